@@ -31,6 +31,7 @@ list(APPEND thirdparty_libraries
 
 list(APPEND LIBRARY_SOURCES
         src/dummy.cpp
+        src/cpi/CpiBase.cpp
         src/cpi/CpiV1.cpp
         src/cpi/CpiV2.cpp
         src/sim/BsplineSE3.cpp
@@ -43,7 +44,11 @@ list(APPEND LIBRARY_SOURCES
         src/feat/Feature.cpp
         src/feat/FeatureDatabase.cpp
         src/feat/FeatureInitializer.cpp
+        src/utils/alloc_audit.cpp
+        src/utils/memory_arena.cpp
         src/utils/print.cpp
+        src/utils/thread_registry.cpp
+        src/utils/tracer.cpp
 )
 file(GLOB_RECURSE LIBRARY_HEADERS "src/*.h")
 add_library(ov_core_lib SHARED ${LIBRARY_SOURCES} ${LIBRARY_HEADERS})
@@ -22,13 +22,84 @@
 #ifndef OV_CORE_CAM_BASE_H
 #define OV_CORE_CAM_BASE_H
 
-#include <Eigen/Eigen>
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cmath>
 #include <unordered_map>
+#include <vector>
 
+#include <Eigen/Eigen>
 #include <opencv2/opencv.hpp>
 
 namespace ov_core {
 
+/**
+ * @brief Forward-mode dual number used to template-differentiate the distortion models.
+ *
+ * Holds a value plus a row of ten partial derivatives: the two normalized coordinates
+ * followed by the eight intrinsic parameters. Each derived camera model writes its
+ * distortion math once as a kernel templated on the scalar type; evaluating that kernel
+ * with this type produces the distorted point together with both calibration Jacobians
+ * in a single pass (the gradient rows are fixed-size so Eigen vectorizes the arithmetic),
+ * and the derivatives can never drift out of sync with the value computation.
+ */
+struct DistortDual {
+
+  /// Value of this quantity
+  double v = 0.0;
+
+  /// Partials in respect to (x_n, y_n, f_x, f_y, c_x, c_y, d_1, d_2, d_3, d_4)
+  Eigen::Matrix<double, 1, 10> g = Eigen::Matrix<double, 1, 10>::Zero();
+
+  DistortDual() = default;
+
+  /// Constants carry a zero derivative (implicit so kernels can mix plain literals in)
+  DistortDual(double value) : v(value) {}
+
+  /// An independent variable: unit derivative in its own slot
+  static DistortDual seed(double value, int index) {
+    DistortDual dual(value);
+    dual.g(index) = 1.0;
+    return dual;
+  }
+};
+
+inline DistortDual operator+(const DistortDual &a, const DistortDual &b) {
+  DistortDual c(a.v + b.v);
+  c.g = a.g + b.g;
+  return c;
+}
+inline DistortDual operator-(const DistortDual &a, const DistortDual &b) {
+  DistortDual c(a.v - b.v);
+  c.g = a.g - b.g;
+  return c;
+}
+inline DistortDual operator*(const DistortDual &a, const DistortDual &b) {
+  DistortDual c(a.v * b.v);
+  c.g = a.v * b.g + b.v * a.g;
+  return c;
+}
+inline DistortDual operator/(const DistortDual &a, const DistortDual &b) {
+  DistortDual c(a.v / b.v);
+  c.g = (a.g - c.v * b.g) / b.v;
+  return c;
+}
+inline DistortDual sqrt(const DistortDual &a) {
+  DistortDual c(std::sqrt(a.v));
+  c.g = a.g * (0.5 / c.v);
+  return c;
+}
+inline DistortDual atan(const DistortDual &a) {
+  DistortDual c(std::atan(a.v));
+  c.g = a.g / (1.0 + a.v * a.v);
+  return c;
+}
+
+/// Plain value of a kernel scalar (lets templated kernels branch on magnitudes)
+inline double dual_value(double a) { return a; }
+inline double dual_value(const DistortDual &a) { return a.v; }
+
 /**
  * @brief Base pinhole camera model class
  *
@@ -48,6 +119,24 @@ public:
 
   virtual ~CamBase() {}
 
+  /**
+   * @brief Inlined fixed-size block holding all calibration values a reader needs.
+   *
+   * The raw vector, camera matrix and distortion are all stored by value in a single
+   * cache-line aligned struct (no heap indirection as with a dynamic Eigen matrix).
+   * A published block is treated as immutable: set_value() fills a fresh one and swaps
+   * it in under the epoch counter, so a concurrent reader can never observe a mix of
+   * old and new intrinsics while online calibration refines them.
+   */
+  struct alignas(64) CalibData {
+    /// Raw set of camera intrinic values (f_x & f_y & c_x & c_y & k_1 & k_2 & k_3 & k_4)
+    Eigen::Matrix<double, 8, 1> camera_values = Eigen::Matrix<double, 8, 1>::Zero();
+    /// Camera intrinsics in OpenCV format
+    cv::Matx33d camera_k_OPENCV;
+    /// Camera distortion in OpenCV format
+    cv::Vec4d camera_d_OPENCV;
+  };
+
   /**
    * @brief This will set and update the camera calibration values.
    * This should be called on startup for each camera and after update!
@@ -57,7 +146,8 @@ public:
 
     // Assert we are of size eight
     assert(calib.rows() == 8);
-    camera_values = calib;
+    CalibData data;
+    data.camera_values = calib;
 
     // Camera matrix
     cv::Matx33d tempK;
@@ -70,7 +160,7 @@ public:
     tempK(2, 0) = 0;
     tempK(2, 1) = 0;
     tempK(2, 2) = 1;
-    camera_k_OPENCV = tempK;
+    data.camera_k_OPENCV = tempK;
 
     // Distortion parameters
     cv::Vec4d tempD;
@@ -78,7 +168,13 @@ public:
     tempD(1) = calib(5);
     tempD(2) = calib(6);
     tempD(3) = calib(7);
-    camera_d_OPENCV = tempD;
+    data.camera_d_OPENCV = tempD;
+
+    // Publish through the seqlock so get_calib() readers on other threads (e.g. the
+    // trackers while the update thread refines the intrinsics) never see a torn write
+    calib_epoch.fetch_add(1, std::memory_order_acq_rel);
+    calib_data = data;
+    calib_epoch.fetch_add(1, std::memory_order_release);
   }
 
   /**
@@ -115,6 +211,22 @@ public:
     return pt_out;
   }
 
+  /**
+   * @brief Batch version of undistort_cv() which processes a whole vector of points at once.
+   * @param pts_dist Raw uv coordinates we wish to undistort
+   * @param pts_norm Vector that will be filled with the normalized coordinates (resized internally)
+   *
+   * Derived models override this so the calibration values are loaded once and the
+   * per-point math is fully inlined, thus the several-hundred-point-per-frame
+   * normalization loops pay a single virtual dispatch instead of one per point.
+   */
+  virtual void undistort_batch_cv(const std::vector<cv::Point2f> &pts_dist, std::vector<cv::Point2f> &pts_norm) {
+    pts_norm.resize(pts_dist.size());
+    for (size_t i = 0; i < pts_dist.size(); i++) {
+      pts_norm.at(i) = undistort_cv(pts_dist.at(i));
+    }
+  }
+
   /**
    * @brief Given a normalized uv coordinate this will distort it to the raw image plane
    * @param uv_norm Normalized coordinates we wish to distort
@@ -149,6 +261,22 @@ public:
     return pt_out;
   }
 
+  /**
+   * @brief Batch version of distort_f() which processes a whole vector of points at once.
+   * @param pts_norm Normalized coordinates we wish to distort
+   * @param pts_dist Vector that will be filled with the raw image plane coordinates (resized internally)
+   *
+   * Mirrors undistort_batch_cv(): derived models override this so the calibration is
+   * loaded once and the per-point math is fully inlined, instead of paying a virtual
+   * dispatch and a calibration snapshot for every point.
+   */
+  virtual void distort_batch_f(const std::vector<Eigen::Vector2f> &pts_norm, std::vector<Eigen::Vector2f> &pts_dist) {
+    pts_dist.resize(pts_norm.size());
+    for (size_t i = 0; i < pts_norm.size(); i++) {
+      pts_dist.at(i) = distort_f(pts_norm.at(i));
+    }
+  }
+
   /**
    * @brief Computes the derivative of raw distorted to normalized coordinate.
    * @param uv_norm Normalized coordinates we wish to distort
@@ -157,14 +285,97 @@ public:
    */
   virtual void compute_distort_jacobian(const Eigen::Vector2d &uv_norm, Eigen::MatrixXd &H_dz_dzn, Eigen::MatrixXd &H_dz_dzeta) = 0;
 
+  /**
+   * @brief Computes only the derivative of raw distorted to normalized coordinate.
+   * @param uv_norm Normalized coordinates we wish to distort
+   * @param H_dz_dzn Derivative of measurement z in respect to normalized
+   *
+   * Reduced version of compute_distort_jacobian() for when the camera intrinsics are
+   * not being calibrated online, thus the derivative in respect to them is never used.
+   */
+  virtual void compute_distort_jacobian_norm(const Eigen::Vector2d &uv_norm, Eigen::MatrixXd &H_dz_dzn) = 0;
+
+  /**
+   * @brief Fused distortion: the raw coordinate and both Jacobians from one model pass.
+   * @param uv_norm Normalized coordinates we wish to distort
+   * @param uv_dist Raw image plane coordinate of the point
+   * @param H_dz_dzn Derivative of measurement z in respect to normalized
+   * @param H_dz_dzeta Derivative of measurement z in respect to intrinic parameters
+   *
+   * Calibration-enabled runs need the distorted point and both derivatives for every
+   * measurement, which as separate calls traverses the distortion model three times.
+   * This evaluates the templated model kernel once on @ref DistortDual scalars, so
+   * value and derivatives come out of the same pass.
+   */
+  virtual void compute_distort_value_jacobian(const Eigen::Vector2d &uv_norm, Eigen::Vector2d &uv_dist, Eigen::MatrixXd &H_dz_dzn,
+                                              Eigen::MatrixXd &H_dz_dzeta) = 0;
+
+  /**
+   * @brief Batch version of compute_distort_value_jacobian() for a whole vector of points.
+   * @param pts_norm Normalized coordinates we wish to distort
+   * @param pts_dist Vector filled with the raw image plane coordinates (resized internally)
+   * @param H_dz_dzn Vector filled with the derivatives in respect to normalized (resized internally)
+   * @param H_dz_dzeta Vector filled with the derivatives in respect to intrinsics (resized internally)
+   *
+   * Mirrors distort_batch_f(): derived models override this so the calibration snapshot
+   * is taken once and the dual-number kernel is fully inlined over the array.
+   */
+  virtual void compute_distort_value_jacobian_batch(const std::vector<Eigen::Vector2d> &pts_norm, std::vector<Eigen::Vector2d> &pts_dist,
+                                                    std::vector<Eigen::MatrixXd> &H_dz_dzn, std::vector<Eigen::MatrixXd> &H_dz_dzeta) {
+    pts_dist.resize(pts_norm.size());
+    H_dz_dzn.resize(pts_norm.size());
+    H_dz_dzeta.resize(pts_norm.size());
+    for (size_t i = 0; i < pts_norm.size(); i++) {
+      compute_distort_value_jacobian(pts_norm.at(i), pts_dist.at(i), H_dz_dzn.at(i), H_dz_dzeta.at(i));
+    }
+  }
+
+  /**
+   * @brief Enables the quantized undistortion lookup table for this camera.
+   * @param spacing Grid node spacing in raw pixels (smaller is more accurate but bigger table)
+   * @param rebuild_thresh How far (pixels) the intrinsics may drift before the table is rebuilt
+   *
+   * When enabled, undistort_f() answers from a precomputed grid of exactly-undistorted
+   * nodes with bilinear interpolation in between, instead of running the iterative
+   * model solve per point. Since online intrinsic refinement only moves the calibration
+   * by sub-pixel amounts, the table is rebuilt lazily and only once the values have
+   * drifted beyond the given threshold.
+   */
+  void enable_undistort_lut(double spacing = 4.0, double rebuild_thresh = 0.01) {
+    assert(spacing > 0);
+    lut_enabled = true;
+    lut_spacing = spacing;
+    lut_thresh = rebuild_thresh;
+  }
+
   /// Gets the complete intrinsic vector
-  Eigen::MatrixXd get_value() { return camera_values; }
+  Eigen::MatrixXd get_value() { return get_calib().camera_values; }
 
   /// Gets the camera matrix
-  cv::Matx33d get_K() { return camera_k_OPENCV; }
+  cv::Matx33d get_K() { return get_calib().camera_k_OPENCV; }
 
   /// Gets the camera distortion
-  cv::Vec4d get_D() { return camera_d_OPENCV; }
+  cv::Vec4d get_D() { return get_calib().camera_d_OPENCV; }
+
+  /**
+   * @brief Gets a consistent copy of the whole calibration block.
+   *
+   * Standard seqlock read: retry if set_value() was mid-publish or published in
+   * between, thus the returned block is always internally consistent. Callers that
+   * touch the calibration more than once (per-point loops, jacobians) should grab
+   * one snapshot and work from it rather than calling the individual getters.
+   */
+  CalibData get_calib() const {
+    for (;;) {
+      uint32_t seq0 = calib_epoch.load(std::memory_order_acquire);
+      if (seq0 % 2 != 0)
+        continue;
+      CalibData data = calib_data;
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (calib_epoch.load(std::memory_order_relaxed) == seq0)
+        return data;
+    }
+  }
 
   /// Gets the width of the camera images
   int w() { return _width; }
@@ -176,20 +387,118 @@ protected:
   // Cannot construct the base camera class, needs a distortion model
   CamBase() = default;
 
-  /// Raw set of camera intrinic values (f_x & f_y & c_x & c_y & k_1 & k_2 & k_3 & k_4)
-  Eigen::MatrixXd camera_values;
+  /**
+   * @brief Runs a distortion kernel on dual numbers and unpacks value plus Jacobians.
+   * @param kernel Templated distortion kernel of the derived model (DistortDual instance)
+   * @param uv_norm Normalized coordinates we wish to distort
+   * @param cam_vals Calibration values to distort with (one consistent snapshot)
+   * @param uv_dist Raw image plane coordinate of the point
+   * @param H_dz_dzn Derivative of measurement z in respect to normalized
+   * @param H_dz_dzeta Derivative of measurement z in respect to intrinic parameters
+   */
+  template <typename Kernel>
+  static void distort_dual_eval(const Kernel &kernel, const Eigen::Vector2d &uv_norm, const Eigen::Matrix<double, 8, 1> &cam_vals,
+                                Eigen::Vector2d &uv_dist, Eigen::MatrixXd &H_dz_dzn, Eigen::MatrixXd &H_dz_dzeta) {
 
-  /// Camera intrinsics in OpenCV format
-  cv::Matx33d camera_k_OPENCV;
+    // Seed the independent variables (normalized point first, then the intrinsics)
+    DistortDual xn = DistortDual::seed(uv_norm(0), 0);
+    DistortDual yn = DistortDual::seed(uv_norm(1), 1);
+    DistortDual cam_d[8];
+    for (int i = 0; i < 8; i++)
+      cam_d[i] = DistortDual::seed(cam_vals(i), 2 + i);
 
-  /// Camera distortion in OpenCV format
-  cv::Vec4d camera_d_OPENCV;
+    // One forward pass through the model computes value and all partials
+    DistortDual u, v;
+    kernel(xn, yn, cam_d, u, v);
+    uv_dist << u.v, v.v;
+    H_dz_dzn.resize(2, 2);
+    H_dz_dzn.row(0) = u.g.segment<2>(0);
+    H_dz_dzn.row(1) = v.g.segment<2>(0);
+    H_dz_dzeta.resize(2, 8);
+    H_dz_dzeta.row(0) = u.g.segment<8>(2);
+    H_dz_dzeta.row(1) = v.g.segment<8>(2);
+  }
+
+  /**
+   * @brief Returns true if the lookup table should be used for undistortion.
+   * Lazily (re)builds the table if it is stale or the intrinsics have drifted.
+   */
+  bool undistort_lut_active() {
+    if (!lut_enabled || lut_building)
+      return false;
+    if (!lut_valid || (get_calib().camera_values - lut_values).cwiseAbs().maxCoeff() > lut_thresh)
+      build_undistort_lut();
+    return lut_valid;
+  }
+
+  /// Answers an undistortion query from the lookup table with bilinear interpolation
+  Eigen::Vector2f undistort_lut(float u, float v) {
+    double gx = (double)u / lut_spacing;
+    double gy = (double)v / lut_spacing;
+    int ix = std::max(0, std::min(lut_cols - 2, (int)gx));
+    int iy = std::max(0, std::min(lut_rows - 2, (int)gy));
+    float ax = (float)(gx - ix);
+    float ay = (float)(gy - iy);
+    const Eigen::Vector2f &p00 = lut_table.at(iy * lut_cols + ix);
+    const Eigen::Vector2f &p01 = lut_table.at(iy * lut_cols + ix + 1);
+    const Eigen::Vector2f &p10 = lut_table.at((iy + 1) * lut_cols + ix);
+    const Eigen::Vector2f &p11 = lut_table.at((iy + 1) * lut_cols + ix + 1);
+    return (1 - ay) * ((1 - ax) * p00 + ax * p01) + ay * ((1 - ax) * p10 + ax * p11);
+  }
+
+  /// Fills the lookup table by exactly undistorting each grid node with the current intrinsics
+  void build_undistort_lut() {
+    lut_building = true;
+    lut_cols = (int)std::ceil((double)_width / lut_spacing) + 1;
+    lut_rows = (int)std::ceil((double)_height / lut_spacing) + 1;
+    lut_table.resize((size_t)lut_cols * lut_rows);
+    for (int iy = 0; iy < lut_rows; iy++) {
+      for (int ix = 0; ix < lut_cols; ix++) {
+        Eigen::Vector2f uv_dist((float)(ix * lut_spacing), (float)(iy * lut_spacing));
+        lut_table.at((size_t)iy * lut_cols + ix) = undistort_f(uv_dist);
+      }
+    }
+    lut_values = get_calib().camera_values;
+    lut_valid = true;
+    lut_building = false;
+  }
+
+  /// Current calibration block (readers must copy it through get_calib())
+  CalibData calib_data;
+
+  /// Epoch counter guarding calib_data (odd while set_value() is publishing)
+  std::atomic<uint32_t> calib_epoch{0};
 
   /// Width of the camera (raw pixels)
   int _width;
 
   /// Height of the camera (raw pixels)
   int _height;
+
+  /// If the undistortion lookup table mode has been enabled
+  bool lut_enabled = false;
+
+  /// If the current table contents are usable (false until the first build)
+  bool lut_valid = false;
+
+  /// Guard so the exact path is used while the table itself is being filled
+  bool lut_building = false;
+
+  /// Grid node spacing of the lookup table (raw pixels)
+  double lut_spacing = 4.0;
+
+  /// Intrinsic drift (pixels) which triggers a lazy table rebuild
+  double lut_thresh = 0.01;
+
+  /// Table dimensions (nodes, not pixels)
+  int lut_cols = 0;
+  int lut_rows = 0;
+
+  /// Exactly-undistorted normalized coordinates of each grid node (row major)
+  std::vector<Eigen::Vector2f> lut_table;
+
+  /// Snapshot of the intrinsics the table was built with
+  Eigen::Matrix<double, 8, 1> lut_values = Eigen::Matrix<double, 8, 1>::Zero();
 };
 
 } // namespace ov_core
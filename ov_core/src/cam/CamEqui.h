@@ -106,26 +106,23 @@ public:
    * @return 2d vector of normalized coordinates
    */
   Eigen::Vector2f undistort_f(const Eigen::Vector2f &uv_dist) override {
+    if (undistort_lut_active())
+      return undistort_lut(uv_dist(0), uv_dist(1));
+    return undistort_single(uv_dist(0), uv_dist(1));
+  }
 
-    // Determine what camera parameters we should use
-    cv::Matx33d camK = camera_k_OPENCV;
-    cv::Vec4d camD = camera_d_OPENCV;
-
-    // Convert point to opencv format
-    cv::Mat mat(1, 2, CV_32F);
-    mat.at<float>(0, 0) = uv_dist(0);
-    mat.at<float>(0, 1) = uv_dist(1);
-    mat = mat.reshape(2); // Nx1, 2-channel
-
-    // Undistort it!
-    cv::fisheye::undistortPoints(mat, mat, camK, camD);
-
-    // Construct our return vector
-    Eigen::Vector2f pt_out;
-    mat = mat.reshape(1); // Nx2, 1-channel
-    pt_out(0) = mat.at<float>(0, 0);
-    pt_out(1) = mat.at<float>(0, 1);
-    return pt_out;
+  /**
+   * @brief Batch version of undistort_cv() which processes a whole vector of points at once.
+   * @param pts_dist Raw uv coordinates we wish to undistort
+   * @param pts_norm Vector that will be filled with the normalized coordinates (resized internally)
+   */
+  void undistort_batch_cv(const std::vector<cv::Point2f> &pts_dist, std::vector<cv::Point2f> &pts_norm) override {
+    pts_norm.resize(pts_dist.size());
+    bool use_lut = undistort_lut_active();
+    for (size_t i = 0; i < pts_dist.size(); i++) {
+      Eigen::Vector2f pt = use_lut ? undistort_lut(pts_dist.at(i).x, pts_dist.at(i).y) : undistort_single(pts_dist.at(i).x, pts_dist.at(i).y);
+      pts_norm.at(i) = cv::Point2f(pt(0), pt(1));
+    }
   }
 
   /**
@@ -134,9 +131,36 @@ public:
    * @return 2d vector of raw uv coordinate
    */
   Eigen::Vector2f distort_f(const Eigen::Vector2f &uv_norm) override {
+    const Eigen::Matrix<double, 8, 1> cam_d = get_calib().camera_values;
+    return distort_single(uv_norm, cam_d);
+  }
+
+  /**
+   * @brief Batch version of distort_f() which processes a whole vector of points at once.
+   * @param pts_norm Normalized coordinates we wish to distort
+   * @param pts_dist Vector that will be filled with the raw image plane coordinates (resized internally)
+   */
+  void distort_batch_f(const std::vector<Eigen::Vector2f> &pts_norm, std::vector<Eigen::Vector2f> &pts_dist) override {
+    const Eigen::Matrix<double, 8, 1> cam_d = get_calib().camera_values;
+    pts_dist.resize(pts_norm.size());
+    for (size_t i = 0; i < pts_norm.size(); i++) {
+      pts_dist.at(i) = distort_single(pts_norm.at(i), cam_d);
+    }
+  }
+
+  /**
+   * @brief Computes the derivative of raw distorted to normalized coordinate.
+   * @param uv_norm Normalized coordinates we wish to distort
+   * @param H_dz_dzn Derivative of measurement z in respect to normalized
+   * @param H_dz_dzeta Derivative of measurement z in respect to intrinic parameters
+   */
+  void compute_distort_jacobian(const Eigen::Vector2d &uv_norm, Eigen::MatrixXd &H_dz_dzn, Eigen::MatrixXd &H_dz_dzeta) override {
+
+    // Jacobian of distorted pixel to normalized pixel
+    compute_distort_jacobian_norm(uv_norm, H_dz_dzn);
 
-    // Get our camera parameters
-    Eigen::MatrixXd cam_d = camera_values;
+    // Get our camera parameters (one consistent snapshot)
+    const Eigen::Matrix<double, 8, 1> cam_d = get_calib().camera_values;
 
     // Calculate distorted coordinates for fisheye
     double r = std::sqrt(uv_norm(0) * uv_norm(0) + uv_norm(1) * uv_norm(1));
@@ -149,24 +173,34 @@ public:
     double cdist = (r > 1e-8) ? theta_d * inv_r : 1.0;
 
     // Calculate distorted coordinates for fisheye
-    Eigen::Vector2f uv_dist;
     double x1 = uv_norm(0) * cdist;
     double y1 = uv_norm(1) * cdist;
-    uv_dist(0) = (float)(cam_d(0) * x1 + cam_d(2));
-    uv_dist(1) = (float)(cam_d(1) * y1 + cam_d(3));
-    return uv_dist;
+
+    // Compute the Jacobian in respect to the intrinsics
+    H_dz_dzeta = Eigen::MatrixXd::Zero(2, 8);
+    H_dz_dzeta(0, 0) = x1;
+    H_dz_dzeta(0, 2) = 1;
+    H_dz_dzeta(0, 4) = cam_d(0) * uv_norm(0) * inv_r * std::pow(theta, 3);
+    H_dz_dzeta(0, 5) = cam_d(0) * uv_norm(0) * inv_r * std::pow(theta, 5);
+    H_dz_dzeta(0, 6) = cam_d(0) * uv_norm(0) * inv_r * std::pow(theta, 7);
+    H_dz_dzeta(0, 7) = cam_d(0) * uv_norm(0) * inv_r * std::pow(theta, 9);
+    H_dz_dzeta(1, 1) = y1;
+    H_dz_dzeta(1, 3) = 1;
+    H_dz_dzeta(1, 4) = cam_d(1) * uv_norm(1) * inv_r * std::pow(theta, 3);
+    H_dz_dzeta(1, 5) = cam_d(1) * uv_norm(1) * inv_r * std::pow(theta, 5);
+    H_dz_dzeta(1, 6) = cam_d(1) * uv_norm(1) * inv_r * std::pow(theta, 7);
+    H_dz_dzeta(1, 7) = cam_d(1) * uv_norm(1) * inv_r * std::pow(theta, 9);
   }
 
   /**
-   * @brief Computes the derivative of raw distorted to normalized coordinate.
+   * @brief Computes only the derivative of raw distorted to normalized coordinate.
    * @param uv_norm Normalized coordinates we wish to distort
    * @param H_dz_dzn Derivative of measurement z in respect to normalized
-   * @param H_dz_dzeta Derivative of measurement z in respect to intrinic parameters
    */
-  void compute_distort_jacobian(const Eigen::Vector2d &uv_norm, Eigen::MatrixXd &H_dz_dzn, Eigen::MatrixXd &H_dz_dzeta) override {
+  void compute_distort_jacobian_norm(const Eigen::Vector2d &uv_norm, Eigen::MatrixXd &H_dz_dzn) override {
 
-    // Get our camera parameters
-    Eigen::MatrixXd cam_d = camera_values;
+    // Get our camera parameters (one consistent snapshot)
+    const Eigen::Matrix<double, 8, 1> cam_d = get_calib().camera_values;
 
     // Calculate distorted coordinates for fisheye
     double r = std::sqrt(uv_norm(0) * uv_norm(0) + uv_norm(1) * uv_norm(1));
@@ -176,7 +210,6 @@ public:
 
     // Handle when r is small (meaning our xy is near the camera center)
     double inv_r = (r > 1e-8) ? 1.0 / r : 1.0;
-    double cdist = (r > 1e-8) ? theta_d * inv_r : 1.0;
 
     // Jacobian of distorted pixel to "normalized" pixel
     Eigen::Matrix<double, 2, 2> duv_dxy = Eigen::Matrix<double, 2, 2>::Zero();
@@ -208,25 +241,129 @@ public:
     // Total Jacobian wrt normalized pixel coordinates
     H_dz_dzn = Eigen::MatrixXd::Zero(2, 2);
     H_dz_dzn = duv_dxy * (dxy_dxyn + (dxy_dr + dxy_dthd * dthd_dth * dth_dr) * dr_dxyn);
+  }
 
-    // Calculate distorted coordinates for fisheye
-    double x1 = uv_norm(0) * cdist;
-    double y1 = uv_norm(1) * cdist;
+  /**
+   * @brief Fused distortion: the raw coordinate and both Jacobians from one model pass.
+   * @param uv_norm Normalized coordinates we wish to distort
+   * @param uv_dist Raw image plane coordinate of the point
+   * @param H_dz_dzn Derivative of measurement z in respect to normalized
+   * @param H_dz_dzeta Derivative of measurement z in respect to intrinic parameters
+   */
+  void compute_distort_value_jacobian(const Eigen::Vector2d &uv_norm, Eigen::Vector2d &uv_dist, Eigen::MatrixXd &H_dz_dzn,
+                                      Eigen::MatrixXd &H_dz_dzeta) override {
+    const Eigen::Matrix<double, 8, 1> cam_d = get_calib().camera_values;
+    distort_dual_eval(&CamEqui::distort_kernel<DistortDual>, uv_norm, cam_d, uv_dist, H_dz_dzn, H_dz_dzeta);
+  }
 
-    // Compute the Jacobian in respect to the intrinsics
-    H_dz_dzeta = Eigen::MatrixXd::Zero(2, 8);
-    H_dz_dzeta(0, 0) = x1;
-    H_dz_dzeta(0, 2) = 1;
-    H_dz_dzeta(0, 4) = cam_d(0) * uv_norm(0) * inv_r * std::pow(theta, 3);
-    H_dz_dzeta(0, 5) = cam_d(0) * uv_norm(0) * inv_r * std::pow(theta, 5);
-    H_dz_dzeta(0, 6) = cam_d(0) * uv_norm(0) * inv_r * std::pow(theta, 7);
-    H_dz_dzeta(0, 7) = cam_d(0) * uv_norm(0) * inv_r * std::pow(theta, 9);
-    H_dz_dzeta(1, 1) = y1;
-    H_dz_dzeta(1, 3) = 1;
-    H_dz_dzeta(1, 4) = cam_d(1) * uv_norm(1) * inv_r * std::pow(theta, 3);
-    H_dz_dzeta(1, 5) = cam_d(1) * uv_norm(1) * inv_r * std::pow(theta, 5);
-    H_dz_dzeta(1, 6) = cam_d(1) * uv_norm(1) * inv_r * std::pow(theta, 7);
-    H_dz_dzeta(1, 7) = cam_d(1) * uv_norm(1) * inv_r * std::pow(theta, 9);
+  /**
+   * @brief Batch version of compute_distort_value_jacobian() for a whole vector of points.
+   * @param pts_norm Normalized coordinates we wish to distort
+   * @param pts_dist Vector filled with the raw image plane coordinates (resized internally)
+   * @param H_dz_dzn Vector filled with the derivatives in respect to normalized (resized internally)
+   * @param H_dz_dzeta Vector filled with the derivatives in respect to intrinsics (resized internally)
+   */
+  void compute_distort_value_jacobian_batch(const std::vector<Eigen::Vector2d> &pts_norm, std::vector<Eigen::Vector2d> &pts_dist,
+                                            std::vector<Eigen::MatrixXd> &H_dz_dzn, std::vector<Eigen::MatrixXd> &H_dz_dzeta) override {
+    const Eigen::Matrix<double, 8, 1> cam_d = get_calib().camera_values;
+    pts_dist.resize(pts_norm.size());
+    H_dz_dzn.resize(pts_norm.size());
+    H_dz_dzeta.resize(pts_norm.size());
+    for (size_t i = 0; i < pts_norm.size(); i++) {
+      distort_dual_eval(&CamEqui::distort_kernel<DistortDual>, pts_norm.at(i), cam_d, pts_dist.at(i), H_dz_dzn.at(i), H_dz_dzeta.at(i));
+    }
+  }
+
+private:
+  /**
+   * @brief Fisheye distortion model written once for any scalar type.
+   * @param xn Normalized horizontal coordinate
+   * @param yn Normalized vertical coordinate
+   * @param cam_d Calibration values to distort with (f_x & f_y & c_x & c_y & k_1 & k_2 & k_3 & k_4)
+   * @param u Raw horizontal image plane coordinate
+   * @param v Raw vertical image plane coordinate
+   *
+   * Instantiated with double for the plain value path and with @ref DistortDual for the
+   * fused value+Jacobian path, so there is a single authoritative model derivation.
+   * Points at the camera center keep the distortion factor pinned at one (same guard as
+   * the scalar code), which also keeps the dual derivatives finite there.
+   */
+  template <typename Scalar> static void distort_kernel(const Scalar &xn, const Scalar &yn, const Scalar *cam_d, Scalar &u, Scalar &v) {
+    using std::atan;
+    using std::sqrt;
+    Scalar r = sqrt(xn * xn + yn * yn);
+    Scalar cdist = Scalar(1.0);
+    if (dual_value(r) > 1e-8) {
+      Scalar theta = atan(r);
+      Scalar theta_2 = theta * theta;
+      Scalar theta_d = theta * (1.0 + theta_2 * (cam_d[4] + theta_2 * (cam_d[5] + theta_2 * (cam_d[6] + theta_2 * cam_d[7]))));
+      cdist = theta_d / r;
+    }
+    Scalar x1 = xn * cdist;
+    Scalar y1 = yn * cdist;
+    u = cam_d[0] * x1 + cam_d[2];
+    v = cam_d[1] * y1 + cam_d[3];
+  }
+
+  /**
+   * @brief Single-point fisheye distortion kernel working from an already-loaded calibration
+   * @param uv_norm Normalized coordinates we wish to distort
+   * @param cam_d Calibration values to distort with
+   * @return 2d vector of raw uv coordinate
+   */
+  static Eigen::Vector2f distort_single(const Eigen::Vector2f &uv_norm, const Eigen::Matrix<double, 8, 1> &cam_d) {
+    double u, v;
+    distort_kernel<double>((double)uv_norm(0), (double)uv_norm(1), cam_d.data(), u, v);
+    return Eigen::Vector2f((float)u, (float)v);
+  }
+
+  /**
+   * @brief Native single-point undistortion kernel (no OpenCV mat setup per call)
+   * @param u Raw horizontal pixel coordinate
+   * @param v Raw vertical pixel coordinate
+   * @return 2d vector of normalized coordinates
+   *
+   * This performs the same theta solve as cv::fisheye::undistortPoints (Newton
+   * iterations on the equidistant polynomial), but inlined so we skip the per-point
+   * cv::Mat allocation and parameter conversion.
+   */
+  Eigen::Vector2f undistort_single(float u, float v) {
+
+    // Load the calibration once into locals (one consistent snapshot)
+    const CalibData calib = get_calib();
+    double fx = calib.camera_k_OPENCV(0, 0);
+    double fy = calib.camera_k_OPENCV(1, 1);
+    double cx = calib.camera_k_OPENCV(0, 2);
+    double cy = calib.camera_k_OPENCV(1, 2);
+    double k1 = calib.camera_d_OPENCV(0);
+    double k2 = calib.camera_d_OPENCV(1);
+    double k3 = calib.camera_d_OPENCV(2);
+    double k4 = calib.camera_d_OPENCV(3);
+
+    // Back-project through the pinhole to get the distorted normalized point
+    double x = ((double)u - cx) / fx;
+    double y = ((double)v - cy) / fy;
+    double theta_d = std::sqrt(x * x + y * y);
+
+    // Newton solve for theta such that theta*(1+k1*theta^2+...) = theta_d
+    double scale = 1.0;
+    if (theta_d > 1e-8) {
+      double theta = theta_d;
+      for (int i = 0; i < 10; i++) {
+        double theta2 = theta * theta;
+        double theta4 = theta2 * theta2;
+        double theta6 = theta4 * theta2;
+        double theta8 = theta6 * theta2;
+        double k_poly = 1.0 + k1 * theta2 + k2 * theta4 + k3 * theta6 + k4 * theta8;
+        double k_poly_deriv = 1.0 + 3.0 * k1 * theta2 + 5.0 * k2 * theta4 + 7.0 * k3 * theta6 + 9.0 * k4 * theta8;
+        double theta_fix = (theta * k_poly - theta_d) / k_poly_deriv;
+        theta -= theta_fix;
+        if (std::abs(theta_fix) < 1e-10)
+          break;
+      }
+      scale = std::tan(theta) / theta_d;
+    }
+    return Eigen::Vector2f((float)(x * scale), (float)(y * scale));
   }
 };
 
@@ -0,0 +1,197 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2018-2023 Patrick Geneva
+ * Copyright (C) 2018-2023 Guoquan Huang
+ * Copyright (C) 2018-2023 OpenVINS Contributors
+ * Copyright (C) 2018-2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OV_CORE_CAM_RECTIFIED_H
+#define OV_CORE_CAM_RECTIFIED_H
+
+#include "CamBase.h"
+
+namespace ov_core {
+
+/**
+ * @brief Distortion-free pinhole camera model for pre-rectified input
+ *
+ * Some sensor drivers rectify (or undistort) the images on their ISP before they ever reach
+ * us, in which case the projection reduces to the pure pinhole:
+ *
+ * \f{align*}{
+ * \begin{bmatrix} u \\ v \end{bmatrix}:= \mathbf{z}_k &= \mathbf h_d(\mathbf{z}_{n,k}, ~\boldsymbol\zeta)
+ * = \begin{bmatrix}  f_x * x_n + c_x \\
+ * f_y * y_n + c_y \end{bmatrix}
+ * \f}
+ *
+ * where \f$ \mathbf{z}_{n,k} = [ x_n ~ y_n ]^\top\f$ are the normalized coordinates of the 3D
+ * feature. Declaring a camera with this model (distortion_model "rectified" or "none") lets
+ * the whole pipeline skip the iterative distortion solves of @ref ov_core::CamRadtan and
+ * @ref ov_core::CamEqui: normalization is a single affine per point, in both directions, and
+ * the measurement Jacobians are constant in the point. The four distortion entries of the
+ * intrinsic vector are carried along as zeros so the calibration state layout is unchanged
+ * (their Jacobian columns are zero, so online calibration leaves them untouched).
+ */
+class CamRectified : public CamBase {
+
+public:
+  /**
+   * @brief Default constructor
+   * @param width Width of the camera (raw pixels)
+   * @param height Height of the camera (raw pixels)
+   */
+  CamRectified(int width, int height) : CamBase(width, height) {}
+
+  ~CamRectified() {}
+
+  /**
+   * @brief Given a rectified uv point, this will normalize it based on the camera matrix.
+   * @param uv_dist Rectified uv coordinate we wish to normalize
+   * @return 2d vector of normalized coordinates
+   */
+  Eigen::Vector2f undistort_f(const Eigen::Vector2f &uv_dist) override {
+    const Eigen::Matrix<double, 8, 1> cam_d = get_calib().camera_values;
+    return Eigen::Vector2f((float)((uv_dist(0) - cam_d(2)) / cam_d(0)), (float)((uv_dist(1) - cam_d(3)) / cam_d(1)));
+  }
+
+  /**
+   * @brief Batch version of undistort_cv() which processes a whole vector of points at once.
+   * @param pts_dist Rectified uv coordinates we wish to normalize
+   * @param pts_norm Vector that will be filled with the normalized coordinates (resized internally)
+   */
+  void undistort_batch_cv(const std::vector<cv::Point2f> &pts_dist, std::vector<cv::Point2f> &pts_norm) override {
+    const Eigen::Matrix<double, 8, 1> cam_d = get_calib().camera_values;
+    pts_norm.resize(pts_dist.size());
+    for (size_t i = 0; i < pts_dist.size(); i++) {
+      pts_norm.at(i) = cv::Point2f((float)((pts_dist.at(i).x - cam_d(2)) / cam_d(0)), (float)((pts_dist.at(i).y - cam_d(3)) / cam_d(1)));
+    }
+  }
+
+  /**
+   * @brief Given a normalized uv coordinate this will project it to the rectified image plane
+   * @param uv_norm Normalized coordinates we wish to project
+   * @return 2d vector of rectified uv coordinate
+   */
+  Eigen::Vector2f distort_f(const Eigen::Vector2f &uv_norm) override {
+    const Eigen::Matrix<double, 8, 1> cam_d = get_calib().camera_values;
+    return Eigen::Vector2f((float)(cam_d(0) * uv_norm(0) + cam_d(2)), (float)(cam_d(1) * uv_norm(1) + cam_d(3)));
+  }
+
+  /**
+   * @brief Batch version of distort_f() which processes a whole vector of points at once.
+   * @param pts_norm Normalized coordinates we wish to project
+   * @param pts_dist Vector that will be filled with the rectified image plane coordinates (resized internally)
+   */
+  void distort_batch_f(const std::vector<Eigen::Vector2f> &pts_norm, std::vector<Eigen::Vector2f> &pts_dist) override {
+    const Eigen::Matrix<double, 8, 1> cam_d = get_calib().camera_values;
+    pts_dist.resize(pts_norm.size());
+    for (size_t i = 0; i < pts_norm.size(); i++) {
+      pts_dist.at(i) = Eigen::Vector2f((float)(cam_d(0) * pts_norm.at(i)(0) + cam_d(2)), (float)(cam_d(1) * pts_norm.at(i)(1) + cam_d(3)));
+    }
+  }
+
+  /**
+   * @brief Computes the derivative of rectified pixel to normalized coordinate.
+   * @param uv_norm Normalized coordinates we wish to project
+   * @param H_dz_dzn Derivative of measurement z in respect to normalized
+   * @param H_dz_dzeta Derivative of measurement z in respect to intrinic parameters
+   */
+  void compute_distort_jacobian(const Eigen::Vector2d &uv_norm, Eigen::MatrixXd &H_dz_dzn, Eigen::MatrixXd &H_dz_dzeta) override {
+    const Eigen::Matrix<double, 8, 1> cam_d = get_calib().camera_values;
+    H_dz_dzn = Eigen::MatrixXd::Zero(2, 2);
+    H_dz_dzn(0, 0) = cam_d(0);
+    H_dz_dzn(1, 1) = cam_d(1);
+    H_dz_dzeta = Eigen::MatrixXd::Zero(2, 8);
+    H_dz_dzeta(0, 0) = uv_norm(0);
+    H_dz_dzeta(0, 2) = 1;
+    H_dz_dzeta(1, 1) = uv_norm(1);
+    H_dz_dzeta(1, 3) = 1;
+  }
+
+  /**
+   * @brief Computes only the derivative of rectified pixel to normalized coordinate.
+   * @param uv_norm Normalized coordinates we wish to project
+   * @param H_dz_dzn Derivative of measurement z in respect to normalized
+   */
+  void compute_distort_jacobian_norm(const Eigen::Vector2d &uv_norm, Eigen::MatrixXd &H_dz_dzn) override {
+    (void)uv_norm;
+    const Eigen::Matrix<double, 8, 1> cam_d = get_calib().camera_values;
+    H_dz_dzn = Eigen::MatrixXd::Zero(2, 2);
+    H_dz_dzn(0, 0) = cam_d(0);
+    H_dz_dzn(1, 1) = cam_d(1);
+  }
+
+  /**
+   * @brief Fused projection: the rectified coordinate and both Jacobians from one model pass.
+   * @param uv_norm Normalized coordinates we wish to project
+   * @param uv_dist Rectified image plane coordinate of the point
+   * @param H_dz_dzn Derivative of measurement z in respect to normalized
+   * @param H_dz_dzeta Derivative of measurement z in respect to intrinic parameters
+   */
+  void compute_distort_value_jacobian(const Eigen::Vector2d &uv_norm, Eigen::Vector2d &uv_dist, Eigen::MatrixXd &H_dz_dzn,
+                                      Eigen::MatrixXd &H_dz_dzeta) override {
+    const Eigen::Matrix<double, 8, 1> cam_d = get_calib().camera_values;
+    value_jacobian_single(uv_norm, cam_d, uv_dist, H_dz_dzn, H_dz_dzeta);
+  }
+
+  /**
+   * @brief Batch version of compute_distort_value_jacobian() for a whole vector of points.
+   * @param pts_norm Normalized coordinates we wish to project
+   * @param pts_dist Vector filled with the rectified image plane coordinates (resized internally)
+   * @param H_dz_dzn Vector filled with the derivatives in respect to normalized (resized internally)
+   * @param H_dz_dzeta Vector filled with the derivatives in respect to intrinsics (resized internally)
+   */
+  void compute_distort_value_jacobian_batch(const std::vector<Eigen::Vector2d> &pts_norm, std::vector<Eigen::Vector2d> &pts_dist,
+                                            std::vector<Eigen::MatrixXd> &H_dz_dzn, std::vector<Eigen::MatrixXd> &H_dz_dzeta) override {
+    const Eigen::Matrix<double, 8, 1> cam_d = get_calib().camera_values;
+    pts_dist.resize(pts_norm.size());
+    H_dz_dzn.resize(pts_norm.size());
+    H_dz_dzeta.resize(pts_norm.size());
+    for (size_t i = 0; i < pts_norm.size(); i++) {
+      value_jacobian_single(pts_norm.at(i), cam_d, pts_dist.at(i), H_dz_dzn.at(i), H_dz_dzeta.at(i));
+    }
+  }
+
+private:
+  /**
+   * @brief Single-point projection and Jacobians working from an already-loaded calibration
+   * @param uv_norm Normalized coordinates we wish to project
+   * @param cam_d Calibration values to project with (f_x & f_y & c_x & c_y & 0 & 0 & 0 & 0)
+   * @param uv_dist Rectified image plane coordinate of the point
+   * @param H_dz_dzn Derivative of measurement z in respect to normalized
+   * @param H_dz_dzeta Derivative of measurement z in respect to intrinic parameters
+   *
+   * The model is affine so no dual-number pass is needed, the derivatives are written in
+   * closed form (and the distortion columns of the intrinsic Jacobian stay zero).
+   */
+  static void value_jacobian_single(const Eigen::Vector2d &uv_norm, const Eigen::Matrix<double, 8, 1> &cam_d, Eigen::Vector2d &uv_dist,
+                                    Eigen::MatrixXd &H_dz_dzn, Eigen::MatrixXd &H_dz_dzeta) {
+    uv_dist << cam_d(0) * uv_norm(0) + cam_d(2), cam_d(1) * uv_norm(1) + cam_d(3);
+    H_dz_dzn = Eigen::MatrixXd::Zero(2, 2);
+    H_dz_dzn(0, 0) = cam_d(0);
+    H_dz_dzn(1, 1) = cam_d(1);
+    H_dz_dzeta = Eigen::MatrixXd::Zero(2, 8);
+    H_dz_dzeta(0, 0) = uv_norm(0);
+    H_dz_dzeta(0, 2) = 1;
+    H_dz_dzeta(1, 1) = uv_norm(1);
+    H_dz_dzeta(1, 3) = 1;
+  }
+};
+
+} // namespace ov_core
+
+#endif /* OV_CORE_CAM_RECTIFIED_H */
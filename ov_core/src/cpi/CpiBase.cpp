@@ -0,0 +1,38 @@
+
+/*
+ * MIT License
+ * Copyright (c) 2018 Kevin Eckenhoff
+ * Copyright (c) 2018 Patrick Geneva
+ * Copyright (c) 2018 Guoquan Huang
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "CpiBase.h"
+
+#include "utils/sensor_data.h"
+
+using namespace ov_core;
+
+void CpiBase::feed_IMU_bulk(const std::vector<ImuData> &imu_readings) {
+  for (size_t k = 0; k + 1 < imu_readings.size(); k++) {
+    feed_IMU(imu_readings.at(k).timestamp, imu_readings.at(k + 1).timestamp, imu_readings.at(k).wm, imu_readings.at(k).am,
+             imu_readings.at(k + 1).wm, imu_readings.at(k + 1).am);
+  }
+}
@@ -28,9 +28,12 @@
 
 #include "utils/quat_ops.h"
 #include <Eigen/Dense>
+#include <vector>
 
 namespace ov_core {
 
+struct ImuData;
+
 /**
  * @brief Base class for continuous preintegration integrators.
  *
@@ -110,6 +113,16 @@ public:
                         Eigen::Matrix<double, 3, 1> w_m_1 = Eigen::Matrix<double, 3, 1>::Zero(),
                         Eigen::Matrix<double, 3, 1> a_m_1 = Eigen::Matrix<double, 3, 1>::Zero()) = 0;
 
+  /**
+   * @brief Precompounds a whole window of consecutive IMU readings.
+   * @param[in] imu_readings Time-sorted IMU readings to precompound over
+   *
+   * Equivalent to calling @ref feed_IMU on each consecutive pair of readings, but keeps
+   * the per-sample loop inside the integrator which helps when whole multi-second windows
+   * are integrated at once (as the initializers do on each attempt).
+   */
+  void feed_IMU_bulk(const std::vector<ImuData> &imu_readings);
+
   // Flag if we should perform IMU averaging or not
   // For version 1 we should average the measurement
   // For version 2 we average the local true
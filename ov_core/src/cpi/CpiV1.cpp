@@ -114,8 +114,8 @@ void CpiV1::feed_IMU(double t_0, double t_1, Eigen::Matrix<double, 3, 1> w_m_0,
   Eigen::Matrix<double, 3, 3> Beta_arg = (delta_t * eye3 + f_3 * w_x + f_4 * w_x_2);
 
   // Matrices that will multiply the a_hat in the update expressions
-  Eigen::MatrixXd H_al = R_tau12k * alpha_arg;
-  Eigen::MatrixXd H_be = R_tau12k * Beta_arg;
+  Eigen::Matrix<double, 3, 3> H_al = R_tau12k * alpha_arg;
+  Eigen::Matrix<double, 3, 3> H_be = R_tau12k * Beta_arg;
 
   // Update the measurement means
   alpha_tau += beta_tau * delta_t + H_al * a_hat;
@@ -139,9 +139,9 @@ void CpiV1::feed_IMU(double t_0, double t_1, Eigen::Matrix<double, 3, 1> w_m_0,
   H_b -= H_be;
 
   // Derivatives of R_tau12k wrt bias_w entries
-  Eigen::MatrixXd d_R_bw_1 = -R_tau12k * skew_x(J_q * e_1);
-  Eigen::MatrixXd d_R_bw_2 = -R_tau12k * skew_x(J_q * e_2);
-  Eigen::MatrixXd d_R_bw_3 = -R_tau12k * skew_x(J_q * e_3);
+  Eigen::Matrix<double, 3, 3> d_R_bw_1 = -R_tau12k * skew_x(J_q * e_1);
+  Eigen::Matrix<double, 3, 3> d_R_bw_2 = -R_tau12k * skew_x(J_q * e_2);
+  Eigen::Matrix<double, 3, 3> d_R_bw_3 = -R_tau12k * skew_x(J_q * e_3);
 
   // Now compute the gyro bias Jacobian terms
   double df_1_dbw_1;
@@ -246,7 +246,8 @@ void CpiV1::feed_IMU(double t_0, double t_1, Eigen::Matrix<double, 3, 1> w_m_0,
   G_k1.block(9, 9, 3, 3) = eye3;
 
   // Get covariance derivative
-  Eigen::Matrix<double, 15, 15> P_dot_k1 = F_k1 * P_meas + P_meas * F_k1.transpose() + G_k1 * Q_c * G_k1.transpose();
+  Eigen::Matrix<double, 15, 15> P_dot_k1;
+  P_dot_k1.noalias() = F_k1 * P_meas + P_meas * F_k1.transpose() + G_k1 * Q_c * G_k1.transpose();
 
   // k2-------------------------------------------------------------------------------------------------
 
@@ -267,7 +268,8 @@ void CpiV1::feed_IMU(double t_0, double t_1, Eigen::Matrix<double, 3, 1> w_m_0,
 
   // Get covariance derivative
   Eigen::Matrix<double, 15, 15> P_k2 = P_meas + P_dot_k1 * delta_t / 2.0;
-  Eigen::Matrix<double, 15, 15> P_dot_k2 = F_k2 * P_k2 + P_k2 * F_k2.transpose() + G_k2 * Q_c * G_k2.transpose();
+  Eigen::Matrix<double, 15, 15> P_dot_k2;
+  P_dot_k2.noalias() = F_k2 * P_k2 + P_k2 * F_k2.transpose() + G_k2 * Q_c * G_k2.transpose();
 
   // k3-------------------------------------------------------------------------------------------------
 
@@ -278,7 +280,8 @@ void CpiV1::feed_IMU(double t_0, double t_1, Eigen::Matrix<double, 3, 1> w_m_0,
 
   // Get covariance derivative
   Eigen::Matrix<double, 15, 15> P_k3 = P_meas + P_dot_k2 * delta_t / 2.0;
-  Eigen::Matrix<double, 15, 15> P_dot_k3 = F_k3 * P_k3 + P_k3 * F_k3.transpose() + G_k3 * Q_c * G_k3.transpose();
+  Eigen::Matrix<double, 15, 15> P_dot_k3;
+  P_dot_k3.noalias() = F_k3 * P_k3 + P_k3 * F_k3.transpose() + G_k3 * Q_c * G_k3.transpose();
 
   // k4-------------------------------------------------------------------------------------------------
 
@@ -299,7 +302,8 @@ void CpiV1::feed_IMU(double t_0, double t_1, Eigen::Matrix<double, 3, 1> w_m_0,
 
   // Get covariance derivative
   Eigen::Matrix<double, 15, 15> P_k4 = P_meas + P_dot_k3 * delta_t;
-  Eigen::Matrix<double, 15, 15> P_dot_k4 = F_k4 * P_k4 + P_k4 * F_k4.transpose() + G_k4 * Q_c * G_k4.transpose();
+  Eigen::Matrix<double, 15, 15> P_dot_k4;
+  P_dot_k4.noalias() = F_k4 * P_k4 + P_k4 * F_k4.transpose() + G_k4 * Q_c * G_k4.transpose();
 
   // done-------------------------------------------------------------------------------------------------
 
@@ -151,9 +151,9 @@ void CpiV2::feed_IMU(double t_0, double t_1, Eigen::Matrix<double, 3, 1> w_m_0,
   O_b += -H_be * R_k2tau * skew_x(g_k);
 
   // Derivatives of R_tau12k wrt bias_w entries
-  Eigen::MatrixXd d_R_bw_1 = -R_tau12k * skew_x(J_q * e_1);
-  Eigen::MatrixXd d_R_bw_2 = -R_tau12k * skew_x(J_q * e_2);
-  Eigen::MatrixXd d_R_bw_3 = -R_tau12k * skew_x(J_q * e_3);
+  Eigen::Matrix<double, 3, 3> d_R_bw_1 = -R_tau12k * skew_x(J_q * e_1);
+  Eigen::Matrix<double, 3, 3> d_R_bw_2 = -R_tau12k * skew_x(J_q * e_2);
+  Eigen::Matrix<double, 3, 3> d_R_bw_3 = -R_tau12k * skew_x(J_q * e_3);
 
   // Now compute the gyro bias Jacobian terms
   double df_1_dbw_1;
@@ -275,7 +275,8 @@ void CpiV2::feed_IMU(double t_0, double t_1, Eigen::Matrix<double, 3, 1> w_m_0,
 
   // Get state transition and covariance derivative
   Eigen::Matrix<double, 21, 21> Phi_dot_k1 = F_k1;
-  Eigen::Matrix<double, 21, 21> P_dot_k1 = F_k1 * P_big + P_big * F_k1.transpose() + G_k1 * Q_c * G_k1.transpose();
+  Eigen::Matrix<double, 21, 21> P_dot_k1;
+  P_dot_k1.noalias() = F_k1 * P_big + P_big * F_k1.transpose() + G_k1 * Q_c * G_k1.transpose();
 
   // k2-------------------------------------------------------------------------------------------------
 
@@ -300,7 +301,8 @@ void CpiV2::feed_IMU(double t_0, double t_1, Eigen::Matrix<double, 3, 1> w_m_0,
   Eigen::Matrix<double, 21, 21> Phi_k2 = Eigen::Matrix<double, 21, 21>::Identity() + Phi_dot_k1 * dt_mid;
   Eigen::Matrix<double, 21, 21> P_k2 = P_big + P_dot_k1 * dt_mid;
   Eigen::Matrix<double, 21, 21> Phi_dot_k2 = F_k2 * Phi_k2;
-  Eigen::Matrix<double, 21, 21> P_dot_k2 = F_k2 * P_k2 + P_k2 * F_k2.transpose() + G_k2 * Q_c * G_k2.transpose();
+  Eigen::Matrix<double, 21, 21> P_dot_k2;
+  P_dot_k2.noalias() = F_k2 * P_k2 + P_k2 * F_k2.transpose() + G_k2 * Q_c * G_k2.transpose();
 
   // k3-------------------------------------------------------------------------------------------------
 
@@ -313,7 +315,8 @@ void CpiV2::feed_IMU(double t_0, double t_1, Eigen::Matrix<double, 3, 1> w_m_0,
   Eigen::Matrix<double, 21, 21> Phi_k3 = Eigen::Matrix<double, 21, 21>::Identity() + Phi_dot_k2 * dt_mid;
   Eigen::Matrix<double, 21, 21> P_k3 = P_big + P_dot_k2 * dt_mid;
   Eigen::Matrix<double, 21, 21> Phi_dot_k3 = F_k3 * Phi_k3;
-  Eigen::Matrix<double, 21, 21> P_dot_k3 = F_k3 * P_k3 + P_k3 * F_k3.transpose() + G_k3 * Q_c * G_k3.transpose();
+  Eigen::Matrix<double, 21, 21> P_dot_k3;
+  P_dot_k3.noalias() = F_k3 * P_k3 + P_k3 * F_k3.transpose() + G_k3 * Q_c * G_k3.transpose();
 
   // k4-------------------------------------------------------------------------------------------------
 
@@ -338,7 +341,8 @@ void CpiV2::feed_IMU(double t_0, double t_1, Eigen::Matrix<double, 3, 1> w_m_0,
   Eigen::Matrix<double, 21, 21> Phi_k4 = Eigen::Matrix<double, 21, 21>::Identity() + Phi_dot_k3 * delta_t;
   Eigen::Matrix<double, 21, 21> P_k4 = P_big + P_dot_k3 * delta_t;
   Eigen::Matrix<double, 21, 21> Phi_dot_k4 = F_k4 * Phi_k4;
-  Eigen::Matrix<double, 21, 21> P_dot_k4 = F_k4 * P_k4 + P_k4 * F_k4.transpose() + G_k4 * Q_c * G_k4.transpose();
+  Eigen::Matrix<double, 21, 21> P_dot_k4;
+  P_dot_k4.noalias() = F_k4 * P_k4 + P_k4 * F_k4.transpose() + G_k4 * Q_c * G_k4.transpose();
 
   // done-------------------------------------------------------------------------------------------------
 
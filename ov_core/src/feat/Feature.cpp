@@ -21,6 +21,8 @@
 
 #include "Feature.h"
 
+#include <algorithm>
+
 using namespace ov_core;
 
 void Feature::clean_old_measurements(const std::vector<double> &valid_times) {
@@ -32,23 +34,25 @@ void Feature::clean_old_measurements(const std::vector<double> &valid_times) {
     assert(timestamps[pair.first].size() == uvs[pair.first].size());
     assert(timestamps[pair.first].size() == uvs_norm[pair.first].size());
 
-    // Our iterators
-    auto it1 = timestamps[pair.first].begin();
-    auto it2 = uvs[pair.first].begin();
-    auto it3 = uvs_norm[pair.first].begin();
-
-    // Loop through measurement times, remove ones that are not in our timestamps
-    while (it1 != timestamps[pair.first].end()) {
-      if (std::find(valid_times.begin(), valid_times.end(), *it1) == valid_times.end()) {
-        it1 = timestamps[pair.first].erase(it1);
-        it2 = uvs[pair.first].erase(it2);
-        it3 = uvs_norm[pair.first].erase(it3);
-      } else {
-        ++it1;
-        ++it2;
-        ++it3;
-      }
+    // Single compaction pass: keep measurements occurring at the valid times
+    // The kept entries are copied forward in order, so chronological ordering
+    // (and the index alignment of the three vectors) is preserved in O(n)
+    // The membership test is a binary search since the valid times are sorted
+    std::vector<double> &times = timestamps[pair.first];
+    std::vector<Eigen::Vector2f> &uv = uvs[pair.first];
+    std::vector<Eigen::Vector2f> &uv_n = uvs_norm[pair.first];
+    size_t num_kept = 0;
+    for (size_t i = 0; i < times.size(); i++) {
+      if (times.at(i) <= prune_timestamp || !std::binary_search(valid_times.begin(), valid_times.end(), times.at(i)))
+        continue;
+      times.at(num_kept) = times.at(i);
+      uv.at(num_kept) = uv.at(i);
+      uv_n.at(num_kept) = uv_n.at(i);
+      num_kept++;
     }
+    times.resize(num_kept);
+    uv.resize(num_kept);
+    uv_n.resize(num_kept);
   }
 }
 
@@ -61,27 +65,26 @@ void Feature::clean_invalid_measurements(const std::vector<double> &invalid_time
     assert(timestamps[pair.first].size() == uvs[pair.first].size());
     assert(timestamps[pair.first].size() == uvs_norm[pair.first].size());
 
-    // Our iterators
-    auto it1 = timestamps[pair.first].begin();
-    auto it2 = uvs[pair.first].begin();
-    auto it3 = uvs_norm[pair.first].begin();
-
-    // Loop through measurement times, remove ones that are in our timestamps
-    while (it1 != timestamps[pair.first].end()) {
-      if (std::find(invalid_times.begin(), invalid_times.end(), *it1) != invalid_times.end()) {
-        it1 = timestamps[pair.first].erase(it1);
-        it2 = uvs[pair.first].erase(it2);
-        it3 = uvs_norm[pair.first].erase(it3);
-      } else {
-        ++it1;
-        ++it2;
-        ++it3;
-      }
+    // Single compaction pass: drop measurements occurring at the invalid times
+    std::vector<double> &times = timestamps[pair.first];
+    std::vector<Eigen::Vector2f> &uv = uvs[pair.first];
+    std::vector<Eigen::Vector2f> &uv_n = uvs_norm[pair.first];
+    size_t num_kept = 0;
+    for (size_t i = 0; i < times.size(); i++) {
+      if (times.at(i) <= prune_timestamp || std::find(invalid_times.begin(), invalid_times.end(), times.at(i)) != invalid_times.end())
+        continue;
+      times.at(num_kept) = times.at(i);
+      uv.at(num_kept) = uv.at(i);
+      uv_n.at(num_kept) = uv_n.at(i);
+      num_kept++;
     }
+    times.resize(num_kept);
+    uv.resize(num_kept);
+    uv_n.resize(num_kept);
   }
 }
 
-void Feature::clean_older_measurements(double timestamp) {
+void Feature::clean_outside_measurements(double timestamp_min, double timestamp_max) {
 
   // Loop through each of the cameras we have
   for (auto const &pair : timestamps) {
@@ -90,22 +93,93 @@ void Feature::clean_older_measurements(double timestamp) {
     assert(timestamps[pair.first].size() == uvs[pair.first].size());
     assert(timestamps[pair.first].size() == uvs_norm[pair.first].size());
 
-    // Our iterators
-    auto it1 = timestamps[pair.first].begin();
-    auto it2 = uvs[pair.first].begin();
-    auto it3 = uvs_norm[pair.first].begin();
-
-    // Loop through measurement times, remove ones that are older then the specified one
-    while (it1 != timestamps[pair.first].end()) {
-      if (*it1 <= timestamp) {
-        it1 = timestamps[pair.first].erase(it1);
-        it2 = uvs[pair.first].erase(it2);
-        it3 = uvs_norm[pair.first].erase(it3);
-      } else {
-        ++it1;
-        ++it2;
-        ++it3;
-      }
+    // Single compaction pass: keep measurements inside the inclusive time span
+    std::vector<double> &times = timestamps[pair.first];
+    std::vector<Eigen::Vector2f> &uv = uvs[pair.first];
+    std::vector<Eigen::Vector2f> &uv_n = uvs_norm[pair.first];
+    size_t num_kept = 0;
+    for (size_t i = 0; i < times.size(); i++) {
+      if (times.at(i) <= prune_timestamp || times.at(i) < timestamp_min || times.at(i) > timestamp_max)
+        continue;
+      times.at(num_kept) = times.at(i);
+      uv.at(num_kept) = uv.at(i);
+      uv_n.at(num_kept) = uv_n.at(i);
+      num_kept++;
     }
+    times.resize(num_kept);
+    uv.resize(num_kept);
+    uv_n.resize(num_kept);
   }
 }
+
+void Feature::clean_older_measurements(double timestamp) {
+
+  // Lazy deletion: only advance the watermark, consumers skip the expired prefix
+  if (timestamp > prune_timestamp)
+    prune_timestamp = timestamp;
+
+  // Loop through each of the cameras we have
+  for (auto const &pair : timestamps) {
+
+    // Assert that we have all the parts of a measurement
+    assert(timestamps[pair.first].size() == uvs[pair.first].size());
+    assert(timestamps[pair.first].size() == uvs_norm[pair.first].size());
+
+    // Only pay for a physical compaction once the expired prefix dominates the track
+    // Since this at least halves the vector, the cost amortizes to O(1) per measurement
+    std::vector<double> &times = timestamps[pair.first];
+    size_t num_expired = first_valid_index(pair.first);
+    if (num_expired == 0 || 2 * num_expired < times.size())
+      continue;
+    std::vector<Eigen::Vector2f> &uv = uvs[pair.first];
+    std::vector<Eigen::Vector2f> &uv_n = uvs_norm[pair.first];
+    times.erase(times.begin(), times.begin() + num_expired);
+    uv.erase(uv.begin(), uv.begin() + num_expired);
+    uv_n.erase(uv_n.begin(), uv_n.begin() + num_expired);
+  }
+}
+
+size_t Feature::first_valid_index(size_t cam_id) const {
+  auto it = timestamps.find(cam_id);
+  if (it == timestamps.end())
+    return 0;
+  // Measurements are appended in chronological order, so we can binary search
+  return (size_t)(std::upper_bound(it->second.begin(), it->second.end(), prune_timestamp) - it->second.begin());
+}
+
+size_t Feature::num_valid_measurements() const {
+  size_t ct_meas = 0;
+  for (auto const &pair : timestamps) {
+    ct_meas += pair.second.size() - first_valid_index(pair.first);
+  }
+  return ct_meas;
+}
+
+Feature::MeasurementWindow Feature::measurement_window(size_t cam_id, double oldest_time, double newest_time) const {
+  MeasurementWindow window;
+  auto it = timestamps.find(cam_id);
+  if (it == timestamps.end())
+    return window;
+  // Binary search both boundaries on the chronological timestamp array
+  // The lower boundary additionally skips the prefix expired by the prune watermark
+  const std::vector<double> &times = it->second;
+  window.begin = first_valid_index(cam_id);
+  window.end = times.size();
+  if (oldest_time != -1)
+    window.begin = std::max(window.begin, (size_t)(std::upper_bound(times.begin(), times.end(), oldest_time) - times.begin()));
+  if (newest_time != -1)
+    window.end = (size_t)(std::lower_bound(times.begin(), times.end(), newest_time) - times.begin());
+  if (window.end < window.begin)
+    window.end = window.begin;
+  return window;
+}
+
+int Feature::measurement_index(size_t cam_id, double timestamp) const {
+  auto it = timestamps.find(cam_id);
+  if (it == timestamps.end())
+    return -1;
+  auto it_time = std::lower_bound(it->second.begin(), it->second.end(), timestamp);
+  if (it_time == it->second.end() || *it_time != timestamp)
+    return -1;
+  return (int)(it_time - it->second.begin());
+}
@@ -46,14 +46,20 @@ public:
   bool to_delete;
 
   /// UV coordinates that this feature has been seen from (mapped by camera ID)
-  std::unordered_map<size_t, std::vector<Eigen::VectorXf>> uvs;
+  /// NOTE: fixed-size Vector2f so each camera's track is one contiguous block of floats,
+  /// NOTE: instead of a vector of individually heap-allocated dynamic vectors
+  std::unordered_map<size_t, std::vector<Eigen::Vector2f>> uvs;
 
   /// UV normalized coordinates that this feature has been seen from (mapped by camera ID)
-  std::unordered_map<size_t, std::vector<Eigen::VectorXf>> uvs_norm;
+  std::unordered_map<size_t, std::vector<Eigen::Vector2f>> uvs_norm;
 
   /// Timestamps of each UV measurement (mapped by camera ID)
   std::unordered_map<size_t, std::vector<double>> timestamps;
 
+  /// Lazy pruning watermark: measurements at or before this time are logically deleted.
+  /// Consumers should skip them via first_valid_index(), physical removal is amortized.
+  double prune_timestamp = -1;
+
   /// What camera ID our pose is anchored in!! By default the first measurement is the anchor.
   int anchor_cam_id = -1;
 
@@ -66,13 +72,18 @@ public:
   /// Triangulated position of this feature, in the global frame
   Eigen::Vector3d p_FinG;
 
+  /// If p_FinA / p_FinG hold a valid estimate from a previous triangulation of this
+  /// feature (lets the FeatureInitializer warm start the next solve instead of
+  /// re-running the full linear triangulation)
+  bool triangulation_valid = false;
+
   /**
    * @brief Remove measurements that do not occur at passed timestamps.
    *
    * Given a series of valid timestamps, this will remove all measurements that have not occurred at these times.
    * This would normally be used to ensure that the measurements that we have occur at our clone times.
    *
-   * @param valid_times Vector of timestamps that our measurements must occur at
+   * @param valid_times Vector of timestamps that our measurements must occur at (must be sorted ascending)
    */
   void clean_old_measurements(const std::vector<double> &valid_times);
 
@@ -85,14 +96,76 @@ public:
    */
   void clean_invalid_measurements(const std::vector<double> &invalid_times);
 
+  /**
+   * @brief Remove measurements that occur outside the passed time span.
+   *
+   * Keeps every measurement with timestamp_min <= time <= timestamp_max. This is used
+   * instead of clean_old_measurements() when measurements between the clone times are
+   * usable (they are expressed against the bracketing clones with pose interpolation),
+   * so only measurements outside the current clone window need to be dropped.
+   *
+   * @param timestamp_min Oldest timestamp measurements may occur at (inclusive)
+   * @param timestamp_max Newest timestamp measurements may occur at (inclusive)
+   */
+  void clean_outside_measurements(double timestamp_min, double timestamp_max);
+
   /**
    * @brief Remove measurements that are older then the specified timestamp.
    *
    * Given a valid timestamp, this will remove all measurements that have occured earlier then this.
+   * The removal is lazy: we only advance the @ref prune_timestamp watermark and defer the
+   * physical compaction until the expired prefix dominates a track, which amortizes the
+   * per-frame cost to O(1) per measurement. Anyone reading the raw measurement vectors must
+   * therefore start at first_valid_index() for each camera.
    *
    * @param timestamp Timestamps that our measurements must occur after
    */
   void clean_older_measurements(double timestamp);
+
+  /**
+   * @brief Index of the first measurement of a camera newer than the prune watermark.
+   *
+   * Measurements are appended in chronological order, so everything before this index
+   * has been logically deleted by clean_older_measurements() and should be skipped.
+   *
+   * @param cam_id Camera id of the track we want to read
+   */
+  size_t first_valid_index(size_t cam_id) const;
+
+  /// Number of measurements newer than the prune watermark (over all cameras)
+  size_t num_valid_measurements() const;
+
+  /// Contiguous [begin, end) index range into one camera's measurement arrays
+  struct MeasurementWindow {
+    size_t begin = 0; ///< Index of the first measurement inside the window
+    size_t end = 0;   ///< Index one past the last measurement inside the window
+    size_t size() const { return end - begin; }
+    bool empty() const { return begin >= end; }
+  };
+
+  /**
+   * @brief Index range of a camera's measurements strictly inside (oldest_time, newest_time).
+   *
+   * Measurements are appended in chronological order, so the boundaries are located with
+   * binary search on the contiguous timestamp array (and clamped to the prune watermark).
+   * This lets every window consumer share O(log n) boundary location instead of scanning
+   * the track linearly. Either bound can be -1 to leave that side of the window open.
+   *
+   * @param cam_id Camera id of the track we want to read
+   * @param oldest_time Only include measurements strictly newer than this (-1 to disable)
+   * @param newest_time Only include measurements strictly older than this (-1 to disable)
+   */
+  MeasurementWindow measurement_window(size_t cam_id, double oldest_time, double newest_time) const;
+
+  /**
+   * @brief Index of the measurement taken exactly at the given time, or -1 if there is none.
+   *
+   * Binary search equivalent of a std::find over the chronological timestamp array.
+   *
+   * @param cam_id Camera id of the track we want to read
+   * @param timestamp Time the measurement must have been taken at
+   */
+  int measurement_index(size_t cam_id, double timestamp) const;
 };
 
 } // namespace ov_core
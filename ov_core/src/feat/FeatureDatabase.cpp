@@ -21,17 +21,75 @@
 
 #include "FeatureDatabase.h"
 
+#include <algorithm>
+#include <cmath>
+
 #include "Feature.h"
 #include "utils/print.h"
 
 using namespace ov_core;
 
+void FeatureDatabase::refresh_index(FeatureShard &shard, size_t id, const std::shared_ptr<Feature> &feat) {
+
+  // Compute the first and last measurement time over all cameras
+  // Note we skip the lazily pruned prefix so the index reflects only valid measurements
+  double time_first = -1;
+  double time_last = -1;
+  for (auto const &pair : feat->timestamps) {
+    size_t start = feat->first_valid_index(pair.first);
+    if (pair.second.size() <= start)
+      continue;
+    if (time_first == -1 || pair.second.at(start) < time_first)
+      time_first = pair.second.at(start);
+    if (time_last == -1 || pair.second.at(pair.second.size() - 1) > time_last)
+      time_last = pair.second.at(pair.second.size() - 1);
+  }
+
+  // Remove the stale index entries if the span has changed
+  auto it = shard.spans.find(id);
+  if (it != shard.spans.end()) {
+    if (it->second.first == time_first && it->second.second == time_last)
+      return;
+    remove_index(shard, id);
+  }
+
+  // A feature with no measurements left has no index entries
+  if (time_first == -1)
+    return;
+  shard.index_first[time_first].insert(id);
+  shard.index_last[time_last].insert(id);
+  shard.spans[id] = {time_first, time_last};
+}
+
+void FeatureDatabase::remove_index(FeatureShard &shard, size_t id) {
+  auto it = shard.spans.find(id);
+  if (it == shard.spans.end())
+    return;
+  auto it_first = shard.index_first.find(it->second.first);
+  if (it_first != shard.index_first.end()) {
+    it_first->second.erase(id);
+    if (it_first->second.empty())
+      shard.index_first.erase(it_first);
+  }
+  auto it_last = shard.index_last.find(it->second.second);
+  if (it_last != shard.index_last.end()) {
+    it_last->second.erase(id);
+    if (it_last->second.empty())
+      shard.index_last.erase(it_last);
+  }
+  shard.spans.erase(it);
+}
+
 std::shared_ptr<Feature> FeatureDatabase::get_feature(size_t id, bool remove) {
-  std::lock_guard<std::mutex> lck(mtx);
-  if (features_idlookup.find(id) != features_idlookup.end()) {
-    std::shared_ptr<Feature> temp = features_idlookup.at(id);
-    if (remove)
-      features_idlookup.erase(id);
+  FeatureShard &shard = get_shard(id);
+  std::lock_guard<std::mutex> lck(shard.mtx);
+  if (shard.features.find(id) != shard.features.end()) {
+    std::shared_ptr<Feature> temp = shard.features.at(id);
+    if (remove) {
+      shard.features.erase(id);
+      remove_index(shard, id);
+      mark_dirty(shard, id);
+    }
     return temp;
   } else {
     return nullptr;
@@ -39,34 +97,73 @@ std::shared_ptr<Feature> FeatureDatabase::get_feature(size_t id, bool remove) {
 }
 
 bool FeatureDatabase::get_feature_clone(size_t id, Feature &feat) {
-  std::lock_guard<std::mutex> lck(mtx);
-  if (features_idlookup.find(id) == features_idlookup.end())
+  FeatureShard &shard = get_shard(id);
+  std::lock_guard<std::mutex> lck(shard.mtx);
+  if (shard.features.find(id) == shard.features.end())
     return false;
   // TODO: should probably have a copy constructor function in feature class
-  std::shared_ptr<Feature> temp = features_idlookup.at(id);
+  std::shared_ptr<Feature> temp = shard.features.at(id);
   feat.featid = temp->featid;
   feat.to_delete = temp->to_delete;
   feat.uvs = temp->uvs;
   feat.uvs_norm = temp->uvs_norm;
   feat.timestamps = temp->timestamps;
+  feat.prune_timestamp = temp->prune_timestamp;
   feat.anchor_cam_id = temp->anchor_cam_id;
   feat.anchor_clone_timestamp = temp->anchor_clone_timestamp;
   feat.p_FinA = temp->p_FinA;
   feat.p_FinG = temp->p_FinG;
+  feat.triangulation_valid = temp->triangulation_valid;
   return true;
 }
 
+size_t FeatureDatabase::get_track_length(size_t id) {
+  FeatureShard &shard = get_shard(id);
+  std::lock_guard<std::mutex> lck(shard.mtx);
+  auto it = shard.features.find(id);
+  if (it == shard.features.end())
+    return 0;
+  // Note we skip the lazily pruned prefix so only valid measurements are counted
+  size_t length = 0;
+  for (const auto &pair : it->second->timestamps) {
+    size_t start = it->second->first_valid_index(pair.first);
+    if (pair.second.size() > start)
+      length = std::max(length, pair.second.size() - start);
+  }
+  return length;
+}
+
 void FeatureDatabase::update_feature(size_t id, double timestamp, size_t cam_id, float u, float v, float u_n, float v_n) {
 
-  // Find this feature using the ID lookup
-  std::lock_guard<std::mutex> lck(mtx);
-  if (features_idlookup.find(id) != features_idlookup.end()) {
+  // Find this feature using the ID lookup (only this shard is locked)
+  FeatureShard &shard = get_shard(id);
+  std::lock_guard<std::mutex> lck(shard.mtx);
+  if (shard.features.find(id) != shard.features.end()) {
     // Get our feature
-    std::shared_ptr<Feature> feat = features_idlookup.at(id);
+    std::shared_ptr<Feature> feat = shard.features.at(id);
+    // Fold this track's displacement into the frame pair disparity aggregate
+    if (!feat->timestamps[cam_id].empty() && feat->timestamps[cam_id].back() < timestamp) {
+      double disp = (double)(Eigen::Vector2f(u, v) - feat->uvs[cam_id].back()).norm();
+      std::lock_guard<std::mutex> lck_disp(mtx_disparity);
+      DisparityStats &stats = disparity_stats[{feat->timestamps[cam_id].back(), timestamp}];
+      stats.count++;
+      stats.sum += disp;
+      stats.sum_sq += disp * disp;
+    }
     // Append this new information to it!
     feat->uvs[cam_id].push_back(Eigen::Vector2f(u, v));
     feat->uvs_norm[cam_id].push_back(Eigen::Vector2f(u_n, v_n));
     feat->timestamps[cam_id].push_back(timestamp);
+    // The last-seen time can only move forward, the first-seen time never changes
+    std::pair<double, double> &span = shard.spans.at(id);
+    if (timestamp > span.second) {
+      shard.index_last.at(span.second).erase(id);
+      if (shard.index_last.at(span.second).empty())
+        shard.index_last.erase(span.second);
+      shard.index_last[timestamp].insert(id);
+      span.second = timestamp;
+    }
+    mark_dirty(shard, id);
     return;
   }
 
@@ -81,7 +178,11 @@ void FeatureDatabase::update_feature(size_t id, double timestamp, size_t cam_id,
   feat->timestamps[cam_id].push_back(timestamp);
 
   // Append this new feature into our database
-  features_idlookup[id] = feat;
+  shard.features[id] = feat;
+  shard.index_first[timestamp].insert(id);
+  shard.index_last[timestamp].insert(id);
+  shard.spans[id] = {timestamp, timestamp};
+  mark_dirty(shard, id);
 }
 
 std::vector<std::shared_ptr<Feature>> FeatureDatabase::features_not_containing_newer(double timestamp, bool remove, bool skip_deleted) {
@@ -89,37 +190,30 @@ std::vector<std::shared_ptr<Feature>> FeatureDatabase::features_not_containing_n
   // Our vector of features that do not have measurements after the specified time
   std::vector<std::shared_ptr<Feature>> feats_old;
 
-  // Now lets loop through all features, and just make sure they are not old
-  std::lock_guard<std::mutex> lck(mtx);
-  for (auto it = features_idlookup.begin(); it != features_idlookup.end();) {
-    // Skip if already deleted
-    if (skip_deleted && (*it).second->to_delete) {
-      it++;
-      continue;
+  // A feature has no measurement >= timestamp exactly when its last-seen time is older
+  // Thus this is a range lookup over the last-seen index instead of a full scan
+  for (auto &shard : shards) {
+    std::lock_guard<std::mutex> lck(shard.mtx);
+    std::vector<size_t> ids;
+    for (auto it = shard.index_last.begin(); it != shard.index_last.lower_bound(timestamp); it++) {
+      ids.insert(ids.end(), it->second.begin(), it->second.end());
     }
-    // Loop through each camera
-    // If we have a measurement greater-than or equal to the specified, this measurement is find
-    bool has_newer_measurement = false;
-    for (auto const &pair : (*it).second->timestamps) {
-      has_newer_measurement = (!pair.second.empty() && pair.second.at(pair.second.size() - 1) >= timestamp);
-      if (has_newer_measurement) {
-        break;
+    for (size_t id : ids) {
+      std::shared_ptr<Feature> feat = shard.features.at(id);
+      // Skip if already deleted
+      if (skip_deleted && feat->to_delete)
+        continue;
+      feats_old.push_back(feat);
+      if (remove) {
+        shard.features.erase(id);
+        remove_index(shard, id);
+        mark_dirty(shard, id);
       }
     }
-    // If it is not being actively tracked, then it is old
-    if (!has_newer_measurement) {
-      feats_old.push_back((*it).second);
-      if (remove)
-        features_idlookup.erase(it++);
-      else
-        it++;
-    } else {
-      it++;
-    }
   }
 
   // Debugging
-  // PRINT_DEBUG("feature db size = %u\n", features_idlookup.size())
+  // PRINT_DEBUG("feature db size = %u\n", size())
 
   // Return the old features
   return feats_old;
@@ -130,37 +224,29 @@ std::vector<std::shared_ptr<Feature>> FeatureDatabase::features_containing_older
   // Our vector of old features
   std::vector<std::shared_ptr<Feature>> feats_old;
 
-  // Now lets loop through all features, and just make sure they are not old
-  std::lock_guard<std::mutex> lck(mtx);
-  for (auto it = features_idlookup.begin(); it != features_idlookup.end();) {
-    // Skip if already deleted
-    if (skip_deleted && (*it).second->to_delete) {
-      it++;
-      continue;
+  // A feature has a measurement < timestamp exactly when its first-seen time is older
+  for (auto &shard : shards) {
+    std::lock_guard<std::mutex> lck(shard.mtx);
+    std::vector<size_t> ids;
+    for (auto it = shard.index_first.begin(); it != shard.index_first.lower_bound(timestamp); it++) {
+      ids.insert(ids.end(), it->second.begin(), it->second.end());
     }
-    // Loop through each camera
-    // Check if we have at least one time older then the requested
-    bool found_containing_older = false;
-    for (auto const &pair : (*it).second->timestamps) {
-      found_containing_older = (!pair.second.empty() && pair.second.at(0) < timestamp);
-      if (found_containing_older) {
-        break;
+    for (size_t id : ids) {
+      std::shared_ptr<Feature> feat = shard.features.at(id);
+      // Skip if already deleted
+      if (skip_deleted && feat->to_delete)
+        continue;
+      feats_old.push_back(feat);
+      if (remove) {
+        shard.features.erase(id);
+        remove_index(shard, id);
+        mark_dirty(shard, id);
       }
     }
-    // If it has an older timestamp, then add it
-    if (found_containing_older) {
-      feats_old.push_back((*it).second);
-      if (remove)
-        features_idlookup.erase(it++);
-      else
-        it++;
-    } else {
-      it++;
-    }
   }
 
   // Debugging
-  // PRINT_DEBUG("feature db size = %u\n", features_idlookup.size())
+  // PRINT_DEBUG("feature db size = %u\n", size())
 
   // Return the old features
   return feats_old;
@@ -171,120 +257,238 @@ std::vector<std::shared_ptr<Feature>> FeatureDatabase::features_containing(doubl
   // Our vector of old features
   std::vector<std::shared_ptr<Feature>> feats_has_timestamp;
 
-  // Now lets loop through all features, and just make sure they are not
-  std::lock_guard<std::mutex> lck(mtx);
-  for (auto it = features_idlookup.begin(); it != features_idlookup.end();) {
-    // Skip if already deleted
-    if (skip_deleted && (*it).second->to_delete) {
-      it++;
-      continue;
+  // Only features whose [first, last] span covers the timestamp can possibly contain it,
+  // so we prefilter with the cached spans and only then do the exact per-camera search
+  for (auto &shard : shards) {
+    std::lock_guard<std::mutex> lck(shard.mtx);
+    std::vector<size_t> ids;
+    for (auto const &pair : shard.spans) {
+      if (pair.second.first <= timestamp && timestamp <= pair.second.second)
+        ids.push_back(pair.first);
     }
-    // Boolean if it has the timestamp
-    // Break out if we found a single timestamp that is equal to the specified time
-    bool has_timestamp = false;
-    for (auto const &pair : (*it).second->timestamps) {
-      has_timestamp = (std::find(pair.second.begin(), pair.second.end(), timestamp) != pair.second.end());
-      if (has_timestamp) {
-        break;
+    for (size_t id : ids) {
+      std::shared_ptr<Feature> feat = shard.features.at(id);
+      // Skip if already deleted
+      if (skip_deleted && feat->to_delete)
+        continue;
+      // Boolean if it has the timestamp
+      // Break out if we found a single timestamp that is equal to the specified time
+      bool has_timestamp = false;
+      for (auto const &pair : feat->timestamps) {
+        auto it_begin = pair.second.begin() + feat->first_valid_index(pair.first);
+        has_timestamp = (std::find(it_begin, pair.second.end(), timestamp) != pair.second.end());
+        if (has_timestamp) {
+          break;
+        }
+      }
+      if (!has_timestamp)
+        continue;
+      feats_has_timestamp.push_back(feat);
+      if (remove) {
+        shard.features.erase(id);
+        remove_index(shard, id);
+        mark_dirty(shard, id);
       }
-    }
-    // Remove this feature if it contains the specified timestamp
-    if (has_timestamp) {
-      feats_has_timestamp.push_back((*it).second);
-      if (remove)
-        features_idlookup.erase(it++);
-      else
-        it++;
-    } else {
-      it++;
     }
   }
 
   // Debugging
-  // PRINT_DEBUG("feature db size = %u\n", features_idlookup.size())
+  // PRINT_DEBUG("feature db size = %u\n", size())
   // PRINT_DEBUG("return vector = %u\n", feats_has_timestamp.size())
 
   // Return the features
   return feats_has_timestamp;
 }
 
+bool FeatureDatabase::get_disparity(double time0, double time1, double &disp_mean, double &disp_var, int &total_feats) {
+
+  // See if update_feature() has accumulated totals for this frame pair
+  std::lock_guard<std::mutex> lck(mtx_disparity);
+  auto it = disparity_stats.find({time0, time1});
+  if (it == disparity_stats.end())
+    return false;
+
+  // If no disparities, just return
+  const DisparityStats &stats = it->second;
+  if (stats.count < 2) {
+    disp_mean = -1;
+    disp_var = -1;
+    total_feats = 0;
+    return true;
+  }
+
+  // Mean and standard deviation from the running totals
+  disp_mean = stats.sum / (double)stats.count;
+  disp_var = std::sqrt(std::max(0.0, stats.sum_sq - (double)stats.count * disp_mean * disp_mean) / (double)(stats.count - 1));
+  total_feats = stats.count;
+  return true;
+}
+
 void FeatureDatabase::cleanup() {
   // Loop through all features
-  // int sizebefore = (int)features_idlookup.size();
-  std::lock_guard<std::mutex> lck(mtx);
-  for (auto it = features_idlookup.begin(); it != features_idlookup.end();) {
-    // If delete flag is set, then delete it
-    if ((*it).second->to_delete) {
-      features_idlookup.erase(it++);
-    } else {
-      it++;
+  // If delete flag is set, then delete it
+  for (auto &shard : shards) {
+    std::lock_guard<std::mutex> lck(shard.mtx);
+    for (auto it = shard.features.begin(); it != shard.features.end();) {
+      if ((*it).second->to_delete) {
+        remove_index(shard, (*it).first);
+        mark_dirty(shard, (*it).first);
+        it = shard.features.erase(it);
+      } else {
+        it++;
+      }
     }
   }
-  // PRINT_DEBUG("feat db = %d -> %d\n", sizebefore, (int)features_idlookup.size() << std::endl;
 }
 
 void FeatureDatabase::cleanup_measurements(double timestamp) {
-  std::lock_guard<std::mutex> lck(mtx);
-  for (auto it = features_idlookup.begin(); it != features_idlookup.end();) {
-    // Remove the older measurements
-    (*it).second->clean_older_measurements(timestamp);
-    // Count how many measurements
-    int ct_meas = 0;
-    for (const auto &pair : (*it).second->timestamps) {
-      ct_meas += (int)(pair.second.size());
+  for (auto &shard : shards) {
+    std::lock_guard<std::mutex> lck(shard.mtx);
+    // Only features whose first valid measurement is old enough can be affected,
+    // which is a prefix of the sorted first-seen index instead of every feature
+    std::vector<size_t> ids;
+    for (auto it = shard.index_first.begin(); it != shard.index_first.upper_bound(timestamp); it++) {
+      ids.insert(ids.end(), it->second.begin(), it->second.end());
     }
-    // If delete flag is set, then delete it
-    if (ct_meas < 1) {
-      features_idlookup.erase(it++);
-    } else {
-      it++;
+    for (size_t id : ids) {
+      std::shared_ptr<Feature> feat = shard.features.at(id);
+      // Remove the older measurements (lazily, this mostly just moves the watermark)
+      feat->clean_older_measurements(timestamp);
+      mark_dirty(shard, id);
+      // If no valid measurements are left, then delete the feature
+      if (feat->num_valid_measurements() < 1) {
+        remove_index(shard, id);
+        shard.features.erase(id);
+      } else {
+        refresh_index(shard, id, feat);
+      }
     }
   }
+
+  // Disparity aggregates whose first frame was removed can no longer be queried
+  // The map is sorted by (time0, time1) so these are a prefix of it
+  {
+    std::lock_guard<std::mutex> lck(mtx_disparity);
+    disparity_stats.erase(disparity_stats.begin(), disparity_stats.lower_bound({timestamp, 0.0}));
+  }
 }
 
 void FeatureDatabase::cleanup_measurements_exact(double timestamp) {
-  std::lock_guard<std::mutex> lck(mtx);
   std::vector<double> timestamps = {timestamp};
-  for (auto it = features_idlookup.begin(); it != features_idlookup.end();) {
-    // Remove the older measurements
-    (*it).second->clean_invalid_measurements(timestamps);
-    // Count how many measurements
-    int ct_meas = 0;
-    for (const auto &pair : (*it).second->timestamps) {
-      ct_meas += (int)(pair.second.size());
+  for (auto &shard : shards) {
+    std::lock_guard<std::mutex> lck(shard.mtx);
+    for (auto it = shard.features.begin(); it != shard.features.end();) {
+      // Count how many measurements we start with (to know if anything was removed)
+      int ct_meas_before = 0;
+      for (const auto &pair : (*it).second->timestamps) {
+        ct_meas_before += (int)(pair.second.size());
+      }
+      // Remove the older measurements
+      (*it).second->clean_invalid_measurements(timestamps);
+      // Count how many measurements
+      int ct_meas = 0;
+      for (const auto &pair : (*it).second->timestamps) {
+        ct_meas += (int)(pair.second.size());
+      }
+      if (ct_meas != ct_meas_before)
+        mark_dirty(shard, (*it).first);
+      // If delete flag is set, then delete it
+      if (ct_meas < 1) {
+        remove_index(shard, (*it).first);
+        it = shard.features.erase(it);
+      } else {
+        refresh_index(shard, (*it).first, (*it).second);
+        it++;
+      }
     }
-    // If delete flag is set, then delete it
-    if (ct_meas < 1) {
-      features_idlookup.erase(it++);
-    } else {
-      it++;
+  }
+
+  // Drop disparity aggregates touching the removed time
+  {
+    std::lock_guard<std::mutex> lck(mtx_disparity);
+    for (auto it = disparity_stats.begin(); it != disparity_stats.end();) {
+      if (it->first.first == timestamp || it->first.second == timestamp) {
+        it = disparity_stats.erase(it);
+      } else {
+        it++;
+      }
     }
   }
 }
 
+std::unordered_map<size_t, std::shared_ptr<Feature>> FeatureDatabase::get_snapshot() {
+
+  // Take all shard locks together so the view is consistent across shards
+  // This is safe against the single-shard paths since nothing ever holds two shard locks
+  std::array<std::unique_lock<std::mutex>, NUM_SHARDS> locks;
+  for (size_t i = 0; i < NUM_SHARDS; i++)
+    locks.at(i) = std::unique_lock<std::mutex>(shards.at(i).mtx);
+
+  // Refresh each shard's published clones (only the features dirtied since last time)
+  size_t total = 0;
+  for (auto &shard : shards) {
+    if (shard.epoch != shard.snapshot_epoch) {
+      for (size_t id : shard.snapshot_dirty) {
+        auto it = shard.features.find(id);
+        if (it == shard.features.end()) {
+          shard.snapshot.erase(id);
+          continue;
+        }
+        // Clone the feature (copy-on-write: the previously published clone is never
+        // touched, so readers of older snapshots are unaffected)
+        // TODO: should probably have a copy constructor function in feature class
+        auto clone = std::make_shared<Feature>();
+        clone->featid = it->second->featid;
+        clone->to_delete = it->second->to_delete;
+        clone->uvs = it->second->uvs;
+        clone->uvs_norm = it->second->uvs_norm;
+        clone->timestamps = it->second->timestamps;
+        clone->prune_timestamp = it->second->prune_timestamp;
+        clone->anchor_cam_id = it->second->anchor_cam_id;
+        clone->anchor_clone_timestamp = it->second->anchor_clone_timestamp;
+        clone->p_FinA = it->second->p_FinA;
+        clone->p_FinG = it->second->p_FinG;
+        clone->triangulation_valid = it->second->triangulation_valid;
+        shard.snapshot[id] = clone;
+      }
+      shard.snapshot_dirty.clear();
+      shard.snapshot_epoch = shard.epoch;
+    }
+    total += shard.snapshot.size();
+  }
+
+  // Merge the per-shard views (pointer copies only, the clones themselves are shared)
+  std::unordered_map<size_t, std::shared_ptr<Feature>> snapshot;
+  snapshot.reserve(total);
+  for (auto &shard : shards)
+    snapshot.insert(shard.snapshot.begin(), shard.snapshot.end());
+  return snapshot;
+}
+
 double FeatureDatabase::get_oldest_timestamp() {
-  std::lock_guard<std::mutex> lck(mtx);
+  // The first-seen index is sorted, so this is just the front of each shard's index
   double oldest_time = -1;
-  for (auto const &feat : features_idlookup) {
-    for (auto const &camtimepair : feat.second->timestamps) {
-      if (!camtimepair.second.empty() && (oldest_time == -1 || oldest_time > camtimepair.second.at(0))) {
-        oldest_time = camtimepair.second.at(0);
-      }
+  for (auto &shard : shards) {
+    std::lock_guard<std::mutex> lck(shard.mtx);
+    if (!shard.index_first.empty() && (oldest_time == -1 || oldest_time > shard.index_first.begin()->first)) {
+      oldest_time = shard.index_first.begin()->first;
     }
   }
   return oldest_time;
 }
 
 void FeatureDatabase::append_new_measurements(const std::shared_ptr<FeatureDatabase> &database) {
-  std::lock_guard<std::mutex> lck(mtx);
 
-  // Loop through the other database's internal database
-  // int sizebefore = (int)features_idlookup.size();
-  for (const auto &feat : database->get_internal_data()) {
-    if (features_idlookup.find(feat.first) != features_idlookup.end()) {
+  // Loop through an immutable snapshot of the other database, so the only time we
+  // spend under its locks is the O(changed) snapshot refresh (the trackers keep
+  // feeding it while we merge here)
+  for (const auto &feat : database->get_snapshot()) {
+    FeatureShard &shard = get_shard(feat.first);
+    std::lock_guard<std::mutex> lck(shard.mtx);
+    if (shard.features.find(feat.first) != shard.features.end()) {
 
       // For this feature, now try to append the new measurement data
-      std::shared_ptr<Feature> temp = features_idlookup.at(feat.first);
+      std::shared_ptr<Feature> temp = shard.features.at(feat.first);
       for (const auto &times : feat.second->timestamps) {
         // Append the whole camera vector is not seen
         // Otherwise need to loop through each and append
@@ -305,17 +509,21 @@ void FeatureDatabase::append_new_measurements(const std::shared_ptr<FeatureDatab
           }
         }
       }
+      refresh_index(shard, feat.first, temp);
+      mark_dirty(shard, feat.first);
 
     } else {
 
       // Else we have not found the feature, so lets make it be a new one!
       std::shared_ptr<Feature> temp = std::make_shared<Feature>();
       temp->featid = feat.second->featid;
+      temp->prune_timestamp = feat.second->prune_timestamp;
       temp->timestamps = feat.second->timestamps;
       temp->uvs = feat.second->uvs;
       temp->uvs_norm = feat.second->uvs_norm;
-      features_idlookup[feat.first] = temp;
+      shard.features[feat.first] = temp;
+      refresh_index(shard, feat.first, temp);
+      mark_dirty(shard, feat.first);
     }
   }
-  // PRINT_DEBUG("feat db = %d -> %d\n", sizebefore, (int)features_idlookup.size() << std::endl;
 }
@@ -22,12 +22,17 @@
 #ifndef OV_CORE_FEATURE_DATABASE_H
 #define OV_CORE_FEATURE_DATABASE_H
 
-#include <Eigen/Eigen>
+#include <array>
+#include <cstdint>
+#include <map>
 #include <memory>
 #include <mutex>
+#include <set>
 #include <unordered_map>
 #include <vector>
 
+#include <Eigen/Eigen>
+
 namespace ov_core {
 
 class Feature;
@@ -50,6 +55,14 @@ class Feature;
  * For example, if you are asynchronous tracking cameras and you chose to update the state, then remove all features you will use in update.
  * The feature trackers will continue to add features while you update, whose measurements can be used in the next update step!
  *
+ * Internally the features are split across a handful of shards (by feature id), each with
+ * its own mutex, so tracker update_feature() calls do not serialize against the update
+ * thread scanning for candidates. Each shard also keeps the first/last measurement time of
+ * every feature in sorted secondary indices, so the per-update time queries are range
+ * lookups over those indices instead of walking every feature's timestamps map.
+ * Read-only consumers that want to walk the whole database (initializers, disparity
+ * fallbacks) should prefer get_snapshot() over get_internal_data(), which publishes
+ * immutable feature clones and only re-clones what changed since the previous call.
  */
 class FeatureDatabase {
 
@@ -75,6 +88,16 @@ public:
    */
   bool get_feature_clone(size_t id, Feature &feat);
 
+  /**
+   * @brief Number of frames the specified feature has been tracked for
+   * @param id What feature we want to query
+   * @return Measurement count of the camera that has seen it the most (zero if unknown)
+   *
+   * This is a cheap query the trackers can use to judge how "stable" a track is
+   * (e.g. to decide how much effort to spend tracking it) without cloning the feature.
+   */
+  size_t get_track_length(size_t id);
+
   /**
    * @brief Update a feature object
    * @param id ID of the feature we will update
@@ -115,6 +138,25 @@ public:
    */
   std::vector<std::shared_ptr<Feature>> features_containing(double timestamp, bool remove = false, bool skip_deleted = false);
 
+  /**
+   * @brief O(1) lookup of the feature disparity between two consecutive frame times.
+   *
+   * update_feature() folds the pixel displacement of every feature that is tracked from
+   * its previous observation into a new frame into a running aggregate keyed by that pair
+   * of frame times. This returns the statistics for the requested pair, matching the
+   * two-timestamp FeatureHelper::compute_disparity() without scanning the database
+   * (note the aggregate keeps features an update may since have consumed). Aggregates
+   * are pruned alongside their measurements by the cleanup functions.
+   *
+   * @param time0 First camera frame timestamp
+   * @param time1 Second camera frame timestamp
+   * @param disp_mean Average raw disparity
+   * @param disp_var Variance of the disparities
+   * @param total_feats Total number of common features
+   * @return True if we have an aggregate for this frame pair
+   */
+  bool get_disparity(double time0, double time1, double &disp_mean, double &disp_var, int &total_feats);
+
   /**
    * @brief This function will delete all features that have been used up.
    *
@@ -136,18 +178,45 @@ public:
    * @brief Returns the size of the feature database
    */
   size_t size() {
-    std::lock_guard<std::mutex> lck(mtx);
-    return features_idlookup.size();
+    size_t count = 0;
+    for (auto &shard : shards) {
+      std::lock_guard<std::mutex> lck(shard.mtx);
+      count += shard.features.size();
+    }
+    return count;
   }
 
   /**
    * @brief Returns the internal data (should not normally be used)
    */
   std::unordered_map<size_t, std::shared_ptr<Feature>> get_internal_data() {
-    std::lock_guard<std::mutex> lck(mtx);
-    return features_idlookup;
+    std::unordered_map<size_t, std::shared_ptr<Feature>> data;
+    for (auto &shard : shards) {
+      std::lock_guard<std::mutex> lck(shard.mtx);
+      data.insert(shard.features.begin(), shard.features.end());
+    }
+    return data;
   }
 
+  /**
+   * @brief Epoch-based immutable snapshot of the whole database.
+   *
+   * Every mutation marks its feature dirty in its shard and bumps the shard epoch.
+   * This call re-clones only the features dirtied since the previous snapshot
+   * (copy-on-write at the feature level: untouched entries keep sharing the clones
+   * published by earlier calls), so the time the shard locks are held is proportional
+   * to what changed and not to the database size. All shard locks are taken together
+   * so the view is consistent across shards.
+   *
+   * The returned features are never mutated after they are published, so a caller
+   * (e.g. a multi-hundred-millisecond initializer solve, or the ZUPT disparity
+   * fallback) can read them without holding any database lock while the trackers
+   * keep calling update_feature(). Note that writes done directly through pointers
+   * obtained from get_feature() bypass the dirty tracking (the same caveat the
+   * class-level threading note makes about using raw feature pointers).
+   */
+  std::unordered_map<size_t, std::shared_ptr<Feature>> get_snapshot();
+
   /**
    * @brief Gets the oldest time in the database
    */
@@ -159,11 +228,69 @@ public:
   void append_new_measurements(const std::shared_ptr<FeatureDatabase> &database);
 
 protected:
-  /// Mutex lock for our map
-  std::mutex mtx;
+  /// Number of independently locked feature shards (features are assigned by id)
+  static const size_t NUM_SHARDS = 8;
+
+  /**
+   * @brief One independently locked slice of the feature database.
+   *
+   * Besides the id lookup itself, each shard maintains sorted secondary indices over
+   * the first and last measurement time of every feature, plus a per-feature span
+   * cache. The time-based queries then become range lookups (last-seen < t for "not
+   * containing newer", first-seen < t for "containing older") instead of full scans
+   * of every feature's per-camera timestamps.
+   */
+  struct FeatureShard {
+    /// Mutex protecting everything in this shard
+    std::mutex mtx;
+    /// Our lookup array that allow use to query based on ID
+    std::unordered_map<size_t, std::shared_ptr<Feature>> features;
+    /// Sorted index of first measurement time -> feature ids
+    std::map<double, std::set<size_t>> index_first;
+    /// Sorted index of last measurement time -> feature ids
+    std::map<double, std::set<size_t>> index_last;
+    /// Cached (first, last) measurement time of each feature
+    std::unordered_map<size_t, std::pair<double, double>> spans;
+    /// Write epoch of this shard (bumped on every feature mutation)
+    uint64_t epoch = 0;
+    /// Epoch the published snapshot of this shard corresponds to
+    uint64_t snapshot_epoch = 0;
+    /// Features mutated or removed since the snapshot was last refreshed
+    std::set<size_t> snapshot_dirty;
+    /// Immutable feature clones of this shard as of snapshot_epoch
+    std::unordered_map<size_t, std::shared_ptr<Feature>> snapshot;
+  };
+
+  /// Returns the shard responsible for the given feature id
+  FeatureShard &get_shard(size_t id) { return shards.at(id % NUM_SHARDS); }
+
+  /// Recomputes a feature's first/last times and refreshes the shard indices (shard mutex must be held)
+  void refresh_index(FeatureShard &shard, size_t id, const std::shared_ptr<Feature> &feat);
+
+  /// Drops a feature from the shard indices (shard mutex must be held)
+  void remove_index(FeatureShard &shard, size_t id);
+
+  /// Records that a feature was mutated or removed so the next snapshot re-clones it (shard mutex must be held)
+  void mark_dirty(FeatureShard &shard, size_t id) {
+    shard.epoch++;
+    shard.snapshot_dirty.insert(id);
+  }
+
+  /// Our sharded feature storage
+  std::array<FeatureShard, NUM_SHARDS> shards;
+
+  /// Running disparity totals of one consecutive frame pair (over all cameras)
+  struct DisparityStats {
+    int count = 0;
+    double sum = 0.0;
+    double sum_sq = 0.0;
+  };
+
+  /// Mutex protecting the disparity aggregates
+  std::mutex mtx_disparity;
 
-  /// Our lookup array that allow use to query based on ID
-  std::unordered_map<size_t, std::shared_ptr<Feature>> features_idlookup;
+  /// Disparity totals keyed by (previous frame time, new frame time)
+  std::map<std::pair<double, double>, DisparityStats> disparity_stats;
 };
 
 } // namespace ov_core
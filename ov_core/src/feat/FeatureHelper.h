@@ -60,8 +60,13 @@ public:
   static void compute_disparity(std::shared_ptr<ov_core::FeatureDatabase> db, double time0, double time1, double &disp_mean,
                                 double &disp_var, int &total_feats) {
 
-    // Get features seen from the first image
-    std::vector<std::shared_ptr<Feature>> feats0 = db->features_containing(time0, false, true);
+    // Read from an immutable snapshot so we never touch live features the tracker may
+    // be appending to (features without the first time are skipped by the search below)
+    std::vector<std::shared_ptr<Feature>> feats0;
+    for (const auto &featpair : db->get_snapshot()) {
+      if (!featpair.second->to_delete)
+        feats0.push_back(featpair.second);
+    }
 
     // Compute the disparity
     std::vector<double> disparities;
@@ -70,14 +75,12 @@ public:
       // Get the two uvs for both times
       for (auto &campairs : feat->timestamps) {
 
-        // First find the two timestamps
+        // First find the two timestamps (binary search, the time array is monotonic)
         size_t camid = campairs.first;
-        auto it0 = std::find(feat->timestamps.at(camid).begin(), feat->timestamps.at(camid).end(), time0);
-        auto it1 = std::find(feat->timestamps.at(camid).begin(), feat->timestamps.at(camid).end(), time1);
-        if (it0 == feat->timestamps.at(camid).end() || it1 == feat->timestamps.at(camid).end())
+        int idx0 = feat->measurement_index(camid, time0);
+        int idx1 = feat->measurement_index(camid, time1);
+        if (idx0 == -1 || idx1 == -1)
           continue;
-        auto idx0 = std::distance(feat->timestamps.at(camid).begin(), it0);
-        auto idx1 = std::distance(feat->timestamps.at(camid).begin(), it1);
 
         // Now lets calculate the disparity
         Eigen::Vector2f uv0 = feat->uvs.at(camid).at(idx0).block(0, 0, 2, 1);
@@ -123,38 +126,22 @@ public:
   static void compute_disparity(std::shared_ptr<ov_core::FeatureDatabase> db, double &disp_mean, double &disp_var, int &total_feats,
                                 double newest_time = -1, double oldest_time = -1) {
 
-    // Compute the disparity
+    // Compute the disparity (over an immutable snapshot, see the overload above)
     std::vector<double> disparities;
-    for (auto &feat : db->get_internal_data()) {
+    for (auto &feat : db->get_snapshot()) {
       for (auto &campairs : feat.second->timestamps) {
 
-        // Skip if only one observation
-        if (campairs.second.size() < 2)
-          continue;
-
-        // Now lets calculate the disparity (assumes time array is monotonic)
+        // Window of measurements strictly inside the requested times
+        // The boundaries are binary searched on the monotonic time array, and we need
+        // at least two measurements in the window to have a disparity between them
         size_t camid = campairs.first;
-        bool found0 = false;
-        bool found1 = false;
-        Eigen::Vector2f uv0 = Eigen::Vector2f::Zero();
-        Eigen::Vector2f uv1 = Eigen::Vector2f::Zero();
-        for (size_t idx = 0; idx < feat.second->timestamps.at(camid).size(); idx++) {
-          double time = feat.second->timestamps.at(camid).at(idx);
-          if ((oldest_time == -1 || time > oldest_time) && !found0) {
-            uv0 = feat.second->uvs.at(camid).at(idx).block(0, 0, 2, 1);
-            found0 = true;
-            continue;
-          }
-          if ((newest_time == -1 || time < newest_time) && found0) {
-            uv1 = feat.second->uvs.at(camid).at(idx).block(0, 0, 2, 1);
-            found1 = true;
-            continue;
-          }
-        }
-
-        // If we found both an old and a new time, then we are good!
-        if (!found0 || !found1)
+        Feature::MeasurementWindow window = feat.second->measurement_window(camid, oldest_time, newest_time);
+        if (window.size() < 2)
           continue;
+
+        // Now lets calculate the disparity between the window edges
+        Eigen::Vector2f uv0 = feat.second->uvs.at(camid).at(window.begin).block(0, 0, 2, 1);
+        Eigen::Vector2f uv1 = feat.second->uvs.at(camid).at(window.end - 1).block(0, 0, 2, 1);
         disparities.push_back((uv1 - uv0).norm());
       }
     }
@@ -23,10 +23,61 @@
 
 #include "Feature.h"
 #include "utils/print.h"
+#include "utils/thread_pool.h"
 #include "utils/quat_ops.h"
 
+#include <algorithm>
+
 using namespace ov_core;
 
+void FeatureInitializer::batch_triangulation(std::vector<std::shared_ptr<Feature>> &feats,
+                                             std::unordered_map<size_t, std::unordered_map<double, ClonePose>> &clonesCAM) {
+
+  // Solve all features as independent parallel tasks
+  // NOTE: uint8_t instead of bool since std::vector<bool> cannot be written concurrently
+  std::vector<uint8_t> success(feats.size(), 0);
+  ThreadPool::instance().parallel_for(0, (int)feats.size(), [&](int i) {
+    // If this feature was already triangulated (e.g. a SLAM candidate we re-attempt each
+    // update), try to skip the linear solve and just refine a couple of steps from the
+    // previous estimate. On any rejection we fall through to the full solve below.
+    if (_options.warm_start && _options.refine_features && !_options.triangulate_1d && feats.at(i)->triangulation_valid) {
+      if (single_warmstart(feats.at(i), clonesCAM) && single_gaussnewton(feats.at(i), clonesCAM, 2)) {
+        success.at(i) = 1;
+        return;
+      }
+    }
+
+    // Triangulate the feature
+    bool success_tri = true;
+    if (_options.triangulate_1d) {
+      success_tri = single_triangulation_1d(feats.at(i), clonesCAM);
+    } else {
+      success_tri = single_triangulation(feats.at(i), clonesCAM);
+    }
+
+    // Gauss-newton refine the feature
+    bool success_refine = true;
+    if (_options.refine_features) {
+      success_refine = single_gaussnewton(feats.at(i), clonesCAM);
+    }
+    feats.at(i)->triangulation_valid = (success_tri && success_refine);
+    success.at(i) = (success_tri && success_refine);
+  });
+
+  // Remove the features that failed, flagging them for deletion from the database
+  size_t index = 0;
+  auto it = feats.begin();
+  while (it != feats.end()) {
+    if (!success.at(index)) {
+      (*it)->to_delete = true;
+      it = feats.erase(it);
+    } else {
+      it++;
+    }
+    index++;
+  }
+}
+
 bool FeatureInitializer::single_triangulation(std::shared_ptr<Feature> feat,
                                               std::unordered_map<size_t, std::unordered_map<double, ClonePose>> &clonesCAM) {
 
@@ -36,10 +87,11 @@ bool FeatureInitializer::single_triangulation(std::shared_ptr<Feature> feat,
   size_t anchor_most_meas = 0;
   size_t most_meas = 0;
   for (auto const &pair : feat->timestamps) {
-    total_meas += (int)pair.second.size();
-    if (pair.second.size() > most_meas) {
+    size_t num_valid = pair.second.size() - feat->first_valid_index(pair.first);
+    total_meas += (int)num_valid;
+    if (num_valid > most_meas) {
       anchor_most_meas = pair.first;
-      most_meas = pair.second.size();
+      most_meas = num_valid;
     }
   }
   feat->anchor_cam_id = anchor_most_meas;
@@ -57,8 +109,8 @@ bool FeatureInitializer::single_triangulation(std::shared_ptr<Feature> feat,
   // Loop through each camera for this feature
   for (auto const &pair : feat->timestamps) {
 
-    // Add CAM_I features
-    for (size_t m = 0; m < feat->timestamps.at(pair.first).size(); m++) {
+    // Add CAM_I features (skipping the pruned prefix)
+    for (size_t m = feat->first_valid_index(pair.first); m < feat->timestamps.at(pair.first).size(); m++) {
 
       // Get the position of this clone in the global
       const Eigen::Matrix<double, 3, 3> &R_GtoCi = clonesCAM.at(pair.first).at(feat->timestamps.at(pair.first).at(m)).Rot();
@@ -120,10 +172,11 @@ bool FeatureInitializer::single_triangulation_1d(std::shared_ptr<Feature> feat,
   size_t anchor_most_meas = 0;
   size_t most_meas = 0;
   for (auto const &pair : feat->timestamps) {
-    total_meas += (int)pair.second.size();
-    if (pair.second.size() > most_meas) {
+    size_t num_valid = pair.second.size() - feat->first_valid_index(pair.first);
+    total_meas += (int)num_valid;
+    if (num_valid > most_meas) {
       anchor_most_meas = pair.first;
-      most_meas = pair.second.size();
+      most_meas = num_valid;
     }
   }
   feat->anchor_cam_id = anchor_most_meas;
@@ -148,8 +201,8 @@ bool FeatureInitializer::single_triangulation_1d(std::shared_ptr<Feature> feat,
   // Loop through each camera for this feature
   for (auto const &pair : feat->timestamps) {
 
-    // Add CAM_I features
-    for (size_t m = 0; m < feat->timestamps.at(pair.first).size(); m++) {
+    // Add CAM_I features (skipping the pruned prefix)
+    for (size_t m = feat->first_valid_index(pair.first); m < feat->timestamps.at(pair.first).size(); m++) {
 
       // Skip the anchor bearing
       if ((int)pair.first == feat->anchor_cam_id && m == idx_anchor_bearing)
@@ -194,8 +247,40 @@ bool FeatureInitializer::single_triangulation_1d(std::shared_ptr<Feature> feat,
   return true;
 }
 
+bool FeatureInitializer::single_warmstart(std::shared_ptr<Feature> feat,
+                                          std::unordered_map<size_t, std::unordered_map<double, ClonePose>> &clonesCAM) {
+
+  // Select the anchor frame exactly as the linear triangulation would
+  // (the anchor clone of the previous solve has likely left the window by now)
+  size_t anchor_most_meas = 0;
+  size_t most_meas = 0;
+  for (auto const &pair : feat->timestamps) {
+    size_t num_valid = pair.second.size() - feat->first_valid_index(pair.first);
+    if (num_valid > most_meas) {
+      anchor_most_meas = pair.first;
+      most_meas = num_valid;
+    }
+  }
+  feat->anchor_cam_id = anchor_most_meas;
+  feat->anchor_clone_timestamp = feat->timestamps.at(feat->anchor_cam_id).back();
+
+  // Convert the previous global estimate into the new anchor frame
+  // (p_FinG is anchor independent, so it survives the anchor change)
+  ClonePose anchorclone = clonesCAM.at(feat->anchor_cam_id).at(feat->anchor_clone_timestamp);
+  Eigen::Vector3d p_FinA = anchorclone.Rot() * (feat->p_FinG - anchorclone.pos());
+
+  // Reject seeds that land outside the accepted depth range (same gates as the full solve)
+  if (p_FinA(2) < _options.min_dist || p_FinA(2) > _options.max_dist || std::isnan(p_FinA.norm())) {
+    return false;
+  }
+
+  // Store it in our feature object
+  feat->p_FinA = p_FinA;
+  return true;
+}
+
 bool FeatureInitializer::single_gaussnewton(std::shared_ptr<Feature> feat,
-                                            std::unordered_map<size_t, std::unordered_map<double, ClonePose>> &clonesCAM) {
+                                            std::unordered_map<size_t, std::unordered_map<double, ClonePose>> &clonesCAM, int max_runs) {
 
   // Get into inverse depth
   double rho = 1 / feat->p_FinA(2);
@@ -219,11 +304,14 @@ bool FeatureInitializer::single_gaussnewton(std::shared_ptr<Feature> feat,
   const Eigen::Matrix<double, 3, 3> &R_GtoA = clonesCAM.at(feat->anchor_cam_id).at(feat->anchor_clone_timestamp).Rot();
   const Eigen::Matrix<double, 3, 1> &p_AinG = clonesCAM.at(feat->anchor_cam_id).at(feat->anchor_clone_timestamp).pos();
 
+  // Cap on optimization iterations (a warm-started solve only wants a step or two)
+  int max_runs_total = (max_runs < 0) ? _options.max_runs : std::min(max_runs, _options.max_runs);
+
   // Loop till we have either
   // 1. Reached our max iteration count
   // 2. System is unstable
   // 3. System has converged
-  while (runs < _options.max_runs && lam < _options.max_lamda && eps > _options.min_dx) {
+  while (runs < max_runs_total && lam < _options.max_lamda && eps > _options.min_dx) {
 
     // Triggers a recomputation of jacobians/information/gradients
     if (recompute) {
@@ -236,8 +324,8 @@ bool FeatureInitializer::single_gaussnewton(std::shared_ptr<Feature> feat,
       // Loop through each camera for this feature
       for (auto const &pair : feat->timestamps) {
 
-        // Add CAM_I features
-        for (size_t m = 0; m < feat->timestamps.at(pair.first).size(); m++) {
+        // Add CAM_I features (skipping the pruned prefix)
+        for (size_t m = feat->first_valid_index(pair.first); m < feat->timestamps.at(pair.first).size(); m++) {
 
           //=====================================================================================
           //=====================================================================================
@@ -344,8 +432,8 @@ bool FeatureInitializer::single_gaussnewton(std::shared_ptr<Feature> feat,
   // Check maximum baseline
   // Loop through each camera for this feature
   for (auto const &pair : feat->timestamps) {
-    // Loop through the other clones to see what the max baseline is
-    for (size_t m = 0; m < feat->timestamps.at(pair.first).size(); m++) {
+    // Loop through the other clones to see what the max baseline is (skipping the pruned prefix)
+    for (size_t m = feat->first_valid_index(pair.first); m < feat->timestamps.at(pair.first).size(); m++) {
       // Get the position of this clone in the global
       const Eigen::Matrix<double, 3, 1> &p_CiinG = clonesCAM.at(pair.first).at(feat->timestamps.at(pair.first).at(m)).pos();
       // Convert current position relative to anchor
@@ -386,8 +474,8 @@ double FeatureInitializer::compute_error(std::unordered_map<size_t, std::unorder
 
   // Loop through each camera for this feature
   for (auto const &pair : feat->timestamps) {
-    // Add CAM_I features
-    for (size_t m = 0; m < feat->timestamps.at(pair.first).size(); m++) {
+    // Add CAM_I features (skipping the pruned prefix)
+    for (size_t m = feat->first_valid_index(pair.first); m < feat->timestamps.at(pair.first).size(); m++) {
 
       //=====================================================================================
       //=====================================================================================
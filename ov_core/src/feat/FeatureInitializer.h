@@ -112,14 +112,47 @@ public:
    */
   bool single_triangulation_1d(std::shared_ptr<Feature> feat, std::unordered_map<size_t, std::unordered_map<double, ClonePose>> &clonesCAM);
 
+  /**
+   * @brief Seeds the feature from its estimate of a previous triangulation instead of solving from scratch
+   *
+   * This selects the anchor exactly like single_triangulation() and converts the previous global
+   * estimate into that (possibly different) anchor frame. If the seed lands outside the accepted
+   * depth range the warm start is rejected and the caller should fall back to the full linear solve.
+   * One would follow this with a (short) single_gaussnewton() call to refine the seed.
+   *
+   * @param feat Pointer to feature which has a previous estimate (Feature::triangulation_valid)
+   * @param clonesCAM Map between camera ID to map of timestamp to camera pose estimate (rotation from global to camera, position of camera
+   * in global frame)
+   * @return Returns false if the previous estimate is not a usable seed
+   */
+  bool single_warmstart(std::shared_ptr<Feature> feat, std::unordered_map<size_t, std::unordered_map<double, ClonePose>> &clonesCAM);
+
   /**
    * @brief Uses a nonlinear triangulation to refine initial linear estimate of the feature
    * @param feat Pointer to feature
    * @param clonesCAM Map between camera ID to map of timestamp to camera pose estimate (rotation from global to camera, position of camera
    * in global frame)
+   * @param max_runs Cap on the number of optimization iterations (negative uses the options value)
    * @return Returns false if it fails to be optimize (based on the thresholds)
    */
-  bool single_gaussnewton(std::shared_ptr<Feature> feat, std::unordered_map<size_t, std::unordered_map<double, ClonePose>> &clonesCAM);
+  bool single_gaussnewton(std::shared_ptr<Feature> feat, std::unordered_map<size_t, std::unordered_map<double, ClonePose>> &clonesCAM,
+                          int max_runs = -1);
+
+  /**
+   * @brief Triangulates and refines a whole batch of features in parallel
+   *
+   * Each feature only reads the shared clone poses and writes into itself, so the
+   * linear triangulation and Gauss-Newton refinement of different features are fully
+   * independent tasks. This respects the triangulate_1d and refine_features options.
+   * Features which fail are flagged with to_delete and removed from the passed vector,
+   * matching what the sequential per-feature update loops used to do.
+   *
+   * @param feats Features we wish to triangulate (failures are removed from this vector)
+   * @param clonesCAM Map between camera ID to map of timestamp to camera pose estimate (rotation from global to camera, position of camera
+   * in global frame)
+   */
+  void batch_triangulation(std::vector<std::shared_ptr<Feature>> &feats,
+                           std::unordered_map<size_t, std::unordered_map<double, ClonePose>> &clonesCAM);
 
   /**
    * @brief Gets the current configuration of the feature initializer
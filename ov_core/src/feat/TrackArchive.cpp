@@ -0,0 +1,144 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2018-2023 Patrick Geneva
+ * Copyright (C) 2018-2023 Guoquan Huang
+ * Copyright (C) 2018-2023 OpenVINS Contributors
+ * Copyright (C) 2018-2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "TrackArchive.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace ov_core;
+
+void TrackArchive::encode_varint(std::vector<uint8_t> &data, uint32_t value) {
+  while (value >= 0x80) {
+    data.push_back((uint8_t)(value & 0x7F) | 0x80);
+    value >>= 7;
+  }
+  data.push_back((uint8_t)value);
+}
+
+// Quantizes a non-negative value to a saturated 16-bit fixed-point representation
+static uint16_t quantize_u16(double value, uint32_t scale) {
+  double scaled = std::round(value * (double)scale);
+  return (uint16_t)std::min(std::max(scaled, 0.0), 65535.0);
+}
+
+void TrackArchive::append_frame(double timestamp, const std::unordered_map<size_t, Eigen::Vector3d> &uvd) {
+  std::lock_guard<std::mutex> lck(mtx);
+
+  // Claim the next frame index in the shared timestamp table
+  uint32_t frame_idx = (uint32_t)frame_times.size();
+  frame_times.push_back(timestamp);
+
+  // Append each observation to its feature's compressed stream
+  for (const auto &feat : uvd) {
+
+    // Find this feature's track, or start a new one
+    auto it = track_index.find(feat.first);
+    if (it == track_index.end()) {
+      it = track_index.insert({feat.first, (uint32_t)tracks.size()}).first;
+      tracks.emplace_back();
+      tracks.back().featid = feat.first;
+    }
+    CompressedTrack &track = tracks.at(it->second);
+
+    // Delta-encode the frame index against the previous measurement
+    // (tracks are usually unbroken, so this is a single byte per observation)
+    encode_varint(track.data, frame_idx - track.last_frame);
+    track.last_frame = frame_idx;
+
+    // Fixed-point uv and depth
+    uint16_t quantized[3] = {quantize_u16(feat.second(0), UV_SCALE), quantize_u16(feat.second(1), UV_SCALE),
+                             quantize_u16(feat.second(2), DEPTH_SCALE)};
+    for (uint16_t value : quantized) {
+      track.data.push_back((uint8_t)(value & 0xFF));
+      track.data.push_back((uint8_t)(value >> 8));
+    }
+    track.num_meas++;
+    total_meas++;
+  }
+}
+
+void TrackArchive::stream_track_impl(const CompressedTrack &track, const std::function<void(const Measurement &)> &callback) const {
+  uint32_t frame_idx = 0;
+  size_t pos = 0;
+  for (uint32_t m = 0; m < track.num_meas; m++) {
+
+    // Decode the varint frame delta
+    uint32_t delta = 0;
+    uint32_t shift = 0;
+    while (track.data.at(pos) & 0x80) {
+      delta |= (uint32_t)(track.data.at(pos++) & 0x7F) << shift;
+      shift += 7;
+    }
+    delta |= (uint32_t)track.data.at(pos++) << shift;
+    frame_idx += delta;
+
+    // Decode the fixed-point uv and depth
+    uint16_t quantized[3];
+    for (auto &value : quantized) {
+      value = (uint16_t)(track.data.at(pos) | (track.data.at(pos + 1) << 8));
+      pos += 2;
+    }
+
+    // Hand the reconstructed measurement to the consumer
+    Measurement meas;
+    meas.timestamp = frame_times.at(frame_idx);
+    meas.u = (float)quantized[0] / (float)UV_SCALE;
+    meas.v = (float)quantized[1] / (float)UV_SCALE;
+    meas.depth = (float)quantized[2] / (float)DEPTH_SCALE;
+    callback(meas);
+  }
+}
+
+bool TrackArchive::stream_track(size_t featid, const std::function<void(const Measurement &)> &callback) const {
+  std::lock_guard<std::mutex> lck(mtx);
+  auto it = track_index.find(featid);
+  if (it == track_index.end())
+    return false;
+  stream_track_impl(tracks.at(it->second), callback);
+  return true;
+}
+
+void TrackArchive::stream_all(const std::function<void(size_t featid, const Measurement &)> &callback) const {
+  std::lock_guard<std::mutex> lck(mtx);
+  for (const auto &track : tracks) {
+    stream_track_impl(track, [&](const Measurement &meas) { callback(track.featid, meas); });
+  }
+}
+
+size_t TrackArchive::memory_bytes() const {
+  std::lock_guard<std::mutex> lck(mtx);
+  size_t bytes = frame_times.capacity() * sizeof(double);
+  bytes += tracks.capacity() * sizeof(CompressedTrack);
+  for (const auto &track : tracks) {
+    bytes += track.data.capacity();
+  }
+  bytes += track_index.size() * (sizeof(size_t) + sizeof(uint32_t) + sizeof(void *));
+  return bytes;
+}
+
+void TrackArchive::clear() {
+  std::lock_guard<std::mutex> lck(mtx);
+  frame_times.clear();
+  tracks.clear();
+  track_index.clear();
+  total_meas = 0;
+}
@@ -0,0 +1,144 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2018-2023 Patrick Geneva
+ * Copyright (C) 2018-2023 Guoquan Huang
+ * Copyright (C) 2018-2023 OpenVINS Contributors
+ * Copyright (C) 2018-2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OV_CORE_TRACK_ARCHIVE_H
+#define OV_CORE_TRACK_ARCHIVE_H
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <Eigen/Eigen>
+
+namespace ov_core {
+
+/**
+ * @brief Compact quantized archive of historical feature tracks.
+ *
+ * This stores the per-frame (u, v, depth) observations that loop-closure export needs, but in
+ * a compressed layout instead of per-frame maps of Eigen vectors: pixel coordinates are
+ * fixed-point quantized to 1/16 px, depth to millimeters, and each measurement's timestamp is
+ * a varint-encoded frame-index delta into one shared timestamp table. A long track therefore
+ * costs about 7 bytes per observation instead of the ~80 the uncompressed maps pay, which is
+ * what keeps multi-hour missions from growing their RSS with track history.
+ *
+ * Consumers read through the streaming interface (@ref stream_track / @ref stream_all), which
+ * decodes measurements one at a time into the caller's callback so message assembly never has
+ * to materialize a full uncompressed copy of the archive.
+ *
+ * All public functions are thread-safe (append from the pipeline, stream from a publisher).
+ */
+class TrackArchive {
+
+public:
+  /// One decoded observation handed to streaming consumers
+  struct Measurement {
+    double timestamp = 0; ///< Imaging time of the frame this was seen in
+    float u = 0;          ///< Distorted pixel u coordinate (1/16 px resolution)
+    float v = 0;          ///< Distorted pixel v coordinate (1/16 px resolution)
+    float depth = 0;      ///< Depth in the imaging frame in meters (1 mm resolution, saturates at ~65 m)
+  };
+
+  /**
+   * @brief Appends one frame of active track observations to the archive.
+   * @param timestamp Imaging time of this frame (must be newer than all previous frames)
+   * @param uvd Per-feature distorted uv and depth, as produced by the active track re-triangulation
+   */
+  void append_frame(double timestamp, const std::unordered_map<size_t, Eigen::Vector3d> &uvd);
+
+  /**
+   * @brief Streams one feature's history (oldest first) into the given callback.
+   * @param featid Frontend id of the feature to stream
+   * @param callback Called once per decoded measurement
+   * @return False if we have never archived this feature
+   */
+  bool stream_track(size_t featid, const std::function<void(const Measurement &)> &callback) const;
+
+  /**
+   * @brief Streams the whole archive (per feature, oldest measurement first) into the given callback.
+   * @param callback Called once per feature id and decoded measurement
+   */
+  void stream_all(const std::function<void(size_t featid, const Measurement &)> &callback) const;
+
+  /// Number of frames that have contributed observations
+  size_t num_frames() const {
+    std::lock_guard<std::mutex> lck(mtx);
+    return frame_times.size();
+  }
+
+  /// Number of distinct features archived
+  size_t num_features() const {
+    std::lock_guard<std::mutex> lck(mtx);
+    return tracks.size();
+  }
+
+  /// Total number of archived measurements
+  size_t num_measurements() const {
+    std::lock_guard<std::mutex> lck(mtx);
+    return total_meas;
+  }
+
+  /// Approximate heap footprint of the archive in bytes
+  size_t memory_bytes() const;
+
+  /// Removes all archived history
+  void clear();
+
+private:
+  /// Fixed-point scale of the stored pixel coordinates (1/16 px)
+  static const uint32_t UV_SCALE = 16;
+
+  /// Fixed-point scale of the stored depth (millimeters)
+  static const uint32_t DEPTH_SCALE = 1000;
+
+  /// Delta-encoded measurement history of a single feature
+  struct CompressedTrack {
+    size_t featid = 0;          ///< Frontend id of this feature
+    uint32_t last_frame = 0;    ///< Frame index of the newest measurement (delta base)
+    uint32_t num_meas = 0;      ///< Number of encoded measurements
+    std::vector<uint8_t> data;  ///< Encoded stream: varint frame delta, u16 u, u16 v, u16 depth
+  };
+
+  /// Appends a varint (7 bits per byte, high bit marks continuation) to a track's stream
+  static void encode_varint(std::vector<uint8_t> &data, uint32_t value);
+
+  /// Decodes one track into the callback (caller holds the lock)
+  void stream_track_impl(const CompressedTrack &track, const std::function<void(const Measurement &)> &callback) const;
+
+  /// Shared table of frame timestamps (measurements reference it by delta-encoded index)
+  std::vector<double> frame_times;
+
+  /// Compressed per-feature tracks, and the id to slot lookup ("pooled" feature ids)
+  std::vector<CompressedTrack> tracks;
+  std::unordered_map<size_t, uint32_t> track_index;
+
+  /// Total number of archived measurements
+  size_t total_meas = 0;
+
+  /// Lock guarding the archive (pipeline appends, publishers stream)
+  mutable std::mutex mtx;
+};
+
+} // namespace ov_core
+
+#endif // OV_CORE_TRACK_ARCHIVE_H
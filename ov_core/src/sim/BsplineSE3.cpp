@@ -59,6 +59,8 @@ void BsplineSE3::feed_trajectory(std::vector<Eigen::VectorXd> traj_points) {
   PRINT_DEBUG("[B-SPLINE]: trajectory end time = %.6f\n", timestamp_max);
 
   // then create spline control points
+  control_times.clear();
+  control_poses.clear();
   double timestamp_curr = timestamp_min;
   while (true) {
 
@@ -77,48 +79,89 @@ void BsplineSE3::feed_trajectory(std::vector<Eigen::VectorXd> traj_points) {
     // Linear interpolation and append to our control points
     double lambda = (timestamp_curr - t0) / (t1 - t0);
     Eigen::Matrix4d pose_interp = exp_se3(lambda * log_se3(pose1 * Inv_se3(pose0))) * pose0;
-    control_points.insert({timestamp_curr, pose_interp});
+    control_times.push_back(timestamp_curr);
+    control_poses.push_back(pose_interp);
     timestamp_curr += dt;
     // std::stringstream ss;
     // ss << pose_interp(0,3) << "," << pose_interp(1,3) << "," << pose_interp(2,3) << std::endl;
     // PRINT_DEBUG(ss.str().c_str());
   }
 
+  // Segment terms are computed lazily on the first query that lands in each segment
+  segment_terms.assign(control_times.size(), SegmentTerms());
+
   // The start time of the system is two dt in since we need at least two older control points
   timestamp_start = timestamp_min + 2 * dt;
   PRINT_DEBUG("[B-SPLINE]: start trajectory time of %.6f\n", timestamp_start);
 }
 
-bool BsplineSE3::get_pose(double timestamp, Eigen::Matrix3d &R_GtoI, Eigen::Vector3d &p_IinG) {
+bool BsplineSE3::find_segment(double timestamp, size_t &index) {
+
+  // We need at least four control points to interpolate
+  if (control_times.size() < 4)
+    return false;
+
+  // The control points are uniformly spaced at dt, so we can directly compute the index
+  double offset = (timestamp - control_times.front()) / dt;
+  if (offset < 0)
+    return false;
+  size_t i = (size_t)offset;
+  if (i >= control_times.size())
+    i = control_times.size() - 1;
+
+  // Correct for accumulated floating point drift of the control point times
+  // We want the segment such that t_i <= timestamp < t_i+1
+  while (i + 1 < control_times.size() && control_times.at(i + 1) <= timestamp)
+    i++;
+  while (i > 0 && control_times.at(i) > timestamp)
+    i--;
+
+  // We need one control point older and two newer than the bounding pair
+  if (i < 1 || i + 2 >= control_times.size() || control_times.at(i) > timestamp)
+    return false;
+  index = i;
+  return true;
+}
 
-  // Get the bounding poses for the desired timestamp
-  double t0, t1, t2, t3;
-  Eigen::Matrix4d pose0, pose1, pose2, pose3;
-  bool success = find_bounding_control_points(timestamp, control_points, t0, pose0, t1, pose1, t2, pose2, t3, pose3);
-  // PRINT_DEBUG("[SIM]: time curr = %.6f | dt1 = %.3f | dt2 = %.3f | dt3 = %.3f | dt4 = %.3f | success =
-  // %d\n",timestamp,t0-timestamp,t1-timestamp,t2-timestamp,t3-timestamp,(int)success);
+const BsplineSE3::SegmentTerms &BsplineSE3::get_segment_terms(size_t index) {
+
+  // Compute the three relative SE(3) logs of this segment if we have not seen it yet
+  // These are shared by every pose/velocity/acceleration query that lands in the segment
+  SegmentTerms &terms = segment_terms.at(index);
+  if (!terms.valid) {
+    terms.omega_10 = log_se3(Inv_se3(control_poses.at(index - 1)) * control_poses.at(index));
+    terms.omega_21 = log_se3(Inv_se3(control_poses.at(index)) * control_poses.at(index + 1));
+    terms.omega_32 = log_se3(Inv_se3(control_poses.at(index + 1)) * control_poses.at(index + 2));
+    terms.valid = true;
+  }
+  return terms;
+}
+
+bool BsplineSE3::get_pose(double timestamp, Eigen::Matrix3d &R_GtoI, Eigen::Vector3d &p_IinG) {
 
-  // Return failure if we can't get bounding poses
-  if (!success) {
+  // Get the segment of control points bounding the desired timestamp
+  size_t i = 0;
+  if (!find_segment(timestamp, i)) {
     R_GtoI.setIdentity();
     p_IinG.setZero();
     return false;
   }
+  const SegmentTerms &terms = get_segment_terms(i);
 
   // Our De Boor-Cox matrix scalars
-  double DT = (t2 - t1);
-  double u = (timestamp - t1) / DT;
+  double DT = control_times.at(i + 1) - control_times.at(i);
+  double u = (timestamp - control_times.at(i)) / DT;
   double b0 = 1.0 / 6.0 * (5 + 3 * u - 3 * u * u + u * u * u);
   double b1 = 1.0 / 6.0 * (1 + 3 * u + 3 * u * u - 2 * u * u * u);
   double b2 = 1.0 / 6.0 * (u * u * u);
 
   // Calculate interpolated poses
-  Eigen::Matrix4d A0 = exp_se3(b0 * log_se3(Inv_se3(pose0) * pose1));
-  Eigen::Matrix4d A1 = exp_se3(b1 * log_se3(Inv_se3(pose1) * pose2));
-  Eigen::Matrix4d A2 = exp_se3(b2 * log_se3(Inv_se3(pose2) * pose3));
+  Eigen::Matrix4d A0 = exp_se3(b0 * terms.omega_10);
+  Eigen::Matrix4d A1 = exp_se3(b1 * terms.omega_21);
+  Eigen::Matrix4d A2 = exp_se3(b2 * terms.omega_32);
 
   // Finally get the interpolated pose
-  Eigen::Matrix4d pose_interp = pose0 * A0 * A1 * A2;
+  Eigen::Matrix4d pose_interp = control_poses.at(i - 1) * A0 * A1 * A2;
   R_GtoI = pose_interp.block(0, 0, 3, 3).transpose();
   p_IinG = pose_interp.block(0, 3, 3, 1);
   return true;
@@ -127,23 +170,18 @@ bool BsplineSE3::get_pose(double timestamp, Eigen::Matrix3d &R_GtoI, Eigen::Vect
 bool BsplineSE3::get_velocity(double timestamp, Eigen::Matrix3d &R_GtoI, Eigen::Vector3d &p_IinG, Eigen::Vector3d &w_IinI,
                               Eigen::Vector3d &v_IinG) {
 
-  // Get the bounding poses for the desired timestamp
-  double t0, t1, t2, t3;
-  Eigen::Matrix4d pose0, pose1, pose2, pose3;
-  bool success = find_bounding_control_points(timestamp, control_points, t0, pose0, t1, pose1, t2, pose2, t3, pose3);
-  // PRINT_DEBUG("[SIM]: time curr = %.6f | dt1 = %.3f | dt2 = %.3f | dt3 = %.3f | dt4 = %.3f | success =
-  // %d\n",timestamp,t0-timestamp,t1-timestamp,t2-timestamp,t3-timestamp,(int)success);
-
-  // Return failure if we can't get bounding poses
-  if (!success) {
+  // Get the segment of control points bounding the desired timestamp
+  size_t i = 0;
+  if (!find_segment(timestamp, i)) {
     w_IinI.setZero();
     v_IinG.setZero();
     return false;
   }
+  const SegmentTerms &terms = get_segment_terms(i);
 
   // Our De Boor-Cox matrix scalars
-  double DT = (t2 - t1);
-  double u = (timestamp - t1) / DT;
+  double DT = control_times.at(i + 1) - control_times.at(i);
+  double u = (timestamp - control_times.at(i)) / DT;
   double b0 = 1.0 / 6.0 * (5 + 3 * u - 3 * u * u + u * u * u);
   double b1 = 1.0 / 6.0 * (1 + 3 * u + 3 * u * u - 2 * u * u * u);
   double b2 = 1.0 / 6.0 * (u * u * u);
@@ -151,27 +189,22 @@ bool BsplineSE3::get_velocity(double timestamp, Eigen::Matrix3d &R_GtoI, Eigen::
   double b1dot = 1.0 / (6.0 * DT) * (3 + 6 * u - 6 * u * u);
   double b2dot = 1.0 / (6.0 * DT) * (3 * u * u);
 
-  // Cache some values we use alot
-  Eigen::Matrix<double, 6, 1> omega_10 = log_se3(Inv_se3(pose0) * pose1);
-  Eigen::Matrix<double, 6, 1> omega_21 = log_se3(Inv_se3(pose1) * pose2);
-  Eigen::Matrix<double, 6, 1> omega_32 = log_se3(Inv_se3(pose2) * pose3);
-
   // Calculate interpolated poses
-  Eigen::Matrix4d A0 = exp_se3(b0 * omega_10);
-  Eigen::Matrix4d A1 = exp_se3(b1 * omega_21);
-  Eigen::Matrix4d A2 = exp_se3(b2 * omega_32);
-  Eigen::Matrix4d A0dot = b0dot * hat_se3(omega_10) * A0;
-  Eigen::Matrix4d A1dot = b1dot * hat_se3(omega_21) * A1;
-  Eigen::Matrix4d A2dot = b2dot * hat_se3(omega_32) * A2;
+  Eigen::Matrix4d A0 = exp_se3(b0 * terms.omega_10);
+  Eigen::Matrix4d A1 = exp_se3(b1 * terms.omega_21);
+  Eigen::Matrix4d A2 = exp_se3(b2 * terms.omega_32);
+  Eigen::Matrix4d A0dot = b0dot * hat_se3(terms.omega_10) * A0;
+  Eigen::Matrix4d A1dot = b1dot * hat_se3(terms.omega_21) * A1;
+  Eigen::Matrix4d A2dot = b2dot * hat_se3(terms.omega_32) * A2;
 
   // Get the interpolated pose
-  Eigen::Matrix4d pose_interp = pose0 * A0 * A1 * A2;
+  Eigen::Matrix4d pose_interp = control_poses.at(i - 1) * A0 * A1 * A2;
   R_GtoI = pose_interp.block(0, 0, 3, 3).transpose();
   p_IinG = pose_interp.block(0, 3, 3, 1);
 
   // Finally get the interpolated velocities
   // NOTE: Rdot = R*skew(omega) => R^T*Rdot = skew(omega)
-  Eigen::Matrix4d vel_interp = pose0 * (A0dot * A1 * A2 + A0 * A1dot * A2 + A0 * A1 * A2dot);
+  Eigen::Matrix4d vel_interp = control_poses.at(i - 1) * (A0dot * A1 * A2 + A0 * A1dot * A2 + A0 * A1 * A2dot);
   w_IinI = vee(pose_interp.block(0, 0, 3, 3).transpose() * vel_interp.block(0, 0, 3, 3));
   v_IinG = vel_interp.block(0, 3, 3, 1);
   return true;
@@ -180,21 +213,18 @@ bool BsplineSE3::get_velocity(double timestamp, Eigen::Matrix3d &R_GtoI, Eigen::
 bool BsplineSE3::get_acceleration(double timestamp, Eigen::Matrix3d &R_GtoI, Eigen::Vector3d &p_IinG, Eigen::Vector3d &w_IinI,
                                   Eigen::Vector3d &v_IinG, Eigen::Vector3d &alpha_IinI, Eigen::Vector3d &a_IinG) {
 
-  // Get the bounding poses for the desired timestamp
-  double t0, t1, t2, t3;
-  Eigen::Matrix4d pose0, pose1, pose2, pose3;
-  bool success = find_bounding_control_points(timestamp, control_points, t0, pose0, t1, pose1, t2, pose2, t3, pose3);
-
-  // Return failure if we can't get bounding poses
-  if (!success) {
+  // Get the segment of control points bounding the desired timestamp
+  size_t i = 0;
+  if (!find_segment(timestamp, i)) {
     alpha_IinI.setZero();
     a_IinG.setZero();
     return false;
   }
+  const SegmentTerms &terms = get_segment_terms(i);
 
   // Our De Boor-Cox matrix scalars
-  double DT = (t2 - t1);
-  double u = (timestamp - t1) / DT;
+  double DT = control_times.at(i + 1) - control_times.at(i);
+  double u = (timestamp - control_times.at(i)) / DT;
   double b0 = 1.0 / 6.0 * (5 + 3 * u - 3 * u * u + u * u * u);
   double b1 = 1.0 / 6.0 * (1 + 3 * u + 3 * u * u - 2 * u * u * u);
   double b2 = 1.0 / 6.0 * (u * u * u);
@@ -206,17 +236,14 @@ bool BsplineSE3::get_acceleration(double timestamp, Eigen::Matrix3d &R_GtoI, Eig
   double b2dotdot = 1.0 / (6.0 * DT * DT) * (6 * u);
 
   // Cache some values we use alot
-  Eigen::Matrix<double, 6, 1> omega_10 = log_se3(Inv_se3(pose0) * pose1);
-  Eigen::Matrix<double, 6, 1> omega_21 = log_se3(Inv_se3(pose1) * pose2);
-  Eigen::Matrix<double, 6, 1> omega_32 = log_se3(Inv_se3(pose2) * pose3);
-  Eigen::Matrix4d omega_10_hat = hat_se3(omega_10);
-  Eigen::Matrix4d omega_21_hat = hat_se3(omega_21);
-  Eigen::Matrix4d omega_32_hat = hat_se3(omega_32);
+  Eigen::Matrix4d omega_10_hat = hat_se3(terms.omega_10);
+  Eigen::Matrix4d omega_21_hat = hat_se3(terms.omega_21);
+  Eigen::Matrix4d omega_32_hat = hat_se3(terms.omega_32);
 
   // Calculate interpolated poses
-  Eigen::Matrix4d A0 = exp_se3(b0 * omega_10);
-  Eigen::Matrix4d A1 = exp_se3(b1 * omega_21);
-  Eigen::Matrix4d A2 = exp_se3(b2 * omega_32);
+  Eigen::Matrix4d A0 = exp_se3(b0 * terms.omega_10);
+  Eigen::Matrix4d A1 = exp_se3(b1 * terms.omega_21);
+  Eigen::Matrix4d A2 = exp_se3(b2 * terms.omega_32);
   Eigen::Matrix4d A0dot = b0dot * omega_10_hat * A0;
   Eigen::Matrix4d A1dot = b1dot * omega_21_hat * A1;
   Eigen::Matrix4d A2dot = b2dot * omega_32_hat * A2;
@@ -225,27 +252,61 @@ bool BsplineSE3::get_acceleration(double timestamp, Eigen::Matrix3d &R_GtoI, Eig
   Eigen::Matrix4d A2dotdot = b2dot * omega_32_hat * A2dot + b2dotdot * omega_32_hat * A2;
 
   // Get the interpolated pose
-  Eigen::Matrix4d pose_interp = pose0 * A0 * A1 * A2;
+  Eigen::Matrix4d pose_interp = control_poses.at(i - 1) * A0 * A1 * A2;
   R_GtoI = pose_interp.block(0, 0, 3, 3).transpose();
   p_IinG = pose_interp.block(0, 3, 3, 1);
 
   // Get the interpolated velocities
   // NOTE: Rdot = R*skew(omega) => R^T*Rdot = skew(omega)
-  Eigen::Matrix4d vel_interp = pose0 * (A0dot * A1 * A2 + A0 * A1dot * A2 + A0 * A1 * A2dot);
+  Eigen::Matrix4d vel_interp = control_poses.at(i - 1) * (A0dot * A1 * A2 + A0 * A1dot * A2 + A0 * A1 * A2dot);
   w_IinI = vee(pose_interp.block(0, 0, 3, 3).transpose() * vel_interp.block(0, 0, 3, 3));
   v_IinG = vel_interp.block(0, 3, 3, 1);
 
   // Finally get the interpolated velocities
   // NOTE: Rdot = R*skew(omega)
   // NOTE: Rdotdot = Rdot*skew(omega) + R*skew(alpha) => R^T*(Rdotdot-Rdot*skew(omega))=skew(alpha)
-  Eigen::Matrix4d acc_interp = pose0 * (A0dotdot * A1 * A2 + A0 * A1dotdot * A2 + A0 * A1 * A2dotdot + 2 * A0dot * A1dot * A2 +
-                                        2 * A0 * A1dot * A2dot + 2 * A0dot * A1 * A2dot);
+  Eigen::Matrix4d acc_interp = control_poses.at(i - 1) * (A0dotdot * A1 * A2 + A0 * A1dotdot * A2 + A0 * A1 * A2dotdot +
+                                                          2 * A0dot * A1dot * A2 + 2 * A0 * A1dot * A2dot + 2 * A0dot * A1 * A2dot);
   Eigen::Matrix3d omegaskew = pose_interp.block(0, 0, 3, 3).transpose() * vel_interp.block(0, 0, 3, 3);
   alpha_IinI = vee(pose_interp.block(0, 0, 3, 3).transpose() * (acc_interp.block(0, 0, 3, 3) - vel_interp.block(0, 0, 3, 3) * omegaskew));
   a_IinG = acc_interp.block(0, 3, 3, 1);
   return true;
 }
 
+std::vector<bool> BsplineSE3::get_pose_batch(const std::vector<double> &timestamps, std::vector<Eigen::Matrix3d> &R_GtoI,
+                                             std::vector<Eigen::Vector3d> &p_IinG) {
+
+  // Evaluate each query in order, the segment term cache turns the repeated
+  // control point logs of a dense sorted batch into a single set per segment
+  std::vector<bool> success(timestamps.size(), false);
+  R_GtoI.assign(timestamps.size(), Eigen::Matrix3d::Identity());
+  p_IinG.assign(timestamps.size(), Eigen::Vector3d::Zero());
+  for (size_t k = 0; k < timestamps.size(); k++) {
+    success.at(k) = get_pose(timestamps.at(k), R_GtoI.at(k), p_IinG.at(k));
+  }
+  return success;
+}
+
+std::vector<bool> BsplineSE3::get_acceleration_batch(const std::vector<double> &timestamps, std::vector<Eigen::Matrix3d> &R_GtoI,
+                                                     std::vector<Eigen::Vector3d> &p_IinG, std::vector<Eigen::Vector3d> &w_IinI,
+                                                     std::vector<Eigen::Vector3d> &v_IinG, std::vector<Eigen::Vector3d> &alpha_IinI,
+                                                     std::vector<Eigen::Vector3d> &a_IinG) {
+
+  // Same as the pose batch, shares the cached segment terms across sorted queries
+  std::vector<bool> success(timestamps.size(), false);
+  R_GtoI.assign(timestamps.size(), Eigen::Matrix3d::Identity());
+  p_IinG.assign(timestamps.size(), Eigen::Vector3d::Zero());
+  w_IinI.assign(timestamps.size(), Eigen::Vector3d::Zero());
+  v_IinG.assign(timestamps.size(), Eigen::Vector3d::Zero());
+  alpha_IinI.assign(timestamps.size(), Eigen::Vector3d::Zero());
+  a_IinG.assign(timestamps.size(), Eigen::Vector3d::Zero());
+  for (size_t k = 0; k < timestamps.size(); k++) {
+    success.at(k) =
+        get_acceleration(timestamps.at(k), R_GtoI.at(k), p_IinG.at(k), w_IinI.at(k), v_IinG.at(k), alpha_IinI.at(k), a_IinG.at(k));
+  }
+  return success;
+}
+
 bool BsplineSE3::find_bounding_poses(const double timestamp, const AlignedEigenMat4d &poses, double &t0, Eigen::Matrix4d &pose0, double &t1,
                                      Eigen::Matrix4d &pose1) {
 
@@ -297,62 +358,3 @@ bool BsplineSE3::find_bounding_poses(const double timestamp, const AlignedEigenM
   // Return true if we found both bounds
   return (found_older && found_newer);
 }
-
-bool BsplineSE3::find_bounding_control_points(const double timestamp, const AlignedEigenMat4d &poses, double &t0, Eigen::Matrix4d &pose0,
-                                              double &t1, Eigen::Matrix4d &pose1, double &t2, Eigen::Matrix4d &pose2, double &t3,
-                                              Eigen::Matrix4d &pose3) {
-
-  // Set the default values
-  t0 = -1;
-  t1 = -1;
-  t2 = -1;
-  t3 = -1;
-  pose0 = Eigen::Matrix4d::Identity();
-  pose1 = Eigen::Matrix4d::Identity();
-  pose2 = Eigen::Matrix4d::Identity();
-  pose3 = Eigen::Matrix4d::Identity();
-
-  // Get the two bounding poses
-  bool success = find_bounding_poses(timestamp, poses, t1, pose1, t2, pose2);
-
-  // Return false if this was a failure
-  if (!success)
-    return false;
-
-  // Now find the poses that are below and above
-  auto iter_t1 = poses.find(t1);
-  auto iter_t2 = poses.find(t2);
-
-  // Check that t1 is not the first timestamp
-  if (iter_t1 == poses.begin()) {
-    return false;
-  }
-
-  // Move the older pose backwards in time
-  // Move the newer one forwards in time
-  auto iter_t0 = --iter_t1;
-  auto iter_t3 = ++iter_t2;
-
-  // Check that it is valid
-  if (iter_t3 == poses.end()) {
-    return false;
-  }
-
-  // Set the oldest one
-  t0 = iter_t0->first;
-  pose0 = iter_t0->second;
-
-  // Set the newest one
-  t3 = iter_t3->first;
-  pose3 = iter_t3->second;
-
-  // Assert the timestamps
-  if (success) {
-    assert(t0 < t1);
-    assert(t1 < t2);
-    assert(t2 < t3);
-  }
-
-  // Return true if we found all four bounding poses
-  return success;
-}
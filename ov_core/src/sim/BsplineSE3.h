@@ -153,6 +153,38 @@ public:
   bool get_acceleration(double timestamp, Eigen::Matrix3d &R_GtoI, Eigen::Vector3d &p_IinG, Eigen::Vector3d &w_IinI,
                         Eigen::Vector3d &v_IinG, Eigen::Vector3d &alpha_IinI, Eigen::Vector3d &a_IinG);
 
+  /**
+   * @brief Batch version of @ref get_pose for a sorted set of timestamps.
+   *
+   * The SE(3) log terms of each control point segment are computed once and shared by
+   * every query that falls inside it, so evaluating a dense (e.g. IMU rate) batch only
+   * pays for the per-query matrix exponentials.
+   *
+   * @param timestamps Sorted timestamps to evaluate the spline at
+   * @param R_GtoI SO(3) orientation of each pose in the global frame
+   * @param p_IinG Position of each pose in the global
+   * @return Per-timestamp success flags (false if a timestamp is outside the spline)
+   */
+  std::vector<bool> get_pose_batch(const std::vector<double> &timestamps, std::vector<Eigen::Matrix3d> &R_GtoI,
+                                   std::vector<Eigen::Vector3d> &p_IinG);
+
+  /**
+   * @brief Batch version of @ref get_acceleration for a sorted set of timestamps.
+   *
+   * @param timestamps Sorted timestamps to evaluate the spline at
+   * @param R_GtoI SO(3) orientation of each pose in the global frame
+   * @param p_IinG Position of each pose in the global
+   * @param w_IinI Angular velocity in the inertial frame
+   * @param v_IinG Linear velocity in the global frame
+   * @param alpha_IinI Angular acceleration in the inertial frame
+   * @param a_IinG Linear acceleration in the global frame
+   * @return Per-timestamp success flags (false if a timestamp is outside the spline)
+   */
+  std::vector<bool> get_acceleration_batch(const std::vector<double> &timestamps, std::vector<Eigen::Matrix3d> &R_GtoI,
+                                           std::vector<Eigen::Vector3d> &p_IinG, std::vector<Eigen::Vector3d> &w_IinI,
+                                           std::vector<Eigen::Vector3d> &v_IinG, std::vector<Eigen::Vector3d> &alpha_IinI,
+                                           std::vector<Eigen::Vector3d> &a_IinG);
+
   /// Returns the simulation start time that we should start simulating from
   double get_start_time() { return timestamp_start; }
 
@@ -167,8 +199,36 @@ protected:
   typedef std::map<double, Eigen::Matrix4d, std::less<double>, Eigen::aligned_allocator<std::pair<const double, Eigen::Matrix4d>>>
       AlignedEigenMat4d;
 
-  /// Our control SE3 control poses (R_ItoG, p_IinG)
-  AlignedEigenMat4d control_points;
+  /// Timestamps of our uniformly spaced control points
+  std::vector<double> control_times;
+
+  /// Our control SE3 control poses (R_ItoG, p_IinG), index matched with control_times
+  std::vector<Eigen::Matrix4d, Eigen::aligned_allocator<Eigen::Matrix4d>> control_poses;
+
+  /// Cached SE(3) log terms of one control point segment (the three relative twists)
+  struct SegmentTerms {
+    bool valid = false;
+    Eigen::Matrix<double, 6, 1> omega_10, omega_21, omega_32;
+  };
+
+  /// Lazily computed terms of each segment, shared by all queries that fall inside it
+  std::vector<SegmentTerms, Eigen::aligned_allocator<SegmentTerms>> segment_terms;
+
+  /**
+   * @brief Finds the segment index i such that t_i <= timestamp < t_i+1.
+   *
+   * Since the control points are uniformly spaced the index is computed arithmetically
+   * (with a small correction for accumulated floating point drift) instead of walking
+   * an ordered map, so dense in-order queries cost constant time each.
+   *
+   * @param timestamp Desired timestamp we want the bounding control points of
+   * @param index Segment index (needs index-1 through index+2 to be valid points)
+   * @return False if the four control points bounding this timestamp do not exist
+   */
+  bool find_segment(double timestamp, size_t &index);
+
+  /// Terms of the given segment (computed and cached on first use)
+  const SegmentTerms &get_segment_terms(size_t index);
 
   /**
    * @brief Will find the two bounding poses for a given timestamp.
@@ -186,25 +246,6 @@ protected:
    */
   static bool find_bounding_poses(const double timestamp, const AlignedEigenMat4d &poses, double &t0, Eigen::Matrix4d &pose0, double &t1,
                                   Eigen::Matrix4d &pose1);
-
-  /**
-   * @brief Will find two older poses and two newer poses for the current timestamp
-   *
-   * @param timestamp Desired timestamp we want to get four bounding poses of
-   * @param poses Map of poses and timestamps
-   * @param t0 Timestamp of the first pose
-   * @param pose0 SE(3) pose of the first pose
-   * @param t1 Timestamp of the second pose
-   * @param pose1 SE(3) pose of the second pose
-   * @param t2 Timestamp of the third pose
-   * @param pose2 SE(3) pose of the third pose
-   * @param t3 Timestamp of the fourth pose
-   * @param pose3 SE(3) pose of the fourth pose
-   * @return False if we are unable to find bounding poses
-   */
-  static bool find_bounding_control_points(const double timestamp, const AlignedEigenMat4d &poses, double &t0, Eigen::Matrix4d &pose0,
-                                           double &t1, Eigen::Matrix4d &pose1, double &t2, Eigen::Matrix4d &pose2, double &t3,
-                                           Eigen::Matrix4d &pose3);
 };
 
 } // namespace ov_core
@@ -20,24 +20,60 @@
  */
 
 #include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <memory>
 #include <sstream>
+#include <string>
 #include <unistd.h>
+#include <unordered_map>
 #include <vector>
 
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
 #include <Eigen/Dense>
 
 #include <opencv2/core/core.hpp>
 #include <opencv2/opencv.hpp>
 
 #include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/math/distributions/students_t.hpp>
 
+#include "cam/CamRadtan.h"
+#include "track/TrackKLT.h"
+#include "utils/colors.h"
 #include "utils/print.h"
+#include "utils/sensor_data.h"
+#include "utils/tracer.h"
 
 // Define the function to be called when ctrl-c (SIGINT) is sent to process
 void signal_callback_handler(int signum) { std::exit(signum); }
 
+// Number of leading samples we drop from every benchmark before computing statistics
+// (cold caches, lazy allocations, and thermal ramp all land in these first samples)
+int num_warmup = 10;
+
+// One benchmark statistic recorded this run (used for file emission and compare mode)
+struct BenchStat {
+  std::string name;
+  int trials = 0;
+  double mean_ms = 0.0;
+  double std_ms = 0.0;
+};
+std::vector<BenchStat> bench_results;
+
 void print_stats(std::string title, std::vector<double> times, std::string title2 = "", std::vector<int> stats = {}) {
 
+  // Separate out the warmup samples from the front
+  if ((int)times.size() > num_warmup + 1) {
+    times.erase(times.begin(), times.begin() + num_warmup);
+    if ((int)stats.size() > num_warmup)
+      stats.erase(stats.begin(), stats.begin() + num_warmup);
+  }
+
   // Compute mean and rmse
   double mean = 0.0;
   double rmse = 0.0;
@@ -68,6 +104,158 @@ void print_stats(std::string title, std::vector<double> times, std::string title
     mean2 /= stats.size();
     PRINT_INFO("%s: %.3f +- %.3f ms (%.2f avg %s)\n", title.c_str(), mean, std, mean2, title2.c_str());
   }
+
+  // Record for file emission and regression comparison
+  BenchStat stat;
+  stat.name = title;
+  stat.trials = (int)times.size();
+  stat.mean_ms = mean;
+  stat.std_ms = std;
+  bench_results.push_back(stat);
+}
+
+/**
+ * @brief Pins the calling process to a single CPU so the scheduler cannot migrate us.
+ *
+ * Core migration and per-core frequency differences are the main source of noise in these
+ * benchmarks, so pinned runs should always be used when two results will be compared.
+ */
+bool pin_cpu(int cpu) {
+#if defined(__linux__)
+  cpu_set_t mask;
+  CPU_ZERO(&mask);
+  CPU_SET(cpu, &mask);
+  if (sched_setaffinity(0, sizeof(mask), &mask) != 0) {
+    PRINT_WARNING(YELLOW "unable to pin process to cpu %d, timings will be noisier\n" RESET, cpu);
+    return false;
+  }
+  PRINT_INFO("pinned process to cpu %d\n", cpu);
+  return true;
+#else
+  (void)cpu;
+  PRINT_WARNING(YELLOW "cpu pinning is not supported on this platform\n" RESET);
+  return false;
+#endif
+}
+
+/**
+ * @brief Saves all recorded benchmark statistics into a comma-separated results file.
+ *
+ * The file can later be fed back with `--compare old.txt new.txt` to test for regressions.
+ */
+void save_results(const std::string &path) {
+  std::ofstream file(path, std::ofstream::out | std::ofstream::trunc);
+  if (!file.is_open()) {
+    PRINT_ERROR(RED "unable to open results output file %s\n" RESET, path.c_str());
+    return;
+  }
+  file << "# benchmark,trials,mean_ms,std_ms" << std::endl;
+  for (const auto &stat : bench_results) {
+    file << stat.name << "," << stat.trials << "," << stat.mean_ms << "," << stat.std_ms << std::endl;
+  }
+  file.close();
+  PRINT_INFO("saved %d benchmark results to %s\n", (int)bench_results.size(), path.c_str());
+}
+
+/**
+ * @brief Loads a results file written by save_results() (insertion ordered).
+ */
+std::vector<BenchStat> load_results(const std::string &path) {
+  std::vector<BenchStat> results;
+  std::ifstream file(path);
+  if (!file.is_open()) {
+    PRINT_ERROR(RED "unable to open results file %s\n" RESET, path.c_str());
+    return results;
+  }
+  std::string line;
+  while (std::getline(file, line)) {
+    if (line.empty() || line.at(0) == '#')
+      continue;
+    std::stringstream ss(line);
+    std::string name, trials, mean, std;
+    if (!std::getline(ss, name, ',') || !std::getline(ss, trials, ',') || !std::getline(ss, mean, ',') || !std::getline(ss, std, ','))
+      continue;
+    BenchStat stat;
+    stat.name = name;
+    stat.trials = std::atoi(trials.c_str());
+    stat.mean_ms = std::atof(mean.c_str());
+    stat.std_ms = std::atof(std.c_str());
+    results.push_back(stat);
+  }
+  return results;
+}
+
+/**
+ * @brief Two-sided p-value of Welch's unequal-variance t-test between two benchmark results.
+ *
+ * This tests whether the two recorded means could have come from the same distribution, so a
+ * small p-value together with a meaningful relative change marks a real performance shift
+ * rather than run-to-run noise.
+ */
+double welch_p_value(const BenchStat &stat_a, const BenchStat &stat_b) {
+  if (stat_a.trials < 2 || stat_b.trials < 2)
+    return 1.0;
+  double var_a = stat_a.std_ms * stat_a.std_ms / stat_a.trials;
+  double var_b = stat_b.std_ms * stat_b.std_ms / stat_b.trials;
+  double denom = var_a + var_b;
+  double df_denom = var_a * var_a / (stat_a.trials - 1) + var_b * var_b / (stat_b.trials - 1);
+  if (denom < 1e-20 || df_denom < 1e-40)
+    return 1.0;
+  double t = std::abs(stat_b.mean_ms - stat_a.mean_ms) / std::sqrt(denom);
+  double df = denom * denom / df_denom;
+  boost::math::students_t dist(df);
+  return 2.0 * boost::math::cdf(boost::math::complement(dist, t));
+}
+
+/**
+ * @brief Compares two results files and reports statistically significant changes.
+ *
+ * A benchmark is flagged as a regression if its mean grew by more than 5 percent *and* the
+ * change is significant at p < 0.01, so pure measurement noise does not fail a gate.
+ *
+ * @return Number of flagged regressions (nonzero exit code fails the calling CI job)
+ */
+int compare_results(const std::string &path_old, const std::string &path_new) {
+
+  // Load both files (baseline becomes a lookup table, candidate keeps its order)
+  std::vector<BenchStat> results_new = load_results(path_new);
+  std::map<std::string, BenchStat> results_old;
+  for (const auto &stat : load_results(path_old)) {
+    results_old.insert({stat.name, stat});
+  }
+  if (results_old.empty() || results_new.empty()) {
+    PRINT_ERROR(RED "nothing to compare (empty or unreadable results file)\n" RESET);
+    return 1;
+  }
+
+  // Walk the candidate results and test each against its baseline
+  int num_regressed = 0;
+  int num_improved = 0;
+  PRINT_INFO("comparing %s (baseline) against %s\n", path_old.c_str(), path_new.c_str());
+  for (const auto &stat_new : results_new) {
+    auto it = results_old.find(stat_new.name);
+    if (it == results_old.end()) {
+      PRINT_WARNING(YELLOW "%s: not in baseline, skipping\n" RESET, stat_new.name.c_str());
+      continue;
+    }
+    const BenchStat &stat_old = it->second;
+    double delta_pct = 100.0 * (stat_new.mean_ms - stat_old.mean_ms) / stat_old.mean_ms;
+    double p_value = welch_p_value(stat_old, stat_new);
+    bool significant = (p_value < 0.01);
+    if (significant && delta_pct > 5.0) {
+      num_regressed++;
+      PRINT_ERROR(RED "%s: %.3f -> %.3f ms (%+.1f%%, p=%.4f) REGRESSED\n" RESET, stat_new.name.c_str(), stat_old.mean_ms, stat_new.mean_ms,
+                  delta_pct, p_value);
+    } else if (significant && delta_pct < -5.0) {
+      num_improved++;
+      PRINT_INFO(GREEN "%s: %.3f -> %.3f ms (%+.1f%%, p=%.4f) improved\n" RESET, stat_new.name.c_str(), stat_old.mean_ms, stat_new.mean_ms,
+                 delta_pct, p_value);
+    } else {
+      PRINT_INFO("%s: %.3f -> %.3f ms (%+.1f%%, p=%.4f)\n", stat_new.name.c_str(), stat_old.mean_ms, stat_new.mean_ms, delta_pct, p_value);
+    }
+  }
+  PRINT_INFO("%d benchmarks compared, %d regressed, %d improved\n", (int)results_new.size(), num_regressed, num_improved);
+  return num_regressed;
 }
 
 // Main function
@@ -77,8 +265,27 @@ int main(int argc, char **argv) {
   std::string verbosity = "INFO";
   ov_core::Printer::setPrintLevel(verbosity);
 
-  // Parameters used in all algorithms
+  // Parse the command line options (compare mode short-circuits the benchmarks)
+  std::string path_out;
   int num_trials = 100;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--compare" && i + 2 < argc) {
+      return (compare_results(argv[i + 1], argv[i + 2]) == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+    } else if (arg == "--out" && i + 1 < argc) {
+      path_out = argv[++i];
+    } else if (arg == "--cpu" && i + 1 < argc) {
+      pin_cpu(std::atoi(argv[++i]));
+    } else if (arg == "--trials" && i + 1 < argc) {
+      num_trials = std::atoi(argv[++i]);
+    } else if (arg == "--warmup" && i + 1 < argc) {
+      num_warmup = std::atoi(argv[++i]);
+    } else {
+      PRINT_ERROR(RED "usage: %s [--out results.txt] [--cpu id] [--trials n] [--warmup n] [--compare old.txt new.txt]\n" RESET, argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  int num_samples = num_trials + num_warmup;
   int big_matrix = 1000;
   int big_matrix_eigen1 = 300;
   int big_matrix_eigen2 = 900;
@@ -96,7 +303,7 @@ int main(int argc, char **argv) {
 
   // OPENCV: RANDOM BIG IMAGE
   times_ms.clear();
-  for (int i = 0; i < num_trials; i++) {
+  for (int i = 0; i < num_samples; i++) {
     auto rT1 = boost::posix_time::microsec_clock::local_time();
     cv::randu(img3, cv::Scalar(0, 0, 0), cv::Scalar(255, 255, 255));
     auto rT2 = boost::posix_time::microsec_clock::local_time();
@@ -106,7 +313,7 @@ int main(int argc, char **argv) {
 
   // OPENCV: HISTOGRAM EQUALIZATION
   times_ms.clear();
-  for (int i = 0; i < num_trials; i++) {
+  for (int i = 0; i < num_samples; i++) {
     cv::randu(img1, cv::Scalar(0), cv::Scalar(255));
     auto rT1 = boost::posix_time::microsec_clock::local_time();
     cv::equalizeHist(img1, img1);
@@ -117,7 +324,7 @@ int main(int argc, char **argv) {
 
   // OPENCV: BUILD OPTICAL FLOW PYRAMID
   times_ms.clear();
-  for (int i = 0; i < num_trials; i++) {
+  for (int i = 0; i < num_samples; i++) {
     cv::randu(img1, cv::Scalar(0), cv::Scalar(255));
     auto rT1 = boost::posix_time::microsec_clock::local_time();
     std::vector<cv::Mat> imgpyr;
@@ -130,7 +337,7 @@ int main(int argc, char **argv) {
   // OPENCV: FAST FEATURE EXTRACTION
   times_ms.clear();
   extra_stats.clear();
-  for (int i = 0; i < num_trials; i++) {
+  for (int i = 0; i < num_samples; i++) {
     cv::randu(img1, cv::Scalar(0), cv::Scalar(255));
     auto rT1 = boost::posix_time::microsec_clock::local_time();
     std::vector<cv::KeyPoint> pts_new;
@@ -144,7 +351,7 @@ int main(int argc, char **argv) {
   // OPENCV: KLT OPTICAL FLOW
   times_ms.clear();
   extra_stats.clear();
-  for (int i = 0; i < num_trials; i++) {
+  for (int i = 0; i < num_samples; i++) {
     std::vector<cv::Mat> imgpyr1, imgpyr2;
     cv::buildOpticalFlowPyramid(img1, imgpyr1, win_size, pyr_levels);
     std::vector<cv::KeyPoint> pts0_tmp;
@@ -176,7 +383,7 @@ int main(int argc, char **argv) {
 
   // EIGEN3(double): RANDOM BIG MATRIX
   times_ms.clear();
-  for (int i = 0; i < num_trials; i++) {
+  for (int i = 0; i < num_samples; i++) {
     auto rT1 = boost::posix_time::microsec_clock::local_time();
     Eigen::MatrixXd mat1 = Eigen::MatrixXd::Random(big_matrix_eigen1, big_matrix_eigen1);
     Eigen::MatrixXd mat2 = Eigen::MatrixXd::Random(big_matrix_eigen1, big_matrix_eigen1);
@@ -187,7 +394,7 @@ int main(int argc, char **argv) {
 
   // EIGEN3(double): MATRIX MULTIPLY
   times_ms.clear();
-  for (int i = 0; i < num_trials; i++) {
+  for (int i = 0; i < num_samples; i++) {
     Eigen::MatrixXd mat1 = Eigen::MatrixXd::Random(big_matrix_eigen1, big_matrix_eigen1);
     Eigen::MatrixXd mat2 = Eigen::MatrixXd::Random(big_matrix_eigen1, big_matrix_eigen1);
     auto rT1 = boost::posix_time::microsec_clock::local_time();
@@ -199,7 +406,7 @@ int main(int argc, char **argv) {
 
   // EIGEN3(double): MATRIX INVERSION
   times_ms.clear();
-  for (int i = 0; i < num_trials; i++) {
+  for (int i = 0; i < num_samples; i++) {
     Eigen::MatrixXd mat1 = Eigen::MatrixXd::Random(big_matrix_eigen1, big_matrix_eigen1);
     auto rT1 = boost::posix_time::microsec_clock::local_time();
     mat1 = mat1.inverse();
@@ -210,7 +417,7 @@ int main(int argc, char **argv) {
 
   // EIGEN3(double): HOUSEHOLDER QR FULL
   times_ms.clear();
-  for (int i = 0; i < num_trials; i++) {
+  for (int i = 0; i < num_samples; i++) {
     Eigen::MatrixXd mat1 = Eigen::MatrixXd::Random(big_matrix_eigen2, big_matrix_eigen1);
     auto rT1 = boost::posix_time::microsec_clock::local_time();
     Eigen::MatrixXd QR = mat1.householderQr().matrixQR();
@@ -221,7 +428,7 @@ int main(int argc, char **argv) {
 
   // EIGEN3(double): HOUSEHOLDER QR PIV
   times_ms.clear();
-  for (int i = 0; i < num_trials; i++) {
+  for (int i = 0; i < num_samples; i++) {
     Eigen::MatrixXd mat1 = Eigen::MatrixXd::Random(big_matrix_eigen2, big_matrix_eigen1);
     auto rT1 = boost::posix_time::microsec_clock::local_time();
     Eigen::MatrixXd R = mat1.colPivHouseholderQr().matrixR();
@@ -232,7 +439,7 @@ int main(int argc, char **argv) {
 
   // EIGEN3(double): HOUSEHOLDER QR CUSTOM
   times_ms.clear();
-  for (int i = 0; i < num_trials; i++) {
+  for (int i = 0; i < num_samples; i++) {
     Eigen::MatrixXd mat1 = Eigen::MatrixXd::Random(big_matrix_eigen2, big_matrix_eigen1);
     Eigen::VectorXd tempV1 = Eigen::VectorXd::Zero(big_matrix_eigen2 * big_matrix_eigen1, 1);
     Eigen::VectorXd tempV2;
@@ -254,7 +461,7 @@ int main(int argc, char **argv) {
 
   // EIGEN3(float): RANDOM BIG MATRIX
   times_ms.clear();
-  for (int i = 0; i < num_trials; i++) {
+  for (int i = 0; i < num_samples; i++) {
     auto rT1 = boost::posix_time::microsec_clock::local_time();
     Eigen::MatrixXf mat1 = Eigen::MatrixXf::Random(big_matrix_eigen1, big_matrix_eigen1);
     Eigen::MatrixXf mat2 = Eigen::MatrixXf::Random(big_matrix_eigen1, big_matrix_eigen1);
@@ -265,7 +472,7 @@ int main(int argc, char **argv) {
 
   // EIGEN3(float): MATRIX MULTIPLY
   times_ms.clear();
-  for (int i = 0; i < num_trials; i++) {
+  for (int i = 0; i < num_samples; i++) {
     Eigen::MatrixXf mat1 = Eigen::MatrixXf::Random(big_matrix_eigen1, big_matrix_eigen1);
     Eigen::MatrixXf mat2 = Eigen::MatrixXf::Random(big_matrix_eigen1, big_matrix_eigen1);
     auto rT1 = boost::posix_time::microsec_clock::local_time();
@@ -277,7 +484,7 @@ int main(int argc, char **argv) {
 
   // EIGEN3(float): MATRIX INVERSION
   times_ms.clear();
-  for (int i = 0; i < num_trials; i++) {
+  for (int i = 0; i < num_samples; i++) {
     Eigen::MatrixXf mat1 = Eigen::MatrixXf::Random(big_matrix_eigen1, big_matrix_eigen1);
     auto rT1 = boost::posix_time::microsec_clock::local_time();
     mat1 = mat1.inverse();
@@ -289,7 +496,7 @@ int main(int argc, char **argv) {
   // EIGEN3(float): HOUSEHOLDER QR FULL
   times_ms.clear();
   Eigen::MatrixXf mat1 = Eigen::MatrixXf::Random(big_matrix_eigen2, big_matrix_eigen1);
-  for (int i = 0; i < num_trials; i++) {
+  for (int i = 0; i < num_samples; i++) {
     auto rT1 = boost::posix_time::microsec_clock::local_time();
     Eigen::MatrixXf Q = mat1.householderQr().householderQ();
     Eigen::MatrixXf R = Q.transpose() * mat1;
@@ -300,7 +507,7 @@ int main(int argc, char **argv) {
 
   // EIGEN3(float): HOUSEHOLDER QR PIV
   times_ms.clear();
-  for (int i = 0; i < num_trials; i++) {
+  for (int i = 0; i < num_samples; i++) {
     Eigen::MatrixXf mat1 = Eigen::MatrixXf::Random(big_matrix_eigen2, big_matrix_eigen1);
     auto rT1 = boost::posix_time::microsec_clock::local_time();
     Eigen::MatrixXf R = mat1.colPivHouseholderQr().matrixR().triangularView<Eigen::Upper>();
@@ -311,7 +518,7 @@ int main(int argc, char **argv) {
 
   // EIGEN3(float): HOUSEHOLDER QR CUSTOM
   times_ms.clear();
-  for (int i = 0; i < num_trials; i++) {
+  for (int i = 0; i < num_samples; i++) {
     Eigen::MatrixXf mat1 = Eigen::MatrixXf::Random(big_matrix_eigen2, big_matrix_eigen1);
     Eigen::VectorXf tempV1 = Eigen::VectorXf::Zero(big_matrix_eigen2 * big_matrix_eigen1, 1);
     Eigen::VectorXf tempV2;
@@ -327,6 +534,72 @@ int main(int argc, char **argv) {
   }
   print_stats("EIGEN3(float): HOUSEHOLDER QR CUSTOM", times_ms);
 
+  //=====================================================================================
+  //=====================================================================================
+  //=====================================================================================
+
+  // TRACKING: KLT FEED NEW CAMERA
+  // A sliding crop of a large blurred noise image gives repeatable frame-to-frame motion,
+  // so the tracker has real temporal correspondences to work on (pure noise is untrackable)
+  times_ms.clear();
+  cv::Mat scene(1200, 1600, CV_8UC1);
+  cv::randu(scene, cv::Scalar(0), cv::Scalar(255));
+  cv::GaussianBlur(scene, scene, cv::Size(5, 5), 2.0);
+  Eigen::Matrix<double, 8, 1> cam_calib;
+  cam_calib << 458.654, 457.296, 367.215, 248.375, -0.28, 0.07, 0.0002, 0.00002;
+  auto camera = std::make_shared<ov_core::CamRadtan>(752, 480);
+  camera->set_value(cam_calib);
+  std::unordered_map<size_t, std::shared_ptr<ov_core::CamBase>> cameras;
+  cameras.insert({0, camera});
+  ov_core::TrackKLT tracker(cameras, max_features, 0, false, ov_core::TrackBase::HistogramMethod::NONE, fast_threshold, 5, 5, 10);
+  ov_core::Tracer::set_enabled(true);
+  for (int i = 0; i < num_samples; i++) {
+    ov_core::CameraData message;
+    message.timestamp = 0.05 * i;
+    message.sensor_ids.push_back(0);
+    message.images.push_back(scene(cv::Rect(2 * (i % 400), i % 700, 752, 480)).clone());
+    message.masks.push_back(cv::Mat::zeros(cv::Size(752, 480), CV_8UC1));
+    auto rT1 = boost::posix_time::microsec_clock::local_time();
+    tracker.feed_new_camera(message);
+    auto rT2 = boost::posix_time::microsec_clock::local_time();
+    ov_core::Tracer::frame(message.timestamp);
+    times_ms.push_back((rT2 - rT1).total_microseconds() * 1e-3);
+  }
+  ov_core::Tracer::set_enabled(false);
+  print_stats("TRACKING: KLT FEED NEW CAMERA", times_ms);
+
+  // TRACKING: PER-STAGE BREAKDOWN
+  // The tracker's TraceSpan instrumentation gives the pyramid / detection / matching split,
+  // dumped in the record_timing_information file format and folded back into our statistics
+  // (the dump is also kept on disk so it can be fed to the ov_eval timing tools)
+  std::string path_stages = path_out.empty() ? "/tmp/ov_core_test_profile_stages.txt" : path_out + ".stages";
+  ov_core::Tracer::dump_flamegraph(path_stages);
+  ov_core::Tracer::clear();
+  std::ifstream file_stages(path_stages);
+  std::string line_stages;
+  if (file_stages.is_open() && std::getline(file_stages, line_stages)) {
+    std::vector<std::string> stage_names;
+    std::stringstream ss_header(line_stages.substr(std::string("# timestamp (sec),").size()));
+    std::string token;
+    while (std::getline(ss_header, token, ','))
+      stage_names.push_back(token);
+    std::vector<std::vector<double>> stage_times(stage_names.size());
+    while (std::getline(file_stages, line_stages)) {
+      std::stringstream ss_row(line_stages);
+      std::getline(ss_row, token, ','); // timestamp
+      for (size_t c = 0; c < stage_names.size() && std::getline(ss_row, token, ','); c++)
+        stage_times.at(c).push_back(1e3 * std::atof(token.c_str()));
+    }
+    for (size_t c = 0; c < stage_names.size(); c++) {
+      if (!stage_times.at(c).empty())
+        print_stats("TRACKING: STAGE " + stage_names.at(c), stage_times.at(c));
+    }
+  }
+
+  // Save our results if the user asked for them
+  if (!path_out.empty())
+    save_results(path_out);
+
   // Done!
   return EXIT_SUCCESS;
 }
@@ -23,6 +23,7 @@
 #define OV_CORE_GRIDER_FAST_H
 
 #include <Eigen/Eigen>
+#include <algorithm>
 #include <functional>
 #include <iostream>
 #include <vector>
@@ -31,7 +32,7 @@
 #include <opencv2/imgproc/imgproc.hpp>
 #include <opencv2/opencv.hpp>
 
-#include "utils/opencv_lambda_body.h"
+#include "utils/thread_pool.h"
 
 namespace ov_core {
 
@@ -42,6 +43,10 @@ namespace ov_core {
  * we want to have as uniform of extractions as possible over the image plane.
  * Thus we split the image into a bunch of small grids, and extract points in each.
  * We then pick enough top points in each grid so that we have the total number of desired points.
+ *
+ * The grider is stateful: each cell keeps its own FAST threshold which is adapted across
+ * frames (raised where the cell over-detects, lowered where it is starved), so an instance
+ * should be kept per camera and reused for every frame of that camera.
  */
 class Grider_FAST {
 
@@ -64,14 +69,16 @@ public:
    * @param num_features max number of features we want to extract
    * @param grid_x size of grid in the x-direction / u-direction
    * @param grid_y size of grid in the y-direction / v-direction
-   * @param threshold FAST threshold paramter (10 is a good value normally)
+   * @param threshold nominal FAST threshold paramter (10 is a good value normally)
    * @param nonmaxSuppression if FAST should perform non-max suppression (true normally)
    *
    * Given a specified grid size, this will try to extract fast features from each grid.
    * It will then return the best from each grid in the return vector.
+   * The passed threshold only anchors the per-cell thresholds, which drift from it as
+   * each cell adapts to its local image content (see the class description).
    */
-  static void perform_griding(const cv::Mat &img, const cv::Mat &mask, std::vector<cv::KeyPoint> &pts, int num_features, int grid_x,
-                              int grid_y, int threshold, bool nonmaxSuppression) {
+  void perform_griding(const cv::Mat &img, const cv::Mat &mask, std::vector<cv::KeyPoint> &pts, int num_features, int grid_x, int grid_y,
+                       int threshold, bool nonmaxSuppression) {
 
     // We want to have equally distributed features
     // NOTE: If we have more grids than number of total points, we calc the biggest grid we can do
@@ -101,48 +108,75 @@ public:
     int ct_cols = std::floor(img.cols / size_x);
     int ct_rows = std::floor(img.rows / size_y);
     std::vector<std::vector<cv::KeyPoint>> collection(ct_cols * ct_rows);
-    parallel_for_(cv::Range(0, ct_cols * ct_rows), LambdaBody([&](const cv::Range &range) {
-                    for (int r = range.start; r < range.end; r++) {
-                      // Calculate what cell xy value we are in
-                      int x = r % ct_cols * size_x;
-                      int y = r / ct_cols * size_y;
-
-                      // Skip if we are out of bounds
-                      if (x + size_x > img.cols || y + size_y > img.rows)
-                        continue;
-
-                      // Calculate where we should be extracting from
-                      cv::Rect img_roi = cv::Rect(x, y, size_x, size_y);
-
-                      // Extract FAST features for this part of the image
-                      std::vector<cv::KeyPoint> pts_new;
-                      cv::FAST(img(img_roi), pts_new, threshold, nonmaxSuppression);
-
-                      // Now lets get the top number from this
-                      std::sort(pts_new.begin(), pts_new.end(), Grider_FAST::compare_response);
-
-                      // Append the "best" ones to our vector
-                      // Note that we need to "correct" the point u,v since we extracted it in a ROI
-                      // So we should append the location of that ROI in the image
-                      for (size_t i = 0; i < (size_t)num_features_grid && i < pts_new.size(); i++) {
-
-                        // Create keypoint
-                        cv::KeyPoint pt_cor = pts_new.at(i);
-                        pt_cor.pt.x += (float)x;
-                        pt_cor.pt.y += (float)y;
-
-                        // Reject if out of bounds (shouldn't be possible...)
-                        if ((int)pt_cor.pt.x < 0 || (int)pt_cor.pt.x > img.cols || (int)pt_cor.pt.y < 0 || (int)pt_cor.pt.y > img.rows)
-                          continue;
-
-                        // Check if it is in the mask region
-                        // NOTE: mask has max value of 255 (white) if it should be removed
-                        if (mask.at<uint8_t>((int)pt_cor.pt.y, (int)pt_cor.pt.x) > 127)
-                          continue;
-                        collection.at(r).push_back(pt_cor);
-                      }
-                    }
-                  }));
+
+    // (Re)seed the per-cell thresholds if the grid geometry changed, otherwise carry the
+    // learned values over (shifted if the caller moved the nominal threshold in between)
+    int threshold_min = std::max(3, threshold / 4);
+    int threshold_max = 4 * threshold;
+    if ((int)cell_thresholds.size() != ct_cols * ct_rows) {
+      cell_thresholds.assign(ct_cols * ct_rows, threshold);
+    } else if (threshold != threshold_nominal) {
+      for (auto &cell : cell_thresholds)
+        cell = std::max(threshold_min, std::min(threshold_max, cell + (threshold - threshold_nominal)));
+    }
+    threshold_nominal = threshold;
+
+    ThreadPool::instance().parallel_for(0, ct_cols * ct_rows, [&](int r) {
+      // Calculate what cell xy value we are in
+      int x = r % ct_cols * size_x;
+      int y = r / ct_cols * size_y;
+
+      // Skip if we are out of bounds
+      if (x + size_x > img.cols || y + size_y > img.rows)
+        return;
+
+      // Calculate where we should be extracting from
+      cv::Rect img_roi = cv::Rect(x, y, size_x, size_y);
+
+      // Extract FAST features for this part of the image
+      // Each worker only touches its own cell threshold, so no locking is needed
+      std::vector<cv::KeyPoint> pts_new;
+      int &cell_threshold = cell_thresholds.at(r);
+      cv::FAST(img(img_roi), pts_new, cell_threshold, nonmaxSuppression);
+
+      // Adapt the threshold for the next frame: bright textured cells that massively
+      // over-detect get raised (we throw away almost everything anyway), while starved
+      // cells (e.g. dark tunnel walls) get lowered until they produce corners again
+      if (pts_new.size() > (size_t)(4 * num_features_grid)) {
+        cell_threshold = std::min(threshold_max, cell_threshold + std::max(1, cell_threshold / 4));
+      } else if (pts_new.size() < (size_t)num_features_grid) {
+        cell_threshold = std::max(threshold_min, cell_threshold - std::max(1, cell_threshold / 4));
+      }
+
+      // Now lets get the top number from this
+      // Only the best num_features_grid survive, so select them instead of sorting everything
+      if (pts_new.size() > (size_t)num_features_grid) {
+        std::nth_element(pts_new.begin(), pts_new.begin() + num_features_grid, pts_new.end(), Grider_FAST::compare_response);
+        pts_new.resize(num_features_grid);
+      }
+      std::sort(pts_new.begin(), pts_new.end(), Grider_FAST::compare_response);
+
+      // Append the "best" ones to our vector
+      // Note that we need to "correct" the point u,v since we extracted it in a ROI
+      // So we should append the location of that ROI in the image
+      for (size_t i = 0; i < (size_t)num_features_grid && i < pts_new.size(); i++) {
+
+        // Create keypoint
+        cv::KeyPoint pt_cor = pts_new.at(i);
+        pt_cor.pt.x += (float)x;
+        pt_cor.pt.y += (float)y;
+
+        // Reject if out of bounds (shouldn't be possible...)
+        if ((int)pt_cor.pt.x < 0 || (int)pt_cor.pt.x > img.cols || (int)pt_cor.pt.y < 0 || (int)pt_cor.pt.y > img.rows)
+          continue;
+
+        // Check if it is in the mask region
+        // NOTE: mask has max value of 255 (white) if it should be removed
+        if (mask.at<uint8_t>((int)pt_cor.pt.y, (int)pt_cor.pt.x) > 127)
+          continue;
+        collection.at(r).push_back(pt_cor);
+      }
+    });
 
     // Combine all the collections into our single vector
     for (size_t r = 0; r < collection.size(); r++) {
@@ -172,6 +206,13 @@ public:
       pts.at(i).pt = pts_refined.at(i);
     }
   }
+
+private:
+  /// Current FAST threshold of each grid cell (persisted across frames, row-major)
+  std::vector<int> cell_thresholds;
+
+  /// Nominal threshold the current cell values are anchored to
+  int threshold_nominal = -1;
 };
 
 } // namespace ov_core
@@ -23,6 +23,8 @@
 #define OV_CORE_GRIDER_GRID_H
 
 #include <Eigen/Eigen>
+#include <algorithm>
+#include <atomic>
 #include <functional>
 #include <iostream>
 #include <vector>
@@ -31,7 +33,7 @@
 #include <opencv2/imgproc/imgproc.hpp>
 #include <opencv2/opencv.hpp>
 
-#include "utils/opencv_lambda_body.h"
+#include "utils/thread_pool.h"
 
 namespace ov_core {
 
@@ -60,23 +62,30 @@ public:
    * @brief This function will perform grid extraction using FAST.
    * @param img Image we will do FAST extraction on
    * @param mask Region of the image we do not want to extract features in (255 = do not detect features)
-   * @param valid_locs Valid 2d grid locations we will extract in (instead of the whole image)
+   * @param valid_cells Per-cell extraction mask, row-major (x + y * grid_x), true for cells we should extract in
    * @param pts vector of extracted points we will return
    * @param num_features max number of features we want to extract
    * @param grid_x size of grid in the x-direction / u-direction
    * @param grid_y size of grid in the y-direction / v-direction
    * @param threshold FAST threshold paramter (10 is a good value normally)
    * @param nonmaxSuppression if FAST should perform non-max suppression (true normally)
+   * @param cell_counts optional per-cell output, set to the number of points a cell contributed
+   *        (cells that were not extracted, e.g. skipped by the budget shortcut, stay untouched)
    *
    * Given a specified grid size, this will try to extract fast features from each grid.
    * It will then return the best from each grid in the return vector.
+   * The cell mask is a packed bitset the caller can own and reuse frame to frame instead
+   * of rebuilding a location vector, and extraction stops early once num_features is met.
    */
-  static void perform_griding(const cv::Mat &img, const cv::Mat &mask, const std::vector<std::pair<int, int>> &valid_locs,
+  static void perform_griding(const cv::Mat &img, const cv::Mat &mask, const std::vector<bool> &valid_cells,
                               std::vector<cv::KeyPoint> &pts, int num_features, int grid_x, int grid_y, int threshold,
-                              bool nonmaxSuppression) {
+                              bool nonmaxSuppression, std::vector<int> *cell_counts = nullptr) {
+
+    // The mask should cover every cell of the grid we were given
+    assert((int)valid_cells.size() == grid_x * grid_y);
 
     // Return if there is nothing to extract
-    if (valid_locs.empty())
+    if (std::find(valid_cells.begin(), valid_cells.end(), true) == valid_cells.end())
       return;
 
     // We want to have equally distributed features
@@ -85,70 +94,84 @@ public:
     // NOTE:    -> 1 = num_features / (grid_x * grid_y)
     // NOTE:    -> grid_x = ratio * grid_y (keep the original grid ratio)
     // NOTE:    -> grid_y = sqrt(num_features / ratio)
+    // NOTE: the cell mask stays indexed by the caller's grid, only the box sizes shrink
+    int grid_x_adj = grid_x;
+    int grid_y_adj = grid_y;
     if (num_features < grid_x * grid_y) {
       double ratio = (double)grid_x / (double)grid_y;
-      grid_y = std::ceil(std::sqrt(num_features / ratio));
-      grid_x = std::ceil(grid_y * ratio);
+      grid_y_adj = std::ceil(std::sqrt(num_features / ratio));
+      grid_x_adj = std::ceil(grid_y_adj * ratio);
     }
-    int num_features_grid = (int)((double)num_features / (double)(grid_x * grid_y)) + 1;
-    assert(grid_x > 0);
-    assert(grid_y > 0);
+    int num_features_grid = (int)((double)num_features / (double)(grid_x_adj * grid_y_adj)) + 1;
+    assert(grid_x_adj > 0);
+    assert(grid_y_adj > 0);
     assert(num_features_grid > 0);
 
     // Calculate the size our extraction boxes should be
-    int size_x = img.cols / grid_x;
-    int size_y = img.rows / grid_y;
+    int size_x = img.cols / grid_x_adj;
+    int size_y = img.rows / grid_y_adj;
 
     // Make sure our sizes are not zero
     assert(size_x > 0);
     assert(size_y > 0);
 
     // Parallelize our 2d grid extraction!!
-    std::vector<std::vector<cv::KeyPoint>> collection(valid_locs.size());
-    parallel_for_(cv::Range(0, (int)valid_locs.size()), LambdaBody([&](const cv::Range &range) {
-                    for (int r = range.start; r < range.end; r++) {
-
-                      // Calculate what cell xy value we are in
-                      auto grid = valid_locs.at(r);
-                      int x = grid.first * size_x;
-                      int y = grid.second * size_y;
-
-                      // Skip if we are out of bounds
-                      if (x + size_x > img.cols || y + size_y > img.rows)
-                        continue;
-
-                      // Calculate where we should be extracting from
-                      cv::Rect img_roi = cv::Rect(x, y, size_x, size_y);
-
-                      // Extract FAST features for this part of the image
-                      std::vector<cv::KeyPoint> pts_new;
-                      cv::FAST(img(img_roi), pts_new, threshold, nonmaxSuppression);
-
-                      // Now lets get the top number from this
-                      std::sort(pts_new.begin(), pts_new.end(), Grider_FAST::compare_response);
-
-                      // Append the "best" ones to our vector
-                      // Note that we need to "correct" the point u,v since we extracted it in a ROI
-                      // So we should append the location of that ROI in the image
-                      for (size_t i = 0; i < (size_t)num_features_grid && i < pts_new.size(); i++) {
-
-                        // Create keypoint
-                        cv::KeyPoint pt_cor = pts_new.at(i);
-                        pt_cor.pt.x += (float)x;
-                        pt_cor.pt.y += (float)y;
-
-                        // Reject if out of bounds (shouldn't be possible...)
-                        if ((int)pt_cor.pt.x < 0 || (int)pt_cor.pt.x > img.cols || (int)pt_cor.pt.y < 0 || (int)pt_cor.pt.y > img.rows)
-                          continue;
-
-                        // Check if it is in the mask region
-                        // NOTE: mask has max value of 255 (white) if it should be removed
-                        if (mask.at<uint8_t>((int)pt_cor.pt.y, (int)pt_cor.pt.x) > 127)
-                          continue;
-                        collection.at(r).push_back(pt_cor);
-                      }
-                    }
-                  }));
+    // Workers bail out as soon as the already-extracted cells cover our feature budget
+    std::atomic<int> num_collected(0);
+    std::vector<std::vector<cv::KeyPoint>> collection(valid_cells.size());
+    ThreadPool::instance().parallel_for(0, (int)valid_cells.size(), [&](int r) {
+      // Skip cells the caller does not want us to extract in
+      if (!valid_cells.at(r))
+        return;
+
+      // Stop doing work once we have enough candidate extractions
+      // NOTE: which cells get skipped depends on thread interleaving, so the shortcut
+      // NOTE: is disabled in deterministic mode where every requested cell is extracted
+      if (!ThreadPool::instance().deterministic() && num_collected.load(std::memory_order_relaxed) >= num_features)
+        return;
+
+      // Calculate what cell xy value we are in
+      int x = r % grid_x * size_x;
+      int y = r / grid_x * size_y;
+
+      // Skip if we are out of bounds
+      if (x + size_x > img.cols || y + size_y > img.rows)
+        return;
+
+      // Calculate where we should be extracting from
+      cv::Rect img_roi = cv::Rect(x, y, size_x, size_y);
+
+      // Extract FAST features for this part of the image
+      std::vector<cv::KeyPoint> pts_new;
+      cv::FAST(img(img_roi), pts_new, threshold, nonmaxSuppression);
+
+      // Now lets get the top number from this
+      std::sort(pts_new.begin(), pts_new.end(), Grider_FAST::compare_response);
+
+      // Append the "best" ones to our vector
+      // Note that we need to "correct" the point u,v since we extracted it in a ROI
+      // So we should append the location of that ROI in the image
+      for (size_t i = 0; i < (size_t)num_features_grid && i < pts_new.size(); i++) {
+
+        // Create keypoint
+        cv::KeyPoint pt_cor = pts_new.at(i);
+        pt_cor.pt.x += (float)x;
+        pt_cor.pt.y += (float)y;
+
+        // Reject if out of bounds (shouldn't be possible...)
+        if ((int)pt_cor.pt.x < 0 || (int)pt_cor.pt.x > img.cols || (int)pt_cor.pt.y < 0 || (int)pt_cor.pt.y > img.rows)
+          continue;
+
+        // Check if it is in the mask region
+        // NOTE: mask has max value of 255 (white) if it should be removed
+        if (mask.at<uint8_t>((int)pt_cor.pt.y, (int)pt_cor.pt.x) > 127)
+          continue;
+        collection.at(r).push_back(pt_cor);
+      }
+      if (cell_counts != nullptr)
+        cell_counts->at(r) = (int)collection.at(r).size();
+      num_collected.fetch_add((int)collection.at(r).size(), std::memory_order_relaxed);
+    });
 
     // Combine all the collections into our single vector
     for (size_t r = 0; r < collection.size(); r++) {
@@ -21,14 +21,21 @@
 
 #include "TrackAruco.h"
 
+#include <algorithm>
+#include <cmath>
+
 #include "cam/CamBase.h"
 #include "feat/Feature.h"
 #include "feat/FeatureDatabase.h"
-#include "utils/opencv_lambda_body.h"
+#include "utils/thread_pool.h"
+#include "utils/tracer.h"
 
 using namespace ov_core;
 
-void TrackAruco::feed_new_camera(const CameraData &message) {
+void TrackAruco::feed_new_camera(const CameraData &message_in) {
+
+  // Run any registered platform preprocessing stages first (e.g. ISP resize/rectify offload)
+  const CameraData &message = apply_preprocess_stages(message_in);
 
   // Error check that we have all the data
   if (message.sensor_ids.empty() || message.sensor_ids.size() != message.images.size() || message.images.size() != message.masks.size()) {
@@ -43,11 +50,17 @@ void TrackAruco::feed_new_camera(const CameraData &message) {
   // Thus here we should just call the monocular version two times
 #if ENABLE_ARUCO_TAGS
   size_t num_images = message.images.size();
-  parallel_for_(cv::Range(0, (int)num_images), LambdaBody([&](const cv::Range &range) {
-                  for (int i = range.start; i < range.end; i++) {
-                    perform_tracking(message.timestamp, message.images.at(i), message.sensor_ids.at(i), message.masks.at(i));
-                  }
-                }));
+  ThreadPool::instance().parallel_for(
+      0, (int)num_images, [&](int i) { perform_tracking(message.timestamp, message.images.at(i), message.sensor_ids.at(i), message.masks.at(i)); });
+
+  // With equalization disabled perform_tracking() stored the raw image as img_last, which
+  // for a zero-copy producer aliases the middleware message, so retain its lifetime handles
+  {
+    std::lock_guard<std::mutex> lckv(mtx_last_vars);
+    for (size_t i = 0; i < num_images; i++) {
+      img_owners_last[message.sensor_ids.at(i)] = message.owners;
+    }
+  }
 #else
   PRINT_ERROR(RED "[ERROR]: you have not compiled with aruco tag support!!!\n" RESET);
   std::exit(EXIT_FAILURE);
@@ -59,7 +72,8 @@ void TrackAruco::feed_new_camera(const CameraData &message) {
 void TrackAruco::perform_tracking(double timestamp, const cv::Mat &imgin, size_t cam_id, const cv::Mat &maskin) {
 
   // Start timing
-  rT1 = boost::posix_time::microsec_clock::local_time();
+  TraceSpan span_total("aruco total");
+  TraceSpan span_detect("aruco detection");
 
   // Lock this data feed for this camera
   std::lock_guard<std::mutex> lck(mtx_feeds.at(cam_id));
@@ -83,41 +97,111 @@ void TrackAruco::perform_tracking(double timestamp, const cv::Mat &imgin, size_t
   rejects[cam_id].clear();
 
   // If we are downsizing, then downsize
+  // In this case the detection is only a coarse first stage at quarter resolution,
+  // located markers are refined at full resolution below
   cv::Mat img0;
+  int downsize_factor = 1;
   if (do_downsizing) {
-    cv::pyrDown(img, img0, cv::Size(img.cols / 2, img.rows / 2));
-  } else {
-    img0 = img;
+    cv::Mat img_half;
+    cv::pyrDown(img, img_half, cv::Size(img.cols / 2, img.rows / 2));
+    cv::pyrDown(img_half, img0, cv::Size(img_half.cols / 2, img_half.rows / 2));
+    downsize_factor = 4;
   }
 
   //===================================================================================
   //===================================================================================
 
   // Perform extraction
-  cv::aruco::detectMarkers(img0, aruco_dict, corners[cam_id], ids_aruco[cam_id], aruco_params, rejects[cam_id]);
-  rT2 = boost::posix_time::microsec_clock::local_time();
+  cv::aruco::detectMarkers(do_downsizing ? img0 : img, aruco_dict, corners[cam_id], ids_aruco[cam_id], aruco_params, rejects[cam_id]);
+  span_detect.stop();
+  TraceSpan span_database("aruco database");
 
   //===================================================================================
   //===================================================================================
 
-  // If we downsized, scale all our u,v measurements by a factor of two
+  // If we downsized, scale all our u,v measurements back to the full image
   // Note: we do this so we can use these results for visulization later
   // Note: and so that the uv added is in the same image size
   if (do_downsizing) {
     for (size_t i = 0; i < corners[cam_id].size(); i++) {
       for (size_t j = 0; j < corners[cam_id].at(i).size(); j++) {
-        corners[cam_id].at(i).at(j).x *= 2;
-        corners[cam_id].at(i).at(j).y *= 2;
+        corners[cam_id].at(i).at(j).x *= (float)downsize_factor;
+        corners[cam_id].at(i).at(j).y *= (float)downsize_factor;
       }
     }
     for (size_t i = 0; i < rejects[cam_id].size(); i++) {
       for (size_t j = 0; j < rejects[cam_id].at(i).size(); j++) {
-        rejects[cam_id].at(i).at(j).x *= 2;
-        rejects[cam_id].at(i).at(j).y *= 2;
+        rejects[cam_id].at(i).at(j).x *= (float)downsize_factor;
+        rejects[cam_id].at(i).at(j).y *= (float)downsize_factor;
       }
     }
   }
 
+  // Recover markers the coarse pass missed: for each marker we saw last frame that was
+  // not re-detected, re-run detection at full resolution only inside its predicted ROI
+  // (which is tiny compared to the whole image, so this is still cheap)
+  if (do_downsizing) {
+    for (const auto &roi_pair : marker_rois[cam_id]) {
+      int marker_id = roi_pair.first;
+      if (std::find(ids_aruco[cam_id].begin(), ids_aruco[cam_id].end(), marker_id) != ids_aruco[cam_id].end())
+        continue;
+      cv::Rect roi = roi_pair.second & cv::Rect(0, 0, img.cols, img.rows);
+      if (roi.width < 40 || roi.height < 40)
+        continue;
+      std::vector<int> ids_roi;
+      std::vector<std::vector<cv::Point2f>> corners_roi, rejects_roi;
+      cv::aruco::detectMarkers(img(roi), aruco_dict, corners_roi, ids_roi, aruco_params, rejects_roi);
+      for (size_t i = 0; i < ids_roi.size(); i++) {
+        if (ids_roi.at(i) != marker_id)
+          continue;
+        for (auto &pt : corners_roi.at(i)) {
+          pt.x += (float)roi.x;
+          pt.y += (float)roi.y;
+        }
+        ids_aruco[cam_id].push_back(marker_id);
+        corners[cam_id].push_back(corners_roi.at(i));
+      }
+    }
+  }
+
+  // Second stage: subpixel refinement of all detected corners at full resolution
+  // The coarse detection only locates the quads, this recovers the corner accuracy
+  // that was lost to the downsizing
+  if (do_downsizing && !corners[cam_id].empty()) {
+    std::vector<cv::Point2f> pts_refine;
+    std::vector<std::pair<size_t, size_t>> pts_lookup;
+    int margin = 6;
+    for (size_t i = 0; i < corners[cam_id].size(); i++) {
+      for (size_t j = 0; j < corners[cam_id].at(i).size(); j++) {
+        cv::Point2f pt = corners[cam_id].at(i).at(j);
+        if (pt.x < (float)margin || pt.x >= (float)(img.cols - margin) || pt.y < (float)margin || pt.y >= (float)(img.rows - margin))
+          continue;
+        pts_refine.push_back(pt);
+        pts_lookup.emplace_back(i, j);
+      }
+    }
+    if (!pts_refine.empty()) {
+      cv::TermCriteria term_crit = cv::TermCriteria(cv::TermCriteria::COUNT + cv::TermCriteria::EPS, 20, 0.001);
+      cv::cornerSubPix(img, pts_refine, cv::Size(5, 5), cv::Size(-1, -1), term_crit);
+      for (size_t n = 0; n < pts_refine.size(); n++) {
+        corners[cam_id].at(pts_lookup.at(n).first).at(pts_lookup.at(n).second) = pts_refine.at(n);
+      }
+    }
+  }
+
+  // Remember where each marker ended up so the next frame can predict its region
+  // We inflate the bounding box by half its size, which bounds the inter-frame motion
+  {
+    auto &rois = marker_rois[cam_id];
+    rois.clear();
+    for (size_t i = 0; i < ids_aruco[cam_id].size(); i++) {
+      cv::Rect bb = cv::boundingRect(corners[cam_id].at(i));
+      int pad_x = bb.width / 2 + 20;
+      int pad_y = bb.height / 2 + 20;
+      rois[ids_aruco[cam_id].at(i)] = cv::Rect(bb.x - pad_x, bb.y - pad_y, bb.width + 2 * pad_x, bb.height + 2 * pad_y);
+    }
+  }
+
   //===================================================================================
   //===================================================================================
 
@@ -126,6 +210,8 @@ void TrackAruco::perform_tracking(double timestamp, const cv::Mat &imgin, size_t
   std::vector<cv::KeyPoint> pts_new;
 
   // Append to our feature database this new information
+  // Note we look the camera up once and reuse it, instead of a map lookup per corner
+  std::shared_ptr<CamBase> camera = camera_calib.at(cam_id);
   for (size_t i = 0; i < ids_aruco[cam_id].size(); i++) {
     // Skip if ID is greater then our max
     if (ids_aruco[cam_id].at(i) > max_tag_id)
@@ -133,12 +219,17 @@ void TrackAruco::perform_tracking(double timestamp, const cv::Mat &imgin, size_t
     // Assert we have 4 points (we will only use one of them)
     assert(corners[cam_id].at(i).size() == 4);
     for (int n = 0; n < 4; n++) {
+      // Check that the (possibly scaled-up) corner is inside the full resolution image
+      int cx = (int)corners[cam_id].at(i).at(n).x;
+      int cy = (int)corners[cam_id].at(i).at(n).y;
+      if (cx < 0 || cx >= img.cols || cy < 0 || cy >= img.rows)
+        continue;
       // Check if it is in the mask
       // NOTE: mask has max value of 255 (white) if it should be
-      if (maskin.at<uint8_t>((int)corners[cam_id].at(i).at(n).y, (int)corners[cam_id].at(i).at(n).x) > 127)
+      if (maskin.at<uint8_t>(cy, cx) > 127)
         continue;
       // Try to undistort the point
-      cv::Point2f npt_l = camera_calib.at(cam_id)->undistort_cv(corners[cam_id].at(i).at(n));
+      cv::Point2f npt_l = camera->undistort_cv(corners[cam_id].at(i).at(n));
       // Append to the ids vector and database
       size_t tmp_id = (size_t)ids_aruco[cam_id].at(i) + n * max_tag_id;
       database->update_feature(tmp_id, timestamp, cam_id, corners[cam_id].at(i).at(n).x, corners[cam_id].at(i).at(n).y, npt_l.x, npt_l.y);
@@ -158,13 +249,13 @@ void TrackAruco::perform_tracking(double timestamp, const cv::Mat &imgin, size_t
     ids_last[cam_id] = ids_new;
     pts_last[cam_id] = pts_new;
   }
-  rT3 = boost::posix_time::microsec_clock::local_time();
+  span_database.stop();
+  span_total.stop();
 
   // Timing information
-  PRINT_ALL("[TIME-ARUCO]: %.4f seconds for detection\n", (rT2 - rT1).total_microseconds() * 1e-6);
-  PRINT_ALL("[TIME-ARUCO]: %.4f seconds for feature DB update (%d features)\n", (rT3 - rT2).total_microseconds() * 1e-6,
-            (int)ids_new.size());
-  PRINT_ALL("[TIME-ARUCO]: %.4f seconds for total\n", (rT3 - rT1).total_microseconds() * 1e-6);
+  PRINT_ALL("[TIME-ARUCO]: %.4f seconds for detection\n", span_detect.seconds());
+  PRINT_ALL("[TIME-ARUCO]: %.4f seconds for feature DB update (%d features)\n", span_database.seconds(), (int)ids_new.size());
+  PRINT_ALL("[TIME-ARUCO]: %.4f seconds for total\n", span_total.seconds());
 }
 
 void TrackAruco::display_active(cv::Mat &img_out, int r1, int g1, int b1, int r2, int g2, int b2, std::string overlay) {
@@ -194,31 +285,56 @@ void TrackAruco::display_active(cv::Mat &img_out, int r1, int g1, int b1, int r2
   if (img_last_cache.empty() || max_width == -1 || max_height == -1)
     return;
 
+  // Operators view these images small, so render the mosaic directly at the output scale
+  double scale = display_scale;
+  int out_width = std::max(1, (int)std::round(scale * max_width));
+  int out_height = std::max(1, (int)std::round(scale * max_height));
+
   // If the image is "small" thus we shoudl use smaller display codes
-  bool is_small = (std::min(max_width, max_height) < 400);
+  bool is_small = (std::min(out_width, out_height) < 400);
 
   // If the image is "new" then draw the images from scratch
   // Otherwise, we grab the subset of the main image and draw on top of it
-  bool image_new = ((int)img_last_cache.size() * max_width != img_out.cols || max_height != img_out.rows);
+  bool image_new = ((int)img_last_cache.size() * out_width != img_out.cols || out_height != img_out.rows);
 
-  // If new, then resize the current image
-  if (image_new)
-    img_out = cv::Mat(max_height, (int)img_last_cache.size() * max_width, CV_8UC3, cv::Scalar(0, 0, 0));
+  // If new, then grab a pooled composite (a consumer may still be holding the previous one)
+  if (image_new) {
+    img_out = display_pool.checkout(out_height, (int)img_last_cache.size() * out_width, CV_8UC3);
+    img_out.setTo(cv::Scalar(0, 0, 0));
+  }
 
   // Loop through each image, and draw
   int index_cam = 0;
   for (auto const &pair : img_last_cache) {
+    // Size of this camera's cell of the mosaic at the output scale
+    int cell_width = std::min(out_width, std::max(1, (int)std::round(scale * pair.second.cols)));
+    int cell_height = std::min(out_height, std::max(1, (int)std::round(scale * pair.second.rows)));
     // select the subset of the image
     cv::Mat img_temp;
-    if (image_new)
-      cv::cvtColor(img_last_cache[pair.first], img_temp, cv::COLOR_GRAY2RGB);
-    else
-      img_temp = img_out(cv::Rect(max_width * index_cam, 0, max_width, max_height));
-    // draw...
+    if (image_new) {
+      // Convert at the output scale so we never pay for coloring the full sensor resolution
+      if (cell_width == pair.second.cols && cell_height == pair.second.rows) {
+        cv::cvtColor(pair.second, img_temp, cv::COLOR_GRAY2RGB);
+      } else {
+        cv::Mat gray_scaled;
+        cv::resize(pair.second, gray_scaled, cv::Size(cell_width, cell_height), 0, 0, cv::INTER_AREA);
+        cv::cvtColor(gray_scaled, img_temp, cv::COLOR_GRAY2RGB);
+      }
+    } else {
+      img_temp = img_out(cv::Rect(out_width * index_cam, 0, out_width, out_height));
+    }
+    // draw... (corners need to be brought to the output scale first)
+    auto scale_corners = [&](const std::vector<std::vector<cv::Point2f>> &corners_in) {
+      std::vector<std::vector<cv::Point2f>> corners_out = corners_in;
+      for (auto &marker : corners_out)
+        for (auto &corner : marker)
+          corner = corner * scale;
+      return corners_out;
+    };
     if (!ids_aruco_cache[pair.first].empty())
-      cv::aruco::drawDetectedMarkers(img_temp, corners_cache[pair.first], ids_aruco_cache[pair.first]);
+      cv::aruco::drawDetectedMarkers(img_temp, scale_corners(corners_cache[pair.first]), ids_aruco_cache[pair.first]);
     if (!rejects_cache[pair.first].empty())
-      cv::aruco::drawDetectedMarkers(img_temp, rejects_cache[pair.first], cv::noArray(), cv::Scalar(100, 0, 255));
+      cv::aruco::drawDetectedMarkers(img_temp, scale_corners(rejects_cache[pair.first]), cv::noArray(), cv::Scalar(100, 0, 255));
     // Draw what camera this is
     auto txtpt = (is_small) ? cv::Point(10, 30) : cv::Point(30, 60);
     if (overlay == "") {
@@ -227,12 +343,20 @@ void TrackAruco::display_active(cv::Mat &img_out, int r1, int g1, int b1, int r2
     } else {
       cv::putText(img_temp, overlay, txtpt, cv::FONT_HERSHEY_COMPLEX_SMALL, (is_small) ? 1.5 : 3.0, cv::Scalar(0, 0, 255), 3);
     }
-    // Overlay the mask
-    cv::Mat mask = cv::Mat::zeros(img_mask_last_cache[pair.first].rows, img_mask_last_cache[pair.first].cols, CV_8UC3);
-    mask.setTo(cv::Scalar(0, 0, 255), img_mask_last_cache[pair.first]);
-    cv::addWeighted(mask, 0.1, img_temp, 1.0, 0.0, img_temp);
-    // Replace the output image
-    img_temp.copyTo(img_out(cv::Rect(max_width * index_cam, 0, img_last_cache[pair.first].cols, img_last_cache[pair.first].rows)));
+    // Overlay the mask, resized to the cell size (see TrackBase::display_active for the masked add)
+    cv::Mat mask = img_mask_last_cache[pair.first];
+    if (!mask.empty() && (mask.cols != cell_width || mask.rows != cell_height)) {
+      cv::Mat mask_scaled;
+      cv::resize(mask, mask_scaled, cv::Size(cell_width, cell_height), 0, 0, cv::INTER_NEAREST);
+      mask = mask_scaled;
+    }
+    if (!mask.empty()) {
+      cv::Mat img_cell = img_temp(cv::Rect(0, 0, cell_width, cell_height));
+      cv::add(img_cell, cv::Scalar(0, 0, 25.5), img_cell, mask);
+    }
+    // Replace the output image (the non-new path drew directly into the composite)
+    if (image_new)
+      img_temp.copyTo(img_out(cv::Rect(out_width * index_cam, 0, cell_width, cell_height)));
     index_cam++;
   }
 }
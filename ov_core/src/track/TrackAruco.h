@@ -49,7 +49,8 @@ public:
    * @param numaruco the max id of the arucotags, we don't use any tags greater than this value even if we extract them
    * @param stereo if we should do stereo feature tracking or binocular
    * @param histmethod what type of histogram pre-processing should be done (histogram eq?)
-   * @param downsize we can scale the image by 1/2 to increase Aruco tag extraction speed
+   * @param downsize we can detect coarsely at quarter resolution (with full-resolution subpixel
+   * refinement and ROI-based recovery) to increase Aruco tag extraction speed
    */
   explicit TrackAruco(std::unordered_map<size_t, std::shared_ptr<CamBase>> cameras, int numaruco, bool stereo, HistogramMethod histmethod,
                       bool downsize)
@@ -110,6 +111,10 @@ protected:
   // Our tag IDs and corner we will get from the extractor
   std::unordered_map<size_t, std::vector<int>> ids_aruco;
   std::unordered_map<size_t, std::vector<std::vector<cv::Point2f>>> corners, rejects;
+
+  // Predicted region of each marker in the next frame (inflated bounding box of its last
+  // detection), used to recover markers that the coarse downsized pass misses
+  std::unordered_map<size_t, std::map<int, cv::Rect>> marker_rois;
 #endif
 };
 
@@ -24,6 +24,11 @@
 #include "cam/CamBase.h"
 #include "feat/Feature.h"
 #include "feat/FeatureDatabase.h"
+#include "utils/thread_pool.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
 
 using namespace ov_core;
 
@@ -31,23 +36,163 @@ TrackBase::TrackBase(std::unordered_map<size_t, std::shared_ptr<CamBase>> camera
                      HistogramMethod histmethod)
     : camera_calib(cameras), database(new FeatureDatabase()), num_features(numfeats), use_stereo(stereo), histogram_method(histmethod) {
   // Our current feature ID should be larger then the number of aruco tags we have (each has 4 corners)
-  currid = 4 * (size_t)numaruco + 1;
+  currid_start = 4 * (size_t)numaruco + 1;
+  currid = currid_start;
   // Create our mutex array based on the number of cameras we have
   // See https://stackoverflow.com/a/24170141/7718197
   if (mtx_feeds.empty() || mtx_feeds.size() != camera_calib.size()) {
     std::vector<std::mutex> list(camera_calib.size());
     mtx_feeds.swap(list);
   }
+  // Pre-insert the histogram pre-processing state for each camera
+  // This way the feed threads never insert into these maps concurrently
+  for (auto const &pair : camera_calib) {
+    img_equalize_buffers[pair.first];
+    img_equalize_index[pair.first] = 0;
+    clahe_engines[pair.first] = cv::Ptr<cv::CLAHE>();
+    grid_close_persistent[pair.first];
+    currid_cam[pair.first] = 0;
+    currid_block[pair.first] = {0, 0};
+  }
+}
+
+size_t TrackBase::next_feature_id(size_t cam_id) {
+
+  // The shared atomic counter hands out unique ids, but which id a given feature gets
+  // then depends on the interleaving of the per-camera tracking tasks
+  // Each camera reserves a whole block of ids in a single atomic bump and then hands
+  // them out locally, so parallel detection threads do not contend on every feature
+  // (the block state is guarded by the camera's feed mutex, like currid_cam below)
+  if (!ThreadPool::instance().deterministic()) {
+    std::pair<size_t, size_t> &block = currid_block.at(cam_id);
+    if (block.first >= block.second) {
+      block.first = currid.fetch_add(id_block_size) + 1;
+      block.second = block.first + id_block_size;
+    }
+    return block.first++;
+  }
+
+  // Deterministic mode: each camera draws from its own stride of the id space, so the
+  // ids a camera assigns only depend on its own (locked, and thus serial) feed history.
+  // The k'th feature of camera c gets id start + num_cams*k + c + 1, which keeps the
+  // stripes disjoint while preserving the oldest-feature-has-smallest-id ordering that
+  // the update feature selection relies on
+  size_t index = currid_cam.at(cam_id)++;
+  return currid_start + camera_calib.size() * index + cam_id + 1;
+}
+
+void TrackBase::preprocess_image(const cv::Mat &img_in, cv::Mat &img_out, size_t cam_id) {
+
+  // Passthrough does not need a buffer
+  if (histogram_method == HistogramMethod::NONE) {
+    img_out = img_in;
+    return;
+  }
+
+  // Grab the next reusable output buffer for this camera
+  // We rotate buffers since our previous output stays alive as img_last (e.g. for visualization)
+  // and the pipelined pyramid pre-computation may already be working one frame ahead
+  // The create() call is a no-op after the first frame since the resolution does not change
+  size_t &index = img_equalize_index.at(cam_id);
+  cv::Mat &buffer = img_equalize_buffers.at(cam_id).at(index);
+  index = (index + 1) % 3;
+  buffer.create(img_in.rows, img_in.cols, CV_8UC1);
+
+  // CLAHE goes through a cached engine since constructing the tile grid every frame is costly
+  if (histogram_method == HistogramMethod::CLAHE) {
+    cv::Ptr<cv::CLAHE> &clahe = clahe_engines.at(cam_id);
+    if (clahe == nullptr) {
+      double eq_clip_limit = 10.0;
+      cv::Size eq_win_size = cv::Size(8, 8);
+      clahe = cv::createCLAHE(eq_clip_limit, eq_win_size);
+    }
+    clahe->apply(img_in, buffer);
+    img_out = buffer;
+    return;
+  }
+
+  // Standard global equalization written by hand so we control memory and scheduling
+  // We accumulate four interleaved sub-histograms to break the store-to-load dependency
+  // chain, then apply the mapping unrolled so multiple table lookups stay in flight
+  // (byte gathers do not exist on SSE/NEON, so unrolling is the practical limit here)
+  assert(img_in.type() == CV_8UC1);
+  int hist[4][256] = {{0}};
+  for (int r = 0; r < img_in.rows; r++) {
+    const uint8_t *src = img_in.ptr<uint8_t>(r);
+    int c = 0;
+    for (; c + 4 <= img_in.cols; c += 4) {
+      hist[0][src[c + 0]]++;
+      hist[1][src[c + 1]]++;
+      hist[2][src[c + 2]]++;
+      hist[3][src[c + 3]]++;
+    }
+    for (; c < img_in.cols; c++)
+      hist[0][src[c]]++;
+  }
+
+  // Build the cumulative mapping table (same formulation as cv::equalizeHist)
+  int total = img_in.rows * img_in.cols;
+  int cdf = 0;
+  int cdf_min = -1;
+  uint8_t lut[256];
+  for (int i = 0; i < 256; i++) {
+    int count = hist[0][i] + hist[1][i] + hist[2][i] + hist[3][i];
+    cdf += count;
+    if (cdf_min == -1 && count != 0)
+      cdf_min = cdf;
+    if (cdf_min == -1 || total == cdf_min) {
+      lut[i] = (uint8_t)i;
+    } else {
+      // NOTE: saturate_cast on a double rounds to nearest for us
+      lut[i] = cv::saturate_cast<uint8_t>((double)(cdf - cdf_min) / (double)(total - cdf_min) * 255.0);
+    }
+  }
+
+  // Apply the mapping into our reused buffer
+  for (int r = 0; r < img_in.rows; r++) {
+    const uint8_t *src = img_in.ptr<uint8_t>(r);
+    uint8_t *dst = buffer.ptr<uint8_t>(r);
+    int c = 0;
+    for (; c + 8 <= img_in.cols; c += 8) {
+      dst[c + 0] = lut[src[c + 0]];
+      dst[c + 1] = lut[src[c + 1]];
+      dst[c + 2] = lut[src[c + 2]];
+      dst[c + 3] = lut[src[c + 3]];
+      dst[c + 4] = lut[src[c + 4]];
+      dst[c + 5] = lut[src[c + 5]];
+      dst[c + 6] = lut[src[c + 6]];
+      dst[c + 7] = lut[src[c + 7]];
+    }
+    for (; c < img_in.cols; c++)
+      dst[c] = lut[src[c]];
+  }
+  img_out = buffer;
+}
+
+// Boost-style hash combine used to build the display cell signatures
+static inline void display_hash_mix(uint64_t &seed, uint64_t value) { seed ^= value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2); }
+
+// Bit-exact hash of a pixel location (any movement of a feature must change the signature)
+static inline uint64_t display_hash_point(const cv::Point2f &pt) {
+  uint32_t bits_x, bits_y;
+  std::memcpy(&bits_x, &pt.x, sizeof(bits_x));
+  std::memcpy(&bits_y, &pt.y, sizeof(bits_y));
+  return ((uint64_t)bits_x << 32) | (uint64_t)bits_y;
 }
 
 void TrackBase::display_active(cv::Mat &img_out, int r1, int g1, int b1, int r2, int g2, int b2, std::string overlay) {
 
+  // Serialize with other display_active callers since the cell caches below are stateful
+  std::lock_guard<std::mutex> lckd(mtx_display_active);
+
   // Cache the images to prevent other threads from editing while we viz (which can be slow)
   std::map<size_t, cv::Mat> img_last_cache, img_mask_last_cache;
+  std::map<size_t, std::vector<std::shared_ptr<const void>>> img_owners_cache;
   std::unordered_map<size_t, std::vector<cv::KeyPoint>> pts_last_cache;
   {
     std::lock_guard<std::mutex> lckv(mtx_last_vars);
     img_last_cache = img_last;
+    img_owners_cache = img_owners_last;
     img_mask_last_cache = img_mask_last;
     pts_last_cache = pts_last;
   }
@@ -66,30 +211,67 @@ void TrackBase::display_active(cv::Mat &img_out, int r1, int g1, int b1, int r2,
   if (img_last_cache.empty() || max_width == -1 || max_height == -1)
     return;
 
+  // Operators view these images small, so render the mosaic directly at the output scale
+  double scale = display_scale;
+  int out_width = std::max(1, (int)std::round(scale * max_width));
+  int out_height = std::max(1, (int)std::round(scale * max_height));
+
   // If the image is "small" thus we should use smaller display codes
-  bool is_small = (std::min(max_width, max_height) < 400);
+  bool is_small = (std::min(out_width, out_height) < 400);
 
   // If the image is "new" then draw the images from scratch
   // Otherwise, we grab the subset of the main image and draw on top of it
-  bool image_new = ((int)img_last_cache.size() * max_width != img_out.cols || max_height != img_out.rows);
+  bool image_new = ((int)img_last_cache.size() * out_width != img_out.cols || out_height != img_out.rows);
 
-  // If new, then resize the current image
-  if (image_new)
-    img_out = cv::Mat(max_height, (int)img_last_cache.size() * max_width, CV_8UC3, cv::Scalar(0, 0, 0));
+  // If new, then grab a pooled composite (a consumer may still be holding the previous one)
+  if (image_new) {
+    img_out = display_pool.checkout(out_height, (int)img_last_cache.size() * out_width, CV_8UC3);
+    img_out.setTo(cv::Scalar(0, 0, 0));
+  }
 
   // Loop through each image, and draw
   int index_cam = 0;
   for (auto const &pair : img_last_cache) {
+    // Size of this camera's cell of the mosaic at the output scale
+    int cell_width = std::min(out_width, std::max(1, (int)std::round(scale * pair.second.cols)));
+    int cell_height = std::min(out_height, std::max(1, (int)std::round(scale * pair.second.rows)));
+    cv::Rect cell_rect(out_width * index_cam, 0, cell_width, cell_height);
+    // Signature of everything this cell's render depends on, so an unchanged cell
+    // (e.g. the visualizer polling faster than the camera rate) is a single blit
+    uint64_t sig = 0;
+    display_hash_mix(sig, (uint64_t)(uintptr_t)pair.second.data);
+    display_hash_mix(sig, ((uint64_t)(uint32_t)pair.second.cols << 32) | (uint64_t)(uint32_t)pair.second.rows);
+    display_hash_mix(sig, ((uint64_t)(uint32_t)(r1 | (g1 << 8) | (b1 << 16)) << 32) | (uint64_t)(uint32_t)(r2 | (g2 << 8) | (b2 << 16)));
+    for (char c : overlay)
+      display_hash_mix(sig, (uint64_t)(unsigned char)c);
+    display_hash_mix(sig, (uint64_t)pts_last_cache[pair.first].size());
+    for (const auto &kpt : pts_last_cache[pair.first])
+      display_hash_mix(sig, display_hash_point(kpt.pt));
+    DisplayCellCache &cache = display_cache_active[pair.first];
+    if (image_new && cache.valid && cache.signature == sig && cache.cell.cols == cell_width && cache.cell.rows == cell_height) {
+      cache.cell.copyTo(img_out(cell_rect));
+      index_cam++;
+      continue;
+    }
     // select the subset of the image
     cv::Mat img_temp;
-    if (image_new)
-      cv::cvtColor(img_last_cache[pair.first], img_temp, cv::COLOR_GRAY2RGB);
-    else
-      img_temp = img_out(cv::Rect(max_width * index_cam, 0, max_width, max_height));
+    if (image_new) {
+      // Render into the (reused) cached cell, converting at the output scale so we
+      // never pay for coloring the full sensor resolution
+      if (cell_width == pair.second.cols && cell_height == pair.second.rows) {
+        cv::cvtColor(pair.second, cache.cell, cv::COLOR_GRAY2RGB);
+      } else {
+        cv::resize(pair.second, cache.gray_scaled, cv::Size(cell_width, cell_height), 0, 0, cv::INTER_AREA);
+        cv::cvtColor(cache.gray_scaled, cache.cell, cv::COLOR_GRAY2RGB);
+      }
+      img_temp = cache.cell;
+    } else {
+      img_temp = img_out(cv::Rect(out_width * index_cam, 0, out_width, out_height));
+    }
     // draw, loop through all keypoints
     for (size_t i = 0; i < pts_last_cache[pair.first].size(); i++) {
       // Get bounding pts for our boxes
-      cv::Point2f pt_l = pts_last_cache[pair.first].at(i).pt;
+      cv::Point2f pt_l = pts_last_cache[pair.first].at(i).pt * scale;
       // Draw the extracted points and ID
       cv::circle(img_temp, pt_l, (is_small) ? 1 : 2, cv::Scalar(r1, g1, b1), cv::FILLED);
       // cv::putText(img_out, std::to_string(ids_left_last.at(i)), pt_l, cv::FONT_HERSHEY_SIMPLEX,0.5,cv::Scalar(0,0,255),1,cv::LINE_AA);
@@ -106,12 +288,24 @@ void TrackBase::display_active(cv::Mat &img_out, int r1, int g1, int b1, int r2,
     } else {
       cv::putText(img_temp, overlay, txtpt, cv::FONT_HERSHEY_COMPLEX_SMALL, (is_small) ? 1.5 : 3.0, cv::Scalar(0, 0, 255), 3);
     }
-    // Overlay the mask
-    cv::Mat mask = cv::Mat::zeros(img_mask_last_cache[pair.first].rows, img_mask_last_cache[pair.first].cols, CV_8UC3);
-    mask.setTo(cv::Scalar(0, 0, 255), img_mask_last_cache[pair.first]);
-    cv::addWeighted(mask, 0.1, img_temp, 1.0, 0.0, img_temp);
-    // Replace the output image
-    img_temp.copyTo(img_out(cv::Rect(max_width * index_cam, 0, img_last_cache[pair.first].cols, img_last_cache[pair.first].rows)));
+    // Overlay the mask, resized to the cell size. Blending 10 percent of a pure red mask
+    // is just adding 25.5 to the red channel of the masked pixels, so a masked add saves
+    // allocating and blending a full color mask image every call
+    cv::Mat mask = img_mask_last_cache[pair.first];
+    if (!mask.empty() && (mask.cols != cell_width || mask.rows != cell_height)) {
+      cv::resize(mask, cache.mask_scaled, cv::Size(cell_width, cell_height), 0, 0, cv::INTER_NEAREST);
+      mask = cache.mask_scaled;
+    }
+    if (!mask.empty()) {
+      cv::Mat img_cell = img_temp(cv::Rect(0, 0, cell_width, cell_height));
+      cv::add(img_cell, cv::Scalar(0, 0, 25.5), img_cell, mask);
+    }
+    // Replace the output image (the non-new path drew directly into the composite)
+    if (image_new) {
+      cache.signature = sig;
+      cache.valid = true;
+      cache.cell.copyTo(img_out(cell_rect));
+    }
     index_cam++;
   }
 }
@@ -119,13 +313,18 @@ void TrackBase::display_active(cv::Mat &img_out, int r1, int g1, int b1, int r2,
 void TrackBase::display_history(cv::Mat &img_out, int r1, int g1, int b1, int r2, int g2, int b2, std::vector<size_t> highlighted,
                                 std::string overlay) {
 
+  // Serialize with other display_history callers since the cell caches below are stateful
+  std::lock_guard<std::mutex> lckd(mtx_display_history);
+
   // Cache the images to prevent other threads from editing while we viz (which can be slow)
   std::map<size_t, cv::Mat> img_last_cache, img_mask_last_cache;
+  std::map<size_t, std::vector<std::shared_ptr<const void>>> img_owners_cache;
   std::unordered_map<size_t, std::vector<cv::KeyPoint>> pts_last_cache;
   std::unordered_map<size_t, std::vector<size_t>> ids_last_cache;
   {
     std::lock_guard<std::mutex> lckv(mtx_last_vars);
     img_last_cache = img_last;
+    img_owners_cache = img_owners_last;
     img_mask_last_cache = img_mask_last;
     pts_last_cache = pts_last;
     ids_last_cache = ids_last;
@@ -145,16 +344,23 @@ void TrackBase::display_history(cv::Mat &img_out, int r1, int g1, int b1, int r2
   if (img_last_cache.empty() || max_width == -1 || max_height == -1)
     return;
 
+  // Operators view these images small, so render the mosaic directly at the output scale
+  double scale = display_scale;
+  int out_width = std::max(1, (int)std::round(scale * max_width));
+  int out_height = std::max(1, (int)std::round(scale * max_height));
+
   // If the image is "small" thus we shoudl use smaller display codes
-  bool is_small = (std::min(max_width, max_height) < 400);
+  bool is_small = (std::min(out_width, out_height) < 400);
 
   // If the image is "new" then draw the images from scratch
   // Otherwise, we grab the subset of the main image and draw on top of it
-  bool image_new = ((int)img_last_cache.size() * max_width != img_out.cols || max_height != img_out.rows);
+  bool image_new = ((int)img_last_cache.size() * out_width != img_out.cols || out_height != img_out.rows);
 
-  // If new, then resize the current image
-  if (image_new)
-    img_out = cv::Mat(max_height, (int)img_last_cache.size() * max_width, CV_8UC3, cv::Scalar(0, 0, 0));
+  // If new, then grab a pooled composite (a consumer may still be holding the previous one)
+  if (image_new) {
+    img_out = display_pool.checkout(out_height, (int)img_last_cache.size() * out_width, CV_8UC3);
+    img_out.setTo(cv::Scalar(0, 0, 0));
+  }
 
   // Max tracks to show (otherwise it clutters up the screen)
   size_t maxtracks = 50;
@@ -162,17 +368,52 @@ void TrackBase::display_history(cv::Mat &img_out, int r1, int g1, int b1, int r2
   // Loop through each image, and draw
   int index_cam = 0;
   for (auto const &pair : img_last_cache) {
+    // Size of this camera's cell of the mosaic at the output scale
+    int cell_width = std::min(out_width, std::max(1, (int)std::round(scale * pair.second.cols)));
+    int cell_height = std::min(out_height, std::max(1, (int)std::round(scale * pair.second.rows)));
+    cv::Rect cell_rect(out_width * index_cam, 0, cell_width, cell_height);
+    // Signature of everything this cell's render depends on. The feature trails only
+    // grow when a new image is fed, which also changes the image and point hashes, so
+    // an unchanged signature means the database query and drawing can all be skipped
+    uint64_t sig = 0;
+    display_hash_mix(sig, (uint64_t)(uintptr_t)pair.second.data);
+    display_hash_mix(sig, ((uint64_t)(uint32_t)pair.second.cols << 32) | (uint64_t)(uint32_t)pair.second.rows);
+    display_hash_mix(sig, ((uint64_t)(uint32_t)(r1 | (g1 << 8) | (b1 << 16)) << 32) | (uint64_t)(uint32_t)(r2 | (g2 << 8) | (b2 << 16)));
+    for (char c : overlay)
+      display_hash_mix(sig, (uint64_t)(unsigned char)c);
+    for (size_t id : highlighted)
+      display_hash_mix(sig, (uint64_t)id);
+    display_hash_mix(sig, (uint64_t)ids_last_cache[pair.first].size());
+    for (size_t id : ids_last_cache[pair.first])
+      display_hash_mix(sig, (uint64_t)id);
+    for (const auto &kpt : pts_last_cache[pair.first])
+      display_hash_mix(sig, display_hash_point(kpt.pt));
+    DisplayCellCache &cache = display_cache_history[pair.first];
+    if (image_new && cache.valid && cache.signature == sig && cache.cell.cols == cell_width && cache.cell.rows == cell_height) {
+      cache.cell.copyTo(img_out(cell_rect));
+      index_cam++;
+      continue;
+    }
     // select the subset of the image
     cv::Mat img_temp;
-    if (image_new)
-      cv::cvtColor(img_last_cache[pair.first], img_temp, cv::COLOR_GRAY2RGB);
-    else
-      img_temp = img_out(cv::Rect(max_width * index_cam, 0, max_width, max_height));
+    if (image_new) {
+      // Render into the (reused) cached cell, converting at the output scale so we
+      // never pay for coloring the full sensor resolution
+      if (cell_width == pair.second.cols && cell_height == pair.second.rows) {
+        cv::cvtColor(pair.second, cache.cell, cv::COLOR_GRAY2RGB);
+      } else {
+        cv::resize(pair.second, cache.gray_scaled, cv::Size(cell_width, cell_height), 0, 0, cv::INTER_AREA);
+        cv::cvtColor(cache.gray_scaled, cache.cell, cv::COLOR_GRAY2RGB);
+      }
+      img_temp = cache.cell;
+    } else {
+      img_temp = img_out(cv::Rect(out_width * index_cam, 0, out_width, out_height));
+    }
     // draw, loop through all keypoints
     for (size_t i = 0; i < ids_last_cache[pair.first].size(); i++) {
       // If a highlighted point, then put a nice box around it
       if (std::find(highlighted.begin(), highlighted.end(), ids_last_cache[pair.first].at(i)) != highlighted.end()) {
-        cv::Point2f pt_c = pts_last_cache[pair.first].at(i).pt;
+        cv::Point2f pt_c = pts_last_cache[pair.first].at(i).pt * scale;
         cv::Point2f pt_l_top = cv::Point2f(pt_c.x - ((is_small) ? 3 : 5), pt_c.y - ((is_small) ? 3 : 5));
         cv::Point2f pt_l_bot = cv::Point2f(pt_c.x + ((is_small) ? 3 : 5), pt_c.y + ((is_small) ? 3 : 5));
         cv::rectangle(img_temp, pt_l_top, pt_l_bot, cv::Scalar(0, 255, 0), 1);
@@ -195,11 +436,11 @@ void TrackBase::display_history(cv::Mat &img_out, int r1, int g1, int b1, int r2
         int color_g = (is_stereo ? r2 : g2) - (int)(1.0 * (is_stereo ? r1 : g1) / feat.uvs[pair.first].size() * z);
         int color_b = (is_stereo ? g2 : b2) - (int)(1.0 * (is_stereo ? g1 : b1) / feat.uvs[pair.first].size() * z);
         // Draw current point
-        cv::Point2f pt_c(feat.uvs[pair.first].at(z)(0), feat.uvs[pair.first].at(z)(1));
+        cv::Point2f pt_c((float)(scale * feat.uvs[pair.first].at(z)(0)), (float)(scale * feat.uvs[pair.first].at(z)(1)));
         cv::circle(img_temp, pt_c, (is_small) ? 1 : 2, cv::Scalar(color_r, color_g, color_b), cv::FILLED);
         // If there is a next point, then display the line from this point to the next
         if (z + 1 < feat.uvs[pair.first].size()) {
-          cv::Point2f pt_n(feat.uvs[pair.first].at(z + 1)(0), feat.uvs[pair.first].at(z + 1)(1));
+          cv::Point2f pt_n((float)(scale * feat.uvs[pair.first].at(z + 1)(0)), (float)(scale * feat.uvs[pair.first].at(z + 1)(1)));
           cv::line(img_temp, pt_c, pt_n, cv::Scalar(color_r, color_g, color_b));
         }
         // If the first point, display the ID
@@ -217,12 +458,22 @@ void TrackBase::display_history(cv::Mat &img_out, int r1, int g1, int b1, int r2
     } else {
       cv::putText(img_temp, overlay, txtpt, cv::FONT_HERSHEY_COMPLEX_SMALL, (is_small) ? 1.5 : 3.0, cv::Scalar(0, 0, 255), 3);
     }
-    // Overlay the mask
-    cv::Mat mask = cv::Mat::zeros(img_mask_last_cache[pair.first].rows, img_mask_last_cache[pair.first].cols, CV_8UC3);
-    mask.setTo(cv::Scalar(0, 0, 255), img_mask_last_cache[pair.first]);
-    cv::addWeighted(mask, 0.1, img_temp, 1.0, 0.0, img_temp);
-    // Replace the output image
-    img_temp.copyTo(img_out(cv::Rect(max_width * index_cam, 0, img_last_cache[pair.first].cols, img_last_cache[pair.first].rows)));
+    // Overlay the mask, resized to the cell size (see display_active for the masked add)
+    cv::Mat mask = img_mask_last_cache[pair.first];
+    if (!mask.empty() && (mask.cols != cell_width || mask.rows != cell_height)) {
+      cv::resize(mask, cache.mask_scaled, cv::Size(cell_width, cell_height), 0, 0, cv::INTER_NEAREST);
+      mask = cache.mask_scaled;
+    }
+    if (!mask.empty()) {
+      cv::Mat img_cell = img_temp(cv::Rect(0, 0, cell_width, cell_height));
+      cv::add(img_cell, cv::Scalar(0, 0, 25.5), img_cell, mask);
+    }
+    // Replace the output image (the non-new path drew directly into the composite)
+    if (image_new) {
+      cache.signature = sig;
+      cache.valid = true;
+      cache.cell.copyTo(img_out(cell_rect));
+    }
     index_cam++;
   }
 }
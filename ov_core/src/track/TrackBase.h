@@ -22,13 +22,17 @@
 #ifndef OV_CORE_TRACK_BASE_H
 #define OV_CORE_TRACK_BASE_H
 
+#include <array>
 #include <atomic>
+#include <cstdint>
+#include <functional>
 #include <iostream>
 #include <mutex>
 #include <thread>
 #include <unordered_map>
 
-#include <boost/date_time/posix_time/posix_time.hpp>
+#include <Eigen/Eigen>
+
 #include <opencv2/core/core.hpp>
 #include <opencv2/highgui/highgui.hpp>
 #include <opencv2/opencv.hpp>
@@ -77,6 +81,39 @@ public:
    */
   enum HistogramMethod { NONE, HISTOGRAM, CLAHE };
 
+  /**
+   * @brief Persistent feature occupancy grid with O(1) clearing.
+   *
+   * Detection needs an "is there already a feature near this pixel" grid every frame.
+   * Instead of allocating and zeroing a fresh cv::Mat each time, we keep a per-camera
+   * grid of generation stamps: a cell is occupied if its stamp matches the current
+   * generation, so clearing the whole grid is a single counter increment and only the
+   * cells actually touched by current features cost any work.
+   */
+  struct OccupancyGrid {
+
+    /// Clears the grid (O(1)) and resizes the backing storage if the image size changed
+    void reset(int width, int height) {
+      if (stamps.cols != width || stamps.rows != height) {
+        stamps = cv::Mat::zeros(height, width, CV_32SC1);
+        generation = 0;
+      }
+      generation++;
+    }
+
+    /// Returns true if a feature has been recorded in this cell this generation
+    bool occupied(int x, int y) const { return stamps.at<int>(y, x) == generation; }
+
+    /// Marks this cell as containing a feature
+    void set(int x, int y) { stamps.at<int>(y, x) = generation; }
+
+    /// Generation stamp of each cell (occupied iff it equals the current generation)
+    cv::Mat stamps;
+
+    /// Current generation counter (incremented on every reset)
+    int generation = 0;
+  };
+
   /**
    * @brief Public constructor with configuration variables
    * @param cameras camera calibration object which has all camera intrinsics in it
@@ -96,6 +133,19 @@ public:
    */
   virtual void feed_new_camera(const CameraData &message) = 0;
 
+  /**
+   * @brief Registers a platform preprocessing stage run on every incoming image bundle
+   * @param stage Callable which mutates the camera message in place
+   *
+   * Stages run in registration order at the very start of feed_new_camera(), before any
+   * tracking work, and may resize, rectify, or otherwise rewrite the images. This is the
+   * offload point for platforms whose ISP or other hardware can do such work for free:
+   * register a stage that swaps in the hardware-produced frames (and pair it with the
+   * "rectified" camera model if they come back undistorted, see @ref ov_core::CamRectified).
+   * All stages must be registered before the first image is fed, we do not lock here.
+   */
+  void register_preprocess_stage(const std::function<void(CameraData &)> &stage) { preprocess_stages.push_back(stage); }
+
   /**
    * @brief Shows features extracted in the last image
    * @param img_out image to which we will overlayed features on
@@ -151,7 +201,127 @@ public:
   /// Setter method for number of active features
   void set_num_features(int _num_features) { num_features = _num_features; }
 
+  /// Getter method for the scale the display functions render at (one means full sensor resolution)
+  double get_display_scale() { return display_scale; }
+
+  /**
+   * @brief Set the scale the display functions render the debug mosaic at.
+   *
+   * Operators usually view the track debug topics at a small size, so rendering them at
+   * the full sensor resolution wastes the color conversion and all the drawing work on
+   * pixels nobody sees. A scale below one makes display_active() and display_history()
+   * resize each grayscale image down first and draw everything at the reduced size.
+   * Should be set once before any display calls are made.
+   *
+   * @param scale Output scale in (0, 1] relative to the raw sensor resolution
+   */
+  void set_display_scale(double scale) { display_scale = (scale < 0.05) ? 0.05 : (scale > 1.0) ? 1.0 : scale; }
+
+  /// Getter method for the detection threshold used when extracting new features (zero if the tracker has none)
+  virtual int get_detection_threshold() { return 0; }
+
+  /// Setter method for the detection threshold used when extracting new features (no-op if the tracker has none)
+  virtual void set_detection_threshold(int _threshold) { (void)_threshold; }
+
+  /**
+   * @brief Set a predicted rotation between the last frame and the next frame of a camera.
+   *
+   * If the user has inertial readings (e.g. gyroscope integrated between the two image times)
+   * they can pass the relative rotation of the camera frame here *before* feeding the next image.
+   * Trackers can use this to warp the previous feature locations to where they should appear in
+   * the new frame, which greatly shrinks the search a matcher needs to perform for fast motions.
+   * The prediction is consumed by the next temporal match of that camera (one-shot).
+   *
+   * @param cam_id Camera the rotation corresponds to
+   * @param R_CprevtoCcurr Rotation from the previous camera frame to the incoming one
+   */
+  void set_predicted_rotation(size_t cam_id, const Eigen::Matrix3d &R_CprevtoCcurr) {
+    std::lock_guard<std::mutex> lckv(mtx_predicted_rotations);
+    predicted_rotations[cam_id] = R_CprevtoCcurr;
+  }
+
+  /**
+   * @brief Set the fixed extrinsic transform between a stereo pair of cameras.
+   *
+   * If the relative pose of a stereo pair is known (and not being calibrated online!)
+   * the user can pass it here so trackers can constrain their stereo correspondence
+   * search to each feature's epipolar line instead of solving a full 2d search.
+   * Should be called once before any images are fed, since the trackers read this
+   * without locking from their feed threads.
+   *
+   * @param cam_id_left First camera of the pair (the one features are detected in)
+   * @param cam_id_right Second camera of the pair (the one we match into)
+   * @param R_C0toC1 Rotation from the left camera frame to the right camera frame
+   * @param p_C0inC1 Position of the left camera in the right camera frame
+   */
+  void set_stereo_extrinsics(size_t cam_id_left, size_t cam_id_right, const Eigen::Matrix3d &R_C0toC1, const Eigen::Vector3d &p_C0inC1) {
+    stereo_extrinsics[{cam_id_left, cam_id_right}] = {R_C0toC1, p_C0inC1};
+  }
+
 protected:
+  /**
+   * @brief Pre-process an incoming image with the configured histogram method
+   * @param img_in raw grayscale image from the sensor
+   * @param img_out pre-processed image (aliases a reused per-camera buffer, do not write into it)
+   * @param cam_id camera this image came from (selects which buffers we use)
+   *
+   * This replaces calling cv::equalizeHist / cv::createCLAHE directly in each tracker.
+   * The output is written into a preallocated per-camera buffer so the steady state does
+   * no allocation, and the plain equalization path is a hand-written kernel tuned for
+   * instruction-level parallelism (interleaved sub-histograms and an unrolled LUT pass).
+   * Should only be called while holding the feed mutex for this camera.
+   */
+  void preprocess_image(const cv::Mat &img_in, cv::Mat &img_out, size_t cam_id);
+
+  /**
+   * @brief Returns the next unique feature id for a new extraction on the given camera.
+   *
+   * Normally this is just the shared atomic counter, so which id a feature receives
+   * depends on how the per-camera tracking tasks happen to interleave. In deterministic
+   * mode (see ThreadPool::set_deterministic()) each camera instead draws from its own
+   * stride of the id space, so a replay of the same data assigns identical ids no matter
+   * how many threads are used. Should only be called while holding the feed mutex of
+   * the camera (which all the detection functions already do).
+   *
+   * @param cam_id Camera the new feature was extracted in (left camera for stereo pairs)
+   */
+  size_t next_feature_id(size_t cam_id);
+
+  /**
+   * @brief Runs the registered preprocessing stages and returns the message to track on
+   * @param message Camera message as delivered by the sensor driver
+   * @return The original message if no stages are registered, else the preprocessed copy
+   *
+   * The copy is shallow (cv::Mat headers share the pixel data) so a stage that replaces
+   * whole images costs nothing, and the incoming message is never mutated.
+   */
+  const CameraData &apply_preprocess_stages(const CameraData &message) { return apply_preprocess_stages(message, preprocess_buffer); }
+
+  /**
+   * @brief Same as above but into a caller-owned buffer
+   * @param message Camera message as delivered by the sensor driver
+   * @param buffer Working copy the stages mutate (kept alive by the caller)
+   * @return The original message if no stages are registered, else the preprocessed copy
+   *
+   * Pipelined callers that may overlap the main feed (e.g. the pyramid precompute
+   * running one frame ahead) must use their own buffer so the two never race.
+   */
+  const CameraData &apply_preprocess_stages(const CameraData &message, CameraData &buffer) {
+    if (preprocess_stages.empty())
+      return message;
+    buffer = message;
+    for (const auto &stage : preprocess_stages) {
+      stage(buffer);
+    }
+    return buffer;
+  }
+
+  /// Platform preprocessing stages run on every incoming image bundle (see register_preprocess_stage)
+  std::vector<std::function<void(CameraData &)>> preprocess_stages;
+
+  /// Working copy of the camera message the preprocessing stages mutate
+  CameraData preprocess_buffer;
+
   /// Camera object which has all calibration in it
   std::unordered_map<size_t, std::shared_ptr<CamBase>> camera_calib;
 
@@ -170,6 +340,30 @@ protected:
   /// What histogram equalization method we should pre-process images with?
   HistogramMethod histogram_method;
 
+  /// Reused equalization output buffers (rotated since the previous output stays alive as img_last,
+  /// and the pipelined pyramid pre-computation may run one frame ahead of the feed)
+  std::map<size_t, std::array<cv::Mat, 3>> img_equalize_buffers;
+
+  /// Which of the two equalization buffers each camera should write into next
+  std::map<size_t, size_t> img_equalize_index;
+
+  /// Cached per-camera CLAHE engines so we do not reconstruct the tile grid every frame
+  std::map<size_t, cv::Ptr<cv::CLAHE>> clahe_engines;
+
+  /// Persistent per-camera detection occupancy grids (cleared in O(1) via generation stamps)
+  std::map<size_t, OccupancyGrid> grid_close_persistent;
+
+  /// User-provided predicted rotations from the last frame of each camera to the incoming one
+  /// (consumed by the next temporal match, so stale predictions are never applied)
+  std::map<size_t, Eigen::Matrix3d> predicted_rotations;
+
+  /// Mutex for the predicted rotations (the setter may race with another camera's feed thread)
+  std::mutex mtx_predicted_rotations;
+
+  /// User-provided fixed extrinsics of each stereo pair (rotation left-to-right and the
+  /// position of the left camera in the right frame), set once before feeding images
+  std::map<std::pair<size_t, size_t>, std::pair<Eigen::Matrix3d, Eigen::Vector3d>> stereo_extrinsics;
+
   /// Mutexs for our last set of image storage (img_last, pts_last, and ids_last)
   std::vector<std::mutex> mtx_feeds;
 
@@ -179,6 +373,13 @@ protected:
   /// Last set of images (use map so all trackers render in the same order)
   std::map<size_t, cv::Mat> img_last;
 
+  /// Lifetime handles for externally-owned buffers img_last may alias (see CameraData::owners)
+  /// With histogram equalization disabled img_last is the raw sensor image, which for a
+  /// zero-copy producer still lives inside e.g. a middleware message, so we must keep the
+  /// handles until the entry is overwritten. Updated wherever img_last is, and copied out
+  /// together with it by the display functions.
+  std::map<size_t, std::vector<std::shared_ptr<const void>>> img_owners_last;
+
   /// Last set of images (use map so all trackers render in the same order)
   std::map<size_t, cv::Mat> img_mask_last;
 
@@ -188,11 +389,61 @@ protected:
   /// Set of IDs of each current feature in the database
   std::unordered_map<size_t, std::vector<size_t>> ids_last;
 
+  /// Scale the display functions render the debug mosaic at (one means full sensor resolution)
+  double display_scale = 1.0;
+
+  /// Pooled composite buffers handed out by the display functions, so a consumer still
+  /// holding the previously returned mosaic (e.g. a publisher thread) never blocks a redraw
+  ImagePool display_pool{6};
+
+  /**
+   * @brief Cached render of one camera cell of the debug mosaic.
+   *
+   * The mosaic is one cell per camera, and a cell only changes when that camera produced
+   * a new image (or the colors / overlay / highlights changed). The display functions
+   * hash everything a cell depends on, and when the signature is unchanged they blit the
+   * cached cell into the composite instead of re-converting and re-drawing it, which is
+   * the common case when the visualizer polls faster than the camera rate.
+   */
+  struct DisplayCellCache {
+    /// Rendered color cell at the output scale
+    cv::Mat cell;
+    /// Reused scratch buffers for the downscaled grayscale image and mask
+    cv::Mat gray_scaled, mask_scaled;
+    /// Signature of the inputs the current cell render corresponds to
+    uint64_t signature = 0;
+    /// If the cell has been rendered at least once (a zero signature could be valid)
+    bool valid = false;
+  };
+
+  /// Per-camera cell caches for display_active (guarded by mtx_display_active)
+  std::map<size_t, DisplayCellCache> display_cache_active;
+
+  /// Per-camera cell caches for display_history (guarded by mtx_display_history)
+  std::map<size_t, DisplayCellCache> display_cache_history;
+
+  /// Serializes display_active calls since its cell caches are stateful
+  std::mutex mtx_display_active;
+
+  /// Serializes display_history calls since its cell caches are stateful
+  std::mutex mtx_display_history;
+
   /// Master ID for this tracker (atomic to allow for multi-threading)
   std::atomic<size_t> currid;
 
-  // Timing variables (most children use these...)
-  boost::posix_time::ptime rT1, rT2, rT3, rT4, rT5, rT6, rT7;
+  /// First id this tracker may hand out (ids below it belong to the aruco tags)
+  size_t currid_start = 0;
+
+  /// Per-camera id counters used in deterministic mode (guarded by the camera's feed mutex)
+  std::map<size_t, size_t> currid_cam;
+
+  /// Per-camera [next, end) id blocks reserved from @ref currid in one atomic bump, so
+  /// parallel detection only synchronizes once per block (guarded by the camera's feed mutex)
+  std::map<size_t, std::pair<size_t, size_t>> currid_block;
+
+  /// How many ids each block reservation grabs from the shared counter
+  size_t id_block_size = 64;
+
 };
 
 } // namespace ov_core
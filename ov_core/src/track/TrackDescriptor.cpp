@@ -21,16 +21,25 @@
 
 #include "TrackDescriptor.h"
 
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
 #include <opencv2/features2d.hpp>
 
 #include "Grider_FAST.h"
 #include "cam/CamBase.h"
 #include "feat/Feature.h"
 #include "feat/FeatureDatabase.h"
+#include "utils/thread_pool.h"
+#include "utils/tracer.h"
 
 using namespace ov_core;
 
-void TrackDescriptor::feed_new_camera(const CameraData &message) {
+void TrackDescriptor::feed_new_camera(const CameraData &message_in) {
+
+  // Run any registered platform preprocessing stages first (e.g. ISP resize/rectify offload)
+  const CameraData &message = apply_preprocess_stages(message_in);
 
   // Error check that we have all the data
   if (message.sensor_ids.empty() || message.sensor_ids.size() != message.images.size() || message.images.size() != message.masks.size()) {
@@ -49,11 +58,7 @@ void TrackDescriptor::feed_new_camera(const CameraData &message) {
   } else if (num_images == 2 && use_stereo) {
     feed_stereo(message, 0, 1);
   } else if (!use_stereo) {
-    parallel_for_(cv::Range(0, (int)num_images), LambdaBody([&](const cv::Range &range) {
-                    for (int i = range.start; i < range.end; i++) {
-                      feed_monocular(message, i);
-                    }
-                  }));
+    ThreadPool::instance().parallel_for(0, (int)num_images, [&](int i) { feed_monocular(message, i); });
   } else {
     PRINT_ERROR(RED "[ERROR]: invalid number of images passed %zu, we only support mono or stereo tracking", num_images);
     std::exit(EXIT_FAILURE);
@@ -63,7 +68,8 @@ void TrackDescriptor::feed_new_camera(const CameraData &message) {
 void TrackDescriptor::feed_monocular(const CameraData &message, size_t msg_id) {
 
   // Start timing
-  rT1 = boost::posix_time::microsec_clock::local_time();
+  TraceSpan span_total("desc total");
+  TraceSpan span_detect("desc detection");
 
   // Lock this data feed for this camera
   size_t cam_id = message.sensor_ids.at(msg_id);
@@ -71,16 +77,7 @@ void TrackDescriptor::feed_monocular(const CameraData &message, size_t msg_id) {
 
   // Histogram equalize
   cv::Mat img, mask;
-  if (histogram_method == HistogramMethod::HISTOGRAM) {
-    cv::equalizeHist(message.images.at(msg_id), img);
-  } else if (histogram_method == HistogramMethod::CLAHE) {
-    double eq_clip_limit = 10.0;
-    cv::Size eq_win_size = cv::Size(8, 8);
-    cv::Ptr<cv::CLAHE> clahe = cv::createCLAHE(eq_clip_limit, eq_win_size);
-    clahe->apply(message.images.at(msg_id), img);
-  } else {
-    img = message.images.at(msg_id);
-  }
+  preprocess_image(message.images.at(msg_id), img, cam_id);
   mask = message.masks.at(msg_id);
 
   // If we are the first frame (or have lost tracking), initialize our descriptors
@@ -88,13 +85,15 @@ void TrackDescriptor::feed_monocular(const CameraData &message, size_t msg_id) {
     std::vector<cv::KeyPoint> good_left;
     std::vector<size_t> good_ids_left;
     cv::Mat good_desc_left;
-    perform_detection_monocular(img, mask, good_left, good_desc_left, good_ids_left);
+    perform_detection_monocular(img, mask, good_left, good_desc_left, cam_id, good_ids_left);
     std::lock_guard<std::mutex> lckv(mtx_last_vars);
     img_last[cam_id] = img;
+    img_owners_last[cam_id] = message.owners;
     img_mask_last[cam_id] = mask;
     pts_last[cam_id] = good_left;
     ids_last[cam_id] = good_ids_left;
     desc_last[cam_id] = good_desc_left;
+    desc_age_last[cam_id] = std::vector<int>(good_left.size(), 0);
     return;
   }
 
@@ -104,20 +103,23 @@ void TrackDescriptor::feed_monocular(const CameraData &message, size_t msg_id) {
   std::vector<size_t> ids_new;
 
   // First, extract new descriptors for this new image
-  perform_detection_monocular(img, mask, pts_new, desc_new, ids_new);
-  rT2 = boost::posix_time::microsec_clock::local_time();
+  perform_detection_monocular(img, mask, pts_new, desc_new, cam_id, ids_new);
+  span_detect.stop();
+  TraceSpan span_match("desc matching");
 
   // Our matches temporally
   std::vector<cv::DMatch> matches_ll;
 
   // Lets match temporally
   robust_match(pts_last[cam_id], pts_new, desc_last[cam_id], desc_new, cam_id, cam_id, matches_ll);
-  rT3 = boost::posix_time::microsec_clock::local_time();
+  span_match.stop();
+  TraceSpan span_merge("desc merging");
 
   // Get our "good tracks"
   std::vector<cv::KeyPoint> good_left;
   std::vector<size_t> good_ids_left;
   cv::Mat good_desc_left;
+  std::vector<int> good_ages_left;
 
   // Count how many we have tracked from the last time
   int num_tracklast = 0;
@@ -137,20 +139,35 @@ void TrackDescriptor::feed_monocular(const CameraData &message, size_t msg_id) {
 
     // Then lets replace the current ID with the old ID if found
     // Else just append the current feature and its unique ID
+    // Matched tracks carry their stored descriptor forward so the track stays
+    // anchored to the patch it was first described on, and we only refresh it
+    // from the current image once it has gone stale
     good_left.push_back(pts_new[i]);
-    good_desc_left.push_back(desc_new.row((int)i));
     if (idll != -1) {
+      int age = desc_age_last[cam_id].at(idll) + 1;
+      if (age < desc_refresh_frames) {
+        good_desc_left.push_back(desc_last[cam_id].row(idll));
+        good_ages_left.push_back(age);
+      } else {
+        good_desc_left.push_back(desc_new.row((int)i));
+        good_ages_left.push_back(0);
+      }
       good_ids_left.push_back(ids_last[cam_id][idll]);
       num_tracklast++;
     } else {
+      good_desc_left.push_back(desc_new.row((int)i));
+      good_ages_left.push_back(0);
       good_ids_left.push_back(ids_new[i]);
     }
   }
-  rT4 = boost::posix_time::microsec_clock::local_time();
+  span_merge.stop();
+  TraceSpan span_database("desc database");
 
   // Update our feature database, with theses new observations
+  // Note we look the camera up once and reuse it, instead of a map lookup per point
+  std::shared_ptr<CamBase> camera = camera_calib.at(cam_id);
   for (size_t i = 0; i < good_left.size(); i++) {
-    cv::Point2f npt_l = camera_calib.at(cam_id)->undistort_cv(good_left.at(i).pt);
+    cv::Point2f npt_l = camera->undistort_cv(good_left.at(i).pt);
     database->update_feature(good_ids_left.at(i), message.timestamp, cam_id, good_left.at(i).pt.x, good_left.at(i).pt.y, npt_l.x, npt_l.y);
   }
 
@@ -161,26 +178,29 @@ void TrackDescriptor::feed_monocular(const CameraData &message, size_t msg_id) {
   {
     std::lock_guard<std::mutex> lckv(mtx_last_vars);
     img_last[cam_id] = img;
+    img_owners_last[cam_id] = message.owners;
     img_mask_last[cam_id] = mask;
     pts_last[cam_id] = good_left;
     ids_last[cam_id] = good_ids_left;
     desc_last[cam_id] = good_desc_left;
+    desc_age_last[cam_id] = good_ages_left;
   }
-  rT5 = boost::posix_time::microsec_clock::local_time();
+  span_database.stop();
+  span_total.stop();
 
   // Our timing information
-  PRINT_ALL("[TIME-DESC]: %.4f seconds for detection\n", (rT2 - rT1).total_microseconds() * 1e-6);
-  PRINT_ALL("[TIME-DESC]: %.4f seconds for matching\n", (rT3 - rT2).total_microseconds() * 1e-6);
-  PRINT_ALL("[TIME-DESC]: %.4f seconds for merging\n", (rT4 - rT3).total_microseconds() * 1e-6);
-  PRINT_ALL("[TIME-DESC]: %.4f seconds for feature DB update (%d features)\n", (rT5 - rT4).total_microseconds() * 1e-6,
-            (int)good_left.size());
-  PRINT_ALL("[TIME-DESC]: %.4f seconds for total\n", (rT5 - rT1).total_microseconds() * 1e-6);
+  PRINT_ALL("[TIME-DESC]: %.4f seconds for detection\n", span_detect.seconds());
+  PRINT_ALL("[TIME-DESC]: %.4f seconds for matching\n", span_match.seconds());
+  PRINT_ALL("[TIME-DESC]: %.4f seconds for merging\n", span_merge.seconds());
+  PRINT_ALL("[TIME-DESC]: %.4f seconds for feature DB update (%d features)\n", span_database.seconds(), (int)good_left.size());
+  PRINT_ALL("[TIME-DESC]: %.4f seconds for total\n", span_total.seconds());
 }
 
 void TrackDescriptor::feed_stereo(const CameraData &message, size_t msg_id_left, size_t msg_id_right) {
 
   // Start timing
-  rT1 = boost::posix_time::microsec_clock::local_time();
+  TraceSpan span_total("desc total");
+  TraceSpan span_detect("desc detection");
 
   // Lock this data feed for this camera
   size_t cam_id_left = message.sensor_ids.at(msg_id_left);
@@ -190,19 +210,8 @@ void TrackDescriptor::feed_stereo(const CameraData &message, size_t msg_id_left,
 
   // Histogram equalize images
   cv::Mat img_left, img_right, mask_left, mask_right;
-  if (histogram_method == HistogramMethod::HISTOGRAM) {
-    cv::equalizeHist(message.images.at(msg_id_left), img_left);
-    cv::equalizeHist(message.images.at(msg_id_right), img_right);
-  } else if (histogram_method == HistogramMethod::CLAHE) {
-    double eq_clip_limit = 10.0;
-    cv::Size eq_win_size = cv::Size(8, 8);
-    cv::Ptr<cv::CLAHE> clahe = cv::createCLAHE(eq_clip_limit, eq_win_size);
-    clahe->apply(message.images.at(msg_id_left), img_left);
-    clahe->apply(message.images.at(msg_id_right), img_right);
-  } else {
-    img_left = message.images.at(msg_id_left);
-    img_right = message.images.at(msg_id_right);
-  }
+  preprocess_image(message.images.at(msg_id_left), img_left, cam_id_left);
+  preprocess_image(message.images.at(msg_id_right), img_right, cam_id_right);
   mask_left = message.masks.at(msg_id_left);
   mask_right = message.masks.at(msg_id_right);
 
@@ -216,6 +225,8 @@ void TrackDescriptor::feed_stereo(const CameraData &message, size_t msg_id_left,
     std::lock_guard<std::mutex> lckv(mtx_last_vars);
     img_last[cam_id_left] = img_left;
     img_last[cam_id_right] = img_right;
+    img_owners_last[cam_id_left] = message.owners;
+    img_owners_last[cam_id_right] = message.owners;
     img_mask_last[cam_id_left] = mask_left;
     img_mask_last[cam_id_right] = mask_right;
     pts_last[cam_id_left] = good_left;
@@ -224,6 +235,8 @@ void TrackDescriptor::feed_stereo(const CameraData &message, size_t msg_id_left,
     ids_last[cam_id_right] = good_ids_right;
     desc_last[cam_id_left] = good_desc_left;
     desc_last[cam_id_right] = good_desc_right;
+    desc_age_last[cam_id_left] = std::vector<int>(good_left.size(), 0);
+    desc_age_last[cam_id_right] = std::vector<int>(good_right.size(), 0);
     return;
   }
 
@@ -235,25 +248,25 @@ void TrackDescriptor::feed_stereo(const CameraData &message, size_t msg_id_left,
   // First, extract new descriptors for this new image
   perform_detection_stereo(img_left, img_right, mask_left, mask_right, pts_left_new, pts_right_new, desc_left_new, desc_right_new,
                            cam_id_left, cam_id_right, ids_left_new, ids_right_new);
-  rT2 = boost::posix_time::microsec_clock::local_time();
+  span_detect.stop();
+  TraceSpan span_match("desc matching");
 
   // Our matches temporally
   std::vector<cv::DMatch> matches_ll, matches_rr;
-  parallel_for_(cv::Range(0, 2), LambdaBody([&](const cv::Range &range) {
-                  for (int i = range.start; i < range.end; i++) {
-                    bool is_left = (i == 0);
-                    robust_match(pts_last[is_left ? cam_id_left : cam_id_right], is_left ? pts_left_new : pts_right_new,
-                                 desc_last[is_left ? cam_id_left : cam_id_right], is_left ? desc_left_new : desc_right_new,
-                                 is_left ? cam_id_left : cam_id_right, is_left ? cam_id_left : cam_id_right,
-                                 is_left ? matches_ll : matches_rr);
-                  }
-                }));
-  rT3 = boost::posix_time::microsec_clock::local_time();
+  ThreadPool::instance().parallel_for(0, 2, [&](int i) {
+    bool is_left = (i == 0);
+    robust_match(pts_last[is_left ? cam_id_left : cam_id_right], is_left ? pts_left_new : pts_right_new,
+                 desc_last[is_left ? cam_id_left : cam_id_right], is_left ? desc_left_new : desc_right_new,
+                 is_left ? cam_id_left : cam_id_right, is_left ? cam_id_left : cam_id_right, is_left ? matches_ll : matches_rr);
+  });
+  span_match.stop();
+  TraceSpan span_merge("desc merging");
 
   // Get our "good tracks"
   std::vector<cv::KeyPoint> good_left, good_right;
   std::vector<size_t> good_ids_left, good_ids_right;
   cv::Mat good_desc_left, good_desc_right;
+  std::vector<int> good_ages_left, good_ages_right;
 
   // Points must be of equal size
   assert(pts_last[cam_id_left].size() == pts_last[cam_id_right].size());
@@ -286,11 +299,24 @@ void TrackDescriptor::feed_stereo(const CameraData &message, size_t msg_id_left,
     // If we found a good stereo track from left to left, and right to right
     // Then lets replace the current ID with the old ID
     // We also check that we are linked to the same past ID value
+    // Matched tracks carry their stored descriptors forward so the track stays
+    // anchored to the patch it was first described on, and we only refresh them
+    // from the current images once they have gone stale
     if (idll != -1 && idrr != -1 && ids_last[cam_id_left][idll] == ids_last[cam_id_right][idrr]) {
       good_left.push_back(pts_left_new[i]);
       good_right.push_back(pts_right_new[i]);
-      good_desc_left.push_back(desc_left_new.row((int)i));
-      good_desc_right.push_back(desc_right_new.row((int)i));
+      int age = std::max(desc_age_last[cam_id_left].at(idll), desc_age_last[cam_id_right].at(idrr)) + 1;
+      if (age < desc_refresh_frames) {
+        good_desc_left.push_back(desc_last[cam_id_left].row(idll));
+        good_desc_right.push_back(desc_last[cam_id_right].row(idrr));
+        good_ages_left.push_back(age);
+        good_ages_right.push_back(age);
+      } else {
+        good_desc_left.push_back(desc_left_new.row((int)i));
+        good_desc_right.push_back(desc_right_new.row((int)i));
+        good_ages_left.push_back(0);
+        good_ages_right.push_back(0);
+      }
       good_ids_left.push_back(ids_last[cam_id_left][idll]);
       good_ids_right.push_back(ids_last[cam_id_right][idrr]);
       num_tracklast++;
@@ -300,22 +326,28 @@ void TrackDescriptor::feed_stereo(const CameraData &message, size_t msg_id_left,
       good_right.push_back(pts_right_new[i]);
       good_desc_left.push_back(desc_left_new.row((int)i));
       good_desc_right.push_back(desc_right_new.row((int)i));
+      good_ages_left.push_back(0);
+      good_ages_right.push_back(0);
       good_ids_left.push_back(ids_left_new[i]);
       good_ids_right.push_back(ids_left_new[i]);
     }
   }
-  rT4 = boost::posix_time::microsec_clock::local_time();
+  span_merge.stop();
+  TraceSpan span_database("desc database");
 
   //===================================================================================
   //===================================================================================
 
   // Update our feature database, with theses new observations
+  // Note we look the cameras up once and reuse them, instead of a map lookup per point
+  std::shared_ptr<CamBase> camera_left = camera_calib.at(cam_id_left);
+  std::shared_ptr<CamBase> camera_right = camera_calib.at(cam_id_right);
   for (size_t i = 0; i < good_left.size(); i++) {
     // Assert that our IDs are the same
     assert(good_ids_left.at(i) == good_ids_right.at(i));
     // Try to undistort the point
-    cv::Point2f npt_l = camera_calib.at(cam_id_left)->undistort_cv(good_left.at(i).pt);
-    cv::Point2f npt_r = camera_calib.at(cam_id_right)->undistort_cv(good_right.at(i).pt);
+    cv::Point2f npt_l = camera_left->undistort_cv(good_left.at(i).pt);
+    cv::Point2f npt_r = camera_right->undistort_cv(good_right.at(i).pt);
     // Append to the database
     database->update_feature(good_ids_left.at(i), message.timestamp, cam_id_left, good_left.at(i).pt.x, good_left.at(i).pt.y, npt_l.x,
                              npt_l.y);
@@ -332,6 +364,8 @@ void TrackDescriptor::feed_stereo(const CameraData &message, size_t msg_id_left,
     std::lock_guard<std::mutex> lckv(mtx_last_vars);
     img_last[cam_id_left] = img_left;
     img_last[cam_id_right] = img_right;
+    img_owners_last[cam_id_left] = message.owners;
+    img_owners_last[cam_id_right] = message.owners;
     img_mask_last[cam_id_left] = mask_left;
     img_mask_last[cam_id_right] = mask_right;
     pts_last[cam_id_left] = good_left;
@@ -340,31 +374,29 @@ void TrackDescriptor::feed_stereo(const CameraData &message, size_t msg_id_left,
     ids_last[cam_id_right] = good_ids_right;
     desc_last[cam_id_left] = good_desc_left;
     desc_last[cam_id_right] = good_desc_right;
+    desc_age_last[cam_id_left] = good_ages_left;
+    desc_age_last[cam_id_right] = good_ages_right;
   }
-  rT5 = boost::posix_time::microsec_clock::local_time();
+  span_database.stop();
+  span_total.stop();
 
   // Our timing information
-  PRINT_ALL("[TIME-DESC]: %.4f seconds for detection\n", (rT2 - rT1).total_microseconds() * 1e-6);
-  PRINT_ALL("[TIME-DESC]: %.4f seconds for matching\n", (rT3 - rT2).total_microseconds() * 1e-6);
-  PRINT_ALL("[TIME-DESC]: %.4f seconds for merging\n", (rT4 - rT3).total_microseconds() * 1e-6);
-  PRINT_ALL("[TIME-DESC]: %.4f seconds for feature DB update (%d features)\n", (rT5 - rT4).total_microseconds() * 1e-6,
-            (int)good_left.size());
-  PRINT_ALL("[TIME-DESC]: %.4f seconds for total\n", (rT5 - rT1).total_microseconds() * 1e-6);
+  PRINT_ALL("[TIME-DESC]: %.4f seconds for detection\n", span_detect.seconds());
+  PRINT_ALL("[TIME-DESC]: %.4f seconds for matching\n", span_match.seconds());
+  PRINT_ALL("[TIME-DESC]: %.4f seconds for merging\n", span_merge.seconds());
+  PRINT_ALL("[TIME-DESC]: %.4f seconds for feature DB update (%d features)\n", span_database.seconds(), (int)good_left.size());
+  PRINT_ALL("[TIME-DESC]: %.4f seconds for total\n", span_total.seconds());
 }
 
 void TrackDescriptor::perform_detection_monocular(const cv::Mat &img0, const cv::Mat &mask0, std::vector<cv::KeyPoint> &pts0,
-                                                  cv::Mat &desc0, std::vector<size_t> &ids0) {
+                                                  cv::Mat &desc0, size_t cam_id0, std::vector<size_t> &ids0) {
 
   // Assert that we need features
   assert(pts0.empty());
 
   // Extract our features (use FAST with griding)
   std::vector<cv::KeyPoint> pts0_ext;
-  Grider_FAST::perform_griding(img0, mask0, pts0_ext, num_features, grid_x, grid_y, threshold, true);
-
-  // For all new points, extract their descriptors
-  cv::Mat desc0_ext;
-  this->orb0->compute(img0, pts0_ext, desc0_ext);
+  griders[cam_id0].perform_griding(img0, mask0, pts0_ext, num_features, grid_x, grid_y, threshold, true);
 
   // Create a 2D occupancy grid for this current image
   // Note that we scale this down, so that each grid point is equal to a set of pixels
@@ -372,11 +404,8 @@ void TrackDescriptor::perform_detection_monocular(const cv::Mat &img0, const cv:
   cv::Size size((int)((float)img0.cols / (float)min_px_dist), (int)((float)img0.rows / (float)min_px_dist));
   cv::Mat grid_2d = cv::Mat::zeros(size, CV_8UC1);
 
-  // For all good matches, lets append to our returned vectors
-  // NOTE: if we multi-thread this atomic can cause some randomness due to multiple thread detecting features
-  // NOTE: this is due to the fact that we select update features based on feat id
-  // NOTE: thus the order will matter since we try to select oldest (smallest id) to update with
-  // NOTE: not sure how to remove... maybe a better way?
+  // Enforce our minimum pixel distance *before* descriptor extraction
+  // This way the orb compute below only runs on the keypoints we will actually keep
   for (size_t i = 0; i < pts0_ext.size(); i++) {
     // Get current left keypoint, check that it is in bounds
     cv::KeyPoint kpt = pts0_ext.at(i);
@@ -390,14 +419,25 @@ void TrackDescriptor::perform_detection_monocular(const cv::Mat &img0, const cv:
     // Check if this keypoint is near another point
     if (grid_2d.at<uint8_t>(y_grid, x_grid) > 127)
       continue;
-    // Else we are good, append our keypoints and descriptors
+    // Else we are good, append our keypoint
     pts0.push_back(pts0_ext.at(i));
-    desc0.push_back(desc0_ext.row((int)i));
-    // Set our IDs to be unique IDs here, will later replace with corrected ones, after temporal matching
-    size_t temp = ++currid;
-    ids0.push_back(temp);
     grid_2d.at<uint8_t>(y_grid, x_grid) = 255;
   }
+
+  // For the kept points, extract their descriptors
+  // NOTE: compute() drops keypoints it cannot describe (e.g. too close to the border)
+  // NOTE: and keeps the keypoint vector aligned with the descriptor rows it returns
+  this->orb0->compute(img0, pts0, desc0);
+
+  // Set our IDs to be unique IDs here, will later replace with corrected ones, after temporal matching
+  // NOTE: if we multi-thread the shared id counter can cause some randomness due to multiple thread detecting features
+  // NOTE: this is due to the fact that we select update features based on feat id
+  // NOTE: thus the order will matter since we try to select oldest (smallest id) to update with
+  // NOTE: in deterministic mode next_feature_id() assigns per-camera id stripes to remove this
+  for (size_t i = 0; i < pts0.size(); i++) {
+    size_t temp = next_feature_id(cam_id0);
+    ids0.push_back(temp);
+  }
 }
 
 void TrackDescriptor::perform_detection_stereo(const cv::Mat &img0, const cv::Mat &img1, const cv::Mat &mask0, const cv::Mat &mask1,
@@ -410,29 +450,52 @@ void TrackDescriptor::perform_detection_stereo(const cv::Mat &img0, const cv::Ma
   assert(pts1.empty());
 
   // Extract our features (use FAST with griding), and their descriptors
+  // We enforce our minimum pixel distance on each image *before* descriptor
+  // extraction, so the orb compute only runs on the keypoints we can keep
+  // NOTE: we grab the grider references before the parallel section since
+  // NOTE: inserting into the map from two threads at once would be a race
   std::vector<cv::KeyPoint> pts0_ext, pts1_ext;
   cv::Mat desc0_ext, desc1_ext;
-  parallel_for_(cv::Range(0, 2), LambdaBody([&](const cv::Range &range) {
-                  for (int i = range.start; i < range.end; i++) {
-                    bool is_left = (i == 0);
-                    Grider_FAST::perform_griding(is_left ? img0 : img1, is_left ? mask0 : mask1, is_left ? pts0_ext : pts1_ext,
-                                                 num_features, grid_x, grid_y, threshold, true);
-                    (is_left ? orb0 : orb1)->compute(is_left ? img0 : img1, is_left ? pts0_ext : pts1_ext, is_left ? desc0_ext : desc1_ext);
-                  }
-                }));
+  Grider_FAST &grider0 = griders[cam_id0];
+  Grider_FAST &grider1 = griders[cam_id1];
+  ThreadPool::instance().parallel_for(0, 2, [&](int i) {
+    bool is_left = (i == 0);
+    const cv::Mat &img = is_left ? img0 : img1;
+    std::vector<cv::KeyPoint> &pts_ext = is_left ? pts0_ext : pts1_ext;
+
+    // Detect with our adaptive FAST grider
+    std::vector<cv::KeyPoint> pts_raw;
+    (is_left ? grider0 : grider1)
+        .perform_griding(img, is_left ? mask0 : mask1, pts_raw, num_features, grid_x, grid_y, threshold, true);
+
+    // Create a 2D occupancy grid for this current image
+    // Note that we scale this down, so that each grid point is equal to a set of pixels
+    // This means that we will reject points that less then grid_px_size points away then existing features
+    cv::Size size((int)((float)img.cols / (float)min_px_dist), (int)((float)img.rows / (float)min_px_dist));
+    cv::Mat grid_2d = cv::Mat::zeros(size, CV_8UC1);
+    for (size_t j = 0; j < pts_raw.size(); j++) {
+      cv::KeyPoint kpt = pts_raw.at(j);
+      int x = (int)kpt.pt.x;
+      int y = (int)kpt.pt.y;
+      int x_grid = (int)(kpt.pt.x / (float)min_px_dist);
+      int y_grid = (int)(kpt.pt.y / (float)min_px_dist);
+      if (x_grid < 0 || x_grid >= size.width || y_grid < 0 || y_grid >= size.height || x < 0 || x >= img.cols || y < 0 || y >= img.rows) {
+        continue;
+      }
+      if (grid_2d.at<uint8_t>(y_grid, x_grid) > 127)
+        continue;
+      pts_ext.push_back(kpt);
+      grid_2d.at<uint8_t>(y_grid, x_grid) = 255;
+    }
+
+    // Extract descriptors for the kept keypoints only
+    (is_left ? orb0 : orb1)->compute(img, pts_ext, is_left ? desc0_ext : desc1_ext);
+  });
 
   // Do matching from the left to the right image
   std::vector<cv::DMatch> matches;
   robust_match(pts0_ext, pts1_ext, desc0_ext, desc1_ext, cam_id0, cam_id1, matches);
 
-  // Create a 2D occupancy grid for this current image
-  // Note that we scale this down, so that each grid point is equal to a set of pixels
-  // This means that we will reject points that less then grid_px_size points away then existing features
-  cv::Size size0((int)((float)img0.cols / (float)min_px_dist), (int)((float)img0.rows / (float)min_px_dist));
-  cv::Mat grid_2d_0 = cv::Mat::zeros(size0, CV_8UC1);
-  cv::Size size1((int)((float)img1.cols / (float)min_px_dist), (int)((float)img1.rows / (float)min_px_dist));
-  cv::Mat grid_2d_1 = cv::Mat::zeros(size1, CV_8UC1);
-
   // For all good matches, lets append to our returned vectors
   for (size_t i = 0; i < matches.size(); i++) {
 
@@ -440,30 +503,6 @@ void TrackDescriptor::perform_detection_stereo(const cv::Mat &img0, const cv::Ma
     int index_pt0 = matches.at(i).queryIdx;
     int index_pt1 = matches.at(i).trainIdx;
 
-    // Get current left/right keypoint, check that it is in bounds
-    cv::KeyPoint kpt0 = pts0_ext.at(index_pt0);
-    cv::KeyPoint kpt1 = pts1_ext.at(index_pt1);
-    int x0 = (int)kpt0.pt.x;
-    int y0 = (int)kpt0.pt.y;
-    int x0_grid = (int)(kpt0.pt.x / (float)min_px_dist);
-    int y0_grid = (int)(kpt0.pt.y / (float)min_px_dist);
-    if (x0_grid < 0 || x0_grid >= size0.width || y0_grid < 0 || y0_grid >= size0.height || x0 < 0 || x0 >= img0.cols || y0 < 0 ||
-        y0 >= img0.rows) {
-      continue;
-    }
-    int x1 = (int)kpt1.pt.x;
-    int y1 = (int)kpt1.pt.y;
-    int x1_grid = (int)(kpt1.pt.x / (float)min_px_dist);
-    int y1_grid = (int)(kpt1.pt.y / (float)min_px_dist);
-    if (x1_grid < 0 || x1_grid >= size1.width || y1_grid < 0 || y1_grid >= size1.height || x1 < 0 || x1 >= img0.cols || y1 < 0 ||
-        y1 >= img0.rows) {
-      continue;
-    }
-
-    // Check if this keypoint is near another point
-    if (grid_2d_0.at<uint8_t>(y0_grid, x0_grid) > 127 || grid_2d_1.at<uint8_t>(y1_grid, x1_grid) > 127)
-      continue;
-
     // Append our keypoints and descriptors
     pts0.push_back(pts0_ext[index_pt0]);
     pts1.push_back(pts1_ext[index_pt1]);
@@ -471,7 +510,7 @@ void TrackDescriptor::perform_detection_stereo(const cv::Mat &img0, const cv::Ma
     desc1.push_back(desc1_ext.row(index_pt1));
 
     // Set our IDs to be unique IDs here, will later replace with corrected ones, after temporal matching
-    size_t temp = ++currid;
+    size_t temp = next_feature_id(cam_id0);
     ids0.push_back(temp);
     ids1.push_back(temp);
   }
@@ -484,8 +523,8 @@ void TrackDescriptor::robust_match(const std::vector<cv::KeyPoint> &pts0, const
   std::vector<std::vector<cv::DMatch>> matches0to1, matches1to0;
 
   // Match descriptors (return 2 nearest neighbours)
-  matcher->knnMatch(desc0, desc1, matches0to1, 2);
-  matcher->knnMatch(desc1, desc0, matches1to0, 2);
+  robust_knn_match(desc0, pts0, desc1, pts1, matches0to1);
+  robust_knn_match(desc1, pts1, desc0, pts0, matches1to0);
 
   // Do a ratio test for both matches
   robust_ratio_test(matches0to1);
@@ -513,10 +552,8 @@ void TrackDescriptor::robust_match(const std::vector<cv::KeyPoint> &pts0, const
   // Normalize these points, so we can then do ransac
   // We don't want to do ransac on distorted image uvs since the mapping is nonlinear
   std::vector<cv::Point2f> pts0_n, pts1_n;
-  for (size_t i = 0; i < pts0_rsc.size(); i++) {
-    pts0_n.push_back(camera_calib.at(id0)->undistort_cv(pts0_rsc.at(i)));
-    pts1_n.push_back(camera_calib.at(id1)->undistort_cv(pts1_rsc.at(i)));
-  }
+  camera_calib.at(id0)->undistort_batch_cv(pts0_rsc, pts0_n);
+  camera_calib.at(id1)->undistort_batch_cv(pts1_rsc, pts1_n);
 
   // Do RANSAC outlier rejection (note since we normalized the max pixel error is now in the normalized cords)
   std::vector<uchar> mask_rsc;
@@ -535,6 +572,94 @@ void TrackDescriptor::robust_match(const std::vector<cv::KeyPoint> &pts0, const
   }
 }
 
+/**
+ * Hamming distance between two binary descriptors using 64-bit popcounts.
+ * ORB descriptors are 32 bytes, so this is four xor+popcount instructions.
+ */
+static inline int hamming_distance(const uchar *a, const uchar *b, int bytes) {
+  int dist = 0;
+  int i = 0;
+  for (; i + 8 <= bytes; i += 8) {
+    uint64_t va, vb;
+    std::memcpy(&va, a + i, sizeof(uint64_t));
+    std::memcpy(&vb, b + i, sizeof(uint64_t));
+    dist += __builtin_popcountll(va ^ vb);
+  }
+  for (; i < bytes; i++)
+    dist += __builtin_popcount((unsigned int)(a[i] ^ b[i]));
+  return dist;
+}
+
+void TrackDescriptor::robust_knn_match(const cv::Mat &desc_q, const std::vector<cv::KeyPoint> &pts_q, const cv::Mat &desc_t,
+                                       const std::vector<cv::KeyPoint> &pts_t, std::vector<std::vector<cv::DMatch>> &matches) {
+
+  // Handle the empty cases so the bucketing below can assume data
+  matches.clear();
+  matches.resize(desc_q.rows);
+  if (desc_q.rows < 1 || desc_t.rows < 1)
+    return;
+  assert(desc_q.cols == desc_t.cols);
+  assert(desc_t.rows == (int)pts_t.size());
+
+  // Bucket the train keypoints into grid cells of our search window size, so
+  // each query only scans the 3x3 cells around its motion-prior location
+  double cell_size = match_window_px;
+  std::unordered_map<int, std::vector<int>> grid;
+  int grid_cols = 0;
+  for (size_t i = 0; i < pts_t.size(); i++)
+    grid_cols = std::max(grid_cols, (int)(pts_t.at(i).pt.x / cell_size) + 2);
+  for (size_t i = 0; i < pts_t.size(); i++) {
+    int cx = (int)(pts_t.at(i).pt.x / cell_size);
+    int cy = (int)(pts_t.at(i).pt.y / cell_size);
+    grid[cy * grid_cols + cx].push_back((int)i);
+  }
+
+  // Find the two nearest neighbours of each query (queries are independent)
+  ThreadPool::instance().parallel_for(0, desc_q.rows, [&](int q) {
+    // Collect the candidates within the window of where we expect the match
+    std::vector<int> candidates;
+    int cx = (int)(pts_q.at(q).pt.x / cell_size);
+    int cy = (int)(pts_q.at(q).pt.y / cell_size);
+    for (int dy = -1; dy <= 1; dy++) {
+      for (int dx = -1; dx <= 1; dx++) {
+        auto it = grid.find((cy + dy) * grid_cols + (cx + dx));
+        if (it != grid.end())
+          candidates.insert(candidates.end(), it->second.begin(), it->second.end());
+      }
+    }
+
+    // If the window is too sparse to even run the ratio test, scan everything
+    // so we never drop a match the brute-force search would have found
+    bool full_scan = (candidates.size() < 2);
+
+    // Single pass keeping the two best Hamming distances
+    const uchar *query = desc_q.ptr(q);
+    int bytes = desc_q.cols;
+    int best1 = -1, best2 = -1;
+    int dist1 = std::numeric_limits<int>::max(), dist2 = std::numeric_limits<int>::max();
+    size_t num_candidates = full_scan ? pts_t.size() : candidates.size();
+    for (size_t c = 0; c < num_candidates; c++) {
+      int t = full_scan ? (int)c : candidates.at(c);
+      int dist = hamming_distance(query, desc_t.ptr(t), bytes);
+      if (dist < dist1) {
+        best2 = best1;
+        dist2 = dist1;
+        best1 = t;
+        dist1 = dist;
+      } else if (dist < dist2) {
+        best2 = t;
+        dist2 = dist;
+      }
+    }
+
+    // Record them in the same form knnMatch would have
+    if (best1 != -1)
+      matches.at(q).emplace_back(cv::DMatch(q, best1, (float)dist1));
+    if (best2 != -1)
+      matches.at(q).emplace_back(cv::DMatch(q, best2, (float)dist2));
+  });
+}
+
 void TrackDescriptor::robust_ratio_test(std::vector<std::vector<cv::DMatch>> &matches) {
   // Loop through all matches
   for (auto &match : matches) {
@@ -22,6 +22,7 @@
 #ifndef OV_CORE_TRACK_DESC_H
 #define OV_CORE_TRACK_DESC_H
 
+#include "Grider_FAST.h"
 #include "TrackBase.h"
 
 namespace ov_core {
@@ -53,7 +54,11 @@ public:
   explicit TrackDescriptor(std::unordered_map<size_t, std::shared_ptr<CamBase>> cameras, int numfeats, int numaruco, bool stereo,
                            HistogramMethod histmethod, int fast_threshold, int gridx, int gridy, int minpxdist, double knnratio)
       : TrackBase(cameras, numfeats, numaruco, stereo, histmethod), threshold(fast_threshold), grid_x(gridx), grid_y(gridy),
-        min_px_dist(minpxdist), knn_ratio(knnratio) {}
+        min_px_dist(minpxdist), knn_ratio(knnratio) {
+    // Pre-create the per-camera griders here so parallel camera feeds never mutate the map
+    for (const auto &camera : camera_calib)
+      griders[camera.first];
+  }
 
   /**
    * @brief Process a new image
@@ -61,6 +66,12 @@ public:
    */
   void feed_new_camera(const CameraData &message) override;
 
+  /// Getter method for the FAST detection threshold
+  int get_detection_threshold() override { return threshold; }
+
+  /// Setter method for the FAST detection threshold
+  void set_detection_threshold(int _threshold) override { threshold = _threshold; }
+
 protected:
   /**
    * @brief Process a new monocular image
@@ -83,6 +94,7 @@ protected:
    * @param mask0 mask which has what ROI we do not want features in
    * @param pts0 vector of extracted keypoints
    * @param desc0 vector of the extracted descriptors
+   * @param cam_id0 id of the camera (selects which adaptive grider we detect with)
    * @param ids0 vector of all new IDs
    *
    * Given a set of images, and their currently extracted features, this will try to add new features.
@@ -91,7 +103,7 @@ protected:
    * See robust_match() for the matching.
    */
   void perform_detection_monocular(const cv::Mat &img0, const cv::Mat &mask0, std::vector<cv::KeyPoint> &pts0, cv::Mat &desc0,
-                                   std::vector<size_t> &ids0);
+                                   size_t cam_id0, std::vector<size_t> &ids0);
 
   /**
    * @brief Detects new features in the current stereo pair
@@ -135,6 +147,25 @@ protected:
   void robust_match(const std::vector<cv::KeyPoint> &pts0, const std::vector<cv::KeyPoint> &pts1, const cv::Mat &desc0,
                     const cv::Mat &desc1, size_t id0, size_t id1, std::vector<cv::DMatch> &matches);
 
+  /**
+   * @brief Finds the two nearest Hamming neighbours of each query descriptor.
+   * @param desc_q query descriptors (one row per keypoint)
+   * @param pts_q query keypoints
+   * @param desc_t train descriptors (one row per keypoint)
+   * @param pts_t train keypoints
+   * @param matches per-query vector of the (up to) two best matches
+   *
+   * Replacement for cv::BFMatcher::knnMatch. Descriptors are compared with a
+   * 64-bit popcount Hamming kernel, and we exploit the motion prior that a
+   * feature cannot have moved far between frames: train keypoints are bucketed
+   * into a pixel grid and only the buckets around the query location are
+   * scanned. If the window has too few candidates (e.g. fast motion) we fall
+   * back to scanning the full train set for that query, so no match that the
+   * brute-force search would have found is ever dropped for good.
+   */
+  void robust_knn_match(const cv::Mat &desc_q, const std::vector<cv::KeyPoint> &pts_q, const cv::Mat &desc_t,
+                        const std::vector<cv::KeyPoint> &pts_t, std::vector<std::vector<cv::DMatch>> &matches);
+
   // Helper functions for the robust_match function
   // Original code is from the "RobustMatcher" in the opencv examples
   // https://github.com/opencv/opencv/blob/master/samples/cpp/tutorial_code/calib3d/real_time_pose_estimation/src/RobustMatcher.cpp
@@ -142,15 +173,17 @@ protected:
   void robust_symmetry_test(std::vector<std::vector<cv::DMatch>> &matches1, std::vector<std::vector<cv::DMatch>> &matches2,
                             std::vector<cv::DMatch> &good_matches);
 
-  // Timing variables
-  boost::posix_time::ptime rT1, rT2, rT3, rT4, rT5, rT6, rT7;
-
   // Our orb extractor
   cv::Ptr<cv::ORB> orb0 = cv::ORB::create();
   cv::Ptr<cv::ORB> orb1 = cv::ORB::create();
 
-  // Our descriptor matcher
-  cv::Ptr<cv::DescriptorMatcher> matcher = cv::DescriptorMatcher::create("BruteForce-Hamming");
+  // Per-camera FAST griders (stateful, they adapt their per-cell thresholds across frames)
+  std::map<size_t, Grider_FAST> griders;
+
+  // Motion-prior search window in pixels for descriptor matching
+  // Candidate matches are first looked for within this radius of the query
+  // keypoint, which covers our inter-frame motion at tracking frequencies
+  int match_window_px = 50;
 
   // Parameters for our FAST grid detector
   int threshold;
@@ -164,8 +197,15 @@ protected:
   // then the two features are too close, so should be considered ambiguous/bad match
   double knn_ratio;
 
+  // Number of frames a matched track may carry its stored descriptor before
+  // we refresh it from the current image (guards against appearance drift)
+  int desc_refresh_frames = 10;
+
   // Descriptor matrices
   std::unordered_map<size_t, cv::Mat> desc_last;
+
+  // Age in frames of each stored descriptor row in desc_last (parallel vectors)
+  std::unordered_map<size_t, std::vector<int>> desc_age_last;
 };
 
 } // namespace ov_core
@@ -26,12 +26,25 @@
 #include "cam/CamBase.h"
 #include "feat/Feature.h"
 #include "feat/FeatureDatabase.h"
-#include "utils/opencv_lambda_body.h"
 #include "utils/print.h"
+#include "utils/thread_pool.h"
+#include "utils/tracer.h"
 
 using namespace ov_core;
 
-void TrackKLT::feed_new_camera(const CameraData &message) {
+// Max level an LK call can use for two precomputed pyramids
+// If the level count was changed between frames (see set_pyramid_levels) the pyramids
+// may have been built with a different setting, so clamp to what they actually contain
+// (each level of a cv::buildOpticalFlowPyramid result is an image + derivative pair)
+static int usable_pyr_levels(const std::vector<cv::Mat> &pyr0, const std::vector<cv::Mat> &pyr1, int levels) {
+  int built = (int)(std::min(pyr0.size(), pyr1.size()) / 2) - 1;
+  return std::max(0, std::min(levels, built));
+}
+
+void TrackKLT::feed_new_camera(const CameraData &message_in) {
+
+  // Run any registered platform preprocessing stages first (e.g. ISP resize/rectify offload)
+  const CameraData &message = apply_preprocess_stages(message_in);
 
   // Error check that we have all the data
   if (message.sensor_ids.empty() || message.sensor_ids.size() != message.images.size() || message.images.size() != message.masks.size()) {
@@ -42,55 +55,141 @@ void TrackKLT::feed_new_camera(const CameraData &message) {
     std::exit(EXIT_FAILURE);
   }
 
-  // Preprocessing steps that we do not parallelize
-  // NOTE: DO NOT PARALLELIZE THESE!
-  // NOTE: These seem to be much slower if you parallelize them...
-  rT1 = boost::posix_time::microsec_clock::local_time();
+  // Preprocessing steps (histogram equalization and pyramid construction)
+  // Each camera is independent here, so we run them as parallel tasks
+  // NOTE: we need to insert the map entries *before* spawning the tasks since
+  // NOTE: concurrent insertion into std::map is not thread safe (filling existing slots is)
+  TraceSpan span_total("klt total");
+  TraceSpan span_pyramid("klt pyramid");
   size_t num_images = message.images.size();
   for (size_t msg_id = 0; msg_id < num_images; msg_id++) {
-
+    size_t cam_id = message.sensor_ids.at(msg_id);
+    img_curr[cam_id];
+    img_pyramid_curr[cam_id];
+  }
+  ThreadPool::instance().parallel_for(0, (int)num_images, [&](int msg_id) {
     // Lock this data feed for this camera
     size_t cam_id = message.sensor_ids.at(msg_id);
     std::lock_guard<std::mutex> lck(mtx_feeds.at(cam_id));
 
+    // If the pipelined pre-computation already built this frame at enqueue time, use it
+    if (precomp_timestamps.at(cam_id) == message.timestamp) {
+      img_curr.at(cam_id) = precomp_imgs.at(cam_id);
+      img_pyramid_curr.at(cam_id) = precomp_pyrs.at(cam_id);
+      return;
+    }
+
     // Histogram equalize
     cv::Mat img;
-    if (histogram_method == HistogramMethod::HISTOGRAM) {
-      cv::equalizeHist(message.images.at(msg_id), img);
-    } else if (histogram_method == HistogramMethod::CLAHE) {
-      double eq_clip_limit = 10.0;
-      cv::Size eq_win_size = cv::Size(8, 8);
-      cv::Ptr<cv::CLAHE> clahe = cv::createCLAHE(eq_clip_limit, eq_win_size);
-      clahe->apply(message.images.at(msg_id), img);
-    } else {
-      img = message.images.at(msg_id);
-    }
+    preprocess_image(message.images.at(msg_id), img, cam_id);
 
-    // Extract image pyramid
-    std::vector<cv::Mat> imgpyr;
-    cv::buildOpticalFlowPyramid(img, imgpyr, win_size, pyr_levels);
+    // Extract image pyramid (into the pooled per-camera allocations)
+    std::vector<cv::Mat> &imgpyr = build_pyramid_pooled(cam_id, img);
 
     // Save!
-    img_curr[cam_id] = img;
-    img_pyramid_curr[cam_id] = imgpyr;
-  }
+    img_curr.at(cam_id) = img;
+    img_pyramid_curr.at(cam_id) = imgpyr;
+  });
+  span_pyramid.stop();
 
   // Either call our stereo or monocular version
   // If we are doing binocular tracking, then we should parallize our tracking
+  // For multi-camera stereo rigs, each adjacent pair is an independent stereo task
+  // so a 4-camera frame costs roughly the latency of a single stereo pair
   if (num_images == 1) {
     feed_monocular(message, 0);
   } else if (num_images == 2 && use_stereo) {
     feed_stereo(message, 0, 1);
   } else if (!use_stereo) {
-    parallel_for_(cv::Range(0, (int)num_images), LambdaBody([&](const cv::Range &range) {
-                    for (int i = range.start; i < range.end; i++) {
-                      feed_monocular(message, i);
-                    }
-                  }));
+    ThreadPool::instance().parallel_for(0, (int)num_images, [&](int i) { feed_monocular(message, i); });
+  } else if (num_images % 2 == 0) {
+    ThreadPool::instance().parallel_for(0, (int)num_images / 2, [&](int i) { feed_stereo(message, 2 * i, 2 * i + 1); });
   } else {
     PRINT_ERROR(RED "[ERROR]: invalid number of images passed %zu, we only support mono or stereo tracking", num_images);
     std::exit(EXIT_FAILURE);
   }
+  span_total.stop();
+
+  // Timing information
+  PRINT_ALL("[TIME-KLT]: %.4f seconds for pyramid\n", span_pyramid.seconds());
+  PRINT_ALL("[TIME-KLT]: %.4f seconds for total\n", span_total.seconds());
+
+#if defined(HAVE_OPENCV_CUDAOPTFLOW)
+  // Release device copies of images that can no longer be matched against
+  if (use_gpu) {
+    std::lock_guard<std::mutex> lck_gpu(mtx_gpu);
+    prune_gpu_cache();
+  }
+#endif
+}
+
+void TrackKLT::precompute_pyramids(const CameraData &message_in) {
+
+  // Run the platform preprocessing stages into our own buffer since this can overlap
+  // feed_new_camera() of the previous frame (which uses the shared buffer)
+  const CameraData &message = apply_preprocess_stages(message_in, precomp_preprocess_buffer);
+
+  // Build each camera's pyramid if it has not already been done for this timestamp
+  // This takes the same per-camera feed locks as feed_new_camera(), so the two can
+  // never preprocess the same camera at the same time
+  for (size_t msg_id = 0; msg_id < message.images.size(); msg_id++) {
+    size_t cam_id = message.sensor_ids.at(msg_id);
+    if (precomp_timestamps.find(cam_id) == precomp_timestamps.end())
+      continue;
+    std::lock_guard<std::mutex> lck(mtx_feeds.at(cam_id));
+    if (precomp_timestamps.at(cam_id) == message.timestamp)
+      continue;
+
+    // Histogram equalize and build the optical flow pyramid
+    cv::Mat img;
+    preprocess_image(message.images.at(msg_id), img, cam_id);
+    std::vector<cv::Mat> &imgpyr = build_pyramid_pooled(cam_id, img);
+    precomp_imgs.at(cam_id) = img;
+    precomp_pyrs.at(cam_id) = imgpyr;
+    precomp_timestamps.at(cam_id) = message.timestamp;
+
+#if defined(HAVE_OPENCV_CUDAOPTFLOW)
+    // Also stage the image on the device now, so the pinned-memory upload
+    // overlaps the filter update of the previous frame instead of the matching
+    if (use_gpu && cv::cuda::getCudaEnabledDeviceCount() > 0) {
+      std::lock_guard<std::mutex> lck_gpu(mtx_gpu);
+      get_gpu_image(imgpyr.at(0));
+    }
+#endif
+  }
+}
+
+std::vector<cv::Mat> &TrackKLT::build_pyramid_pooled(size_t cam_id, const cv::Mat &img) {
+
+  // A buffer is still in use if one of the pyramid maps holds header copies of it,
+  // since those share the underlying level storage (data pointer comparison is enough)
+  // The maps are all filled under the per-camera feed mutex which our caller holds
+  auto in_use = [&](const std::vector<cv::Mat> &buf) {
+    if (buf.empty())
+      return false;
+    for (const std::map<size_t, std::vector<cv::Mat>> *pyrs : {&img_pyramid_last, &img_pyramid_curr, &precomp_pyrs}) {
+      auto it = pyrs->find(cam_id);
+      if (it != pyrs->end() && !it->second.empty() && it->second.at(0).data == buf.at(0).data)
+        return true;
+    }
+    return false;
+  };
+
+  // Round-robin to the next free buffer (at most three can be in use at once)
+  std::array<std::vector<cv::Mat>, 4> &pool = pyr_pool.at(cam_id);
+  size_t idx = pyr_pool_idx.at(cam_id);
+  for (size_t i = 0; i < pool.size(); i++) {
+    idx = (idx + 1) % pool.size();
+    if (!in_use(pool.at(idx)))
+      break;
+  }
+  pyr_pool_idx.at(cam_id) = idx;
+
+  // Build into the pooled levels, which cv::buildOpticalFlowPyramid will only
+  // re-allocate if the (padded) image dimensions have changed
+  std::vector<cv::Mat> &imgpyr = pool.at(idx);
+  cv::buildOpticalFlowPyramid(img, imgpyr, win_size, pyr_levels);
+  return imgpyr;
 }
 
 void TrackKLT::feed_monocular(const CameraData &message, size_t msg_id) {
@@ -103,7 +202,7 @@ void TrackKLT::feed_monocular(const CameraData &message, size_t msg_id) {
   cv::Mat img = img_curr.at(cam_id);
   std::vector<cv::Mat> imgpyr = img_pyramid_curr.at(cam_id);
   cv::Mat mask = message.masks.at(msg_id);
-  rT2 = boost::posix_time::microsec_clock::local_time();
+  TraceSpan span_detect("klt detection");
 
   // If we didn't have any successful tracks last time, just extract this time
   // This also handles, the tracking initalization on the first call to this extractor
@@ -111,10 +210,11 @@ void TrackKLT::feed_monocular(const CameraData &message, size_t msg_id) {
     // Detect new features
     std::vector<cv::KeyPoint> good_left;
     std::vector<size_t> good_ids_left;
-    perform_detection_monocular(imgpyr, mask, good_left, good_ids_left);
+    perform_detection_monocular(imgpyr, mask, cam_id, good_left, good_ids_left);
     // Save the current image and pyramid
     std::lock_guard<std::mutex> lckv(mtx_last_vars);
     img_last[cam_id] = img;
+    img_owners_last[cam_id] = message.owners;
     img_pyramid_last[cam_id] = imgpyr;
     img_mask_last[cam_id] = mask;
     pts_last[cam_id] = good_left;
@@ -127,22 +227,25 @@ void TrackKLT::feed_monocular(const CameraData &message, size_t msg_id) {
   int pts_before_detect = (int)pts_last[cam_id].size();
   auto pts_left_old = pts_last[cam_id];
   auto ids_left_old = ids_last[cam_id];
-  perform_detection_monocular(img_pyramid_last[cam_id], img_mask_last[cam_id], pts_left_old, ids_left_old);
-  rT3 = boost::posix_time::microsec_clock::local_time();
+  perform_detection_monocular(img_pyramid_last[cam_id], img_mask_last[cam_id], cam_id, pts_left_old, ids_left_old);
+  span_detect.stop();
+  TraceSpan span_temporal("klt temporal");
 
   // Our return success masks, and predicted new features
   std::vector<uchar> mask_ll;
   std::vector<cv::KeyPoint> pts_left_new = pts_left_old;
 
   // Lets track temporally
-  perform_matching(img_pyramid_last[cam_id], imgpyr, pts_left_old, pts_left_new, cam_id, cam_id, mask_ll);
+  perform_matching(img_pyramid_last[cam_id], imgpyr, pts_left_old, pts_left_new, ids_left_old, cam_id, cam_id, mask_ll);
   assert(pts_left_new.size() == ids_left_old.size());
-  rT4 = boost::posix_time::microsec_clock::local_time();
+  span_temporal.stop();
+  TraceSpan span_database("klt database");
 
   // If any of our mask is empty, that means we didn't have enough to do ransac, so just return
   if (mask_ll.empty()) {
     std::lock_guard<std::mutex> lckv(mtx_last_vars);
     img_last[cam_id] = img;
+    img_owners_last[cam_id] = message.owners;
     img_pyramid_last[cam_id] = imgpyr;
     img_mask_last[cam_id] = mask;
     pts_last[cam_id].clear();
@@ -173,8 +276,10 @@ void TrackKLT::feed_monocular(const CameraData &message, size_t msg_id) {
   }
 
   // Update our feature database, with theses new observations
+  // Note we look the camera up once and reuse it, instead of a map lookup per point
+  std::shared_ptr<CamBase> camera = camera_calib.at(cam_id);
   for (size_t i = 0; i < good_left.size(); i++) {
-    cv::Point2f npt_l = camera_calib.at(cam_id)->undistort_cv(good_left.at(i).pt);
+    cv::Point2f npt_l = camera->undistort_cv(good_left.at(i).pt);
     database->update_feature(good_ids_left.at(i), message.timestamp, cam_id, good_left.at(i).pt.x, good_left.at(i).pt.y, npt_l.x, npt_l.y);
   }
 
@@ -182,21 +287,19 @@ void TrackKLT::feed_monocular(const CameraData &message, size_t msg_id) {
   {
     std::lock_guard<std::mutex> lckv(mtx_last_vars);
     img_last[cam_id] = img;
+    img_owners_last[cam_id] = message.owners;
     img_pyramid_last[cam_id] = imgpyr;
     img_mask_last[cam_id] = mask;
     pts_last[cam_id] = good_left;
     ids_last[cam_id] = good_ids_left;
   }
-  rT5 = boost::posix_time::microsec_clock::local_time();
+  span_database.stop();
 
   // Timing information
-  PRINT_ALL("[TIME-KLT]: %.4f seconds for pyramid\n", (rT2 - rT1).total_microseconds() * 1e-6);
-  PRINT_ALL("[TIME-KLT]: %.4f seconds for detection (%zu detected)\n", (rT3 - rT2).total_microseconds() * 1e-6,
+  PRINT_ALL("[TIME-KLT]: %.4f seconds for detection (%zu detected)\n", span_detect.seconds(),
             (int)pts_last[cam_id].size() - pts_before_detect);
-  PRINT_ALL("[TIME-KLT]: %.4f seconds for temporal klt\n", (rT4 - rT3).total_microseconds() * 1e-6);
-  PRINT_ALL("[TIME-KLT]: %.4f seconds for feature DB update (%d features)\n", (rT5 - rT4).total_microseconds() * 1e-6,
-            (int)good_left.size());
-  PRINT_ALL("[TIME-KLT]: %.4f seconds for total\n", (rT5 - rT1).total_microseconds() * 1e-6);
+  PRINT_ALL("[TIME-KLT]: %.4f seconds for temporal klt\n", span_temporal.seconds());
+  PRINT_ALL("[TIME-KLT]: %.4f seconds for feature DB update (%d features)\n", span_database.seconds(), (int)good_left.size());
 }
 
 void TrackKLT::feed_stereo(const CameraData &message, size_t msg_id_left, size_t msg_id_right) {
@@ -214,7 +317,7 @@ void TrackKLT::feed_stereo(const CameraData &message, size_t msg_id_left, size_t
   std::vector<cv::Mat> imgpyr_right = img_pyramid_curr.at(cam_id_right);
   cv::Mat mask_left = message.masks.at(msg_id_left);
   cv::Mat mask_right = message.masks.at(msg_id_right);
-  rT2 = boost::posix_time::microsec_clock::local_time();
+  TraceSpan span_detect("klt detection");
 
   // If we didn't have any successful tracks last time, just extract this time
   // This also handles, the tracking initalization on the first call to this extractor
@@ -228,6 +331,8 @@ void TrackKLT::feed_stereo(const CameraData &message, size_t msg_id_left, size_t
     std::lock_guard<std::mutex> lckv(mtx_last_vars);
     img_last[cam_id_left] = img_left;
     img_last[cam_id_right] = img_right;
+    img_owners_last[cam_id_left] = message.owners;
+    img_owners_last[cam_id_right] = message.owners;
     img_pyramid_last[cam_id_left] = imgpyr_left;
     img_pyramid_last[cam_id_right] = imgpyr_right;
     img_mask_last[cam_id_left] = mask_left;
@@ -249,7 +354,8 @@ void TrackKLT::feed_stereo(const CameraData &message, size_t msg_id_left, size_t
   perform_detection_stereo(img_pyramid_last[cam_id_left], img_pyramid_last[cam_id_right], img_mask_last[cam_id_left],
                            img_mask_last[cam_id_right], cam_id_left, cam_id_right, pts_left_old, pts_right_old, ids_left_old,
                            ids_right_old);
-  rT3 = boost::posix_time::microsec_clock::local_time();
+  span_detect.stop();
+  TraceSpan span_temporal("klt temporal");
 
   // Our return success masks, and predicted new features
   std::vector<uchar> mask_ll, mask_rr;
@@ -257,16 +363,15 @@ void TrackKLT::feed_stereo(const CameraData &message, size_t msg_id_left, size_t
   std::vector<cv::KeyPoint> pts_right_new = pts_right_old;
 
   // Lets track temporally
-  parallel_for_(cv::Range(0, 2), LambdaBody([&](const cv::Range &range) {
-                  for (int i = range.start; i < range.end; i++) {
-                    bool is_left = (i == 0);
-                    perform_matching(img_pyramid_last[is_left ? cam_id_left : cam_id_right], is_left ? imgpyr_left : imgpyr_right,
-                                     is_left ? pts_left_old : pts_right_old, is_left ? pts_left_new : pts_right_new,
-                                     is_left ? cam_id_left : cam_id_right, is_left ? cam_id_left : cam_id_right,
-                                     is_left ? mask_ll : mask_rr);
-                  }
-                }));
-  rT4 = boost::posix_time::microsec_clock::local_time();
+  ThreadPool::instance().parallel_for(0, 2, [&](int i) {
+    bool is_left = (i == 0);
+    perform_matching(img_pyramid_last[is_left ? cam_id_left : cam_id_right], is_left ? imgpyr_left : imgpyr_right,
+                     is_left ? pts_left_old : pts_right_old, is_left ? pts_left_new : pts_right_new,
+                     is_left ? ids_left_old : ids_right_old, is_left ? cam_id_left : cam_id_right,
+                     is_left ? cam_id_left : cam_id_right, is_left ? mask_ll : mask_rr);
+  });
+  span_temporal.stop();
+  TraceSpan span_stereo("klt stereo");
 
   //===================================================================================
   //===================================================================================
@@ -275,8 +380,9 @@ void TrackKLT::feed_stereo(const CameraData &message, size_t msg_id_left, size_t
   // TODO: we should probably still do this to reject outliers
   // TODO: maybe we should collect all tracks that are in both frames and make they pass this?
   // std::vector<uchar> mask_lr;
-  // perform_matching(imgpyr_left, imgpyr_right, pts_left_new, pts_right_new, cam_id_left, cam_id_right, mask_lr);
-  rT5 = boost::posix_time::microsec_clock::local_time();
+  // perform_matching(imgpyr_left, imgpyr_right, pts_left_new, pts_right_new, ids_left_old, cam_id_left, cam_id_right, mask_lr);
+  span_stereo.stop();
+  TraceSpan span_database("klt database");
 
   //===================================================================================
   //===================================================================================
@@ -286,6 +392,8 @@ void TrackKLT::feed_stereo(const CameraData &message, size_t msg_id_left, size_t
     std::lock_guard<std::mutex> lckv(mtx_last_vars);
     img_last[cam_id_left] = img_left;
     img_last[cam_id_right] = img_right;
+    img_owners_last[cam_id_left] = message.owners;
+    img_owners_last[cam_id_right] = message.owners;
     img_pyramid_last[cam_id_left] = imgpyr_left;
     img_pyramid_last[cam_id_right] = imgpyr_right;
     img_mask_last[cam_id_left] = mask_left;
@@ -354,13 +462,16 @@ void TrackKLT::feed_stereo(const CameraData &message, size_t msg_id_left, size_t
   }
 
   // Update our feature database, with theses new observations
+  // Note we look the cameras up once and reuse them, instead of a map lookup per point
+  std::shared_ptr<CamBase> camera_left = camera_calib.at(cam_id_left);
+  std::shared_ptr<CamBase> camera_right = camera_calib.at(cam_id_right);
   for (size_t i = 0; i < good_left.size(); i++) {
-    cv::Point2f npt_l = camera_calib.at(cam_id_left)->undistort_cv(good_left.at(i).pt);
+    cv::Point2f npt_l = camera_left->undistort_cv(good_left.at(i).pt);
     database->update_feature(good_ids_left.at(i), message.timestamp, cam_id_left, good_left.at(i).pt.x, good_left.at(i).pt.y, npt_l.x,
                              npt_l.y);
   }
   for (size_t i = 0; i < good_right.size(); i++) {
-    cv::Point2f npt_r = camera_calib.at(cam_id_right)->undistort_cv(good_right.at(i).pt);
+    cv::Point2f npt_r = camera_right->undistort_cv(good_right.at(i).pt);
     database->update_feature(good_ids_right.at(i), message.timestamp, cam_id_right, good_right.at(i).pt.x, good_right.at(i).pt.y, npt_r.x,
                              npt_r.y);
   }
@@ -370,6 +481,8 @@ void TrackKLT::feed_stereo(const CameraData &message, size_t msg_id_left, size_t
     std::lock_guard<std::mutex> lckv(mtx_last_vars);
     img_last[cam_id_left] = img_left;
     img_last[cam_id_right] = img_right;
+    img_owners_last[cam_id_left] = message.owners;
+    img_owners_last[cam_id_right] = message.owners;
     img_pyramid_last[cam_id_left] = imgpyr_left;
     img_pyramid_last[cam_id_right] = imgpyr_right;
     img_mask_last[cam_id_left] = mask_left;
@@ -379,28 +492,72 @@ void TrackKLT::feed_stereo(const CameraData &message, size_t msg_id_left, size_t
     ids_last[cam_id_left] = good_ids_left;
     ids_last[cam_id_right] = good_ids_right;
   }
-  rT6 = boost::posix_time::microsec_clock::local_time();
+  span_database.stop();
 
   //  // Timing information
-  PRINT_ALL("[TIME-KLT]: %.4f seconds for pyramid\n", (rT2 - rT1).total_microseconds() * 1e-6);
-  PRINT_ALL("[TIME-KLT]: %.4f seconds for detection (%d detected)\n", (rT3 - rT2).total_microseconds() * 1e-6,
+  PRINT_ALL("[TIME-KLT]: %.4f seconds for detection (%d detected)\n", span_detect.seconds(),
             (int)pts_last[cam_id_left].size() - pts_before_detect);
-  PRINT_ALL("[TIME-KLT]: %.4f seconds for temporal klt\n", (rT4 - rT3).total_microseconds() * 1e-6);
-  PRINT_ALL("[TIME-KLT]: %.4f seconds for stereo klt\n", (rT5 - rT4).total_microseconds() * 1e-6);
-  PRINT_ALL("[TIME-KLT]: %.4f seconds for feature DB update (%d features)\n", (rT6 - rT5).total_microseconds() * 1e-6,
-            (int)good_left.size());
-  PRINT_ALL("[TIME-KLT]: %.4f seconds for total\n", (rT6 - rT1).total_microseconds() * 1e-6);
+  PRINT_ALL("[TIME-KLT]: %.4f seconds for temporal klt\n", span_temporal.seconds());
+  PRINT_ALL("[TIME-KLT]: %.4f seconds for stereo klt\n", span_stereo.seconds());
+  PRINT_ALL("[TIME-KLT]: %.4f seconds for feature DB update (%d features)\n", span_database.seconds(), (int)good_left.size());
 }
 
-void TrackKLT::perform_detection_monocular(const std::vector<cv::Mat> &img0pyr, const cv::Mat &mask0, std::vector<cv::KeyPoint> &pts0,
-                                           std::vector<size_t> &ids0) {
+void TrackKLT::apply_cell_backoff(size_t cam_id, const cv::Mat &grid_occ, std::vector<bool> &valid_cells) {
 
-  // Create a 2D occupancy grid for this current image
+  // Lazily size the persistent state (also covers the grid dimensions changing)
+  CellBackoff &state = grid_backoff[cam_id];
+  size_t num_cells = (size_t)grid_x * grid_y;
+  if (state.backoff.size() != num_cells) {
+    state.backoff.assign(num_cells, 0);
+    state.streak.assign(num_cells, 0);
+    state.occ_last.assign(num_cells, 0);
+  }
+
+  // A cell that lost occupancy since the last call is retried immediately,
+  // otherwise cells that are backing off are removed from this extraction
+  for (int y = 0; y < grid_occ.rows; y++) {
+    for (int x = 0; x < grid_occ.cols; x++) {
+      size_t idx = (size_t)y * grid_x + x;
+      uint8_t occ = grid_occ.at<uint8_t>(y, x);
+      if (occ < state.occ_last.at(idx)) {
+        state.backoff.at(idx) = 0;
+        state.streak.at(idx) = 0;
+      }
+      state.occ_last.at(idx) = occ;
+      if (state.backoff.at(idx) > 0) {
+        state.backoff.at(idx)--;
+        valid_cells.at(idx) = false;
+      }
+    }
+  }
+}
+
+void TrackKLT::update_cell_backoff(size_t cam_id, const std::vector<int> &cell_counts) {
+
+  // Empty extractions grow the backoff exponentially (capped at 16 detection calls),
+  // any cell that produced points resets. Cells that were not extracted (negative
+  // count, e.g. skipped by the budget shortcut of the grider) keep their state.
+  CellBackoff &state = grid_backoff.at(cam_id);
+  for (size_t r = 0; r < cell_counts.size(); r++) {
+    if (cell_counts.at(r) == 0) {
+      state.streak.at(r) = (uint8_t)std::min((int)state.streak.at(r) + 1, 4);
+      state.backoff.at(r) = (uint8_t)(1 << state.streak.at(r));
+    } else if (cell_counts.at(r) > 0) {
+      state.streak.at(r) = 0;
+    }
+  }
+}
+
+void TrackKLT::perform_detection_monocular(const std::vector<cv::Mat> &img0pyr, const cv::Mat &mask0, size_t cam_id,
+                                           std::vector<cv::KeyPoint> &pts0, std::vector<size_t> &ids0) {
+
+  // Clear our persistent 2D occupancy grid for this current image (O(1) via generation stamp)
   // Note that we scale this down, so that each grid point is equal to a set of pixels
   // This means that we will reject points that less than grid_px_size points away then existing features
   cv::Size size_close((int)((float)img0pyr.at(0).cols / (float)min_px_dist),
                       (int)((float)img0pyr.at(0).rows / (float)min_px_dist)); // width x height
-  cv::Mat grid_2d_close = cv::Mat::zeros(size_close, CV_8UC1);
+  OccupancyGrid &grid_2d_close = grid_close_persistent.at(cam_id);
+  grid_2d_close.reset(size_close.width, size_close.height);
   float size_x = (float)img0pyr.at(0).cols / (float)grid_x;
   float size_y = (float)img0pyr.at(0).rows / (float)grid_y;
   cv::Size size_grid(grid_x, grid_y); // width x height
@@ -436,7 +593,7 @@ void TrackKLT::perform_detection_monocular(const std::vector<cv::Mat> &img0pyr,
       continue;
     }
     // Check if this keypoint is near another point
-    if (grid_2d_close.at<uint8_t>(y_close, x_close) > 127) {
+    if (grid_2d_close.occupied(x_close, y_close)) {
       it0 = pts0.erase(it0);
       it1 = ids0.erase(it1);
       continue;
@@ -449,7 +606,7 @@ void TrackKLT::perform_detection_monocular(const std::vector<cv::Mat> &img0pyr,
       continue;
     }
     // Else we are good, move forward to the next point
-    grid_2d_close.at<uint8_t>(y_close, x_close) = 255;
+    grid_2d_close.set(x_close, y_close);
     if (grid_2d_grid.at<uint8_t>(y_grid, x_grid) < 255) {
       grid_2d_grid.at<uint8_t>(y_grid, x_grid) += 1;
     }
@@ -482,16 +639,22 @@ void TrackKLT::perform_detection_monocular(const std::vector<cv::Mat> &img0pyr,
   // Create grids we need to extract from and then extract our features (use fast with griding)
   int num_features_grid = (int)((double)num_features / (double)(grid_x * grid_y)) + 1;
   int num_features_grid_req = std::max(1, (int)(min_feat_percent * num_features_grid));
-  std::vector<std::pair<int, int>> valid_locs;
+  std::vector<bool> &valid_cells = grid_valid_cells[cam_id];
+  valid_cells.assign((size_t)grid_x * grid_y, false);
   for (int x = 0; x < grid_2d_grid.cols; x++) {
     for (int y = 0; y < grid_2d_grid.rows; y++) {
       if ((int)grid_2d_grid.at<uint8_t>(y, x) < num_features_grid_req && (int)mask0_grid.at<uint8_t>(y, x) != 255) {
-        valid_locs.emplace_back(x, y);
+        valid_cells.at((size_t)y * grid_x + x) = true;
       }
     }
   }
+  apply_cell_backoff(cam_id, grid_2d_grid, valid_cells);
+  std::vector<int> &cell_counts = grid_backoff.at(cam_id).counts;
+  cell_counts.assign((size_t)grid_x * grid_y, -1);
   std::vector<cv::KeyPoint> pts0_ext;
-  Grider_GRID::perform_griding(img0pyr.at(0), mask0_updated, valid_locs, pts0_ext, num_features, grid_x, grid_y, threshold, true);
+  Grider_GRID::perform_griding(img0pyr.at(0), mask0_updated, valid_cells, pts0_ext, num_features, grid_x, grid_y, threshold, true,
+                               &cell_counts);
+  update_cell_backoff(cam_id, cell_counts);
 
   // Now, reject features that are close a current feature
   std::vector<cv::KeyPoint> kpts0_new;
@@ -503,26 +666,26 @@ void TrackKLT::perform_detection_monocular(const std::vector<cv::Mat> &img0pyr,
     if (x_grid < 0 || x_grid >= size_close.width || y_grid < 0 || y_grid >= size_close.height)
       continue;
     // See if there is a point at this location
-    if (grid_2d_close.at<uint8_t>(y_grid, x_grid) > 127)
+    if (grid_2d_close.occupied(x_grid, y_grid))
       continue;
     // Else lets add it!
     kpts0_new.push_back(kpt);
     pts0_new.push_back(kpt.pt);
-    grid_2d_close.at<uint8_t>(y_grid, x_grid) = 255;
+    grid_2d_close.set(x_grid, y_grid);
   }
 
   // Loop through and record only ones that are valid
-  // NOTE: if we multi-thread this atomic can cause some randomness due to multiple thread detecting features
+  // NOTE: if we multi-thread the shared id counter can cause some randomness due to multiple thread detecting features
   // NOTE: this is due to the fact that we select update features based on feat id
   // NOTE: thus the order will matter since we try to select oldest (smallest id) to update with
-  // NOTE: not sure how to remove... maybe a better way?
+  // NOTE: in deterministic mode next_feature_id() assigns per-camera id stripes to remove this
   for (size_t i = 0; i < pts0_new.size(); i++) {
     // update the uv coordinates
     kpts0_new.at(i).pt = pts0_new.at(i);
     // append the new uv coordinate
     pts0.push_back(kpts0_new.at(i));
     // move id foward and append this new point
-    size_t temp = ++currid;
+    size_t temp = next_feature_id(cam_id);
     ids0.push_back(temp);
   }
 }
@@ -536,7 +699,8 @@ void TrackKLT::perform_detection_stereo(const std::vector<cv::Mat> &img0pyr, con
   // This means that we will reject points that less then grid_px_size points away then existing features
   cv::Size size_close0((int)((float)img0pyr.at(0).cols / (float)min_px_dist),
                        (int)((float)img0pyr.at(0).rows / (float)min_px_dist)); // width x height
-  cv::Mat grid_2d_close0 = cv::Mat::zeros(size_close0, CV_8UC1);
+  OccupancyGrid &grid_2d_close0 = grid_close_persistent.at(cam_id_left);
+  grid_2d_close0.reset(size_close0.width, size_close0.height);
   float size_x0 = (float)img0pyr.at(0).cols / (float)grid_x;
   float size_y0 = (float)img0pyr.at(0).rows / (float)grid_y;
   cv::Size size_grid0(grid_x, grid_y); // width x height
@@ -572,7 +736,7 @@ void TrackKLT::perform_detection_stereo(const std::vector<cv::Mat> &img0pyr, con
       continue;
     }
     // Check if this keypoint is near another point
-    if (grid_2d_close0.at<uint8_t>(y_close, x_close) > 127) {
+    if (grid_2d_close0.occupied(x_close, y_close)) {
       it0 = pts0.erase(it0);
       it1 = ids0.erase(it1);
       continue;
@@ -585,7 +749,7 @@ void TrackKLT::perform_detection_stereo(const std::vector<cv::Mat> &img0pyr, con
       continue;
     }
     // Else we are good, move forward to the next point
-    grid_2d_close0.at<uint8_t>(y_close, x_close) = 255;
+    grid_2d_close0.set(x_close, y_close);
     if (grid_2d_grid0.at<uint8_t>(y_grid, x_grid) < 255) {
       grid_2d_grid0.at<uint8_t>(y_grid, x_grid) += 1;
     }
@@ -620,16 +784,22 @@ void TrackKLT::perform_detection_stereo(const std::vector<cv::Mat> &img0pyr, con
     // Create grids we need to extract from and then extract our features (use fast with griding)
     int num_features_grid = (int)((double)num_features / (double)(grid_x * grid_y)) + 1;
     int num_features_grid_req = std::max(1, (int)(min_feat_percent * num_features_grid));
-    std::vector<std::pair<int, int>> valid_locs;
+    std::vector<bool> &valid_cells = grid_valid_cells[cam_id_left];
+    valid_cells.assign((size_t)grid_x * grid_y, false);
     for (int x = 0; x < grid_2d_grid0.cols; x++) {
       for (int y = 0; y < grid_2d_grid0.rows; y++) {
         if ((int)grid_2d_grid0.at<uint8_t>(y, x) < num_features_grid_req && (int)mask0_grid.at<uint8_t>(y, x) != 255) {
-          valid_locs.emplace_back(x, y);
+          valid_cells.at((size_t)y * grid_x + x) = true;
         }
       }
     }
+    apply_cell_backoff(cam_id_left, grid_2d_grid0, valid_cells);
+    std::vector<int> &cell_counts = grid_backoff.at(cam_id_left).counts;
+    cell_counts.assign((size_t)grid_x * grid_y, -1);
     std::vector<cv::KeyPoint> pts0_ext;
-    Grider_GRID::perform_griding(img0pyr.at(0), mask0_updated, valid_locs, pts0_ext, num_features, grid_x, grid_y, threshold, true);
+    Grider_GRID::perform_griding(img0pyr.at(0), mask0_updated, valid_cells, pts0_ext, num_features, grid_x, grid_y, threshold, true,
+                                 &cell_counts);
+    update_cell_backoff(cam_id_left, cell_counts);
 
     // Now, reject features that are close a current feature
     std::vector<cv::KeyPoint> kpts0_new;
@@ -641,10 +811,10 @@ void TrackKLT::perform_detection_stereo(const std::vector<cv::Mat> &img0pyr, con
       if (x_grid < 0 || x_grid >= size_close0.width || y_grid < 0 || y_grid >= size_close0.height)
         continue;
       // See if there is a point at this location
-      if (grid_2d_close0.at<uint8_t>(y_grid, x_grid) > 127)
+      if (grid_2d_close0.occupied(x_grid, y_grid))
         continue;
       // Else lets add it!
-      grid_2d_close0.at<uint8_t>(y_grid, x_grid) = 255;
+      grid_2d_close0.set(x_grid, y_grid);
       kpts0_new.push_back(kpt);
       pts0_new.push_back(kpt.pt);
     }
@@ -652,24 +822,29 @@ void TrackKLT::perform_detection_stereo(const std::vector<cv::Mat> &img0pyr, con
     // TODO: Project points from the left frame into the right frame
     // TODO: This will not work for large baseline systems.....
     // TODO: If we had some depth estimates we could do a better projection
-    // TODO: Or project and search along the epipolar line??
     std::vector<cv::KeyPoint> kpts1_new;
     std::vector<cv::Point2f> pts1_new;
     kpts1_new = kpts0_new;
     pts1_new = pts0_new;
 
-    // If we have points, do KLT tracking to get the valid projections into the right image
+    // If we have points, get the valid projections into the right image
     if (!pts0_new.empty()) {
 
-      // Do our KLT tracking from the left to the right frame of reference
-      // NOTE: we have a pretty big window size here since our projection might be bad
+      // If the user gave us the fixed extrinsics of this pair, search along each feature's
+      // epipolar line in the right image, which is much cheaper than the 2d pyramidal solve
+      // Otherwise do our KLT tracking from the left to the right frame of reference
+      // NOTE: LK has a pretty big window size here since our projection might be bad
       // NOTE: but this might cause failure in cases of repeated textures (eg. checkerboard)
       std::vector<uchar> mask;
       // perform_matching(img0pyr, img1pyr, kpts0_new, kpts1_new, cam_id_left, cam_id_right, mask);
-      std::vector<float> error;
-      cv::TermCriteria term_crit = cv::TermCriteria(cv::TermCriteria::COUNT | cv::TermCriteria::EPS, 30, 0.01);
-      cv::calcOpticalFlowPyrLK(img0pyr, img1pyr, pts0_new, pts1_new, mask, error, win_size, pyr_levels, term_crit,
-                               cv::OPTFLOW_USE_INITIAL_FLOW);
+      if (stereo_extrinsics.find({cam_id_left, cam_id_right}) != stereo_extrinsics.end()) {
+        perform_epipolar_stereo_matching(img0pyr.at(0), img1pyr.at(0), cam_id_left, cam_id_right, pts0_new, pts1_new, mask);
+      } else {
+        std::vector<float> error;
+        cv::TermCriteria term_crit = cv::TermCriteria(cv::TermCriteria::COUNT | cv::TermCriteria::EPS, 30, 0.01);
+        cv::calcOpticalFlowPyrLK(img0pyr, img1pyr, pts0_new, pts1_new, mask, error, win_size, usable_pyr_levels(img0pyr, img1pyr, pyr_levels),
+                                 term_crit, cv::OPTFLOW_USE_INITIAL_FLOW);
+      }
 
       // Loop through and record only ones that are valid
       for (size_t i = 0; i < pts0_new.size(); i++) {
@@ -693,7 +868,7 @@ void TrackKLT::perform_detection_stereo(const std::vector<cv::Mat> &img0pyr, con
           pts0.push_back(kpts0_new.at(i));
           pts1.push_back(kpts1_new.at(i));
           // move id forward and append this new point
-          size_t temp = ++currid;
+          size_t temp = next_feature_id(cam_id_left);
           ids0.push_back(temp);
           ids1.push_back(temp);
         } else if (!oob_left) {
@@ -702,7 +877,7 @@ void TrackKLT::perform_detection_stereo(const std::vector<cv::Mat> &img0pyr, con
           // append the new uv coordinate
           pts0.push_back(kpts0_new.at(i));
           // move id forward and append this new point
-          size_t temp = ++currid;
+          size_t temp = next_feature_id(cam_id_left);
           ids0.push_back(temp);
         }
       }
@@ -713,7 +888,8 @@ void TrackKLT::perform_detection_stereo(const std::vector<cv::Mat> &img0pyr, con
   // RIGHT: We will try to extract some monocular features if we have the room
   // RIGHT: This will also remove features if there are multiple in the same location
   cv::Size size_close1((int)((float)img1pyr.at(0).cols / (float)min_px_dist), (int)((float)img1pyr.at(0).rows / (float)min_px_dist));
-  cv::Mat grid_2d_close1 = cv::Mat::zeros(size_close1, CV_8UC1);
+  OccupancyGrid &grid_2d_close1 = grid_close_persistent.at(cam_id_right);
+  grid_2d_close1.reset(size_close1.width, size_close1.height);
   float size_x1 = (float)img1pyr.at(0).cols / (float)grid_x;
   float size_y1 = (float)img1pyr.at(0).rows / (float)grid_y;
   cv::Size size_grid1(grid_x, grid_y); // width x height
@@ -752,7 +928,7 @@ void TrackKLT::perform_detection_stereo(const std::vector<cv::Mat> &img0pyr, con
     // NOTE: if it is *not* a stereo point, then we will not delete the feature
     // NOTE: this means we might have a mono and stereo feature near each other, but that is ok
     bool is_stereo = (std::find(ids0.begin(), ids0.end(), *it1) != ids0.end());
-    if (grid_2d_close1.at<uint8_t>(y_close, x_close) > 127 && !is_stereo) {
+    if (grid_2d_close1.occupied(x_close, y_close) && !is_stereo) {
       it0 = pts1.erase(it0);
       it1 = ids1.erase(it1);
       continue;
@@ -765,7 +941,7 @@ void TrackKLT::perform_detection_stereo(const std::vector<cv::Mat> &img0pyr, con
       continue;
     }
     // Else we are good, move forward to the next point
-    grid_2d_close1.at<uint8_t>(y_close, x_close) = 255;
+    grid_2d_close1.set(x_close, y_close);
     if (grid_2d_grid1.at<uint8_t>(y_grid, x_grid) < 255) {
       grid_2d_grid1.at<uint8_t>(y_grid, x_grid) += 1;
     }
@@ -796,16 +972,22 @@ void TrackKLT::perform_detection_stereo(const std::vector<cv::Mat> &img0pyr, con
     // Create grids we need to extract from and then extract our features (use fast with griding)
     int num_features_grid = (int)((double)num_features / (double)(grid_x * grid_y)) + 1;
     int num_features_grid_req = std::max(1, (int)(min_feat_percent * num_features_grid));
-    std::vector<std::pair<int, int>> valid_locs;
+    std::vector<bool> &valid_cells = grid_valid_cells[cam_id_right];
+    valid_cells.assign((size_t)grid_x * grid_y, false);
     for (int x = 0; x < grid_2d_grid1.cols; x++) {
       for (int y = 0; y < grid_2d_grid1.rows; y++) {
         if ((int)grid_2d_grid1.at<uint8_t>(y, x) < num_features_grid_req && (int)mask1_grid.at<uint8_t>(y, x) != 255) {
-          valid_locs.emplace_back(x, y);
+          valid_cells.at((size_t)y * grid_x + x) = true;
         }
       }
     }
+    apply_cell_backoff(cam_id_right, grid_2d_grid1, valid_cells);
+    std::vector<int> &cell_counts = grid_backoff.at(cam_id_right).counts;
+    cell_counts.assign((size_t)grid_x * grid_y, -1);
     std::vector<cv::KeyPoint> pts1_ext;
-    Grider_GRID::perform_griding(img1pyr.at(0), mask1_updated, valid_locs, pts1_ext, num_features, grid_x, grid_y, threshold, true);
+    Grider_GRID::perform_griding(img1pyr.at(0), mask1_updated, valid_cells, pts1_ext, num_features, grid_x, grid_y, threshold, true,
+                                 &cell_counts);
+    update_cell_backoff(cam_id_right, cell_counts);
 
     // Now, reject features that are close a current feature
     for (auto &kpt : pts1_ext) {
@@ -815,19 +997,162 @@ void TrackKLT::perform_detection_stereo(const std::vector<cv::Mat> &img0pyr, con
       if (x_grid < 0 || x_grid >= size_close1.width || y_grid < 0 || y_grid >= size_close1.height)
         continue;
       // See if there is a point at this location
-      if (grid_2d_close1.at<uint8_t>(y_grid, x_grid) > 127)
+      if (grid_2d_close1.occupied(x_grid, y_grid))
         continue;
       // Else lets add it!
       pts1.push_back(kpt);
-      size_t temp = ++currid;
+      size_t temp = next_feature_id(cam_id_right);
       ids1.push_back(temp);
-      grid_2d_close1.at<uint8_t>(y_grid, x_grid) = 255;
+      grid_2d_close1.set(x_grid, y_grid);
     }
   }
 }
 
+void TrackKLT::perform_epipolar_stereo_matching(const cv::Mat &img0, const cv::Mat &img1, size_t cam_id_left, size_t cam_id_right,
+                                                const std::vector<cv::Point2f> &pts0, std::vector<cv::Point2f> &pts1,
+                                                std::vector<uchar> &mask_out) {
+
+  // Fixed geometry of this pair and the two camera models
+  const auto &extrinsics = stereo_extrinsics.at({cam_id_left, cam_id_right});
+  const Eigen::Matrix3d &R_C0toC1 = extrinsics.first;
+  const Eigen::Vector3d &p_C0inC1 = extrinsics.second;
+  std::shared_ptr<CamBase> cam0 = camera_calib.at(cam_id_left);
+  std::shared_ptr<CamBase> cam1 = camera_calib.at(cam_id_right);
+
+  // Search parameters: the patch we correlate, the inverse depth range we sweep
+  // (infinity down to a quarter meter), the pixel spacing of the candidates along
+  // the curve, and the correlation quality we require to accept a match
+  const int halfpatch = 7;
+  const double rho_max = 1.0 / 0.25;
+  const double step_px = 2.0;
+  const double zncc_min = 0.80;
+  const double zncc_margin = 0.05;
+  const int max_cands = 512;
+  const int N = (2 * halfpatch + 1) * (2 * halfpatch + 1);
+
+  // Each point writes only its own slot, so the sweep is an independent task per feature
+  mask_out.assign(pts0.size(), (uchar)0);
+  ThreadPool::instance().parallel_for(0, (int)pts0.size(), [&](int i) {
+
+    // Reference patch around the left feature (skip it if one does not fit)
+    int x0 = (int)std::round(pts0.at(i).x);
+    int y0 = (int)std::round(pts0.at(i).y);
+    if (x0 < halfpatch || x0 >= img0.cols - halfpatch || y0 < halfpatch || y0 >= img0.rows - halfpatch)
+      return;
+
+    // Sums of the reference patch for the zncc (reject textureless patches outright)
+    int64_t sum0 = 0, sumsq0 = 0;
+    for (int r = -halfpatch; r <= halfpatch; r++) {
+      const uchar *row = img0.ptr<uchar>(y0 + r) + (x0 - halfpatch);
+      for (int c = 0; c < 2 * halfpatch + 1; c++) {
+        sum0 += row[c];
+        sumsq0 += (int)row[c] * (int)row[c];
+      }
+    }
+    double var0 = (double)N * (double)sumsq0 - (double)sum0 * (double)sum0;
+    if (var0 < 1e-8)
+      return;
+
+    // Scores the right patch centered at the given pixel against the reference patch
+    auto zncc_at = [&](int xc, int yc) -> double {
+      int64_t sum1 = 0, sumsq1 = 0, sum01 = 0;
+      for (int r = -halfpatch; r <= halfpatch; r++) {
+        const uchar *row0 = img0.ptr<uchar>(y0 + r) + (x0 - halfpatch);
+        const uchar *row1 = img1.ptr<uchar>(yc + r) + (xc - halfpatch);
+        for (int c = 0; c < 2 * halfpatch + 1; c++) {
+          sum1 += row1[c];
+          sumsq1 += (int)row1[c] * (int)row1[c];
+          sum01 += (int)row0[c] * (int)row1[c];
+        }
+      }
+      double var1 = (double)N * (double)sumsq1 - (double)sum1 * (double)sum1;
+      if (var1 < 1e-8)
+        return -1.0;
+      return ((double)N * (double)sum01 - (double)sum0 * (double)sum1) / std::sqrt(var0 * var1);
+    };
+
+    // March the bearing of the left feature along its epipolar curve in the right image,
+    // from infinity towards the closest depth, adapting the inverse depth step so that
+    // consecutive candidates land about step_px pixels apart
+    cv::Point2f ptn = cam0->undistort_cv(pts0.at(i));
+    Eigen::Vector3d b0(ptn.x, ptn.y, 1.0);
+    std::vector<cv::Point2f> cand_pts;
+    std::vector<double> cand_scores;
+    double rho = 0.0;
+    double drho = 1e-4;
+    bool have_prev = false;
+    cv::Point2f pt_prev;
+    int last_x = -1, last_y = -1;
+    while ((int)cand_pts.size() < max_cands && rho <= rho_max) {
+
+      // Project the candidate at this inverse depth into the right image
+      Eigen::Vector3d h = R_C0toC1 * b0 + rho * p_C0inC1;
+      if (h(2) < 1e-3)
+        break;
+      Eigen::Vector2f uv = cam1->distort_f(Eigen::Vector2f((float)(h(0) / h(2)), (float)(h(1) / h(2))));
+      cv::Point2f pt(uv(0), uv(1));
+
+      // Adapt the inverse depth step towards step_px pixel moves along the curve
+      if (have_prev) {
+        double move = std::hypot(pt.x - pt_prev.x, pt.y - pt_prev.y);
+        if (move > 1e-6)
+          drho = std::max(1e-6, std::min(1e-1, drho * step_px / move));
+      }
+      have_prev = true;
+      pt_prev = pt;
+      rho += drho;
+
+      // Only score candidates that are inside the image and landed on a new pixel
+      int x1 = (int)std::round(pt.x);
+      int y1 = (int)std::round(pt.y);
+      if (x1 < halfpatch || x1 >= img1.cols - halfpatch || y1 < halfpatch || y1 >= img1.rows - halfpatch)
+        continue;
+      if (x1 == last_x && y1 == last_y)
+        continue;
+      last_x = x1;
+      last_y = y1;
+      cand_pts.push_back(pt);
+      cand_scores.push_back(zncc_at(x1, y1));
+    }
+
+    // Find the best candidate, and the best one that is not part of the same peak,
+    // so we can reject repeated textures that correlate equally well elsewhere
+    int best_idx = -1;
+    double best = -1.0;
+    for (size_t k = 0; k < cand_scores.size(); k++) {
+      if (cand_scores.at(k) > best) {
+        best = cand_scores.at(k);
+        best_idx = (int)k;
+      }
+    }
+    double second = -1.0;
+    for (size_t k = 0; k < cand_scores.size(); k++) {
+      if (std::abs((int)k - best_idx) > 4)
+        second = std::max(second, cand_scores.at(k));
+    }
+    if (best_idx < 0 || best < zncc_min || best - second < zncc_margin)
+      return;
+
+    // Refine to subpixel along the curve with a parabolic fit over the neighboring scores
+    cv::Point2f pt_best = cand_pts.at(best_idx);
+    if (best_idx > 0 && best_idx < (int)cand_pts.size() - 1) {
+      double s_m = cand_scores.at(best_idx - 1);
+      double s_p = cand_scores.at(best_idx + 1);
+      double denom = s_m - 2.0 * best + s_p;
+      if (denom < -1e-9) {
+        double delta = std::max(-0.5, std::min(0.5, 0.5 * (s_m - s_p) / denom));
+        pt_best.x += (float)(delta * 0.5 * (cand_pts.at(best_idx + 1).x - cand_pts.at(best_idx - 1).x));
+        pt_best.y += (float)(delta * 0.5 * (cand_pts.at(best_idx + 1).y - cand_pts.at(best_idx - 1).y));
+      }
+    }
+    pts1.at(i) = pt_best;
+    mask_out.at(i) = 1;
+  });
+}
+
 void TrackKLT::perform_matching(const std::vector<cv::Mat> &img0pyr, const std::vector<cv::Mat> &img1pyr, std::vector<cv::KeyPoint> &kpts0,
-                                std::vector<cv::KeyPoint> &kpts1, size_t id0, size_t id1, std::vector<uchar> &mask_out) {
+                                std::vector<cv::KeyPoint> &kpts1, const std::vector<size_t> &ids0, size_t id0, size_t id1,
+                                std::vector<uchar> &mask_out) {
 
   // We must have equal vectors
   assert(kpts0.size() == kpts1.size());
@@ -851,19 +1176,123 @@ void TrackKLT::perform_matching(const std::vector<cv::Mat> &img0pyr, const std::
     return;
   }
 
+  // If the user gave us a predicted rotation for this temporal pair, warp the old feature
+  // locations through it so LK starts its search where each feature should now appear.
+  // Rotation is the dominant part of the apparent motion for fast maneuvers, so this keeps
+  // the true match within a much smaller effective search range of the initial flow seeds.
+  if (id0 == id1) {
+    Eigen::Matrix3d R_C0toC1;
+    bool have_prediction = false;
+    {
+      std::lock_guard<std::mutex> lckv(mtx_predicted_rotations);
+      auto it = predicted_rotations.find(id0);
+      if (it != predicted_rotations.end()) {
+        R_C0toC1 = it->second;
+        predicted_rotations.erase(it);
+        have_prediction = true;
+      }
+    }
+    if (have_prediction) {
+      std::shared_ptr<CamBase> camera = camera_calib.at(id0);
+      float width = (float)img1pyr.at(0).cols;
+      float height = (float)img1pyr.at(0).rows;
+      for (size_t i = 0; i < pts1.size(); i++) {
+        // Rotate the bearing of the old feature into the new camera frame
+        cv::Point2f pt_n = camera->undistort_cv(pts1.at(i));
+        Eigen::Vector3d bearing = R_C0toC1 * Eigen::Vector3d(pt_n.x, pt_n.y, 1.0);
+        if (bearing(2) < 0.1)
+          continue;
+        // Only move the seed if the re-distorted prediction lands inside the new image
+        Eigen::Vector2f uv_dist = camera->distort_f(Eigen::Vector2f((float)(bearing(0) / bearing(2)), (float)(bearing(1) / bearing(2))));
+        if (uv_dist(0) < 0 || uv_dist(0) >= width || uv_dist(1) < 0 || uv_dist(1) >= height)
+          continue;
+        pts1.at(i) = cv::Point2f(uv_dist(0), uv_dist(1));
+      }
+    }
+  }
+
   // Now do KLT tracking to get the valid new points
+  // If requested (and possible) this is dispatched to the GPU, otherwise we
+  // fall back to the stock CPU pyramidal LK on the precomputed pyramids
   std::vector<uchar> mask_klt;
-  std::vector<float> error;
-  cv::TermCriteria term_crit = cv::TermCriteria(cv::TermCriteria::COUNT | cv::TermCriteria::EPS, 30, 0.01);
-  cv::calcOpticalFlowPyrLK(img0pyr, img1pyr, pts0, pts1, mask_klt, error, win_size, pyr_levels, term_crit, cv::OPTFLOW_USE_INITIAL_FLOW);
+  bool tracked_on_gpu = false;
+#if defined(HAVE_OPENCV_CUDAOPTFLOW)
+  if (use_gpu)
+    tracked_on_gpu = perform_matching_gpu(img0pyr.at(0), img1pyr.at(0), pts0, pts1, mask_klt);
+#endif
+  if (!tracked_on_gpu) {
+
+    // If multi-resolution tracking is enabled, find the temporal tracks that have survived
+    // long enough to be considered stable (their flow seed is already close, so the cheap
+    // half-resolution solve is accurate enough for them)
+    std::vector<bool> is_stable(pts0.size(), false);
+    size_t num_stable = 0;
+    if (use_multires && id0 == id1 && ids0.size() == pts0.size() && img0pyr.size() > 2 && img1pyr.size() > 2) {
+      for (size_t i = 0; i < ids0.size(); i++) {
+        if (database->get_track_length(ids0.at(i)) >= (size_t)multires_stable_age) {
+          is_stable.at(i) = true;
+          num_stable++;
+        }
+      }
+    }
+
+    std::vector<float> error;
+    cv::TermCriteria term_crit = cv::TermCriteria(cv::TermCriteria::COUNT | cv::TermCriteria::EPS, 30, 0.01);
+    if (num_stable == 0) {
+      cv::calcOpticalFlowPyrLK(img0pyr, img1pyr, pts0, pts1, mask_klt, error, win_size, usable_pyr_levels(img0pyr, img1pyr, pyr_levels),
+                               term_crit, cv::OPTFLOW_USE_INITIAL_FLOW);
+    } else {
+
+      // Split the points into the two tiers (stable points are moved into half-resolution coordinates)
+      std::vector<cv::Point2f> pts0_full, pts1_full, pts0_half, pts1_half;
+      for (size_t i = 0; i < pts0.size(); i++) {
+        if (is_stable.at(i)) {
+          pts0_half.push_back(0.5f * pts0.at(i));
+          pts1_half.push_back(0.5f * pts1.at(i));
+        } else {
+          pts0_full.push_back(pts0.at(i));
+          pts1_full.push_back(pts1.at(i));
+        }
+      }
+
+      // New and uncertain features still get the full-resolution solve
+      std::vector<uchar> mask_full, mask_half;
+      if (!pts0_full.empty()) {
+        cv::calcOpticalFlowPyrLK(img0pyr, img1pyr, pts0_full, pts1_full, mask_full, error, win_size,
+                                 usable_pyr_levels(img0pyr, img1pyr, pyr_levels), term_crit, cv::OPTFLOW_USE_INITIAL_FLOW);
+      }
+
+      // Stable tracks are matched on a view of the pyramids that starts at the half-resolution
+      // level (each level is an image + derivative pair), with a halved window. The build-time
+      // window padding is larger than this window, so the precomputed levels can be reused as-is.
+      if (!pts0_half.empty()) {
+        std::vector<cv::Mat> img0pyr_half(img0pyr.begin() + 2, img0pyr.end());
+        std::vector<cv::Mat> img1pyr_half(img1pyr.begin() + 2, img1pyr.end());
+        cv::Size win_half(win_size.width / 2 + 1, win_size.height / 2 + 1);
+        cv::calcOpticalFlowPyrLK(img0pyr_half, img1pyr_half, pts0_half, pts1_half, mask_half, error, win_half,
+                                 usable_pyr_levels(img0pyr_half, img1pyr_half, pyr_levels - 1), term_crit, cv::OPTFLOW_USE_INITIAL_FLOW);
+      }
+
+      // Scatter the results back into the original order (half-resolution results are scaled up)
+      mask_klt.resize(pts0.size());
+      size_t idx_full = 0, idx_half = 0;
+      for (size_t i = 0; i < pts0.size(); i++) {
+        if (is_stable.at(i)) {
+          pts1.at(i) = 2.f * pts1_half.at(idx_half);
+          mask_klt.at(i) = mask_half.at(idx_half++);
+        } else {
+          pts1.at(i) = pts1_full.at(idx_full);
+          mask_klt.at(i) = mask_full.at(idx_full++);
+        }
+      }
+    }
+  }
 
   // Normalize these points, so we can then do ransac
   // We don't want to do ransac on distorted image uvs since the mapping is nonlinear
   std::vector<cv::Point2f> pts0_n, pts1_n;
-  for (size_t i = 0; i < pts0.size(); i++) {
-    pts0_n.push_back(camera_calib.at(id0)->undistort_cv(pts0.at(i)));
-    pts1_n.push_back(camera_calib.at(id1)->undistort_cv(pts1.at(i)));
-  }
+  camera_calib.at(id0)->undistort_batch_cv(pts0, pts0_n);
+  camera_calib.at(id1)->undistort_batch_cv(pts1, pts1_n);
 
   // Do RANSAC outlier rejection (note since we normalized the max pixel error is now in the normalized cords)
   std::vector<uchar> mask_rsc;
@@ -884,3 +1313,79 @@ void TrackKLT::perform_matching(const std::vector<cv::Mat> &img0pyr, const std::
     kpts1.at(i).pt = pts1.at(i);
   }
 }
+
+#if defined(HAVE_OPENCV_CUDAOPTFLOW)
+
+bool TrackKLT::perform_matching_gpu(const cv::Mat &img0, const cv::Mat &img1, std::vector<cv::Point2f> &pts0,
+                                    std::vector<cv::Point2f> &pts1, std::vector<uchar> &mask_out) {
+
+  // Fall back to the CPU path if there is no device (warn only the first time)
+  static std::atomic<bool> warned(false);
+  if (cv::cuda::getCudaEnabledDeviceCount() < 1) {
+    if (!warned.exchange(true)) {
+      PRINT_WARNING(YELLOW "[KLT]: gpu tracking requested but no CUDA device found, using cpu!\n" RESET);
+    }
+    return false;
+  }
+
+  // One solver and one upload stream are shared by all cameras
+  std::lock_guard<std::mutex> lck(mtx_gpu);
+  if (gpu_pyrlk == nullptr)
+    gpu_pyrlk = cv::cuda::SparsePyrLKOpticalFlow::create(win_size, pyr_levels, 30, true);
+
+  // Upload each distinct image once (the device builds its own pyramid)
+  cv::cuda::GpuMat &gpu_img0 = get_gpu_image(img0);
+  cv::cuda::GpuMat &gpu_img1 = get_gpu_image(img1);
+
+  // Upload the points, run the flow with our predictions as the initial guess
+  cv::Mat pts0_mat(1, (int)pts0.size(), CV_32FC2, pts0.data());
+  cv::Mat pts1_mat(1, (int)pts1.size(), CV_32FC2, pts1.data());
+  cv::cuda::GpuMat gpu_pts0, gpu_pts1, gpu_status;
+  gpu_pts0.upload(pts0_mat, gpu_stream);
+  gpu_pts1.upload(pts1_mat, gpu_stream);
+  gpu_pyrlk->calc(gpu_img0, gpu_img1, gpu_pts0, gpu_pts1, gpu_status, cv::noArray(), gpu_stream);
+
+  // Download the tracked positions straight back into the caller's vector
+  gpu_pts1.download(pts1_mat, gpu_stream);
+  cv::Mat status_mat;
+  gpu_status.download(status_mat, gpu_stream);
+  gpu_stream.waitForCompletion();
+  mask_out.assign(status_mat.ptr<uchar>(), status_mat.ptr<uchar>() + pts1.size());
+  return true;
+}
+
+cv::cuda::GpuMat &TrackKLT::get_gpu_image(const cv::Mat &img) {
+
+  // Reuse the device copy if this exact image was already uploaded
+  auto it = gpu_img_cache.find(img.data);
+  if (it != gpu_img_cache.end())
+    return it->second;
+
+  // Copy into the pinned staging buffer so the upload itself is asynchronous
+  gpu_staging.create(img.rows, img.cols, img.type());
+  img.copyTo(gpu_staging.createMatHeader());
+  cv::cuda::GpuMat &gpu_img = gpu_img_cache[img.data];
+  gpu_img.upload(gpu_staging, gpu_stream);
+  gpu_stream.waitForCompletion();
+  return gpu_img;
+}
+
+void TrackKLT::prune_gpu_cache() {
+
+  // The only images we can still be asked to match against are the last frame
+  // of each camera and any staged pre-computations, keep just those
+  std::vector<const void *> keep;
+  for (const auto &pyr : img_pyramid_last) {
+    if (!pyr.second.empty())
+      keep.push_back(pyr.second.at(0).data);
+  }
+  for (const auto &pyr : precomp_pyrs) {
+    if (!pyr.second.empty())
+      keep.push_back(pyr.second.at(0).data);
+  }
+  for (auto it = gpu_img_cache.begin(); it != gpu_img_cache.end();) {
+    it = (std::find(keep.begin(), keep.end(), it->first) == keep.end()) ? gpu_img_cache.erase(it) : ++it;
+  }
+}
+
+#endif
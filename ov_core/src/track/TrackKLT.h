@@ -24,6 +24,14 @@
 
 #include "TrackBase.h"
 
+#include <algorithm>
+#include <array>
+
+#if defined(HAVE_OPENCV_CUDAOPTFLOW)
+#include <opencv2/core/cuda.hpp>
+#include <opencv2/cudaoptflow.hpp>
+#endif
+
 namespace ov_core {
 
 /**
@@ -35,6 +43,9 @@ namespace ov_core {
  * to find the stereo correspondence information also.
  * This uses the [calcOpticalFlowPyrLK](https://github.com/opencv/opencv/blob/master/modules/video/src/lkpyramid.cpp)
  * OpenCV function to do the KLT tracking.
+ * If OpenCV was built with the CUDA optical flow module the pyramid build and
+ * pyramidal LK can instead be dispatched to the GPU (see the gpu constructor flag),
+ * with an automatic fallback to the CPU path when no device is available.
  */
 class TrackKLT : public TrackBase {
 
@@ -50,11 +61,26 @@ public:
    * @param gridx size of grid in the x-direction / u-direction
    * @param gridy size of grid in the y-direction / v-direction
    * @param minpxdist features need to be at least this number pixels away from each other
+   * @param gpu if we should try to run the optical flow on the GPU (ignored if OpenCV has no CUDA support)
+   * @param multires if long-lived tracks should be matched on the half-resolution pyramid levels
+   * @param multires_age number of frames a track has to survive before it is demoted to half resolution
    */
   explicit TrackKLT(std::unordered_map<size_t, std::shared_ptr<CamBase>> cameras, int numfeats, int numaruco, bool stereo,
-                    HistogramMethod histmethod, int fast_threshold, int gridx, int gridy, int minpxdist)
+                    HistogramMethod histmethod, int fast_threshold, int gridx, int gridy, int minpxdist, bool gpu = false,
+                    bool multires = false, int multires_age = 15)
       : TrackBase(cameras, numfeats, numaruco, stereo, histmethod), threshold(fast_threshold), grid_x(gridx), grid_y(gridy),
-        min_px_dist(minpxdist) {}
+        min_px_dist(minpxdist), use_multires(multires), multires_stable_age(multires_age), use_gpu(gpu) {
+    // Pre-insert the pre-computation slots so the pipeline thread never inserts concurrently
+    for (auto const &pair : camera_calib) {
+      precomp_timestamps[pair.first] = -1;
+      precomp_imgs[pair.first];
+      precomp_pyrs[pair.first];
+      pyr_pool[pair.first];
+      pyr_pool_idx[pair.first] = 0;
+      img_pyramid_last[pair.first];
+      img_pyramid_curr[pair.first];
+    }
+  }
 
   /**
    * @brief Process a new image
@@ -62,6 +88,31 @@ public:
    */
   void feed_new_camera(const CameraData &message) override;
 
+  /**
+   * @brief Pre-computes the image pre-processing and pyramids for a future image
+   * @param message Contains our timestamp, images, and camera ids
+   *
+   * This can be called at enqueue time (e.g. from the camera callback) so the histogram
+   * equalization and cv::buildOpticalFlowPyramid work overlaps with the filter update of
+   * the previous frame. When feed_new_camera() later runs for the same timestamp it will
+   * pick up the cached pyramids instead of building them on the critical path.
+   */
+  void precompute_pyramids(const CameraData &message);
+
+  /// Getter method for the FAST detection threshold
+  int get_detection_threshold() override { return threshold; }
+
+  /// Setter method for the FAST detection threshold
+  void set_detection_threshold(int _threshold) override { threshold = _threshold; }
+
+  /// Getter method for the number of pyramid levels the KLT tracks over
+  int get_pyramid_levels() { return pyr_levels; }
+
+  /// Setter method for the number of pyramid levels (takes effect on the next pyramid build)
+  /// Tracking against pyramids built with an older setting is safe since the LK calls
+  /// clamp to the levels those pyramids actually contain
+  void set_pyramid_levels(int levels) { pyr_levels = std::max(1, levels); }
+
 protected:
   /**
    * @brief Process a new monocular image
@@ -82,6 +133,7 @@ protected:
    * @brief Detects new features in the current image
    * @param img0pyr image we will detect features on (first level of pyramid)
    * @param mask0 mask which has what ROI we do not want features in
+   * @param cam_id camera sensor id (selects the persistent occupancy grid)
    * @param pts0 vector of currently extracted keypoints in this image
    * @param ids0 vector of feature ids for each currently extracted keypoint
    *
@@ -89,8 +141,8 @@ protected:
    * Will try to always have the "max_features" being tracked through KLT at each timestep.
    * Passed images should already be grayscaled.
    */
-  void perform_detection_monocular(const std::vector<cv::Mat> &img0pyr, const cv::Mat &mask0, std::vector<cv::KeyPoint> &pts0,
-                                   std::vector<size_t> &ids0);
+  void perform_detection_monocular(const std::vector<cv::Mat> &img0pyr, const cv::Mat &mask0, size_t cam_id,
+                                   std::vector<cv::KeyPoint> &pts0, std::vector<size_t> &ids0);
 
   /**
    * @brief Detects new features in the current stereo pair
@@ -114,12 +166,35 @@ protected:
                                 const cv::Mat &mask1, size_t cam_id_left, size_t cam_id_right, std::vector<cv::KeyPoint> &pts0,
                                 std::vector<cv::KeyPoint> &pts1, std::vector<size_t> &ids0, std::vector<size_t> &ids1);
 
+  /**
+   * @brief Epipolar-guided stereo matching of freshly detected features
+   * @param img0 left image (first level of its pyramid)
+   * @param img1 right image (first level of its pyramid)
+   * @param cam_id_left first camera sensor id
+   * @param cam_id_right second camera sensor id
+   * @param pts0 detected points in the left image
+   * @param pts1 matched points in the right image (only valid where mask_out is set)
+   * @param mask_out which points found a confident correspondence
+   *
+   * Alternative to the pyramidal LK stereo leg for rigs whose extrinsics are known and fixed
+   * (see TrackBase::set_stereo_extrinsics()). Each left feature's bearing is swept along its
+   * epipolar curve in the right image, parameterized by inverse depth and marched at roughly
+   * constant pixel steps, so the search is 1d and works directly on the distorted images with
+   * no rectification. Candidates are scored with ZNCC over patch rows (the contiguous uchar
+   * row loops auto-vectorize), and the best score is refined to subpixel along the curve with
+   * a parabolic fit. Low-texture patches and ambiguous correlation peaks are rejected.
+   */
+  void perform_epipolar_stereo_matching(const cv::Mat &img0, const cv::Mat &img1, size_t cam_id_left, size_t cam_id_right,
+                                        const std::vector<cv::Point2f> &pts0, std::vector<cv::Point2f> &pts1,
+                                        std::vector<uchar> &mask_out);
+
   /**
    * @brief KLT track between two images, and do RANSAC afterwards
    * @param img0pyr starting image pyramid
    * @param img1pyr image pyramid we want to track too
    * @param pts0 starting points
    * @param pts1 points we have tracked
+   * @param ids0 feature ids of the starting points (used to tier tracks by their age)
    * @param id0 id of the first camera
    * @param id1 id of the second camera
    * @param mask_out what points had valid tracks
@@ -127,9 +202,38 @@ protected:
    * This will track features from the first image into the second image.
    * The two point vectors will be of equal size, but the mask_out variable will specify which points are good or bad.
    * If the second vector is non-empty, it will be used as an initial guess of where the keypoints are in the second image.
+   * If multi-resolution tracking is enabled, long-lived tracks (as reported by the feature database)
+   * are matched on the half-resolution pyramid levels with a smaller window, since a track that has
+   * survived many frames is well localized and its initial flow guess is already close. Only the
+   * new and uncertain features pay for the full-resolution solve, which roughly halves the LK cost
+   * in steady state on high resolution streams.
    */
   void perform_matching(const std::vector<cv::Mat> &img0pyr, const std::vector<cv::Mat> &img1pyr, std::vector<cv::KeyPoint> &pts0,
-                        std::vector<cv::KeyPoint> &pts1, size_t id0, size_t id1, std::vector<uchar> &mask_out);
+                        std::vector<cv::KeyPoint> &pts1, const std::vector<size_t> &ids0, size_t id0, size_t id1,
+                        std::vector<uchar> &mask_out);
+
+#if defined(HAVE_OPENCV_CUDAOPTFLOW)
+  /**
+   * @brief GPU pyramidal LK between two full-resolution images
+   * @param img0 starting image (first level of its pyramid)
+   * @param img1 image we want to track into (first level of its pyramid)
+   * @param pts0 starting points
+   * @param pts1 tracked points (used as the initial flow guess)
+   * @param mask_out status of each tracked point
+   * @return True if the flow was computed on the device, false to use the CPU path
+   *
+   * The device builds its own pyramid from the full-resolution image, which is
+   * uploaded once per frame through a pinned staging buffer (see get_gpu_image()).
+   */
+  bool perform_matching_gpu(const cv::Mat &img0, const cv::Mat &img1, std::vector<cv::Point2f> &pts0, std::vector<cv::Point2f> &pts1,
+                            std::vector<uchar> &mask_out);
+
+  /// Uploads the given host image through the pinned staging buffer (cached per frame, needs mtx_gpu)
+  cv::cuda::GpuMat &get_gpu_image(const cv::Mat &img);
+
+  /// Drops device copies of images that are no longer the last frame of any camera (needs mtx_gpu)
+  void prune_gpu_cache();
+#endif
 
   // Parameters for our FAST grid detector
   int threshold;
@@ -143,10 +247,95 @@ protected:
   int pyr_levels = 5;
   cv::Size win_size = cv::Size(15, 15);
 
+  // Multi-resolution tracking mode: temporal tracks older than the stable age are
+  // matched starting from the half-resolution pyramid level with a smaller window
+  bool use_multires = false;
+  int multires_stable_age = 15;
+
+  // Reusable per-camera cell masks handed to the grid extractor (true = extract in that cell)
+  std::map<size_t, std::vector<bool>> grid_valid_cells;
+
+  /**
+   * @brief Removes cells that are backing off from the requested extraction cells
+   * @param cam_id Camera the detection is running on (selects the persistent state)
+   * @param grid_occ Current per-cell feature occupancy (CV_8UC1, grid_y by grid_x)
+   * @param valid_cells Cells the detector wants to extract in (backing-off cells are cleared)
+   *
+   * Cells that keep coming up empty (e.g. sky or a white wall) would otherwise pay for a
+   * FAST extraction on every detection call. We back such barren cells off for an
+   * exponentially growing (capped) number of detection calls, while any cell whose
+   * occupancy dropped since the last call is retried immediately, so detection effort
+   * concentrates on the cells that actually vacated.
+   */
+  void apply_cell_backoff(size_t cam_id, const cv::Mat &grid_occ, std::vector<bool> &valid_cells);
+
+  /**
+   * @brief Updates the barren-cell backoff state after an extraction
+   * @param cam_id Camera the detection ran on
+   * @param cell_counts Per-cell extraction counts from the grid extractor (negative = not extracted)
+   */
+  void update_cell_backoff(size_t cam_id, const std::vector<int> &cell_counts);
+
+  // Per-camera barren-cell backoff state for detection (see apply_cell_backoff())
+  struct CellBackoff {
+    std::vector<uint8_t> backoff;  // detection calls left before the cell may be extracted again
+    std::vector<uint8_t> streak;   // consecutive empty extractions of the cell
+    std::vector<uint8_t> occ_last; // cell occupancy at the last detection call
+    std::vector<int> counts;       // scratch buffer handed to the grid extractor
+  };
+  std::map<size_t, CellBackoff> grid_backoff;
+
   // Last set of image pyramids
   std::map<size_t, std::vector<cv::Mat>> img_pyramid_last;
   std::map<size_t, cv::Mat> img_curr;
   std::map<size_t, std::vector<cv::Mat>> img_pyramid_curr;
+
+  // Asynchronously pre-computed pyramids (guarded by the per-camera feed mutex)
+  std::map<size_t, double> precomp_timestamps;
+  std::map<size_t, cv::Mat> precomp_imgs;
+  std::map<size_t, std::vector<cv::Mat>> precomp_pyrs;
+
+  /**
+   * @brief Builds the optical flow pyramid for a camera into pooled storage
+   * @param cam_id Camera the image came from (selects the pool)
+   * @param img Pre-processed image to build the pyramid from
+   * @return Reference to the pooled pyramid that was just built
+   *
+   * Each camera owns a small set of pyramid buffers which are reused frame to frame,
+   * skipping any buffer whose storage is still referenced by the last frame, the
+   * current frame, or a not-yet-consumed precompute. cv::buildOpticalFlowPyramid
+   * only re-allocates a level when its padded size changes, thus after warm-up every
+   * level is written into a stable allocation instead of faulting in fresh pages
+   * every frame. Must be called with the per-camera feed mutex held.
+   */
+  std::vector<cv::Mat> &build_pyramid_pooled(size_t cam_id, const cv::Mat &img);
+
+  // Dedicated preprocessing buffer for the precompute path, which may overlap the
+  // previous frame's feed_new_camera() and so cannot share the base-class buffer
+  CameraData precomp_preprocess_buffer;
+
+  // Pooled per-camera pyramid allocations (guarded by the per-camera feed mutex)
+  // Four buffers cover the worst case of distinct last/current/precomputed pyramids
+  std::map<size_t, std::array<std::vector<cv::Mat>, 4>> pyr_pool;
+  std::map<size_t, size_t> pyr_pool_idx;
+
+  // If we should try to dispatch the optical flow to the GPU
+  bool use_gpu = false;
+
+#if defined(HAVE_OPENCV_CUDAOPTFLOW)
+  // Cached device-side sparse pyramidal LK solver (shared by all cameras)
+  cv::Ptr<cv::cuda::SparsePyrLKOpticalFlow> gpu_pyrlk;
+
+  // Uploaded images keyed by their host data pointer, so each frame is copied to
+  // the device once even though it is matched temporally and across the stereo pair
+  std::map<const void *, cv::cuda::GpuMat> gpu_img_cache;
+
+  // Pinned staging buffer and stream, so uploads at enqueue time (see
+  // precompute_pyramids) overlap the previous frame's filter update
+  cv::cuda::HostMem gpu_staging;
+  cv::cuda::Stream gpu_stream;
+  std::mutex mtx_gpu;
+#endif
 };
 
 } // namespace ov_core
@@ -46,6 +46,7 @@ void TrackSIM::feed_measurement_simulation(double timestamp, const std::vector<i
     // Update our feature database, with theses new observations
     // NOTE: we add the "currid" since we need to offset the simulator
     // NOTE: ids by the number of aruoc tags we have specified as tracking
+    std::shared_ptr<CamBase> camera = camera_calib.at(cam_id);
     for (const auto &feat : feats.at(i)) {
 
       // Get our id value
@@ -59,21 +60,25 @@ void TrackSIM::feed_measurement_simulation(double timestamp, const std::vector<i
       good_ids_left.push_back(id);
 
       // Append to the database
-      cv::Point2f npt_l = camera_calib.at(cam_id)->undistort_cv(kpt.pt);
+      cv::Point2f npt_l = camera->undistort_cv(kpt.pt);
       database->update_feature(id, timestamp, cam_id, kpt.pt.x, kpt.pt.y, npt_l.x, npt_l.y);
     }
 
     // Get our width and height
-    int width = camera_calib.at(cam_id)->w();
-    int height = camera_calib.at(cam_id)->h();
+    int width = camera->w();
+    int height = camera->h();
 
     // Move forward in time
+    // The placeholder images are only there so the display functions have something
+    // to draw on, so allocate them once and reuse them every following frame
     {
       std::lock_guard<std::mutex> lckv(mtx_last_vars);
-      img_last[cam_id] = cv::Mat::zeros(cv::Size(width, height), CV_8UC1);
-      img_mask_last[cam_id] = cv::Mat::zeros(cv::Size(width, height), CV_8UC1);
-      pts_last[cam_id] = good_left;
-      ids_last[cam_id] = good_ids_left;
+      if (img_last[cam_id].rows != height || img_last[cam_id].cols != width) {
+        img_last[cam_id] = cv::Mat::zeros(cv::Size(width, height), CV_8UC1);
+        img_mask_last[cam_id] = cv::Mat::zeros(cv::Size(width, height), CV_8UC1);
+      }
+      pts_last[cam_id] = std::move(good_left);
+      ids_last[cam_id] = std::move(good_ids_left);
     }
   }
 }
@@ -54,6 +54,14 @@ public:
     std::exit(EXIT_FAILURE);
   }
 
+  /**
+   * @brief Feed function for synchronized simulated cameras
+   * @param message Simulated uv observations for this timestep (no images involved)
+   */
+  void feed_measurement_simulation(const SimCameraData &message) {
+    feed_measurement_simulation(message.timestamp, message.sensor_ids, message.feats);
+  }
+
   /**
    * @brief Feed function for a synchronized simulated cameras
    * @param timestamp Time that this image was collected
@@ -155,22 +155,22 @@ public:
   }
 
   /// Rotation access
-  Eigen::Matrix<double, 3, 3> Rot() const { return _pose->Rot(); }
+  const Eigen::Matrix<double, 3, 3> &Rot() const { return _pose->Rot(); }
 
   /// FEJ Rotation access
-  Eigen::Matrix<double, 3, 3> Rot_fej() const { return _pose->Rot_fej(); }
+  const Eigen::Matrix<double, 3, 3> &Rot_fej() const { return _pose->Rot_fej(); }
 
   /// Rotation access quaternion
-  Eigen::Matrix<double, 4, 1> quat() const { return _pose->quat(); }
+  const Eigen::Matrix<double, 4, 1> &quat() const { return _pose->quat(); }
 
   /// FEJ Rotation access quaternion
-  Eigen::Matrix<double, 4, 1> quat_fej() const { return _pose->quat_fej(); }
+  const Eigen::Matrix<double, 4, 1> &quat_fej() const { return _pose->quat_fej(); }
 
   /// Position access
-  Eigen::Matrix<double, 3, 1> pos() const { return _pose->pos(); }
+  const Eigen::Matrix<double, 3, 1> &pos() const { return _pose->pos(); }
 
   /// FEJ position access
-  Eigen::Matrix<double, 3, 1> pos_fej() const { return _pose->pos_fej(); }
+  const Eigen::Matrix<double, 3, 1> &pos_fej() const { return _pose->pos_fej(); }
 
   /// Velocity access
   Eigen::Matrix<double, 3, 1> vel() const { return _v->value(); }
@@ -191,22 +191,22 @@ public:
   Eigen::Matrix<double, 3, 1> bias_a_fej() const { return _ba->fej(); }
 
   /// Keyframe Rotation access
-  Eigen::Matrix<double, 3, 3> keyframe_Rot() const { return _keyframe_pose->Rot(); }
+  const Eigen::Matrix<double, 3, 3> &keyframe_Rot() const { return _keyframe_pose->Rot(); }
 
   /// Keyframe FEJ Rotation access
-  Eigen::Matrix<double, 3, 3> keyframe_Rot_fej() const { return _keyframe_pose->Rot_fej(); }
+  const Eigen::Matrix<double, 3, 3> &keyframe_Rot_fej() const { return _keyframe_pose->Rot_fej(); }
 
   /// Keyframe Rotation access quaternion
-  Eigen::Matrix<double, 4, 1> keyframe_quat() const { return _keyframe_pose->quat(); }
+  const Eigen::Matrix<double, 4, 1> &keyframe_quat() const { return _keyframe_pose->quat(); }
 
   /// Keyframe FEJ Rotation access quaternion
-  Eigen::Matrix<double, 4, 1> keyframe_quat_fej() const { return _keyframe_pose->quat_fej(); }
+  const Eigen::Matrix<double, 4, 1> &keyframe_quat_fej() const { return _keyframe_pose->quat_fej(); }
 
   /// Keyframe Position access
-  Eigen::Matrix<double, 3, 1> keyframe_pos() const { return _keyframe_pose->pos(); }
+  const Eigen::Matrix<double, 3, 1> &keyframe_pos() const { return _keyframe_pose->pos(); }
 
   /// Keyframe FEJ position access
-  Eigen::Matrix<double, 3, 1> keyframe_pos_fej() const { return _keyframe_pose->pos_fej(); }
+  const Eigen::Matrix<double, 3, 1> &keyframe_pos_fej() const { return _keyframe_pose->pos_fej(); }
 
   /// Pose type access
   std::shared_ptr<PoseJPL> pose() { return _pose; }
@@ -143,11 +143,11 @@ public:
     return Clone;
   }
 
-  /// Rotation access
-  Eigen::Matrix<double, 3, 3> Rot() const { return _R; }
+  /// Rotation access (reference into the cached matrix, no temporary is built)
+  const Eigen::Matrix<double, 3, 3> &Rot() const { return _R; }
 
-  /// FEJ Rotation access
-  Eigen::Matrix<double, 3, 3> Rot_fej() const { return _Rfej; }
+  /// FEJ Rotation access (reference into the cached matrix, no temporary is built)
+  const Eigen::Matrix<double, 3, 3> &Rot_fej() const { return _Rfej; }
 
 protected:
   // Stores the rotation
@@ -119,22 +119,22 @@ public:
   }
 
   /// Rotation access
-  Eigen::Matrix<double, 3, 3> Rot() const { return _q->Rot(); }
+  const Eigen::Matrix<double, 3, 3> &Rot() const { return _q->Rot(); }
 
   /// FEJ Rotation access
-  Eigen::Matrix<double, 3, 3> Rot_fej() const { return _q->Rot_fej(); }
+  const Eigen::Matrix<double, 3, 3> &Rot_fej() const { return _q->Rot_fej(); }
 
   /// Rotation access as quaternion
-  Eigen::Matrix<double, 4, 1> quat() const { return _q->value(); }
+  const Eigen::Matrix<double, 4, 1> &quat() const { return _quat; }
 
   /// FEJ Rotation access as quaternion
-  Eigen::Matrix<double, 4, 1> quat_fej() const { return _q->fej(); }
+  const Eigen::Matrix<double, 4, 1> &quat_fej() const { return _quat_fej; }
 
   /// Position access
-  Eigen::Matrix<double, 3, 1> pos() const { return _p->value(); }
+  const Eigen::Matrix<double, 3, 1> &pos() const { return _pos; }
 
   // FEJ position access
-  Eigen::Matrix<double, 3, 1> pos_fej() const { return _p->fej(); }
+  const Eigen::Matrix<double, 3, 1> &pos_fej() const { return _pos_fej; }
 
   // Quaternion type access
   std::shared_ptr<JPLQuat> q() { return _q; }
@@ -149,6 +149,11 @@ protected:
   /// Subvariable containing position
   std::shared_ptr<Vec> _p;
 
+  /// Fixed-size mirrors of the estimate, refreshed on set, so the hot accessors
+  /// hand out references instead of rebuilding temporaries from dynamic storage
+  Eigen::Matrix<double, 4, 1> _quat, _quat_fej;
+  Eigen::Matrix<double, 3, 1> _pos, _pos_fej;
+
   /**
    * @brief Sets the value of the estimate
    * @param new_value New value we should set
@@ -165,6 +170,8 @@ protected:
     _p->set_value(new_value.block(4, 0, 3, 1));
 
     _value = new_value;
+    _quat = new_value.block(0, 0, 4, 1);
+    _pos = new_value.block(4, 0, 3, 1);
   }
 
   /**
@@ -183,6 +190,8 @@ protected:
     _p->set_fej(new_value.block(4, 0, 3, 1));
 
     _fej = new_value;
+    _quat_fej = new_value.block(0, 0, 4, 1);
+    _pos_fej = new_value.block(4, 0, 3, 1);
   }
 };
 
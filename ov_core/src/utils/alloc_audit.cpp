@@ -0,0 +1,228 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2018-2023 Patrick Geneva
+ * Copyright (C) 2018-2023 Guoquan Huang
+ * Copyright (C) 2018-2023 OpenVINS Contributors
+ * Copyright (C) 2018-2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "alloc_audit.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <new>
+#include <string>
+
+#include "print.h"
+
+using namespace ov_core;
+
+// Static storage for the enable flag, frame count, and the thread table registry
+std::atomic<bool> AllocAudit::_enabled(false);
+std::atomic<uint64_t> AllocAudit::_frames(0);
+std::mutex AllocAudit::_registry_mtx;
+std::vector<std::shared_ptr<AllocAudit::ThreadCounters>> AllocAudit::_registry;
+
+// Reentrancy guard so the registration of a new thread table (which itself allocates)
+// and any allocation made by the hooks below is never attributed recursively
+static thread_local bool audit_busy = false;
+
+AllocAudit::ThreadCounters &AllocAudit::counters() {
+  // First use on this thread allocates the table and registers it for reporting
+  static thread_local std::shared_ptr<ThreadCounters> table = [] {
+    auto created = std::make_shared<ThreadCounters>();
+    std::lock_guard<std::mutex> lck(_registry_mtx);
+    _registry.push_back(created);
+    return created;
+  }();
+  return *table;
+}
+
+void AllocAudit::push(const char *name) {
+  if (audit_busy)
+    return;
+  audit_busy = true;
+  ThreadCounters &table = counters();
+  audit_busy = false;
+  if (table.depth < MAX_DEPTH)
+    table.stack[table.depth] = name;
+  table.depth++;
+}
+
+void AllocAudit::pop() {
+  if (audit_busy)
+    return;
+  audit_busy = true;
+  ThreadCounters &table = counters();
+  audit_busy = false;
+  if (table.depth > 0)
+    table.depth--;
+}
+
+void AllocAudit::frame() {
+  if (!enabled())
+    return;
+  _frames.fetch_add(1, std::memory_order_relaxed);
+}
+
+void AllocAudit::count(size_t bytes) {
+  if (!enabled() || audit_busy)
+    return;
+  audit_busy = true;
+  ThreadCounters &table = counters();
+
+  // Attribute to the innermost active span, or the untracked bucket outside any span
+  const char *name = "(untracked)";
+  if (table.depth > 0 && table.depth <= MAX_DEPTH)
+    name = table.stack[table.depth - 1];
+
+  // Find (or claim) the counter slot for this stage name
+  // Names are string literals so pointer identity is the fast path, with a strcmp
+  // fallback since the same literal can have different addresses across libraries
+  for (size_t i = 0; i < MAX_STAGES; i++) {
+    StageCounters &slot = table.stages[i];
+    if (slot.name == nullptr) {
+      slot.name = name;
+      slot.count = 1;
+      slot.bytes = bytes;
+      break;
+    }
+    if (slot.name == name || strcmp(slot.name, name) == 0) {
+      slot.count++;
+      slot.bytes += bytes;
+      break;
+    }
+  }
+  audit_busy = false;
+}
+
+void AllocAudit::aggregate(std::vector<StageCounters> &totals, uint64_t &frames) {
+
+  // Aggregate the per-thread tables by stage name
+  frames = _frames.load(std::memory_order_relaxed);
+  {
+    std::lock_guard<std::mutex> lck(_registry_mtx);
+    for (auto &table : _registry) {
+      for (size_t i = 0; i < MAX_STAGES; i++) {
+        const StageCounters &slot = table->stages[i];
+        if (slot.name == nullptr)
+          break;
+        auto it = std::find_if(totals.begin(), totals.end(), [&](const StageCounters &t) { return strcmp(t.name, slot.name) == 0; });
+        if (it == totals.end()) {
+          totals.push_back(slot);
+        } else {
+          it->count += slot.count;
+          it->bytes += slot.bytes;
+        }
+      }
+    }
+  }
+
+  // Largest offenders first
+  std::sort(totals.begin(), totals.end(), [](const StageCounters &a, const StageCounters &b) { return a.bytes > b.bytes; });
+}
+
+void AllocAudit::report() {
+
+  // Aggregate the per-thread tables by stage name
+  std::vector<StageCounters> totals;
+  uint64_t frames = 0;
+  aggregate(totals, frames);
+  if (totals.empty()) {
+    PRINT_INFO("[ALLOC]: no allocations recorded\n");
+    return;
+  }
+
+  // Print totals, and per-frame averages if we saw frame boundaries
+  PRINT_INFO("[ALLOC]: per-stage heap allocations over %llu frames\n", (unsigned long long)frames);
+  for (const auto &total : totals) {
+    if (frames > 0) {
+      PRINT_INFO("[ALLOC]: %-24s %10llu allocs (%12llu bytes) | %8.1f allocs/frame (%10.1f bytes/frame)\n", total.name,
+                 (unsigned long long)total.count, (unsigned long long)total.bytes, (double)total.count / (double)frames,
+                 (double)total.bytes / (double)frames);
+    } else {
+      PRINT_INFO("[ALLOC]: %-24s %10llu allocs (%12llu bytes)\n", total.name, (unsigned long long)total.count,
+                 (unsigned long long)total.bytes);
+    }
+  }
+}
+
+void AllocAudit::report(const std::string &path) {
+
+  // Aggregate the per-thread tables by stage name
+  std::vector<StageCounters> totals;
+  uint64_t frames = 0;
+  aggregate(totals, frames);
+
+  // Write the same table the console report prints, one stage per row
+  std::ofstream file(path, std::ofstream::out | std::ofstream::trunc);
+  if (!file.is_open()) {
+    PRINT_ERROR("[ALLOC]: unable to open dump file %s\n", path.c_str());
+    return;
+  }
+  file << "# stage,allocs,bytes,allocs/frame,bytes/frame (over " << frames << " frames)" << std::endl;
+  for (const auto &total : totals) {
+    file << total.name << "," << total.count << "," << total.bytes << ","
+         << ((frames > 0) ? (double)total.count / (double)frames : 0.0) << ","
+         << ((frames > 0) ? (double)total.bytes / (double)frames : 0.0) << std::endl;
+  }
+}
+
+void AllocAudit::clear() {
+  std::lock_guard<std::mutex> lck(_registry_mtx);
+  for (auto &table : _registry) {
+    for (size_t i = 0; i < MAX_STAGES; i++) {
+      table->stages[i] = StageCounters();
+    }
+  }
+  _frames.store(0, std::memory_order_relaxed);
+}
+
+//=====================================================================================
+// Global allocation hooks
+//=====================================================================================
+// These replace the default operators for the whole process (they live in ov_core, so
+// anything linking the library gets them). They are malloc/free pass-throughs with a
+// single relaxed atomic check when auditing is disabled, so leaving them compiled in
+// costs nothing measurable in production builds.
+
+static void *audited_alloc(size_t size) {
+  void *ptr = std::malloc(size == 0 ? 1 : size);
+  if (ptr == nullptr)
+    throw std::bad_alloc();
+  AllocAudit::count(size);
+  return ptr;
+}
+
+void *operator new(size_t size) { return audited_alloc(size); }
+void *operator new[](size_t size) { return audited_alloc(size); }
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+  void *ptr = std::malloc(size == 0 ? 1 : size);
+  if (ptr != nullptr)
+    AllocAudit::count(size);
+  return ptr;
+}
+void *operator new[](size_t size, const std::nothrow_t &tag) noexcept { return operator new(size, tag); }
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete[](void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { std::free(ptr); }
+void operator delete(void *ptr, const std::nothrow_t &) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept { std::free(ptr); }
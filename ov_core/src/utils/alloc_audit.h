@@ -0,0 +1,129 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2018-2023 Patrick Geneva
+ * Copyright (C) 2018-2023 Guoquan Huang
+ * Copyright (C) 2018-2023 OpenVINS Contributors
+ * Copyright (C) 2018-2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OV_CORE_ALLOC_AUDIT_H
+#define OV_CORE_ALLOC_AUDIT_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace ov_core {
+
+/**
+ * @brief Opt-in heap allocation auditor for the hot pipeline path.
+ *
+ * When enabled, the global operator new hooks (defined in alloc_audit.cpp) attribute every
+ * heap allocation to the innermost active @ref TraceSpan of the calling thread, so per-frame
+ * allocation churn (Eigen temporaries, cv::Mat buffers, shared_ptr control blocks) shows up
+ * against the same stage names the tracer reports ("tracking", "msckf update", ...). This is
+ * what an external heaptrack run tells us, but cheap enough to leave in CI numbers.
+ *
+ * Counters live in fixed per-thread tables so the allocation hook itself never allocates,
+ * and each hook costs a single relaxed atomic load when auditing is off. Totals are
+ * aggregated across threads by @ref report, which also divides by the number of frames
+ * seen (via @ref Tracer::frame) to give per-frame figures that are comparable across runs.
+ */
+class AllocAudit {
+
+public:
+  /// Maximum number of distinct stage names each thread can attribute to
+  static const size_t MAX_STAGES = 64;
+
+  /// Maximum span nesting depth we keep attribution for
+  static const size_t MAX_DEPTH = 32;
+
+  /// Enable or disable allocation attribution at runtime
+  static void set_enabled(bool enabled) { _enabled.store(enabled, std::memory_order_relaxed); }
+
+  /// If we are currently attributing allocations
+  static bool enabled() { return _enabled.load(std::memory_order_relaxed); }
+
+  /**
+   * @brief Mark the calling thread as inside the given stage (innermost wins).
+   *
+   * Normally called by @ref TraceSpan, not directly.
+   * The name must be a string literal (only the pointer is stored).
+   */
+  static void push(const char *name);
+
+  /// Leave the innermost stage of the calling thread (pairs with @ref push)
+  static void pop();
+
+  /// Count one completed frame (called from @ref Tracer::frame)
+  static void frame();
+
+  /**
+   * @brief Attribute one allocation of the given size to the calling thread's active stage.
+   *
+   * Called from the global operator new hooks. Allocations made outside any span are
+   * collected under the "(untracked)" stage. Never allocates.
+   */
+  static void count(size_t bytes);
+
+  /// Print the per-stage allocation counts/bytes (totals and per-frame) aggregated over all threads
+  static void report();
+
+  /// Write the same per-stage report into the given file (e.g. for a watchdog dump)
+  static void report(const std::string &path);
+
+  /// Clear all recorded counters and the frame count
+  static void clear();
+
+private:
+  /// Allocation totals attributed to one stage name on one thread
+  struct StageCounters {
+    const char *name = nullptr; ///< Static stage name (nullptr marks an unused slot)
+    uint64_t count = 0;         ///< Number of allocations attributed
+    uint64_t bytes = 0;         ///< Total bytes attributed
+  };
+
+  /// Aggregate the per-thread tables by stage name (largest offenders first)
+  static void aggregate(std::vector<StageCounters> &totals, uint64_t &frames);
+
+  /// Fixed-size counter table and stage stack owned by one thread
+  struct ThreadCounters {
+    StageCounters stages[MAX_STAGES];
+    const char *stack[MAX_DEPTH] = {nullptr};
+    uint32_t depth = 0;
+  };
+
+  /// The calling thread's counter table (registered on first use)
+  static ThreadCounters &counters();
+
+  /// If we are currently attributing allocations
+  static std::atomic<bool> _enabled;
+
+  /// Number of frames seen while auditing was enabled
+  static std::atomic<uint64_t> _frames;
+
+  /// Registry of all per-thread counter tables (mutated only on thread first-use)
+  static std::mutex _registry_mtx;
+  static std::vector<std::shared_ptr<ThreadCounters>> _registry;
+};
+
+} // namespace ov_core
+
+#endif // OV_CORE_ALLOC_AUDIT_H
@@ -0,0 +1,145 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2018-2023 Patrick Geneva
+ * Copyright (C) 2018-2023 Guoquan Huang
+ * Copyright (C) 2018-2023 OpenVINS Contributors
+ * Copyright (C) 2018-2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OV_CORE_COUNTER_RNG_H
+#define OV_CORE_COUNTER_RNG_H
+
+#include <cmath>
+#include <cstdint>
+
+namespace ov_core {
+
+/**
+ * @brief Counter-based random number generator (Philox 4x32-10)
+ *
+ * Unlike a sequential generator such as std::mt19937, every draw here is a pure function
+ * of (seed, stream, counter): jumping to any position is O(1), and two generators built
+ * with the same key always produce the same value at the same counter no matter how many
+ * draws happened before or on which thread. This is what makes parallel noise generation
+ * reproducible — the simulators key each measurement's noise by its sensor stream and
+ * timestamp (see @ref seek_time), so any single measurement's noise is computable
+ * independently of the rest of the sequence while staying bit-exact per seed.
+ *
+ * The counter is split into an epoch (typically a quantized timestamp) and a draw index
+ * within that epoch, so a bounded number of draws per measurement can never collide with
+ * the draws of a neighboring measurement.
+ *
+ * Reference: Salmon et al. "Parallel Random Numbers: As Easy as 1, 2, 3" (SC 2011).
+ */
+class CounterRNG {
+
+public:
+  /// Default constructor (key of all zeros, counter at zero)
+  CounterRNG() {}
+
+  /**
+   * @brief Creates a generator for the given seed and stream, with the counter at zero
+   * @param seed User-chosen seed shared by all streams of one simulation run
+   * @param stream Identifier of the independent sub-sequence (e.g. one per sensor)
+   */
+  CounterRNG(uint64_t seed, uint64_t stream) {
+    // Mix seed and stream into the 64-bit philox key (splitmix64 finalizer)
+    uint64_t z = seed + 0x9E3779B97F4A7C15ULL * (stream + 1);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z = z ^ (z >> 31);
+    key0 = (uint32_t)z;
+    key1 = (uint32_t)(z >> 32);
+  }
+
+  /**
+   * @brief Jumps to an absolute position in the stream
+   * @param epoch High half of the counter (e.g. a measurement index or quantized time)
+   * @param draw Draw index within that epoch (defaults to the first draw)
+   */
+  void seek(uint64_t epoch, uint64_t draw = 0) {
+    ctr_epoch = epoch;
+    ctr_draw = draw;
+  }
+
+  /**
+   * @brief Keys the position by a timestamp so draws belong to that measurement alone
+   *
+   * The timestamp is quantized to microseconds, thus two processes computing the noise
+   * of the same measurement agree even if their timestamps differ by floating point
+   * round-off. The draw index restarts at zero for the new epoch.
+   *
+   * @param timestamp Measurement time in seconds
+   */
+  void seek_time(double timestamp) { seek((uint64_t)(int64_t)std::llround(1e6 * timestamp)); }
+
+  /// Uniformly distributed double in [0,1) (advances the counter by one)
+  double uniform01() { return (double)(next_bits() >> 11) * (1.0 / 9007199254740992.0); }
+
+  /**
+   * @brief Uniformly distributed double in [a,b) (advances the counter by one)
+   * @param a Lower bound of the interval
+   * @param b Upper bound of the interval
+   */
+  double uniform(double a, double b) { return a + (b - a) * uniform01(); }
+
+  /// Standard normal N(0,1) via Box-Muller (advances the counter by two)
+  double normal() {
+    // Offset the first uniform away from zero so the logarithm is always finite
+    double u1 = (double)((next_bits() >> 11) + 1) * (1.0 / 9007199254740993.0);
+    double u2 = uniform01();
+    return std::sqrt(-2.0 * std::log(u1)) * std::cos(2.0 * M_PI * u2);
+  }
+
+private:
+  /// Runs the ten philox rounds at the current counter and advances the draw index
+  uint64_t next_bits() {
+    uint32_t c0 = (uint32_t)ctr_draw;
+    uint32_t c1 = (uint32_t)(ctr_draw >> 32);
+    uint32_t c2 = (uint32_t)ctr_epoch;
+    uint32_t c3 = (uint32_t)(ctr_epoch >> 32);
+    uint32_t k0 = key0, k1 = key1;
+    for (int round = 0; round < 10; round++) {
+      uint64_t p0 = 0xD2511F53ULL * c0;
+      uint64_t p1 = 0xCD9E8D57ULL * c2;
+      uint32_t n0 = (uint32_t)(p1 >> 32) ^ c1 ^ k0;
+      uint32_t n1 = (uint32_t)p1;
+      uint32_t n2 = (uint32_t)(p0 >> 32) ^ c3 ^ k1;
+      uint32_t n3 = (uint32_t)p0;
+      c0 = n0;
+      c1 = n1;
+      c2 = n2;
+      c3 = n3;
+      k0 += 0x9E3779B9U;
+      k1 += 0xBB67AE85U;
+    }
+    ctr_draw++;
+    return (uint64_t)c0 | ((uint64_t)c1 << 32);
+  }
+
+  /// Philox key derived from (seed, stream)
+  uint32_t key0 = 0, key1 = 0;
+
+  /// High half of the counter (measurement epoch, see @ref seek_time)
+  uint64_t ctr_epoch = 0;
+
+  /// Low half of the counter (draw index within the epoch)
+  uint64_t ctr_draw = 0;
+};
+
+} // namespace ov_core
+
+#endif // OV_CORE_COUNTER_RNG_H
@@ -23,10 +23,15 @@
 #define OV_CORE_DATASET_READER_H
 
 #include <Eigen/Eigen>
+#include <cstdint>
 #include <fstream>
 #include <iostream>
+#include <map>
 #include <sstream>
 #include <string>
+#include <vector>
+
+#include <sys/stat.h>
 
 #include "colors.h"
 #include "print.h"
@@ -64,6 +69,16 @@ public:
     // Clear any old data
     gt_states.clear();
 
+    // First see if we have a binary sidecar from an earlier run (much faster than parsing the CSV)
+    std::vector<double> values;
+    if (load_binary_sidecar(path, 17, values)) {
+      for (size_t r = 0; r < values.size() / 17; r++) {
+        Eigen::Matrix<double, 17, 1> temp = Eigen::Map<Eigen::Matrix<double, 17, 1>>(values.data() + 17 * r);
+        gt_states.insert({1e-9 * temp(0, 0), temp});
+      }
+      return;
+    }
+
     // Open the file
     std::ifstream file;
     std::string line;
@@ -100,8 +115,13 @@ public:
       }
       // Append to our groundtruth map
       gt_states.insert({1e-9 * temp(0, 0), temp});
+      for (int j = 0; j < 17; j++)
+        values.push_back(temp(j, 0));
     }
     file.close();
+
+    // Write the sidecar so the next load of this file skips the CSV parse
+    save_binary_sidecar(path, 17, values);
   }
 
   /**
@@ -120,14 +140,18 @@ public:
       return false;
     }
 
-    // Loop through gt states and find the closest time stamp
+    // Binary search for the closest timestamp (the map is ordered by time, so
+    // only the two entries bracketing the query can be the closest one)
     double closest_time = INFINITY;
-    auto it0 = gt_states.begin();
-    while (it0 != gt_states.end()) {
+    auto it1 = gt_states.lower_bound(timestep);
+    if (it1 != gt_states.end()) {
+      closest_time = it1->first;
+    }
+    if (it1 != gt_states.begin()) {
+      auto it0 = std::prev(it1);
       if (std::abs(it0->first - timestep) < std::abs(closest_time - timestep)) {
         closest_time = it0->first;
       }
-      it0++;
     }
 
     // If close to this timestamp, then use it
@@ -176,6 +200,15 @@ public:
    */
   static void load_simulated_trajectory(std::string path, std::vector<Eigen::VectorXd> &traj_data) {
 
+    // First see if we have a binary sidecar from an earlier run (much faster than parsing the text)
+    std::vector<double> values;
+    if (load_binary_sidecar(path, 8, values)) {
+      for (size_t r = 0; r < values.size() / 8; r++) {
+        traj_data.push_back(Eigen::Map<Eigen::Matrix<double, 8, 1>>(values.data() + 8 * r));
+      }
+      return;
+    }
+
     // Try to open our groundtruth file
     std::ifstream file;
     file.open(path);
@@ -216,6 +249,8 @@ public:
       // Only a valid line if we have all the parameters
       if (i > 7) {
         traj_data.push_back(data);
+        for (int j = 0; j < 8; j++)
+          values.push_back(data(j));
 
         // std::stringstream ss;
         // ss << std::setprecision(15) << data.transpose() << std::endl;
@@ -232,9 +267,75 @@ public:
       PRINT_ERROR(RED "ERROR: %s\n" RESET, path.c_str());
       std::exit(EXIT_FAILURE);
     }
+
+    // Write the sidecar so the next load of this file skips the text parse
+    save_binary_sidecar(path, 8, values);
   }
 
 private:
+  /// Magic number ("OVDT") and version of the binary sidecar cache format
+  static const uint32_t BIN_CACHE_MAGIC = 0x4f564454;
+  static const uint32_t BIN_CACHE_VERSION = 1;
+
+  /**
+   * @brief Tries to load a binary sidecar written by an earlier parse of the same file.
+   * @param path_text Path to the original text file (the sidecar lives next to it with a .bin suffix)
+   * @param cols Number of values per row we expect
+   * @param values Will be filled with the row-major values if successful
+   * @return False if the sidecar is missing, stale, or malformed (caller should parse the text file)
+   */
+  static bool load_binary_sidecar(const std::string &path_text, size_t cols, std::vector<double> &values) {
+    std::string path_bin = path_text + ".bin";
+    struct stat st_text, st_bin;
+    if (stat(path_bin.c_str(), &st_bin) != 0)
+      return false;
+    if (stat(path_text.c_str(), &st_text) == 0 && st_text.st_mtime > st_bin.st_mtime)
+      return false;
+    std::ifstream file(path_bin, std::ios::binary);
+    if (!file)
+      return false;
+    uint32_t magic = 0, version = 0;
+    uint64_t rows = 0, cols_file = 0;
+    file.read((char *)&magic, sizeof(magic));
+    file.read((char *)&version, sizeof(version));
+    file.read((char *)&rows, sizeof(rows));
+    file.read((char *)&cols_file, sizeof(cols_file));
+    if (!file.good() || magic != BIN_CACHE_MAGIC || version != BIN_CACHE_VERSION || cols_file != (uint64_t)cols || rows < 1)
+      return false;
+    values.resize(rows * cols);
+    file.read((char *)values.data(), values.size() * sizeof(double));
+    if (!file.good()) {
+      values.clear();
+      return false;
+    }
+    PRINT_DEBUG("loaded binary cache %s\n", path_bin.c_str());
+    return true;
+  }
+
+  /**
+   * @brief Saves the parsed values next to the text file so the next load can skip the parse.
+   * @param path_text Path to the original text file
+   * @param cols Number of values per row
+   * @param values Row-major values to write
+   *
+   * This is best effort, if the directory is read-only we just parse the text again next time.
+   */
+  static void save_binary_sidecar(const std::string &path_text, size_t cols, const std::vector<double> &values) {
+    if (values.empty())
+      return;
+    std::string path_bin = path_text + ".bin";
+    std::ofstream file(path_bin, std::ios::binary);
+    if (!file)
+      return;
+    uint32_t magic = BIN_CACHE_MAGIC, version = BIN_CACHE_VERSION;
+    uint64_t rows = values.size() / cols, cols_file = cols;
+    file.write((const char *)&magic, sizeof(magic));
+    file.write((const char *)&version, sizeof(version));
+    file.write((const char *)&rows, sizeof(rows));
+    file.write((const char *)&cols_file, sizeof(cols_file));
+    file.write((const char *)values.data(), values.size() * sizeof(double));
+  }
+
   /**
    * All function in this class should be static.
    * Thus an instance of this class cannot be created.
@@ -0,0 +1,342 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2018-2023 Patrick Geneva
+ * Copyright (C) 2018-2023 Guoquan Huang
+ * Copyright (C) 2018-2023 OpenVINS Contributors
+ * Copyright (C) 2018-2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OV_CORE_FRAME_CACHE_H
+#define OV_CORE_FRAME_CACHE_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <opencv2/opencv.hpp>
+
+#include "colors.h"
+#include "print.h"
+#include "thread_registry.h"
+
+namespace ov_core {
+
+/**
+ * @brief Background loader which stays a bounded number of frames ahead of the consumer.
+ *
+ * A worker thread calls the user supplied loader for increasing indices, keeping at most
+ * a window of loaded-but-unconsumed entries so the decode work is hidden behind whatever
+ * the consuming thread does with the previous frame. The consumer calls get() with
+ * monotonically increasing indices; entries that are skipped over are dropped.
+ * This is the same scheme the serial replay node uses to deserialize bag messages ahead
+ * of the filter, generalized so dataset readers can decode images ahead of the tracker.
+ */
+template <typename T> class FramePrefetcher {
+
+public:
+  /**
+   * @brief Starts the background worker
+   * @param total Total number of entries that can be loaded
+   * @param window Max number of loaded entries ahead of the last one consumed
+   * @param loader Function which loads/decodes the given index (called on the worker thread)
+   */
+  FramePrefetcher(size_t total, size_t window, std::function<T(size_t)> loader) : total(total), window(window), loader(loader) {
+    worker = std::thread([this] { run(); });
+  }
+
+  ~FramePrefetcher() {
+    {
+      std::lock_guard<std::mutex> lck(mtx);
+      stop = true;
+    }
+    cv.notify_all();
+    worker.join();
+  }
+
+  /**
+   * @brief Blocks until the requested entry has been loaded and returns it
+   * @param index Index of the entry we want (should be non-decreasing between calls)
+   */
+  T get(size_t index) {
+    std::unique_lock<std::mutex> lck(mtx);
+    demand = std::max(demand, index);
+    loaded.erase(loaded.begin(), loaded.lower_bound(index));
+    cv.notify_all();
+    cv.wait(lck, [&] { return loaded.find(index) != loaded.end(); });
+    T value = std::move(loaded.at(index));
+    loaded.erase(index);
+    return value;
+  }
+
+private:
+  /// Worker loop which loads entries while staying within the window of the consumer
+  void run() {
+    ThreadRegistry::register_thread("prefetch frames");
+    for (size_t m = 0; m < total; m++) {
+      {
+        std::unique_lock<std::mutex> lck(mtx);
+        cv.wait(lck, [&] { return m < demand + window || stop; });
+        if (stop)
+          return;
+      }
+      T value = loader(m);
+      {
+        std::lock_guard<std::mutex> lck(mtx);
+        loaded[m] = std::move(value);
+      }
+      cv.notify_all();
+    }
+  }
+
+  /// Total number of entries, and how far ahead of the consumer we may load
+  size_t total, window;
+
+  /// User function which loads/decodes a single entry
+  std::function<T(size_t)> loader;
+
+  /// Mutex and condition variable protecting the pool below
+  std::mutex mtx;
+  std::condition_variable cv;
+
+  /// Loaded entries not yet handed to the consumer
+  std::map<size_t, T> loaded;
+
+  /// Highest index the consumer has asked for
+  size_t demand = 0;
+
+  /// Set when the destructor wants the worker to exit
+  bool stop = false;
+
+  /// The background worker thread
+  std::thread worker;
+};
+
+/**
+ * @brief On-disk cache of decoded frames for repeatedly-replayed sequences.
+ *
+ * Benchmarks that replay the same dataset many times spend a large part of their wall
+ * time decoding the images over and over. On the first replay the decoded frames can be
+ * appended to this cache (raw pixel data, one record per frame), and later replays then
+ * memory-map the file and hand out zero-copy cv::Mat views of it, skipping both the
+ * dataset read and the decode entirely. Like the DatasetReader binary sidecar, the cache
+ * is rejected if it is older than the source dataset file, and writing is best effort.
+ *
+ * @m_class{m-note m-warning}
+ *
+ * @par Frames are read-only
+ * The matrices returned by get() point directly into the read-only mapping, so they must
+ * not be written in place and are only valid while this object is alive.
+ */
+class FrameCache {
+
+public:
+  /**
+   * @brief Default constructor
+   * @param path_cache Path of the cache file
+   * @param path_source Path of the dataset it was decoded from (for staleness checking)
+   */
+  FrameCache(const std::string &path_cache, const std::string &path_source) : path_cache(path_cache), path_source(path_source) {}
+
+  ~FrameCache() {
+    if (map_data != nullptr)
+      munmap((void *)map_data, map_size);
+    if (fd >= 0)
+      close(fd);
+  }
+
+  /**
+   * @brief Tries to memory-map a cache written by an earlier replay of the same dataset.
+   * @return False if the cache is missing, stale, or malformed (caller should decode the dataset)
+   */
+  bool open_read() {
+
+    // Reject the cache if the dataset has been modified after it was written
+    struct stat st_source, st_cache;
+    if (stat(path_cache.c_str(), &st_cache) != 0)
+      return false;
+    if (stat(path_source.c_str(), &st_source) == 0 && st_source.st_mtime > st_cache.st_mtime)
+      return false;
+
+    // Map the whole file into memory
+    fd = open(path_cache.c_str(), O_RDONLY);
+    if (fd < 0)
+      return false;
+    map_size = (size_t)st_cache.st_size;
+    map_data = (const uint8_t *)mmap(nullptr, map_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (map_data == MAP_FAILED) {
+      map_data = nullptr;
+      close(fd);
+      fd = -1;
+      return false;
+    }
+
+    // Validate the header (an interrupted write never updates the frame count from zero)
+    uint32_t magic = 0, version = 0;
+    uint64_t count = 0;
+    size_t offset = 0;
+    if (!read_bytes(&magic, sizeof(magic), offset) || !read_bytes(&version, sizeof(version), offset) ||
+        !read_bytes(&count, sizeof(count), offset))
+      return false;
+    if (magic != CACHE_MAGIC || version != CACHE_VERSION || count < 1)
+      return false;
+
+    // Walk the records and build our frame index
+    for (uint64_t n = 0; n < count; n++) {
+      FrameRecord record;
+      int32_t rows = 0, cols = 0, type = 0;
+      uint64_t cam_id = 0, bytes = 0;
+      if (!read_bytes(&record.timestamp, sizeof(record.timestamp), offset) || !read_bytes(&cam_id, sizeof(cam_id), offset) ||
+          !read_bytes(&rows, sizeof(rows), offset) || !read_bytes(&cols, sizeof(cols), offset) ||
+          !read_bytes(&type, sizeof(type), offset) || !read_bytes(&bytes, sizeof(bytes), offset))
+        return false;
+      if (offset + bytes > map_size || (uint64_t)rows * cols * CV_ELEM_SIZE(type) != bytes)
+        return false;
+      record.cam_id = (size_t)cam_id;
+      record.rows = rows;
+      record.cols = cols;
+      record.type = type;
+      record.offset = offset;
+      offset += bytes;
+      records.push_back(record);
+    }
+    PRINT_DEBUG("loaded frame cache %s (%zu frames)\n", path_cache.c_str(), records.size());
+    return true;
+  }
+
+  /// Number of cached frames (valid after a successful open_read())
+  size_t size() const { return records.size(); }
+
+  /**
+   * @brief Gets a cached frame as a zero-copy view of the mapping
+   * @param index Index of the frame in replay order
+   * @param cam_id Will be set to the camera this frame belongs to
+   * @param timestamp Will be set to the frame timestamp
+   * @param img Will wrap the cached pixel data (read-only, valid while this object is alive)
+   * @return False if the index is out of range
+   */
+  bool get(size_t index, size_t &cam_id, double &timestamp, cv::Mat &img) {
+    if (index >= records.size())
+      return false;
+    const FrameRecord &record = records.at(index);
+    cam_id = record.cam_id;
+    timestamp = record.timestamp;
+    img = cv::Mat(record.rows, record.cols, record.type, (void *)(map_data + record.offset));
+    return true;
+  }
+
+  /**
+   * @brief Starts writing a new cache (truncating any existing one).
+   * @return False if the file could not be created (caller should just skip caching)
+   */
+  bool open_write() {
+    writer.open(path_cache, std::ios::binary | std::ios::trunc);
+    if (!writer)
+      return false;
+    // The frame count is zero until finalize_write(), so a partial file is never loaded
+    uint32_t magic = CACHE_MAGIC, version = CACHE_VERSION;
+    uint64_t count = 0;
+    writer.write((const char *)&magic, sizeof(magic));
+    writer.write((const char *)&version, sizeof(version));
+    writer.write((const char *)&count, sizeof(count));
+    return writer.good();
+  }
+
+  /**
+   * @brief Appends a decoded frame to the cache being written
+   * @param cam_id Camera this frame belongs to
+   * @param timestamp Frame timestamp
+   * @param img Decoded image (cloned if not continuous in memory)
+   */
+  void append(size_t cam_id, double timestamp, const cv::Mat &img) {
+    if (!writer.is_open())
+      return;
+    cv::Mat frame = img.isContinuous() ? img : img.clone();
+    uint64_t cam_id_file = cam_id, bytes = (uint64_t)frame.rows * frame.cols * frame.elemSize();
+    int32_t rows = frame.rows, cols = frame.cols, type = frame.type();
+    writer.write((const char *)&timestamp, sizeof(timestamp));
+    writer.write((const char *)&cam_id_file, sizeof(cam_id_file));
+    writer.write((const char *)&rows, sizeof(rows));
+    writer.write((const char *)&cols, sizeof(cols));
+    writer.write((const char *)&type, sizeof(type));
+    writer.write((const char *)&bytes, sizeof(bytes));
+    writer.write((const char *)frame.data, bytes);
+    num_written++;
+  }
+
+  /**
+   * @brief Seals the cache being written by recording the final frame count.
+   */
+  void finalize_write() {
+    if (!writer.is_open())
+      return;
+    uint64_t count = num_written;
+    writer.seekp(sizeof(uint32_t) + sizeof(uint32_t), std::ios::beg);
+    writer.write((const char *)&count, sizeof(count));
+    writer.close();
+    PRINT_DEBUG("wrote frame cache %s (%zu frames)\n", path_cache.c_str(), (size_t)num_written);
+  }
+
+private:
+  /// Magic number ("OVFC") and version of the frame cache format
+  static const uint32_t CACHE_MAGIC = 0x4f564643;
+  static const uint32_t CACHE_VERSION = 1;
+
+  /// Location of one frame inside the mapping
+  struct FrameRecord {
+    double timestamp = 0;
+    size_t cam_id = 0;
+    int32_t rows = 0, cols = 0, type = 0;
+    size_t offset = 0;
+  };
+
+  /// Bounds-checked copy out of the mapping which advances the offset
+  bool read_bytes(void *dest, size_t bytes, size_t &offset) {
+    if (offset + bytes > map_size)
+      return false;
+    memcpy(dest, map_data + offset, bytes);
+    offset += bytes;
+    return true;
+  }
+
+  /// Paths of the cache file and of the dataset it was decoded from
+  std::string path_cache, path_source;
+
+  /// Read side (memory mapping and the frame index built from it)
+  int fd = -1;
+  const uint8_t *map_data = nullptr;
+  size_t map_size = 0;
+  std::vector<FrameRecord> records;
+
+  /// Write side
+  std::ofstream writer;
+  uint64_t num_written = 0;
+};
+
+} // namespace ov_core
+
+#endif /* OV_CORE_FRAME_CACHE_H */
@@ -0,0 +1,94 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2018-2023 Patrick Geneva
+ * Copyright (C) 2018-2023 Guoquan Huang
+ * Copyright (C) 2018-2023 OpenVINS Contributors
+ * Copyright (C) 2018-2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OV_CORE_LOCKFREE_QUEUE_H
+#define OV_CORE_LOCKFREE_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace ov_core {
+
+/**
+ * @brief Bounded lock-free single-producer single-consumer queue.
+ *
+ * This is the classic Lamport ring buffer with acquire/release index publication.
+ * We use it to hand high-rate sensor measurements from a driver callback thread to
+ * the estimation thread without ever taking a mutex on the callback hot path, which
+ * avoids priority inversion when the estimation thread holds its data for a while.
+ *
+ * The single-producer single-consumer contract is strict: exactly one thread may
+ * call push() and exactly one thread may call pop(). Anything more requires
+ * external synchronization (at which point a mutex-guarded container is simpler).
+ */
+template <typename T> class LockFreeSpscQueue {
+
+public:
+  /**
+   * @brief Construct a queue that can hold a fixed number of elements
+   * @param capacity Maximum number of elements that can be in flight at once
+   */
+  explicit LockFreeSpscQueue(size_t capacity = 1024) : buffer(capacity + 1), head(0), tail(0) {}
+
+  /**
+   * @brief Append an element (may only be called from the producer thread)
+   * @param value Element we wish to enqueue
+   * @return False if the queue was full and the element was *not* enqueued
+   */
+  bool push(const T &value) {
+    size_t t = tail.load(std::memory_order_relaxed);
+    size_t t_next = (t + 1) % buffer.size();
+    if (t_next == head.load(std::memory_order_acquire))
+      return false;
+    buffer[t] = value;
+    tail.store(t_next, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief Remove the oldest element (may only be called from the consumer thread)
+   * @param value Output location for the dequeued element
+   * @return False if the queue was empty
+   */
+  bool pop(T &value) {
+    size_t h = head.load(std::memory_order_relaxed);
+    if (h == tail.load(std::memory_order_acquire))
+      return false;
+    value = buffer[h];
+    head.store((h + 1) % buffer.size(), std::memory_order_release);
+    return true;
+  }
+
+private:
+  /// Backing storage (one extra slot so full and empty are distinguishable)
+  std::vector<T> buffer;
+
+  /// Consumer index, kept on its own cache line to avoid false sharing with the producer
+  alignas(64) std::atomic<size_t> head;
+
+  /// Producer index, kept on its own cache line to avoid false sharing with the consumer
+  alignas(64) std::atomic<size_t> tail;
+};
+
+} // namespace ov_core
+
+#endif // OV_CORE_LOCKFREE_QUEUE_H
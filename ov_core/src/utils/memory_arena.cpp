@@ -0,0 +1,155 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2018-2023 Patrick Geneva
+ * Copyright (C) 2018-2023 Guoquan Huang
+ * Copyright (C) 2018-2023 OpenVINS Contributors
+ * Copyright (C) 2018-2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "memory_arena.h"
+
+#include <cstdlib>
+
+#include "colors.h"
+#include "print.h"
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+using namespace ov_core;
+
+unsigned char *MemoryArena::_base = nullptr;
+size_t MemoryArena::_capacity = 0;
+size_t MemoryArena::_offset = 0;
+bool MemoryArena::_hugepages = false;
+bool MemoryArena::_warned_exhausted = false;
+std::map<size_t, std::vector<unsigned char *>> MemoryArena::_free_lists;
+std::map<unsigned char *, size_t> MemoryArena::_block_sizes;
+std::mutex MemoryArena::_mtx;
+
+bool MemoryArena::configure(size_t bytes, bool use_hugepages) {
+  std::lock_guard<std::mutex> lck(_mtx);
+  if (_base != nullptr) {
+    PRINT_WARNING(YELLOW "MemoryArena::configure(): already configured with %.1f MB, ignoring\n" RESET, 1e-6 * (double)_capacity);
+    return true;
+  }
+
+  // Round up to whole 2 MiB huge pages so a hugetlb mapping is always valid
+  const size_t hugepage = 2 * 1024 * 1024;
+  bytes = ((bytes + hugepage - 1) / hugepage) * hugepage;
+
+#if defined(__linux__)
+  // First preference is an explicit hugetlb mapping (needs reserved huge pages),
+  // second is a normal mapping we ask the kernel to back with transparent huge pages
+  void *mem = MAP_FAILED;
+  if (use_hugepages) {
+    mem = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    _hugepages = (mem != MAP_FAILED);
+  }
+  if (mem == MAP_FAILED) {
+    mem = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+#if defined(MADV_HUGEPAGE)
+    if (mem != MAP_FAILED && use_hugepages) {
+      _hugepages = (madvise(mem, bytes, MADV_HUGEPAGE) == 0);
+    }
+#endif
+  }
+  if (mem == MAP_FAILED) {
+    PRINT_WARNING(YELLOW "MemoryArena::configure(): unable to reserve %.1f MB, falling back to the system heap\n" RESET,
+                  1e-6 * (double)bytes);
+    return false;
+  }
+  _base = (unsigned char *)mem;
+  _capacity = bytes;
+  PRINT_DEBUG("MemoryArena: reserved %.1f MB (%s pages)\n", 1e-6 * (double)_capacity, _hugepages ? "huge" : "normal");
+  return true;
+#else
+  (void)use_hugepages;
+  PRINT_WARNING(YELLOW "MemoryArena::configure(): not supported on this platform, falling back to the system heap\n" RESET);
+  return false;
+#endif
+}
+
+bool MemoryArena::enabled() {
+  std::lock_guard<std::mutex> lck(_mtx);
+  return _base != nullptr;
+}
+
+void *MemoryArena::allocate(size_t bytes) {
+  // Round to the alignment so equal requests always share a free list
+  const size_t align = 64;
+  bytes = ((bytes + align - 1) / align) * align;
+  {
+    std::lock_guard<std::mutex> lck(_mtx);
+    if (_base != nullptr) {
+      // Recycle a freed block of this exact size if we have one
+      auto it = _free_lists.find(bytes);
+      if (it != _free_lists.end() && !it->second.empty()) {
+        unsigned char *block = it->second.back();
+        it->second.pop_back();
+        _block_sizes.insert({block, bytes});
+        return block;
+      }
+      // Otherwise carve a fresh block off the bump pointer
+      if (_offset + bytes <= _capacity) {
+        unsigned char *block = _base + _offset;
+        _offset += bytes;
+        _block_sizes.insert({block, bytes});
+        return block;
+      }
+      if (!_warned_exhausted) {
+        PRINT_WARNING(YELLOW "MemoryArena::allocate(): arena of %.1f MB exhausted, falling back to the system heap\n" RESET,
+                      1e-6 * (double)_capacity);
+        _warned_exhausted = true;
+      }
+    }
+  }
+  // Disabled or exhausted: plain aligned heap allocation
+  void *mem = nullptr;
+  if (posix_memalign(&mem, align, bytes) != 0) {
+    PRINT_ERROR(RED "MemoryArena::allocate(): unable to allocate %.1f MB!\n" RESET, 1e-6 * (double)bytes);
+    std::exit(EXIT_FAILURE);
+  }
+  return mem;
+}
+
+void MemoryArena::deallocate(void *ptr) {
+  if (ptr == nullptr)
+    return;
+  {
+    std::lock_guard<std::mutex> lck(_mtx);
+    if (_base != nullptr && (unsigned char *)ptr >= _base && (unsigned char *)ptr < _base + _capacity) {
+      auto it = _block_sizes.find((unsigned char *)ptr);
+      if (it != _block_sizes.end()) {
+        _free_lists[it->second].push_back(it->first);
+        _block_sizes.erase(it);
+      }
+      return;
+    }
+  }
+  free(ptr);
+}
+
+size_t MemoryArena::capacity() {
+  std::lock_guard<std::mutex> lck(_mtx);
+  return _capacity;
+}
+
+size_t MemoryArena::used() {
+  std::lock_guard<std::mutex> lck(_mtx);
+  return _offset;
+}
@@ -0,0 +1,109 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2018-2023 Patrick Geneva
+ * Copyright (C) 2018-2023 Guoquan Huang
+ * Copyright (C) 2018-2023 OpenVINS Contributors
+ * Copyright (C) 2018-2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OV_CORE_MEMORY_ARENA_H
+#define OV_CORE_MEMORY_ARENA_H
+
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace ov_core {
+
+/**
+ * @brief Preallocated (optionally hugepage-backed) arena for the big recurring allocations.
+ *
+ * On long-running deployments the mixed allocation sizes of the pipeline (image slabs,
+ * the dense covariance, stacked Jacobians) slowly fragment the system heap, which degrades
+ * both allocator and TLB behavior after many hours. This arena reserves one contiguous
+ * region at startup, sized from the configuration, and hands out 64-byte aligned blocks
+ * from it. Freed blocks go onto per-size free lists, so the recurring sizes are recycled
+ * in place and the region never fragments the system heap.
+ *
+ * When requested the region is backed by huge pages (MAP_HUGETLB with a transparent
+ * hugepage fallback via madvise), so a multi-megabyte covariance matrix is covered by a
+ * handful of TLB entries instead of thousands of 4 KiB ones.
+ *
+ * The arena is optional and deliberately boring: before @ref configure is called (or if
+ * the reservation fails) every call falls back to the system heap, and an exhausted arena
+ * warns once and degrades the same way rather than failing the caller.
+ */
+class MemoryArena {
+
+public:
+  /**
+   * @brief Reserves the arena region, to be called once before the pipeline allocates
+   * @param bytes Size of the region to reserve (rounded up to a multiple of 2 MiB)
+   * @param use_hugepages True to back the region with huge pages (falls back if unavailable)
+   * @return True if the reservation succeeded and the arena is active
+   */
+  static bool configure(size_t bytes, bool use_hugepages);
+
+  /// Returns true if the arena has been configured and its reservation succeeded
+  static bool enabled();
+
+  /**
+   * @brief Allocates a 64-byte aligned block (arena-backed when possible)
+   * @param bytes Size of the requested block
+   * @return Pointer to the block (never nullptr, falls back to the system heap)
+   */
+  static void *allocate(size_t bytes);
+
+  /**
+   * @brief Returns a block to the arena free lists (or the system heap if it came from there)
+   * @param ptr Pointer previously returned by @ref allocate (nullptr is ignored)
+   */
+  static void deallocate(void *ptr);
+
+  /// Total bytes reserved for the arena (zero when disabled)
+  static size_t capacity();
+
+  /// Bytes currently handed out or parked on the free lists
+  static size_t used();
+
+private:
+  /// Start of the reserved region (nullptr when the arena is disabled)
+  static unsigned char *_base;
+
+  /// Total reserved bytes and current bump offset into the region
+  static size_t _capacity;
+  static size_t _offset;
+
+  /// Whether the region actually got hugepage backing
+  static bool _hugepages;
+
+  /// Whether we already warned about falling back to the system heap
+  static bool _warned_exhausted;
+
+  /// Free blocks keyed by their (rounded) size, recycled before the bump pointer moves
+  static std::map<size_t, std::vector<unsigned char *>> _free_lists;
+
+  /// Size of each handed-out arena block, so deallocate knows which list to return it to
+  static std::map<unsigned char *, size_t> _block_sizes;
+
+  /// Lock protecting all of the above (allocation is rare, contention is not a concern)
+  static std::mutex _mtx;
+};
+
+} // namespace ov_core
+
+#endif // OV_CORE_MEMORY_ARENA_H
@@ -24,6 +24,8 @@
 
 #include <Eigen/Eigen>
 #include <boost/filesystem.hpp>
+#include <ctime>
+#include <map>
 #include <memory>
 #include <opencv2/opencv.hpp>
 
@@ -317,6 +319,12 @@ private:
   /// Record if all parameters were found
   bool all_params_found_successfully = true;
 
+  /// Parsed external config files keyed by their full path (see open_external())
+  std::map<std::string, std::shared_ptr<cv::FileStorage>> external_configs;
+
+  /// Modification time each cached external file had when we parsed it
+  std::map<std::string, std::time_t> external_mtimes;
+
 #if ROS_AVAILABLE == 1
   /// ROS1 node handler that will override values
   std::shared_ptr<ros::NodeHandle> nh;
@@ -343,6 +351,40 @@ private:
     return found_node;
   }
 
+  /**
+   * @brief Opens an external config file, re-using an already parsed copy if we have one.
+   *
+   * Option loading reads dozens of keys from the same per-sensor files, and re-opening
+   * and re-walking the YAML for each key dominated our cold-start time.
+   * Thus we cache the parsed cv::FileStorage keyed by path, and only re-parse a file
+   * if its modification time has changed since we last read it.
+   *
+   * @param path Full path of the external file we wish to parse
+   * @return Opened file storage (nullptr if the file could not be opened)
+   */
+  std::shared_ptr<cv::FileStorage> open_external(const std::string &path) {
+
+    // Return the cached copy if the file has not changed since we parsed it
+    std::time_t mtime = 0;
+    try {
+      mtime = boost::filesystem::last_write_time(path);
+    } catch (...) {
+    }
+    auto it = external_configs.find(path);
+    if (it != external_configs.end() && external_mtimes.at(path) == mtime) {
+      return it->second;
+    }
+
+    // Else we need to actually open and parse the file
+    auto config_external = std::make_shared<cv::FileStorage>(path, cv::FileStorage::READ);
+    if (!config_external->isOpened()) {
+      return nullptr;
+    }
+    external_configs[path] = config_external;
+    external_mtimes[path] = mtime;
+    return config_external;
+  }
+
   /**
    * @brief This function will try to get the requested parameter from our config.
    *
@@ -592,9 +634,9 @@ private:
     (*config)[external_node_name] >> path;
     std::string relative_folder = config_path_.substr(0, config_path_.find_last_of('/')) + "/";
 
-    // Now actually try to load them from file!
-    auto config_external = std::make_shared<cv::FileStorage>(relative_folder + path, cv::FileStorage::READ);
-    if (!config_external->isOpened()) {
+    // Now actually try to load them from file (cached, so each file is only parsed once)!
+    auto config_external = open_external(relative_folder + path);
+    if (config_external == nullptr) {
       PRINT_ERROR(RED "unable to open the configuration file!\n%s\n" RESET, (relative_folder + path).c_str());
       std::exit(EXIT_FAILURE);
     }
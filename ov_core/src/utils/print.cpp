@@ -21,11 +21,83 @@
 
 #include "print.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
 using namespace ov_core;
 
 // Need to define the static variable for everything to work
 Printer::PrintLevel Printer::current_print_level = PrintLevel::INFO;
 
+namespace {
+
+// Fixed-size multi-producer single-consumer ring for the asynchronous backend
+// Producers claim a slot with a compare-and-swap on the head sequence (Vyukov
+// style bounded queue), so the hot path never takes a lock and never blocks on
+// console I/O. A full ring drops the message and counts it instead of waiting.
+constexpr size_t ASYNC_RING_SIZE = 1024; // must be a power of two
+constexpr size_t ASYNC_MAX_MSG_LENGTH = 512;
+
+struct AsyncRingSlot {
+  std::atomic<uint64_t> seq;
+  char text[ASYNC_MAX_MSG_LENGTH];
+};
+
+AsyncRingSlot async_ring[ASYNC_RING_SIZE];
+std::atomic<uint64_t> async_head(0);
+uint64_t async_tail = 0; // only touched by the drain thread
+std::atomic<uint64_t> async_dropped(0);
+std::atomic<bool> async_enabled(false);
+std::atomic<bool> async_running(false);
+std::thread async_drain_thread;
+
+// Try to append an already-formatted message to the ring (false if it was full)
+bool async_push(const char *text) {
+  uint64_t pos = async_head.load(std::memory_order_relaxed);
+  while (true) {
+    AsyncRingSlot &slot = async_ring[pos % ASYNC_RING_SIZE];
+    uint64_t seq = slot.seq.load(std::memory_order_acquire);
+    int64_t dif = (int64_t)seq - (int64_t)pos;
+    if (dif == 0) {
+      if (async_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+        snprintf(slot.text, ASYNC_MAX_MSG_LENGTH, "%s", text);
+        slot.seq.store(pos + 1, std::memory_order_release);
+        return true;
+      }
+    } else if (dif < 0) {
+      async_dropped.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    } else {
+      pos = async_head.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+// Background thread which writes queued messages to stdout in order
+// Keeps draining after shutdown is requested until the ring is empty
+void async_drain_loop() {
+  while (true) {
+    AsyncRingSlot &slot = async_ring[async_tail % ASYNC_RING_SIZE];
+    if (slot.seq.load(std::memory_order_acquire) == async_tail + 1) {
+      fputs(slot.text, stdout);
+      slot.seq.store(async_tail + ASYNC_RING_SIZE, std::memory_order_release);
+      async_tail++;
+      continue;
+    }
+    if (!async_running.load(std::memory_order_acquire))
+      break;
+    fflush(stdout);
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  fflush(stdout);
+}
+
+} // namespace
+
 void Printer::setPrintLevel(const std::string &level) {
   if (level == "ALL")
     setPrintLevel(PrintLevel::ALL);
@@ -77,12 +149,68 @@ void Printer::setPrintLevel(PrintLevel level) {
   std::cout << std::endl;
 }
 
+void Printer::setAsyncLogging(bool enable) {
+  if (enable && !async_running.load()) {
+    // The slot sequence numbers carry over between enables, so only seed them once
+    static bool ring_initialized = false;
+    if (!ring_initialized) {
+      for (size_t i = 0; i < ASYNC_RING_SIZE; i++) {
+        async_ring[i].seq.store(i, std::memory_order_relaxed);
+      }
+      ring_initialized = true;
+      // Make sure everything is flushed if the program never disables us
+      std::atexit([] { Printer::setAsyncLogging(false); });
+    }
+    async_running.store(true);
+    async_enabled.store(true);
+    async_drain_thread = std::thread(async_drain_loop);
+  } else if (!enable && async_running.load()) {
+    // New messages go back to synchronous printing, then flush what is queued
+    async_enabled.store(false);
+    async_running.store(false);
+    if (async_drain_thread.joinable()) {
+      async_drain_thread.join();
+    }
+    static uint64_t dropped_reported = 0;
+    uint64_t dropped = async_dropped.load();
+    if (dropped > dropped_reported) {
+      printf("[PRINT]: dropped %llu messages since the async ring was full\n", (unsigned long long)(dropped - dropped_reported));
+      dropped_reported = dropped;
+    }
+  }
+}
+
+uint64_t Printer::droppedMessages() { return async_dropped.load(); }
+
 void Printer::debugPrint(PrintLevel level, const char location[], const char line[], const char *format, ...) {
   // Only print for the current debug level
   if (static_cast<int>(level) < static_cast<int>(Printer::current_print_level)) {
     return;
   }
 
+  // If the async backend is running then we format into a stack buffer and hand
+  // the result to the ring, so the caller never pays for the console I/O
+  if (async_enabled.load(std::memory_order_relaxed)) {
+    char buffer[ASYNC_MAX_MSG_LENGTH];
+    size_t offset = 0;
+    if (static_cast<int>(Printer::current_print_level) <= static_cast<int>(Printer::PrintLevel::DEBUG)) {
+      const char *base_filename = strrchr(location, '/');
+      base_filename = (base_filename == nullptr) ? location : base_filename + 1;
+      size_t len = strlen(base_filename);
+      if (len > MAX_FILE_PATH_LEGTH) {
+        base_filename += len - MAX_FILE_PATH_LEGTH;
+      }
+      int written = snprintf(buffer, sizeof(buffer), "%s:%s ", base_filename, line);
+      offset = (written > 0) ? std::min((size_t)written, sizeof(buffer) - 1) : 0;
+    }
+    va_list args;
+    va_start(args, format);
+    vsnprintf(buffer + offset, sizeof(buffer) - offset, format, args);
+    va_end(args);
+    async_push(buffer);
+    return;
+  }
+
   // Print the location info first for our debug output
   // Truncate the filename to the max size for the filepath
   if (static_cast<int>(Printer::current_print_level) <= static_cast<int>(Printer::PrintLevel::DEBUG)) {
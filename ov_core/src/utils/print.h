@@ -74,6 +74,22 @@ public:
    */
   static void debugPrint(PrintLevel level, const char location[], const char line[], const char *format, ...);
 
+  /**
+   * @brief Enable or disable the asynchronous logging backend.
+   *
+   * When enabled, callers format into a fixed-size lock-free ring and a background
+   * thread drains it to stdout, so even full debug logging only costs the caller the
+   * formatting time (microseconds) instead of the console I/O. If the ring is full
+   * the message is dropped and counted (see @ref droppedMessages) rather than
+   * blocking the caller. Disabling flushes all pending messages before returning.
+   *
+   * @param enable If we should print asynchronously
+   */
+  static void setAsyncLogging(bool enable);
+
+  /// Number of messages dropped because the asynchronous ring was full
+  static uint64_t droppedMessages();
+
   /// The current print level
   static PrintLevel current_print_level;
 
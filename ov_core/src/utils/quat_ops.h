@@ -150,9 +150,11 @@ inline Eigen::Matrix<double, 3, 3> skew_x(const Eigen::Matrix<double, 3, 1> &w)
  * @return 3x3 SO(3) rotation matrix
  */
 inline Eigen::Matrix<double, 3, 3> quat_2_Rot(const Eigen::Matrix<double, 4, 1> &q) {
+  // NOTE: written with fixed-size expressions only, this is called in tight propagation
+  // NOTE: loops and the dynamic-size identity previously used here heap allocated each call
   Eigen::Matrix<double, 3, 3> q_x = skew_x(q.block(0, 0, 3, 1));
-  Eigen::MatrixXd Rot = (2 * std::pow(q(3, 0), 2) - 1) * Eigen::MatrixXd::Identity(3, 3) - 2 * q(3, 0) * q_x +
-                        2 * q.block(0, 0, 3, 1) * (q.block(0, 0, 3, 1).transpose());
+  Eigen::Matrix<double, 3, 3> Rot = (2 * q(3, 0) * q(3, 0) - 1) * Eigen::Matrix<double, 3, 3>::Identity() - 2 * q(3, 0) * q_x +
+                                    2 * q.block(0, 0, 3, 1) * (q.block(0, 0, 3, 1).transpose());
   return Rot;
 }
 
@@ -178,14 +180,13 @@ inline Eigen::Matrix<double, 3, 3> quat_2_Rot(const Eigen::Matrix<double, 4, 1>
  * @return 4x1 resulting q*p quaternion
  */
 inline Eigen::Matrix<double, 4, 1> quat_multiply(const Eigen::Matrix<double, 4, 1> &q, const Eigen::Matrix<double, 4, 1> &p) {
+  // The big L matrix multiplied out by hand, so we neither build the 4x4 nor
+  // heap allocate the dynamic-size identity it used to be assembled from
   Eigen::Matrix<double, 4, 1> q_t;
-  Eigen::Matrix<double, 4, 4> Qm;
-  // create big L matrix
-  Qm.block(0, 0, 3, 3) = q(3, 0) * Eigen::MatrixXd::Identity(3, 3) - skew_x(q.block(0, 0, 3, 1));
-  Qm.block(0, 3, 3, 1) = q.block(0, 0, 3, 1);
-  Qm.block(3, 0, 1, 3) = -q.block(0, 0, 3, 1).transpose();
-  Qm(3, 3) = q(3, 0);
-  q_t = Qm * p;
+  q_t(0) = q(3) * p(0) + q(2) * p(1) - q(1) * p(2) + q(0) * p(3);
+  q_t(1) = -q(2) * p(0) + q(3) * p(1) + q(0) * p(2) + q(1) * p(3);
+  q_t(2) = q(1) * p(0) - q(0) * p(1) + q(3) * p(2) + q(2) * p(3);
+  q_t(3) = -q(0) * p(0) - q(1) * p(1) - q(2) * p(2) + q(3) * p(3);
   // ensure unique by forcing q_4 to be >0
   if (q_t(3, 0) < 0) {
     q_t *= -1;
@@ -230,24 +231,23 @@ inline Eigen::Matrix<double, 3, 1> vee(const Eigen::Matrix<double, 3, 3> &w_x) {
  */
 inline Eigen::Matrix<double, 3, 3> exp_so3(const Eigen::Matrix<double, 3, 1> &w) {
   // get theta
-  Eigen::Matrix<double, 3, 3> w_x = skew_x(w);
-  double theta = w.norm();
+  double theta2 = w.dot(w);
+  double theta = std::sqrt(theta2);
   // Handle small angle values
+  // For small theta the Taylor series A=1-theta^2/6 and B=1/2-theta^2/24 are
+  // exact to double precision, and skip the sin/cos calls in these hot loops
   double A, B;
-  if (theta < 1e-7) {
-    A = 1;
-    B = 0.5;
+  if (theta < 1e-3) {
+    A = 1.0 - theta2 / 6.0;
+    B = 0.5 - theta2 / 24.0;
   } else {
-    A = sin(theta) / theta;
-    B = (1 - cos(theta)) / (theta * theta);
+    A = std::sin(theta) / theta;
+    B = (1 - std::cos(theta)) / theta2;
   }
   // compute so(3) rotation
-  Eigen::Matrix<double, 3, 3> R;
-  if (theta == 0) {
-    R = Eigen::MatrixXd::Identity(3, 3);
-  } else {
-    R = Eigen::MatrixXd::Identity(3, 3) + A * w_x + B * w_x * w_x;
-  }
+  // We use the identity skew(w)^2 = w*w^T - theta^2*I to avoid the matrix-matrix product
+  Eigen::Matrix<double, 3, 3> R =
+      (1.0 - B * theta2) * Eigen::Matrix<double, 3, 3>::Identity() + A * skew_x(w) + B * w * w.transpose();
   return R;
 }
 
@@ -515,11 +515,12 @@ inline Eigen::Matrix<double, 4, 1> quatnorm(Eigen::Matrix<double, 4, 1> q_t) {
 inline Eigen::Matrix<double, 3, 3> Jl_so3(const Eigen::Matrix<double, 3, 1> &w) {
   double theta = w.norm();
   if (theta < 1e-6) {
-    return Eigen::MatrixXd::Identity(3, 3);
+    return Eigen::Matrix<double, 3, 3>::Identity();
   } else {
     Eigen::Matrix<double, 3, 1> a = w / theta;
-    Eigen::Matrix<double, 3, 3> J = sin(theta) / theta * Eigen::MatrixXd::Identity(3, 3) + (1 - sin(theta) / theta) * a * a.transpose() +
-                                    ((1 - cos(theta)) / theta) * skew_x(a);
+    double stt = std::sin(theta) / theta;
+    Eigen::Matrix<double, 3, 3> J =
+        stt * Eigen::Matrix<double, 3, 3>::Identity() + (1 - stt) * a * a.transpose() + ((1 - std::cos(theta)) / theta) * skew_x(a);
     return J;
   }
 }
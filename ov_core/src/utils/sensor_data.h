@@ -23,9 +23,14 @@
 #define OV_CORE_SENSOR_DATA_H
 
 #include <Eigen/Eigen>
+#include <mutex>
 #include <opencv2/opencv.hpp>
 #include <vector>
 
+#include "colors.h"
+#include "print.h"
+#include "tracer.h"
+
 namespace ov_core {
 
 /**
@@ -57,6 +62,12 @@ struct CameraData {
   /// Timestamp of the reading
   double timestamp;
 
+  /// Tick stamp of when the driver handed this image over (see ov_core::Tracer::now).
+  /// This is the reference point of the end-to-end latency accounting: the estimator
+  /// measures its queue wait against it and the publisher measures the full
+  /// sensor-handoff-to-output latency against it.
+  uint64_t time_received = Tracer::now();
+
   /// Camera ids for each of the images collected
   std::vector<int> sensor_ids;
 
@@ -66,6 +77,15 @@ struct CameraData {
   /// Tracking masks for each camera we have
   std::vector<cv::Mat> masks;
 
+  /// Lifetime handles for externally-owned image buffers.
+  /// A producer that hands over images *without* copying (e.g. a ROS callback using
+  /// cv_bridge::toCvShare, whose cv::Mat aliases the middleware message) must park a
+  /// handle to the owning object here, since cv::Mat does not reference count external
+  /// data. Consumers that retain an image past the life of this struct (see
+  /// TrackBase::img_owners_last) keep the handles alongside it. Left empty when the
+  /// images own their data.
+  std::vector<std::shared_ptr<const void>> owners;
+
   /// Sort function to allow for using of STL containers
   bool operator<(const CameraData &other) const {
     if (timestamp == other.timestamp) {
@@ -78,6 +98,91 @@ struct CameraData {
   }
 };
 
+/**
+ * @brief Struct for a collection of simulated camera measurements.
+ *
+ * This is the image-free equivalent of @ref CameraData for simulated frontends: the
+ * simulator already knows the uv projections, so there are no pixels to carry around
+ * and no cv::Mat is ever allocated on this path. Each entry of @ref feats holds the
+ * (feature id, noisy uv) observations of the camera with the matching @ref sensor_ids
+ * entry. The vectors are intended to be handed along by move from the simulator all
+ * the way into the tracker.
+ */
+struct SimCameraData {
+
+  /// Timestamp of the reading
+  double timestamp;
+
+  /// Camera ids for each of the observation sets collected
+  std::vector<int> sensor_ids;
+
+  /// Noisy uv measurements and feature ids for each camera
+  std::vector<std::vector<std::pair<size_t, Eigen::VectorXf>>> feats;
+
+  /// Sort function to allow for using of STL containers
+  bool operator<(const SimCameraData &other) const { return timestamp < other.timestamp; }
+};
+
+/**
+ * @brief Fixed-size pool of reusable image buffers.
+ *
+ * Sensor callbacks which deposit images into @ref CameraData typically clone the incoming
+ * cv::Mat, which at high rates costs both the memcpy and a fresh heap allocation per frame.
+ * This pool instead hands out preallocated slabs from a fixed-size ring, so the only cost
+ * left in the callback is the single copy out of the driver/ROS buffer.
+ *
+ * We lean on cv::Mat's own reference counting to know when a slab has been released: the
+ * pool always holds one reference, so a slab whose refcount has dropped back to one is free
+ * to be handed out again. If every slab is still checked out (i.e. the consumer is holding
+ * onto more frames than expected) we fall back to a normal allocation and warn, so the
+ * system degrades to the old behavior rather than blocking the sensor callback.
+ */
+class ImagePool {
+
+public:
+  /**
+   * @brief Construct a pool with a fixed number of reusable slabs
+   * @param num_slabs How many images can be checked out at the same time
+   */
+  explicit ImagePool(size_t num_slabs = 8) : slabs(num_slabs) {}
+
+  /**
+   * @brief Checkout a buffer of the requested size from the pool
+   * @param rows image height in pixels
+   * @param cols image width in pixels
+   * @param type OpenCV image type (e.g. CV_8UC1)
+   * @return A cv::Mat backed by a pooled slab (or freshly allocated if the pool is exhausted)
+   *
+   * The returned matrix can be treated like any other cv::Mat, and the slab automatically
+   * returns to the pool once all copies of it have been destructed.
+   */
+  cv::Mat checkout(int rows, int cols, int type) {
+    std::lock_guard<std::mutex> lck(mtx);
+    for (size_t i = 0; i < slabs.size(); i++) {
+      cv::Mat &slab = slabs.at((next + i) % slabs.size());
+      // A refcount of one means only the pool still references this slab
+      if (slab.u != nullptr && CV_XADD(&slab.u->refcount, 0) != 1)
+        continue;
+      // The create() call only allocates if the size or type changed
+      slab.create(rows, cols, type);
+      next = (next + i + 1) % slabs.size();
+      return slab;
+    }
+    PRINT_WARNING(YELLOW "ImagePool: all %zu slabs checked out, falling back to allocation\n" RESET, slabs.size());
+    return cv::Mat(rows, cols, type);
+  }
+
+private:
+  /// Lock protecting the slab ring (checkout can be called from multiple sensor callbacks)
+  std::mutex mtx;
+
+  /// Our preallocated image slabs
+  std::vector<cv::Mat> slabs;
+
+  /// Index we should start our next free-slab search from
+  size_t next = 0;
+};
+
 /**
  * @brief Struct for GPS measurements.
  *
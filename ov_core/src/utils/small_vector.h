@@ -0,0 +1,118 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2018-2023 Patrick Geneva
+ * Copyright (C) 2018-2023 Guoquan Huang
+ * Copyright (C) 2018-2023 OpenVINS Contributors
+ * Copyright (C) 2018-2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OV_CORE_SMALL_VECTOR_H
+#define OV_CORE_SMALL_VECTOR_H
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace ov_core {
+
+/**
+ * @brief Vector with inline storage for its first N elements.
+ *
+ * The hot pipeline paths build many short-lived lists that are almost always tiny (the
+ * clones observing one feature, the state variables one Jacobian touches) but that a
+ * std::vector or hash map would put on the heap every time, which the allocation auditor
+ * (see alloc_audit.h) attributes as steady per-frame churn. This container keeps up to N
+ * elements in the object itself, typically on the stack of the function that builds the
+ * list, and only falls back to the heap in the rare case the list outgrows that. The
+ * interface is the small subset of std::vector these call sites need.
+ */
+template <typename T, size_t N> class SmallVector {
+
+public:
+  SmallVector() : data_((T *)inline_storage_), size_(0), capacity_(N) {}
+
+  // Not copyable or movable, these live and die inside one function
+  SmallVector(const SmallVector &) = delete;
+  SmallVector &operator=(const SmallVector &) = delete;
+
+  ~SmallVector() {
+    clear();
+    if (data_ != (T *)inline_storage_)
+      ::operator delete(data_);
+  }
+
+  /// Append a copy of the given value
+  void push_back(const T &value) { emplace_back(value); }
+
+  /// Append an element constructed in place from the given arguments
+  template <typename... Args> void emplace_back(Args &&... args) {
+    if (size_ == capacity_)
+      grow();
+    new (data_ + size_) T(std::forward<Args>(args)...);
+    size_++;
+  }
+
+  /// Destroy all elements (the heap buffer, if we spilled into one, is kept)
+  void clear() {
+    for (size_t i = 0; i < size_; i++)
+      data_[i].~T();
+    size_ = 0;
+  }
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  T &operator[](size_t i) { return data_[i]; }
+  const T &operator[](size_t i) const { return data_[i]; }
+
+  T *begin() { return data_; }
+  T *end() { return data_ + size_; }
+  const T *begin() const { return data_; }
+  const T *end() const { return data_ + size_; }
+
+private:
+  /// Spill into a heap buffer twice the current capacity (rare, the inline
+  /// capacity should be chosen to cover every normal configuration)
+  void grow() {
+    size_t capacity_new = 2 * capacity_;
+    T *data_new = (T *)::operator new(capacity_new * sizeof(T));
+    for (size_t i = 0; i < size_; i++) {
+      new (data_new + i) T(std::move(data_[i]));
+      data_[i].~T();
+    }
+    if (data_ != (T *)inline_storage_)
+      ::operator delete(data_);
+    data_ = data_new;
+    capacity_ = capacity_new;
+  }
+
+  /// Inline element storage (uninitialized, elements are constructed in place)
+  typename std::aligned_storage<sizeof(T), alignof(T)>::type inline_storage_[N];
+
+  /// Current element buffer (the inline storage until we spill)
+  T *data_;
+
+  /// Number of constructed elements
+  size_t size_;
+
+  /// Capacity of the current buffer
+  size_t capacity_;
+};
+
+} // namespace ov_core
+
+#endif // OV_CORE_SMALL_VECTOR_H
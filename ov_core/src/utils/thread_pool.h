@@ -0,0 +1,283 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2018-2023 Patrick Geneva
+ * Copyright (C) 2018-2023 Guoquan Huang
+ * Copyright (C) 2018-2023 OpenVINS Contributors
+ * Copyright (C) 2018-2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OV_CORE_THREAD_POOL_H
+#define OV_CORE_THREAD_POOL_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#endif
+
+#include "thread_registry.h"
+
+namespace ov_core {
+
+/**
+ * @brief OpenVINS-owned work-stealing task pool.
+ *
+ * Historically all our tracking and update parallelism went through cv::parallel_for_,
+ * which shares OpenCV's global thread pool with pyramid construction and with any other
+ * vision code running in the process. This pool is ours alone: tasks are distributed
+ * round-robin across per-worker deques, each worker services its own deque front first
+ * and steals from the back of its neighbours when idle, and the workers can optionally
+ * be pinned to specific cores.
+ *
+ * The parallel_for() entry point is safe to nest: the calling thread always helps
+ * execute the loop body itself (workers never block waiting on other workers), and if
+ * the pool has not been configured the loop simply runs inline on the caller.
+ */
+class ThreadPool {
+
+public:
+  /// Global pool shared by all OpenVINS components in this process
+  static ThreadPool &instance() {
+    static ThreadPool pool;
+    return pool;
+  }
+
+  /**
+   * @brief Enables or disables replay-stable parallel execution.
+   *
+   * Parallel code is expected to consult deterministic() and avoid any behavior that
+   * depends on how its tasks interleave (e.g. the early-exit budget check in the grid
+   * detectors, or shared-counter feature id assignment in the trackers). Reductions in
+   * this codebase are already fixed-order (per-index result slots combined serially),
+   * so with this set two runs over the same data produce identical estimates regardless
+   * of the worker count. Set it before feeding any data, it is not meant to be toggled
+   * mid-run.
+   */
+  void set_deterministic(bool enable) { deterministic_mode = enable; }
+
+  /// True if parallel paths must avoid interleaving-dependent behavior (see set_deterministic())
+  bool deterministic() const { return deterministic_mode; }
+
+  /**
+   * @brief Starts (or restarts) the pool with the given number of workers
+   * @param num_threads Number of worker threads (0 or 1 makes parallel_for run inline)
+   * @param affinity Optional core ids to pin the workers to (cycled if fewer than workers)
+   */
+  void configure(int num_threads, const std::vector<int> &affinity = {}) {
+    shutdown();
+    if (num_threads < 2)
+      return;
+    running = true;
+    for (int i = 0; i < num_threads; i++)
+      workers.push_back(std::unique_ptr<Worker>(new Worker()));
+    for (int i = 0; i < num_threads; i++) {
+      threads.emplace_back(&ThreadPool::worker_loop, this, (size_t)i);
+#if defined(__linux__)
+      if (!affinity.empty()) {
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        CPU_SET(affinity.at(i % affinity.size()), &cpuset);
+        pthread_setaffinity_np(threads.back().native_handle(), sizeof(cpu_set_t), &cpuset);
+      }
+#else
+      (void)affinity;
+#endif
+    }
+  }
+
+  /**
+   * @brief Runs body(i) for every i in [begin, end) across the pool
+   * @param begin First loop index (inclusive)
+   * @param end Last loop index (exclusive)
+   * @param body Loop body to invoke for each index
+   *
+   * Blocks until all indices have been processed. The caller participates in the
+   * work, so this is safe to call from inside another parallel_for body.
+   */
+  void parallel_for(int begin, int end, const std::function<void(int)> &body) {
+
+    // Run inline if there is no pool or nothing to share
+    if (end - begin <= 0)
+      return;
+    if (threads.empty() || end - begin == 1) {
+      for (int i = begin; i < end; i++)
+        body(i);
+      return;
+    }
+
+    // Shared job that hands out loop indices to whoever grabs them first
+    auto job = std::make_shared<RangeJob>();
+    job->next = begin;
+    job->end = end;
+    job->body = body;
+    job->pending = (int)threads.size();
+
+    // One helper task per worker (idle workers will steal them from busy ones)
+    for (size_t i = 0; i < threads.size(); i++)
+      submit([job] { job->run(); });
+
+    // The caller chews through indices too, then *helps* with other queued tasks
+    // until its helpers have all finished. Helping (instead of sleeping) is what
+    // makes nested parallel_for calls deadlock free: a blocked caller will end up
+    // executing the queued helper tasks itself if every worker is busy.
+    int i;
+    while ((i = job->next.fetch_add(1)) < job->end)
+      job->body(i);
+    while (job->pending.load(std::memory_order_acquire) != 0) {
+      std::function<void()> task;
+      if (try_steal_any(task))
+        task();
+      else
+        std::this_thread::yield();
+    }
+  }
+
+  /**
+   * @brief Fire-and-forget submission of a standalone task to the pool
+   * @param task Work to run on some worker thread
+   * @return True if the task was queued, false if there are no workers (task NOT run)
+   *
+   * Used for pipelined work that is purely an optimization (e.g. pre-building image
+   * pyramids at enqueue time): when the pool is not running the caller should simply
+   * skip the work and let the synchronous path compute it later.
+   */
+  bool async(std::function<void()> task) {
+    if (threads.empty())
+      return false;
+    submit(std::move(task));
+    return true;
+  }
+
+  /// Stops all workers and discards any queued tasks
+  void shutdown() {
+    if (!running)
+      return;
+    running = false;
+    cv_work.notify_all();
+    for (auto &thread : threads)
+      thread.join();
+    threads.clear();
+    workers.clear();
+  }
+
+  ~ThreadPool() { shutdown(); }
+
+private:
+  ThreadPool() = default;
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  /// Per-worker task deque (own thread pops the front, thieves take the back)
+  struct Worker {
+    std::deque<std::function<void()>> tasks;
+    std::mutex mtx;
+  };
+
+  /// State shared by all participants of one parallel_for call
+  struct RangeJob {
+    std::atomic<int> next{0};
+    int end = 0;
+    std::function<void(int)> body;
+    std::atomic<int> pending{0};
+    void run() {
+      int i;
+      while ((i = next.fetch_add(1)) < end)
+        body(i);
+      pending.fetch_sub(1, std::memory_order_release);
+    }
+  };
+
+  /// Appends a task to the next worker deque in round-robin order
+  void submit(std::function<void()> task) {
+    size_t id = submit_index.fetch_add(1) % workers.size();
+    {
+      std::lock_guard<std::mutex> lck(workers.at(id)->mtx);
+      workers.at(id)->tasks.push_back(std::move(task));
+    }
+    cv_work.notify_all();
+  }
+
+  /// Pops a task from our own deque, or steals one from a neighbour
+  bool try_pop(size_t id, std::function<void()> &task) {
+    {
+      std::lock_guard<std::mutex> lck(workers.at(id)->mtx);
+      if (!workers.at(id)->tasks.empty()) {
+        task = std::move(workers.at(id)->tasks.front());
+        workers.at(id)->tasks.pop_front();
+        return true;
+      }
+    }
+    for (size_t n = 1; n < workers.size(); n++) {
+      size_t other = (id + n) % workers.size();
+      std::lock_guard<std::mutex> lck(workers.at(other)->mtx);
+      if (!workers.at(other)->tasks.empty()) {
+        task = std::move(workers.at(other)->tasks.back());
+        workers.at(other)->tasks.pop_back();
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /// Steals a task from any worker deque (used by callers helping while they wait)
+  bool try_steal_any(std::function<void()> &task) {
+    for (size_t n = 0; n < workers.size(); n++) {
+      std::lock_guard<std::mutex> lck(workers.at(n)->mtx);
+      if (!workers.at(n)->tasks.empty()) {
+        task = std::move(workers.at(n)->tasks.back());
+        workers.at(n)->tasks.pop_back();
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /// Main loop of each worker: run local work, steal, or sleep
+  void worker_loop(size_t id) {
+    // NOTE: a "track" role in the thread registry policy also pins us here, use
+    // NOTE: either that or the explicit configure() affinity list, not both
+    ThreadRegistry::register_thread("track pool " + std::to_string(id));
+    while (running) {
+      std::function<void()> task;
+      if (try_pop(id, task)) {
+        task();
+        continue;
+      }
+      std::unique_lock<std::mutex> lck(cv_mtx);
+      cv_work.wait_for(lck, std::chrono::milliseconds(10));
+    }
+  }
+
+  std::vector<std::unique_ptr<Worker>> workers;
+  std::vector<std::thread> threads;
+  std::condition_variable cv_work;
+  std::mutex cv_mtx;
+  std::atomic<bool> running{false};
+  std::atomic<bool> deterministic_mode{false};
+  std::atomic<size_t> submit_index{0};
+};
+
+} // namespace ov_core
+
+#endif // OV_CORE_THREAD_POOL_H
@@ -0,0 +1,167 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2018-2023 Patrick Geneva
+ * Copyright (C) 2018-2023 Guoquan Huang
+ * Copyright (C) 2018-2023 OpenVINS Contributors
+ * Copyright (C) 2018-2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "thread_registry.h"
+
+#include "colors.h"
+#include "print.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace ov_core;
+
+std::mutex ThreadRegistry::_mtx;
+std::map<std::string, ThreadRegistry::Policy> ThreadRegistry::_policies;
+
+/// Strips leading and trailing whitespace from a spec token
+static std::string trim(const std::string &str) {
+  size_t first = str.find_first_not_of(" \t");
+  if (first == std::string::npos)
+    return "";
+  size_t last = str.find_last_not_of(" \t");
+  return str.substr(first, last - first + 1);
+}
+
+std::map<std::string, std::vector<int>> ThreadRegistry::parse_spec(const std::string &name, const std::string &spec) {
+  std::map<std::string, std::vector<int>> entries;
+  std::stringstream ss_entries(spec);
+  std::string entry;
+  while (std::getline(ss_entries, entry, ';')) {
+    entry = trim(entry);
+    if (entry.empty())
+      continue;
+    size_t split = entry.find(':');
+    std::string role = (split == std::string::npos) ? "" : trim(entry.substr(0, split));
+    if (role.empty()) {
+      PRINT_ERROR(RED "ThreadRegistry(): malformed %s entry \"%s\"\n" RESET, name.c_str(), entry.c_str());
+      PRINT_ERROR(RED "ThreadRegistry(): expected \"role:value,value,...\" entries separated by semicolons\n" RESET);
+      std::exit(EXIT_FAILURE);
+    }
+    std::vector<int> values;
+    std::stringstream ss_values(entry.substr(split + 1));
+    std::string value;
+    while (std::getline(ss_values, value, ',')) {
+      try {
+        values.push_back(std::stoi(trim(value)));
+      } catch (const std::exception &) {
+        PRINT_ERROR(RED "ThreadRegistry(): non-integer value \"%s\" in %s entry \"%s\"\n" RESET, value.c_str(), name.c_str(),
+                    entry.c_str());
+        std::exit(EXIT_FAILURE);
+      }
+    }
+    if (values.empty()) {
+      PRINT_ERROR(RED "ThreadRegistry(): no values in %s entry \"%s\"\n" RESET, name.c_str(), entry.c_str());
+      std::exit(EXIT_FAILURE);
+    }
+    entries[role] = values;
+  }
+  return entries;
+}
+
+void ThreadRegistry::configure(const std::string &affinity_spec, const std::string &priority_spec) {
+  std::lock_guard<std::mutex> lck(_mtx);
+  _policies.clear();
+  for (const auto &entry : parse_spec("thread_affinity_policy", affinity_spec)) {
+    _policies[entry.first].cores = entry.second;
+  }
+  for (const auto &entry : parse_spec("thread_priority_policy", priority_spec)) {
+    if (entry.second.size() != 1) {
+      PRINT_ERROR(RED "ThreadRegistry(): role \"%s\" should have exactly one niceness value (has %d)\n" RESET, entry.first.c_str(),
+                  (int)entry.second.size());
+      std::exit(EXIT_FAILURE);
+    }
+    _policies[entry.first].niceness = entry.second.at(0);
+    _policies[entry.first].has_niceness = true;
+  }
+}
+
+void ThreadRegistry::register_thread(const std::string &role) {
+
+  // Find the policy whose role prefix matches best (longest prefix of our role wins)
+  Policy policy;
+  bool matched = false;
+  {
+    std::lock_guard<std::mutex> lck(_mtx);
+    size_t best_len = 0;
+    for (const auto &pair : _policies) {
+      if (role.compare(0, pair.first.size(), pair.first) == 0 && pair.first.size() >= best_len) {
+        policy = pair.second;
+        best_len = pair.first.size();
+        matched = true;
+      }
+    }
+  }
+
+#if defined(__linux__)
+
+  // Name the thread so it shows up by role in top/gdb (the kernel caps names at 15 chars)
+  pthread_setname_np(pthread_self(), role.substr(0, 15).c_str());
+
+  // Nothing else to do if no policy covers this role
+  if (!matched) {
+    PRINT_DEBUG("[THREADS]: %s thread started (no policy)\n", role.c_str());
+    return;
+  }
+
+  // Pin ourselves to the requested cores
+  std::stringstream assignment;
+  if (!policy.cores.empty()) {
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    for (int core : policy.cores)
+      CPU_SET(core, &cpuset);
+    int ret = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+    if (ret != 0) {
+      PRINT_WARNING(YELLOW "[THREADS]: unable to set affinity of the %s thread (%s)\n" RESET, role.c_str(), std::strerror(ret));
+    } else {
+      assignment << " cores {";
+      for (size_t i = 0; i < policy.cores.size(); i++)
+        assignment << (i == 0 ? "" : ",") << policy.cores.at(i);
+      assignment << "}";
+    }
+  }
+
+  // And lower (or with privileges raise) our scheduling priority
+  if (policy.has_niceness) {
+    errno = 0;
+    if (setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), policy.niceness) != 0) {
+      PRINT_WARNING(YELLOW "[THREADS]: unable to set niceness of the %s thread (%s)\n" RESET, role.c_str(), std::strerror(errno));
+    } else {
+      assignment << " nice " << policy.niceness;
+    }
+  }
+  PRINT_INFO("[THREADS]: %s thread ->%s\n", role.c_str(), assignment.str().empty() ? " (nothing applied)" : assignment.str().c_str());
+
+#else
+  (void)matched;
+  PRINT_DEBUG("[THREADS]: %s thread started (affinity not supported on this platform)\n", role.c_str());
+#endif
+}
@@ -0,0 +1,90 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2018-2023 Patrick Geneva
+ * Copyright (C) 2018-2023 Guoquan Huang
+ * Copyright (C) 2018-2023 OpenVINS Contributors
+ * Copyright (C) 2018-2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OV_CORE_THREAD_REGISTRY_H
+#define OV_CORE_THREAD_REGISTRY_H
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace ov_core {
+
+/**
+ * @brief Role-based core affinity and priority for the threads we spawn.
+ *
+ * Every thread OpenVINS creates registers itself here with a role name at the top of its
+ * loop ("track pool 0", "filter", "visualization", "prefetch bag", ...). The registry
+ * matches the role against a user-configured policy and applies the requested core
+ * affinity and niceness to the calling thread, printing the assignment so a startup log
+ * shows exactly which thread landed where. On asymmetric (big.LITTLE style) parts this
+ * is how the tracking and filter threads get kept on the performance cores while the
+ * visualization and prefetch threads are pushed to the efficiency cores.
+ *
+ * The policy is two spec strings, normally loaded from the launch yaml:
+ *
+ *     thread_affinity_policy: "track:4,5,6,7;filter:4,5;visualization:0,1"
+ *     thread_priority_policy: "visualization:10;prefetch:5"
+ *
+ * Each entry is `role:<values>` separated by semicolons. Affinity values are the core
+ * ids the role may run on, priority values are a single niceness (positive values lower
+ * the priority, negatives need privileges). A policy entry applies to every registered
+ * role it is a prefix of, longest prefix wins, so "track" covers all pool workers.
+ * With no policy configured registration is just a debug print, and everything is a
+ * no-op on non-Linux platforms. Configure before the pipeline threads are started (the
+ * VioManager constructor does this before it spawns anything).
+ */
+class ThreadRegistry {
+
+public:
+  /**
+   * @brief Loads the per-role policy from the given spec strings
+   * @param affinity_spec Semicolon-separated `role:core,core,...` entries (empty to disable)
+   * @param priority_spec Semicolon-separated `role:niceness` entries (empty to disable)
+   */
+  static void configure(const std::string &affinity_spec, const std::string &priority_spec);
+
+  /**
+   * @brief Registers the calling thread under the given role and applies the matching policy
+   * @param role Role name of this thread (also becomes its debugger-visible name)
+   */
+  static void register_thread(const std::string &role);
+
+private:
+  /// Affinity and priority requested for one role prefix
+  struct Policy {
+    std::vector<int> cores;
+    int niceness = 0;
+    bool has_niceness = false;
+  };
+
+  /// Splits one `role:values` spec string into its entries (exits on malformed input)
+  static std::map<std::string, std::vector<int>> parse_spec(const std::string &name, const std::string &spec);
+
+  /// Policies keyed by role prefix (longest prefix of a registered role wins)
+  static std::mutex _mtx;
+  static std::map<std::string, Policy> _policies;
+};
+
+} // namespace ov_core
+
+#endif // OV_CORE_THREAD_REGISTRY_H
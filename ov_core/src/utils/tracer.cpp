@@ -0,0 +1,192 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2018-2023 Patrick Geneva
+ * Copyright (C) 2018-2023 Guoquan Huang
+ * Copyright (C) 2018-2023 OpenVINS Contributors
+ * Copyright (C) 2018-2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "tracer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <thread>
+
+#include "print.h"
+
+using namespace ov_core;
+
+// Static storage for the enable flag and the thread buffer registry
+std::atomic<bool> Tracer::_enabled(false);
+std::mutex Tracer::_registry_mtx;
+std::vector<std::shared_ptr<Tracer::ThreadBuffer>> Tracer::_registry;
+
+uint32_t &Tracer::thread_depth() {
+  static thread_local uint32_t depth = 0;
+  return depth;
+}
+
+Tracer::ThreadBuffer &Tracer::buffer() {
+  // First use on this thread allocates the ring and registers it for dumping
+  static thread_local std::shared_ptr<ThreadBuffer> buf = [] {
+    auto created = std::make_shared<ThreadBuffer>();
+    std::lock_guard<std::mutex> lck(_registry_mtx);
+    _registry.push_back(created);
+    return created;
+  }();
+  return *buf;
+}
+
+double Tracer::to_seconds(uint64_t ticks) {
+
+  // Anchor pair captured the first time any span asks for seconds
+  // The tick rate is re-derived from the anchor on every call, so the estimate
+  // only gets better as the program runs (and the call itself stays cheap)
+  static uint64_t tsc_anchor = now();
+  static std::chrono::steady_clock::time_point wall_anchor = std::chrono::steady_clock::now();
+
+  // Make sure enough wall time has passed for a stable rate estimate
+  uint64_t tsc_now = now();
+  double elapsed = std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::steady_clock::now() - wall_anchor).count();
+  while (elapsed < 1e-3 || tsc_now <= tsc_anchor) {
+    std::this_thread::yield();
+    tsc_now = now();
+    elapsed = std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::steady_clock::now() - wall_anchor).count();
+  }
+  double ticks_per_sec = (double)(tsc_now - tsc_anchor) / elapsed;
+  return (double)ticks / ticks_per_sec;
+}
+
+void Tracer::frame(double timestamp) {
+  // Frame boundaries also pace the allocation auditor's per-frame averages
+  AllocAudit::frame();
+  if (!enabled())
+    return;
+  Record rec;
+  rec.name = nullptr;
+  rec.tsc_start = now();
+  rec.tsc_stop = rec.tsc_start;
+  rec.frame_time = timestamp;
+  ThreadBuffer &buf = buffer();
+  uint64_t head = buf.head.load(std::memory_order_relaxed);
+  buf.records[head % RING_SIZE] = rec;
+  buf.head.store(head + 1, std::memory_order_release);
+}
+
+void Tracer::record(const char *name, uint64_t tsc_start, uint64_t tsc_stop, uint32_t depth) {
+  Record rec;
+  rec.name = name;
+  rec.tsc_start = tsc_start;
+  rec.tsc_stop = tsc_stop;
+  rec.depth = depth;
+  ThreadBuffer &buf = buffer();
+  uint64_t head = buf.head.load(std::memory_order_relaxed);
+  buf.records[head % RING_SIZE] = rec;
+  buf.head.store(head + 1, std::memory_order_release);
+}
+
+void Tracer::clear() {
+  std::lock_guard<std::mutex> lck(_registry_mtx);
+  for (auto &buf : _registry) {
+    buf->head.store(0, std::memory_order_release);
+    std::fill(buf->records.begin(), buf->records.end(), Record());
+  }
+}
+
+void Tracer::dump_flamegraph(const std::string &path) {
+
+  // Snapshot all per-thread rings (readers race only against the newest slot,
+  // which at worst costs us the very last span of a still-running thread)
+  std::vector<Record> records;
+  {
+    std::lock_guard<std::mutex> lck(_registry_mtx);
+    for (auto &buf : _registry) {
+      uint64_t head = buf->head.load(std::memory_order_acquire);
+      uint64_t count = std::min(head, (uint64_t)RING_SIZE);
+      for (uint64_t i = head - count; i < head; i++) {
+        records.push_back(buf->records[i % RING_SIZE]);
+      }
+    }
+  }
+  if (records.empty()) {
+    PRINT_WARNING("[TRACE]: no spans recorded, nothing to dump\n");
+    return;
+  }
+
+  // Sort everything by start time so frames partition the spans
+  std::sort(records.begin(), records.end(), [](const Record &a, const Record &b) { return a.tsc_start < b.tsc_start; });
+
+  // Collect the span names (insertion ordered by first appearance)
+  std::vector<const char *> names;
+  for (const auto &rec : records) {
+    if (rec.name != nullptr && std::find_if(names.begin(), names.end(), [&](const char *n) { return strcmp(n, rec.name) == 0; }) == names.end()) {
+      names.push_back(rec.name);
+    }
+  }
+  if (names.empty()) {
+    PRINT_WARNING("[TRACE]: no named spans recorded, nothing to dump\n");
+    return;
+  }
+
+  // Open the output and write the header (same layout as the statistics file)
+  std::ofstream file(path, std::ofstream::out | std::ofstream::trunc);
+  if (!file.is_open()) {
+    PRINT_ERROR("[TRACE]: unable to open trace output file %s\n", path.c_str());
+    return;
+  }
+  file << "# timestamp (sec),";
+  for (const auto &name : names)
+    file << name << ",";
+  file << "total" << std::endl;
+
+  // Walk the spans in start order, emitting one row at each frame boundary
+  // A frame mark carries the timestamp of the frame that just completed, so the
+  // spans accumulated since the previous mark belong to it. The "total" column
+  // is the summed time of all top-level spans within the frame.
+  std::vector<double> sums(names.size(), 0.0);
+  double total = 0.0;
+  for (const auto &rec : records) {
+
+    // A named span: accumulate into its category
+    if (rec.name != nullptr) {
+      double secs = to_seconds(rec.tsc_stop - rec.tsc_start);
+      for (size_t c = 0; c < names.size(); c++) {
+        if (strcmp(names[c], rec.name) == 0) {
+          sums[c] += secs;
+          break;
+        }
+      }
+      if (rec.depth == 0)
+        total += secs;
+      continue;
+    }
+
+    // A frame mark: flush the accumulated row and start the next frame
+    file << std::fixed << std::setprecision(15) << rec.frame_time << std::setprecision(5);
+    for (const auto &sum : sums)
+      file << "," << sum;
+    file << "," << total << std::endl;
+    std::fill(sums.begin(), sums.end(), 0.0);
+    total = 0.0;
+  }
+
+  file.close();
+  PRINT_INFO("[TRACE]: dumped trace history to %s\n", path.c_str());
+}
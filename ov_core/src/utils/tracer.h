@@ -0,0 +1,204 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2018-2023 Patrick Geneva
+ * Copyright (C) 2018-2023 Guoquan Huang
+ * Copyright (C) 2018-2023 OpenVINS Contributors
+ * Copyright (C) 2018-2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OV_CORE_TRACER_H
+#define OV_CORE_TRACER_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "alloc_audit.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#include <x86intrin.h>
+#define OV_CORE_TRACER_RDTSC 1
+#else
+#include <chrono>
+#endif
+
+namespace ov_core {
+
+/**
+ * @brief Low-overhead flight-recorder tracer for the hot pipeline path.
+ *
+ * This replaces the old boost::posix_time spot timers (which each cost a system call
+ * and only produced human-readable PRINT_ALL text) with RDTSC-based scoped spans.
+ * Each thread records completed spans into its own fixed-size ring buffer with no
+ * locking on the record path, so the most recent history is always available for
+ * inspection ("flight recorder"). Recording is toggled at runtime with @ref
+ * set_enabled and costs a single relaxed atomic load plus a TSC read when off.
+ *
+ * The recorded history can be dumped with @ref dump_flamegraph into the same
+ * comma-separated per-frame format that the `record_timing_information` statistics
+ * file uses, so the output can be fed straight into the ov_eval timing tools
+ * (timing_flamegraph, timing_histogram, ...). Frame boundaries are marked by the
+ * estimator calling @ref frame once per processed image with the dataset timestamp.
+ *
+ * Spans are created with the RAII @ref TraceSpan helper and always measure their
+ * duration (so callers can still print elapsed times), but are only stored into the
+ * ring buffers while tracing is enabled.
+ */
+class Tracer {
+
+public:
+  /// Number of span records each thread keeps (most recent wins, power of two)
+  static const size_t RING_SIZE = 16384;
+
+  /// Enable or disable recording at runtime (measuring stays near-free when off)
+  static void set_enabled(bool enabled) { _enabled.store(enabled, std::memory_order_relaxed); }
+
+  /// If we are currently recording spans into the flight recorder
+  static bool enabled() { return _enabled.load(std::memory_order_relaxed); }
+
+  /// Current timestamp counter value (TSC ticks, or nanoseconds on non-x86)
+  static uint64_t now() {
+#ifdef OV_CORE_TRACER_RDTSC
+    return __rdtsc();
+#else
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+  }
+
+  /// Convert a tick delta into seconds (wall-clock calibrated)
+  static double to_seconds(uint64_t ticks);
+
+  /**
+   * @brief Mark the boundary of a processing frame (one image through the pipeline).
+   * @param timestamp Dataset timestamp of this frame in seconds
+   */
+  static void frame(double timestamp);
+
+  /**
+   * @brief Store a completed span into the calling thread's ring buffer.
+   *
+   * Normally called by @ref TraceSpan, not directly.
+   * The name must be a string literal (only the pointer is stored).
+   *
+   * @param name Static name of this span (e.g. "msckf update")
+   * @param tsc_start Tick count at the start of the span
+   * @param tsc_stop Tick count at the end of the span
+   * @param depth Nesting depth of the span within its thread (0 = top level)
+   */
+  static void record(const char *name, uint64_t tsc_start, uint64_t tsc_stop, uint32_t depth);
+
+  /**
+   * @brief Dump the recorded history as a per-frame timing file.
+   *
+   * The format matches the `record_timing_information` statistics file and thus the
+   * ov_eval loaders: a commented header `# timestamp (sec),<span>,...,total` followed
+   * by one comma-separated row of per-span seconds for each recorded frame. The
+   * `total` column is the summed time of all top-level spans in that frame.
+   *
+   * @param path File we will save the timing information into
+   */
+  static void dump_flamegraph(const std::string &path);
+
+  /// Clear all recorded history (e.g. after a dump)
+  static void clear();
+
+  /// Current span nesting depth of the calling thread (used by TraceSpan)
+  static uint32_t &thread_depth();
+
+private:
+  /// A single recorded span (name==nullptr marks a frame boundary)
+  struct Record {
+    const char *name = nullptr; ///< Static span name, or nullptr for a frame mark
+    uint64_t tsc_start = 0;     ///< Tick count at span start
+    uint64_t tsc_stop = 0;      ///< Tick count at span end
+    double frame_time = 0.0;    ///< Dataset timestamp (frame marks only)
+    uint32_t depth = 0;         ///< Nesting depth within the recording thread
+  };
+
+  /// Fixed-size single-producer ring buffer owned by one thread
+  struct ThreadBuffer {
+    std::vector<Record> records = std::vector<Record>(RING_SIZE);
+    std::atomic<uint64_t> head{0};
+  };
+
+  /// The calling thread's ring buffer (registered on first use)
+  static ThreadBuffer &buffer();
+
+  /// If we are currently recording
+  static std::atomic<bool> _enabled;
+
+  /// Registry of all per-thread ring buffers (mutated only on thread first-use)
+  static std::mutex _registry_mtx;
+  static std::vector<std::shared_ptr<ThreadBuffer>> _registry;
+};
+
+/**
+ * @brief RAII scoped span for the @ref Tracer.
+ *
+ * Reads the TSC on construction and on stop, and records itself into the flight
+ * recorder if tracing is enabled when it stops. The measured duration is always
+ * available through @ref seconds so existing debug prints can reuse it.
+ */
+class TraceSpan {
+
+public:
+  /// Start a span (name must be a string literal)
+  explicit TraceSpan(const char *name) : _name(name), _depth(Tracer::thread_depth()++), _tsc_start(Tracer::now()) {
+    // Tell the allocation auditor we are the active stage (pairing is kept through
+    // _audited so a runtime toggle mid-span can never unbalance the stage stack)
+    if (AllocAudit::enabled()) {
+      AllocAudit::push(_name);
+      _audited = true;
+    }
+  }
+
+  ~TraceSpan() { stop(); }
+
+  /// Stop the span early (otherwise stopped on destruction)
+  void stop() {
+    if (_stopped)
+      return;
+    _stopped = true;
+    _tsc_stop = Tracer::now();
+    Tracer::thread_depth()--;
+    if (_audited)
+      AllocAudit::pop();
+    if (Tracer::enabled())
+      Tracer::record(_name, _tsc_start, _tsc_stop, _depth);
+  }
+
+  /// Elapsed time of this span in seconds (span must be stopped)
+  double seconds() const { return Tracer::to_seconds(_tsc_stop - _tsc_start); }
+
+  // No copying, a span belongs to one scope
+  TraceSpan(const TraceSpan &) = delete;
+  TraceSpan &operator=(const TraceSpan &) = delete;
+
+private:
+  const char *_name;
+  uint32_t _depth;
+  uint64_t _tsc_start;
+  uint64_t _tsc_stop = 0;
+  bool _stopped = false;
+  bool _audited = false;
+};
+
+} // namespace ov_core
+
+#endif // OV_CORE_TRACER_H
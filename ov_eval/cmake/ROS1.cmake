@@ -64,7 +64,13 @@ list(APPEND LIBRARY_SOURCES
         src/alignment/AlignTrajectory.cpp
         src/alignment/AlignUtils.cpp
         src/calc/ResultTrajectory.cpp
+        src/calc/StreamingTrajectory.cpp
         src/calc/ResultSimulation.cpp
+        src/calc/ResultMonteCarlo.cpp
+        src/utils/BinaryState.cpp
+        src/utils/BinaryStats.cpp
+        src/utils/BinaryTiming.cpp
+        src/utils/BinaryTrajectory.cpp
         src/utils/Loader.cpp
 )
 file(GLOB_RECURSE LIBRARY_HEADERS "src/*.h")
@@ -152,6 +158,14 @@ install(TARGETS error_simulation
         RUNTIME DESTINATION ${CATKIN_PACKAGE_BIN_DESTINATION}
 )
 
+add_executable(error_simulation_montecarlo src/error_simulation_montecarlo.cpp)
+target_link_libraries(error_simulation_montecarlo ov_eval_lib ${thirdparty_libraries})
+install(TARGETS error_simulation_montecarlo
+        ARCHIVE DESTINATION ${CATKIN_PACKAGE_LIB_DESTINATION}
+        LIBRARY DESTINATION ${CATKIN_PACKAGE_LIB_DESTINATION}
+        RUNTIME DESTINATION ${CATKIN_PACKAGE_BIN_DESTINATION}
+)
+
 add_executable(timing_comparison src/timing_comparison.cpp)
 target_link_libraries(timing_comparison ov_eval_lib ${thirdparty_libraries})
 install(TARGETS timing_comparison
@@ -192,4 +206,12 @@ install(TARGETS plot_trajectories
         RUNTIME DESTINATION ${CATKIN_PACKAGE_BIN_DESTINATION}
 )
 
+add_executable(plot_statistics src/plot_statistics.cpp)
+target_link_libraries(plot_statistics ov_eval_lib ${thirdparty_libraries})
+install(TARGETS plot_statistics
+        ARCHIVE DESTINATION ${CATKIN_PACKAGE_LIB_DESTINATION}
+        LIBRARY DESTINATION ${CATKIN_PACKAGE_LIB_DESTINATION}
+        RUNTIME DESTINATION ${CATKIN_PACKAGE_BIN_DESTINATION}
+)
+
 
@@ -34,7 +34,13 @@ list(APPEND LIBRARY_SOURCES
         src/alignment/AlignTrajectory.cpp
         src/alignment/AlignUtils.cpp
         src/calc/ResultTrajectory.cpp
+        src/calc/StreamingTrajectory.cpp
         src/calc/ResultSimulation.cpp
+        src/calc/ResultMonteCarlo.cpp
+        src/utils/BinaryState.cpp
+        src/utils/BinaryStats.cpp
+        src/utils/BinaryTiming.cpp
+        src/utils/BinaryTrajectory.cpp
         src/utils/Loader.cpp
 )
 file(GLOB_RECURSE LIBRARY_HEADERS "src/*.h")
@@ -91,6 +97,11 @@ ament_target_dependencies(error_simulation rclcpp ov_core)
 target_link_libraries(error_simulation ov_eval_lib ${thirdparty_libraries})
 install(TARGETS error_simulation DESTINATION lib/${PROJECT_NAME})
 
+add_executable(error_simulation_montecarlo src/error_simulation_montecarlo.cpp)
+ament_target_dependencies(error_simulation_montecarlo rclcpp ov_core)
+target_link_libraries(error_simulation_montecarlo ov_eval_lib ${thirdparty_libraries})
+install(TARGETS error_simulation_montecarlo DESTINATION lib/${PROJECT_NAME})
+
 add_executable(timing_comparison src/timing_comparison.cpp)
 ament_target_dependencies(timing_comparison rclcpp ov_core)
 target_link_libraries(timing_comparison ov_eval_lib ${thirdparty_libraries})
@@ -116,6 +127,11 @@ ament_target_dependencies(plot_trajectories rclcpp ov_core)
 target_link_libraries(plot_trajectories ov_eval_lib ${thirdparty_libraries})
 install(TARGETS plot_trajectories DESTINATION lib/${PROJECT_NAME})
 
+add_executable(plot_statistics src/plot_statistics.cpp)
+ament_target_dependencies(plot_statistics rclcpp ov_core)
+target_link_libraries(plot_statistics ov_eval_lib ${thirdparty_libraries})
+install(TARGETS plot_statistics DESTINATION lib/${PROJECT_NAME})
+
 
 ##################################################
 # Python scripts!
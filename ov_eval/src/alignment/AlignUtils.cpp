@@ -21,6 +21,8 @@
 
 #include "AlignUtils.h"
 
+#include <algorithm>
+
 using namespace ov_eval;
 
 void AlignUtils::align_umeyama(const std::vector<Eigen::Matrix<double, 3, 1>> &data, const std::vector<Eigen::Matrix<double, 3, 1>> &model,
@@ -28,29 +30,30 @@ void AlignUtils::align_umeyama(const std::vector<Eigen::Matrix<double, 3, 1>> &d
 
   assert(model.size() == data.size());
 
+  // The vectors of fixed-size 3x1 points are contiguous, so map them as 3xN matrices
+  Eigen::Map<const Eigen::Matrix<double, 3, Eigen::Dynamic>> data_mat(data.at(0).data(), 3, (Eigen::Index)data.size());
+  Eigen::Map<const Eigen::Matrix<double, 3, Eigen::Dynamic>> model_mat(model.at(0).data(), 3, (Eigen::Index)model.size());
+  AlignUtils::align_umeyama(data_mat, model_mat, R, t, s, known_scale, yaw_only);
+}
+
+void AlignUtils::align_umeyama(const Eigen::Ref<const Eigen::Matrix<double, 3, Eigen::Dynamic>> &data,
+                               const Eigen::Ref<const Eigen::Matrix<double, 3, Eigen::Dynamic>> &model, Eigen::Matrix<double, 3, 3> &R,
+                               Eigen::Matrix<double, 3, 1> &t, double &s, bool known_scale, bool yaw_only) {
+
+  assert(model.cols() == data.cols());
+
   // Substract mean of each trajectory
-  Eigen::Matrix<double, 3, 1> mu_M = get_mean(model);
-  Eigen::Matrix<double, 3, 1> mu_D = get_mean(data);
-  std::vector<Eigen::Matrix<double, 3, 1>> model_zerocentered, data_zerocentered;
-  for (size_t i = 0; i < model.size(); i++) {
-    model_zerocentered.push_back(model[i] - mu_M);
-    data_zerocentered.push_back(data[i] - mu_D);
-  }
+  Eigen::Matrix<double, 3, 1> mu_M = model.rowwise().mean();
+  Eigen::Matrix<double, 3, 1> mu_D = data.rowwise().mean();
+  Eigen::Matrix<double, 3, Eigen::Dynamic> model_zerocentered = model.colwise() - mu_M;
+  Eigen::Matrix<double, 3, Eigen::Dynamic> data_zerocentered = data.colwise() - mu_D;
 
-  // Get correlation matrix
-  double n = model.size();
-  Eigen::Matrix<double, 3, 3> C = Eigen::Matrix<double, 3, 3>::Zero();
-  for (size_t i = 0; i < model_zerocentered.size(); i++) {
-    C.noalias() += model_zerocentered[i] * data_zerocentered[i].transpose();
-  }
-  C *= 1.0 / n;
+  // Get correlation matrix (a single blocked 3xN * Nx3 product instead of a point loop)
+  double n = model.cols();
+  Eigen::Matrix<double, 3, 3> C = (1.0 / n) * model_zerocentered * data_zerocentered.transpose();
 
   // Get data sigma
-  double sigma2 = 0;
-  for (size_t i = 0; i < data_zerocentered.size(); i++) {
-    sigma2 += data_zerocentered[i].dot(data_zerocentered[i]);
-  }
-  sigma2 *= 1.0 / n;
+  double sigma2 = data_zerocentered.squaredNorm() / n;
 
   // SVD decomposition
   Eigen::JacobiSVD<Eigen::Matrix<double, 3, 3>> svd(C, Eigen::ComputeFullV | Eigen::ComputeFullU);
@@ -187,3 +190,86 @@ void AlignUtils::perform_association(double offset, double max_difference, std::
   gt_covori = gt_covori_temp;
   gt_covpos = gt_covpos_temp;
 }
+
+void AlignUtils::perform_association_interpolated(double offset, double max_gap, std::vector<double> &est_times,
+                                                  std::vector<double> &gt_times, std::vector<Eigen::Matrix<double, 7, 1>> &est_poses,
+                                                  std::vector<Eigen::Matrix<double, 7, 1>> &gt_poses,
+                                                  std::vector<Eigen::Matrix3d> &est_covori, std::vector<Eigen::Matrix3d> &est_covpos,
+                                                  std::vector<Eigen::Matrix3d> &gt_covori, std::vector<Eigen::Matrix3d> &gt_covpos) {
+
+  // Temp results which keeps only the matches
+  std::vector<double> est_times_temp, gt_times_temp;
+  std::vector<Eigen::Matrix<double, 7, 1>> est_poses_temp, gt_poses_temp;
+  std::vector<Eigen::Matrix3d> est_covori_temp, est_covpos_temp, gt_covori_temp, gt_covpos_temp;
+
+  // Interpolate the groundtruth to each estimate timestamp
+  for (size_t i = 0; i < est_times.size(); i++) {
+
+    // Binary search for the first groundtruth sample after this estimate
+    double timestamp = est_times.at(i) + offset;
+    auto it = std::upper_bound(gt_times.begin(), gt_times.end(), timestamp);
+
+    // Skip if we are outside the groundtruth time span (an exact hit on the last sample is still valid)
+    if (it == gt_times.begin() || (it == gt_times.end() && timestamp > gt_times.back()))
+      continue;
+    size_t idx1 = (it == gt_times.end()) ? gt_times.size() - 1 : (size_t)(it - gt_times.begin());
+    size_t idx0 = idx1 - 1;
+
+    // Skip if the two bracketing samples span a hole in the groundtruth recording
+    double t0 = gt_times.at(idx0);
+    double t1 = gt_times.at(idx1);
+    if (t1 - t0 > max_gap || t1 <= t0)
+      continue;
+    double lambda = (timestamp - t0) / (t1 - t0);
+
+    // Interpolate on the SE(3) manifold (linear position, exponential map orientation)
+    Eigen::Matrix<double, 7, 1> pose_gt;
+    pose_gt.block(0, 0, 3, 1) = (1.0 - lambda) * gt_poses.at(idx0).block(0, 0, 3, 1) + lambda * gt_poses.at(idx1).block(0, 0, 3, 1);
+    Eigen::Matrix3d R0 = ov_core::quat_2_Rot(gt_poses.at(idx0).block(3, 0, 4, 1));
+    Eigen::Matrix3d R1 = ov_core::quat_2_Rot(gt_poses.at(idx1).block(3, 0, 4, 1));
+    Eigen::Matrix3d R_interp = R0 * ov_core::exp_so3(lambda * ov_core::log_so3(R0.transpose() * R1));
+    pose_gt.block(3, 0, 4, 1) = ov_core::rot_2_quat(R_interp);
+
+    // Save estimate and the interpolated gt state for the match
+    est_times_temp.push_back(timestamp);
+    est_poses_temp.push_back(est_poses.at(i));
+    gt_times_temp.push_back(timestamp);
+    gt_poses_temp.push_back(pose_gt);
+
+    // If we have covariance then also append it (gt covariance from the nearest sample)
+    // If the groundtruth doesn't have covariance say it is 100% certain
+    if (!est_covori.empty()) {
+      assert(est_covori.size() == est_covpos.size());
+      est_covori_temp.push_back(est_covori.at(i));
+      est_covpos_temp.push_back(est_covpos.at(i));
+      size_t idx_near = (lambda < 0.5) ? idx0 : idx1;
+      if (gt_covori.empty()) {
+        gt_covori_temp.push_back(Eigen::Matrix3d::Zero());
+        gt_covpos_temp.push_back(Eigen::Matrix3d::Zero());
+      } else {
+        assert(gt_covori.size() == gt_covpos.size());
+        gt_covori_temp.push_back(gt_covori.at(idx_near));
+        gt_covpos_temp.push_back(gt_covpos.at(idx_near));
+      }
+    }
+  }
+
+  // Ensure that we have enough associations
+  if (est_times_temp.size() < 3) {
+    PRINT_ERROR(RED "[ALIGN]: Was unable to associate groundtruth and estimate trajectories\n" RESET);
+    PRINT_ERROR(RED "[ALIGN]: %d total matches....\n" RESET, (int)est_times_temp.size());
+    PRINT_ERROR(RED "[ALIGN]: Do the time of the files match??\n" RESET);
+    return;
+  }
+  assert(est_times_temp.size() == gt_times_temp.size());
+
+  // Overwrite with intersected values
+  est_times = est_times_temp;
+  est_poses = est_poses_temp;
+  est_covori = est_covori_temp;
+  est_covpos = est_covpos_temp;
+  gt_times = gt_times_temp;
+  gt_poses = gt_poses_temp;
+  gt_covori = gt_covori_temp;
+  gt_covpos = gt_covpos_temp;
+}
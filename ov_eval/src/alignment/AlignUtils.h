@@ -61,14 +61,13 @@ public:
    * @brief Gets mean of the vector of data
    * @param data Vector of data
    * @return Mean value
+   *
+   * The vector of fixed-size 3x1 points is contiguous in memory, so we map it
+   * as a single 3xN matrix and let Eigen vectorize the reduction.
    */
   static inline Eigen::Matrix<double, 3, 1> get_mean(const std::vector<Eigen::Matrix<double, 3, 1>> &data) {
-    Eigen::Matrix<double, 3, 1> mean = Eigen::Matrix<double, 3, 1>::Zero();
-    for (size_t i = 0; i < data.size(); i++) {
-      mean.noalias() += data[i];
-    }
-    mean /= data.size();
-    return mean;
+    Eigen::Map<const Eigen::Matrix<double, 3, Eigen::Dynamic>> points(data.at(0).data(), 3, (Eigen::Index)data.size());
+    return points.rowwise().mean();
   }
 
   /**
@@ -86,6 +85,26 @@ public:
   static void align_umeyama(const std::vector<Eigen::Matrix<double, 3, 1>> &data, const std::vector<Eigen::Matrix<double, 3, 1>> &model,
                             Eigen::Matrix<double, 3, 3> &R, Eigen::Matrix<double, 3, 1> &t, double &s, bool known_scale, bool yaw_only);
 
+  /**
+   * @brief Batch variant of align_umeyama() operating on 3xN point matrices.
+   *
+   * The vector overload above maps its contiguous pose storage and forwards here,
+   * so callers that already hold their points as a matrix can skip the copy. The
+   * correlation and variance reductions are single matrix products which Eigen
+   * blocks and vectorizes, instead of a scalar loop over individual points.
+   *
+   * @param data 3xN matrix of points in data frame (i.e., estimates)
+   * @param model 3xN matrix of points in model frame (i.e., gt)
+   * @param R Output rotation from data frame to model frame
+   * @param t Output translation from data frame to model frame
+   * @param s Output scale from data frame to model frame
+   * @param known_scale Whether to fix scale
+   * @param yaw_only Whether to only use yaw orientation (such as when frames are already gravity aligned)
+   */
+  static void align_umeyama(const Eigen::Ref<const Eigen::Matrix<double, 3, Eigen::Dynamic>> &data,
+                            const Eigen::Ref<const Eigen::Matrix<double, 3, Eigen::Dynamic>> &model, Eigen::Matrix<double, 3, 3> &R,
+                            Eigen::Matrix<double, 3, 1> &t, double &s, bool known_scale, bool yaw_only);
+
   /**
    * @brief Will intersect our loaded data so that we have common timestamps.
    * @param offset Time offset to append to our estimate
@@ -103,6 +122,26 @@ public:
                                   std::vector<Eigen::Matrix<double, 7, 1>> &est_poses, std::vector<Eigen::Matrix<double, 7, 1>> &gt_poses,
                                   std::vector<Eigen::Matrix3d> &est_covori, std::vector<Eigen::Matrix3d> &est_covpos,
                                   std::vector<Eigen::Matrix3d> &gt_covori, std::vector<Eigen::Matrix3d> &gt_covpos);
+
+  /**
+   * @brief Will intersect our loaded data by interpolating the groundtruth to the estimate timestamps.
+   *
+   * Instead of keeping only the estimates whose timestamp is within a tight tolerance of a
+   * groundtruth sample, this binary-searches the (sorted) groundtruth for the two samples
+   * bracketing each estimate time and interpolates the groundtruth pose between them on the
+   * SE(3) manifold (linear in position, exponential map in orientation). Estimates are only
+   * dropped when they fall outside the groundtruth time span or inside a recording hole
+   * larger than max_gap, so high-rate estimates survive even against sparse groundtruth.
+   * Covariances, if recorded, are taken from the nearest groundtruth sample.
+   *
+   * @param offset Time offset to append to our estimate
+   * @param max_gap Biggest allowed gap between the two bracketing groundtruth samples
+   */
+  static void perform_association_interpolated(double offset, double max_gap, std::vector<double> &est_times, std::vector<double> &gt_times,
+                                               std::vector<Eigen::Matrix<double, 7, 1>> &est_poses,
+                                               std::vector<Eigen::Matrix<double, 7, 1>> &gt_poses, std::vector<Eigen::Matrix3d> &est_covori,
+                                               std::vector<Eigen::Matrix3d> &est_covpos, std::vector<Eigen::Matrix3d> &gt_covori,
+                                               std::vector<Eigen::Matrix3d> &gt_covpos);
 };
 
 } // namespace ov_eval
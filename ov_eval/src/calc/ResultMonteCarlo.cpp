@@ -0,0 +1,245 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2018-2023 Patrick Geneva
+ * Copyright (C) 2018-2023 Guoquan Huang
+ * Copyright (C) 2018-2023 OpenVINS Contributors
+ * Copyright (C) 2018-2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "ResultMonteCarlo.h"
+
+#include <boost/filesystem.hpp>
+
+#include "utils/thread_pool.h"
+
+using namespace ov_eval;
+
+ResultMonteCarlo::ResultMonteCarlo(std::string path_runs) {
+
+  // List the run folders of this study (each should hold the three recorded state files)
+  std::vector<boost::filesystem::path> paths;
+  for (const auto &entry : boost::filesystem::directory_iterator(path_runs)) {
+    if (boost::filesystem::is_directory(entry) && boost::filesystem::exists(entry.path() / "state_estimate.txt")) {
+      paths.push_back(entry.path());
+    }
+  }
+  std::sort(paths.begin(), paths.end());
+  if (paths.empty()) {
+    PRINT_ERROR(RED "[SIM]: No run folders with a state_estimate.txt inside found...\n" RESET);
+    PRINT_ERROR(RED "[SIM]: %s\n" RESET, path_runs.c_str());
+    std::exit(EXIT_FAILURE);
+  }
+  for (const auto &p : paths) {
+    run_names.push_back(p.filename().string());
+  }
+
+  // Load every run in parallel into the column-oriented store
+  est_runs.resize(paths.size());
+  std_runs.resize(paths.size());
+  gt_runs.resize(paths.size());
+  ov_core::ThreadPool::instance().parallel_for(0, (int)paths.size(), [&](int r) {
+    // Load from disk
+    std::vector<Eigen::VectorXd> est_state, gt_state, state_cov;
+    Loader::load_simulation((paths.at(r) / "state_estimate.txt").string(), est_state);
+    Loader::load_simulation((paths.at(r) / "state_deviation.txt").string(), state_cov);
+    Loader::load_simulation((paths.at(r) / "state_groundtruth.txt").string(), gt_state);
+
+    /// Assert they are of equal length
+    assert(est_state.size() == state_cov.size());
+    assert(est_state.size() == gt_state.size());
+
+    // Convert the rows into a single matrix (one column per state component)
+    auto to_matrix = [](const std::vector<Eigen::VectorXd> &rows) {
+      Eigen::MatrixXd mat(rows.size(), rows.empty() ? 0 : rows.at(0).rows());
+      for (int i = 0; i < (int)rows.size(); i++) {
+        mat.row(i) = rows.at(i).transpose();
+      }
+      return mat;
+    };
+    est_runs.at(r) = to_matrix(est_state);
+    std_runs.at(r) = to_matrix(state_cov);
+    gt_runs.at(r) = to_matrix(gt_state);
+  });
+
+  // Truncate all runs to the common number of timesteps (a diverged run may have been cut short)
+  int num_times = (int)est_runs.at(0).rows();
+  for (const auto &mat : est_runs) {
+    num_times = std::min(num_times, (int)mat.rows());
+  }
+  for (size_t r = 0; r < est_runs.size(); r++) {
+    if ((int)est_runs.at(r).rows() != num_times) {
+      PRINT_WARNING(YELLOW "[SIM]: run %s has %d timestamps, truncating all runs to %d...\n" RESET, run_names.at(r).c_str(),
+                    (int)est_runs.at(r).rows(), num_times);
+    }
+    est_runs.at(r).conservativeResize(num_times, Eigen::NoChange);
+    std_runs.at(r).conservativeResize(num_times, Eigen::NoChange);
+    gt_runs.at(r).conservativeResize(num_times, Eigen::NoChange);
+    // All runs need to share the simulation clock for the per-timestep averages to make sense
+    if ((est_runs.at(r).col(0) - est_runs.at(0).col(0)).cwiseAbs().maxCoeff() > 1e-6) {
+      PRINT_ERROR(RED "[SIM]: run %s does not share the timeline of run %s...\n" RESET, run_names.at(r).c_str(), run_names.at(0).c_str());
+      std::exit(EXIT_FAILURE);
+    }
+  }
+  timestamps = est_runs.at(0).col(0);
+
+  // Debug print
+  PRINT_DEBUG("[SIM]: loaded %d runs with %d timestamps each!!\n", (int)est_runs.size(), num_times);
+  PRINT_DEBUG("[SIM]: we have %d cameras in total!!\n", (int)est_runs.at(0)(0, 18));
+}
+
+void ResultMonteCarlo::plot_consistency(bool doplotting, double max_time) {
+
+  // Number of timesteps inside the requested plotting window
+  int num_runs = (int)est_runs.size();
+  int num_times = 0;
+  while (num_times < (int)timestamps.rows() && (timestamps(num_times) - timestamps(0)) <= max_time) {
+    num_times++;
+  }
+
+  // Per-run squared and normalized errors (filled in parallel, reduced in a fixed order afterwards)
+  std::vector<Eigen::MatrixXd> err_sq_ori(num_runs), err_sq_pos(num_runs), err_sq_vel(num_runs);
+  std::vector<Eigen::VectorXd> nees_ori(num_runs), nees_pos(num_runs);
+  ov_core::ThreadPool::instance().parallel_for(0, num_runs, [&](int r) {
+    const Eigen::MatrixXd &est = est_runs.at(r);
+    const Eigen::MatrixXd &gt = gt_runs.at(r);
+    const Eigen::MatrixXd &cov = std_runs.at(r);
+
+    // Orientation error needs the quaternion log at every timestep (radians)
+    // NOTE: we define our error as e_R = -Log(R*Rhat^T)
+    Eigen::MatrixXd err_ori(num_times, 3);
+    for (int i = 0; i < num_times; i++) {
+      Eigen::Matrix3d e_R =
+          ov_core::quat_2_Rot(gt.block(i, 1, 1, 4).transpose()) * ov_core::quat_2_Rot(est.block(i, 1, 1, 4).transpose()).transpose();
+      err_ori.row(i) = -ov_core::log_so3(e_R).transpose();
+    }
+
+    // Position and velocity errors are whole-column subtractions
+    err_sq_ori.at(r) = err_ori.array().square();
+    err_sq_pos.at(r) = (gt.block(0, 5, num_times, 3) - est.block(0, 5, num_times, 3)).array().square();
+    err_sq_vel.at(r) = (gt.block(0, 8, num_times, 3) - est.block(0, 8, num_times, 3)).array().square();
+
+    // Normalized errors against the recorded marginal deviations (see class note)
+    Eigen::ArrayXXd var_ori = cov.block(0, 1, num_times, 3).array().square().max(1e-20);
+    Eigen::ArrayXXd var_pos = cov.block(0, 4, num_times, 3).array().square().max(1e-20);
+    nees_ori.at(r) = (err_sq_ori.at(r).array() / var_ori).rowwise().sum();
+    nees_pos.at(r) = (err_sq_pos.at(r).array() / var_pos).rowwise().sum();
+  });
+
+  // Average over the runs, along with the covariance trace the filter itself reported
+  Eigen::MatrixXd avg_sq_ori = Eigen::MatrixXd::Zero(num_times, 3);
+  Eigen::MatrixXd avg_sq_pos = Eigen::MatrixXd::Zero(num_times, 3);
+  Eigen::MatrixXd avg_sq_vel = Eigen::MatrixXd::Zero(num_times, 3);
+  Eigen::VectorXd avg_nees_ori = Eigen::VectorXd::Zero(num_times);
+  Eigen::VectorXd avg_nees_pos = Eigen::VectorXd::Zero(num_times);
+  Eigen::VectorXd avg_var_ori = Eigen::VectorXd::Zero(num_times);
+  Eigen::VectorXd avg_var_pos = Eigen::VectorXd::Zero(num_times);
+  Eigen::VectorXd avg_var_vel = Eigen::VectorXd::Zero(num_times);
+  for (int r = 0; r < num_runs; r++) {
+    avg_sq_ori += err_sq_ori.at(r);
+    avg_sq_pos += err_sq_pos.at(r);
+    avg_sq_vel += err_sq_vel.at(r);
+    avg_nees_ori += nees_ori.at(r);
+    avg_nees_pos += nees_pos.at(r);
+    avg_var_ori += std_runs.at(r).block(0, 1, num_times, 3).array().square().rowwise().sum().matrix();
+    avg_var_pos += std_runs.at(r).block(0, 4, num_times, 3).array().square().rowwise().sum().matrix();
+    avg_var_vel += std_runs.at(r).block(0, 7, num_times, 3).array().square().rowwise().sum().matrix();
+  }
+  avg_nees_ori /= num_runs;
+  avg_nees_pos /= num_runs;
+
+  // Root mean squared error over the runs (total over the three axes), and
+  // what the filter *predicts* that error to be (root of the average covariance trace)
+  Eigen::VectorXd rmse_ori = 180.0 / M_PI * (avg_sq_ori.rowwise().sum() / num_runs).array().sqrt();
+  Eigen::VectorXd rmse_pos = (avg_sq_pos.rowwise().sum() / num_runs).array().sqrt();
+  Eigen::VectorXd rmse_vel = (avg_sq_vel.rowwise().sum() / num_runs).array().sqrt();
+  Eigen::VectorXd pred_ori = 180.0 / M_PI * (avg_var_ori / num_runs).array().sqrt();
+  Eigen::VectorXd pred_pos = (avg_var_pos / num_runs).array().sqrt();
+  Eigen::VectorXd pred_vel = (avg_var_vel / num_runs).array().sqrt();
+
+  // Print our summary statistics
+  PRINT_INFO("======================================\n");
+  PRINT_INFO("Monte-Carlo Consistency (%d runs)\n", num_runs);
+  PRINT_INFO("======================================\n");
+  PRINT_INFO("nees_ori = %.3f | nees_pos = %.3f (3.000 is consistent)\n", avg_nees_ori.mean(), avg_nees_pos.mean());
+  PRINT_INFO("rmse_ori = %.4f deg | predicted = %.4f deg\n", rmse_ori.mean(), pred_ori.mean());
+  PRINT_INFO("rmse_pos = %.4f m | predicted = %.4f m\n", rmse_pos.mean(), pred_pos.mean());
+  PRINT_INFO("rmse_vel = %.4f m/s | predicted = %.4f m/s\n", rmse_vel.mean(), pred_vel.mean());
+
+  // return if we don't want to plot
+  if (!doplotting)
+    return;
+
+#ifndef HAVE_PYTHONLIBS
+  PRINT_ERROR(RED "Matplotlib not loaded, so will not plot, just returning..\n" RESET);
+  return;
+#else
+
+  // Zero our time array and convert the reductions for plotting
+  std::vector<double> times(num_times);
+  for (int i = 0; i < num_times; i++) {
+    times.at(i) = timestamps(i) - timestamps(0);
+  }
+  auto to_vector = [](const Eigen::VectorXd &vec) { return std::vector<double>(vec.data(), vec.data() + vec.rows()); };
+
+  // Parameters that define the line styles
+  std::map<std::string, std::string> params_value, params_bound;
+  params_value.insert({"label", "average over runs"});
+  params_value.insert({"linestyle", "-"});
+  params_value.insert({"color", "blue"});
+  params_bound.insert({"label", "filter predicted"});
+  params_bound.insert({"linestyle", "--"});
+  params_bound.insert({"color", "red"});
+
+  //=====================================================
+  // Plot this figure (average NEES and its consistent value)
+  matplotlibcpp::figure_size(1000, 500);
+  matplotlibcpp::subplot(2, 1, 1);
+  matplotlibcpp::title("Average NEES over " + std::to_string(num_runs) + " runs");
+  matplotlibcpp::plot(times, to_vector(avg_nees_ori), params_value);
+  matplotlibcpp::plot(times, std::vector<double>(num_times, 3.0), "r--");
+  matplotlibcpp::ylabel("NEES Orientation");
+  matplotlibcpp::subplot(2, 1, 2);
+  matplotlibcpp::plot(times, to_vector(avg_nees_pos), params_value);
+  matplotlibcpp::plot(times, std::vector<double>(num_times, 3.0), "r--");
+  matplotlibcpp::ylabel("NEES Position");
+  matplotlibcpp::xlabel("dataset time (s)");
+  matplotlibcpp::tight_layout();
+  matplotlibcpp::show(false);
+  //=====================================================
+
+  //=====================================================
+  // Plot this figure (RMSE against what the reported covariance predicts)
+  matplotlibcpp::figure_size(1000, 600);
+  matplotlibcpp::subplot(3, 1, 1);
+  matplotlibcpp::title("Average RMSE over " + std::to_string(num_runs) + " runs");
+  matplotlibcpp::plot(times, to_vector(rmse_ori), params_value);
+  matplotlibcpp::plot(times, to_vector(pred_ori), params_bound);
+  matplotlibcpp::ylabel("orientation (deg)");
+  matplotlibcpp::subplot(3, 1, 2);
+  matplotlibcpp::plot(times, to_vector(rmse_pos), params_value);
+  matplotlibcpp::plot(times, to_vector(pred_pos), params_bound);
+  matplotlibcpp::ylabel("position (m)");
+  matplotlibcpp::subplot(3, 1, 3);
+  matplotlibcpp::plot(times, to_vector(rmse_vel), params_value);
+  matplotlibcpp::plot(times, to_vector(pred_vel), params_bound);
+  matplotlibcpp::ylabel("velocity (m/s)");
+  matplotlibcpp::xlabel("dataset time (s)");
+  matplotlibcpp::tight_layout();
+  matplotlibcpp::show(false);
+  //=====================================================
+
+#endif
+}
@@ -0,0 +1,99 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2018-2023 Patrick Geneva
+ * Copyright (C) 2018-2023 Guoquan Huang
+ * Copyright (C) 2018-2023 OpenVINS Contributors
+ * Copyright (C) 2018-2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OV_EVAL_MONTECARLO_H
+#define OV_EVAL_MONTECARLO_H
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <Eigen/Eigen>
+
+#include "utils/Loader.h"
+#include "utils/Statistics.h"
+
+#include "utils/colors.h"
+#include "utils/print.h"
+#include "utils/quat_ops.h"
+
+#ifdef HAVE_PYTHONLIBS
+
+// import the c++ wrapper for matplot lib
+// https://github.com/lava/matplotlib-cpp
+// sudo apt-get install python-matplotlib python-numpy python2.7-dev
+#include "plot/matplotlibcpp.h"
+
+#endif
+
+namespace ov_eval {
+
+/**
+ * @brief A set of simulation runs of the same trajectory (Monte-Carlo consistency study).
+ *
+ * While ov_eval::ResultSimulation handles a single run, this loads *every* run of a study at once:
+ * each run is a sub-folder containing the three files written by the ov_msckf::RosVisualizer
+ * (state_estimate.txt, state_deviation.txt, state_groundtruth.txt). All runs are parsed in parallel
+ * on the ov_core::ThreadPool and stored column-oriented (one timestep per matrix row, so each state
+ * component is a contiguous column). The averaged NEES and RMSE statistics are then single
+ * vectorized column reductions over the runs, instead of re-parsing and re-walking the state
+ * vectors once per plotted quantity.
+ *
+ * Note that the deviation files only record the marginal sigma of each state element, thus the
+ * normalized errors here are computed against the diagonal of the covariance. This matches the
+ * three sigma bounds that ResultSimulation::plot_state displays for a single run.
+ */
+class ResultMonteCarlo {
+
+public:
+  /**
+   * @brief Default constructor that will load all runs of a study from disk
+   * @param path_runs Folder with one sub-folder per run, each holding the three recorded state files
+   */
+  ResultMonteCarlo(std::string path_runs);
+
+  /**
+   * @brief Will compute and plot the run-averaged NEES and RMSE of the IMU state
+   *
+   * This is a single pass over the loaded runs: each run contributes its squared errors and
+   * normalized errors as whole-column array operations, and the averages over runs are reduced in a
+   * fixed order so the reported statistics do not depend on the worker count.
+   *
+   * @param doplotting True if you want to display the plots
+   * @param max_time Max number of second we want to plot
+   */
+  void plot_consistency(bool doplotting, double max_time = INFINITY);
+
+protected:
+  /// Name of each run (folder name, sorted)
+  std::vector<std::string> run_names;
+
+  /// Timeline shared by all runs (seconds)
+  Eigen::VectorXd timestamps;
+
+  /// One timesteps-by-state matrix per run (each state component is a contiguous column)
+  std::vector<Eigen::MatrixXd> est_runs, gt_runs, std_runs;
+};
+
+} // namespace ov_eval
+
+#endif // OV_EVAL_MONTECARLO_H
@@ -21,9 +21,11 @@
 
 #include "ResultTrajectory.h"
 
+#include "utils/thread_pool.h"
+
 using namespace ov_eval;
 
-ResultTrajectory::ResultTrajectory(std::string path_est, std::string path_gt, std::string alignment_method) {
+ResultTrajectory::ResultTrajectory(std::string path_est, std::string path_gt, std::string alignment_method, bool interpolate_gt) {
 
   // Load from file
   Loader::load_data(path_est, est_times, est_poses, est_covori, est_covpos);
@@ -43,7 +45,14 @@ ResultTrajectory::ResultTrajectory(std::string path_est, std::string path_gt, st
   }
 
   // Intersect timestamps
-  AlignUtils::perform_association(0, 0.02, est_times, gt_times, est_poses, gt_poses, est_covori, est_covpos, gt_covori, gt_covpos);
+  // Either keep estimates near a groundtruth sample, or interpolate the groundtruth to every
+  // estimate timestamp (the gap bound skips holes in the groundtruth recording)
+  if (interpolate_gt) {
+    AlignUtils::perform_association_interpolated(0, 0.10, est_times, gt_times, est_poses, gt_poses, est_covori, est_covpos, gt_covori,
+                                                 gt_covpos);
+  } else {
+    AlignUtils::perform_association(0, 0.02, est_times, gt_times, est_poses, gt_poses, est_covori, est_covpos, gt_covori, gt_covpos);
+  }
 
   // Return failure if we didn't have any common timestamps
   if (est_poses.size() < 3) {
@@ -161,11 +170,31 @@ void ResultTrajectory::calculate_rpe(const std::vector<double> &segment_lengths,
                   "[COMP]: the recommendation is to use a higher frequency groundtruth, or relax this trajectory segment logic...\n" RESET);
   }
 
-  // Loop through each segment length
-  for (const double &distance : segment_lengths) {
+  // Precompute the absolute 4x4 pose of every state once, shared by all segment
+  // lengths: each window's relative transform is then two array lookups instead of
+  // rebuilding the rotations from their quaternions for every window of every length
+  std::vector<Eigen::Matrix4d, Eigen::aligned_allocator<Eigen::Matrix4d>> T_est(gt_poses.size());
+  std::vector<Eigen::Matrix4d, Eigen::aligned_allocator<Eigen::Matrix4d>> T_gt(gt_poses.size());
+  ov_core::ThreadPool::instance().parallel_for(0, (int)gt_poses.size(), [&](int i) {
+    Eigen::Matrix4d T_c = Eigen::Matrix4d::Identity();
+    T_c.block(0, 0, 3, 3) = ov_core::quat_2_Rot(est_poses_aignedtoGT.at(i).block(3, 0, 4, 1)).transpose();
+    T_c.block(0, 3, 3, 1) = est_poses_aignedtoGT.at(i).block(0, 0, 3, 1);
+    T_est.at(i) = T_c;
+    Eigen::Matrix4d T_m = Eigen::Matrix4d::Identity();
+    T_m.block(0, 0, 3, 3) = ov_core::quat_2_Rot(gt_poses.at(i).block(3, 0, 4, 1)).transpose();
+    T_m.block(0, 3, 3, 1) = gt_poses.at(i).block(0, 0, 3, 1);
+    T_gt.at(i) = T_m;
+  });
+
+  // Process each segment length in parallel (each one is an independent sweep
+  // over the trajectory), then merge the results in their requested order
+  std::vector<std::pair<Statistics, Statistics>> length_errors(segment_lengths.size());
+  ov_core::ThreadPool::instance().parallel_for(0, (int)segment_lengths.size(), [&](int l) {
+    const double distance = segment_lengths.at(l);
 
     // Our stats for this length
-    Statistics error_ori, error_pos;
+    Statistics &error_ori = length_errors.at(l).first;
+    Statistics &error_pos = length_errors.at(l).second;
 
     // Get end of subtrajectories for each possible starting point
     // NOTE: is there a better way to select which end pos is a valid segments that are of the correct lenght?
@@ -174,70 +203,66 @@ void ResultTrajectory::calculate_rpe(const std::vector<double> &segment_lengths,
     std::vector<int> comparisons = compute_comparison_indices_length(accum_distances, distance, max_dist_diff);
     assert(comparisons.size() == gt_poses.size());
 
-    // Loop through each relative comparison
-    for (size_t id_start = 0; id_start < comparisons.size(); id_start++) {
-
-      // Get the end id (skip if we couldn't find an end)
-      int id_end = comparisons[id_start];
-      if (id_end == -1)
-        continue;
-
-      //===============================================================================
-      // Get T I1 to world EST at beginning of subtrajectory (at state idx)
-      Eigen::Matrix4d T_c1 = Eigen::Matrix4d::Identity();
-      T_c1.block(0, 0, 3, 3) = ov_core::quat_2_Rot(est_poses_aignedtoGT.at(id_start).block(3, 0, 4, 1)).transpose();
-      T_c1.block(0, 3, 3, 1) = est_poses_aignedtoGT.at(id_start).block(0, 0, 3, 1);
-
-      // Get T I2 to world EST at end of subtrajectory starting (at state comparisons[idx])
-      Eigen::Matrix4d T_c2 = Eigen::Matrix4d::Identity();
-      T_c2.block(0, 0, 3, 3) = ov_core::quat_2_Rot(est_poses_aignedtoGT.at(id_end).block(3, 0, 4, 1)).transpose();
-      T_c2.block(0, 3, 3, 1) = est_poses_aignedtoGT.at(id_end).block(0, 0, 3, 1);
-
-      // Get T I2 to I1 EST
-      Eigen::Matrix4d T_c1_c2 = ov_core::Inv_se3(T_c1) * T_c2;
-
-      //===============================================================================
-      // Get T I1 to world GT at beginning of subtrajectory (at state idx)
-      Eigen::Matrix4d T_m1 = Eigen::Matrix4d::Identity();
-      T_m1.block(0, 0, 3, 3) = ov_core::quat_2_Rot(gt_poses.at(id_start).block(3, 0, 4, 1)).transpose();
-      T_m1.block(0, 3, 3, 1) = gt_poses.at(id_start).block(0, 0, 3, 1);
-
-      // Get T I2 to world GT at end of subtrajectory starting (at state comparisons[idx])
-      Eigen::Matrix4d T_m2 = Eigen::Matrix4d::Identity();
-      T_m2.block(0, 0, 3, 3) = ov_core::quat_2_Rot(gt_poses.at(id_end).block(3, 0, 4, 1)).transpose();
-      T_m2.block(0, 3, 3, 1) = gt_poses.at(id_end).block(0, 0, 3, 1);
-
-      // Get T I2 to I1 GT
-      Eigen::Matrix4d T_m1_m2 = ov_core::Inv_se3(T_m1) * T_m2;
-
-      //===============================================================================
-      // Compute error transform between EST and GT start-end transform
-      Eigen::Matrix4d T_error_in_c2 = ov_core::Inv_se3(T_m1_m2) * T_c1_c2;
-
-      Eigen::Matrix4d T_c2_rot = Eigen::Matrix4d::Identity();
-      T_c2_rot.block(0, 0, 3, 3) = T_c2.block(0, 0, 3, 3);
-
-      Eigen::Matrix4d T_c2_rot_inv = Eigen::Matrix4d::Identity();
-      T_c2_rot_inv.block(0, 0, 3, 3) = T_c2.block(0, 0, 3, 3).transpose();
-
-      // Rotate rotation so that rotation error is in the global frame (allows us to look at yaw error)
-      Eigen::Matrix4d T_error_in_w = T_c2_rot * T_error_in_c2 * T_c2_rot_inv;
-
-      //===============================================================================
-      // Compute error for position
-      error_pos.timestamps.push_back(est_times.at(id_start));
-      error_pos.values.push_back(T_error_in_w.block(0, 3, 3, 1).norm());
-
-      // Calculate orientation error
-      double ori_err = 180.0 / M_PI * ov_core::log_so3(T_error_in_w.block(0, 0, 3, 3)).norm();
-      error_ori.timestamps.push_back(est_times.at(id_start));
-      error_ori.values.push_back(ori_err);
+    // Sweep the window start poses in fixed-size chunks in parallel (the pool is safe
+    // to nest inside the segment-length parallel_for). Each chunk accumulates into its
+    // own statistics and the chunks are merged back in index order, so the resulting
+    // series is identical to a serial sweep no matter how the chunks interleave.
+    const int chunk_size = 8192;
+    int num_chunks = ((int)comparisons.size() + chunk_size - 1) / chunk_size;
+    std::vector<std::pair<Statistics, Statistics>> chunk_errors(num_chunks);
+    ov_core::ThreadPool::instance().parallel_for(0, num_chunks, [&](int chunk) {
+      Statistics &chunk_ori = chunk_errors.at(chunk).first;
+      Statistics &chunk_pos = chunk_errors.at(chunk).second;
+      size_t id_max = std::min(comparisons.size(), (size_t)(chunk + 1) * chunk_size);
+      for (size_t id_start = (size_t)chunk * chunk_size; id_start < id_max; id_start++) {
+
+        // Get the end id (skip if we couldn't find an end)
+        int id_end = comparisons[id_start];
+        if (id_end == -1)
+          continue;
+
+        //===============================================================================
+        // Get T I2 to I1 EST and GT (two lookups each into the precomputed poses)
+        Eigen::Matrix4d T_c1_c2 = ov_core::Inv_se3(T_est.at(id_start)) * T_est.at(id_end);
+        Eigen::Matrix4d T_m1_m2 = ov_core::Inv_se3(T_gt.at(id_start)) * T_gt.at(id_end);
+
+        //===============================================================================
+        // Compute error transform between EST and GT start-end transform
+        Eigen::Matrix4d T_error_in_c2 = ov_core::Inv_se3(T_m1_m2) * T_c1_c2;
+
+        Eigen::Matrix4d T_c2_rot = Eigen::Matrix4d::Identity();
+        T_c2_rot.block(0, 0, 3, 3) = T_est.at(id_end).block(0, 0, 3, 3);
+
+        Eigen::Matrix4d T_c2_rot_inv = Eigen::Matrix4d::Identity();
+        T_c2_rot_inv.block(0, 0, 3, 3) = T_est.at(id_end).block(0, 0, 3, 3).transpose();
+
+        // Rotate rotation so that rotation error is in the global frame (allows us to look at yaw error)
+        Eigen::Matrix4d T_error_in_w = T_c2_rot * T_error_in_c2 * T_c2_rot_inv;
+
+        //===============================================================================
+        // Compute error for position
+        chunk_pos.timestamps.push_back(est_times.at(id_start));
+        chunk_pos.values.push_back(T_error_in_w.block(0, 3, 3, 1).norm());
+
+        // Calculate orientation error
+        double ori_err = 180.0 / M_PI * ov_core::log_so3(T_error_in_w.block(0, 0, 3, 3)).norm();
+        chunk_ori.timestamps.push_back(est_times.at(id_start));
+        chunk_ori.values.push_back(ori_err);
+      }
+    });
+
+    // Merge the chunks in index order and update the stat information
+    for (auto &chunk : chunk_errors) {
+      error_ori.timestamps.insert(error_ori.timestamps.end(), chunk.first.timestamps.begin(), chunk.first.timestamps.end());
+      error_ori.values.insert(error_ori.values.end(), chunk.first.values.begin(), chunk.first.values.end());
+      error_pos.timestamps.insert(error_pos.timestamps.end(), chunk.second.timestamps.begin(), chunk.second.timestamps.end());
+      error_pos.values.insert(error_pos.values.end(), chunk.second.values.begin(), chunk.second.values.end());
     }
-
-    // Update stat information
     error_ori.calculate();
     error_pos.calculate();
-    error_rpe.insert({distance, {error_ori, error_pos}});
+  });
+  for (size_t l = 0; l < segment_lengths.size(); l++) {
+    error_rpe.insert({segment_lengths.at(l), length_errors.at(l)});
   }
 }
 
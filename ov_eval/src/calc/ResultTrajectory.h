@@ -22,6 +22,7 @@
 #ifndef OV_EVAL_TRAJECTORY_H
 #define OV_EVAL_TRAJECTORY_H
 
+#include <algorithm>
 #include <fstream>
 #include <map>
 #include <random>
@@ -61,11 +62,19 @@ class ResultTrajectory {
 public:
   /**
    * @brief Default constructor that will load, intersect, and align our trajectories.
+   *
+   * By default the two trajectories are intersected by keeping only the estimate poses whose
+   * timestamp is within a tight tolerance of a groundtruth sample. If interpolate_gt is set
+   * the groundtruth is instead interpolated on the SE(3) manifold to every estimate timestamp
+   * (see AlignUtils::perform_association_interpolated), which keeps nearly every estimate
+   * pose even when the groundtruth rate is low or the clocks are not sample-aligned.
+   *
    * @param path_est Path to the estimate text file
    * @param path_gt Path to the groundtruth text file
    * @param alignment_method The alignment method to use [sim3, se3, posyaw, none]
+   * @param interpolate_gt If true, interpolate the groundtruth to the estimate timestamps
    */
-  ResultTrajectory(std::string path_est, std::string path_gt, std::string alignment_method);
+  ResultTrajectory(std::string path_est, std::string path_gt, std::string alignment_method, bool interpolate_gt = false);
 
   /**
    * @brief Computes the Absolute Trajectory Error (ATE) for this trajectory.
@@ -172,19 +181,29 @@ protected:
     std::vector<int> comparisons;
 
     // Loop through each pose in our trajectory (i.e. our distance vector generated from the trajectory).
+    // The accumulated distances are monotonically non-decreasing, so the pose closest to the
+    // desired trajectory distance is binary searched instead of scanning the remainder of the
+    // trajectory for every start (the old quadratic walk dominated RPE on long runs).
     for (size_t idx = 0; idx < distances.size(); idx++) {
 
-      // Loop through and find the pose that minimized the difference between
-      // The desired trajectory distance and our current trajectory distance
-      double distance_startpose = distances.at(idx);
+      // Candidates are the first pose at or beyond the target distance and the last one
+      // before it (a segment cannot end before it starts, so the search begins at idx).
+      // Repeated distances (zero motion) are walked back to their first index with another
+      // binary search, matching what a forward scan with a strict improvement test selects.
+      double target = distances.at(idx) + distance;
+      auto it_above = std::lower_bound(distances.begin() + idx, distances.end(), target);
       int best_idx = -1;
       double best_error = max_dist_diff;
-      for (size_t i = idx; i < distances.size(); i++) {
-        if (std::abs(distances.at(i) - (distance_startpose + distance)) < best_error) {
-          best_idx = i;
-          best_error = std::abs(distances.at(i) - (distance_startpose + distance));
+      if (it_above != distances.begin() + idx) {
+        auto it_below = std::lower_bound(distances.begin() + idx, it_above, *(it_above - 1));
+        if (std::abs(*it_below - target) < best_error) {
+          best_idx = (int)(it_below - distances.begin());
+          best_error = std::abs(*it_below - target);
         }
       }
+      if (it_above != distances.end() && std::abs(*it_above - target) < best_error) {
+        best_idx = (int)(it_above - distances.begin());
+      }
 
       // If we have an end id that reached this trajectory distance then add it!
       // Else this isn't a valid segment, thus we shouldn't add it (we will try again at the next pose)
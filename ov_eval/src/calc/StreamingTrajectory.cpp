@@ -0,0 +1,445 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2018-2023 Patrick Geneva
+ * Copyright (C) 2018-2023 Guoquan Huang
+ * Copyright (C) 2018-2023 OpenVINS Contributors
+ * Copyright (C) 2018-2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "StreamingTrajectory.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "alignment/AlignUtils.h"
+#include "utils/BinaryTrajectory.h"
+#include "utils/Loader.h"
+
+using namespace ov_eval;
+
+StreamingTrajectory::StreamingTrajectory(std::string path_est, std::string alignment_method, const std::vector<double> &gt_times,
+                                         const std::vector<Eigen::Matrix<double, 7, 1>> &gt_poses,
+                                         const std::vector<Eigen::Matrix3d> &gt_covori, const std::vector<Eigen::Matrix3d> &gt_covpos)
+    : path_est(path_est), gt_times(gt_times), gt_poses(gt_poses), gt_covori(gt_covori), gt_covpos(gt_covpos) {
+
+  // Moments accumulated over the matched pose positions
+  // These are the sufficient statistics of the Umeyama alignment problem
+  size_t n = 0;
+  Eigen::Vector3d sum_est = Eigen::Vector3d::Zero();
+  Eigen::Vector3d sum_gt = Eigen::Vector3d::Zero();
+  Eigen::Matrix3d sum_gt_est = Eigen::Matrix3d::Zero();
+  double sumsq_est = 0.0, sumsq_gt = 0.0;
+
+  // First matched pair (needed by the *single alignment methods)
+  Eigen::Matrix<double, 7, 1> first_est = Eigen::Matrix<double, 7, 1>::Zero();
+  Eigen::Matrix<double, 7, 1> first_gt = Eigen::Matrix<double, 7, 1>::Zero();
+
+  // PASS ONE: stream the run and accumulate the alignment moments
+  stream_matches([&](size_t gt_idx, const Eigen::Matrix<double, 7, 1> &pose, bool has_cov, const Eigen::Matrix3d &c_ori,
+                     const Eigen::Matrix3d &c_pos) {
+    (void)has_cov;
+    (void)c_ori;
+    (void)c_pos;
+    Eigen::Vector3d p_est = pose.block(0, 0, 3, 1);
+    Eigen::Vector3d p_gt = gt_poses.at(gt_idx).block(0, 0, 3, 1);
+    if (n == 0) {
+      first_est = pose;
+      first_gt = gt_poses.at(gt_idx);
+    }
+    sum_est += p_est;
+    sum_gt += p_gt;
+    sum_gt_est.noalias() += p_gt * p_est.transpose();
+    sumsq_est += p_est.squaredNorm();
+    sumsq_gt += p_gt.squaredNorm();
+    n++;
+  });
+  num_matches = n;
+
+  // A run with mixed covariance rows is a malformed recording
+  if (lines_with_cov != 0 && lines_with_cov != lines_total) {
+    PRINT_ERROR(RED "[TRAJ]: Parsing error, timestamps covariance size do not match!!\n" RESET);
+    PRINT_ERROR(RED "[TRAJ]: %s\n" RESET, path_est.c_str());
+    std::exit(EXIT_FAILURE);
+  }
+  est_has_cov = (lines_total > 0 && lines_with_cov == lines_total);
+
+  // Warn if the lengths are different (with the raw length accumulated while streaming)
+  double len_gt = Loader::get_total_length(gt_poses);
+  double ratio = length_est / len_gt;
+  if (ratio > 1.1 || ratio < 0.9) {
+    PRINT_WARNING(YELLOW "[TRAJ]: Trajectory is a bad ratio of %.2f length (est %.2f, gt %.2f)\n", ratio, length_est, len_gt);
+    PRINT_WARNING(YELLOW "[TRAJ]: %s\n", path_est.c_str());
+  }
+
+  // Return failure if we didn't have any common timestamps
+  if (num_matches < 3) {
+    PRINT_ERROR(RED "[TRAJ]: unable to get enough common timestamps between trajectories.\n" RESET);
+    PRINT_ERROR(RED "[TRAJ]: does the estimated trajectory publish the rosbag timestamps??\n" RESET);
+    std::exit(EXIT_FAILURE);
+  }
+
+  // Central moments of the matched positions (est = data frame, gt = model frame)
+  Eigen::Vector3d mu_est = sum_est / (double)n;
+  Eigen::Vector3d mu_gt = sum_gt / (double)n;
+  Eigen::Matrix3d C_gt_est = sum_gt_est / (double)n - mu_gt * mu_est.transpose();
+  double sigma2_est = sumsq_est / (double)n - mu_est.squaredNorm();
+  double sigma2_gt = sumsq_gt / (double)n - mu_gt.squaredNorm();
+
+  // Perform alignment of the trajectories (both directions, as ResultTrajectory does)
+  if (alignment_method == "posyaw") {
+    align_umeyama_moments(mu_est, mu_gt, C_gt_est, sigma2_est, true, true, R_ESTtoGT, t_ESTinGT, s_ESTtoGT);
+    align_umeyama_moments(mu_gt, mu_est, C_gt_est.transpose(), sigma2_gt, true, true, R_GTtoEST, t_GTinEST, s_GTtoEST);
+  } else if (alignment_method == "posyawsingle" || alignment_method == "se3single") {
+    // Single-pose alignments only need the first matched pair
+    Eigen::Matrix3d rot_gt = ov_core::quat_2_Rot(first_gt.block(3, 0, 4, 1)).transpose();
+    Eigen::Matrix3d rot_est = ov_core::quat_2_Rot(first_est.block(3, 0, 4, 1)).transpose();
+    if (alignment_method == "posyawsingle") {
+      R_ESTtoGT = ov_core::rot_z(AlignUtils::get_best_yaw(rot_est * rot_gt.transpose()));
+      R_GTtoEST = ov_core::rot_z(AlignUtils::get_best_yaw(rot_gt * rot_est.transpose()));
+    } else {
+      R_ESTtoGT = rot_gt * rot_est.transpose();
+      R_GTtoEST = rot_est * rot_gt.transpose();
+    }
+    s_ESTtoGT = s_GTtoEST = 1;
+    t_ESTinGT.noalias() = first_gt.block(0, 0, 3, 1) - R_ESTtoGT * first_est.block(0, 0, 3, 1);
+    t_GTinEST.noalias() = first_est.block(0, 0, 3, 1) - R_GTtoEST * first_gt.block(0, 0, 3, 1);
+  } else if (alignment_method == "se3") {
+    align_umeyama_moments(mu_est, mu_gt, C_gt_est, sigma2_est, true, false, R_ESTtoGT, t_ESTinGT, s_ESTtoGT);
+    align_umeyama_moments(mu_gt, mu_est, C_gt_est.transpose(), sigma2_gt, true, false, R_GTtoEST, t_GTinEST, s_GTtoEST);
+  } else if (alignment_method == "sim3") {
+    align_umeyama_moments(mu_est, mu_gt, C_gt_est, sigma2_est, false, false, R_ESTtoGT, t_ESTinGT, s_ESTtoGT);
+    align_umeyama_moments(mu_gt, mu_est, C_gt_est.transpose(), sigma2_gt, false, false, R_GTtoEST, t_GTinEST, s_GTtoEST);
+  } else if (alignment_method == "none") {
+    R_ESTtoGT.setIdentity();
+    R_GTtoEST.setIdentity();
+    t_ESTinGT.setZero();
+    t_GTinEST.setZero();
+    s_ESTtoGT = s_GTtoEST = 1;
+  } else {
+    PRINT_ERROR(RED "[ALIGN]: Invalid alignment method!\n" RESET);
+    PRINT_ERROR(RED "[ALIGN]: Possible options: posyaw, posyawsingle, se3, se3single, sim3, none\n" RESET);
+    std::exit(EXIT_FAILURE);
+  }
+
+  // Debug print to the user
+  q_ESTtoGT = ov_core::rot_2_quat(R_ESTtoGT);
+  q_GTtoEST = ov_core::rot_2_quat(R_GTtoEST);
+  PRINT_DEBUG("[TRAJ]: q_ESTtoGT = %.3f, %.3f, %.3f, %.3f | p_ESTinGT = %.3f, %.3f, %.3f | s = %.2f\n", q_ESTtoGT(0), q_ESTtoGT(1),
+              q_ESTtoGT(2), q_ESTtoGT(3), t_ESTinGT(0), t_ESTinGT(1), t_ESTinGT(2), s_ESTtoGT);
+}
+
+void StreamingTrajectory::calculate_errors(
+    const std::vector<double> &segment_lengths,
+    const std::function<void(size_t, double, double, double, double, double, bool, double, double)> &func_error,
+    const std::function<void(double, double, double, double)> &func_rpe) {
+
+  // NEES needs every estimate line to have a covariance recorded
+  bool has_nees = est_has_cov;
+  bool warned_nees = false;
+
+  // Sliding window of aligned poses used by the RPE sweeps
+  // Entries are only needed until every segment length has consumed them as a start, so
+  // the window never spans more than the largest segment length (plus the tolerance)
+  double max_dist_diff = 0.5;
+  std::deque<WindowPose> window;
+  size_t window_base = 0;                                        // global match index of window.front()
+  std::vector<size_t> next_start(segment_lengths.size(), 0);     // next unfinalized start per segment length
+  double cum_dist = 0.0, sum_dist = 0.0;                         // accumulated gt distance over the matched poses
+  size_t total = 0;
+
+  // Finalizes one RPE start index against the current window (same math as
+  // ResultTrajectory::calculate_rpe with the end chosen inside the window)
+  auto finalize_start = [&](size_t l, size_t id_start) {
+    const WindowPose &start = window.at(id_start - window_base);
+    double target = start.distance + segment_lengths.at(l);
+
+    // Find the end pose which best matches the desired segment length
+    double best_error = max_dist_diff;
+    int id_end = -1;
+    for (size_t i = id_start - window_base; i < window.size(); i++) {
+      if (std::abs(window.at(i).distance - target) < best_error) {
+        best_error = std::abs(window.at(i).distance - target);
+        id_end = (int)i;
+      }
+    }
+    if (id_end == -1)
+      return;
+    const WindowPose &end = window.at(id_end);
+
+    // Get T I1 to world EST at beginning of subtrajectory
+    Eigen::Matrix4d T_c1 = Eigen::Matrix4d::Identity();
+    T_c1.block(0, 0, 3, 3) = ov_core::quat_2_Rot(start.est_pose_alignedtoGT.block(3, 0, 4, 1)).transpose();
+    T_c1.block(0, 3, 3, 1) = start.est_pose_alignedtoGT.block(0, 0, 3, 1);
+
+    // Get T I2 to world EST at end of subtrajectory
+    Eigen::Matrix4d T_c2 = Eigen::Matrix4d::Identity();
+    T_c2.block(0, 0, 3, 3) = ov_core::quat_2_Rot(end.est_pose_alignedtoGT.block(3, 0, 4, 1)).transpose();
+    T_c2.block(0, 3, 3, 1) = end.est_pose_alignedtoGT.block(0, 0, 3, 1);
+
+    // Get T I2 to I1 EST
+    Eigen::Matrix4d T_c1_c2 = ov_core::Inv_se3(T_c1) * T_c2;
+
+    // Get T I1 to world GT at beginning of subtrajectory
+    Eigen::Matrix4d T_m1 = Eigen::Matrix4d::Identity();
+    T_m1.block(0, 0, 3, 3) = ov_core::quat_2_Rot(start.gt_pose.block(3, 0, 4, 1)).transpose();
+    T_m1.block(0, 3, 3, 1) = start.gt_pose.block(0, 0, 3, 1);
+
+    // Get T I2 to world GT at end of subtrajectory
+    Eigen::Matrix4d T_m2 = Eigen::Matrix4d::Identity();
+    T_m2.block(0, 0, 3, 3) = ov_core::quat_2_Rot(end.gt_pose.block(3, 0, 4, 1)).transpose();
+    T_m2.block(0, 3, 3, 1) = end.gt_pose.block(0, 0, 3, 1);
+
+    // Get T I2 to I1 GT
+    Eigen::Matrix4d T_m1_m2 = ov_core::Inv_se3(T_m1) * T_m2;
+
+    // Compute error transform between EST and GT start-end transform
+    Eigen::Matrix4d T_error_in_c2 = ov_core::Inv_se3(T_m1_m2) * T_c1_c2;
+
+    // Rotate rotation so that rotation error is in the global frame (allows us to look at yaw error)
+    Eigen::Matrix4d T_c2_rot = Eigen::Matrix4d::Identity();
+    T_c2_rot.block(0, 0, 3, 3) = T_c2.block(0, 0, 3, 3);
+    Eigen::Matrix4d T_c2_rot_inv = Eigen::Matrix4d::Identity();
+    T_c2_rot_inv.block(0, 0, 3, 3) = T_c2.block(0, 0, 3, 3).transpose();
+    Eigen::Matrix4d T_error_in_w = T_c2_rot * T_error_in_c2 * T_c2_rot_inv;
+
+    // Compute the position and orientation error
+    double ori_err = 180.0 / M_PI * ov_core::log_so3(T_error_in_w.block(0, 0, 3, 3)).norm();
+    func_rpe(segment_lengths.at(l), start.timestamp, ori_err, T_error_in_w.block(0, 3, 3, 1).norm());
+  };
+
+  // PASS TWO: stream the run again, align each matched pose and report its errors
+  stream_matches([&](size_t gt_idx, const Eigen::Matrix<double, 7, 1> &pose, bool has_cov, const Eigen::Matrix3d &c_ori,
+                     const Eigen::Matrix3d &c_pos) {
+    (void)has_cov;
+    double timestamp = gt_times.at(gt_idx);
+    const Eigen::Matrix<double, 7, 1> &gt_pose = gt_poses.at(gt_idx);
+
+    // Align the estimate into the groundtruth frame
+    Eigen::Matrix<double, 7, 1> pose_ESTinGT;
+    pose_ESTinGT.block(0, 0, 3, 1) = s_ESTtoGT * R_ESTtoGT * pose.block(0, 0, 3, 1) + t_ESTinGT;
+    pose_ESTinGT.block(3, 0, 4, 1) = ov_core::quat_multiply(pose.block(3, 0, 4, 1), ov_core::Inv(q_ESTtoGT));
+
+    // Calculate the ATE orientation and position error at this timestep
+    Eigen::Matrix3d e_R =
+        ov_core::quat_2_Rot(pose_ESTinGT.block(3, 0, 4, 1)).transpose() * ov_core::quat_2_Rot(gt_pose.block(3, 0, 4, 1));
+    Eigen::Vector3d e_log = ov_core::log_so3(e_R);
+    double ori_err = 180.0 / M_PI * e_log.norm();
+    double pos_err = (gt_pose.block(0, 0, 3, 1) - pose_ESTinGT.block(0, 0, 3, 1)).norm();
+
+    // And the same error in the 2d x-y plane (yaw and xy error)
+    double ori_2d_err = 180.0 / M_PI * e_log(2);
+    double pos_2d_err = (gt_pose.block(0, 0, 2, 1) - pose_ESTinGT.block(0, 0, 2, 1)).norm();
+
+    // NEES normalizes the error in the estimate frame with the estimate covariance
+    // NOTE: we define our error as e_R = -Log(R*Rhat^T)
+    bool pose_has_nees = has_nees;
+    double ori_nees = 0.0, pos_nees = 0.0;
+    if (has_nees) {
+      Eigen::Matrix<double, 7, 1> pose_GTinEST;
+      pose_GTinEST.block(0, 0, 3, 1) = s_GTtoEST * R_GTtoEST * gt_pose.block(0, 0, 3, 1) + t_GTinEST;
+      pose_GTinEST.block(3, 0, 4, 1) = ov_core::quat_multiply(gt_pose.block(3, 0, 4, 1), ov_core::Inv(q_GTtoEST));
+      Eigen::Matrix3d e_R_nees =
+          ov_core::quat_2_Rot(pose_GTinEST.block(3, 0, 4, 1)) * ov_core::quat_2_Rot(pose.block(3, 0, 4, 1)).transpose();
+      Eigen::Vector3d errori = -ov_core::log_so3(e_R_nees);
+      ori_nees = errori.transpose() * c_ori.inverse() * errori;
+      Eigen::Vector3d errpos = pose_GTinEST.block(0, 0, 3, 1) - pose.block(0, 0, 3, 1);
+      pos_nees = errpos.transpose() * c_pos.inverse() * errpos;
+      if (std::isnan(ori_nees) || std::isnan(pos_nees)) {
+        if (!warned_nees) {
+          PRINT_WARNING(YELLOW "[TRAJ]: nees calculation had nan number (covariance is wrong?) skipping...\n" RESET);
+          warned_nees = true;
+        }
+        pose_has_nees = false;
+      }
+    }
+
+    // Hand this pose's errors to the caller
+    func_error(gt_idx, timestamp, ori_err, pos_err, ori_2d_err, pos_2d_err, pose_has_nees, ori_nees, pos_nees);
+
+    // Append to the RPE window with the accumulated groundtruth distance
+    if (!window.empty()) {
+      double pos_diff = (gt_pose.block(0, 0, 3, 1) - window.back().gt_pose.block(0, 0, 3, 1)).norm();
+      cum_dist += pos_diff;
+      sum_dist += pos_diff;
+    }
+    window.push_back({timestamp, gt_pose, pose_ESTinGT, cum_dist});
+    total++;
+
+    // Finalize every start whose candidate ends can no longer improve (the distances are
+    // monotonic, so once we streamed past the target distance plus tolerance we are done)
+    for (size_t l = 0; l < segment_lengths.size(); l++) {
+      while (next_start.at(l) < window_base + window.size() &&
+             cum_dist > window.at(next_start.at(l) - window_base).distance + segment_lengths.at(l) + max_dist_diff) {
+        finalize_start(l, next_start.at(l));
+        next_start.at(l)++;
+      }
+    }
+
+    // Drop window entries that every segment length has moved past
+    size_t min_start = *std::min_element(next_start.begin(), next_start.end());
+    while (window_base < min_start) {
+      window.pop_front();
+      window_base++;
+    }
+  });
+
+  // Finalize the remaining starts against what is left of the trajectory
+  for (size_t l = 0; l < segment_lengths.size(); l++) {
+    for (size_t id_start = next_start.at(l); id_start < window_base + window.size(); id_start++) {
+      finalize_start(l, id_start);
+    }
+  }
+
+  // Warn if large pos difference
+  double average_pos_difference = (total > 0) ? sum_dist / (double)total : 0.0;
+  if (average_pos_difference > max_dist_diff) {
+    PRINT_WARNING(YELLOW "[COMP]: average groundtruth position difference %.2f > %.2f is too large\n" RESET, average_pos_difference,
+                  max_dist_diff);
+    PRINT_WARNING(YELLOW "[COMP]: this will prevent the RPE from finding valid trajectory segments!!!\n" RESET);
+    PRINT_WARNING(YELLOW
+                  "[COMP]: the recommendation is to use a higher frequency groundtruth, or relax this trajectory segment logic...\n" RESET);
+  }
+}
+
+void StreamingTrajectory::stream_matches(
+    const std::function<void(size_t, const Eigen::Matrix<double, 7, 1> &, bool, const Eigen::Matrix3d &, const Eigen::Matrix3d &)> &func) {
+
+  // Reset the per-stream statistics
+  lines_total = 0;
+  lines_with_cov = 0;
+  length_est = 0.0;
+
+  // Association state (offset 0 and max difference as in ResultTrajectory)
+  // The groundtruth pointer only ever increases to enforce injectivity of matches
+  double max_difference = 0.02;
+  size_t gt_pointer = 0;
+  bool has_prev = false;
+  Eigen::Vector3d prev_pos = Eigen::Vector3d::Zero();
+
+  // Processes one estimate line: raw statistics, then closest-groundtruth association
+  auto process = [&](double timestamp, const Eigen::Matrix<double, 7, 1> &pose, bool has_cov, const Eigen::Matrix3d &c_ori,
+                     const Eigen::Matrix3d &c_pos) {
+    lines_total++;
+    if (has_cov)
+      lines_with_cov++;
+    if (has_prev)
+      length_est += (pose.block(0, 0, 3, 1) - prev_pos).norm();
+    prev_pos = pose.block(0, 0, 3, 1);
+    has_prev = true;
+
+    // Increment while too small and is not within our difference threshold
+    while (gt_pointer < gt_times.size() && gt_times.at(gt_pointer) < timestamp &&
+           std::abs(gt_times.at(gt_pointer) - timestamp) > max_difference) {
+      gt_pointer++;
+    }
+
+    // If we are closer than max difference, see if we can do any better
+    double best_diff = max_difference;
+    int best_gt_idx = -1;
+    while (gt_pointer < gt_times.size() && std::abs(gt_times.at(gt_pointer) - timestamp) <= max_difference) {
+      // Break if we found a good match but are getting worse, we are done
+      if (std::abs(gt_times.at(gt_pointer) - timestamp) >= best_diff) {
+        break;
+      }
+      // We have a closer match, save it and move on
+      best_diff = std::abs(gt_times.at(gt_pointer) - timestamp);
+      best_gt_idx = gt_pointer;
+      gt_pointer++;
+    }
+
+    // Report if we got a valid match
+    if (best_gt_idx != -1) {
+      func((size_t)best_gt_idx, pose, has_cov, c_ori, c_pos);
+    }
+  };
+
+  // Our binary trajectory files have no streaming reader, so fall back to loading this
+  // single run into memory and replaying it (still only one run resident at a time)
+  if (BinaryTrajectory::is_binary(path_est)) {
+    std::vector<double> times;
+    std::vector<Eigen::Matrix<double, 7, 1>> poses;
+    std::vector<Eigen::Matrix3d> covori, covpos;
+    if (!BinaryTrajectory::read(path_est, times, poses, covori, covpos)) {
+      PRINT_ERROR(RED "[LOAD]: Could not parse any data from the file!!\n" RESET);
+      PRINT_ERROR(RED "[LOAD]: %s\n" RESET, path_est.c_str());
+      std::exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < times.size(); i++) {
+      bool has_cov = !covori.empty();
+      process(times.at(i), poses.at(i), has_cov, has_cov ? covori.at(i) : Eigen::Matrix3d::Zero(),
+              has_cov ? covpos.at(i) : Eigen::Matrix3d::Zero());
+    }
+    return;
+  }
+
+  // Stream each line of this file from a memory mapping of it
+  // Line format is (timestamp(s) tx ty tz qx qy qz qw Pr11 Pr12 Pr13 Pr22 Pr23 Pr33 Pt11 Pt12 Pt13 Pt22 Pt23 Pt33)
+  bool opened = Loader::stream_values(path_est, ' ', [&](const Eigen::Matrix<double, 20, 1> &data, int i) {
+    // Only a valid line if we have all the parameters
+    if (i >= 20) {
+      Eigen::Matrix3d c_ori, c_pos;
+      c_ori << data(8), data(9), data(10), data(9), data(11), data(12), data(10), data(12), data(13);
+      c_pos << data(14), data(15), data(16), data(15), data(17), data(18), data(16), data(18), data(19);
+      c_ori = 0.5 * (c_ori + c_ori.transpose());
+      c_pos = 0.5 * (c_pos + c_pos.transpose());
+      process(data(0), data.block(1, 0, 7, 1), true, c_ori, c_pos);
+    } else if (i >= 8) {
+      process(data(0), data.block(1, 0, 7, 1), false, Eigen::Matrix3d::Zero(), Eigen::Matrix3d::Zero());
+    }
+  });
+
+  // Error if we could not open the file
+  if (!opened) {
+    PRINT_ERROR(RED "[LOAD]: Unable to open trajectory file...\n" RESET);
+    PRINT_ERROR(RED "[LOAD]: %s\n" RESET, path_est.c_str());
+    std::exit(EXIT_FAILURE);
+  }
+}
+
+void StreamingTrajectory::align_umeyama_moments(const Eigen::Vector3d &mu_D, const Eigen::Vector3d &mu_M, const Eigen::Matrix3d &C,
+                                                double sigma2, bool known_scale, bool yaw_only, Eigen::Matrix3d &R, Eigen::Vector3d &t,
+                                                double &s) {
+
+  // SVD decomposition of the correlation matrix
+  Eigen::JacobiSVD<Eigen::Matrix<double, 3, 3>> svd(C, Eigen::ComputeFullV | Eigen::ComputeFullU);
+  Eigen::Matrix<double, 3, 3> U_svd = svd.matrixU();
+  Eigen::Matrix<double, 3, 1> D_svd = svd.singularValues();
+  Eigen::Matrix<double, 3, 3> V_svd = svd.matrixV();
+  Eigen::Matrix<double, 3, 3> S = Eigen::Matrix<double, 3, 3>::Identity();
+  if (U_svd.determinant() * V_svd.determinant() < 0) {
+    S(2, 2) = -1;
+  }
+
+  // If only yaw, use that specific solver (optimizes over yaw angle)
+  // Else get best full 3 dof rotation
+  if (yaw_only) {
+    double theta = AlignUtils::get_best_yaw(C.transpose());
+    R = ov_core::rot_z(theta);
+  } else {
+    R.noalias() = U_svd * S * V_svd.transpose();
+  }
+
+  // If known scale, fix it
+  if (known_scale) {
+    s = 1;
+  } else {
+    // Get best scale
+    s = 1.0 / sigma2 * (D_svd.asDiagonal() * S).trace();
+  }
+
+  // Get best translation
+  t.noalias() = mu_M - s * R * mu_D;
+}
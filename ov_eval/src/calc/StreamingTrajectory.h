@@ -0,0 +1,160 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2018-2023 Patrick Geneva
+ * Copyright (C) 2018-2023 Guoquan Huang
+ * Copyright (C) 2018-2023 OpenVINS Contributors
+ * Copyright (C) 2018-2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OV_EVAL_STREAMINGTRAJECTORY_H
+#define OV_EVAL_STREAMINGTRAJECTORY_H
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <Eigen/Eigen>
+
+#include "utils/Statistics.h"
+
+#include "utils/colors.h"
+#include "utils/print.h"
+#include "utils/quat_ops.h"
+
+namespace ov_eval {
+
+/**
+ * @brief A single run for a given dataset, evaluated in two streaming passes.
+ *
+ * This computes the same errors as ResultTrajectory but never materializes the estimated
+ * trajectory, so peak memory is bounded by the (shared) groundtruth plus a small sliding
+ * window regardless of how long the run is or how many runs are evaluated. The first pass
+ * streams the run once to associate it against the groundtruth and accumulate the moments
+ * (means, correlation, variance) that the Umeyama alignment needs, from which the alignment
+ * transform is recovered in closed form. The second pass streams the run again, applies the
+ * transform to each matched pose, and hands the per-pose errors to the caller through a
+ * callback together with the groundtruth index so the caller can maintain its own fixed-size
+ * accumulators. Relative pose errors are computed inside the second pass with a sliding
+ * window of aligned poses that only spans the largest requested segment length.
+ *
+ * The groundtruth is borrowed by const reference and must outlive this object. Binary
+ * trajectory files have no streaming reader, so they fall back to loading that single run
+ * into memory (still one run at a time).
+ */
+class StreamingTrajectory {
+
+public:
+  /**
+   * @brief First pass: streams the run to associate and align it against the groundtruth.
+   * @param path_est Path to the estimate text file
+   * @param alignment_method The alignment method to use [sim3, se3, posyaw, none]
+   * @param gt_times Timesteps in seconds of the groundtruth
+   * @param gt_poses Groundtruth pose at every timestep [pos,quat]
+   * @param gt_covori Groundtruth orientation covariances (empty if not recorded)
+   * @param gt_covpos Groundtruth position covariances (empty if not recorded)
+   */
+  StreamingTrajectory(std::string path_est, std::string alignment_method, const std::vector<double> &gt_times,
+                      const std::vector<Eigen::Matrix<double, 7, 1>> &gt_poses, const std::vector<Eigen::Matrix3d> &gt_covori,
+                      const std::vector<Eigen::Matrix3d> &gt_covpos);
+
+  /**
+   * @brief Second pass: streams the run again and reports the error at every matched pose.
+   *
+   * The per-pose errors match ResultTrajectory::calculate_ate(), calculate_ate_2d() and
+   * calculate_nees(), and the relative pose errors match calculate_rpe(). NEES values are
+   * only reported if both the run and the groundtruth recorded covariances (has_nees).
+   *
+   * @param segment_lengths What segment lengths we want to calculate RPE for
+   * @param func_error Callback invoked per matched pose with
+   *        (gt_index, timestamp, ori_err, pos_err, ori_2d_err, pos_2d_err, has_nees, nees_ori, nees_pos)
+   * @param func_rpe Callback invoked per relative pose error sample with
+   *        (segment_length, timestamp, ori_err, pos_err)
+   */
+  void calculate_errors(const std::vector<double> &segment_lengths,
+                        const std::function<void(size_t, double, double, double, double, double, bool, double, double)> &func_error,
+                        const std::function<void(double, double, double, double)> &func_rpe);
+
+protected:
+  /**
+   * @brief Streams the estimate file and reports each pose matched against the groundtruth.
+   *
+   * This replicates AlignUtils::perform_association() (offset 0, max difference 0.02) but
+   * with a monotonic groundtruth pointer advanced as the estimate streams by, so nothing
+   * besides the current line is materialized. Estimate timestamps must be sorted.
+   *
+   * @param func Callback invoked per match with (gt_index, est_pose, has_cov, cov_ori, cov_pos)
+   */
+  void stream_matches(
+      const std::function<void(size_t, const Eigen::Matrix<double, 7, 1> &, bool, const Eigen::Matrix3d &, const Eigen::Matrix3d &)> &func);
+
+  /**
+   * @brief Recovers the Umeyama alignment from streamed moments.
+   *
+   * Closed form of AlignUtils::align_umeyama() in terms of the accumulated sufficient
+   * statistics: the two means, the correlation matrix C = E[(model-mu_M)(data-mu_D)^T]
+   * and the data variance sigma2 = E[|data-mu_D|^2].
+   *
+   * @param mu_D Mean of the points in the data frame (i.e., estimates)
+   * @param mu_M Mean of the points in the model frame (i.e., gt)
+   * @param C Correlation matrix between zero-centered model and data points
+   * @param sigma2 Variance of the zero-centered data points
+   * @param known_scale Whether to fix scale
+   * @param yaw_only Whether to only use yaw orientation
+   * @param R Output rotation from data frame to model frame
+   * @param t Output translation from data frame to model frame
+   * @param s Output scale from data frame to model frame
+   */
+  static void align_umeyama_moments(const Eigen::Vector3d &mu_D, const Eigen::Vector3d &mu_M, const Eigen::Matrix3d &C, double sigma2,
+                                    bool known_scale, bool yaw_only, Eigen::Matrix3d &R, Eigen::Vector3d &t, double &s);
+
+  // Path of the estimate file (streamed once per pass)
+  std::string path_est;
+
+  // Groundtruth trajectory (borrowed, shared across all runs of the dataset)
+  const std::vector<double> &gt_times;
+  const std::vector<Eigen::Matrix<double, 7, 1>> &gt_poses;
+  const std::vector<Eigen::Matrix3d> &gt_covori;
+  const std::vector<Eigen::Matrix3d> &gt_covpos;
+
+  // Number of matched poses and whether every matched estimate line had a covariance
+  size_t num_matches = 0;
+  bool est_has_cov = false;
+
+  // Per-stream statistics maintained by stream_matches (raw line counts and raw length)
+  size_t lines_total = 0;
+  size_t lines_with_cov = 0;
+  double length_est = 0.0;
+
+  // Alignment computed by the first pass (both directions, as in ResultTrajectory)
+  Eigen::Matrix3d R_ESTtoGT, R_GTtoEST;
+  Eigen::Vector4d q_ESTtoGT, q_GTtoEST;
+  Eigen::Vector3d t_ESTinGT, t_GTinEST;
+  double s_ESTtoGT = 1.0, s_GTtoEST = 1.0;
+
+  // Sliding window entry used by the RPE computation in the second pass
+  struct WindowPose {
+    double timestamp;
+    Eigen::Matrix<double, 7, 1> gt_pose;
+    Eigen::Matrix<double, 7, 1> est_pose_alignedtoGT;
+    double distance;
+  };
+};
+
+} // namespace ov_eval
+
+#endif // OV_EVAL_STREAMINGTRAJECTORY_H
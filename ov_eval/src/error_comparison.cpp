@@ -26,9 +26,11 @@
 #include <string>
 
 #include "calc/ResultTrajectory.h"
+#include "utils/BinaryStats.h"
 #include "utils/Loader.h"
 #include "utils/colors.h"
 #include "utils/print.h"
+#include "utils/thread_pool.h"
 
 #ifdef HAVE_PYTHONLIBS
 
@@ -44,14 +46,20 @@ int main(int argc, char **argv) {
   // Verbosity setting
   ov_core::Printer::setPrintLevel("INFO");
 
+  // Worker threads used to process the runs of each dataset in parallel
+  ov_core::ThreadPool::instance().configure((int)std::thread::hardware_concurrency(), {});
+
   // Ensure we have a path
   if (argc < 4) {
     PRINT_ERROR(RED "ERROR: Please specify a align mode, folder, and algorithms\n" RESET);
-    PRINT_ERROR(RED "ERROR: ./error_comparison <align_mode> <folder_groundtruth> <folder_algorithms>\n" RESET);
-    PRINT_ERROR(RED "ERROR: rosrun ov_eval error_comparison <align_mode> <folder_groundtruth> <folder_algorithms>\n" RESET);
+    PRINT_ERROR(RED "ERROR: ./error_comparison <align_mode> <folder_groundtruth> <folder_algorithms> [file_stats.ovs]\n" RESET);
+    PRINT_ERROR(RED "ERROR: rosrun ov_eval error_comparison <align_mode> <folder_groundtruth> <folder_algorithms> [file_stats.ovs]\n" RESET);
     std::exit(EXIT_FAILURE);
   }
 
+  // Optional binary statistics export (re-plot later with plot_statistics)
+  std::string path_stats = ov_eval::BinaryStats::export_path(argc, argv);
+
   // List the groundtruth files in this folder
   std::string path_gts(argv[2]);
   std::vector<boost::filesystem::path> path_groundtruths;
@@ -122,26 +130,75 @@ int main(int argc, char **argv) {
   //===============================================================================
   //===============================================================================
 
-  // Loop through each algorithm type
+  // First collect every single run of every algorithm x dataset pair, so that we
+  // can fan the whole evaluation out across the pool at once (a dataset with few
+  // runs would otherwise leave most cores idle while it is being processed)
+  struct RunJob {
+    size_t algo;
+    size_t dataset;
+    std::string path_esttxt;
+  };
+  std::vector<RunJob> run_jobs;
+  std::vector<std::map<std::string, boost::filesystem::path>> algo_datasets(path_algorithms.size());
   for (size_t i = 0; i < path_algorithms.size(); i++) {
 
-    // Debug print
-    PRINT_DEBUG("======================================\n");
-    PRINT_DEBUG("[COMP]: processing %s algorithm\n", path_algorithms.at(i).filename().c_str());
-
     // Get the list of datasets this algorithm records
-    std::map<std::string, boost::filesystem::path> path_algo_datasets;
     for (auto &entry : boost::filesystem::directory_iterator(path_algorithms.at(i))) {
       if (boost::filesystem::is_directory(entry)) {
-        path_algo_datasets.insert({entry.path().filename().string(), entry.path()});
+        algo_datasets.at(i).insert({entry.path().filename().string(), entry.path()});
       }
     }
 
+    // Append the sorted runs of each dataset we have groundtruth for
+    for (size_t j = 0; j < path_groundtruths.size(); j++) {
+      if (algo_datasets.at(i).find(path_groundtruths.at(j).stem().string()) == algo_datasets.at(i).end())
+        continue;
+      std::vector<std::string> file_paths;
+      for (auto &entry : boost::filesystem::directory_iterator(algo_datasets.at(i).at(path_groundtruths.at(j).stem().string()))) {
+        if (entry.path().extension() != ".txt")
+          continue;
+        file_paths.push_back(entry.path().string());
+      }
+      std::sort(file_paths.begin(), file_paths.end());
+      for (auto &path_esttxt : file_paths) {
+        run_jobs.push_back({i, j, path_esttxt});
+      }
+    }
+  }
+
+  // Process all runs in parallel, each into its own result slot
+  // The merge below is done serially in collection order so results are deterministic
+  struct RunErrors {
+    ov_eval::Statistics ate_ori, ate_pos;
+    ov_eval::Statistics ate_2d_ori, ate_2d_pos;
+    std::map<double, std::pair<ov_eval::Statistics, ov_eval::Statistics>> rpe;
+  };
+  std::vector<RunErrors> run_errors(run_jobs.size());
+  ov_core::ThreadPool::instance().parallel_for(0, (int)run_jobs.size(), [&](int r) {
+    // Create our trajectory object
+    ov_eval::ResultTrajectory traj(run_jobs.at(r).path_esttxt, path_groundtruths.at(run_jobs.at(r).dataset).string(), argv[1]);
+
+    // Calculate ATE and ATE 2D error for this run
+    traj.calculate_ate(run_errors.at(r).ate_ori, run_errors.at(r).ate_pos);
+    traj.calculate_ate_2d(run_errors.at(r).ate_2d_ori, run_errors.at(r).ate_2d_pos);
+
+    // Calculate RPE error for this run
+    traj.calculate_rpe(segments, run_errors.at(r).rpe);
+  });
+
+  // Loop through each algorithm type
+  size_t job_index = 0;
+  for (size_t i = 0; i < path_algorithms.size(); i++) {
+
+    // Debug print
+    PRINT_DEBUG("======================================\n");
+    PRINT_DEBUG("[COMP]: processing %s algorithm\n", path_algorithms.at(i).filename().c_str());
+
     // Loop through our list of groundtruth datasets, and see if we have it
     for (size_t j = 0; j < path_groundtruths.size(); j++) {
 
       // Check if we have runs for this dataset
-      if (path_algo_datasets.find(path_groundtruths.at(j).stem().string()) == path_algo_datasets.end()) {
+      if (algo_datasets.at(i).find(path_groundtruths.at(j).stem().string()) == algo_datasets.at(i).end()) {
         PRINT_ERROR(RED "[COMP]: %s dataset does not have any runs for %s!!!!!\n" RESET, path_algorithms.at(i).filename().c_str(),
                     path_groundtruths.at(j).stem().c_str());
         continue;
@@ -159,40 +216,21 @@ int main(int argc, char **argv) {
         rpe_dataset.insert({len, {ov_eval::Statistics(), ov_eval::Statistics()}});
       }
 
-      // Loop though the different runs for this dataset
-      std::vector<std::string> file_paths;
-      for (auto &entry : boost::filesystem::directory_iterator(path_algo_datasets.at(path_groundtruths.at(j).stem().string()))) {
-        if (entry.path().extension() != ".txt")
-          continue;
-        file_paths.push_back(entry.path().string());
-      }
-      std::sort(file_paths.begin(), file_paths.end());
+      // Now merge the per-run errors of this dataset in their sorted order
+      while (job_index < run_jobs.size() && run_jobs.at(job_index).algo == i && run_jobs.at(job_index).dataset == j) {
+        const RunErrors &run = run_errors.at(job_index);
+        job_index++;
 
-      // Now loop through the sorted vector
-      for (auto &path_esttxt : file_paths) {
-        // Our paths
-        std::string dataset = path_groundtruths.at(j).stem().string();
-        std::string path_gttxt = path_groundtruths.at(j).string();
-
-        // Create our trajectory object
-        ov_eval::ResultTrajectory traj(path_esttxt, path_gttxt, argv[1]);
-
-        // Calculate ATE error for this dataset
-        ov_eval::Statistics error_ori, error_pos;
-        traj.calculate_ate(error_ori, error_pos);
-        ate_dataset_ori.values.push_back(error_ori.rmse);
-        ate_dataset_pos.values.push_back(error_pos.rmse);
-
-        // Calculate ATE 2D error for this dataset
-        ov_eval::Statistics error_ori_2d, error_pos_2d;
-        traj.calculate_ate_2d(error_ori_2d, error_pos_2d);
-        ate_2d_dataset_ori.values.push_back(error_ori_2d.rmse);
-        ate_2d_dataset_pos.values.push_back(error_pos_2d.rmse);
-
-        // Calculate RPE error for this dataset
-        std::map<double, std::pair<ov_eval::Statistics, ov_eval::Statistics>> error_rpe;
-        traj.calculate_rpe(segments, error_rpe);
-        for (const auto &elm : error_rpe) {
+        // Append ATE errors for this dataset
+        ate_dataset_ori.values.push_back(run.ate_ori.rmse);
+        ate_dataset_pos.values.push_back(run.ate_pos.rmse);
+
+        // Append ATE 2D errors for this dataset
+        ate_2d_dataset_ori.values.push_back(run.ate_2d_ori.rmse);
+        ate_2d_dataset_pos.values.push_back(run.ate_2d_pos.rmse);
+
+        // Append RPE errors for this dataset
+        for (const auto &elm : run.rpe) {
           rpe_dataset.at(elm.first).first.values.insert(rpe_dataset.at(elm.first).first.values.end(), elm.second.first.values.begin(),
                                                         elm.second.first.values.end());
           rpe_dataset.at(elm.first).first.timestamps.insert(rpe_dataset.at(elm.first).first.timestamps.end(),
@@ -341,6 +379,19 @@ int main(int argc, char **argv) {
   }
   PRINT_INFO("============================================\n");
 
+  // Write the aggregate RPE samples of each algorithm if the user gave us an output
+  if (!path_stats.empty()) {
+    std::vector<std::pair<std::string, ov_eval::Statistics>> stats_series;
+    for (const auto &algo : algo_rpe) {
+      for (const auto &seg : algo.second) {
+        stats_series.push_back({algo.first + "_rpe_" + std::to_string((int)seg.first) + "m_ori", seg.second.first});
+        stats_series.push_back({algo.first + "_rpe_" + std::to_string((int)seg.first) + "m_pos", seg.second.second});
+      }
+    }
+    ov_eval::BinaryStats::write(path_stats, stats_series);
+    PRINT_INFO("[STAT]: saved %d series to %s\n", (int)stats_series.size(), path_stats.c_str());
+  }
+
 #ifdef HAVE_PYTHONLIBS
 
   // Plot line colors
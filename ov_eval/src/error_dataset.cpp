@@ -22,9 +22,11 @@
 #include <Eigen/Eigen>
 #include <boost/algorithm/string.hpp>
 #include <boost/filesystem.hpp>
+#include <cmath>
 #include <string>
 
-#include "calc/ResultTrajectory.h"
+#include "calc/StreamingTrajectory.h"
+#include "utils/BinaryStats.h"
 #include "utils/Loader.h"
 #include "utils/colors.h"
 #include "utils/print.h"
@@ -38,6 +40,14 @@
 
 #endif
 
+// Running aggregate of relative pose error samples (we only ever report the mean, so
+// the individual samples of the week-long runs are never materialized)
+struct RpeAccum {
+  size_t count = 0;
+  double sum_ori = 0.0;
+  double sum_pos = 0.0;
+};
+
 int main(int argc, char **argv) {
 
   // Verbosity setting
@@ -46,11 +56,15 @@ int main(int argc, char **argv) {
   // Ensure we have a path
   if (argc < 4) {
     PRINT_ERROR(RED "ERROR: Please specify a align mode, folder, and algorithms\n" RESET);
-    PRINT_ERROR(RED "ERROR: ./error_dataset <align_mode> <file_gt.txt> <folder_algorithms>\n" RESET);
-    PRINT_ERROR(RED "ERROR: rosrun ov_eval error_dataset <align_mode> <file_gt.txt> <folder_algorithms>\n" RESET);
+    PRINT_ERROR(RED "ERROR: ./error_dataset <align_mode> <file_gt.txt> <folder_algorithms> [file_stats.ovs]\n" RESET);
+    PRINT_ERROR(RED "ERROR: rosrun ov_eval error_dataset <align_mode> <file_gt.txt> <folder_algorithms> [file_stats.ovs]\n" RESET);
     std::exit(EXIT_FAILURE);
   }
 
+  // Optional binary statistics export (re-plot later with plot_statistics)
+  std::string path_stats = ov_eval::BinaryStats::export_path(argc, argv);
+  std::vector<std::pair<std::string, ov_eval::Statistics>> stats_series;
+
   // Load it!
   boost::filesystem::path path_gt(argv[2]);
   std::vector<double> times;
@@ -93,11 +107,11 @@ int main(int argc, char **argv) {
   // std::vector<double> segments = {40.0, 60.0, 80.0, 100.0, 120.0};
 
   // The overall RPE error calculation for each algorithm type
-  std::map<std::string, std::map<double, std::pair<ov_eval::Statistics, ov_eval::Statistics>>> algo_rpe;
+  std::map<std::string, std::map<double, RpeAccum>> algo_rpe;
   for (const auto &p : path_algorithms) {
-    std::map<double, std::pair<ov_eval::Statistics, ov_eval::Statistics>> temp;
+    std::map<double, RpeAccum> temp;
     for (const auto &len : segments) {
-      temp.insert({len, {ov_eval::Statistics(), ov_eval::Statistics()}});
+      temp.insert({len, RpeAccum()});
     }
     algo_rpe.insert({p.filename().string(), temp});
   }
@@ -131,13 +145,19 @@ int main(int argc, char **argv) {
     // Errors for this specific dataset (i.e. our averages over the total runs)
     ov_eval::Statistics ate_dataset_ori, ate_dataset_pos;
     ov_eval::Statistics ate_2d_dataset_ori, ate_2d_dataset_pos;
-    std::map<double, std::pair<ov_eval::Statistics, ov_eval::Statistics>> rpe_dataset;
+    std::map<double, RpeAccum> rpe_dataset;
     for (const auto &len : segments) {
-      rpe_dataset.insert({len, {ov_eval::Statistics(), ov_eval::Statistics()}});
+      rpe_dataset.insert({len, RpeAccum()});
     }
-    std::map<double, std::pair<ov_eval::Statistics, ov_eval::Statistics>> rmse_dataset;
-    std::map<double, std::pair<ov_eval::Statistics, ov_eval::Statistics>> rmse_2d_dataset;
-    std::map<double, std::pair<ov_eval::Statistics, ov_eval::Statistics>> nees_dataset;
+
+    // Per-groundtruth-index accumulators for the cross-run RMSE and NEES statistics
+    // These are fixed size in the groundtruth length regardless of how many runs we
+    // evaluate, instead of the per-timestamp value vectors we used to accumulate
+    std::vector<int> rmse_count(times.size(), 0);
+    std::vector<double> rmse_ori_sq(times.size(), 0.0), rmse_pos_sq(times.size(), 0.0);
+    std::vector<double> rmse_2d_ori_sq(times.size(), 0.0), rmse_2d_pos_sq(times.size(), 0.0);
+    std::vector<int> nees_count(times.size(), 0);
+    std::vector<double> nees_ori_sum(times.size(), 0.0), nees_pos_sum(times.size(), 0.0);
 
     // Loop though the different runs for this dataset
     std::vector<std::string> file_paths;
@@ -157,54 +177,48 @@ int main(int argc, char **argv) {
     // Loop though the different runs for this dataset
     for (auto &path_esttxt : file_paths) {
 
-      // Create our trajectory object
-      std::string path_gttxt = path_gt.string();
-      ov_eval::ResultTrajectory traj(path_esttxt, path_gttxt, argv[1]);
-
-      // Calculate ATE error for this dataset
-      ov_eval::Statistics error_ori, error_pos;
-      traj.calculate_ate(error_ori, error_pos);
-      ate_dataset_ori.values.push_back(error_ori.rmse);
-      ate_dataset_pos.values.push_back(error_pos.rmse);
-      for (size_t j = 0; j < error_ori.values.size(); j++) {
-        rmse_dataset[error_ori.timestamps.at(j)].first.values.push_back(error_ori.values.at(j));
-        rmse_dataset[error_pos.timestamps.at(j)].second.values.push_back(error_pos.values.at(j));
-        assert(error_ori.timestamps.at(j) == error_pos.timestamps.at(j));
-      }
-
-      // Calculate ATE 2D error for this dataset
-      ov_eval::Statistics error_ori_2d, error_pos_2d;
-      traj.calculate_ate_2d(error_ori_2d, error_pos_2d);
-      ate_2d_dataset_ori.values.push_back(error_ori_2d.rmse);
-      ate_2d_dataset_pos.values.push_back(error_pos_2d.rmse);
-      for (size_t j = 0; j < error_ori_2d.values.size(); j++) {
-        rmse_2d_dataset[error_ori_2d.timestamps.at(j)].first.values.push_back(error_ori_2d.values.at(j));
-        rmse_2d_dataset[error_pos_2d.timestamps.at(j)].second.values.push_back(error_pos_2d.values.at(j));
-        assert(error_ori_2d.timestamps.at(j) == error_pos_2d.timestamps.at(j));
-      }
-
-      // NEES error for this dataset
-      ov_eval::Statistics nees_ori, nees_pos;
-      traj.calculate_nees(nees_ori, nees_pos);
-      for (size_t j = 0; j < nees_ori.values.size(); j++) {
-        nees_dataset[nees_ori.timestamps.at(j)].first.values.push_back(nees_ori.values.at(j));
-        nees_dataset[nees_ori.timestamps.at(j)].second.values.push_back(nees_pos.values.at(j));
-        assert(nees_ori.timestamps.at(j) == nees_pos.timestamps.at(j));
-      }
-
-      // Calculate RPE error for this dataset
-      std::map<double, std::pair<ov_eval::Statistics, ov_eval::Statistics>> error_rpe;
-      traj.calculate_rpe(segments, error_rpe);
-      for (const auto &elm : error_rpe) {
-        rpe_dataset.at(elm.first).first.values.insert(rpe_dataset.at(elm.first).first.values.end(), elm.second.first.values.begin(),
-                                                      elm.second.first.values.end());
-        rpe_dataset.at(elm.first).first.timestamps.insert(rpe_dataset.at(elm.first).first.timestamps.end(),
-                                                          elm.second.first.timestamps.begin(), elm.second.first.timestamps.end());
-        rpe_dataset.at(elm.first).second.values.insert(rpe_dataset.at(elm.first).second.values.end(), elm.second.second.values.begin(),
-                                                       elm.second.second.values.end());
-        rpe_dataset.at(elm.first).second.timestamps.insert(rpe_dataset.at(elm.first).second.timestamps.end(),
-                                                           elm.second.second.timestamps.begin(), elm.second.second.timestamps.end());
-      }
+      // Pass one: stream the run to associate and align it against the groundtruth
+      ov_eval::StreamingTrajectory traj(path_esttxt, argv[1], times, poses, cov_ori, cov_pos);
+
+      // Pass two: stream it again and accumulate every error as it goes by
+      size_t num_poses = 0;
+      double ate_ori_sq = 0.0, ate_pos_sq = 0.0;
+      double ate_2d_ori_sq = 0.0, ate_2d_pos_sq = 0.0;
+      traj.calculate_errors(
+          segments,
+          [&](size_t gt_idx, double timestamp, double ori_err, double pos_err, double ori_2d_err, double pos_2d_err, bool has_nees,
+              double nees_ori, double nees_pos) {
+            (void)timestamp;
+            // ATE error for this run (RMSE over the run computed at the end)
+            num_poses++;
+            ate_ori_sq += ori_err * ori_err;
+            ate_pos_sq += pos_err * pos_err;
+            ate_2d_ori_sq += ori_2d_err * ori_2d_err;
+            ate_2d_pos_sq += pos_2d_err * pos_2d_err;
+            // Cross-run per-timestep accumulators (indexed by groundtruth pose)
+            rmse_count.at(gt_idx)++;
+            rmse_ori_sq.at(gt_idx) += ori_err * ori_err;
+            rmse_pos_sq.at(gt_idx) += pos_err * pos_err;
+            rmse_2d_ori_sq.at(gt_idx) += ori_2d_err * ori_2d_err;
+            rmse_2d_pos_sq.at(gt_idx) += pos_2d_err * pos_2d_err;
+            if (has_nees) {
+              nees_count.at(gt_idx)++;
+              nees_ori_sum.at(gt_idx) += nees_ori;
+              nees_pos_sum.at(gt_idx) += nees_pos;
+            }
+          },
+          [&](double segment_length, double timestamp, double ori_err, double pos_err) {
+            (void)timestamp;
+            rpe_dataset.at(segment_length).count++;
+            rpe_dataset.at(segment_length).sum_ori += ori_err;
+            rpe_dataset.at(segment_length).sum_pos += pos_err;
+          });
+
+      // Record this run's ATE scores
+      ate_dataset_ori.values.push_back(std::sqrt(ate_ori_sq / (double)num_poses));
+      ate_dataset_pos.values.push_back(std::sqrt(ate_pos_sq / (double)num_poses));
+      ate_2d_dataset_ori.values.push_back(std::sqrt(ate_2d_ori_sq / (double)num_poses));
+      ate_2d_dataset_pos.values.push_back(std::sqrt(ate_2d_pos_sq / (double)num_poses));
     }
 
     // Compute our mean ATE score
@@ -222,61 +236,57 @@ int main(int argc, char **argv) {
                 (int)ate_2d_dataset_ori.values.size());
     PRINT_DEBUG("\tATE 2D: std_ori  = %.5f | std_pos  = %.5f\n", ate_2d_dataset_ori.std, ate_2d_dataset_pos.std);
     for (auto &seg : rpe_dataset) {
-      seg.second.first.calculate();
-      seg.second.second.calculate();
-      PRINT_DEBUG("\tRPE: seg %d - mean_ori = %.3f | mean_pos = %.3f (%d samples)\n", (int)seg.first, seg.second.first.mean,
-                  seg.second.second.mean, (int)seg.second.second.values.size());
-      // PRINT_DEBUG("RPE: seg %d - std_ori  = %.3f | std_pos  = %.3f\n",(int)seg.first,seg.second.first.std,seg.second.second.std);
+      double mean_ori = (seg.second.count == 0) ? 0.0 : seg.second.sum_ori / (double)seg.second.count;
+      double mean_pos = (seg.second.count == 0) ? 0.0 : seg.second.sum_pos / (double)seg.second.count;
+      PRINT_DEBUG("\tRPE: seg %d - mean_ori = %.3f | mean_pos = %.3f (%d samples)\n", (int)seg.first, mean_ori, mean_pos,
+                  (int)seg.second.count);
     }
 
     // RMSE: Convert into the right format (only use times where all runs have an error)
     ov_eval::Statistics rmse_ori, rmse_pos;
-    for (auto &elm : rmse_dataset) {
-      if (elm.second.first.values.size() == file_paths.size()) {
-        elm.second.first.calculate();
-        elm.second.second.calculate();
-        rmse_ori.timestamps.push_back(elm.first);
-        rmse_ori.values.push_back(elm.second.first.rmse);
-        rmse_pos.timestamps.push_back(elm.first);
-        rmse_pos.values.push_back(elm.second.second.rmse);
-      }
+    ov_eval::Statistics rmse_2d_ori, rmse_2d_pos;
+    for (size_t j = 0; j < times.size(); j++) {
+      if (rmse_count.at(j) != (int)file_paths.size())
+        continue;
+      rmse_ori.timestamps.push_back(times.at(j));
+      rmse_ori.values.push_back(std::sqrt(rmse_ori_sq.at(j) / (double)rmse_count.at(j)));
+      rmse_pos.timestamps.push_back(times.at(j));
+      rmse_pos.values.push_back(std::sqrt(rmse_pos_sq.at(j) / (double)rmse_count.at(j)));
+      rmse_2d_ori.timestamps.push_back(times.at(j));
+      rmse_2d_ori.values.push_back(std::sqrt(rmse_2d_ori_sq.at(j) / (double)rmse_count.at(j)));
+      rmse_2d_pos.timestamps.push_back(times.at(j));
+      rmse_2d_pos.values.push_back(std::sqrt(rmse_2d_pos_sq.at(j) / (double)rmse_count.at(j)));
     }
     rmse_ori.calculate();
     rmse_pos.calculate();
     PRINT_DEBUG("\tRMSE: mean_ori = %.3f | mean_pos = %.3f\n", rmse_ori.mean, rmse_pos.mean);
-
-    // RMSE: Convert into the right format (only use times where all runs have an error)
-    ov_eval::Statistics rmse_2d_ori, rmse_2d_pos;
-    for (auto &elm : rmse_2d_dataset) {
-      if (elm.second.first.values.size() == file_paths.size()) {
-        elm.second.first.calculate();
-        elm.second.second.calculate();
-        rmse_2d_ori.timestamps.push_back(elm.first);
-        rmse_2d_ori.values.push_back(elm.second.first.rmse);
-        rmse_2d_pos.timestamps.push_back(elm.first);
-        rmse_2d_pos.values.push_back(elm.second.second.rmse);
-      }
-    }
     rmse_2d_ori.calculate();
     rmse_2d_pos.calculate();
     PRINT_DEBUG("\tRMSE 2D: mean_ori = %.3f | mean_pos = %.3f\n", rmse_2d_ori.mean, rmse_2d_pos.mean);
 
     // NEES: Convert into the right format (only use times where all runs have an error)
     ov_eval::Statistics nees_ori, nees_pos;
-    for (auto &elm : nees_dataset) {
-      if (elm.second.first.values.size() == file_paths.size()) {
-        elm.second.first.calculate();
-        elm.second.second.calculate();
-        nees_ori.timestamps.push_back(elm.first);
-        nees_ori.values.push_back(elm.second.first.mean);
-        nees_pos.timestamps.push_back(elm.first);
-        nees_pos.values.push_back(elm.second.second.mean);
-      }
+    for (size_t j = 0; j < times.size(); j++) {
+      if (nees_count.at(j) != (int)file_paths.size())
+        continue;
+      nees_ori.timestamps.push_back(times.at(j));
+      nees_ori.values.push_back(nees_ori_sum.at(j) / (double)nees_count.at(j));
+      nees_pos.timestamps.push_back(times.at(j));
+      nees_pos.values.push_back(nees_pos_sum.at(j) / (double)nees_count.at(j));
     }
     nees_ori.calculate();
     nees_pos.calculate();
     PRINT_DEBUG("\tNEES: mean_ori = %.3f | mean_pos = %.3f\n", nees_ori.mean, nees_pos.mean);
 
+    // Record the per-timestep curves for our binary export if requested
+    if (!path_stats.empty()) {
+      std::string algoname = path_algorithms.at(i).filename().string();
+      stats_series.push_back({algoname + "_rmse_ori", rmse_ori});
+      stats_series.push_back({algoname + "_rmse_pos", rmse_pos});
+      stats_series.push_back({algoname + "_nees_ori", nees_ori});
+      stats_series.push_back({algoname + "_nees_pos", nees_pos});
+    }
+
 #ifdef HAVE_PYTHONLIBS
 
     //=====================================================
@@ -349,14 +359,9 @@ int main(int argc, char **argv) {
 
     // Update the global RPE error stats
     for (const auto &elm : rpe_dataset) {
-      algo_rpe.at(algo).at(elm.first).first.values.insert(algo_rpe.at(algo).at(elm.first).first.values.end(),
-                                                          elm.second.first.values.begin(), elm.second.first.values.end());
-      algo_rpe.at(algo).at(elm.first).first.timestamps.insert(algo_rpe.at(algo).at(elm.first).first.timestamps.end(),
-                                                              elm.second.first.timestamps.begin(), elm.second.first.timestamps.end());
-      algo_rpe.at(algo).at(elm.first).second.values.insert(algo_rpe.at(algo).at(elm.first).second.values.end(),
-                                                           elm.second.second.values.begin(), elm.second.second.values.end());
-      algo_rpe.at(algo).at(elm.first).second.timestamps.insert(algo_rpe.at(algo).at(elm.first).second.timestamps.end(),
-                                                               elm.second.second.timestamps.begin(), elm.second.second.timestamps.end());
+      algo_rpe.at(algo).at(elm.first).count += elm.second.count;
+      algo_rpe.at(algo).at(elm.first).sum_ori += elm.second.sum_ori;
+      algo_rpe.at(algo).at(elm.first).sum_pos += elm.second.sum_pos;
     }
   }
   PRINT_DEBUG("\n\n");
@@ -405,9 +410,9 @@ int main(int argc, char **argv) {
     boost::replace_all(algoname, "_", "\\_");
     PRINT_INFO(algoname.c_str());
     for (auto &seg : algo.second) {
-      seg.second.first.calculate();
-      seg.second.second.calculate();
-      PRINT_INFO(" & %.3f / %.3f", seg.second.first.mean, seg.second.second.mean);
+      double mean_ori = (seg.second.count == 0) ? 0.0 : seg.second.sum_ori / (double)seg.second.count;
+      double mean_pos = (seg.second.count == 0) ? 0.0 : seg.second.sum_pos / (double)seg.second.count;
+      PRINT_INFO(" & %.3f / %.3f", mean_ori, mean_pos);
     }
     PRINT_INFO(" \\\\\n");
   }
@@ -420,6 +425,12 @@ int main(int argc, char **argv) {
 
 #endif
 
+  // Finally write all the recorded series to file
+  if (!path_stats.empty()) {
+    ov_eval::BinaryStats::write(path_stats, stats_series);
+    PRINT_INFO("[STAT]: saved %d series to %s\n", (int)stats_series.size(), path_stats.c_str());
+  }
+
   // Done!
   return EXIT_SUCCESS;
 }
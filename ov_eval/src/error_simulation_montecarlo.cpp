@@ -0,0 +1,69 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2018-2023 Patrick Geneva
+ * Copyright (C) 2018-2023 Guoquan Huang
+ * Copyright (C) 2018-2023 OpenVINS Contributors
+ * Copyright (C) 2018-2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <string>
+#include <thread>
+
+#include "calc/ResultMonteCarlo.h"
+#include "utils/colors.h"
+#include "utils/print.h"
+#include "utils/thread_pool.h"
+
+#ifdef HAVE_PYTHONLIBS
+
+// import the c++ wrapper for matplot lib
+// https://github.com/lava/matplotlib-cpp
+// sudo apt-get install python-matplotlib python-numpy python2.7-dev
+#include "plot/matplotlibcpp.h"
+
+#endif
+
+int main(int argc, char **argv) {
+
+  // Verbosity setting
+  ov_core::Printer::setPrintLevel("INFO");
+
+  // Worker threads used to load and process the runs in parallel
+  ov_core::ThreadPool::instance().configure((int)std::thread::hardware_concurrency(), {});
+
+  // Ensure we have a path
+  if (argc < 2) {
+    PRINT_ERROR(RED "ERROR: Please specify a folder of simulation runs\n" RESET);
+    PRINT_ERROR(RED "ERROR: ./error_simulation_montecarlo <folder_runs>\n" RESET);
+    PRINT_ERROR(RED "ERROR: rosrun ov_eval error_simulation_montecarlo <folder_runs>\n" RESET);
+    PRINT_ERROR(RED "ERROR: each sub-folder should have the state_estimate, state_deviation, and state_groundtruth files\n" RESET);
+    std::exit(EXIT_FAILURE);
+  }
+
+  // Load all runs of this study
+  ov_eval::ResultMonteCarlo study(argv[1]);
+
+  // Compute and plot the run-averaged NEES and RMSE
+  PRINT_INFO("Plotting Monte-Carlo consistency statistics...\n");
+  study.plot_consistency(true);
+
+#ifdef HAVE_PYTHONLIBS
+  matplotlibcpp::show(true);
+#endif
+
+  // Done!
+  return EXIT_SUCCESS;
+}
@@ -24,6 +24,7 @@
 #include <string>
 
 #include "calc/ResultTrajectory.h"
+#include "utils/BinaryStats.h"
 #include "utils/colors.h"
 #include "utils/print.h"
 
@@ -90,11 +91,20 @@ int main(int argc, char **argv) {
   // Ensure we have a path
   if (argc < 4) {
     PRINT_ERROR(RED "ERROR: Please specify a align mode, groudtruth, and algorithm run file\n" RESET);
-    PRINT_ERROR(RED "ERROR: ./error_singlerun <align_mode> <file_gt.txt> <file_est.txt>\n" RESET);
-    PRINT_ERROR(RED "ERROR: rosrun ov_eval error_singlerun <align_mode> <file_gt.txt> <file_est.txt>\n" RESET);
+    PRINT_ERROR(RED "ERROR: ./error_singlerun <align_mode> <file_gt.txt> <file_est.txt> [interpolate_gt] [file_stats.ovs]\n" RESET);
+    PRINT_ERROR(RED "ERROR: rosrun ov_eval error_singlerun <align_mode> <file_gt.txt> <file_est.txt> [interpolate_gt] [file_stats.ovs]\n" RESET);
     std::exit(EXIT_FAILURE);
   }
 
+  // If we should interpolate the groundtruth to the estimate timestamps instead of
+  // only keeping estimates that land near a groundtruth sample
+  bool interpolate_gt = (argc > 4 && std::string(argv[4]) == "interpolate_gt");
+
+  // Optional binary statistics export so a headless run can be re-plotted later
+  // with plot_statistics instead of re-evaluating the whole trajectory
+  std::string path_stats = ov_eval::BinaryStats::export_path(argc, argv);
+  std::vector<std::pair<std::string, ov_eval::Statistics>> stats_series;
+
   // Load it!
   boost::filesystem::path path_gt(argv[2]);
   std::vector<double> times;
@@ -106,7 +116,7 @@ int main(int argc, char **argv) {
   PRINT_DEBUG("[COMP]: %d poses in %s => length of %.2f meters\n", (int)times.size(), path_gt.stem().string().c_str(), length);
 
   // Create our trajectory object
-  ov_eval::ResultTrajectory traj(argv[3], argv[2], argv[1]);
+  ov_eval::ResultTrajectory traj(argv[3], argv[2], argv[1], interpolate_gt);
 
   //===========================================================
   // Absolute trajectory error
@@ -126,6 +136,12 @@ int main(int argc, char **argv) {
   PRINT_INFO("max_ori  = %.3f | max_pos  = %.3f\n", error_ori.max, error_pos.max);
   PRINT_INFO("std_ori  = %.3f | std_pos  = %.3f\n", error_ori.std, error_pos.std);
 
+  // Record for our binary export if requested
+  if (!path_stats.empty()) {
+    stats_series.push_back({"ate_ori", error_ori});
+    stats_series.push_back({"ate_pos", error_pos});
+  }
+
   //===========================================================
   // Relative pose error
   //===========================================================
@@ -145,6 +161,14 @@ int main(int argc, char **argv) {
     // PRINT_DEBUG("seg %d - std_ori  = %.3f | std_pos  = %.3f\n",(int)seg.first,seg.second.first.std,seg.second.second.std);
   }
 
+  // Record for our binary export if requested
+  if (!path_stats.empty()) {
+    for (const auto &seg : error_rpe) {
+      stats_series.push_back({"rpe_" + std::to_string((int)seg.first) + "m_ori", seg.second.first});
+      stats_series.push_back({"rpe_" + std::to_string((int)seg.first) + "m_pos", seg.second.second});
+    }
+  }
+
 #ifdef HAVE_PYTHONLIBS
 
   // Parameters
@@ -213,6 +237,12 @@ int main(int argc, char **argv) {
   PRINT_INFO("std_ori  = %.3f | std_pos  = %.3f\n", nees_ori.std, nees_pos.std);
   PRINT_INFO("======================================\n");
 
+  // Record for our binary export if requested
+  if (!path_stats.empty()) {
+    stats_series.push_back({"nees_ori", nees_ori});
+    stats_series.push_back({"nees_pos", nees_pos});
+  }
+
 #ifdef HAVE_PYTHONLIBS
 
   if (!nees_ori.values.empty() && !nees_pos.values.empty()) {
@@ -280,6 +310,19 @@ int main(int argc, char **argv) {
     yaw.timestamps.at(i) -= starttime2;
   }
 
+  // Record for our binary export if requested
+  if (!path_stats.empty()) {
+    stats_series.push_back({"pos_x", posx});
+    stats_series.push_back({"pos_y", posy});
+    stats_series.push_back({"pos_z", posz});
+    stats_series.push_back({"ori_x", orix});
+    stats_series.push_back({"ori_y", oriy});
+    stats_series.push_back({"ori_z", oriz});
+    stats_series.push_back({"rpy_roll", roll});
+    stats_series.push_back({"rpy_pitch", pitch});
+    stats_series.push_back({"rpy_yaw", yaw});
+  }
+
 #ifdef HAVE_PYTHONLIBS
 
   //=====================================================
@@ -350,6 +393,12 @@ int main(int argc, char **argv) {
 
 #endif
 
+  // Finally write all the recorded series to file
+  if (!path_stats.empty()) {
+    ov_eval::BinaryStats::write(path_stats, stats_series);
+    PRINT_INFO("[STAT]: saved %d series to %s\n", (int)stats_series.size(), path_stats.c_str());
+  }
+
   // Done!
   return EXIT_SUCCESS;
 }
@@ -22,18 +22,24 @@
 #include <Eigen/Eigen>
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/filesystem.hpp>
+#include <chrono>
 #include <fstream>
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <thread>
 
+#include "utils/BinaryTiming.h"
+#include "utils/BinaryTrajectory.h"
+#include "utils/Loader.h"
 #include "utils/colors.h"
 #include "utils/print.h"
+#include "utils/thread_pool.h"
 
 /**
  * Given a CSV file this will convert it to our text file format.
  */
-void process_csv(std::string infile) {
+void process_csv(std::string infile, bool overwrite = false) {
 
   // Verbosity setting
   ov_core::Printer::setPrintLevel("INFO");
@@ -96,9 +102,9 @@ void process_csv(std::string infile) {
   }
   PRINT_INFO("\t- Loaded %d poses from file\n", (int)traj_data.size());
 
-  // If file exists already then crash
+  // If file exists already then crash (batch mode regenerates stale outputs instead)
   std::string outfile = infile.substr(0, infile.find_last_of('.')) + ".txt";
-  if (boost::filesystem::exists(outfile)) {
+  if (!overwrite && boost::filesystem::exists(outfile)) {
     PRINT_ERROR(RED "\t- ERROR: Output file already exists, please delete and re-run this script!!\n" RESET);
     PRINT_ERROR(RED "\t- ERROR: %s\n" RESET, outfile.c_str());
     return;
@@ -129,31 +135,285 @@ void process_csv(std::string infile) {
   file2.close();
 }
 
+/**
+ * Given one of our text trajectory files this will convert it to the binary format.
+ */
+void process_txt_to_binary(std::string infile, bool overwrite = false) {
+
+  // Verbosity setting
+  ov_core::Printer::setPrintLevel("INFO");
+
+  // Load the text trajectory (this exits if the file is bad)
+  std::vector<double> times;
+  std::vector<Eigen::Matrix<double, 7, 1>> poses;
+  std::vector<Eigen::Matrix3d> cov_ori, cov_pos;
+  ov_eval::Loader::load_data(infile, times, poses, cov_ori, cov_pos);
+  PRINT_INFO("Opening file %s\n", boost::filesystem::path(infile).filename().c_str());
+  PRINT_INFO("\t- Loaded %d poses from file\n", (int)poses.size());
+
+  // If file exists already then crash (batch mode regenerates stale outputs instead)
+  std::string outfile = infile.substr(0, infile.find_last_of('.')) + ".ovb";
+  if (!overwrite && boost::filesystem::exists(outfile)) {
+    PRINT_ERROR(RED "\t- ERROR: Output file already exists, please delete and re-run this script!!\n" RESET);
+    PRINT_ERROR(RED "\t- ERROR: %s\n" RESET, outfile.c_str());
+    return;
+  }
+
+  // Write it back out as binary
+  ov_eval::BinaryTrajectory::write(outfile, times, poses, cov_ori, cov_pos);
+  PRINT_INFO("\t- Saved to file %s\n", boost::filesystem::path(outfile).filename().c_str());
+}
+
+/**
+ * Given a binary trajectory file this will convert it back to our text file format.
+ */
+void process_binary_to_txt(std::string infile) {
+
+  // Verbosity setting
+  ov_core::Printer::setPrintLevel("INFO");
+
+  // Load the binary trajectory (this exits if the file is bad)
+  std::vector<double> times;
+  std::vector<Eigen::Matrix<double, 7, 1>> poses;
+  std::vector<Eigen::Matrix3d> cov_ori, cov_pos;
+  ov_eval::Loader::load_data(infile, times, poses, cov_ori, cov_pos);
+  PRINT_INFO("Opening file %s\n", boost::filesystem::path(infile).filename().c_str());
+  PRINT_INFO("\t- Loaded %d poses from file\n", (int)poses.size());
+
+  // If file exists already then crash
+  std::string outfile = infile.substr(0, infile.find_last_of('.')) + ".txt";
+  if (boost::filesystem::exists(outfile)) {
+    PRINT_ERROR(RED "\t- ERROR: Output file already exists, please delete and re-run this script!!\n" RESET);
+    PRINT_ERROR(RED "\t- ERROR: %s\n" RESET, outfile.c_str());
+    return;
+  }
+
+  // Open this file we want to write to
+  std::ofstream file2;
+  file2.open(outfile.c_str());
+  if (file2.fail()) {
+    PRINT_ERROR(RED "ERROR: Unable to open output file!!\n" RESET);
+    PRINT_ERROR(RED "ERROR: %s\n" RESET, outfile.c_str());
+    std::exit(EXIT_FAILURE);
+  }
+  file2 << "# timestamp(s) tx ty tz qx qy qz qw Pr11 Pr12 Pr13 Pr22 Pr23 Pr33 Pt11 Pt12 Pt13 Pt22 Pt23 Pt33" << std::endl;
+
+  // Write to disk in the correct order!
+  for (size_t i = 0; i < times.size(); i++) {
+    file2.precision(5);
+    file2.setf(std::ios::fixed, std::ios::floatfield);
+    file2 << times.at(i) << " ";
+    file2.precision(6);
+    file2 << poses.at(i)(0) << " " << poses.at(i)(1) << " " << poses.at(i)(2) << " " << poses.at(i)(3) << " " << poses.at(i)(4) << " "
+          << poses.at(i)(5) << " " << poses.at(i)(6);
+    if (!cov_ori.empty()) {
+      file2.precision(10);
+      file2 << " " << cov_ori.at(i)(0, 0) << " " << cov_ori.at(i)(0, 1) << " " << cov_ori.at(i)(0, 2) << " " << cov_ori.at(i)(1, 1) << " "
+            << cov_ori.at(i)(1, 2) << " " << cov_ori.at(i)(2, 2) << " " << cov_pos.at(i)(0, 0) << " " << cov_pos.at(i)(0, 1) << " "
+            << cov_pos.at(i)(0, 2) << " " << cov_pos.at(i)(1, 1) << " " << cov_pos.at(i)(1, 2) << " " << cov_pos.at(i)(2, 2) << std::endl;
+    } else {
+      file2 << std::endl;
+    }
+  }
+  PRINT_INFO("\t- Saved to file %s\n", boost::filesystem::path(outfile).filename().c_str());
+
+  // Finally close the file
+  file2.close();
+}
+
+/**
+ * Given a text timing log this will convert it to our binary timing format.
+ */
+void process_timing_to_binary(std::string infile) {
+
+  // Verbosity setting
+  ov_core::Printer::setPrintLevel("INFO");
+
+  // Load the text timing log (this exits if the file is bad)
+  std::vector<std::string> names;
+  std::vector<double> times;
+  std::vector<Eigen::VectorXd> timing_values;
+  ov_eval::Loader::load_timing_flamegraph(infile, names, times, timing_values);
+  PRINT_INFO("Opening file %s\n", boost::filesystem::path(infile).filename().c_str());
+  PRINT_INFO("\t- Loaded %d timestamps from file (%d categories)\n", (int)times.size(), (int)names.size());
+
+  // If file exists already then crash
+  std::string outfile = infile.substr(0, infile.find_last_of('.')) + ".ovt";
+  if (boost::filesystem::exists(outfile)) {
+    PRINT_ERROR(RED "\t- ERROR: Output file already exists, please delete and re-run this script!!\n" RESET);
+    PRINT_ERROR(RED "\t- ERROR: %s\n" RESET, outfile.c_str());
+    return;
+  }
+
+  // Write it back out as binary
+  ov_eval::BinaryTiming::write(outfile, names, times, timing_values);
+  PRINT_INFO("\t- Saved to file %s\n", boost::filesystem::path(outfile).filename().c_str());
+}
+
+/**
+ * Given a binary timing file this will convert it back to the text timing format.
+ */
+void process_timing_to_txt(std::string infile) {
+
+  // Verbosity setting
+  ov_core::Printer::setPrintLevel("INFO");
+
+  // Load the binary timing log (this exits if the file is bad)
+  std::vector<std::string> names;
+  std::vector<double> times;
+  std::vector<Eigen::VectorXd> timing_values;
+  ov_eval::Loader::load_timing_flamegraph(infile, names, times, timing_values);
+  PRINT_INFO("Opening file %s\n", boost::filesystem::path(infile).filename().c_str());
+  PRINT_INFO("\t- Loaded %d timestamps from file (%d categories)\n", (int)times.size(), (int)names.size());
+
+  // If file exists already then crash
+  std::string outfile = infile.substr(0, infile.find_last_of('.')) + ".txt";
+  if (boost::filesystem::exists(outfile)) {
+    PRINT_ERROR(RED "\t- ERROR: Output file already exists, please delete and re-run this script!!\n" RESET);
+    PRINT_ERROR(RED "\t- ERROR: %s\n" RESET, outfile.c_str());
+    return;
+  }
+
+  // Open this file we want to write to
+  std::ofstream file2;
+  file2.open(outfile.c_str());
+  if (file2.fail()) {
+    PRINT_ERROR(RED "ERROR: Unable to open output file!!\n" RESET);
+    PRINT_ERROR(RED "ERROR: %s\n" RESET, outfile.c_str());
+    std::exit(EXIT_FAILURE);
+  }
+  file2 << "# timestamp (s)";
+  for (const auto &name : names)
+    file2 << "," << name;
+  file2 << std::endl;
+
+  // Write to disk in the correct order!
+  for (size_t i = 0; i < times.size(); i++) {
+    file2.precision(5);
+    file2.setf(std::ios::fixed, std::ios::floatfield);
+    file2 << times.at(i);
+    file2.precision(8);
+    for (int c = 0; c < timing_values.at(i).rows(); c++)
+      file2 << "," << timing_values.at(i)(c);
+    file2 << std::endl;
+  }
+  PRINT_INFO("\t- Saved to file %s\n", boost::filesystem::path(outfile).filename().c_str());
+
+  // Finally close the file
+  file2.close();
+}
+
+/**
+ * Returns true if the output file already exists and is at least as new as the input,
+ * in which case the conversion can be skipped (the batch mode incremental check).
+ */
+bool is_up_to_date(const std::string &infile, const std::string &outfile) {
+  if (!boost::filesystem::exists(outfile))
+    return false;
+  return boost::filesystem::last_write_time(outfile) >= boost::filesystem::last_write_time(infile);
+}
+
+/**
+ * Batch mode: converts every trajectory file under the given directory over the worker
+ * pool, skipping outputs that are already newer than their inputs. Raw csv logs become
+ * text and text trajectories become binary, so re-running only touches what changed.
+ * With watch enabled this keeps polling the directory, picking up new and modified
+ * files as they appear (a csv dropped in converges to its binary on the next poll).
+ */
+void process_directory(std::string folder, bool watch) {
+
+  // Verbosity setting
+  ov_core::Printer::setPrintLevel("INFO");
+
+  // Create our thread pool (each file conversion is independent)
+  ov_core::ThreadPool::instance().configure((int)std::thread::hardware_concurrency(), {});
+
+  bool first_pass = true;
+  while (true) {
+
+    // Collect the conversions whose outputs are missing or stale by mtime
+    std::vector<std::string> jobs;
+    for (auto &p : boost::filesystem::recursive_directory_iterator(boost::filesystem::path(folder))) {
+      std::string infile = p.path().string();
+      std::string outfile;
+      if (p.path().extension() == ".csv") {
+        outfile = infile.substr(0, infile.find_last_of('.')) + ".txt";
+      } else if (p.path().extension() == ".txt") {
+        outfile = infile.substr(0, infile.find_last_of('.')) + ".ovb";
+      } else {
+        continue;
+      }
+      if (!is_up_to_date(infile, outfile)) {
+        jobs.push_back(infile);
+      }
+    }
+
+    // Convert them all in parallel workers
+    if (!jobs.empty()) {
+      PRINT_INFO("Converting %d stale files with %d workers...\n", (int)jobs.size(), (int)std::thread::hardware_concurrency());
+      ov_core::ThreadPool::instance().parallel_for(0, (int)jobs.size(), [&](int i) {
+        if (boost::algorithm::ends_with(jobs.at(i), "csv")) {
+          process_csv(jobs.at(i), true);
+        } else {
+          process_txt_to_binary(jobs.at(i), true);
+        }
+      });
+    } else if (first_pass) {
+      PRINT_INFO("All outputs are up-to-date, nothing to convert\n");
+    }
+    first_pass = false;
+
+    // Single pass unless we were asked to keep watching for new files
+    if (!watch)
+      break;
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+  }
+}
+
 int main(int argc, char **argv) {
 
   // Ensure we have a path
   if (argc < 2) {
     PRINT_ERROR(RED "ERROR: Please specify a file to convert\n" RESET);
-    PRINT_ERROR(RED "ERROR: ./format_converter <file.csv or folder\n" RESET);
-    PRINT_ERROR(RED "ERROR: rosrun ov_eval format_converter <file.csv or folder>\n" RESET);
+    PRINT_ERROR(RED "ERROR: ./format_converter <file.csv, file.txt, file.ovb, file.ovt or folder>\n" RESET);
+    PRINT_ERROR(RED "ERROR: rosrun ov_eval format_converter <file.csv, file.txt, file.ovb, file.ovt or folder>\n" RESET);
+    PRINT_ERROR(RED "ERROR: append \"timing\" to convert a text timing log: ./format_converter <file_times.txt> timing\n" RESET);
+    PRINT_ERROR(RED "ERROR: append \"watch\" to keep converting a folder as files appear: ./format_converter <folder> watch\n" RESET);
     std::exit(EXIT_FAILURE);
   }
 
-  // If we do not have a wildcard, then process this one csv
+  // If we do not have a wildcard, then process this one file
+  // Text files become binary and binary files become text
   if (boost::algorithm::ends_with(argv[1], "csv")) {
 
     // Process this single file
     process_csv(argv[1]);
 
+  } else if (boost::algorithm::ends_with(argv[1], "txt") && argc >= 3 && std::string(argv[2]) == "timing") {
+
+    // Process this single timing log
+    process_timing_to_binary(argv[1]);
+
+  } else if (boost::algorithm::ends_with(argv[1], "txt")) {
+
+    // Process this single file
+    process_txt_to_binary(argv[1]);
+
+  } else if (boost::algorithm::ends_with(argv[1], "ovb")) {
+
+    // Process this single file
+    process_binary_to_txt(argv[1]);
+
+  } else if (boost::algorithm::ends_with(argv[1], "ovt")) {
+
+    // Process this single timing file
+    process_timing_to_txt(argv[1]);
+
   } else {
 
-    // Loop through this directory
-    boost::filesystem::path infolder(argv[1]);
-    for (auto &p : boost::filesystem::recursive_directory_iterator(infolder)) {
-      if (p.path().extension() == ".csv") {
-        process_csv(p.path().string());
-      }
-    }
+    // Batch mode over a directory, incremental by mtime and parallel over workers
+    // Appending "watch" keeps polling the directory for new or modified files
+    process_directory(argv[1], argc >= 3 && std::string(argv[2]) == "watch");
   }
 
   // Done!
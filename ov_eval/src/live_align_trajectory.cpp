@@ -19,11 +19,13 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <deque>
+#include <limits>
+
 #include <geometry_msgs/PoseStamped.h>
 #include <nav_msgs/Path.h>
 #include <ros/ros.h>
 
-#include "alignment/AlignTrajectory.h"
 #include "alignment/AlignUtils.h"
 #include "utils/Loader.h"
 #include "utils/colors.h"
@@ -36,6 +38,137 @@ std::vector<double> times_gt;
 std::vector<Eigen::Matrix<double, 7, 1>> poses_gt;
 std::string alignment_type;
 
+// Incremental alignment state: the Umeyama quantities are maintained as running sums
+// over the matched pose pairs, so each new pose is O(1) to fold in and the closed-form
+// transform is recovered from the sums without ever revisiting the whole history
+int window_size = 0; // how many of the newest matched pairs the alignment uses (0 = entire session)
+size_t gt_pointer = 0;
+double last_est_time = -std::numeric_limits<double>::infinity();
+double sum_n = 0.0;
+Eigen::Vector3d sum_est = Eigen::Vector3d::Zero();
+Eigen::Vector3d sum_gt = Eigen::Vector3d::Zero();
+Eigen::Matrix3d sum_gt_estT = Eigen::Matrix3d::Zero();
+double sum_est_sq = 0.0;
+std::deque<std::pair<Eigen::Vector3d, Eigen::Vector3d>> window_pairs; // (est, gt), only filled when windowed
+bool have_first_pair = false;
+Eigen::Matrix<double, 7, 1> first_est_pose, first_gt_pose;
+
+// Matched groundtruth poses we re-publish as the corrected path
+// Only every stride'th is kept once full, so memory stays bounded over long sessions
+std::deque<std::pair<double, Eigen::Matrix<double, 7, 1>>> gt_matched;
+size_t gt_hist_stride = 1, gt_hist_counter = 0;
+const size_t gt_hist_max = 16384;
+
+/**
+ * Folds one matched estimate/groundtruth pose pair into the running sums.
+ * If a sliding window is configured, the contribution of pairs that fall out
+ * of the window is subtracted again.
+ */
+void fold_in_match(const Eigen::Matrix<double, 7, 1> &pose_est, const Eigen::Matrix<double, 7, 1> &pose_gt) {
+  Eigen::Vector3d p_est = pose_est.block(0, 0, 3, 1);
+  Eigen::Vector3d p_gt = pose_gt.block(0, 0, 3, 1);
+  sum_n += 1.0;
+  sum_est += p_est;
+  sum_gt += p_gt;
+  sum_gt_estT += p_gt * p_est.transpose();
+  sum_est_sq += p_est.squaredNorm();
+  if (!have_first_pair) {
+    have_first_pair = true;
+    first_est_pose = pose_est;
+    first_gt_pose = pose_gt;
+  }
+  if (window_size > 0) {
+    window_pairs.emplace_back(p_est, p_gt);
+    while ((int)window_pairs.size() > window_size) {
+      Eigen::Vector3d p_est_old = window_pairs.front().first;
+      Eigen::Vector3d p_gt_old = window_pairs.front().second;
+      sum_n -= 1.0;
+      sum_est -= p_est_old;
+      sum_gt -= p_gt_old;
+      sum_gt_estT -= p_gt_old * p_est_old.transpose();
+      sum_est_sq -= p_est_old.squaredNorm();
+      window_pairs.pop_front();
+    }
+  }
+}
+
+/**
+ * Recovers the alignment transform from the running sums (closed form, independent
+ * of how many poses have been folded in). This is the same math AlignUtils::align_umeyama
+ * evaluates from the raw point sets: the correlation matrix and data variance are
+ * expressed through the accumulated first and second moments instead.
+ * Returns false if we do not yet have enough matched poses.
+ */
+bool compute_alignment(Eigen::Matrix3d &R, Eigen::Vector3d &t, double &s) {
+
+  // No-op and single-pose methods do not need the accumulated sums
+  if (alignment_type == "none") {
+    s = 1;
+    R.setIdentity();
+    t.setZero();
+    return true;
+  }
+  if (alignment_type == "posyawsingle" || alignment_type == "se3single") {
+    if (!have_first_pair)
+      return false;
+    Eigen::Matrix3d g_rot = ov_core::quat_2_Rot(first_gt_pose.block(3, 0, 4, 1)).transpose();
+    Eigen::Matrix3d est_rot = ov_core::quat_2_Rot(first_est_pose.block(3, 0, 4, 1)).transpose();
+    s = 1;
+    if (alignment_type == "posyawsingle") {
+      R = ov_core::rot_z(ov_eval::AlignUtils::get_best_yaw(est_rot * g_rot.transpose()));
+    } else {
+      R.noalias() = g_rot * est_rot.transpose();
+    }
+    t.noalias() = first_gt_pose.block(0, 0, 3, 1) - R * first_est_pose.block(0, 0, 3, 1);
+    return true;
+  }
+
+  // Umeyama-based methods, need at least a handful of matched pairs
+  if (sum_n < 3)
+    return false;
+  double n = sum_n;
+  Eigen::Vector3d mu_D = sum_est / n; // data = estimate
+  Eigen::Vector3d mu_M = sum_gt / n;  // model = groundtruth
+  Eigen::Matrix3d C = sum_gt_estT / n - mu_M * mu_D.transpose();
+  double sigma2 = sum_est_sq / n - mu_D.squaredNorm();
+  if (alignment_type == "posyaw") {
+    s = 1;
+    Eigen::Matrix3d rot_C = n * C.transpose();
+    R = ov_core::rot_z(ov_eval::AlignUtils::get_best_yaw(rot_C));
+  } else if (alignment_type == "se3" || alignment_type == "sim3") {
+    Eigen::JacobiSVD<Eigen::Matrix3d> svd(C, Eigen::ComputeFullV | Eigen::ComputeFullU);
+    Eigen::Matrix3d S = Eigen::Matrix3d::Identity();
+    if (svd.matrixU().determinant() * svd.matrixV().determinant() < 0)
+      S(2, 2) = -1;
+    R.noalias() = svd.matrixU() * S * svd.matrixV().transpose();
+    s = (alignment_type == "sim3") ? 1.0 / sigma2 * (svd.singularValues().asDiagonal() * S).trace() : 1.0;
+  } else {
+    PRINT_ERROR(RED "[ALIGN]: Invalid alignment method!\n" RESET);
+    PRINT_ERROR(RED "[ALIGN]: Possible options: posyaw, posyawsingle, se3, se3single, sim3, none\n" RESET);
+    std::exit(EXIT_FAILURE);
+  }
+  t.noalias() = mu_M - s * R * mu_D;
+  return true;
+}
+
+/**
+ * Resets all incremental state (e.g. when the estimator restarts and time jumps back).
+ */
+void reset_alignment_state() {
+  gt_pointer = 0;
+  last_est_time = -std::numeric_limits<double>::infinity();
+  sum_n = 0.0;
+  sum_est.setZero();
+  sum_gt.setZero();
+  sum_gt_estT.setZero();
+  sum_est_sq = 0.0;
+  window_pairs.clear();
+  have_first_pair = false;
+  gt_matched.clear();
+  gt_hist_stride = 1;
+  gt_hist_counter = 0;
+}
+
 int main(int argc, char **argv) {
 
   // Create ros node
@@ -50,6 +183,9 @@ int main(int argc, char **argv) {
   // Load what type of alignment we should use
   nh.param<std::string>("alignment_type", alignment_type, "posyaw");
 
+  // How many of the newest matched poses the alignment may use (0 = whole session)
+  nh.param<int>("window_size", window_size, 0);
+
   // If we don't have it, or it is empty then error
   if (!nh.hasParam("path_gt")) {
     ROS_ERROR("[LOAD]: Please provide a groundtruth file path!!!");
@@ -80,35 +216,63 @@ int main(int argc, char **argv) {
 
 void align_and_publish(const nav_msgs::Path::ConstPtr &msg) {
 
-  // Convert the message into correct vector format
-  // tx ty tz qx qy qz qw
-  std::vector<double> times_temp;
-  std::vector<Eigen::Matrix<double, 7, 1>> poses_temp;
+  // If the estimator restarted (timestamps jumped backwards), start the alignment over
+  if (!msg->poses.empty() && msg->poses.back().header.stamp.toSec() < last_est_time) {
+    reset_alignment_state();
+  }
+
+  // Fold in only the poses we have not seen yet (the path message resends its history)
   for (auto const &pose : msg->poses) {
-    times_temp.push_back(pose.header.stamp.toSec());
-    Eigen::Matrix<double, 7, 1> pose_tmp;
-    pose_tmp << pose.pose.position.x, pose.pose.position.y, pose.pose.position.z, pose.pose.orientation.x, pose.pose.orientation.y,
+    double time_est = pose.header.stamp.toSec();
+    if (time_est <= last_est_time)
+      continue;
+    last_est_time = time_est;
+    Eigen::Matrix<double, 7, 1> pose_est;
+    pose_est << pose.pose.position.x, pose.pose.position.y, pose.pose.position.z, pose.pose.orientation.x, pose.pose.orientation.y,
         pose.pose.orientation.z, pose.pose.orientation.w;
-    poses_temp.push_back(pose_tmp);
-  }
 
-  // Intersect timestamps
-  std::vector<double> gt_times_temp = times_gt;
-  std::vector<Eigen::Matrix<double, 7, 1>> gt_poses_temp = poses_gt;
-  ov_eval::AlignUtils::perform_association(0, 0.02, times_temp, gt_times_temp, poses_temp, gt_poses_temp);
+    // Find the closest groundtruth pose for this timestamp
+    // Same injective matching as AlignUtils::perform_association, but the groundtruth
+    // pointer persists across messages so every pose is matched exactly once
+    double best_diff = 0.02;
+    int best_gt_idx = -1;
+    while (gt_pointer < times_gt.size() && times_gt.at(gt_pointer) < time_est && std::abs(times_gt.at(gt_pointer) - time_est) > 0.02) {
+      gt_pointer++;
+    }
+    while (gt_pointer < times_gt.size() && std::abs(times_gt.at(gt_pointer) - time_est) <= 0.02) {
+      if (std::abs(times_gt.at(gt_pointer) - time_est) >= best_diff) {
+        break;
+      }
+      best_diff = std::abs(times_gt.at(gt_pointer) - time_est);
+      best_gt_idx = (int)gt_pointer;
+      gt_pointer++;
+    }
+    if (best_gt_idx == -1)
+      continue;
 
-  // Return failure if we didn't have any common timestamps
-  if (poses_temp.size() < 3) {
-    PRINT_ERROR(RED "[TRAJ]: unable to get enough common timestamps between trajectories.\n" RESET);
-    PRINT_ERROR(RED "[TRAJ]: does the estimated trajectory publish the rosbag timestamps??\n" RESET);
-    return;
+    // Fold the matched pair into the running sums and record the gt pose for publishing
+    fold_in_match(pose_est, poses_gt.at(best_gt_idx));
+    if (gt_hist_counter++ % gt_hist_stride == 0) {
+      gt_matched.emplace_back(times_gt.at(best_gt_idx), poses_gt.at(best_gt_idx));
+      if (gt_matched.size() > gt_hist_max) {
+        std::deque<std::pair<double, Eigen::Matrix<double, 7, 1>>> thinned;
+        for (size_t i = 0; i < gt_matched.size(); i += 2)
+          thinned.push_back(gt_matched.at(i));
+        gt_matched.swap(thinned);
+        gt_hist_stride *= 2;
+      }
+    }
   }
 
-  // Perform alignment of the trajectories
+  // Recover the transform from the running sums (cost independent of the history length)
   Eigen::Matrix3d R_ESTtoGT;
   Eigen::Vector3d t_ESTinGT;
   double s_ESTtoGT;
-  ov_eval::AlignTrajectory::align_trajectory(poses_temp, gt_poses_temp, R_ESTtoGT, t_ESTinGT, s_ESTtoGT, alignment_type);
+  if (!compute_alignment(R_ESTtoGT, t_ESTinGT, s_ESTtoGT)) {
+    PRINT_ERROR(RED "[TRAJ]: unable to get enough common timestamps between trajectories.\n" RESET);
+    PRINT_ERROR(RED "[TRAJ]: does the estimated trajectory publish the rosbag timestamps??\n" RESET);
+    return;
+  }
   Eigen::Vector4d q_ESTtoGT = ov_core::rot_2_quat(R_ESTtoGT);
   PRINT_DEBUG("[TRAJ]: q_ESTtoGT = %.3f, %.3f, %.3f, %.3f | p_ESTinGT = %.3f, %.3f, %.3f | s = %.2f\n", q_ESTtoGT(0), q_ESTtoGT(1),
               q_ESTtoGT(2), q_ESTtoGT(3), t_ESTinGT(0), t_ESTinGT(1), t_ESTinGT(2), s_ESTtoGT);
@@ -119,11 +283,11 @@ void align_and_publish(const nav_msgs::Path::ConstPtr &msg) {
   // NOTE: https://github.com/ros-visualization/rviz/issues/1107
   nav_msgs::Path arr_groundtruth;
   arr_groundtruth.header = msg->header;
-  for (size_t i = 0; i < gt_times_temp.size(); i += std::floor(gt_times_temp.size() / 16384.0) + 1) {
+  for (size_t i = 0; i < gt_matched.size(); i += std::floor(gt_matched.size() / 16384.0) + 1) {
 
     // Convert into the correct frame
-    double timestamp = gt_times_temp.at(i);
-    Eigen::Matrix<double, 7, 1> pose_inGT = gt_poses_temp.at(i);
+    double timestamp = gt_matched.at(i).first;
+    Eigen::Matrix<double, 7, 1> pose_inGT = gt_matched.at(i).second;
     Eigen::Vector3d pos_IinEST = R_ESTtoGT.transpose() * (pose_inGT.block(0, 0, 3, 1) - t_ESTinGT) / s_ESTtoGT;
     Eigen::Vector4d quat_ESTtoI = ov_core::quat_multiply(pose_inGT.block(3, 0, 4, 1), q_ESTtoGT);
     // Finally push back
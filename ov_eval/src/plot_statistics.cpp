@@ -0,0 +1,137 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2018-2023 Patrick Geneva
+ * Copyright (C) 2018-2023 Guoquan Huang
+ * Copyright (C) 2018-2023 OpenVINS Contributors
+ * Copyright (C) 2018-2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <boost/filesystem.hpp>
+#include <string>
+#include <vector>
+
+#include "utils/BinaryStats.h"
+#include "utils/Statistics.h"
+#include "utils/colors.h"
+#include "utils/print.h"
+
+#ifdef HAVE_PYTHONLIBS
+
+// import the c++ wrapper for matplot lib
+// https://github.com/lava/matplotlib-cpp
+// sudo apt-get install python-matplotlib python-numpy python2.7-dev
+#include "plot/matplotlibcpp.h"
+
+// Will plot one statistics series (error line with its 3 sigma bound if recorded)
+void plot_series(ov_eval::Statistics stat) {
+
+  // Parameters that define the line styles
+  std::map<std::string, std::string> params_value, params_bound;
+  params_value.insert({"label", "error"});
+  params_value.insert({"linestyle", "-"});
+  params_value.insert({"color", "blue"});
+  params_bound.insert({"label", "3 sigma bound"});
+  params_bound.insert({"linestyle", "--"});
+  params_bound.insert({"color", "red"});
+
+  // Series without a timestamp for every value (e.g. RPE samples) are plotted by index
+  std::vector<double> xaxis = stat.timestamps;
+  if (xaxis.size() != stat.values.size()) {
+    xaxis.clear();
+    for (size_t i = 0; i < stat.values.size(); i++)
+      xaxis.push_back((double)i);
+  }
+
+  // Plot the values and the bound mirrored around zero if we have it
+  matplotlibcpp::plot(xaxis, stat.values, params_value);
+  if (stat.values_bound.size() == stat.values.size()) {
+    matplotlibcpp::plot(xaxis, stat.values_bound, params_bound);
+    for (size_t i = 0; i < stat.values_bound.size(); i++) {
+      stat.values_bound.at(i) *= -1;
+    }
+    matplotlibcpp::plot(xaxis, stat.values_bound, "r--");
+  }
+}
+
+#endif
+
+int main(int argc, char **argv) {
+
+  // Verbosity setting
+  ov_core::Printer::setPrintLevel("INFO");
+
+  // Ensure we have a path
+  if (argc < 2) {
+    PRINT_ERROR(RED "ERROR: Please specify a binary statistics file\n" RESET);
+    PRINT_ERROR(RED "ERROR: ./plot_statistics <file_stats1.ovs> ... <file_statsN.ovs>\n" RESET);
+    PRINT_ERROR(RED "ERROR: rosrun ov_eval plot_statistics <file_stats1.ovs> ... <file_statsN.ovs>\n" RESET);
+    std::exit(EXIT_FAILURE);
+  }
+
+  // Loop through each file and print the summary of every series it holds
+  // These files are written by the evaluation tools when given a trailing ".ovs"
+  // output path, so a headless CI run can be re-plotted without re-evaluating it
+  std::vector<std::pair<std::string, std::vector<std::pair<std::string, ov_eval::Statistics>>>> files;
+  for (int z = 1; z < argc; z++) {
+    std::vector<std::pair<std::string, ov_eval::Statistics>> series;
+    if (!ov_eval::BinaryStats::read(argv[z], series)) {
+      PRINT_ERROR(RED "[LOAD]: Unable to read binary statistics file!!\n" RESET);
+      PRINT_ERROR(RED "[LOAD]: %s\n" RESET, argv[z]);
+      std::exit(EXIT_FAILURE);
+    }
+    boost::filesystem::path path(argv[z]);
+    PRINT_INFO("======================================\n");
+    PRINT_INFO("[STAT]: %d series in %s\n", (int)series.size(), path.stem().string().c_str());
+    for (auto &entry : series) {
+      entry.second.calculate();
+      PRINT_INFO("rmse = %.4f | mean = %.4f | std = %.4f | max = %.4f (%s, %d samples)\n", entry.second.rmse, entry.second.mean,
+                 entry.second.std, entry.second.max, entry.first.c_str(), (int)entry.second.values.size());
+    }
+    files.push_back({path.stem().string(), series});
+  }
+  PRINT_INFO("======================================\n");
+
+#ifdef HAVE_PYTHONLIBS
+
+  // Plot each file as figures of three series per figure
+  for (auto &file : files) {
+    for (size_t i = 0; i < file.second.size(); i += 3) {
+      size_t num_subplots = std::min((size_t)3, file.second.size() - i);
+      matplotlibcpp::figure_size(1000, 600);
+      for (size_t j = 0; j < num_subplots; j++) {
+        matplotlibcpp::subplot((long)num_subplots, 1, (long)j + 1);
+        if (j == 0)
+          matplotlibcpp::title(file.first);
+        plot_series(file.second.at(i + j).second);
+        matplotlibcpp::ylabel(file.second.at(i + j).first);
+      }
+      matplotlibcpp::xlabel("dataset time (s)");
+      matplotlibcpp::tight_layout();
+      bool is_last = (&file == &files.back() && i + 3 >= file.second.size());
+      matplotlibcpp::show(is_last);
+    }
+  }
+
+#else
+
+  // No python means we can only print, the summary above is all we can do
+  PRINT_WARNING(YELLOW "[STAT]: matplotlib support was not compiled in, so no plots for you!\n" RESET);
+
+#endif
+
+  // Done!
+  return EXIT_SUCCESS;
+}
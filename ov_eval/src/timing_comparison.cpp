@@ -27,10 +27,13 @@
 #include <iostream>
 #include <string>
 
+#include "utils/BinaryStats.h"
+#include "utils/BinaryTiming.h"
 #include "utils/Loader.h"
 #include "utils/Statistics.h"
 #include "utils/colors.h"
 #include "utils/print.h"
+#include "utils/thread_pool.h"
 
 #ifdef HAVE_PYTHONLIBS
 
@@ -47,30 +50,55 @@ int main(int argc, char **argv) {
   ov_core::Printer::setPrintLevel("INFO");
 
   // Ensure we have a path
+  // An argument can also be a *folder* of timing logs (e.g. one run per vehicle),
+  // in which case all logs inside are merged into a single aggregate entry
   if (argc < 2) {
     PRINT_ERROR(RED "ERROR: Please specify a timing file\n" RESET);
-    PRINT_ERROR(RED "ERROR: ./timing_comparison <file_times1.txt> ... <file_timesN.txt>\n" RESET);
-    PRINT_ERROR(RED "ERROR: rosrun ov_eval timing_comparison <file_times1.txt> ... <file_timesN.txt>\n" RESET);
+    PRINT_ERROR(RED "ERROR: ./timing_comparison <file_times1.txt or folder> ... <file_timesN.txt or folder> [file_stats.ovs]\n" RESET);
+    PRINT_ERROR(RED "ERROR: rosrun ov_eval timing_comparison <file_times1.txt or folder> ... <file_timesN.txt or folder> [file_stats.ovs]\n" RESET);
     std::exit(EXIT_FAILURE);
   }
 
+  // Optional binary statistics export (re-plot later with plot_statistics)
+  std::string path_stats = ov_eval::BinaryStats::export_path(argc, argv);
+
+  // Create our thread pool (folder arguments ingest their files in parallel)
+  ov_core::ThreadPool::instance().configure((int)std::thread::hardware_concurrency(), {});
+
   // Read in all our trajectories from file
   std::vector<std::string> names;
   std::vector<ov_eval::Statistics> total_times;
   PRINT_INFO("======================================\n");
   for (int z = 1; z < argc; z++) {
 
+    // Skip the binary stats output path, it is not an input timing file
+    if (ov_eval::BinaryStats::has_binary_extension(argv[z]))
+      continue;
+
     // Parse the name of this timing
     boost::filesystem::path path(argv[z]);
     std::string name = path.stem().string();
     PRINT_INFO("[TIME]: loading data for %s\n", name.c_str());
 
     // Load it!!
+    // A folder is merged into one aggregate entry across all the logs it contains
     std::vector<std::string> names_temp;
     std::vector<double> times;
     std::vector<Eigen::VectorXd> timing_values;
-    ov_eval::Loader::load_timing_flamegraph(argv[z], names_temp, times, timing_values);
-    PRINT_DEBUG("[TIME]: loaded %d timestamps from file (%d categories)!!\n", (int)times.size(), (int)names_temp.size());
+    if (boost::filesystem::is_directory(path)) {
+      std::vector<std::string> files;
+      for (auto &p : boost::filesystem::recursive_directory_iterator(path)) {
+        if (p.path().extension() == ".txt" || ov_eval::BinaryTiming::has_binary_extension(p.path().string()))
+          files.push_back(p.path().string());
+      }
+      std::sort(files.begin(), files.end());
+      ov_eval::BinaryTiming::load_merged(files, names_temp, times, timing_values);
+      PRINT_DEBUG("[TIME]: merged %d timestamps from %d files (%d categories)!!\n", (int)times.size(), (int)files.size(),
+                  (int)names_temp.size());
+    } else {
+      ov_eval::Loader::load_timing_flamegraph(argv[z], names_temp, times, timing_values);
+      PRINT_DEBUG("[TIME]: loaded %d timestamps from file (%d categories)!!\n", (int)times.size(), (int)names_temp.size());
+    }
 
     // Our categories
     std::vector<ov_eval::Statistics> stats;
@@ -102,6 +130,15 @@ int main(int argc, char **argv) {
     PRINT_INFO("======================================\n");
   }
 
+  // Write the total time series of each run to file if the user gave us an output
+  if (!path_stats.empty()) {
+    std::vector<std::pair<std::string, ov_eval::Statistics>> stats_series;
+    for (size_t i = 0; i < names.size(); i++)
+      stats_series.push_back({names.at(i), total_times.at(i)});
+    ov_eval::BinaryStats::write(path_stats, stats_series);
+    PRINT_INFO("[STAT]: saved %d series to %s\n", (int)stats_series.size(), path_stats.c_str());
+  }
+
 #ifdef HAVE_PYTHONLIBS
 
   // Valid colors
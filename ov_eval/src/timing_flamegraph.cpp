@@ -20,12 +20,19 @@
  */
 
 #include <Eigen/Eigen>
+#include <algorithm>
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/foreach.hpp>
+#include <chrono>
+#include <csignal>
 #include <fstream>
 #include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
 #include <string>
+#include <thread>
 
 #include "utils/Loader.h"
 #include "utils/Statistics.h"
@@ -41,6 +48,214 @@
 
 #endif
 
+// Dataset seconds each heatmap column covers
+static const double WINDOW_SEC = 60.0;
+
+// How many samples each reservoir keeps (per stage, per window)
+static const size_t RESERVOIR_SIZE = 2048;
+
+// Set by SIGINT so a live tail can stop cleanly and still render its plots
+static volatile std::sig_atomic_t stop_requested = 0;
+static void handle_sigint(int /*signum*/) { stop_requested = 1; }
+
+/**
+ * Fixed-size uniform sample of a value stream (Vitter's Algorithm R).
+ * Lets us report stable percentiles over a multi-hour run without
+ * keeping every frame's timing in memory.
+ */
+struct Reservoir {
+  std::vector<double> samples;
+  size_t count = 0;
+  std::mt19937 gen = std::mt19937(0);
+  void insert(double value) {
+    count++;
+    if (samples.size() < RESERVOIR_SIZE) {
+      samples.push_back(value);
+      return;
+    }
+    std::uniform_int_distribution<size_t> dist(0, count - 1);
+    size_t j = dist(gen);
+    if (j < RESERVOIR_SIZE)
+      samples[j] = value;
+  }
+  double percentile(double p) const {
+    if (samples.empty())
+      return 0.0;
+    std::vector<double> sorted = samples;
+    size_t idx = (size_t)(p * (double)(sorted.size() - 1));
+    std::nth_element(sorted.begin(), sorted.begin() + idx, sorted.end());
+    return sorted[idx];
+  }
+};
+
+#ifdef HAVE_PYTHONLIBS
+
+/**
+ * Render p50/p95/p99 heatmaps (stages on the y-axis, dataset-time windows on
+ * the x-axis) so latency drift over a long run is visible at a glance.
+ */
+static void plot_percentile_heatmaps(const std::vector<std::string> &names, const std::map<int, std::vector<Reservoir>> &windows) {
+
+  // Nothing recorded yet
+  if (windows.empty())
+    return;
+  int num_windows = windows.rbegin()->first + 1;
+  int num_stages = (int)names.size();
+
+  // Build the three stage-by-window images (row major, empty windows stay zero)
+  std::vector<double> percentiles = {0.50, 0.95, 0.99};
+  std::vector<std::string> titles = {"p50", "p95", "p99"};
+  std::vector<std::vector<float>> images(3, std::vector<float>(num_stages * num_windows, 0.0f));
+  for (const auto &window : windows) {
+    for (int c = 0; c < num_stages; c++) {
+      for (size_t p = 0; p < percentiles.size(); p++) {
+        images.at(p).at(c * num_windows + window.first) = (float)window.second.at(c).percentile(percentiles.at(p));
+      }
+    }
+  }
+
+  // Stage names label the rows
+  std::vector<double> yticks;
+  for (int c = 0; c < num_stages; c++)
+    yticks.push_back(c);
+
+  // One subplot per percentile
+  matplotlibcpp::figure_size(1200, 800);
+  for (size_t p = 0; p < percentiles.size(); p++) {
+    matplotlibcpp::subplot(3, 1, (long)p + 1);
+    matplotlibcpp::imshow(images.at(p).data(), num_stages, num_windows, 1,
+                          {{"aspect", "auto"}, {"cmap", "inferno"}, {"interpolation", "nearest"}});
+    matplotlibcpp::yticks(yticks, names);
+    matplotlibcpp::title(titles.at(p) + " latency per stage (s)");
+  }
+  matplotlibcpp::xlabel("dataset time window (" + std::to_string((int)WINDOW_SEC) + " sec each)");
+  matplotlibcpp::tight_layout();
+  matplotlibcpp::show(true);
+}
+
+#endif
+
+/**
+ * Tail a timing file of a run still in progress, keeping reservoir-sampled
+ * percentiles per pipeline stage (global and per dataset-time window). A
+ * percentile table is printed periodically, and when the tail ends (ctrl+c or
+ * the file going quiet) the windowed heatmaps are rendered.
+ */
+static void run_live(const std::string &path) {
+
+  // Wait for the file to exist (the run may not have opened it yet)
+  std::ifstream file(path);
+  while (!file.is_open() && !stop_requested) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(250));
+    file.open(path);
+  }
+  if (!file.is_open())
+    return;
+  PRINT_INFO("[TIME]: tailing %s (ctrl+c to stop and plot)\n", path.c_str());
+
+  // Per-stage state (filled once the header line arrives)
+  std::vector<std::string> names;
+  std::vector<Reservoir> reservoirs;
+  std::map<int, std::vector<Reservoir>> windows;
+  double first_time = -1;
+  size_t num_frames = 0;
+
+  // Consume one complete line from the file
+  auto process_line = [&](const std::string &line) {
+    // Header gives us the stage names (first field is just the timestamp)
+    if (!line.find("#")) {
+      std::istringstream s(line);
+      std::string field;
+      names.clear();
+      bool skipped_first = false;
+      while (std::getline(s, field, ',')) {
+        if (field.empty())
+          continue;
+        if (skipped_first)
+          names.push_back(field);
+        skipped_first = true;
+      }
+      reservoirs.assign(names.size(), Reservoir());
+      return;
+    }
+    // Data row: timestamp then one value per stage
+    std::istringstream s(line);
+    std::string field;
+    std::vector<double> vec;
+    while (std::getline(s, field, ',')) {
+      if (field.empty())
+        continue;
+      vec.push_back(std::atof(field.c_str()));
+    }
+    if (names.empty() || vec.size() != names.size() + 1)
+      return;
+    if (first_time < 0)
+      first_time = vec.at(0);
+    int window_idx = (int)((vec.at(0) - first_time) / WINDOW_SEC);
+    if (windows.find(window_idx) == windows.end())
+      windows.insert({window_idx, std::vector<Reservoir>(names.size(), Reservoir())});
+    for (size_t c = 0; c < names.size(); c++) {
+      reservoirs.at(c).insert(vec.at(c + 1));
+      windows.at(window_idx).at(c).insert(vec.at(c + 1));
+    }
+    num_frames++;
+  };
+
+  // Tail loop: read whatever complete lines have been appended, then sleep.
+  // A line without a trailing newline is a torn write, keep it for next pass.
+  std::string partial, chunk;
+  auto last_data = std::chrono::steady_clock::now();
+  auto last_report = std::chrono::steady_clock::now();
+  while (!stop_requested) {
+
+    // Drain all currently available lines
+    bool got_data = false;
+    while (std::getline(file, chunk)) {
+      if (file.eof()) {
+        partial += chunk;
+        break;
+      }
+      process_line(partial + chunk);
+      partial.clear();
+      got_data = true;
+    }
+    file.clear();
+
+    // Track idleness and bail if the run looks finished
+    auto now = std::chrono::steady_clock::now();
+    if (got_data)
+      last_data = now;
+    if (std::chrono::duration_cast<std::chrono::seconds>(now - last_data).count() > 30) {
+      PRINT_INFO("[TIME]: no new data for 30 seconds, assuming the run has finished\n");
+      break;
+    }
+
+    // Periodic percentile table, plus drift of the newest window vs the first
+    if (num_frames > 0 && std::chrono::duration_cast<std::chrono::seconds>(now - last_report).count() >= 5) {
+      last_report = now;
+      PRINT_INFO("=======================================================\n");
+      PRINT_INFO("[TIME]: %d frames over %d windows\n", (int)num_frames, (int)windows.size());
+      for (size_t c = 0; c < names.size(); c++) {
+        PRINT_INFO("p50 = %.4f | p95 = %.4f | p99 = %.4f (%s)\n", reservoirs.at(c).percentile(0.50), reservoirs.at(c).percentile(0.95),
+                   reservoirs.at(c).percentile(0.99), names.at(c).c_str());
+      }
+      if (windows.size() > 1) {
+        double p95_first = windows.begin()->second.back().percentile(0.95);
+        double p95_now = windows.rbegin()->second.back().percentile(0.95);
+        PRINT_INFO("total p95 drift = %+.4f sec (first window %.4f -> current %.4f)\n", p95_now - p95_first, p95_first, p95_now);
+      }
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(250));
+  }
+
+  // Done tailing, show what we collected
+  file.close();
+  PRINT_INFO("[TIME]: tail finished with %d frames (%d categories)!!\n", (int)num_frames, (int)names.size());
+#ifdef HAVE_PYTHONLIBS
+  plot_percentile_heatmaps(names, windows);
+#endif
+}
+
 int main(int argc, char **argv) {
 
   // Verbosity setting
@@ -49,15 +264,22 @@ int main(int argc, char **argv) {
   // Ensure we have a path
   if (argc < 2) {
     PRINT_ERROR(RED "ERROR: Please specify a timing file\n" RESET);
-    PRINT_ERROR(RED "ERROR: ./timing_flamegraph <file_times.txt> <subsample>\n" RESET);
-    PRINT_ERROR(RED "ERROR: rosrun ov_eval timing_flamegraph <file_times.txt> <subsample>\n" RESET);
+    PRINT_ERROR(RED "ERROR: ./timing_flamegraph <file_times.txt> <subsample> [live]\n" RESET);
+    PRINT_ERROR(RED "ERROR: rosrun ov_eval timing_flamegraph <file_times.txt> <subsample> [live]\n" RESET);
     std::exit(EXIT_FAILURE);
   }
   int keep_every = 10;
-  if (argc == 3) {
+  if (argc >= 3) {
     keep_every = atoi(argv[2]);
   }
 
+  // Live mode: tail the file as the run writes it
+  if (argc >= 4 && std::string(argv[3]) == "live") {
+    std::signal(SIGINT, handle_sigint);
+    run_live(argv[1]);
+    return EXIT_SUCCESS;
+  }
+
   // Load it!!
   std::vector<std::string> names;
   std::vector<double> times;
@@ -71,10 +293,16 @@ int main(int argc, char **argv) {
     stats.push_back(ov_eval::Statistics());
 
   // Loop through each and report the average timing information
+  // Also feed the windowed reservoirs so we can render the percentile heatmaps
+  std::map<int, std::vector<Reservoir>> windows;
   for (size_t i = 0; i < times.size(); i++) {
+    int window_idx = (int)((times.at(i) - times.at(0)) / WINDOW_SEC);
+    if (windows.find(window_idx) == windows.end())
+      windows.insert({window_idx, std::vector<Reservoir>(names.size(), Reservoir())});
     for (size_t c = 0; c < names.size(); c++) {
       stats.at(c).timestamps.push_back(times.at(i));
       stats.at(c).values.push_back(timing_values.at(i)(c));
+      windows.at(window_idx).at(c).insert(timing_values.at(i)(c));
     }
   }
 
@@ -138,6 +366,9 @@ int main(int argc, char **argv) {
   // Display to the user
   matplotlibcpp::show(true);
 
+  // Follow up with the windowed percentile heatmaps
+  plot_percentile_heatmaps(names, windows);
+
 #endif
 
   // Done!
@@ -27,6 +27,7 @@
 #include <iostream>
 #include <string>
 
+#include "utils/BinaryStats.h"
 #include "utils/Loader.h"
 #include "utils/Statistics.h"
 #include "utils/colors.h"
@@ -49,12 +50,15 @@ int main(int argc, char **argv) {
   // Ensure we have a path
   if (argc < 3) {
     PRINT_ERROR(RED "ERROR: Please specify a timing file\n" RESET);
-    PRINT_ERROR(RED "ERROR: ./timing_histagram <file_times.txt> <num_bins>\n" RESET);
-    PRINT_ERROR(RED "ERROR: rosrun ov_eval timing_flamegraph <file_times.txt> <num_bins>\n" RESET);
+    PRINT_ERROR(RED "ERROR: ./timing_histagram <file_times.txt> <num_bins> [file_stats.ovs]\n" RESET);
+    PRINT_ERROR(RED "ERROR: rosrun ov_eval timing_flamegraph <file_times.txt> <num_bins> [file_stats.ovs]\n" RESET);
     std::exit(EXIT_FAILURE);
   }
   int nbins = atoi(argv[2]);
 
+  // Optional binary statistics export (re-plot later with plot_statistics)
+  std::string path_stats = ov_eval::BinaryStats::export_path(argc, argv);
+
   // Load it!!
   std::vector<std::string> names;
   std::vector<double> times;
@@ -75,6 +79,15 @@ int main(int argc, char **argv) {
     }
   }
 
+  // Write each category series to file if the user gave us a binary stats output
+  if (!path_stats.empty()) {
+    std::vector<std::pair<std::string, ov_eval::Statistics>> stats_series;
+    for (size_t i = 0; i < names.size(); i++)
+      stats_series.push_back({names.at(i), stats.at(i)});
+    ov_eval::BinaryStats::write(path_stats, stats_series);
+    PRINT_INFO("[STAT]: saved %d series to %s\n", (int)stats_series.size(), path_stats.c_str());
+  }
+
 #ifdef HAVE_PYTHONLIBS
 
   // Valid colors
@@ -27,6 +27,7 @@
 #include <iostream>
 #include <string>
 
+#include "utils/BinaryStats.h"
 #include "utils/Loader.h"
 #include "utils/Statistics.h"
 #include "utils/colors.h"
@@ -49,11 +50,14 @@ int main(int argc, char **argv) {
   // Ensure we have a path
   if (argc < 2) {
     PRINT_ERROR(RED "ERROR: Please specify a timing and memory percent folder\n" RESET);
-    PRINT_ERROR(RED "ERROR: ./timing_percentages <timings_folder>\n" RESET);
-    PRINT_ERROR(RED "ERROR: rosrun ov_eval timing_percentages <timings_folder>\n" RESET);
+    PRINT_ERROR(RED "ERROR: ./timing_percentages <timings_folder> [file_stats.ovs]\n" RESET);
+    PRINT_ERROR(RED "ERROR: rosrun ov_eval timing_percentages <timings_folder> [file_stats.ovs]\n" RESET);
     std::exit(EXIT_FAILURE);
   }
 
+  // Optional binary statistics export (re-plot later with plot_statistics)
+  std::string path_stats = ov_eval::BinaryStats::export_path(argc, argv);
+
   // Get the algorithms we will process
   // Also create empty statistic objects for each of our datasets
   std::string path_algos(argv[1]);
@@ -135,6 +139,18 @@ int main(int argc, char **argv) {
   //===============================================================================
   //===============================================================================
 
+  // Write the cpu, memory, and thread series of each algorithm if the user gave us an output
+  if (!path_stats.empty()) {
+    std::vector<std::pair<std::string, ov_eval::Statistics>> stats_series;
+    for (const auto &algo : algo_timings) {
+      stats_series.push_back({algo.first + "_cpu", algo.second.at(0)});
+      stats_series.push_back({algo.first + "_mem", algo.second.at(1)});
+      stats_series.push_back({algo.first + "_threads", algo.second.at(2)});
+    }
+    ov_eval::BinaryStats::write(path_stats, stats_series);
+    PRINT_INFO("[STAT]: saved %d series to %s\n", (int)stats_series.size(), path_stats.c_str());
+  }
+
 #ifdef HAVE_PYTHONLIBS
 
   // Plot line colors
@@ -0,0 +1,114 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2018-2023 Patrick Geneva
+ * Copyright (C) 2018-2023 Guoquan Huang
+ * Copyright (C) 2018-2023 OpenVINS Contributors
+ * Copyright (C) 2018-2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "BinaryState.h"
+
+#include <cstring>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace ov_eval;
+
+// Magic at the start of every binary state file
+// Starts with '#' and ends with a newline so text parsers see one comment line
+static const char BINARY_MAGIC[8] = {'#', 'O', 'V', 'S', 'B', 'I', 'N', '\n'};
+static const uint32_t BINARY_VERSION = 1;
+static const size_t HEADER_SIZE = sizeof(BINARY_MAGIC) + 2 * sizeof(uint32_t);
+
+bool BinaryState::is_binary(const std::string &path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open())
+    return false;
+  char magic[8] = {0};
+  file.read(magic, sizeof(magic));
+  return file.good() && std::memcmp(magic, BINARY_MAGIC, sizeof(magic)) == 0;
+}
+
+bool BinaryState::read(const std::string &path, std::vector<Eigen::VectorXd> &values) {
+
+  // Get the raw file contents, preferring a memory mapping so we only fault in
+  // the pages we touch (same as BinaryTrajectory::read)
+  const char *data = nullptr;
+  size_t size = 0;
+  bool mapped = false;
+  std::string contents;
+#if defined(__unix__) || defined(__APPLE__)
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd >= 0) {
+    struct stat sb;
+    if (fstat(fd, &sb) == 0 && sb.st_size > 0) {
+      void *mem = mmap(nullptr, (size_t)sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (mem != MAP_FAILED) {
+        data = (const char *)mem;
+        size = (size_t)sb.st_size;
+        mapped = true;
+      }
+    }
+    close(fd);
+  }
+#endif
+  if (!mapped) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+      return false;
+    contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    data = contents.data();
+    size = contents.size();
+  }
+
+  // Validate the header, the record count is whatever fits in the file
+  // A partial trailing record (e.g. from a crashed run) is silently dropped
+  uint32_t version = 0, values_per_record = 0;
+  bool valid = (size >= HEADER_SIZE && std::memcmp(data, BINARY_MAGIC, sizeof(BINARY_MAGIC)) == 0);
+  if (valid) {
+    std::memcpy(&version, data + 8, sizeof(uint32_t));
+    std::memcpy(&values_per_record, data + 12, sizeof(uint32_t));
+    valid = (version == BINARY_VERSION && values_per_record > 0);
+  }
+
+  // Copy out each fixed-stride record
+  if (valid) {
+    size_t stride = values_per_record * sizeof(double);
+    size_t num_records = (size - HEADER_SIZE) / stride;
+    values.reserve(values.size() + num_records);
+    const char *ptr = data + HEADER_SIZE;
+    for (size_t i = 0; i < num_records; i++) {
+      Eigen::VectorXd temp(values_per_record);
+      std::memcpy(temp.data(), ptr, stride);
+      values.push_back(temp);
+      ptr += stride;
+    }
+  } else {
+    PRINT_ERROR(RED "[LOAD]: Invalid binary state file!\n" RESET);
+    PRINT_ERROR(RED "[LOAD]: %s\n" RESET, path.c_str());
+  }
+
+#if defined(__unix__) || defined(__APPLE__)
+  if (mapped)
+    munmap((void *)data, size);
+#endif
+  return valid;
+}
@@ -0,0 +1,80 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2018-2023 Patrick Geneva
+ * Copyright (C) 2018-2023 Guoquan Huang
+ * Copyright (C) 2018-2023 OpenVINS Contributors
+ * Copyright (C) 2018-2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OV_EVAL_BINARYSTATE_H
+#define OV_EVAL_BINARYSTATE_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <Eigen/Eigen>
+
+#include "utils/colors.h"
+#include "utils/print.h"
+
+namespace ov_eval {
+
+/**
+ * @brief Compact binary state history container.
+ *
+ * The binary counterpart of the simulation "total state" text files which the
+ * estimator writes when the configured filepaths end in ".ovb" (see
+ * ov_msckf::ROSVisualizerHelper::sim_save_total_state_to_binary). The columns
+ * are identical to the text format, stored as fixed-stride records of doubles:
+ *
+ * - 16 byte header: 8 byte magic "#OVSBIN\n", uint32 version, uint32 values
+ *   per record
+ * - records: values doubles each in host order, until the end of the file
+ *
+ * Unlike ov_eval::BinaryTrajectory there is no record count in the header: the
+ * writer appends records after each filter update and never seeks back, so the
+ * count is derived from the file size and a file from a crashed run loads up
+ * to its last complete record. Loader::load_simulation() sniffs the magic, so
+ * ResultSimulation and friends consume text and binary runs interchangeably.
+ */
+class BinaryState {
+
+public:
+  /**
+   * @brief Checks if the given file starts with our binary magic
+   * @param path File to sniff
+   * @return True if this is a binary state file
+   */
+  static bool is_binary(const std::string &path);
+
+  /**
+   * @brief Reads a binary state file (the binary equivalent of Loader::load_simulation)
+   * @param path File we will try to memory-map and read
+   * @param values One vector per record with the same columns as the text format
+   * @return True if the file was read successfully
+   */
+  static bool read(const std::string &path, std::vector<Eigen::VectorXd> &values);
+
+private:
+  // Cannot create this class
+  BinaryState() = default;
+};
+
+} // namespace ov_eval
+
+#endif // OV_EVAL_BINARYSTATE_H
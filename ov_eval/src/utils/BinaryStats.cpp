@@ -0,0 +1,132 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2018-2023 Patrick Geneva
+ * Copyright (C) 2018-2023 Guoquan Huang
+ * Copyright (C) 2018-2023 OpenVINS Contributors
+ * Copyright (C) 2018-2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "BinaryStats.h"
+
+#include <cstring>
+
+using namespace ov_eval;
+
+// Magic at the start of every binary statistics file
+// Starts with '#' and ends with a newline so text parsers see one comment line
+static const char BINARY_MAGIC[8] = {'#', 'O', 'V', 'S', 'T', 'A', 'T', '\n'};
+static const uint32_t BINARY_VERSION = 1;
+
+/// Writes one double vector as a uint64 count followed by the raw values
+static void write_vector(std::ofstream &file, const std::vector<double> &values) {
+  uint64_t count = (uint64_t)values.size();
+  file.write((const char *)&count, sizeof(uint64_t));
+  if (!values.empty())
+    file.write((const char *)values.data(), values.size() * sizeof(double));
+}
+
+/// Reads one double vector back, returns false if the stream runs out
+static bool read_vector(std::ifstream &file, std::vector<double> &values) {
+  uint64_t count = 0;
+  file.read((char *)&count, sizeof(uint64_t));
+  if (!file.good())
+    return false;
+  values.resize(count);
+  if (count > 0)
+    file.read((char *)values.data(), count * sizeof(double));
+  return file.good();
+}
+
+bool BinaryStats::has_binary_extension(const std::string &path) {
+  std::string ext = ".ovs";
+  return path.size() >= ext.size() && path.compare(path.size() - ext.size(), ext.size(), ext) == 0;
+}
+
+bool BinaryStats::is_binary(const std::string &path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open())
+    return false;
+  char magic[8] = {0};
+  file.read(magic, sizeof(magic));
+  return file.good() && std::memcmp(magic, BINARY_MAGIC, sizeof(magic)) == 0;
+}
+
+std::string BinaryStats::export_path(int argc, char **argv) {
+  for (int i = 1; i < argc; i++) {
+    if (has_binary_extension(argv[i]))
+      return argv[i];
+  }
+  return "";
+}
+
+bool BinaryStats::read(const std::string &path, std::vector<std::pair<std::string, Statistics>> &series) {
+
+  // Validate the header magic and version
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open())
+    return false;
+  char magic[8] = {0};
+  file.read(magic, sizeof(magic));
+  if (!file.good() || std::memcmp(magic, BINARY_MAGIC, sizeof(magic)) != 0)
+    return false;
+  uint32_t version = 0, num_series = 0;
+  file.read((char *)&version, sizeof(uint32_t));
+  file.read((char *)&num_series, sizeof(uint32_t));
+  if (!file.good() || version != BINARY_VERSION)
+    return false;
+
+  // Each series is its name followed by the three raw vectors
+  for (uint32_t i = 0; i < num_series; i++) {
+    uint32_t name_size = 0;
+    file.read((char *)&name_size, sizeof(uint32_t));
+    if (!file.good())
+      return false;
+    std::string name(name_size, '\0');
+    if (name_size > 0)
+      file.read(&name[0], name_size);
+    Statistics stat;
+    if (!file.good() || !read_vector(file, stat.timestamps) || !read_vector(file, stat.values) || !read_vector(file, stat.values_bound))
+      return false;
+    series.push_back({name, stat});
+  }
+  return true;
+}
+
+void BinaryStats::write(const std::string &path, const std::vector<std::pair<std::string, Statistics>> &series) {
+
+  // Open the output and write the header
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  if (file.fail()) {
+    PRINT_ERROR(RED "[LOAD]: Unable to open binary statistics file for writing!!\n" RESET);
+    PRINT_ERROR(RED "[LOAD]: %s\n" RESET, path.c_str());
+    std::exit(EXIT_FAILURE);
+  }
+  file.write(BINARY_MAGIC, sizeof(BINARY_MAGIC));
+  uint32_t num_series = (uint32_t)series.size();
+  file.write((const char *)&BINARY_VERSION, sizeof(uint32_t));
+  file.write((const char *)&num_series, sizeof(uint32_t));
+
+  // Then each named series with its three raw vectors
+  for (const auto &entry : series) {
+    uint32_t name_size = (uint32_t)entry.first.size();
+    file.write((const char *)&name_size, sizeof(uint32_t));
+    file.write(entry.first.data(), name_size);
+    write_vector(file, entry.second.timestamps);
+    write_vector(file, entry.second.values);
+    write_vector(file, entry.second.values_bound);
+  }
+  file.close();
+}
@@ -0,0 +1,98 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2018-2023 Patrick Geneva
+ * Copyright (C) 2018-2023 Guoquan Huang
+ * Copyright (C) 2018-2023 OpenVINS Contributors
+ * Copyright (C) 2018-2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OV_EVAL_BINARYSTATS_H
+#define OV_EVAL_BINARYSTATS_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "utils/Statistics.h"
+#include "utils/colors.h"
+#include "utils/print.h"
+
+namespace ov_eval {
+
+/**
+ * @brief Compact binary container for named Statistics series.
+ *
+ * When the evaluation tools are built headless (DISABLE_MATPLOTLIB or no python libs)
+ * their computed error and timing curves used to only survive as console summaries,
+ * so re-plotting a nightly CI run meant re-running the whole evaluation with python
+ * enabled. This container lets a tool dump every Statistics series it computed
+ * (timestamps, values, and 3-sigma bounds) so the standalone plot_statistics viewer
+ * can render them later on a machine that does have matplotlib:
+ *
+ * - 16 byte header: 8 byte magic "#OVSTAT\n", uint32 version, uint32 series count
+ * - per series: uint32 name size, name bytes, then uint64 counts for the timestamp,
+ *   value, and bound vectors followed by each vector as raw doubles in host order
+ *
+ * Tools that support exporting scan their command line for a trailing ".ovs" path
+ * (see export_path), so the export is a pure opt-in that does not disturb the
+ * existing positional arguments.
+ */
+class BinaryStats {
+
+public:
+  /// File extension we write binary statistics files under
+  static bool has_binary_extension(const std::string &path);
+
+  /**
+   * @brief Checks if the given file starts with our binary magic
+   * @param path File to sniff
+   * @return True if this is a binary statistics file
+   */
+  static bool is_binary(const std::string &path);
+
+  /**
+   * @brief Scans the command line for an output path with our extension.
+   *
+   * Tools call this once at startup so users can append e.g. "results.ovs" to any
+   * invocation to get a binary export alongside the normal console output.
+   *
+   * @param argc Argument count from main
+   * @param argv Argument values from main
+   * @return The first argument ending in our extension, or empty if none was given
+   */
+  static std::string export_path(int argc, char **argv);
+
+  /**
+   * @brief Reads a binary statistics file
+   * @param path File we will read
+   * @param series Name and statistics data of each stored series (appended to)
+   * @return True on success, false if the file could not be opened or is malformed
+   */
+  static bool read(const std::string &path, std::vector<std::pair<std::string, Statistics>> &series);
+
+  /**
+   * @brief Writes the given named series to a binary file
+   * @param path Output file (overwritten if it exists)
+   * @param series Name and statistics data of each series to store
+   */
+  static void write(const std::string &path, const std::vector<std::pair<std::string, Statistics>> &series);
+};
+
+} // namespace ov_eval
+
+#endif // OV_EVAL_BINARYSTATS_H
@@ -0,0 +1,244 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2018-2023 Patrick Geneva
+ * Copyright (C) 2018-2023 Guoquan Huang
+ * Copyright (C) 2018-2023 OpenVINS Contributors
+ * Copyright (C) 2018-2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "BinaryTiming.h"
+
+#include <cstring>
+#include <sstream>
+
+#include "Loader.h"
+#include "utils/thread_pool.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace ov_eval;
+
+// Magic at the start of every binary timing file
+// Starts with '#' and ends with a newline so text parsers see one comment line
+static const char BINARY_MAGIC[8] = {'#', 'O', 'V', 'T', 'I', 'M', 'B', '\n'};
+static const uint32_t BINARY_VERSION = 1;
+static const size_t HEADER_SIZE = sizeof(BINARY_MAGIC) + 2 * sizeof(uint32_t) + sizeof(uint64_t) + sizeof(uint32_t);
+
+/// Serializes the 28-byte header into the given buffer
+static void build_header(char *buffer, uint32_t values_per_record, uint64_t num_records, uint32_t names_size) {
+  std::memcpy(buffer, BINARY_MAGIC, sizeof(BINARY_MAGIC));
+  std::memcpy(buffer + 8, &BINARY_VERSION, sizeof(uint32_t));
+  std::memcpy(buffer + 12, &values_per_record, sizeof(uint32_t));
+  std::memcpy(buffer + 16, &num_records, sizeof(uint64_t));
+  std::memcpy(buffer + 24, &names_size, sizeof(uint32_t));
+}
+
+/// Parses the header fields out of a raw buffer, returns false if invalid
+static bool parse_header(const char *data, size_t size, uint32_t &values_per_record, uint64_t &num_records, uint32_t &names_size) {
+  if (size < HEADER_SIZE || std::memcmp(data, BINARY_MAGIC, sizeof(BINARY_MAGIC)) != 0)
+    return false;
+  uint32_t version = 0;
+  std::memcpy(&version, data + 8, sizeof(uint32_t));
+  std::memcpy(&values_per_record, data + 12, sizeof(uint32_t));
+  std::memcpy(&num_records, data + 16, sizeof(uint64_t));
+  std::memcpy(&names_size, data + 24, sizeof(uint32_t));
+  return (version == BINARY_VERSION && values_per_record >= 1 &&
+          size >= HEADER_SIZE + names_size + num_records * values_per_record * sizeof(double));
+}
+
+/// Splits the '\n' joined name table back into individual names
+static void split_names(const char *table, uint32_t names_size, std::vector<std::string> &names) {
+  names.clear();
+  std::string current;
+  for (uint32_t i = 0; i < names_size; i++) {
+    if (table[i] == '\n') {
+      names.push_back(current);
+      current.clear();
+    } else {
+      current.push_back(table[i]);
+    }
+  }
+  if (!current.empty())
+    names.push_back(current);
+}
+
+bool BinaryTiming::has_binary_extension(const std::string &path) {
+  std::string ext = ".ovt";
+  return path.size() >= ext.size() && path.compare(path.size() - ext.size(), ext.size(), ext) == 0;
+}
+
+bool BinaryTiming::is_binary(const std::string &path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open())
+    return false;
+  char magic[8] = {0};
+  file.read(magic, sizeof(magic));
+  return file.good() && std::memcmp(magic, BINARY_MAGIC, sizeof(magic)) == 0;
+}
+
+bool BinaryTiming::read_names(const std::string &path, std::vector<std::string> &names, uint64_t &num_records) {
+
+  // Only the header and name table are read here, the record pages stay untouched
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open())
+    return false;
+  char header[HEADER_SIZE];
+  file.read(header, sizeof(header));
+  if (!file.good() || std::memcmp(header, BINARY_MAGIC, sizeof(BINARY_MAGIC)) != 0)
+    return false;
+  uint32_t version = 0, values_per_record = 0, names_size = 0;
+  std::memcpy(&version, header + 8, sizeof(uint32_t));
+  std::memcpy(&values_per_record, header + 12, sizeof(uint32_t));
+  std::memcpy(&num_records, header + 16, sizeof(uint64_t));
+  std::memcpy(&names_size, header + 24, sizeof(uint32_t));
+  if (version != BINARY_VERSION || values_per_record < 1)
+    return false;
+  std::vector<char> table(names_size);
+  file.read(table.data(), names_size);
+  if (!file.good() && names_size > 0)
+    return false;
+  split_names(table.data(), names_size, names);
+  return true;
+}
+
+bool BinaryTiming::read(const std::string &path, std::vector<std::string> &names, std::vector<double> &times,
+                        std::vector<Eigen::VectorXd> &timing_values) {
+
+  // Get the raw file contents, preferring a memory mapping so we only fault in
+  // the pages we touch (see Loader::stream_values which does the same for text)
+  const char *data = nullptr;
+  size_t size = 0;
+  bool mapped = false;
+  std::string contents;
+#if defined(__unix__) || defined(__APPLE__)
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd >= 0) {
+    struct stat sb;
+    if (fstat(fd, &sb) == 0 && sb.st_size > 0) {
+      void *mem = mmap(nullptr, (size_t)sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (mem != MAP_FAILED) {
+        data = (const char *)mem;
+        size = (size_t)sb.st_size;
+        mapped = true;
+      }
+    }
+    close(fd);
+  }
+#endif
+  if (!mapped) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+      return false;
+    contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    data = contents.data();
+    size = contents.size();
+  }
+
+  // Validate the header and that the file is big enough for what it claims
+  uint32_t values_per_record = 0, names_size = 0;
+  uint64_t num_records = 0;
+  bool valid = parse_header(data, size, values_per_record, num_records, names_size);
+
+  // Copy out the name table and each fixed-stride record
+  if (valid) {
+    split_names(data + HEADER_SIZE, names_size, names);
+    times.reserve(times.size() + num_records);
+    timing_values.reserve(timing_values.size() + num_records);
+    const char *ptr = data + HEADER_SIZE + names_size;
+    for (uint64_t i = 0; i < num_records; i++) {
+      double timestamp = 0;
+      std::memcpy(&timestamp, ptr, sizeof(double));
+      Eigen::VectorXd values(values_per_record - 1);
+      std::memcpy(values.data(), ptr + sizeof(double), (values_per_record - 1) * sizeof(double));
+      ptr += values_per_record * sizeof(double);
+      times.push_back(timestamp);
+      timing_values.push_back(values);
+    }
+  }
+
+#if defined(__unix__) || defined(__APPLE__)
+  if (mapped)
+    munmap((void *)data, size);
+#endif
+  return valid;
+}
+
+void BinaryTiming::write(const std::string &path, const std::vector<std::string> &names, const std::vector<double> &times,
+                         const std::vector<Eigen::VectorXd> &timing_values) {
+
+  // Sanity check that all our vectors are in sync
+  assert(times.size() == timing_values.size());
+  assert(!timing_values.empty());
+  assert(names.empty() || (int)names.size() == timing_values.at(0).rows());
+
+  // Join the names into the table (a trailing '\n' after each keeps parsing simple)
+  std::string table;
+  for (const auto &name : names)
+    table += name + "\n";
+
+  // Open the output and write the final header directly since we know the count
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  if (file.fail()) {
+    PRINT_ERROR(RED "[LOAD]: Unable to open binary timing file for writing!!\n" RESET);
+    PRINT_ERROR(RED "[LOAD]: %s\n" RESET, path.c_str());
+    std::exit(EXIT_FAILURE);
+  }
+  uint32_t values_per_record = 1 + (uint32_t)timing_values.at(0).rows();
+  char header[HEADER_SIZE];
+  build_header(header, values_per_record, (uint64_t)times.size(), (uint32_t)table.size());
+  file.write(header, sizeof(header));
+  file.write(table.data(), table.size());
+
+  // Then the fixed-stride records followed by the timestamp index
+  for (size_t i = 0; i < times.size(); i++) {
+    assert(timing_values.at(i).rows() == (int)(values_per_record - 1));
+    file.write((const char *)&times.at(i), sizeof(double));
+    file.write((const char *)timing_values.at(i).data(), (values_per_record - 1) * sizeof(double));
+  }
+  if (!times.empty())
+    file.write((const char *)times.data(), times.size() * sizeof(double));
+  file.close();
+}
+
+void BinaryTiming::load_merged(const std::vector<std::string> &paths, std::vector<std::string> &names, std::vector<double> &times,
+                               std::vector<Eigen::VectorXd> &timing_values) {
+
+  // Ingest each file as its own task, into fixed per-file slots so the merge
+  // below is deterministic no matter how the tasks interleave
+  std::vector<std::vector<std::string>> file_names(paths.size());
+  std::vector<std::vector<double>> file_times(paths.size());
+  std::vector<std::vector<Eigen::VectorXd>> file_values(paths.size());
+  ov_core::ThreadPool::instance().parallel_for(0, (int)paths.size(), [&](int i) {
+    Loader::load_timing_flamegraph(paths.at(i), file_names.at(i), file_times.at(i), file_values.at(i));
+  });
+
+  // Append in path order, skipping any file whose categories do not line up
+  for (size_t i = 0; i < paths.size(); i++) {
+    if (names.empty())
+      names = file_names.at(i);
+    if (file_names.at(i) != names) {
+      PRINT_WARNING(YELLOW "[LOAD]: categories of %s do not match the first file, skipping!!\n" RESET, paths.at(i).c_str());
+      continue;
+    }
+    times.insert(times.end(), file_times.at(i).begin(), file_times.at(i).end());
+    timing_values.insert(timing_values.end(), file_values.at(i).begin(), file_values.at(i).end());
+  }
+}
@@ -0,0 +1,123 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2018-2023 Patrick Geneva
+ * Copyright (C) 2018-2023 Guoquan Huang
+ * Copyright (C) 2018-2023 OpenVINS Contributors
+ * Copyright (C) 2018-2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OV_EVAL_BINARYTIMING_H
+#define OV_EVAL_BINARYTIMING_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <Eigen/Eigen>
+
+#include "utils/colors.h"
+#include "utils/print.h"
+
+namespace ov_eval {
+
+/**
+ * @brief Compact binary timing log container.
+ *
+ * The timing tools (timing_histogram, timing_percentages, timing_comparison) all go
+ * through the Loader text parsers, which re-scan every number on every load and become
+ * the bottleneck once more than a handful of large logs are involved. This is the
+ * timing counterpart of BinaryTrajectory: the same rows as the text format stored in
+ * fixed-stride binary records so a file loads with straight copies, laid out so the
+ * cheap questions (what categories, how many records) only touch the header:
+ *
+ * - 28 byte header: 8 byte magic "#OVTIMB\n", uint32 version, uint32 values per
+ *   record (timestamp + value columns), uint64 record count, uint32 name table size
+ * - name table: the category names joined by '\n' (empty for files whose columns
+ *   have no names, e.g. the percent logs)
+ * - records: count * values doubles in host order, columns matching the text format
+ * - index: count doubles of just the timestamps at the tail of the file
+ *
+ * Both Loader timing parsers sniff the magic, so binary and text logs can be mixed
+ * freely, and format_converter can convert between the two ("timing" mode).
+ */
+class BinaryTiming {
+
+public:
+  /// File extension we write binary timing logs under
+  static bool has_binary_extension(const std::string &path);
+
+  /**
+   * @brief Checks if the given file starts with our binary magic
+   * @param path File to sniff
+   * @return True if this is a binary timing file
+   */
+  static bool is_binary(const std::string &path);
+
+  /**
+   * @brief Reads only the header and name table of a binary timing file.
+   *
+   * This is what tools that just need to enumerate categories (or check that two
+   * logs are comparable) should call, since it never touches the record pages.
+   *
+   * @param path File we will read
+   * @param names Names of each value column (empty if the file has none)
+   * @param num_records Number of records the file holds
+   * @return True on success, false if the file could not be opened or is malformed
+   */
+  static bool read_names(const std::string &path, std::vector<std::string> &names, uint64_t &num_records);
+
+  /**
+   * @brief Reads a binary timing file (the binary equivalent of Loader::load_timing_flamegraph)
+   * @param path File we will try to memory-map and read
+   * @param names Names of each value column (empty if the file has none)
+   * @param times Timestamps in seconds for each record
+   * @param timing_values Value columns for each record (appended to)
+   * @return True on success, false if the file could not be opened or is malformed
+   */
+  static bool read(const std::string &path, std::vector<std::string> &names, std::vector<double> &times,
+                   std::vector<Eigen::VectorXd> &timing_values);
+
+  /**
+   * @brief Writes a complete timing log to a binary file
+   * @param path Output file (overwritten if it exists)
+   * @param names Names of each value column (pass empty for unnamed columns)
+   * @param times Timestamps in seconds for each record
+   * @param timing_values Value columns for each record
+   */
+  static void write(const std::string &path, const std::vector<std::string> &names, const std::vector<double> &times,
+                    const std::vector<Eigen::VectorXd> &timing_values);
+
+  /**
+   * @brief Loads and merges many timing logs (text or binary) in parallel.
+   *
+   * Each file is ingested as its own thread pool task, then the per-file results are
+   * appended in the order the paths were given so the merge is deterministic. All
+   * files must agree on the category names of the first file; mismatched files are
+   * warned about and skipped rather than silently mixed.
+   *
+   * @param paths Files we will load (text or binary, can be mixed)
+   * @param names Category names shared by the merged files
+   * @param times Timestamps of every merged record
+   * @param timing_values Value columns of every merged record
+   */
+  static void load_merged(const std::vector<std::string> &paths, std::vector<std::string> &names, std::vector<double> &times,
+                          std::vector<Eigen::VectorXd> &timing_values);
+};
+
+} // namespace ov_eval
+
+#endif // OV_EVAL_BINARYTIMING_H
@@ -0,0 +1,233 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2018-2023 Patrick Geneva
+ * Copyright (C) 2018-2023 Guoquan Huang
+ * Copyright (C) 2018-2023 OpenVINS Contributors
+ * Copyright (C) 2018-2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "BinaryTrajectory.h"
+
+#include <cstring>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace ov_eval;
+
+// Magic at the start of every binary trajectory file
+// Starts with '#' and ends with a newline so text parsers see one comment line
+static const char BINARY_MAGIC[8] = {'#', 'O', 'V', 'T', 'B', 'I', 'N', '\n'};
+static const uint32_t BINARY_VERSION = 1;
+static const size_t HEADER_SIZE = sizeof(BINARY_MAGIC) + 2 * sizeof(uint32_t) + sizeof(uint64_t);
+
+/// Serializes the 24-byte header into the given buffer
+static void build_header(char *buffer, uint32_t values_per_record, uint64_t num_records) {
+  std::memcpy(buffer, BINARY_MAGIC, sizeof(BINARY_MAGIC));
+  std::memcpy(buffer + 8, &BINARY_VERSION, sizeof(uint32_t));
+  std::memcpy(buffer + 12, &values_per_record, sizeof(uint32_t));
+  std::memcpy(buffer + 16, &num_records, sizeof(uint64_t));
+}
+
+bool BinaryTrajectory::has_binary_extension(const std::string &path) {
+  std::string ext = ".ovb";
+  return path.size() >= ext.size() && path.compare(path.size() - ext.size(), ext.size(), ext) == 0;
+}
+
+bool BinaryTrajectory::is_binary(const std::string &path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open())
+    return false;
+  char magic[8] = {0};
+  file.read(magic, sizeof(magic));
+  return file.good() && std::memcmp(magic, BINARY_MAGIC, sizeof(magic)) == 0;
+}
+
+bool BinaryTrajectory::read(const std::string &path, std::vector<double> &times, std::vector<Eigen::Matrix<double, 7, 1>> &poses,
+                            std::vector<Eigen::Matrix3d> &cov_ori, std::vector<Eigen::Matrix3d> &cov_pos) {
+
+  // Get the raw file contents, preferring a memory mapping so we only fault in
+  // the pages we touch (see Loader::stream_values which does the same for text)
+  const char *data = nullptr;
+  size_t size = 0;
+  bool mapped = false;
+  std::string contents;
+#if defined(__unix__) || defined(__APPLE__)
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd >= 0) {
+    struct stat sb;
+    if (fstat(fd, &sb) == 0 && sb.st_size > 0) {
+      void *mem = mmap(nullptr, (size_t)sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (mem != MAP_FAILED) {
+        data = (const char *)mem;
+        size = (size_t)sb.st_size;
+        mapped = true;
+      }
+    }
+    close(fd);
+  }
+#endif
+  if (!mapped) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+      return false;
+    contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    data = contents.data();
+    size = contents.size();
+  }
+
+  // Validate the header and that the file is big enough for what it claims
+  uint32_t version = 0, values_per_record = 0;
+  uint64_t num_records = 0;
+  bool valid = (size >= HEADER_SIZE && std::memcmp(data, BINARY_MAGIC, sizeof(BINARY_MAGIC)) == 0);
+  if (valid) {
+    std::memcpy(&version, data + 8, sizeof(uint32_t));
+    std::memcpy(&values_per_record, data + 12, sizeof(uint32_t));
+    std::memcpy(&num_records, data + 16, sizeof(uint64_t));
+    valid = (version == BINARY_VERSION && (values_per_record == VALUES_POSE || values_per_record == VALUES_POSE_COV) &&
+             size >= HEADER_SIZE + num_records * (values_per_record + 1) * sizeof(double));
+  }
+
+  // Copy out each fixed-stride record
+  if (valid) {
+    bool has_cov = (values_per_record == VALUES_POSE_COV);
+    times.reserve(times.size() + num_records);
+    poses.reserve(poses.size() + num_records);
+    if (has_cov) {
+      cov_ori.reserve(cov_ori.size() + num_records);
+      cov_pos.reserve(cov_pos.size() + num_records);
+    }
+    const char *ptr = data + HEADER_SIZE;
+    for (uint64_t i = 0; i < num_records; i++) {
+      double record[VALUES_POSE_COV];
+      std::memcpy(record, ptr, values_per_record * sizeof(double));
+      ptr += values_per_record * sizeof(double);
+      times.push_back(record[0]);
+      Eigen::Matrix<double, 7, 1> pose;
+      pose << record[1], record[2], record[3], record[4], record[5], record[6], record[7];
+      poses.push_back(pose);
+      if (has_cov) {
+        Eigen::Matrix3d c_ori, c_pos;
+        c_ori << record[8], record[9], record[10], record[9], record[11], record[12], record[10], record[12], record[13];
+        c_pos << record[14], record[15], record[16], record[15], record[17], record[18], record[16], record[18], record[19];
+        cov_ori.push_back(c_ori);
+        cov_pos.push_back(c_pos);
+      }
+    }
+  }
+
+#if defined(__unix__) || defined(__APPLE__)
+  if (mapped)
+    munmap((void *)data, size);
+#endif
+  return valid;
+}
+
+void BinaryTrajectory::write(const std::string &path, const std::vector<double> &times,
+                             const std::vector<Eigen::Matrix<double, 7, 1>> &poses, const std::vector<Eigen::Matrix3d> &cov_ori,
+                             const std::vector<Eigen::Matrix3d> &cov_pos) {
+
+  // Sanity check that all our vectors are in sync
+  assert(times.size() == poses.size());
+  assert(cov_ori.size() == cov_pos.size());
+  assert(cov_ori.empty() || cov_ori.size() == times.size());
+
+  // Open the output and write the final header directly since we know the count
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  if (file.fail()) {
+    PRINT_ERROR(RED "[LOAD]: Unable to open binary trajectory file for writing!!\n" RESET);
+    PRINT_ERROR(RED "[LOAD]: %s\n" RESET, path.c_str());
+    std::exit(EXIT_FAILURE);
+  }
+  bool has_cov = !cov_ori.empty();
+  uint32_t values_per_record = has_cov ? VALUES_POSE_COV : VALUES_POSE;
+  char header[HEADER_SIZE];
+  build_header(header, values_per_record, (uint64_t)times.size());
+  file.write(header, sizeof(header));
+
+  // Then the fixed-stride records followed by the timestamp index
+  for (size_t i = 0; i < times.size(); i++) {
+    double record[VALUES_POSE_COV];
+    record[0] = times.at(i);
+    for (int j = 0; j < 7; j++)
+      record[1 + j] = poses.at(i)(j);
+    if (has_cov) {
+      const Eigen::Matrix3d &c_ori = cov_ori.at(i);
+      const Eigen::Matrix3d &c_pos = cov_pos.at(i);
+      record[8] = c_ori(0, 0);
+      record[9] = c_ori(0, 1);
+      record[10] = c_ori(0, 2);
+      record[11] = c_ori(1, 1);
+      record[12] = c_ori(1, 2);
+      record[13] = c_ori(2, 2);
+      record[14] = c_pos(0, 0);
+      record[15] = c_pos(0, 1);
+      record[16] = c_pos(0, 2);
+      record[17] = c_pos(1, 1);
+      record[18] = c_pos(1, 2);
+      record[19] = c_pos(2, 2);
+    }
+    file.write((const char *)record, values_per_record * sizeof(double));
+  }
+  if (!times.empty())
+    file.write((const char *)times.data(), times.size() * sizeof(double));
+  file.close();
+}
+
+bool BinaryTrajectory::Writer::open(const std::string &path) {
+
+  // Open and write a placeholder header, the real one is patched in on close
+  file.open(path, std::ios::binary | std::ios::in | std::ios::out | std::ios::trunc);
+  if (!file.is_open())
+    return false;
+  char header[HEADER_SIZE];
+  build_header(header, 0, 0);
+  file.write(header, sizeof(header));
+  values_per_record = 0;
+  timestamps.clear();
+  return true;
+}
+
+void BinaryTrajectory::Writer::append(const double *record, uint32_t num_values) {
+
+  // The first record fixes the stride of the whole file
+  assert(num_values == VALUES_POSE || num_values == VALUES_POSE_COV);
+  if (values_per_record == 0)
+    values_per_record = num_values;
+  assert(num_values == values_per_record);
+  file.write((const char *)record, values_per_record * sizeof(double));
+  timestamps.push_back(record[0]);
+}
+
+void BinaryTrajectory::Writer::close() {
+  if (!file.is_open())
+    return;
+
+  // Append the timestamp index, then go back and patch the header
+  if (!timestamps.empty())
+    file.write((const char *)timestamps.data(), timestamps.size() * sizeof(double));
+  char header[HEADER_SIZE];
+  build_header(header, values_per_record, (uint64_t)timestamps.size());
+  file.seekp(0);
+  file.write(header, sizeof(header));
+  file.close();
+  timestamps.clear();
+  values_per_record = 0;
+}
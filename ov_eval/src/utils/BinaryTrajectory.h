@@ -0,0 +1,131 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2018-2023 Patrick Geneva
+ * Copyright (C) 2018-2023 Guoquan Huang
+ * Copyright (C) 2018-2023 OpenVINS Contributors
+ * Copyright (C) 2018-2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OV_EVAL_BINARYTRAJECTORY_H
+#define OV_EVAL_BINARYTRAJECTORY_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <Eigen/Eigen>
+
+#include "utils/colors.h"
+#include "utils/print.h"
+
+namespace ov_eval {
+
+/**
+ * @brief Compact binary trajectory container.
+ *
+ * Our text trajectory files are convenient to inspect but have to be re-parsed
+ * number by number on every load, which dominates evaluation time on long runs.
+ * This container stores the exact same columns as the text format in fixed-stride
+ * binary records so a file can be memory-mapped and loaded with straight copies:
+ *
+ * - 24 byte header: 8 byte magic "#OVTBIN\n", uint32 version, uint32 values per
+ *   record (8 for time+pose, 20 when covariance is present), uint64 record count
+ * - records: count * values doubles in host order, columns matching the text
+ *   format (timestamp(s) tx ty tz qx qy qz qw [Pr11..Pr33 Pt11..Pt33])
+ * - index: count doubles of just the timestamps, so time lookups only touch
+ *   the tail pages of the file
+ *
+ * Loader::load_data() sniffs the magic, so binary and text files can be mixed
+ * freely; Recorder writes this format when given a ".ovb" output file, and
+ * format_converter can convert between the two.
+ */
+class BinaryTrajectory {
+
+public:
+  /// Values per record for a time + pose file
+  static const uint32_t VALUES_POSE = 8;
+
+  /// Values per record for a time + pose + covariance file
+  static const uint32_t VALUES_POSE_COV = 20;
+
+  /// File extension we record binary trajectories under
+  static bool has_binary_extension(const std::string &path);
+
+  /**
+   * @brief Checks if the given file starts with our binary magic
+   * @param path File to sniff
+   * @return True if this is a binary trajectory file
+   */
+  static bool is_binary(const std::string &path);
+
+  /**
+   * @brief Reads a binary trajectory file (the binary equivalent of Loader::load_data)
+   * @param path File we will try to memory-map and read
+   * @param times Timestamps of the poses
+   * @param poses Pose as [tx ty tz qx qy qz qw]
+   * @param cov_ori Orientation covariances (empty if the file has none)
+   * @param cov_pos Position covariances (empty if the file has none)
+   * @return True on success, false if the file could not be opened or is malformed
+   */
+  static bool read(const std::string &path, std::vector<double> &times, std::vector<Eigen::Matrix<double, 7, 1>> &poses,
+                   std::vector<Eigen::Matrix3d> &cov_ori, std::vector<Eigen::Matrix3d> &cov_pos);
+
+  /**
+   * @brief Writes a complete trajectory to a binary file
+   * @param path Output file (overwritten if it exists)
+   * @param times Timestamps of the poses
+   * @param poses Pose as [tx ty tz qx qy qz qw]
+   * @param cov_ori Orientation covariances (pass empty to skip covariance columns)
+   * @param cov_pos Position covariances (pass empty to skip covariance columns)
+   */
+  static void write(const std::string &path, const std::vector<double> &times, const std::vector<Eigen::Matrix<double, 7, 1>> &poses,
+                    const std::vector<Eigen::Matrix3d> &cov_ori, const std::vector<Eigen::Matrix3d> &cov_pos);
+
+  /**
+   * @brief Incremental writer used when poses arrive one at a time (e.g. Recorder).
+   *
+   * Appends fixed-stride records as they come in while keeping the timestamp
+   * index in memory, then writes the index and patches the header record count
+   * when closed. The record stride is fixed by the first appended record.
+   */
+  class Writer {
+
+  public:
+    /// Opens the output file and writes a placeholder header
+    bool open(const std::string &path);
+
+    /// Whether the output file was opened successfully
+    bool is_open() { return file.is_open(); }
+
+    /// Appends one record of the given number of values (must not change between calls)
+    void append(const double *record, uint32_t num_values);
+
+    /// Writes the timestamp index and final header, then closes the file
+    void close();
+
+    ~Writer() { close(); }
+
+  private:
+    std::fstream file;
+    uint32_t values_per_record = 0;
+    std::vector<double> timestamps;
+  };
+};
+
+} // namespace ov_eval
+
+#endif // OV_EVAL_BINARYTRAJECTORY_H
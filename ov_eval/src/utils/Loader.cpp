@@ -21,43 +21,173 @@
 
 #include "Loader.h"
 
+#include <cmath>
+
+#include "BinaryState.h"
+#include "BinaryTiming.h"
+#include "BinaryTrajectory.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 using namespace ov_eval;
 
-void Loader::load_data(std::string path_traj, std::vector<double> &times, std::vector<Eigen::Matrix<double, 7, 1>> &poses,
-                       std::vector<Eigen::Matrix3d> &cov_ori, std::vector<Eigen::Matrix3d> &cov_pos) {
+/**
+ * Fast in-place double parser used when scanning a mapped file.
+ * Handles sign, fraction and exponent; on success advances the pointer past the
+ * number, on failure leaves it untouched so the caller can skip the token.
+ */
+static bool parse_double_fast(const char *&ptr, const char *end, double &value) {
+  const char *p = ptr;
+  bool negative = false;
+  if (p != end && (*p == '+' || *p == '-')) {
+    negative = (*p == '-');
+    p++;
+  }
+  double mantissa = 0.0;
+  int digits = 0;
+  while (p != end && *p >= '0' && *p <= '9') {
+    mantissa = 10.0 * mantissa + (*p - '0');
+    p++;
+    digits++;
+  }
+  if (p != end && *p == '.') {
+    p++;
+    double scale = 1.0;
+    while (p != end && *p >= '0' && *p <= '9') {
+      mantissa = 10.0 * mantissa + (*p - '0');
+      scale *= 10.0;
+      p++;
+      digits++;
+    }
+    mantissa /= scale;
+  }
+  if (digits == 0)
+    return false;
+  if (p != end && (*p == 'e' || *p == 'E')) {
+    const char *q = p + 1;
+    bool exp_negative = false;
+    if (q != end && (*q == '+' || *q == '-')) {
+      exp_negative = (*q == '-');
+      q++;
+    }
+    int exponent = 0;
+    int exp_digits = 0;
+    while (q != end && *q >= '0' && *q <= '9') {
+      exponent = 10 * exponent + (*q - '0');
+      q++;
+      exp_digits++;
+    }
+    if (exp_digits > 0) {
+      mantissa *= std::pow(10.0, exp_negative ? -exponent : exponent);
+      p = q;
+    }
+  }
+  value = negative ? -mantissa : mantissa;
+  ptr = p;
+  return true;
+}
 
-  // Try to open our trajectory file
-  std::ifstream file(path_traj);
-  if (!file.is_open()) {
-    PRINT_ERROR(RED "[LOAD]: Unable to open trajectory file...\n" RESET);
-    PRINT_ERROR(RED "[LOAD]: %s\n" RESET, path_traj.c_str());
-    std::exit(EXIT_FAILURE);
+bool Loader::stream_values(const std::string &path, char delim,
+                           const std::function<void(const Eigen::Matrix<double, 20, 1> &, int)> &func) {
+
+  // Get the raw file contents as one contiguous read-only buffer
+  // We prefer to memory-map it so multi-hour files are paged in on demand and never
+  // copied, otherwise (or if the mapping fails) we fall back to a single bulk read
+  const char *data = nullptr;
+  size_t size = 0;
+  bool mapped = false;
+  std::string contents;
+#if defined(__unix__) || defined(__APPLE__)
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd >= 0) {
+    struct stat sb;
+    if (fstat(fd, &sb) == 0 && sb.st_size > 0) {
+      void *mem = mmap(nullptr, (size_t)sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (mem != MAP_FAILED) {
+        data = (const char *)mem;
+        size = (size_t)sb.st_size;
+        mapped = true;
+      }
+    }
+    close(fd);
+  }
+#endif
+  if (!mapped) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+      return false;
+    contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    data = contents.data();
+    size = contents.size();
   }
 
-  // Loop through each line of this file
-  std::string current_line;
-  while (std::getline(file, current_line)) {
+  // Walk the buffer line by line, parsing the numbers in place
+  Eigen::Matrix<double, 20, 1> values;
+  const char *ptr = data;
+  const char *end = data + size;
+  while (ptr < end) {
+
+    // Bound the current line
+    const char *line_end = ptr;
+    while (line_end < end && *line_end != '\n')
+      line_end++;
 
     // Skip if we start with a comment
-    if (!current_line.find("#"))
+    if (ptr < line_end && *ptr == '#') {
+      ptr = line_end + 1;
       continue;
+    }
 
-    // Loop variables
-    int i = 0;
-    std::istringstream s(current_line);
-    std::string field;
-    Eigen::Matrix<double, 20, 1> data;
-
-    // Loop through this line (timestamp(s) tx ty tz qx qy qz qw Pr11 Pr12 Pr13 Pr22 Pr23 Pr33 Pt11 Pt12 Pt13 Pt22 Pt23 Pt33)
-    while (std::getline(s, field, ' ')) {
-      // Skip if empty
-      if (field.empty() || i >= data.rows())
+    // Parse up to 20 delimited values from this line
+    int ct = 0;
+    const char *p = ptr;
+    while (p < line_end && ct < (int)values.rows()) {
+      while (p < line_end && (*p == delim || *p == ' ' || *p == '\r'))
+        p++;
+      if (p >= line_end)
+        break;
+      double value = 0.0;
+      if (!parse_double_fast(p, line_end, value)) {
+        // Not a number, skip over this token
+        while (p < line_end && *p != delim && *p != ' ')
+          p++;
         continue;
-      // save the data to our vector
-      data(i) = std::atof(field.c_str());
-      i++;
+      }
+      values(ct++) = value;
+    }
+    if (ct > 0)
+      func(values, ct);
+    ptr = line_end + 1;
+  }
+
+#if defined(__unix__) || defined(__APPLE__)
+  if (mapped)
+    munmap((void *)data, size);
+#endif
+  return true;
+}
+
+void Loader::load_data(std::string path_traj, std::vector<double> &times, std::vector<Eigen::Matrix<double, 7, 1>> &poses,
+                       std::vector<Eigen::Matrix3d> &cov_ori, std::vector<Eigen::Matrix3d> &cov_pos) {
+
+  // If this is one of our binary trajectory files, read its records directly
+  if (BinaryTrajectory::is_binary(path_traj)) {
+    if (!BinaryTrajectory::read(path_traj, times, poses, cov_ori, cov_pos)) {
+      PRINT_ERROR(RED "[LOAD]: Could not parse any data from the file!!\n" RESET);
+      PRINT_ERROR(RED "[LOAD]: %s\n" RESET, path_traj.c_str());
+      std::exit(EXIT_FAILURE);
     }
+    return;
+  }
 
+  // Stream each line of this file from a memory mapping of it
+  // Line format is (timestamp(s) tx ty tz qx qy qz qw Pr11 Pr12 Pr13 Pr22 Pr23 Pr33 Pt11 Pt12 Pt13 Pt22 Pt23 Pt33)
+  bool opened = stream_values(path_traj, ' ', [&](const Eigen::Matrix<double, 20, 1> &data, int i) {
     // Only a valid line if we have all the parameters
     if (i >= 20) {
       // time and pose
@@ -75,10 +205,14 @@ void Loader::load_data(std::string path_traj, std::vector<double> &times, std::v
       times.push_back(data(0));
       poses.push_back(data.block(1, 0, 7, 1));
     }
-  }
+  });
 
-  // Finally close the file
-  file.close();
+  // Error if we could not open the file
+  if (!opened) {
+    PRINT_ERROR(RED "[LOAD]: Unable to open trajectory file...\n" RESET);
+    PRINT_ERROR(RED "[LOAD]: %s\n" RESET, path_traj.c_str());
+    std::exit(EXIT_FAILURE);
+  }
 
   // Error if we don't have any data
   if (times.empty()) {
@@ -109,38 +243,9 @@ void Loader::load_data(std::string path_traj, std::vector<double> &times, std::v
 void Loader::load_data_csv(std::string path_traj, std::vector<double> &times, std::vector<Eigen::Matrix<double, 7, 1>> &poses,
                            std::vector<Eigen::Matrix3d> &cov_ori, std::vector<Eigen::Matrix3d> &cov_pos) {
 
-  // Try to open our trajectory file
-  std::ifstream file(path_traj);
-  if (!file.is_open()) {
-    PRINT_ERROR(RED "[LOAD]: Unable to open trajectory file...\n" RESET);
-    PRINT_ERROR(RED "[LOAD]: %s\n" RESET, path_traj.c_str());
-    std::exit(EXIT_FAILURE);
-  }
-
-  // Loop through each line of this file
-  std::string current_line;
-  while (std::getline(file, current_line)) {
-
-    // Skip if we start with a comment
-    if (!current_line.find("#"))
-      continue;
-
-    // Loop variables
-    int i = 0;
-    std::istringstream s(current_line);
-    std::string field;
-    Eigen::Matrix<double, 20, 1> data;
-
-    // Loop through this line (groundtruth state [time(sec),q_GtoI,p_IinG,v_IinG,b_gyro,b_accel])
-    while (std::getline(s, field, ',')) {
-      // Skip if empty
-      if (field.empty() || i >= data.rows())
-        continue;
-      // save the data to our vector
-      data(i) = std::atof(field.c_str());
-      i++;
-    }
-
+  // Stream each line of this file from a memory mapping of it
+  // Line format is the groundtruth state [time(ns),q_GtoI,p_IinG,v_IinG,b_gyro,b_accel]
+  bool opened = stream_values(path_traj, ',', [&](const Eigen::Matrix<double, 20, 1> &data, int i) {
     // Only a valid line if we have all the parameters
     // Times are in nanoseconds -> convert to seconds
     // Our "fixed" state vector from the ETH GT format [q,p,v,bg,ba]
@@ -156,10 +261,14 @@ void Loader::load_data_csv(std::string path_traj, std::vector<double> &times, st
       imustate(6, 0) = data(4, 0);
       poses.push_back(imustate);
     }
-  }
+  });
 
-  // Finally close the file
-  file.close();
+  // Error if we could not open the file
+  if (!opened) {
+    PRINT_ERROR(RED "[LOAD]: Unable to open trajectory file...\n" RESET);
+    PRINT_ERROR(RED "[LOAD]: %s\n" RESET, path_traj.c_str());
+    std::exit(EXIT_FAILURE);
+  }
 
   // Error if we don't have any data
   if (times.empty()) {
@@ -178,6 +287,16 @@ void Loader::load_data_csv(std::string path_traj, std::vector<double> &times, st
 
 void Loader::load_simulation(std::string path, std::vector<Eigen::VectorXd> &values) {
 
+  // If this is one of our binary state files, read its records directly
+  if (BinaryState::is_binary(path)) {
+    if (!BinaryState::read(path, values)) {
+      PRINT_ERROR(RED "[LOAD]: Could not parse any data from the file!!\n" RESET);
+      PRINT_ERROR(RED "[LOAD]: %s\n" RESET, path.c_str());
+      std::exit(EXIT_FAILURE);
+    }
+    return;
+  }
+
   // Try to open our trajectory file
   std::ifstream file(path);
   if (!file.is_open()) {
@@ -240,6 +359,16 @@ void Loader::load_simulation(std::string path, std::vector<Eigen::VectorXd> &val
 void Loader::load_timing_flamegraph(std::string path, std::vector<std::string> &names, std::vector<double> &times,
                                     std::vector<Eigen::VectorXd> &timing_values) {
 
+  // If this is one of our binary timing files, read its records directly
+  if (BinaryTiming::is_binary(path)) {
+    if (!BinaryTiming::read(path, names, times, timing_values)) {
+      PRINT_ERROR(RED "[LOAD]: Could not parse any data from the file!!\n" RESET);
+      PRINT_ERROR(RED "[LOAD]: %s\n" RESET, path.c_str());
+      std::exit(EXIT_FAILURE);
+    }
+    return;
+  }
+
   // Try to open our trajectory file
   std::ifstream file(path);
   if (!file.is_open()) {
@@ -321,6 +450,28 @@ void Loader::load_timing_flamegraph(std::string path, std::vector<std::string> &
 void Loader::load_timing_percent(std::string path, std::vector<double> &times, std::vector<Eigen::Vector3d> &summed_values,
                                  std::vector<Eigen::VectorXd> &node_values) {
 
+  // If this is one of our binary timing files, its records hold the full text row
+  // (summed values then per-node values), so split the columns the same way
+  if (BinaryTiming::is_binary(path)) {
+    std::vector<std::string> names;
+    std::vector<double> times_raw;
+    std::vector<Eigen::VectorXd> rows;
+    if (!BinaryTiming::read(path, names, times_raw, rows) || (rows.empty() || rows.at(0).rows() < 3)) {
+      PRINT_ERROR(RED "[LOAD]: Could not parse any data from the file!!\n" RESET);
+      PRINT_ERROR(RED "[LOAD]: %s\n" RESET, path.c_str());
+      std::exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < times_raw.size(); i++) {
+      // Skip if there where no threads
+      if (rows.at(i)(2) == 0.0)
+        continue;
+      times.push_back(times_raw.at(i));
+      summed_values.push_back(rows.at(i).block(0, 0, 3, 1));
+      node_values.push_back(rows.at(i).block(3, 0, rows.at(i).rows() - 3, 1));
+    }
+    return;
+  }
+
   // Try to open our trajectory file
   std::ifstream file(path);
   if (!file.is_open()) {
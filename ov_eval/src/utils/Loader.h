@@ -23,6 +23,7 @@
 #define OV_EVAL_LOADER_H
 
 #include <fstream>
+#include <functional>
 #include <iostream>
 #include <string>
 
@@ -42,6 +43,7 @@ class Loader {
 public:
   /**
    * @brief This will load *space* separated trajectory into memory
+   * (or one of our binary trajectory files, which are detected by their magic)
    * @param path_traj Path to the trajectory file that we want to read in.
    * @param times Timesteps in seconds for each pose
    * @param poses Pose at every timestep [pos,quat]
@@ -51,6 +53,22 @@ public:
   static void load_data(std::string path_traj, std::vector<double> &times, std::vector<Eigen::Matrix<double, 7, 1>> &poses,
                         std::vector<Eigen::Matrix3d> &cov_ori, std::vector<Eigen::Matrix3d> &cov_pos);
 
+  /**
+   * @brief Streaming parse of a delimited numeric text file
+   *
+   * The file is memory-mapped (with a bulk-read fallback) and parsed in place with a
+   * fast float scanner, so there is no per-line string construction. Each non-comment
+   * line is parsed into at most 20 values and handed to the callback together with the
+   * number of values found, which lets callers consume arbitrarily long files without
+   * this function materializing anything besides the current line's values.
+   *
+   * @param path Path to the text file that we want to read in
+   * @param delim Field separator used in the file (e.g. space or comma)
+   * @param func Callback invoked with (values, count) for every data line
+   * @return False if the file could not be opened
+   */
+  static bool stream_values(const std::string &path, char delim, const std::function<void(const Eigen::Matrix<double, 20, 1> &, int)> &func);
+
   /**
    * @brief This will load *comma* separated trajectory into memory (ASL/ETH format)
    * @param path_traj Path to the trajectory file that we want to read in.
@@ -29,6 +29,8 @@
 #include <Eigen/Eigen>
 #include <boost/filesystem.hpp>
 
+#include "utils/BinaryTrajectory.h"
+
 #include <geometry_msgs/PoseStamped.h>
 #include <geometry_msgs/PoseWithCovarianceStamped.h>
 #include <geometry_msgs/TransformStamped.h>
@@ -42,6 +44,8 @@ namespace ov_eval {
  *
  * Original code is based on this modified [posemsg_to_file](https://github.com/rpng/posemsg_to_file/).
  * Output is in a text file that is space deliminated and can be read by all scripts.
+ * If the output filename ends in ".ovb" we instead record our compact binary trajectory
+ * format (see BinaryTrajectory), which the loaders detect automatically.
  * If we have a covariance then we also save the upper triangular part to file so we can calculate NEES values.
  */
 class Recorder {
@@ -64,14 +68,23 @@ public:
       ROS_WARN("Output file exists, deleting old file....");
       boost::filesystem::remove(filename);
     }
-    // Open this file we want to write to
-    outfile.open(filename.c_str());
-    if (outfile.fail()) {
-      ROS_ERROR("Unable to open output file!!");
-      ROS_ERROR("Path: %s", filename.c_str());
-      std::exit(EXIT_FAILURE);
+    // Open this file we want to write to (binary or text based on the extension)
+    use_binary = BinaryTrajectory::has_binary_extension(filename);
+    if (use_binary) {
+      if (!binwriter.open(filename)) {
+        ROS_ERROR("Unable to open output file!!");
+        ROS_ERROR("Path: %s", filename.c_str());
+        std::exit(EXIT_FAILURE);
+      }
+    } else {
+      outfile.open(filename.c_str());
+      if (outfile.fail()) {
+        ROS_ERROR("Unable to open output file!!");
+        ROS_ERROR("Path: %s", filename.c_str());
+        std::exit(EXIT_FAILURE);
+      }
+      outfile << "# timestamp(s) tx ty tz qx qy qz qw Pr11 Pr12 Pr13 Pr22 Pr23 Pr33 Pt11 Pt12 Pt13 Pt22 Pt23 Pt33" << std::endl;
     }
-    outfile << "# timestamp(s) tx ty tz qx qy qz qw Pr11 Pr12 Pr13 Pr22 Pr23 Pr33 Pt11 Pt12 Pt13 Pt22 Pt23 Pt33" << std::endl;
     // Set initial state values
     timestamp = -1;
     q_ItoG << 0, 0, 0, 1;
@@ -154,6 +167,35 @@ protected:
    */
   void write() {
 
+    // If recording binary, append one fixed-stride record and return
+    if (use_binary) {
+      double record[BinaryTrajectory::VALUES_POSE_COV];
+      record[0] = timestamp;
+      record[1] = p_IinG.x();
+      record[2] = p_IinG.y();
+      record[3] = p_IinG.z();
+      record[4] = q_ItoG(0);
+      record[5] = q_ItoG(1);
+      record[6] = q_ItoG(2);
+      record[7] = q_ItoG(3);
+      if (has_covariance) {
+        record[8] = cov_rot(0, 0);
+        record[9] = cov_rot(0, 1);
+        record[10] = cov_rot(0, 2);
+        record[11] = cov_rot(1, 1);
+        record[12] = cov_rot(1, 2);
+        record[13] = cov_rot(2, 2);
+        record[14] = cov_pos(0, 0);
+        record[15] = cov_pos(0, 1);
+        record[16] = cov_pos(0, 2);
+        record[17] = cov_pos(1, 1);
+        record[18] = cov_pos(1, 2);
+        record[19] = cov_pos(2, 2);
+      }
+      binwriter.append(record, has_covariance ? BinaryTrajectory::VALUES_POSE_COV : BinaryTrajectory::VALUES_POSE);
+      return;
+    }
+
     // timestamp
     outfile.precision(5);
     outfile.setf(std::ios::fixed, std::ios::floatfield);
@@ -178,6 +220,10 @@ protected:
   // Output stream file
   std::ofstream outfile;
 
+  // Binary output (used instead of the text stream when the extension asks for it)
+  bool use_binary = false;
+  BinaryTrajectory::Writer binwriter;
+
   // Temp storage objects for our pose and its certainty
   bool has_covariance = false;
   double timestamp;
@@ -35,6 +35,10 @@ namespace ov_eval {
  *
  * Ensure that you call the calculate() function to update the values before using them.
  * This will compute all the final results from the values in @ref values vector.
+ * Repeated calls are incremental: only values appended since the last call are
+ * processed (a sorted copy is merged for the order statistics and the mean and
+ * variance are maintained with Welford's algorithm), so growing a series and
+ * recalculating costs O(new samples) instead of a full re-sort every time.
  */
 struct Statistics {
 
@@ -72,47 +76,54 @@ public:
   /// Will calculate all values from our vectors of information
   void calculate() {
 
-    // Sort the data for easy finding of values
-    std::vector<double> values_sorted = values;
-    std::sort(values_sorted.begin(), values_sorted.end());
+    // If values were removed or replaced wholesale, start the accumulation over
+    if (values.size() < values_processed) {
+      values_processed = 0;
+      welford_mean = 0.0;
+      welford_m2 = 0.0;
+      sum_squares = 0.0;
+      values_sorted.clear();
+    }
 
     // If we don't have any data, just return :(
-    if (values_sorted.empty())
+    if (values.empty())
       return;
 
-    // Now that its been sorted, can easily grab min and max
+    // Fold in the values appended since the last call
+    // New values are sorted on their own and merged into the sorted copy,
+    // while mean and variance are updated one sample at a time (Welford)
+    if (values.size() > values_processed) {
+      size_t num_old = values_sorted.size();
+      values_sorted.insert(values_sorted.end(), values.begin() + values_processed, values.end());
+      std::sort(values_sorted.begin() + num_old, values_sorted.end());
+      std::inplace_merge(values_sorted.begin(), values_sorted.begin() + num_old, values_sorted.end());
+      for (size_t i = values_processed; i < values.size(); i++) {
+        assert(!std::isnan(values.at(i)));
+        double delta = values.at(i) - welford_mean;
+        welford_mean += delta / (i + 1);
+        welford_m2 += delta * (values.at(i) - welford_mean);
+        sum_squares += values.at(i) * values.at(i);
+      }
+      values_processed = values.size();
+    }
+
+    // Min and max come straight off the sorted copy
     min = values_sorted.at(0);
     max = values_sorted.at(values_sorted.size() - 1);
 
     // Compute median
     // ODD:  grab middle from the sorted vector
     // EVEN: average the middle two numbers
-    if (values_sorted.size() == 1) {
-      median = values_sorted.at(values_sorted.size() - 1);
-    } else if (values_sorted.size() % 2 == 1) {
+    if (values_sorted.size() % 2 == 1) {
       median = values_sorted.at(values_sorted.size() / 2);
-    } else if (values_sorted.size() > 1) {
-      median = 0.5 * (values_sorted.at(values_sorted.size() / 2 - 1) + values_sorted.at(values_sorted.size() / 2));
     } else {
-      median = 0.0;
-    }
-
-    // Compute mean and rmse
-    mean = 0;
-    for (size_t i = 0; i < values_sorted.size(); i++) {
-      assert(!std::isnan(values_sorted.at(i)));
-      mean += values_sorted.at(i);
-      rmse += values_sorted.at(i) * values_sorted.at(i);
+      median = 0.5 * (values_sorted.at(values_sorted.size() / 2 - 1) + values_sorted.at(values_sorted.size() / 2));
     }
-    mean /= values_sorted.size();
-    rmse = std::sqrt(rmse / values_sorted.size());
 
-    // Using mean, compute standard deviation
-    std = 0;
-    for (size_t i = 0; i < values_sorted.size(); i++) {
-      std += std::pow(values_sorted.at(i) - mean, 2);
-    }
-    std = std::sqrt(std / (values_sorted.size() - 1));
+    // Mean, rmse and standard deviation from the running accumulators
+    mean = welford_mean;
+    rmse = std::sqrt(sum_squares / values_sorted.size());
+    std = (values_sorted.size() > 1) ? std::sqrt(welford_m2 / (values_sorted.size() - 1)) : 0.0;
 
     // 99th percentile
     // TODO: is this correct?
@@ -125,7 +136,25 @@ public:
     timestamps.clear();
     values.clear();
     values_bound.clear();
+    values_processed = 0;
+    welford_mean = 0.0;
+    welford_m2 = 0.0;
+    sum_squares = 0.0;
+    values_sorted.clear();
   }
+
+private:
+  /// How many entries of @ref values have been folded into the accumulators
+  size_t values_processed = 0;
+
+  /// Running Welford mean and sum of squared deviations of the processed values
+  double welford_mean = 0.0, welford_m2 = 0.0;
+
+  /// Running sum of squared values (for the rmse)
+  double sum_squares = 0.0;
+
+  /// Sorted copy of the processed values (for median, min, max)
+  std::vector<double> values_sorted;
 };
 
 } // namespace ov_eval
@@ -69,26 +69,30 @@ bool Factor_ImageReprojCalib::Evaluate(double const *const *parameters, double *
   Eigen::Matrix<double, 2, 2> sqrtQ_gate = gate * sqrtQ;
 
   // Get the distorted raw image coordinate using the camera model
-  // Also if jacobians are requested, then compute derivatives
+  // If jacobians are requested, the fused dual-number kernel produces the value and
+  // both derivatives from a single traversal of the distortion model (the same kernel
+  // the filter updaters use, so there is one authoritative derivation)
   Eigen::Vector2d uv_dist;
   Eigen::MatrixXd H_dz_dzn, H_dz_dzeta;
   if (is_fisheye) {
     ov_core::CamEqui cam(0, 0);
     cam.set_value(camera_vals);
-    uv_dist = cam.distort_d(uv_norm);
     if (jacobians) {
-      cam.compute_distort_jacobian(uv_norm, H_dz_dzn, H_dz_dzeta);
+      cam.compute_distort_value_jacobian(uv_norm, uv_dist, H_dz_dzn, H_dz_dzeta);
       H_dz_dzn = sqrtQ_gate * H_dz_dzn;
       H_dz_dzeta = sqrtQ_gate * H_dz_dzeta;
+    } else {
+      uv_dist = cam.distort_d(uv_norm);
     }
   } else {
     ov_core::CamRadtan cam(0, 0);
     cam.set_value(camera_vals);
-    uv_dist = cam.distort_d(uv_norm);
     if (jacobians) {
-      cam.compute_distort_jacobian(uv_norm, H_dz_dzn, H_dz_dzeta);
+      cam.compute_distort_value_jacobian(uv_norm, uv_dist, H_dz_dzn, H_dz_dzeta);
       H_dz_dzn = sqrtQ_gate * H_dz_dzn;
       H_dz_dzeta = sqrtQ_gate * H_dz_dzeta;
+    } else {
+      uv_dist = cam.distort_d(uv_norm);
     }
   }
 
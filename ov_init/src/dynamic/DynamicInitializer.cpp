@@ -21,6 +21,8 @@
 
 #include "DynamicInitializer.h"
 
+#include <algorithm>
+
 #include "ceres/Factor_GenericPrior.h"
 #include "ceres/Factor_ImageReprojCalib.h"
 #include "ceres/Factor_ImuCPIv1.h"
@@ -36,6 +38,7 @@
 #include "utils/print.h"
 #include "utils/quat_ops.h"
 #include "utils/sensor_data.h"
+#include "utils/thread_pool.h"
 
 using namespace ov_core;
 using namespace ov_type;
@@ -45,10 +48,14 @@ bool DynamicInitializer::initialize(double &timestamp, Eigen::MatrixXd &covarian
                                     std::shared_ptr<ov_type::IMU> &_imu, std::map<double, std::shared_ptr<ov_type::PoseJPL>> &_clones_IMU,
                                     std::unordered_map<size_t, std::shared_ptr<ov_type::Landmark>> &_features_SLAM) {
 
-  // Get the newest and oldest timestamps we will try to initialize between!
+  // Grab a consistent immutable snapshot of the current tracks, so the long solve below
+  // never holds the live database locks against the tracker's feed_new_camera
   auto rT1 = boost::posix_time::microsec_clock::local_time();
+  std::unordered_map<size_t, std::shared_ptr<Feature>> db_snapshot = _db->get_snapshot();
+
+  // Get the newest and oldest timestamps we will try to initialize between!
   double newest_cam_time = -1;
-  for (auto const &feat : _db->get_internal_data()) {
+  for (auto const &feat : db_snapshot) {
     for (auto const &camtimepair : feat.second->timestamps) {
       for (auto const &time : camtimepair.second) {
         newest_cam_time = std::max(newest_cam_time, time);
@@ -69,8 +76,18 @@ bool DynamicInitializer::initialize(double &timestamp, Eigen::MatrixXd &covarian
     have_old_imu_readings = true;
     it_imu = imu_data->erase(it_imu);
   }
-  if (_db->get_internal_data().size() < 0.75 * params.init_max_features) {
-    PRINT_WARNING(RED "[init-d]: only %zu valid features of required (%.0f thresh)!!\n" RESET, _db->get_internal_data().size(),
+  size_t num_valid_features = 0;
+  for (auto const &feat : db_snapshot) {
+    for (auto const &camtimepair : feat.second->timestamps) {
+      // Timestamps are appended in order, so the back is the latest measurement
+      if (!camtimepair.second.empty() && camtimepair.second.back() >= oldest_time) {
+        num_valid_features++;
+        break;
+      }
+    }
+  }
+  if (num_valid_features < 0.75 * params.init_max_features) {
+    PRINT_WARNING(RED "[init-d]: only %zu valid features of required (%.0f thresh)!!\n" RESET, num_valid_features,
                   0.95 * params.init_max_features);
     return false;
   }
@@ -84,12 +101,22 @@ bool DynamicInitializer::initialize(double &timestamp, Eigen::MatrixXd &covarian
   // measurements appended to it in an async-manor so this initialization
   // can be performed in a secondary thread while feature tracking is still performed.
   std::unordered_map<size_t, std::shared_ptr<Feature>> features;
-  for (const auto &feat : _db->get_internal_data()) {
+  for (const auto &feat : db_snapshot) {
     auto feat_new = std::make_shared<Feature>();
     feat_new->featid = feat.second->featid;
-    feat_new->uvs = feat.second->uvs;
-    feat_new->uvs_norm = feat.second->uvs_norm;
-    feat_new->timestamps = feat.second->timestamps;
+    // Only copy measurements inside our window: combine the lazy-prune watermark with
+    // an explicit bound, since the snapshot was taken before the cleanup call above
+    // (the per-camera timestamps are sorted so the window start is a binary search)
+    for (auto const &camtime : feat.second->timestamps) {
+      size_t start = feat.second->first_valid_index(camtime.first);
+      start = (size_t)(std::lower_bound(camtime.second.begin() + start, camtime.second.end(), oldest_time) - camtime.second.begin());
+      if (camtime.second.size() <= start)
+        continue;
+      feat_new->timestamps[camtime.first].assign(camtime.second.begin() + start, camtime.second.end());
+      feat_new->uvs[camtime.first].assign(feat.second->uvs.at(camtime.first).begin() + start, feat.second->uvs.at(camtime.first).end());
+      feat_new->uvs_norm[camtime.first].assign(feat.second->uvs_norm.at(camtime.first).begin() + start,
+                                               feat.second->uvs_norm.at(camtime.first).end());
+    }
     features.insert({feat.first, feat_new});
   }
 
@@ -169,6 +196,13 @@ bool DynamicInitializer::initialize(double &timestamp, Eigen::MatrixXd &covarian
   Eigen::Vector3d gyroscope_bias = params.init_dyn_bias_g;
   Eigen::Vector3d accelerometer_bias = params.init_dyn_bias_a;
 
+  // Warm start from the previous attempt's MLE solution if we have one
+  // The biases are in the IMU frame, so they carry over directly between windows
+  if (retry_cache.have_last_biases) {
+    gyroscope_bias = retry_cache.last_bias_g;
+    accelerometer_bias = retry_cache.last_bias_a;
+  }
+
   // Check that we have some angular velocity / orientation change
   double accel_inI_norm = 0.0;
   double theta_inI_norm = 0.0;
@@ -238,9 +272,16 @@ bool DynamicInitializer::initialize(double &timestamp, Eigen::MatrixXd &covarian
   }
 
   // Now lets pre-integrate from the first time to the last
+  // The I0 to Ii preintegration (used in the linear system) is built incrementally:
+  // we keep one running integration from I0 and snapshot a copy of it at each camera
+  // time, feeding it the same interval readings as the Ii to Ii1 preintegration.
+  // This way every IMU reading is only integrated twice total instead of once per
+  // camera pose it precedes (which made initialization quadratic in the window size).
   assert(oldest_camera_time < newest_cam_time);
   double last_camera_timestamp = 0.0;
   std::map<double, std::shared_ptr<ov_core::CpiV1>> map_camera_cpi_I0toIi, map_camera_cpi_IitoIi1;
+  auto cpiI0toIi_running = std::make_shared<ov_core::CpiV1>(params.sigma_w, params.sigma_wb, params.sigma_a, params.sigma_ab, true);
+  cpiI0toIi_running->setLinearizationPoints(gyroscope_bias, accelerometer_bias);
   for (auto const &timepair : map_camera_times) {
 
     // No preintegration at the first timestamp
@@ -252,69 +293,39 @@ bool DynamicInitializer::initialize(double &timestamp, Eigen::MatrixXd &covarian
       continue;
     }
 
-    // Perform our preintegration from I0 to Ii (used in the linear system)
-    double cpiI0toIi1_time0_in_imu = oldest_camera_time + params.calib_camimu_dt;
-    double cpiI0toIi1_time1_in_imu = current_time + params.calib_camimu_dt;
-    auto cpiI0toIi1 = std::make_shared<ov_core::CpiV1>(params.sigma_w, params.sigma_wb, params.sigma_a, params.sigma_ab, true);
-    cpiI0toIi1->setLinearizationPoints(gyroscope_bias, accelerometer_bias);
-    std::vector<ov_core::ImuData> cpiI0toIi1_readings =
-        InitializerHelper::select_imu_readings(*imu_data, cpiI0toIi1_time0_in_imu, cpiI0toIi1_time1_in_imu);
-    if (cpiI0toIi1_readings.size() < 2) {
-      PRINT_DEBUG(YELLOW "[init-d]: camera %.2f in has %zu IMU readings!\n" RESET, (cpiI0toIi1_time1_in_imu - cpiI0toIi1_time0_in_imu),
-                  cpiI0toIi1_readings.size());
+    // Select the IMU readings that span from the previous camera time to this one
+    double cpi_time0_in_imu = last_camera_timestamp + params.calib_camimu_dt;
+    double cpi_time1_in_imu = current_time + params.calib_camimu_dt;
+    std::vector<ov_core::ImuData> cpi_readings = InitializerHelper::select_imu_readings(*imu_data, cpi_time0_in_imu, cpi_time1_in_imu);
+    if (cpi_readings.size() < 2) {
+      PRINT_DEBUG(YELLOW "[init-d]: camera %.2f in has %zu IMU readings!\n" RESET, (cpi_time1_in_imu - cpi_time0_in_imu),
+                  cpi_readings.size());
       return false;
     }
-    double cpiI0toIi1_dt_imu = cpiI0toIi1_readings.at(cpiI0toIi1_readings.size() - 1).timestamp - cpiI0toIi1_readings.at(0).timestamp;
-    if (std::abs(cpiI0toIi1_dt_imu - (cpiI0toIi1_time1_in_imu - cpiI0toIi1_time0_in_imu)) > 0.01) {
-      PRINT_DEBUG(YELLOW "[init-d]: camera IMU was only propagated %.3f of %.3f\n" RESET, cpiI0toIi1_dt_imu,
-                  (cpiI0toIi1_time1_in_imu - cpiI0toIi1_time0_in_imu));
+    double cpi_dt_imu = cpi_readings.at(cpi_readings.size() - 1).timestamp - cpi_readings.at(0).timestamp;
+    if (std::abs(cpi_dt_imu - (cpi_time1_in_imu - cpi_time0_in_imu)) > 0.01) {
+      PRINT_DEBUG(YELLOW "[init-d]: camera IMU was only propagated %.3f of %.3f\n" RESET, cpi_dt_imu,
+                  (cpi_time1_in_imu - cpi_time0_in_imu));
       return false;
     }
-    for (size_t k = 0; k < cpiI0toIi1_readings.size() - 1; k++) {
-      auto imu0 = cpiI0toIi1_readings.at(k);
-      auto imu1 = cpiI0toIi1_readings.at(k + 1);
-      cpiI0toIi1->feed_IMU(imu0.timestamp, imu1.timestamp, imu0.wm, imu0.am, imu1.wm, imu1.am);
-    }
 
     // Perform our preintegration from Ii to Ii1 (used in the mle optimization)
-    double cpiIitoIi1_time0_in_imu = last_camera_timestamp + params.calib_camimu_dt;
-    double cpiIitoIi1_time1_in_imu = current_time + params.calib_camimu_dt;
+    // The running I0 to Ii integration consumes the exact same readings
     auto cpiIitoIi1 = std::make_shared<ov_core::CpiV1>(params.sigma_w, params.sigma_wb, params.sigma_a, params.sigma_ab, true);
     cpiIitoIi1->setLinearizationPoints(gyroscope_bias, accelerometer_bias);
-    std::vector<ov_core::ImuData> cpiIitoIi1_readings =
-        InitializerHelper::select_imu_readings(*imu_data, cpiIitoIi1_time0_in_imu, cpiIitoIi1_time1_in_imu);
-    if (cpiIitoIi1_readings.size() < 2) {
-      PRINT_DEBUG(YELLOW "[init-d]: camera %.2f in has %zu IMU readings!\n" RESET, (cpiIitoIi1_time1_in_imu - cpiIitoIi1_time0_in_imu),
-                  cpiIitoIi1_readings.size());
-      return false;
-    }
-    double cpiIitoIi1_dt_imu = cpiIitoIi1_readings.at(cpiIitoIi1_readings.size() - 1).timestamp - cpiIitoIi1_readings.at(0).timestamp;
-    if (std::abs(cpiIitoIi1_dt_imu - (cpiIitoIi1_time1_in_imu - cpiIitoIi1_time0_in_imu)) > 0.01) {
-      PRINT_DEBUG(YELLOW "[init-d]: camera IMU was only propagated %.3f of %.3f\n" RESET, cpiIitoIi1_dt_imu,
-                  (cpiIitoIi1_time1_in_imu - cpiIitoIi1_time0_in_imu));
-      return false;
-    }
-    for (size_t k = 0; k < cpiIitoIi1_readings.size() - 1; k++) {
-      auto imu0 = cpiIitoIi1_readings.at(k);
-      auto imu1 = cpiIitoIi1_readings.at(k + 1);
-      cpiIitoIi1->feed_IMU(imu0.timestamp, imu1.timestamp, imu0.wm, imu0.am, imu1.wm, imu1.am);
-    }
+    cpiIitoIi1->feed_IMU_bulk(cpi_readings);
+    cpiI0toIi_running->feed_IMU_bulk(cpi_readings);
 
-    // Finally push back our integrations!
-    map_camera_cpi_I0toIi.insert({current_time, cpiI0toIi1});
+    // Finally push back our integrations (snapshot the running I0 to Ii one)!
+    map_camera_cpi_I0toIi.insert({current_time, std::make_shared<ov_core::CpiV1>(*cpiI0toIi_running)});
     map_camera_cpi_IitoIi1.insert({current_time, cpiIitoIi1});
     last_camera_timestamp = current_time;
   }
 
-  // Loop through each feature observation and append it!
-  // State ordering is: [features, velocity, gravity]
-  Eigen::MatrixXd A = Eigen::MatrixXd::Zero(num_measurements, system_size);
-  Eigen::VectorXd b = Eigen::VectorXd::Zero(num_measurements);
-  PRINT_DEBUG("[init-d]: system of %d measurement x %d states created (%d features, %s)\n", num_measurements, system_size, num_features,
-              (have_stereo) ? "stereo" : "mono");
-  int index_meas = 0;
+  // Assign each valid feature its column index in the state
   int idx_feat = 0;
   std::map<size_t, int> A_index_features;
+  std::vector<size_t> A_feat_ids;
   for (auto const &feat : features) {
     if (map_features_num_meas[feat.first] < min_num_meas_to_optimize)
       continue;
@@ -322,7 +333,44 @@ bool DynamicInitializer::initialize(double &timestamp, Eigen::MatrixXd &covarian
       A_index_features.insert({feat.first, idx_feat});
       idx_feat += 1;
     }
-    for (auto const &camtime : feat.second->timestamps) {
+    A_feat_ids.push_back(feat.first);
+  }
+
+  // Build each feature's additive contribution to the normal equations
+  // State ordering is: [features, velocity, gravity]
+  // No measurement row ever couples two features, so A^T A decomposes into per-feature
+  // blocks which we build directly (the stacked rows x states system is never formed).
+  // The blocks are cached across attempts: a retry that shares the same window anchor
+  // and bias linearization recomputes only the features whose measurement set changed,
+  // while departed features simply fall out of the cache (the downdate).
+  prior_builder.set_epoch(oldest_camera_time, gyroscope_bias, accelerometer_bias);
+  PRINT_DEBUG("[init-d]: system of %d measurement x %d states created (%d features, %s)\n", num_measurements, system_size, num_features,
+              (have_stereo) ? "stereo" : "mono");
+  std::vector<IncrementalPriorBuilder::Contribution> contribs(A_feat_ids.size());
+  std::vector<char> contribs_reused(A_feat_ids.size(), 0);
+  ov_core::ThreadPool::instance().parallel_for(0, (int)A_feat_ids.size(), [&](int f) {
+    auto const &feat = features.at(A_feat_ids.at(f));
+
+    // Measurements of this feature inside the window (this is the cache signature)
+    IncrementalPriorBuilder::Contribution &contrib = contribs.at(f);
+    for (auto const &camtime : feat->timestamps) {
+      for (double time : camtime.second) {
+        if (map_camera_times.find(time) != map_camera_times.end())
+          contrib.meas.emplace_back(camtime.first, time);
+      }
+    }
+
+    // Reuse the cached blocks if this feature's measurements have not changed
+    const IncrementalPriorBuilder::Contribution *cached = prior_builder.lookup(A_feat_ids.at(f), contrib.meas);
+    if (cached != nullptr) {
+      contrib.G = cached->G;
+      contrib.w = cached->w;
+      contribs_reused.at(f) = 1;
+      return;
+    }
+
+    // Otherwise accumulate H^T H and H^T b over this feature's observations
+    for (auto const &camtime : feat->timestamps) {
 
       // This camera
       size_t cam_id = camtime.first;
@@ -334,13 +382,13 @@ bool DynamicInitializer::initialize(double &timestamp, Eigen::MatrixXd &covarian
       for (size_t i = 0; i < camtime.second.size(); i++) {
 
         // Skip measurements we don't have poses for
-        double time = feat.second->timestamps.at(cam_id).at(i);
+        double time = feat->timestamps.at(cam_id).at(i);
         if (map_camera_times.find(time) == map_camera_times.end())
           continue;
 
         // Our measurement
         Eigen::Vector2d uv_norm;
-        uv_norm << (double)feat.second->uvs_norm.at(cam_id).at(i)(0), (double)feat.second->uvs_norm.at(cam_id).at(i)(1);
+        uv_norm << (double)feat->uvs_norm.at(cam_id).at(i)(0), (double)feat->uvs_norm.at(cam_id).at(i)(1);
 
         // Preintegration values
         double DT = 0.0;
@@ -361,44 +409,67 @@ bool DynamicInitializer::initialize(double &timestamp, Eigen::MatrixXd &covarian
         Eigen::MatrixXd H_proj = Eigen::MatrixXd::Zero(2, 3);
         H_proj << 1, 0, -uv_norm(0), 0, 1, -uv_norm(1);
         Eigen::MatrixXd Y = H_proj * R_ItoC * R_I0toIk;
-        Eigen::MatrixXd H_i = Eigen::MatrixXd::Zero(2, system_size);
+        Eigen::Matrix<double, 2, 9> H_i = Eigen::Matrix<double, 2, 9>::Zero();
         Eigen::MatrixXd b_i = Y * alpha_I0toIk - H_proj * p_IinC;
         if (size_feature == 1) {
           assert(false);
           // Substitute in p_FinI0 = z*bearing_inC0_rotI0 - R_ItoC^T*p_IinC
-          // H_i.block(0, size_feature * A_index_features.at(feat.first), 2, 1) = Y * features_bearings.at(feat.first);
+          // H_i.block(0, 0, 2, 1) = Y * features_bearings.at(feat.first);
           // b_i += Y * R_ItoC.transpose() * p_IinC;
         } else {
-          H_i.block(0, size_feature * A_index_features.at(feat.first), 2, 3) = Y; // feat
+          H_i.block(0, 0, 2, 3) = Y; // feat
         }
-        H_i.block(0, size_feature * num_features + 0, 2, 3) = -DT * Y;            // vel
-        H_i.block(0, size_feature * num_features + 3, 2, 3) = 0.5 * DT * DT * Y;  // grav
+        H_i.block(0, 3, 2, 3) = -DT * Y;           // vel
+        H_i.block(0, 6, 2, 3) = 0.5 * DT * DT * Y; // grav
 
-        // Else lets append this to our system!
-        A.block(index_meas, 0, 2, A.cols()) = H_i;
-        b.block(index_meas, 0, 2, 1) = b_i;
-        index_meas += 2;
+        // Else lets append this to our blocks!
+        contrib.G.noalias() += H_i.transpose() * H_i;
+        contrib.w.noalias() += H_i.transpose() * b_i;
       }
     }
+  });
+
+  // Store the recomputed contributions and drop departed features from the cache
+  int num_reused = 0;
+  for (size_t f = 0; f < A_feat_ids.size(); f++) {
+    if (contribs_reused.at(f)) {
+      num_reused++;
+      continue;
+    }
+    prior_builder.store(A_feat_ids.at(f), contribs.at(f));
+  }
+  prior_builder.prune(A_index_features);
+  PRINT_DEBUG("[init-d]: prior builder reused %d of %zu feature contributions\n", num_reused, A_feat_ids.size());
+
+  // Assemble the normal equations A^T A and A^T b from the per-feature blocks
+  int n1 = size_feature * num_features + 3;
+  Eigen::MatrixXd AtA = Eigen::MatrixXd::Zero(system_size, system_size);
+  Eigen::VectorXd Atb = Eigen::VectorXd::Zero(system_size);
+  for (size_t f = 0; f < A_feat_ids.size(); f++) {
+    const IncrementalPriorBuilder::Contribution &contrib = contribs.at(f);
+    int idx = size_feature * A_index_features.at(A_feat_ids.at(f));
+    AtA.block(idx, idx, 3, 3) = contrib.G.block(0, 0, 3, 3);
+    AtA.block(idx, n1 - 3, 3, 3) = contrib.G.block(0, 3, 3, 3);
+    AtA.block(n1 - 3, idx, 3, 3) = contrib.G.block(3, 0, 3, 3);
+    AtA.block(idx, n1, 3, 3) = contrib.G.block(0, 6, 3, 3);
+    AtA.block(n1, idx, 3, 3) = contrib.G.block(6, 0, 3, 3);
+    AtA.block(n1 - 3, n1 - 3, 6, 6) += contrib.G.block(3, 3, 6, 6);
+    Atb.segment(idx, 3) = contrib.w.head(3);
+    Atb.segment(n1 - 3, 6) += contrib.w.tail(6);
   }
   auto rT3 = boost::posix_time::microsec_clock::local_time();
 
   // ======================================================
   // ======================================================
 
-  // Solve the linear system without constraint
-  // Eigen::MatrixXd AtA = A.transpose() * A;
-  // Eigen::MatrixXd Atb = A.transpose() * b;
-  // Eigen::MatrixXd x_hat = AtA.colPivHouseholderQr().solve(Atb);
-
   // Constrained solving |g| = 9.81 constraint
-  Eigen::MatrixXd A1 = A.block(0, 0, A.rows(), A.cols() - 3);
-  // Eigen::MatrixXd A1A1_inv = (A1.transpose() * A1).inverse();
-  Eigen::MatrixXd A1A1_inv = (A1.transpose() * A1).llt().solve(Eigen::MatrixXd::Identity(A1.cols(), A1.cols()));
-  Eigen::MatrixXd A2 = A.block(0, A.cols() - 3, A.rows(), 3);
-  Eigen::MatrixXd Temp = A2.transpose() * (Eigen::MatrixXd::Identity(A1.rows(), A1.rows()) - A1 * A1A1_inv * A1.transpose());
-  Eigen::MatrixXd D = Temp * A2;
-  Eigen::MatrixXd d = Temp * b;
+  // All operations stay in the normal equations: with A = [A1 A2] this is the same
+  // D = A2^T (I - A1 (A1^T A1)^-1 A1^T) A2 as the stacked form, without the rows
+  Eigen::MatrixXd A1A1_inv = AtA.topLeftCorner(n1, n1).llt().solve(Eigen::MatrixXd::Identity(n1, n1));
+  Eigen::MatrixXd A1tA2 = AtA.topRightCorner(n1, 3);
+  Eigen::VectorXd A1tb = Atb.head(n1);
+  Eigen::MatrixXd D = AtA.bottomRightCorner(3, 3) - A1tA2.transpose() * A1A1_inv * A1tA2;
+  Eigen::MatrixXd d = Atb.tail(3) - A1tA2.transpose() * A1A1_inv * A1tb;
   Eigen::Matrix<double, 7, 1> coeff = InitializerHelper::compute_dongsi_coeff(D, d, params.gravity_mag);
 
   // Create companion matrix of our polynomial
@@ -462,7 +533,7 @@ bool DynamicInitializer::initialize(double &timestamp, Eigen::MatrixXd &covarian
   Eigen::VectorXd state_grav = D_lambdaI_inv * d;
 
   // Overwrite our state: [features, velocity, gravity]
-  Eigen::VectorXd state_feat_vel = -A1A1_inv * A1.transpose() * A2 * state_grav + A1A1_inv * A1.transpose() * b;
+  Eigen::VectorXd state_feat_vel = A1A1_inv * (A1tb - A1tA2 * state_grav);
   Eigen::MatrixXd x_hat = Eigen::MatrixXd::Zero(system_size, 1);
   x_hat.block(0, 0, size_feature * num_features + 3, 1) = state_feat_vel;
   x_hat.block(size_feature * num_features + 3, 0, 3, 1) = state_grav;
@@ -594,27 +665,9 @@ bool DynamicInitializer::initialize(double &timestamp, Eigen::MatrixXd &covarian
   std::map<size_t, int> map_calib_cam;
   std::vector<double *> ceres_vars_calib_cam_intrinsics;
 
-  // Helper lambda that will free any memory we have allocated
-  auto free_state_memory = [&]() {
-    for (auto const &ptr : ceres_vars_ori)
-      delete[] ptr;
-    for (auto const &ptr : ceres_vars_pos)
-      delete[] ptr;
-    for (auto const &ptr : ceres_vars_vel)
-      delete[] ptr;
-    for (auto const &ptr : ceres_vars_bias_g)
-      delete[] ptr;
-    for (auto const &ptr : ceres_vars_bias_a)
-      delete[] ptr;
-    for (auto const &ptr : ceres_vars_feat)
-      delete[] ptr;
-    for (auto const &ptr : ceres_vars_calib_cam2imu_ori)
-      delete[] ptr;
-    for (auto const &ptr : ceres_vars_calib_cam2imu_pos)
-      delete[] ptr;
-    for (auto const &ptr : ceres_vars_calib_cam_intrinsics)
-      delete[] ptr;
-  };
+  // All parameter blocks come from the retry cache pool so failed attempts can
+  // hand their allocations straight to the next attempt instead of freeing them
+  retry_cache.reset();
 
   // Set the optimization settings
   // NOTE: We use dense schur since after eliminating features we have a dense problem
@@ -653,14 +706,14 @@ bool DynamicInitializer::initialize(double &timestamp, Eigen::MatrixXd &covarian
     // ================================================================
 
     // Load our state variables into our allocated state pointers
-    auto *var_ori = new double[4];
+    auto *var_ori = retry_cache.alloc();
     for (int j = 0; j < 4; j++) {
       var_ori[j] = state_k1(0 + j, 0);
     }
-    auto *var_pos = new double[3];
-    auto *var_vel = new double[3];
-    auto *var_bias_g = new double[3];
-    auto *var_bias_a = new double[3];
+    auto *var_pos = retry_cache.alloc();
+    auto *var_vel = retry_cache.alloc();
+    auto *var_bias_g = retry_cache.alloc();
+    auto *var_bias_a = retry_cache.alloc();
     for (int j = 0; j < 3; j++) {
       var_pos[j] = state_k1(4 + j, 0);
       var_vel[j] = state_k1(7 + j, 0);
@@ -754,11 +807,11 @@ bool DynamicInitializer::initialize(double &timestamp, Eigen::MatrixXd &covarian
   for (auto const &idpair : map_camera_ids) {
     size_t cam_id = idpair.first;
     if (map_calib_cam2imu.find(cam_id) == map_calib_cam2imu.end()) {
-      auto *var_calib_ori = new double[4];
+      auto *var_calib_ori = retry_cache.alloc();
       for (int j = 0; j < 4; j++) {
         var_calib_ori[j] = params.camera_extrinsics.at(cam_id)(0 + j, 0);
       }
-      auto *var_calib_pos = new double[3];
+      auto *var_calib_pos = retry_cache.alloc();
       for (int j = 0; j < 3; j++) {
         var_calib_pos[j] = params.camera_extrinsics.at(cam_id)(4 + j, 0);
       }
@@ -797,7 +850,7 @@ bool DynamicInitializer::initialize(double &timestamp, Eigen::MatrixXd &covarian
       }
     }
     if (map_calib_cam.find(cam_id) == map_calib_cam.end()) {
-      auto *var_calib_cam = new double[8];
+      auto *var_calib_cam = retry_cache.alloc();
       for (int j = 0; j < 8; j++) {
         var_calib_cam[j] = params.camera_intrinsics.at(cam_id)->get_value()(j, 0);
       }
@@ -859,7 +912,7 @@ bool DynamicInitializer::initialize(double &timestamp, Eigen::MatrixXd &covarian
         // If we don't have the feature state we should create that parameter block
         // The initial guess of the features are the scaled feature map from the SFM
         if (map_features.find(feat_id) == map_features.end()) {
-          auto *var_feat = new double[3];
+          auto *var_feat = retry_cache.alloc();
           for (int j = 0; j < 3; j++) {
             var_feat[j] = features_inG.at(feat_id)(j);
           }
@@ -889,6 +942,25 @@ bool DynamicInitializer::initialize(double &timestamp, Eigen::MatrixXd &covarian
   assert(ceres_vars_ori.size() == ceres_vars_pos.size());
   auto rT5 = boost::posix_time::microsec_clock::local_time();
 
+  // Hand ceres the Schur elimination ordering explicitly (features eliminated
+  // first) so it does not have to recompute one on every retried attempt
+  auto ordering = std::make_shared<ceres::ParameterBlockOrdering>();
+  for (auto const &ptr : ceres_vars_feat)
+    ordering->AddElementToGroup(ptr, 0);
+  for (size_t i = 0; i < ceres_vars_ori.size(); i++) {
+    ordering->AddElementToGroup(ceres_vars_ori.at(i), 1);
+    ordering->AddElementToGroup(ceres_vars_pos.at(i), 1);
+    ordering->AddElementToGroup(ceres_vars_vel.at(i), 1);
+    ordering->AddElementToGroup(ceres_vars_bias_g.at(i), 1);
+    ordering->AddElementToGroup(ceres_vars_bias_a.at(i), 1);
+  }
+  for (size_t i = 0; i < ceres_vars_calib_cam2imu_ori.size(); i++) {
+    ordering->AddElementToGroup(ceres_vars_calib_cam2imu_ori.at(i), 1);
+    ordering->AddElementToGroup(ceres_vars_calib_cam2imu_pos.at(i), 1);
+    ordering->AddElementToGroup(ceres_vars_calib_cam_intrinsics.at(i), 1);
+  }
+  options.linear_solver_ordering = ordering;
+
   // Optimize the ceres graph
   ceres::Solver::Summary summary;
   ceres::Solve(options, &problem, &summary);
@@ -901,11 +973,17 @@ bool DynamicInitializer::initialize(double &timestamp, Eigen::MatrixXd &covarian
   timestamp = newest_cam_time;
   if (params.init_dyn_mle_max_iter != 0 && summary.termination_type != ceres::CONVERGENCE) {
     PRINT_WARNING(YELLOW "[init-d]: opt failed: %s!\n" RESET, summary.message.c_str());
-    free_state_memory();
     return false;
   }
   PRINT_DEBUG("[init-d]: %s\n", summary.message.c_str());
 
+  // Remember the solved biases so the next attempt (if this one is later rejected)
+  // can warm start its preintegration linearization points from them
+  int index_newest = map_states.at(newest_cam_time);
+  retry_cache.have_last_biases = true;
+  retry_cache.last_bias_g << ceres_vars_bias_g[index_newest][0], ceres_vars_bias_g[index_newest][1], ceres_vars_bias_g[index_newest][2];
+  retry_cache.last_bias_a << ceres_vars_bias_a[index_newest][0], ceres_vars_bias_a[index_newest][1], ceres_vars_bias_a[index_newest][2];
+
   //======================================================
   //======================================================
 
@@ -1012,7 +1090,6 @@ bool DynamicInitializer::initialize(double &timestamp, Eigen::MatrixXd &covarian
   bool success = problem_cov.Compute(covariance_blocks, &problem);
   if (!success) {
     PRINT_WARNING(YELLOW "[init-d]: covariance recovery failed...\n" RESET);
-    free_state_memory();
     return false;
   }
 
@@ -1102,6 +1179,5 @@ bool DynamicInitializer::initialize(double &timestamp, Eigen::MatrixXd &covarian
   PRINT_DEBUG("[TIME]: %.4f sec for ceres opt\n", (rT6 - rT5).total_microseconds() * 1e-6);
   PRINT_DEBUG("[TIME]: %.4f sec for ceres covariance\n", (rT7 - rT6).total_microseconds() * 1e-6);
   PRINT_DEBUG("[TIME]: %.4f sec total for initialization\n", (rT7 - rT1).total_microseconds() * 1e-6);
-  free_state_memory();
   return true;
 }
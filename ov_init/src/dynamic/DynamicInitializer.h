@@ -23,6 +23,7 @@
 #define OV_INIT_DYNAMICINITIALIZER_H
 
 #include "init/InertialInitializerOptions.h"
+#include "utils/helper.h"
 
 namespace ov_core {
 class FeatureDatabase;
@@ -95,6 +96,43 @@ private:
 
   /// Our history of IMU messages (time, angular, linear)
   std::shared_ptr<std::vector<ov_core::ImuData>> imu_data;
+
+  /**
+   * @brief Persistent state reused across repeated initialization attempts.
+   *
+   * The ceres problem itself has to be rebuilt each attempt since the window slides
+   * and the valid feature set changes, but we keep the parameter block memory pooled
+   * (instead of thousands of new/delete pairs per retry) and warm-start the bias
+   * linearization points from the previous attempt's MLE solution. The biases are
+   * expressed in the IMU frame, so unlike the poses they carry over directly between
+   * windows and improve both the preintegration and the linear system of the retry.
+   */
+  struct RetryCache {
+
+    /// Pool of fixed-size parameter blocks (8 doubles covers our largest block)
+    std::vector<std::unique_ptr<double[]>> param_pool;
+    size_t param_pool_used = 0;
+
+    /// Biases recovered by the last converged MLE (if we have one)
+    bool have_last_biases = false;
+    Eigen::Vector3d last_bias_g, last_bias_a;
+
+    /// Get a parameter block, reusing a pooled one if available
+    double *alloc() {
+      if (param_pool_used == param_pool.size())
+        param_pool.emplace_back(new double[8]);
+      return param_pool.at(param_pool_used++).get();
+    }
+
+    /// Return all pooled blocks for the next attempt to reuse
+    void reset() { param_pool_used = 0; }
+  };
+
+  /// Cache that survives failed initialization attempts
+  RetryCache retry_cache;
+
+  /// Per-feature information blocks of the linear system, reused across attempts
+  IncrementalPriorBuilder prior_builder;
 };
 
 } // namespace ov_init
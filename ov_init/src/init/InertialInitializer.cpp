@@ -23,7 +23,9 @@
 
 #include "dynamic/DynamicInitializer.h"
 #include "static/StaticInitializer.h"
+#include "utils/helper.h"
 
+#include "feat/FeatureDatabase.h"
 #include "feat/FeatureHelper.h"
 #include "types/Type.h"
 #include "utils/colors.h"
@@ -41,16 +43,32 @@ InertialInitializer::InertialInitializer(InertialInitializerOptions &params_, st
   // Vector of our IMU data
   imu_data = std::make_shared<std::vector<ov_core::ImuData>>();
 
+  // Rolling accumulators so the static initializer's window checks are cheap
+  imu_stats = std::make_shared<ImuWindowStats>();
+
+  // Our private snapshots of the tracker database and IMU window (see initialize())
+  _db_init = std::make_shared<ov_core::FeatureDatabase>();
+  imu_data_init = std::make_shared<std::vector<ov_core::ImuData>>();
+  imu_stats_init = std::make_shared<ImuWindowStats>();
+
   // Create initializers
-  init_static = std::make_shared<StaticInitializer>(params, _db, imu_data);
-  init_dynamic = std::make_shared<DynamicInitializer>(params, _db, imu_data);
+  // Note that they work on the snapshots so the multi-hundred-ms dynamic solve
+  // does not contend with the sensor threads appending new tracks and readings
+  init_static = std::make_shared<StaticInitializer>(params, _db_init, imu_data_init, imu_stats_init);
+  init_dynamic = std::make_shared<DynamicInitializer>(params, _db_init, imu_data_init);
 }
 
 void InertialInitializer::feed_imu(const ov_core::ImuData &message, double oldest_time) {
 
+  // Lock since initialize() snapshots this window from its own thread
+  std::lock_guard<std::mutex> lck(imu_data_mtx);
+
   // Append it to our vector
   imu_data->emplace_back(message);
 
+  // Update our rolling window statistics
+  imu_stats->push(message);
+
   // Sort our imu data (handles any out of order measurements)
   // std::sort(imu_data->begin(), imu_data->end(), [](const IMUDATA i, const IMUDATA j) {
   //    return i.timestamp < j.timestamp;
@@ -67,15 +85,21 @@ void InertialInitializer::feed_imu(const ov_core::ImuData &message, double oldes
         it0++;
       }
     }
+    imu_stats->prune(oldest_time);
   }
 }
 
 bool InertialInitializer::initialize(double &timestamp, Eigen::MatrixXd &covariance, std::vector<std::shared_ptr<ov_type::Type>> &order,
                                      std::shared_ptr<ov_type::IMU> t_imu, bool wait_for_jerk) {
 
+  // Copy any new measurements into our private snapshot
+  // This is the only part of the attempt that locks the live database, so the
+  // camera thread can keep appending tracks while the solvers below run
+  _db_init->append_new_measurements(_db);
+
   // Get the newest and oldest timestamps we will try to initialize between!
   double newest_cam_time = -1;
-  for (auto const &feat : _db->get_internal_data()) {
+  for (auto const &feat : _db_init->get_internal_data()) {
     for (auto const &camtimepair : feat.second->timestamps) {
       for (auto const &time : camtimepair.second) {
         newest_cam_time = std::max(newest_cam_time, time);
@@ -89,10 +113,20 @@ bool InertialInitializer::initialize(double &timestamp, Eigen::MatrixXd &covaria
 
   // Remove all measurements that are older then our initialization window
   // Then we will try to use all features that are in the feature database!
+  // NOTE: we also cleanup the live database so its memory stays bounded while we keep failing
+  _db_init->cleanup_measurements(oldest_time);
   _db->cleanup_measurements(oldest_time);
-  auto it_imu = imu_data->begin();
-  while (it_imu != imu_data->end() && it_imu->timestamp < oldest_time + params.calib_camimu_dt) {
-    it_imu = imu_data->erase(it_imu);
+
+  // Copy the IMU window, then trim the copy to the initialization window
+  // The live window keeps being appended to by feed_imu and is trimmed there
+  {
+    std::lock_guard<std::mutex> lck(imu_data_mtx);
+    *imu_data_init = *imu_data;
+    *imu_stats_init = *imu_stats;
+  }
+  auto it_imu = imu_data_init->begin();
+  while (it_imu != imu_data_init->end() && it_imu->timestamp < oldest_time + params.calib_camimu_dt) {
+    it_imu = imu_data_init->erase(it_imu);
   }
 
   // Compute the disparity of the system at the current timestep
@@ -108,8 +142,8 @@ bool InertialInitializer::initialize(double &timestamp, Eigen::MatrixXd &covaria
     int num_features1 = 0;
     double avg_disp0, avg_disp1;
     double var_disp0, var_disp1;
-    FeatureHelper::compute_disparity(_db, avg_disp0, var_disp0, num_features0, newest_time_allowed);
-    FeatureHelper::compute_disparity(_db, avg_disp1, var_disp1, num_features1, newest_cam_time, newest_time_allowed);
+    FeatureHelper::compute_disparity(_db_init, avg_disp0, var_disp0, num_features0, newest_time_allowed);
+    FeatureHelper::compute_disparity(_db_init, avg_disp1, var_disp1, num_features1, newest_cam_time, newest_time_allowed);
 
     // Return if we can't compute the disparity
     int feat_thresh = 15;
@@ -22,6 +22,8 @@
 #ifndef OV_INIT_INERTIALINITIALIZER_H
 #define OV_INIT_INERTIALINITIALIZER_H
 
+#include <mutex>
+
 #include "init/InertialInitializerOptions.h"
 
 namespace ov_core {
@@ -37,6 +39,7 @@ namespace ov_init {
 
 class StaticInitializer;
 class DynamicInitializer;
+class ImuWindowStats;
 
 /**
  * @brief Initializer for visual-inertial system.
@@ -104,9 +107,25 @@ protected:
   /// Feature tracker database with all features in it
   std::shared_ptr<ov_core::FeatureDatabase> _db;
 
+  /// Snapshot of the tracker database each attempt solves against.
+  /// New measurements are appended at the start of initialize(), so the slow
+  /// dynamic solve never holds locks the tracker's camera thread is waiting on.
+  std::shared_ptr<ov_core::FeatureDatabase> _db_init;
+
   /// Our history of IMU messages (time, angular, linear)
   std::shared_ptr<std::vector<ov_core::ImuData>> imu_data;
 
+  /// Rolling IMU window statistics (kept in sync by feed_imu)
+  std::shared_ptr<ImuWindowStats> imu_stats;
+
+  /// Snapshot of the IMU window and statistics each attempt solves against.
+  /// Copied under imu_data_mtx, so the solvers never race feed_imu() appending.
+  std::shared_ptr<std::vector<ov_core::ImuData>> imu_data_init;
+  std::shared_ptr<ImuWindowStats> imu_stats_init;
+
+  /// Protects imu_data and imu_stats (feed_imu appends while initialize snapshots)
+  std::mutex imu_data_mtx;
+
   /// Static initialization helper class
   std::shared_ptr<StaticInitializer> init_static;
 
@@ -122,17 +122,15 @@ SimulatorInit::SimulatorInit(InertialInitializerOptions &params_) {
   //===============================================================
 
   // Load the seeds for the random number generators
-  gen_state_init = std::mt19937(params.sim_seed_state_init);
-  gen_state_init.seed(params.sim_seed_state_init);
-  gen_state_perturb = std::mt19937(params.sim_seed_preturb);
-  gen_state_perturb.seed(params.sim_seed_preturb);
-  gen_meas_imu = std::mt19937(params.sim_seed_measurements);
-  gen_meas_imu.seed(params.sim_seed_measurements);
-
-  // Create generator for our camera
+  // Each purpose gets its own counter-based stream, so any draw is a pure function of
+  // (seed, stream, counter) and the measurement noise can be generated out of order
+  gen_state_init = ov_core::CounterRNG(params.sim_seed_state_init, 0);
+  gen_state_perturb = ov_core::CounterRNG(params.sim_seed_preturb, 1);
+  gen_meas_imu = ov_core::CounterRNG(params.sim_seed_measurements, 2);
+
+  // Create generator for our camera (stream is offset by the fixed sensor streams above)
   for (int i = 0; i < params.num_cameras; i++) {
-    gen_meas_cams.push_back(std::mt19937(params.sim_seed_measurements));
-    gen_meas_cams.at(i).seed(params.sim_seed_measurements);
+    gen_meas_cams.push_back(ov_core::CounterRNG(params.sim_seed_measurements, 3 + i));
   }
 
   //===============================================================
@@ -202,16 +200,13 @@ SimulatorInit::SimulatorInit(InertialInitializerOptions &params_) {
 
 void SimulatorInit::perturb_parameters(InertialInitializerOptions &params_) {
 
-  // One std generator
-  std::normal_distribution<double> w(0, 1);
-
   // Perturb our bias
-  true_bias_accel(0) = 0.08 * w(gen_state_perturb);
-  true_bias_accel(1) = 0.08 * w(gen_state_perturb);
-  true_bias_accel(2) = 0.08 * w(gen_state_perturb);
-  true_bias_gyro(0) = 0.01 * w(gen_state_perturb);
-  true_bias_gyro(1) = 0.01 * w(gen_state_perturb);
-  true_bias_gyro(2) = 0.01 * w(gen_state_perturb);
+  true_bias_accel(0) = 0.08 * gen_state_perturb.normal();
+  true_bias_accel(1) = 0.08 * gen_state_perturb.normal();
+  true_bias_accel(2) = 0.08 * gen_state_perturb.normal();
+  true_bias_gyro(0) = 0.01 * gen_state_perturb.normal();
+  true_bias_gyro(1) = 0.01 * gen_state_perturb.normal();
+  true_bias_gyro(2) = 0.01 * gen_state_perturb.normal();
 
   // Camera IMU offset
   // params_.calib_camimu_dt = 0.005 * w(gen_state_perturb) + params.calib_camimu_dt;
@@ -321,22 +316,24 @@ bool SimulatorInit::get_next_imu(double &time_imu, Eigen::Vector3d &wm, Eigen::V
   Eigen::Vector3d accel_inI = R_GtoI * (a_IinG + gravity);
 
   // Now add noise to these measurements
+  // NOTE: the noise draws are keyed by this reading's timestamp, so they do not
+  // NOTE: depend on how many readings (or which threads) came before this one
   double dt = 1.0 / params.sim_freq_imu;
-  std::normal_distribution<double> w(0, 1);
-  wm(0) = omega_inI(0) + true_bias_gyro(0) + params.sigma_w / std::sqrt(dt) * w(gen_meas_imu);
-  wm(1) = omega_inI(1) + true_bias_gyro(1) + params.sigma_w / std::sqrt(dt) * w(gen_meas_imu);
-  wm(2) = omega_inI(2) + true_bias_gyro(2) + params.sigma_w / std::sqrt(dt) * w(gen_meas_imu);
-  am(0) = accel_inI(0) + true_bias_accel(0) + params.sigma_a / std::sqrt(dt) * w(gen_meas_imu);
-  am(1) = accel_inI(1) + true_bias_accel(1) + params.sigma_a / std::sqrt(dt) * w(gen_meas_imu);
-  am(2) = accel_inI(2) + true_bias_accel(2) + params.sigma_a / std::sqrt(dt) * w(gen_meas_imu);
+  gen_meas_imu.seek_time(timestamp_last_imu);
+  wm(0) = omega_inI(0) + true_bias_gyro(0) + params.sigma_w / std::sqrt(dt) * gen_meas_imu.normal();
+  wm(1) = omega_inI(1) + true_bias_gyro(1) + params.sigma_w / std::sqrt(dt) * gen_meas_imu.normal();
+  wm(2) = omega_inI(2) + true_bias_gyro(2) + params.sigma_w / std::sqrt(dt) * gen_meas_imu.normal();
+  am(0) = accel_inI(0) + true_bias_accel(0) + params.sigma_a / std::sqrt(dt) * gen_meas_imu.normal();
+  am(1) = accel_inI(1) + true_bias_accel(1) + params.sigma_a / std::sqrt(dt) * gen_meas_imu.normal();
+  am(2) = accel_inI(2) + true_bias_accel(2) + params.sigma_a / std::sqrt(dt) * gen_meas_imu.normal();
 
   // Move the biases forward in time
-  true_bias_gyro(0) += params.sigma_wb * std::sqrt(dt) * w(gen_meas_imu);
-  true_bias_gyro(1) += params.sigma_wb * std::sqrt(dt) * w(gen_meas_imu);
-  true_bias_gyro(2) += params.sigma_wb * std::sqrt(dt) * w(gen_meas_imu);
-  true_bias_accel(0) += params.sigma_ab * std::sqrt(dt) * w(gen_meas_imu);
-  true_bias_accel(1) += params.sigma_ab * std::sqrt(dt) * w(gen_meas_imu);
-  true_bias_accel(2) += params.sigma_ab * std::sqrt(dt) * w(gen_meas_imu);
+  true_bias_gyro(0) += params.sigma_wb * std::sqrt(dt) * gen_meas_imu.normal();
+  true_bias_gyro(1) += params.sigma_wb * std::sqrt(dt) * gen_meas_imu.normal();
+  true_bias_gyro(2) += params.sigma_wb * std::sqrt(dt) * gen_meas_imu.normal();
+  true_bias_accel(0) += params.sigma_ab * std::sqrt(dt) * gen_meas_imu.normal();
+  true_bias_accel(1) += params.sigma_ab * std::sqrt(dt) * gen_meas_imu.normal();
+  true_bias_accel(2) += params.sigma_ab * std::sqrt(dt) * gen_meas_imu.normal();
 
   // Append the current true bias to our history
   hist_true_bias_time.push_back(timestamp_last_imu);
@@ -394,10 +391,12 @@ bool SimulatorInit::get_next_cam(double &time_cam, std::vector<int> &camids,
     }
 
     // Loop through and add noise to each uv measurement
-    std::normal_distribution<double> w(0, 1);
+    // The draws are keyed by this frame's timestamp, so each frame's noise is
+    // independent of every other frame and can be generated in parallel
+    gen_meas_cams.at(i).seek_time(timestamp_last_cam);
     for (size_t j = 0; j < uvs.size(); j++) {
-      uvs.at(j).second(0) += params.sigma_pix * w(gen_meas_cams.at(i));
-      uvs.at(j).second(1) += params.sigma_pix * w(gen_meas_cams.at(i));
+      uvs.at(j).second(0) += params.sigma_pix * gen_meas_cams.at(i).normal();
+      uvs.at(j).second(1) += params.sigma_pix * gen_meas_cams.at(i).normal();
     }
 
     // Push back for this camera
@@ -475,10 +474,8 @@ void SimulatorInit::generate_points(const Eigen::Matrix3d &R_GtoI, const Eigen::
   for (int i = 0; i < numpts; i++) {
 
     // Uniformly randomly generate within our fov
-    std::uniform_real_distribution<double> gen_u(0, camera->w());
-    std::uniform_real_distribution<double> gen_v(0, camera->h());
-    double u_dist = gen_u(gen_state_init);
-    double v_dist = gen_v(gen_state_init);
+    double u_dist = gen_state_init.uniform(0, camera->w());
+    double v_dist = gen_state_init.uniform(0, camera->h());
 
     // Convert to opencv format
     cv::Point2f uv_dist((float)u_dist, (float)v_dist);
@@ -488,8 +485,7 @@ void SimulatorInit::generate_points(const Eigen::Matrix3d &R_GtoI, const Eigen::
     uv_norm = camera->undistort_cv(uv_dist);
 
     // Generate a random depth
-    std::uniform_real_distribution<double> gen_depth(params.sim_min_feature_gen_distance, params.sim_max_feature_gen_distance);
-    double depth = gen_depth(gen_state_init);
+    double depth = gen_state_init.uniform(params.sim_min_feature_gen_distance, params.sim_max_feature_gen_distance);
 
     // Get the 3d point
     Eigen::Vector3d bearing;
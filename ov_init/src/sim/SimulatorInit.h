@@ -25,12 +25,12 @@
 #include <Eigen/Eigen>
 #include <fstream>
 #include <opencv2/core/core.hpp>
-#include <random>
 #include <sstream>
 #include <string>
 #include <unordered_map>
 
 #include "init/InertialInitializerOptions.h"
+#include "utils/counter_rng.h"
 
 namespace ov_core {
 class BsplineSE3;
@@ -152,17 +152,17 @@ protected:
   size_t id_map = 0;
   std::unordered_map<size_t, Eigen::Vector3d> featmap;
 
-  /// Mersenne twister PRNG for measurements (IMU)
-  std::mt19937 gen_meas_imu;
+  /// Counter-based PRNG for measurements (IMU), re-keyed by each reading's timestamp
+  ov_core::CounterRNG gen_meas_imu;
 
-  /// Mersenne twister PRNG for measurements (CAMERAS)
-  std::vector<std::mt19937> gen_meas_cams;
+  /// Counter-based PRNGs for measurements (CAMERAS), re-keyed by each frame's timestamp
+  std::vector<ov_core::CounterRNG> gen_meas_cams;
 
-  /// Mersenne twister PRNG for state initialization
-  std::mt19937 gen_state_init;
+  /// Counter-based PRNG for feature map generation
+  ov_core::CounterRNG gen_state_init;
 
-  /// Mersenne twister PRNG for state perturbations
-  std::mt19937 gen_state_perturb;
+  /// Counter-based PRNG for state perturbations
+  ov_core::CounterRNG gen_state_perturb;
 
   /// If our simulation is running
   bool is_running;
@@ -52,49 +52,23 @@ bool StaticInitializer::initialize(double &timestamp, Eigen::MatrixXd &covarianc
     return false;
   }
 
-  // First lets collect a window of IMU readings from the newest measurement to the oldest
-  std::vector<ImuData> window_1to0, window_2to1;
-  for (const ImuData &data : *imu_data) {
-    if (data.timestamp > newesttime - 0.5 * params.init_window_time && data.timestamp <= newesttime - 0.0 * params.init_window_time) {
-      window_1to0.push_back(data);
-    }
-    if (data.timestamp > newesttime - 1.0 * params.init_window_time && data.timestamp <= newesttime - 0.5 * params.init_window_time) {
-      window_2to1.push_back(data);
-    }
-  }
+  // Query the rolling accumulators for the two half windows of IMU readings
+  // These are maintained as the readings arrive, so each check here is constant
+  // time instead of re-summing thousands of samples while we idle at standstill
+  int count_1to0 = 0, count_2to1 = 0;
+  double time_last_1to0 = 0.0, time_last_2to1 = 0.0;
+  Eigen::Vector3d a_avg_1to0, w_avg_1to0, a_avg_2to1, w_avg_2to1;
+  double a_var_1to0 = 0.0, a_var_2to1 = 0.0;
+  bool have_1to0 =
+      imu_stats->window(newesttime - 0.5 * params.init_window_time, newesttime, count_1to0, time_last_1to0, a_avg_1to0, w_avg_1to0, a_var_1to0);
+  bool have_2to1 = imu_stats->window(newesttime - 1.0 * params.init_window_time, newesttime - 0.5 * params.init_window_time, count_2to1,
+                                     time_last_2to1, a_avg_2to1, w_avg_2to1, a_var_2to1);
 
   // Return if both of these failed
-  if (window_1to0.size() < 2 || window_2to1.size() < 2) {
+  if (!have_1to0 || !have_2to1) {
     PRINT_INFO(YELLOW "[init-s]: unable to select window of IMU readings, not enough readings\n" RESET);
     return false;
   }
-
-  // Calculate the sample variance for the newest window from 1 to 0
-  Eigen::Vector3d a_avg_1to0 = Eigen::Vector3d::Zero();
-  for (const ImuData &data : window_1to0) {
-    a_avg_1to0 += data.am;
-  }
-  a_avg_1to0 /= (int)window_1to0.size();
-  double a_var_1to0 = 0;
-  for (const ImuData &data : window_1to0) {
-    a_var_1to0 += (data.am - a_avg_1to0).dot(data.am - a_avg_1to0);
-  }
-  a_var_1to0 = std::sqrt(a_var_1to0 / ((int)window_1to0.size() - 1));
-
-  // Calculate the sample variance for the second newest window from 2 to 1
-  Eigen::Vector3d a_avg_2to1 = Eigen::Vector3d::Zero();
-  Eigen::Vector3d w_avg_2to1 = Eigen::Vector3d::Zero();
-  for (const ImuData &data : window_2to1) {
-    a_avg_2to1 += data.am;
-    w_avg_2to1 += data.wm;
-  }
-  a_avg_2to1 = a_avg_2to1 / window_2to1.size();
-  w_avg_2to1 = w_avg_2to1 / window_2to1.size();
-  double a_var_2to1 = 0;
-  for (const ImuData &data : window_2to1) {
-    a_var_2to1 += (data.am - a_avg_2to1).dot(data.am - a_avg_2to1);
-  }
-  a_var_2to1 = std::sqrt(a_var_2to1 / ((int)window_2to1.size() - 1));
   PRINT_DEBUG(YELLOW "[init-s]: IMU excitation stats: %.3f,%.3f\n" RESET, a_var_2to1, a_var_1to0);
 
   // If it is below the threshold and we want to wait till we detect a jerk
@@ -131,7 +105,7 @@ bool StaticInitializer::initialize(double &timestamp, Eigen::MatrixXd &covarianc
   Eigen::Vector3d ba = a_avg_2to1 - quat_2_Rot(q_GtoI) * gravity_inG;
 
   // Set our state variables
-  timestamp = window_2to1.at(window_2to1.size() - 1).timestamp;
+  timestamp = time_last_2to1;
   Eigen::VectorXd imu_state = Eigen::VectorXd::Zero(16);
   imu_state.block(0, 0, 4, 1) = q_GtoI;
   imu_state.block(10, 0, 3, 1) = bg;
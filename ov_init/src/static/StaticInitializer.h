@@ -23,6 +23,7 @@
 #define OV_INIT_STATICINITIALIZER_H
 
 #include "init/InertialInitializerOptions.h"
+#include "utils/helper.h"
 
 namespace ov_core {
 class FeatureDatabase;
@@ -55,10 +56,11 @@ public:
    * @param params_ Parameters loaded from either ROS or CMDLINE
    * @param db Feature tracker database with all features in it
    * @param imu_data_ Shared pointer to our IMU vector of historical information
+   * @param imu_stats_ Shared pointer to the rolling IMU window statistics
    */
   explicit StaticInitializer(InertialInitializerOptions &params_, std::shared_ptr<ov_core::FeatureDatabase> db,
-                             std::shared_ptr<std::vector<ov_core::ImuData>> imu_data_)
-      : params(params_), _db(db), imu_data(imu_data_) {}
+                             std::shared_ptr<std::vector<ov_core::ImuData>> imu_data_, std::shared_ptr<ImuWindowStats> imu_stats_)
+      : params(params_), _db(db), imu_data(imu_data_), imu_stats(imu_stats_) {}
 
   /**
    * @brief Try to get the initialized system using just the imu
@@ -90,6 +92,9 @@ private:
 
   /// Our history of IMU messages (time, angular, linear)
   std::shared_ptr<std::vector<ov_core::ImuData>> imu_data;
+
+  /// Rolling IMU window statistics maintained as readings arrive
+  std::shared_ptr<ImuWindowStats> imu_stats;
 };
 
 } // namespace ov_init
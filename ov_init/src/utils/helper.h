@@ -22,6 +22,11 @@
 #ifndef OV_INIT_HELPER
 #define OV_INIT_HELPER
 
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <unordered_map>
+
 #include "cpi/CpiV1.h"
 #include "types/IMU.h"
 
@@ -318,6 +323,158 @@ public:
     return coeff;
   }
 };
+
+/**
+ * @brief Rolling accumulators over the IMU history for constant-time window statistics.
+ *
+ * Each appended reading stores the cumulative sum of the accelerometer vector, its
+ * squared norm, and the gyroscope vector, so the mean and sample variance over any
+ * time window can be recovered from two binary searches and a subtraction instead
+ * of re-summing every reading in the window. This keeps the standstill checks of
+ * the static initializer cheap while we idle at high IMU rates.
+ */
+class ImuWindowStats {
+
+public:
+  /// Append the next (in-order) IMU reading to the accumulators
+  void push(const ov_core::ImuData &message) {
+    Sample sample;
+    sample.timestamp = message.timestamp;
+    if (samples.empty()) {
+      sample.sum_a = message.am;
+      sample.sum_w = message.wm;
+      sample.sum_aa = message.am.dot(message.am);
+    } else {
+      sample.sum_a = samples.back().sum_a + message.am;
+      sample.sum_w = samples.back().sum_w + message.wm;
+      sample.sum_aa = samples.back().sum_aa + message.am.dot(message.am);
+    }
+    samples.push_back(sample);
+  }
+
+  /// Drop accumulators for readings older than the requested time (bounds memory only)
+  void prune(double oldest_time) {
+    while (!samples.empty() && samples.front().timestamp < oldest_time)
+      samples.pop_front();
+  }
+
+  /**
+   * @brief Statistics of the readings in the window (time0, time1].
+   *
+   * @param time0 Exclusive start of the window
+   * @param time1 Inclusive end of the window
+   * @param[out] count Number of readings in the window
+   * @param[out] time_last Timestamp of the last reading in the window
+   * @param[out] a_avg Mean accelerometer reading
+   * @param[out] w_avg Mean gyroscope reading
+   * @param[out] a_var Sample standard deviation of the accelerometer readings
+   * @return False if there are under two readings in the window
+   */
+  bool window(double time0, double time1, int &count, double &time_last, Eigen::Vector3d &a_avg, Eigen::Vector3d &w_avg,
+              double &a_var) const {
+
+    // Find the first sample after time0, and one past the last sample at or before time1
+    auto compare = [](double time, const Sample &sample) { return time < sample.timestamp; };
+    auto it0 = std::upper_bound(samples.begin(), samples.end(), time0, compare);
+    auto it1 = std::upper_bound(samples.begin(), samples.end(), time1, compare);
+    count = (int)(it1 - it0);
+    if (count < 2)
+      return false;
+
+    // Range sums are the difference of the cumulative sums at the window edges
+    Eigen::Vector3d sum_a = (it1 - 1)->sum_a;
+    Eigen::Vector3d sum_w = (it1 - 1)->sum_w;
+    double sum_aa = (it1 - 1)->sum_aa;
+    if (it0 != samples.begin()) {
+      sum_a -= (it0 - 1)->sum_a;
+      sum_w -= (it0 - 1)->sum_w;
+      sum_aa -= (it0 - 1)->sum_aa;
+    }
+
+    // Sample variance via sum(||a||^2) - n*||a_avg||^2
+    time_last = (it1 - 1)->timestamp;
+    a_avg = sum_a / count;
+    w_avg = sum_w / count;
+    a_var = std::sqrt(std::max(0.0, sum_aa - count * a_avg.dot(a_avg)) / (count - 1));
+    return true;
+  }
+
+private:
+  /// Cumulative accumulators up to and including one IMU reading
+  struct Sample {
+    double timestamp = 0.0;
+    Eigen::Vector3d sum_a = Eigen::Vector3d::Zero();
+    Eigen::Vector3d sum_w = Eigen::Vector3d::Zero();
+    double sum_aa = 0.0;
+  };
+
+  /// Accumulators for our history of IMU readings (pruned from the front)
+  std::deque<Sample> samples;
+};
+
+/**
+ * @brief Caches the dynamic initializer's per-feature information blocks across attempts.
+ *
+ * The linear system of the dynamic initializer never couples two features, so its
+ * normal equations decompose into additive per-feature blocks over the local ordering
+ * [feature, velocity, gravity]. This cache keys those blocks by feature id and the
+ * exact measurement set that produced them: a retried attempt that shares the same
+ * window anchor and bias linearization reuses the blocks of unchanged features and
+ * recomputes only those with arriving measurements, while departing features are
+ * simply dropped (the downdate), instead of restacking and re-multiplying the full
+ * dense system. The factorization of the assembled matrix itself cannot be carried
+ * over since features enter and leave the state (its dimension changes), but the
+ * expensive part -- the Jacobian products over every measurement row -- is reused.
+ */
+class IncrementalPriorBuilder {
+
+public:
+  /// One feature's additive contribution to the normal equations
+  struct Contribution {
+    /// The (camera id, timestamp) measurements the blocks were built from
+    std::vector<std::pair<size_t, double>> meas;
+    /// Accumulated H^T H over this feature's rows ([feature, velocity, gravity] ordering)
+    Eigen::Matrix<double, 9, 9> G = Eigen::Matrix<double, 9, 9>::Zero();
+    /// Accumulated H^T b over this feature's rows
+    Eigen::Matrix<double, 9, 1> w = Eigen::Matrix<double, 9, 1>::Zero();
+  };
+
+  /// Invalidate the cache if the window anchor or bias linearization points changed
+  void set_epoch(double anchor_time, const Eigen::Vector3d &bias_g, const Eigen::Vector3d &bias_a) {
+    if (anchor_time == epoch_anchor && bias_g == epoch_bias_g && bias_a == epoch_bias_a)
+      return;
+    cache.clear();
+    epoch_anchor = anchor_time;
+    epoch_bias_g = bias_g;
+    epoch_bias_a = bias_a;
+  }
+
+  /// Cached contribution of a feature, or nullptr if its measurement set changed (safe to call concurrently)
+  const Contribution *lookup(size_t featid, const std::vector<std::pair<size_t, double>> &meas) const {
+    auto it = cache.find(featid);
+    return (it != cache.end() && it->second.meas == meas) ? &it->second : nullptr;
+  }
+
+  /// Store a freshly computed contribution (only call between attempts, never during lookups)
+  void store(size_t featid, const Contribution &contrib) { cache[featid] = contrib; }
+
+  /// Drop features that have left the window so their information departs with them
+  void prune(const std::map<size_t, int> &active) {
+    for (auto it = cache.begin(); it != cache.end();) {
+      it = (active.find(it->first) == active.end()) ? cache.erase(it) : std::next(it);
+    }
+  }
+
+private:
+  /// Linearization the cached blocks are valid for
+  double epoch_anchor = -1;
+  Eigen::Vector3d epoch_bias_g = Eigen::Vector3d::Zero();
+  Eigen::Vector3d epoch_bias_a = Eigen::Vector3d::Zero();
+
+  /// Cached contributions keyed by feature id
+  std::unordered_map<size_t, Contribution> cache;
+};
+
 } // namespace ov_init
 
 #endif /* OV_INIT_HELPER */
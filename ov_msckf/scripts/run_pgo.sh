@@ -0,0 +1,49 @@
+#!/usr/bin/env bash
+
+# Two-phase profile-guided optimization build of the whole workspace.
+#
+# Phase one builds instrumented binaries, then replays a representative slice through
+# them to collect profiles: a serial bag replay if a bag is given (closest to the
+# deployed workload), otherwise the simulator with a fixed seed so the profiles are
+# reproducible from a clean checkout. Phase two rebuilds optimized against the
+# collected profiles. Run again after pulling to refresh the release binaries.
+#
+# usage: ./run_pgo.sh                         (collect profiles on the simulator)
+#        ./run_pgo.sh <config> <dataset.bag>  (collect profiles on a serial bag replay)
+
+set -e
+
+# Source our workspace directory to load ENV variables
+SCRIPT_DIR="$( cd -- "$( dirname -- "${BASH_SOURCE[0]}" )" &> /dev/null && pwd )"
+WORKSPACE_DIR="${SCRIPT_DIR}/../../../.."
+
+# start timing
+big_start_time="$(date -u +%s)"
+
+# Phase one: instrumented build (the flags cover ov_core, ov_init and ov_msckf)
+cd ${WORKSPACE_DIR}
+catkin_make -DENABLE_PGO_GENERATE=ON -DENABLE_PGO_USE=OFF
+source ${WORKSPACE_DIR}/devel/setup.bash
+
+# Replay the representative slice to fill the profiles
+# serial=read from bag (fast), otherwise a deterministic simulation run
+if [ "$#" -ge 2 ]; then
+  roslaunch ov_msckf serial.launch \
+    config:="$1" \
+    bag:="$2" \
+    dobag:="true" \
+    verbosity:="WARNING"
+else
+  roslaunch ov_msckf simulation.launch \
+    verbosity:="WARNING" \
+    seed:="1" \
+    dataset:="udel_gore.txt"
+fi
+
+# Phase two: rebuild optimized against the collected profiles
+catkin_make -DENABLE_PGO_GENERATE=OFF -DENABLE_PGO_USE=ON
+
+# print out the time elapsed
+big_end_time="$(date -u +%s)"
+elapsed="$(($big_end_time-$big_start_time))"
+echo "BASH: PGO build took $elapsed seconds";
@@ -0,0 +1,258 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2018-2023 Patrick Geneva
+ * Copyright (C) 2018-2023 Guoquan Huang
+ * Copyright (C) 2018-2023 OpenVINS Contributors
+ * Copyright (C) 2018-2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "FixedLagSmoother.h"
+
+#include "state/State.h"
+#include "types/PoseJPL.h"
+#include "utils/print.h"
+#include "utils/quat_ops.h"
+#include "utils/thread_registry.h"
+
+using namespace ov_core;
+using namespace ov_msckf;
+
+FixedLagSmoother::FixedLagSmoother(double lag_) : lag(lag_) {
+  thread_worker = std::thread(&FixedLagSmoother::worker, this);
+}
+
+FixedLagSmoother::~FixedLagSmoother() {
+  {
+    std::lock_guard<std::mutex> lck(snapshot_mtx);
+    should_stop = true;
+  }
+  snapshot_cv.notify_all();
+  if (thread_worker.joinable()) {
+    thread_worker.join();
+  }
+}
+
+void FixedLagSmoother::feed_clones(std::shared_ptr<State> state) {
+
+  // Copy the window (a handful of 7-vectors, so this is cheap on the filter thread)
+  CloneSnapshot snapshot;
+  snapshot.reserve(state->_clones_IMU.size());
+  for (const auto &clone : state->_clones_IMU) {
+    Eigen::Matrix<double, 7, 1> pose;
+    pose.block(0, 0, 4, 1) = clone.second->quat();
+    pose.block(4, 0, 3, 1) = clone.second->pos();
+    snapshot.push_back({clone.first, pose});
+  }
+  if (snapshot.empty())
+    return;
+
+  // Hand it to the worker
+  {
+    std::lock_guard<std::mutex> lck(snapshot_mtx);
+    snapshot_queue.push_back(std::move(snapshot));
+  }
+  snapshot_cv.notify_one();
+}
+
+std::vector<std::pair<double, Eigen::Matrix<double, 7, 1>>> FixedLagSmoother::pop_smoothed_poses() {
+  std::lock_guard<std::mutex> lck(smoothed_mtx);
+  std::vector<std::pair<double, Eigen::Matrix<double, 7, 1>>> poses;
+  poses.swap(smoothed_poses);
+  return poses;
+}
+
+void FixedLagSmoother::worker() {
+  ThreadRegistry::register_thread("smoother");
+  while (true) {
+
+    // Wait for new snapshots (or shutdown)
+    std::deque<CloneSnapshot> snapshots;
+    {
+      std::unique_lock<std::mutex> lck(snapshot_mtx);
+      snapshot_cv.wait(lck, [&] { return should_stop || !snapshot_queue.empty(); });
+      if (should_stop && snapshot_queue.empty())
+        return;
+      snapshots.swap(snapshot_queue);
+    }
+
+    // Ingest everything that queued up, then refine once
+    for (const auto &snapshot : snapshots) {
+      ingest(snapshot);
+    }
+    optimize();
+    finalize();
+  }
+}
+
+void FixedLagSmoother::ingest(const CloneSnapshot &snapshot) {
+
+  // Update (or create) the node for each clone still in the filter window
+  // The prior is always overwritten, so a node's prior ends up being the last
+  // estimate the filter had of it before it was marginalized
+  for (const auto &clonepair : snapshot) {
+    Node &node = nodes[clonepair.first];
+    node.R = quat_2_Rot(clonepair.second.block(0, 0, 4, 1));
+    node.p = clonepair.second.block(4, 0, 3, 1);
+    node.R_prior = node.R;
+    node.p_prior = node.p;
+    node.active = true;
+  }
+
+  // Any node we did not just see has been marginalized, freeze its prior
+  double oldest_in_window = snapshot.front().first;
+  for (auto &nodepair : nodes) {
+    if (nodepair.first < oldest_in_window) {
+      nodepair.second.active = false;
+    }
+  }
+
+  // Re-harvest the relative edges between consecutive clones of this window
+  // These keep improving until the older endpoint leaves the window, which is
+  // exactly the information the refinement pushes back into marginalized nodes
+  for (size_t i = 1; i < snapshot.size(); i++) {
+    Eigen::Matrix3d R_GtoA = quat_2_Rot(snapshot.at(i - 1).second.block(0, 0, 4, 1));
+    Eigen::Matrix3d R_GtoB = quat_2_Rot(snapshot.at(i).second.block(0, 0, 4, 1));
+    Eigen::Vector3d p_AinG = snapshot.at(i - 1).second.block(4, 0, 3, 1);
+    Eigen::Vector3d p_BinG = snapshot.at(i).second.block(4, 0, 3, 1);
+    Edge &edge = edges[snapshot.at(i - 1).first];
+    edge.R_AtoB = R_GtoB * R_GtoA.transpose();
+    edge.p_BinA = R_GtoA * (p_BinG - p_AinG);
+  }
+}
+
+void FixedLagSmoother::optimize() {
+
+  // Collect the free variables (marginalized nodes), active clones are held fixed
+  // since the filter itself is still refining them with new measurements
+  std::map<double, int> var_index;
+  for (const auto &nodepair : nodes) {
+    if (!nodepair.second.active) {
+      int index = 6 * (int)var_index.size();
+      var_index.insert({nodepair.first, index});
+    }
+  }
+  if (var_index.empty())
+    return;
+  int total_size = 6 * (int)var_index.size();
+
+  // Relative edges carry the post-marginalization information, so they are weighted
+  // above the priors (heuristic, we do not harvest covariances from the filter to
+  // keep the per-frame hook on the filter thread trivially cheap)
+  double w_prior = 1.0;
+  double w_rel = 10.0;
+
+  // A couple of Gauss-Newton iterations is plenty, the filter estimates are near-optimal
+  for (int iter = 0; iter < 3; iter++) {
+
+    Eigen::MatrixXd Hess = Eigen::MatrixXd::Zero(total_size, total_size);
+    Eigen::VectorXd grad = Eigen::VectorXd::Zero(total_size);
+
+    // Prior residuals (perturbation is R' = exp(-dth)*R, p' = p + dp, so the
+    // rotation Jacobian is -I and the position Jacobian is I)
+    for (const auto &varpair : var_index) {
+      const Node &node = nodes.at(varpair.first);
+      Eigen::Vector3d r_th = log_so3(node.R * node.R_prior.transpose());
+      Eigen::Vector3d r_p = node.p - node.p_prior;
+      Hess.block(varpair.second, varpair.second, 6, 6) += w_prior * Eigen::Matrix<double, 6, 6>::Identity();
+      grad.segment(varpair.second, 3) += w_prior * r_th;
+      grad.segment(varpair.second + 3, 3) -= w_prior * r_p;
+    }
+
+    // Relative edge residuals between each node and its time-successor
+    for (const auto &edgepair : edges) {
+      auto it_a = nodes.find(edgepair.first);
+      if (it_a == nodes.end())
+        continue;
+      auto it_b = std::next(it_a);
+      if (it_b == nodes.end())
+        continue;
+      const Node &node_a = it_a->second;
+      const Node &node_b = it_b->second;
+      bool free_a = !node_a.active;
+      bool free_b = !node_b.active;
+      if (!free_a && !free_b)
+        continue;
+
+      // Residuals of the current estimates against the harvested measurement
+      const Edge &edge = edgepair.second;
+      Eigen::Vector3d d_AtoB = node_b.p - node_a.p;
+      Eigen::Vector3d r_th = log_so3(node_b.R * node_a.R.transpose() * edge.R_AtoB.transpose());
+      Eigen::Vector3d r_p = node_a.R * d_AtoB - edge.p_BinA;
+
+      // Jacobians in the same perturbation convention as the priors
+      // J_th wrt a is R_AtoB, wrt b is -I; J_p wrt dp is -/+R_a and wrt dth_a is skew(R_a*d)
+      Eigen::Matrix<double, 6, 6> J_a = Eigen::Matrix<double, 6, 6>::Zero();
+      J_a.block(0, 0, 3, 3) = edge.R_AtoB;
+      J_a.block(3, 0, 3, 3) = skew_x(node_a.R * d_AtoB);
+      J_a.block(3, 3, 3, 3) = -node_a.R;
+      Eigen::Matrix<double, 6, 6> J_b = Eigen::Matrix<double, 6, 6>::Zero();
+      J_b.block(0, 0, 3, 3) = -Eigen::Matrix3d::Identity();
+      J_b.block(3, 3, 3, 3) = node_a.R;
+      Eigen::Matrix<double, 6, 1> res;
+      res.segment(0, 3) = r_th;
+      res.segment(3, 3) = r_p;
+
+      // Accumulate the normal equations, skipping the columns of fixed nodes
+      int index_a = (free_a) ? var_index.at(it_a->first) : -1;
+      int index_b = (free_b) ? var_index.at(it_b->first) : -1;
+      if (free_a) {
+        Hess.block(index_a, index_a, 6, 6) += w_rel * J_a.transpose() * J_a;
+        grad.segment(index_a, 6) -= w_rel * J_a.transpose() * res;
+      }
+      if (free_b) {
+        Hess.block(index_b, index_b, 6, 6) += w_rel * J_b.transpose() * J_b;
+        grad.segment(index_b, 6) -= w_rel * J_b.transpose() * res;
+      }
+      if (free_a && free_b) {
+        Eigen::Matrix<double, 6, 6> cross = w_rel * J_a.transpose() * J_b;
+        Hess.block(index_a, index_b, 6, 6) += cross;
+        Hess.block(index_b, index_a, 6, 6) += cross.transpose();
+      }
+    }
+
+    // Solve and apply the correction (priors make the system well conditioned)
+    Eigen::VectorXd dx = Hess.ldlt().solve(grad);
+    for (const auto &varpair : var_index) {
+      Node &node = nodes.at(varpair.first);
+      Eigen::Vector3d dth = dx.segment(varpair.second, 3);
+      Eigen::Vector3d dp = dx.segment(varpair.second + 3, 3);
+      node.R = exp_so3(-dth) * node.R;
+      node.p += dp;
+    }
+  }
+}
+
+void FixedLagSmoother::finalize() {
+
+  // Nothing to do until we actually have a window
+  if (nodes.empty())
+    return;
+  double newest_time = nodes.rbegin()->first;
+
+  // Pop refined poses off the old end of the graph once they are behind the lag
+  std::lock_guard<std::mutex> lck(smoothed_mtx);
+  while (!nodes.empty()) {
+    auto it = nodes.begin();
+    if (it->second.active || it->first > newest_time - lag)
+      break;
+    Eigen::Matrix<double, 7, 1> pose;
+    pose.block(0, 0, 4, 1) = rot_2_quat(it->second.R);
+    pose.block(4, 0, 3, 1) = it->second.p;
+    smoothed_poses.push_back({it->first, pose});
+    edges.erase(it->first);
+    nodes.erase(it);
+  }
+}
@@ -0,0 +1,140 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2018-2023 Patrick Geneva
+ * Copyright (C) 2018-2023 Guoquan Huang
+ * Copyright (C) 2018-2023 OpenVINS Contributors
+ * Copyright (C) 2018-2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OV_MSCKF_FIXEDLAGSMOOTHER_H
+#define OV_MSCKF_FIXEDLAGSMOOTHER_H
+
+#include <Eigen/Eigen>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace ov_msckf {
+
+class State;
+
+/**
+ * @brief Asynchronous fixed-lag smoother layered over the filter output.
+ *
+ * The filter remains the real-time path, while this class refines poses a few seconds
+ * behind real time on a spare core. After each update (right before the oldest clone is
+ * destroyed) the filter thread feeds a cheap snapshot of the clone window. From these
+ * snapshots we maintain a small pose graph:
+ * - Each clone becomes a node whose prior is its *last* filter estimate (i.e. the best
+ *   estimate the filter ever had of it, taken just before marginalization).
+ * - Consecutive clones are linked by relative-pose edges that are re-harvested from every
+ *   snapshot, so edges touching still-active clones keep absorbing information that
+ *   arrived after their older endpoint was marginalized.
+ *
+ * A Gauss-Newton pass over the marginalized nodes (active clones are held fixed, since
+ * the filter is still improving them) then propagates that newer information backwards.
+ * Nodes that fall behind the requested lag are finalized and can be retrieved with
+ * pop_smoothed_poses() for publishing or logging.
+ */
+class FixedLagSmoother {
+
+public:
+  /**
+   * @brief Default constructor, starts the background worker
+   * @param lag_ How many seconds behind the newest clone a pose is finalized
+   */
+  explicit FixedLagSmoother(double lag_);
+
+  ~FixedLagSmoother();
+
+  /**
+   * @brief Feed the current clone window into the smoother.
+   *
+   * This should be called on the filter thread after the update, right before
+   * StateHelper::marginalize_old_clone() destroys the oldest clone, so the dying
+   * clone's final estimate is captured. Only copies a handful of poses, the actual
+   * smoothing happens on the worker thread.
+   *
+   * @param state State of the filter whose clone window we snapshot
+   */
+  void feed_clones(std::shared_ptr<State> state);
+
+  /**
+   * @brief Retrieve (and clear) the poses that have been finalized.
+   * @return Pairs of (timestamp, pose) where the pose is [q_GtoI; p_IinG] in JPL order
+   */
+  std::vector<std::pair<double, Eigen::Matrix<double, 7, 1>>> pop_smoothed_poses();
+
+protected:
+  /// One snapshot of the filter's clone window: (timestamp, [q_GtoI; p_IinG]) in time order
+  typedef std::vector<std::pair<double, Eigen::Matrix<double, 7, 1>>> CloneSnapshot;
+
+  /// A pose node in our graph (estimate being refined, and its frozen filter prior)
+  struct Node {
+    Eigen::Matrix3d R;       // current estimate of R_GtoI
+    Eigen::Vector3d p;       // current estimate of p_IinG
+    Eigen::Matrix3d R_prior; // last filter estimate of R_GtoI
+    Eigen::Vector3d p_prior; // last filter estimate of p_IinG
+    bool active = true;      // true while the clone is still in the filter window
+  };
+
+  /// Relative-pose edge from a node to its successor in time
+  struct Edge {
+    Eigen::Matrix3d R_AtoB;  // measured relative rotation
+    Eigen::Vector3d p_BinA;  // measured position of the successor in the older frame
+  };
+
+  /// Background worker that ingests snapshots and runs the refinement
+  void worker();
+
+  /// Ingest one snapshot (updates priors, relative edges, and the active set)
+  void ingest(const CloneSnapshot &snapshot);
+
+  /// Gauss-Newton refinement over the marginalized nodes (active ones held fixed)
+  void optimize();
+
+  /// Move nodes that are older than the lag into the output buffer
+  void finalize();
+
+  /// How many seconds behind the newest clone a pose is finalized
+  double lag;
+
+  /// Our graph of pose nodes, and the edge from each node to its time-successor
+  std::map<double, Node> nodes;
+  std::map<double, Edge> edges;
+
+  /// Snapshots waiting to be ingested by the worker
+  std::deque<CloneSnapshot> snapshot_queue;
+  std::mutex snapshot_mtx;
+  std::condition_variable snapshot_cv;
+
+  /// Finalized poses waiting to be popped by the consumer
+  std::vector<std::pair<double, Eigen::Matrix<double, 7, 1>>> smoothed_poses;
+  std::mutex smoothed_mtx;
+
+  /// Worker thread and its shutdown flag
+  std::thread thread_worker;
+  bool should_stop = false;
+};
+
+} // namespace ov_msckf
+
+#endif // OV_MSCKF_FIXEDLAGSMOOTHER_H
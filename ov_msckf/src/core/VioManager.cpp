@@ -30,16 +30,22 @@
 #include "track/TrackSIM.h"
 #include "types/Landmark.h"
 #include "types/LandmarkRepresentation.h"
-#include "utils/opencv_lambda_body.h"
+#include "utils/alloc_audit.h"
+#include "utils/memory_arena.h"
 #include "utils/print.h"
 #include "utils/sensor_data.h"
+#include "utils/thread_pool.h"
+#include "utils/thread_registry.h"
+#include "utils/tracer.h"
 
 #include "init/InertialInitializer.h"
 
+#include "core/FixedLagSmoother.h"
 #include "state/Propagator.h"
 #include "state/State.h"
 #include "state/StateHelper.h"
 #include "update/UpdaterGlobal.h"
+#include "update/UpdaterJacobianEngine.h"
 #include "update/UpdaterMSCKF.h"
 #include "update/UpdaterSLAM.h"
 #include "update/UpdaterZeroVelocity.h"
@@ -48,7 +54,8 @@ using namespace ov_core;
 using namespace ov_type;
 using namespace ov_msckf;
 
-VioManager::VioManager(VioManagerOptions &params_) : thread_init_running(false), thread_init_success(false) {
+VioManager::VioManager(VioManagerOptions &params_)
+    : thread_init_running(false), thread_init_success(false), thread_construct_done(false) {
 
   // Nice startup message
   PRINT_DEBUG("=======================================\n");
@@ -67,6 +74,43 @@ VioManager::VioManager(VioManagerOptions &params_) : thread_init_running(false),
   cv::setNumThreads(params.num_opencv_threads);
   cv::setRNGSeed(0);
 
+  // Load the per-role thread affinity/priority policy before any of our threads exist
+  // Every thread we spawn from here on registers itself and gets placed by this policy
+  ov_core::ThreadRegistry::configure(params.thread_affinity_policy, params.thread_priority_policy);
+
+  // Spin up our own work-stealing pool with the same thread count
+  // Zero threads keeps everything inline on the caller (needed for sim repeatability)
+  // Deterministic mode makes the parallel paths replay-stable even with many threads
+  ov_core::ThreadPool::instance().set_deterministic(params.deterministic_parallelism);
+  ov_core::ThreadPool::instance().configure(params.num_opencv_threads, params.thread_pool_affinity);
+
+  // Optionally reserve the big recurring allocations in one preallocated region so a
+  // long-running deployment never fragments the system heap (see ov_core::MemoryArena)
+  // The arena is sized from the expected steady-state footprint implied by the config
+  // and must be configured before the state below allocates its covariance storage
+  if (params.use_memory_prealloc) {
+    int max_cov_dim = 40 + 14 * params.state_options.num_cameras + 6 * (params.state_options.max_clone_size + 1) +
+                      3 * (params.state_options.max_slam_features + params.state_options.max_aruco_features);
+    double mb_cov = 1e-6 * (double)max_cov_dim * max_cov_dim * sizeof(CovScalar);
+    double mb_imgs = 0.0;
+    for (int i = 0; i < params.state_options.num_cameras; i++) {
+      // Image slab rings (sensor callback pool plus tracker display and history buffers)
+      mb_imgs += 1e-6 * 24.0 * (double)(params.camera_intrinsics.at(i)->w() * params.camera_intrinsics.at(i)->h());
+    }
+    // Stacked measurement Jacobian and its triangularization workspace at the largest update
+    double max_rows = 2.0 * params.state_options.max_clone_size * (params.num_pts > 1 ? params.num_pts : 1);
+    double mb_jac = 1e-6 * 2.0 * max_rows * max_cov_dim * sizeof(double);
+    double mb_total = mb_cov + mb_imgs + mb_jac;
+    PRINT_INFO("[MEM]: expected steady-state footprint %.1f MB (covariance %.1f, image slabs %.1f, jacobians %.1f)\n", mb_total, mb_cov,
+               mb_imgs, mb_jac);
+    size_t arena_bytes =
+        (params.memory_arena_mb > 0) ? (size_t)params.memory_arena_mb * 1024 * 1024 : (size_t)(1.25 * 1e6 * mb_total);
+    if (ov_core::MemoryArena::configure(arena_bytes, params.memory_use_hugepages)) {
+      PRINT_INFO("[MEM]: reserved a %.1f MB arena (%s pages requested)\n", 1e-6 * (double)ov_core::MemoryArena::capacity(),
+                 params.memory_use_hugepages ? "huge" : "normal");
+    }
+  }
+
   // Create the state!!
   state = std::make_shared<State>(params.state_options);
 
@@ -96,6 +140,9 @@ VioManager::VioManager(VioManagerOptions &params_) : thread_init_running(false),
     state->_cam_intrinsics.at(i)->set_fej(params.camera_intrinsics.at(i)->get_value());
     state->_calib_IMUtoCAM.at(i)->set_value(params.camera_extrinsics.at(i));
     state->_calib_IMUtoCAM.at(i)->set_fej(params.camera_extrinsics.at(i));
+    if (params.use_undistort_lut) {
+      params.camera_intrinsics.at(i)->enable_undistort_lut();
+    }
   }
 
   //===================================================================================
@@ -122,37 +169,100 @@ VioManager::VioManager(VioManagerOptions &params_) : thread_init_running(false),
     of_statistics << "re-tri & marg,total" << std::endl;
   }
 
+  // If we want the hot-path flight recorder, then enable it now
+  // Spans are recorded into lock-free per-thread buffers and dumped on destruction
+  if (params.record_trace_information) {
+    ov_core::Tracer::set_enabled(true);
+  }
+
+  // If we want heap allocations attributed to those same spans, enable the auditor
+  // Per-stage allocation counts/bytes are reported on destruction
+  if (params.record_alloc_information) {
+    ov_core::AllocAudit::set_enabled(true);
+  }
+
+  // The stage watchdog needs both recorders running so there is history to dump
+  // when a budget trips (the data only ever leaves memory on an actual overrun)
+  if (params.use_stage_watchdog) {
+    ov_core::Tracer::set_enabled(true);
+    ov_core::AllocAudit::set_enabled(true);
+    boost::filesystem::create_directories(boost::filesystem::path(params.watchdog_dump_path));
+  }
+
   //===================================================================================
   //===================================================================================
   //===================================================================================
 
+  // Initialize our state propagator
+  // This must exist before the constructor returns since feed_measurement_imu()
+  // hands it every message from time zero (it is cheap to build anyways)
+  propagator = std::make_shared<Propagator>(params.imu_noises, params.gravity_mag);
+
+  // Finish constructing the heavy members (trackers, updaters, chi-squared tables) on
+  // a background thread so the caller can open its sensor subscriptions right away
+  // instead of missing the first seconds of data while we build them. Anything that
+  // needs these members waits on this thread, and early IMU is buffered and replayed.
+  thread_construct = std::thread([this] {
+    ov_core::ThreadRegistry::register_thread("construct");
+    this->construct_trackers_and_updaters();
+  });
+}
+
+void VioManager::construct_trackers_and_updaters() {
+
   // Let's make a feature extractor
   // NOTE: after we initialize we will increase the total number of feature tracks
   // NOTE: we will split the total number of features over all cameras uniformly
   int init_max_features = std::floor((double)params.init_options.init_max_features / (double)params.state_options.num_cameras);
   if (params.use_klt) {
-    trackFEATS = std::shared_ptr<TrackBase>(new TrackKLT(state->_cam_intrinsics_cameras, init_max_features,
-                                                         state->_options.max_aruco_features, params.use_stereo, params.histogram_method,
-                                                         params.fast_threshold, params.grid_x, params.grid_y, params.min_px_dist));
+    trackFEATS = std::shared_ptr<TrackBase>(
+        new TrackKLT(state->_cam_intrinsics_cameras, init_max_features, state->_options.max_aruco_features, params.use_stereo,
+                     params.histogram_method, params.fast_threshold, params.grid_x, params.grid_y, params.min_px_dist,
+                     params.use_gpu_tracking, params.klt_multires_tracking, params.klt_multires_age));
   } else {
     trackFEATS = std::shared_ptr<TrackBase>(new TrackDescriptor(
         state->_cam_intrinsics_cameras, init_max_features, state->_options.max_aruco_features, params.use_stereo, params.histogram_method,
         params.fast_threshold, params.grid_x, params.grid_y, params.min_px_dist, params.knn_ratio));
   }
 
+  // If requested, hand the tracker the fixed stereo extrinsics so the stereo leg of its
+  // detection can search along epipolar lines instead of running a full 2d LK solve.
+  // This is only valid if the extrinsics actually stay fixed over the whole run!
+  if (params.use_stereo_epipolar_matching && params.use_stereo) {
+    if (params.state_options.do_calib_camera_pose) {
+      PRINT_WARNING(YELLOW "VioManager(): stereo epipolar matching disabled since camera extrinsics are being calibrated!\n" RESET);
+    } else {
+      for (int i = 0; i < params.state_options.num_cameras; i++) {
+        for (int j = i + 1; j < params.state_options.num_cameras; j++) {
+          Eigen::Matrix3d R_ItoC0 = state->_calib_IMUtoCAM.at(i)->Rot();
+          Eigen::Vector3d p_IinC0 = state->_calib_IMUtoCAM.at(i)->pos();
+          Eigen::Matrix3d R_ItoC1 = state->_calib_IMUtoCAM.at(j)->Rot();
+          Eigen::Vector3d p_IinC1 = state->_calib_IMUtoCAM.at(j)->pos();
+          Eigen::Matrix3d R_C0toC1 = R_ItoC1 * R_ItoC0.transpose();
+          trackFEATS->set_stereo_extrinsics(i, j, R_C0toC1, p_IinC1 - R_C0toC1 * p_IinC0);
+        }
+      }
+    }
+  }
+
   // Initialize our aruco tag extractor
   if (params.use_aruco) {
     trackARUCO = std::shared_ptr<TrackBase>(new TrackAruco(state->_cam_intrinsics_cameras, state->_options.max_aruco_features,
                                                            params.use_stereo, params.histogram_method, params.downsize_aruco));
   }
 
-  // Initialize our state propagator
-  propagator = std::make_shared<Propagator>(params.imu_noises, params.gravity_mag);
+  // Render the tracker debug images at the configured scale (one means full sensor resolution)
+  trackFEATS->set_display_scale(params.track_display_scale);
+  if (trackARUCO != nullptr)
+    trackARUCO->set_display_scale(params.track_display_scale);
 
   // Our state initialize
   initializer = std::make_shared<ov_init::InertialInitializer>(params.init_options, trackFEATS->get_feature_database());
 
   // Make the updater!
+  // Build the per-representation Jacobian engines the updaters dispatch into
+  UpdaterJacobianEngine::initialize();
+
   updaterMSCKF = std::make_shared<UpdaterMSCKF>(params.msckf_options, params.featinit_options);
   updaterSLAM = std::make_shared<UpdaterSLAM>(params.slam_options, params.aruco_options, params.featinit_options);
   updaterGlobal = std::make_shared<UpdaterGlobal>();
@@ -163,6 +273,69 @@ VioManager::VioManager(VioManagerOptions &params_) : thread_init_running(false),
                                                         propagator, params.gravity_mag, params.zupt_max_velocity,
                                                         params.zupt_noise_multiplier, params.zupt_max_disparity);
   }
+
+  // If requested, create the fixed-lag smoother which refines marginalized clones in the background
+  if (params.use_fixed_lag_smoother) {
+    smoother = std::make_shared<FixedLagSmoother>(params.fixed_lag_smoother_lag);
+  }
+
+  // If requested, map the shared-memory odometry segment for co-located consumers
+  if (params.use_shm_output) {
+    shm_output = std::make_shared<ShmOdometryWriter>(params.shm_output_name);
+    if (!shm_output->good()) {
+      PRINT_WARNING(YELLOW "VioManager(): unable to map shared-memory segment '%s', shm output disabled!\n" RESET,
+                    params.shm_output_name.c_str());
+    }
+  }
+
+  // Replay the IMU that arrived while we were constructing into the consumers that now
+  // exist, then mark ourselves done. The flag is flipped under the buffer lock so a
+  // concurrent feed_measurement_imu() either lands in the buffer or sees the members.
+  {
+    std::lock_guard<std::mutex> lck(imu_queue_construct_mtx);
+    for (const auto &message : imu_queue_construct) {
+      double oldest_time = state->imu_time(message.timestamp - params.init_options.init_window_time) - 0.10;
+      initializer->feed_imu(message, oldest_time);
+      if (updaterZUPT != nullptr) {
+        updaterZUPT->feed_imu(message, oldest_time);
+      }
+    }
+    imu_queue_construct.clear();
+    thread_construct_done = true;
+  }
+}
+
+void VioManager::wait_for_construction() {
+
+  // Once the done flag is set the members all exist, so this is just an atomic load
+  // (the thread itself is reaped by the destructor). Joining is not thread-safe on
+  // its own, so serialize the callers that actually have to wait.
+  if (thread_construct_done)
+    return;
+  std::lock_guard<std::mutex> lck(thread_construct_mtx);
+  if (thread_construct.joinable()) {
+    thread_construct.join();
+  }
+}
+
+VioManager::~VioManager() {
+
+  // Make sure the construction thread is reaped (wait_for_construction leaves the
+  // join to us once the done flag is up)
+  if (thread_construct.joinable()) {
+    thread_construct.join();
+  }
+
+  // Dump the tracer flight recorder so this run's hot-path history is not lost
+  if (params.record_trace_information) {
+    ov_core::Tracer::dump_flamegraph(params.record_trace_filepath);
+  }
+
+  // Report the per-stage heap allocation totals of this run
+  if (params.record_alloc_information) {
+    ov_core::AllocAudit::set_enabled(false);
+    ov_core::AllocAudit::report();
+  }
 }
 
 void VioManager::feed_measurement_imu(const ov_core::ImuData &message) {
@@ -174,10 +347,21 @@ void VioManager::feed_measurement_imu(const ov_core::ImuData &message) {
     oldest_time = -1;
   }
   if (!is_initialized_vio) {
-    oldest_time = message.timestamp - params.init_options.init_window_time + state->_calib_dt_CAMtoIMU->value()(0) - 0.10;
+    oldest_time = state->imu_time(message.timestamp - params.init_options.init_window_time) - 0.10;
   }
   propagator->feed_imu(message, oldest_time);
 
+  // If the background construction has not finished yet, the initializer and zero
+  // velocity updater do not exist, so buffer the message to be replayed into them
+  // (double-checked under the lock since the flag flips while holding it)
+  if (!thread_construct_done) {
+    std::lock_guard<std::mutex> lck(imu_queue_construct_mtx);
+    if (!thread_construct_done) {
+      imu_queue_construct.push_back(message);
+      return;
+    }
+  }
+
   // Push back to our initializer
   if (!is_initialized_vio) {
     initializer->feed_imu(message, oldest_time);
@@ -188,18 +372,26 @@ void VioManager::feed_measurement_imu(const ov_core::ImuData &message) {
   if (is_initialized_vio && updaterZUPT != nullptr && (!params.zupt_only_at_beginning || !has_moved_since_zupt)) {
     updaterZUPT->feed_imu(message, oldest_time);
   }
+
+  // Share the high-rate predicted state with any shared-memory consumers
+  if (shm_output != nullptr) {
+    publish_shm_odometry(message.timestamp, true);
+  }
 }
 
 void VioManager::feed_measurement_gps(const ov_core::GPSData &message) {
   // Give the GPD data to the global updater, without applying it to the state
+  wait_for_construction();
   updaterGlobal->feed_gps(message);
 }
 
-void VioManager::feed_measurement_simulation(double timestamp, const std::vector<int> &camids,
-                                             const std::vector<std::vector<std::pair<size_t, Eigen::VectorXf>>> &feats) {
+void VioManager::feed_measurement_simulation(const ov_core::SimCameraData &message) {
 
   // Start timing
-  rT1 = boost::posix_time::microsec_clock::local_time();
+  ov_core::TraceSpan span_track("tracking");
+
+  // We are about to swap out the trackers, so construction must have finished
+  wait_for_construction();
 
   // Check if we actually have a simulated tracker
   // If not, recreate and re-cast the tracker to our simulation tracker
@@ -207,6 +399,7 @@ void VioManager::feed_measurement_simulation(double timestamp, const std::vector
   if (trackSIM == nullptr) {
     // Replace with the simulated tracker
     trackSIM = std::make_shared<TrackSIM>(state->_cam_intrinsics_cameras, state->_options.max_aruco_features);
+    trackSIM->set_display_scale(params.track_display_scale);
     trackFEATS = trackSIM;
     // Need to also replace it in init and zv-upt since it points to the trackFEATS db pointer
     initializer = std::make_shared<ov_init::InertialInitializer>(params.init_options, trackFEATS->get_feature_database());
@@ -219,21 +412,23 @@ void VioManager::feed_measurement_simulation(double timestamp, const std::vector
   }
 
   // Feed our simulation tracker
-  trackSIM->feed_measurement_simulation(timestamp, camids, feats);
-  rT2 = boost::posix_time::microsec_clock::local_time();
+  trackSIM->feed_measurement_simulation(message);
+  span_track.stop();
+  time_track = span_track.seconds();
 
   // Check if we should do zero-velocity, if so update the state with it
   // Note that in the case that we only use in the beginning initialization phase
   // If we have since moved, then we should never try to do a zero velocity update!
   if (is_initialized_vio && updaterZUPT != nullptr && (!params.zupt_only_at_beginning || !has_moved_since_zupt)) {
     // If the same state time, use the previous timestep decision
-    if (state->_timestamp != timestamp) {
-      did_zupt_update = updaterZUPT->try_update(state, timestamp);
+    if (state->_timestamp != message.timestamp) {
+      did_zupt_update = updaterZUPT->try_update(state, message.timestamp);
     }
     if (did_zupt_update) {
-      assert(state->_timestamp == timestamp);
-      propagator->clean_old_imu_measurements(timestamp + state->_calib_dt_CAMtoIMU->value()(0) - 0.10);
-      updaterZUPT->clean_old_imu_measurements(timestamp + state->_calib_dt_CAMtoIMU->value()(0) - 0.10);
+      assert(state->_timestamp == message.timestamp);
+      double oldest_time = state->imu_time(message.timestamp) - 0.10;
+      propagator->clean_old_imu_measurements(oldest_time);
+      updaterZUPT->clean_old_imu_measurements(oldest_time);
       propagator->invalidate_cache();
       return;
     }
@@ -248,22 +443,75 @@ void VioManager::feed_measurement_simulation(double timestamp, const std::vector
 
   // Call on our propagate and update function
   // Simulation is either all sync, or single camera...
-  ov_core::CameraData message;
-  message.timestamp = timestamp;
-  for (auto const &camid : camids) {
-    int width = state->_cam_intrinsics_cameras.at(camid)->w();
-    int height = state->_cam_intrinsics_cameras.at(camid)->h();
-    message.sensor_ids.push_back(camid);
-    message.images.push_back(cv::Mat::zeros(cv::Size(width, height), CV_8UC1));
-    message.masks.push_back(cv::Mat::zeros(cv::Size(width, height), CV_8UC1));
-  }
-  do_feature_propagate_update(message);
+  // The update only looks at the timestamp and camera ids, so no placeholder
+  // images are ever allocated on this path (TrackSIM already has the uvs)
+  ov_core::CameraData message_cam;
+  message_cam.timestamp = message.timestamp;
+  message_cam.sensor_ids = message.sensor_ids;
+  do_feature_propagate_update(message_cam);
+}
+
+void VioManager::precompute_camera_pyramids(const ov_core::CameraData &message) {
+
+  // This is only an optimization, so just skip it if the tracker does not exist yet
+  if (!thread_construct_done)
+    return;
+
+  // Only the KLT frontend has pyramids to pre-build
+  std::shared_ptr<TrackKLT> trackKLT = std::dynamic_pointer_cast<TrackKLT>(trackFEATS);
+  if (trackKLT == nullptr)
+    return;
+
+  // Hand the work to the pool; if it is not running we just skip it and the
+  // synchronous path in feed_new_camera will build the pyramids as before
+  // NOTE: CameraData copies are cheap since cv::Mat is reference counted
+  // NOTE: we apply the same downsampling the tracking path will, otherwise the
+  // NOTE: cached pyramids would be the wrong resolution and silently discarded
+  bool downsample = params.downsample_cameras;
+  ov_core::ThreadPool::instance().async([trackKLT, message, downsample] {
+    ov_core::CameraData message_proc = message;
+    for (size_t i = 0; i < message_proc.sensor_ids.size() && downsample; i++) {
+      cv::Mat img = message_proc.images.at(i);
+      cv::Mat img_temp;
+      cv::pyrDown(img, img_temp, cv::Size(img.cols / 2.0, img.rows / 2.0));
+      message_proc.images.at(i) = img_temp;
+    }
+    trackKLT->precompute_pyramids(message_proc);
+  });
 }
 
 void VioManager::track_image_and_update(const ov_core::CameraData &message_const) {
 
   // Start timing
-  rT1 = boost::posix_time::microsec_clock::local_time();
+  ov_core::TraceSpan span_track("tracking");
+
+  // The trackers and updaters construct on a background thread, wait if they are not up
+  // In practice they finish long before the first camera frame makes it here
+  wait_for_construction();
+
+  // Latency accounting: how long this frame sat between the driver handing it over
+  // and the pipeline starting on it (queue build-up regressions show up here first)
+  // The wait also goes into the flight recorder as its own span so a latency budget
+  // overrun can be broken down post-hoc next to the compute stages
+  uint64_t latency_t_entry = ov_core::Tracer::now();
+  frame_received_last = message_const.time_received;
+  latency_queue_last = ov_core::Tracer::to_seconds(latency_t_entry - message_const.time_received);
+  if (ov_core::Tracer::enabled()) {
+    ov_core::Tracer::record("queue wait", message_const.time_received, latency_t_entry, 0);
+  }
+
+  // Whatever thread drives the pipeline is the "filter" thread (a dedicated worker, a
+  // ROS executor thread, or the replay main thread), so it registers on its first frame
+  static thread_local bool thread_is_registered = false;
+  if (!thread_is_registered) {
+    ov_core::ThreadRegistry::register_thread("filter");
+    thread_is_registered = true;
+  }
+
+  // If a performance tier change was requested, apply it now (never mid-pipeline)
+  if (perf_tier_requested != perf_tier_active) {
+    apply_perf_tier(perf_tier_requested);
+  }
 
   // Assert we have valid measurement data and ids
   assert(!message_const.sensor_ids.empty());
@@ -284,6 +532,23 @@ void VioManager::track_image_and_update(const ov_core::CameraData &message_const
     message.masks.at(i) = mask_temp;
   }
 
+  // Seed the tracker with the gyro-predicted rotation since the last processed frame
+  // This lets KLT start its search at the rotated location of each old feature, which is
+  // where most of the apparent motion comes from during aggressive maneuvers
+  // Note we predict from the last *tracked* frame, which with update decimation can be
+  // newer than the state time (the state only advances on undecimated frames)
+  double time_seed = (time_last_tracked != -1) ? time_last_tracked : state->_timestamp;
+  if (is_initialized_vio && time_seed != -1 && message.timestamp > time_seed) {
+    Eigen::Matrix3d R_I0toI1;
+    if (propagator->get_gyro_relative_rotation(state->imu_time(time_seed), state->imu_time(message.timestamp), state->_imu->bias_g(),
+                                               R_I0toI1)) {
+      for (const auto &cam_id : message.sensor_ids) {
+        Eigen::Matrix3d R_ItoC = state->_calib_IMUtoCAM.at(cam_id)->Rot();
+        trackFEATS->set_predicted_rotation(cam_id, R_ItoC * R_I0toI1 * R_ItoC.transpose());
+      }
+    }
+  }
+
   // Perform our feature tracking!
   trackFEATS->feed_new_camera(message);
 
@@ -293,7 +558,18 @@ void VioManager::track_image_and_update(const ov_core::CameraData &message_const
   if (is_initialized_vio && trackARUCO != nullptr) {
     trackARUCO->feed_new_camera(message);
   }
-  rT2 = boost::posix_time::microsec_clock::local_time();
+  time_last_tracked = message.timestamp;
+  span_track.stop();
+  time_track = span_track.seconds();
+
+  // If we are decimating updates, the frames in between only pay for the tracker
+  // Their measurements stay in the feature database so the tracks remain continuous,
+  // and the next undecimated frame propagates over the whole gap and updates as normal
+  if (is_initialized_vio && params.update_decimation > 1 && ++frames_since_update < params.update_decimation) {
+    PRINT_DEBUG(BLUE "[TIME]: %.4f seconds for tracking (update decimated)\n" RESET, time_track);
+    return;
+  }
+  frames_since_update = 0;
 
   // Check if we should do zero-velocity, if so update the state with it
   // Note that in the case that we only use in the beginning initialization phase
@@ -305,8 +581,9 @@ void VioManager::track_image_and_update(const ov_core::CameraData &message_const
     }
     if (did_zupt_update) {
       assert(state->_timestamp == message.timestamp);
-      propagator->clean_old_imu_measurements(message.timestamp + state->_calib_dt_CAMtoIMU->value()(0) - 0.10);
-      updaterZUPT->clean_old_imu_measurements(message.timestamp + state->_calib_dt_CAMtoIMU->value()(0) - 0.10);
+      double oldest_time = state->imu_time(message.timestamp) - 0.10;
+      propagator->clean_old_imu_measurements(oldest_time);
+      updaterZUPT->clean_old_imu_measurements(oldest_time);
       propagator->invalidate_cache();
       return;
     }
@@ -317,7 +594,6 @@ void VioManager::track_image_and_update(const ov_core::CameraData &message_const
   if (!is_initialized_vio) {
     is_initialized_vio = try_to_initialize(message);
     if (!is_initialized_vio) {
-      double time_track = (rT2 - rT1).total_microseconds() * 1e-6;
       PRINT_DEBUG(BLUE "[TIME]: %.4f seconds for tracking\n" RESET, time_track);
       return;
     }
@@ -331,6 +607,350 @@ ov_type::PoseJPL VioManager::reset_keyframe() {
   return state->reset_keyframe();
 }
 
+void VioManager::update_tracking_budget(double time_total) {
+
+  // Target latency is either explicit, or 80 percent of the tracking period
+  double target = (params.adaptive_budget_latency > 0) ? params.adaptive_budget_latency : 0.8 / params.track_frequency;
+
+  // Smooth the per-frame time so a single hiccup does not trim the budget
+  budget_avg_time = (budget_avg_time < 0) ? time_total : 0.9 * budget_avg_time + 0.1 * time_total;
+
+  // Bounds we adapt within (never below half the points / msckf cap, never
+  // above double the detection threshold, and never above the configured values)
+  int pts_config = std::floor((double)params.num_pts / (double)params.state_options.num_cameras);
+  int pts_min = std::max(1, pts_config / 2);
+  int thresh_max = 2 * params.fast_threshold;
+  int msckf_min = std::max(1, params.state_options.max_msckf_in_update / 2);
+
+  // Over budget: trim each knob by ten percent of its current value
+  // Under 70 percent of budget: walk them back towards the configured values
+  // The deadband in between keeps the knobs steady so tracking stays consistent
+  if (budget_avg_time > target) {
+    trackFEATS->set_num_features(std::max(pts_min, (int)(0.9 * trackFEATS->get_num_features())));
+    if (trackFEATS->get_detection_threshold() > 0)
+      trackFEATS->set_detection_threshold(std::min(thresh_max, (int)std::ceil(1.1 * trackFEATS->get_detection_threshold())));
+    state->_options.max_msckf_in_update = std::max(msckf_min, (int)(0.9 * state->_options.max_msckf_in_update));
+    PRINT_DEBUG(YELLOW "[BUDGET]: %.1f ms > %.1f ms target, trimmed to %d pts, %d thresh, %d msckf\n" RESET, 1000 * budget_avg_time,
+                1000 * target, trackFEATS->get_num_features(), trackFEATS->get_detection_threshold(),
+                state->_options.max_msckf_in_update);
+  } else if (budget_avg_time < 0.7 * target) {
+    trackFEATS->set_num_features(std::min(pts_config, (int)std::ceil(1.05 * trackFEATS->get_num_features())));
+    if (trackFEATS->get_detection_threshold() > 0)
+      trackFEATS->set_detection_threshold(std::max(params.fast_threshold, (int)(0.95 * trackFEATS->get_detection_threshold())));
+    state->_options.max_msckf_in_update =
+        std::min(params.state_options.max_msckf_in_update, (int)std::ceil(1.05 * state->_options.max_msckf_in_update));
+  }
+}
+
+void VioManager::apply_perf_tier(int tier) {
+
+  // Per-tier scale factors for each knob group (index 0 is the configured values)
+  // The point / update caps shrink, the detection threshold rises so we extract less,
+  // and the zero velocity detector gets more eager so a stationary platform stops
+  // paying for feature updates sooner
+  tier = std::max(0, std::min(tier, (int)PERF_TIER_MINIMUM));
+  const double scale_pts[3] = {1.00, 0.66, 0.50};
+  const double scale_thresh[3] = {1.00, 1.50, 2.00};
+  const double scale_zupt[3] = {1.00, 1.25, 1.50};
+
+  // Tracker knobs (derived from the configured values so tier 0 restores them exactly)
+  int pts_config = std::floor((double)params.num_pts / (double)params.state_options.num_cameras);
+  trackFEATS->set_num_features(std::max(1, (int)(scale_pts[tier] * pts_config)));
+  if (trackFEATS->get_detection_threshold() > 0) {
+    trackFEATS->set_detection_threshold(std::max(1, (int)std::ceil(scale_thresh[tier] * params.fast_threshold)));
+  }
+
+  // KLT pyramid depth (one level less per tier, the LK calls clamp against the pooled
+  // pyramids so frames already in flight with the old depth remain valid)
+  auto trackKLT = std::dynamic_pointer_cast<ov_core::TrackKLT>(trackFEATS);
+  if (trackKLT != nullptr) {
+    if (pyr_levels_config < 0)
+      pyr_levels_config = trackKLT->get_pyramid_levels();
+    trackKLT->set_pyramid_levels(std::max(1, pyr_levels_config - tier));
+  }
+
+  // Per-update feature caps
+  state->_options.max_msckf_in_update = std::max(1, (int)(scale_pts[tier] * params.state_options.max_msckf_in_update));
+  state->_options.max_slam_in_update = std::max(1, (int)(scale_pts[tier] * params.state_options.max_slam_in_update));
+
+  // Zero velocity aggressiveness
+  if (updaterZUPT != nullptr) {
+    updaterZUPT->set_thresholds(scale_zupt[tier] * params.zupt_max_velocity, scale_zupt[tier] * params.zupt_max_disparity);
+  }
+
+  // Record it and keep any stale request in sync (external set while we were applying wins next frame)
+  perf_tier_active = tier;
+  PRINT_INFO(YELLOW "[GOVERNOR]: switched to tier %d (%d pts, %d thresh, %d msckf, %d slam)\n" RESET, tier,
+             trackFEATS->get_num_features(), trackFEATS->get_detection_threshold(), state->_options.max_msckf_in_update,
+             state->_options.max_slam_in_update);
+}
+
+void VioManager::update_perf_governor(double time_total) {
+
+  // Target latency is either explicit, or 90 percent of the tracking period
+  double target = (params.perf_governor_latency > 0) ? params.perf_governor_latency : 0.9 / params.track_frequency;
+
+  // Smooth the per-frame time so a single hiccup does not count as load
+  governor_avg_time = (governor_avg_time < 0) ? time_total : 0.9 * governor_avg_time + 0.1 * time_total;
+
+  // Hysteresis: demote after a sustained run over target, promote only after a much
+  // longer run with comfortable headroom, and let the counters decay in the deadband
+  // so brief excursions in either direction do not accumulate into a tier change
+  if (governor_avg_time > target) {
+    governor_frames_over++;
+    governor_frames_under = 0;
+  } else if (governor_avg_time < 0.6 * target) {
+    governor_frames_under++;
+    governor_frames_over = 0;
+  } else {
+    governor_frames_over = std::max(0, governor_frames_over - 1);
+    governor_frames_under = std::max(0, governor_frames_under - 1);
+  }
+  if (governor_frames_over > 30 && perf_tier_active < (int)PERF_TIER_MINIMUM) {
+    set_perf_tier(perf_tier_active + 1);
+    governor_frames_over = 0;
+  } else if (governor_frames_under > 300 && perf_tier_active > (int)PERF_TIER_FULL) {
+    set_perf_tier(perf_tier_active - 1);
+    governor_frames_under = 0;
+  }
+}
+
+void VioManager::update_stage_watchdog() {
+
+  // Stage timings of the frame that just finished, against their budgets
+  // The SLAM budget covers both the update and the delayed initialization
+  struct StageBudget {
+    const char *name;
+    double seconds;
+    double budget;
+  };
+  StageBudget stages[] = {
+      {"tracking", timing_spans_last(0), 1e-3 * params.watchdog_ms_tracking},
+      {"propagation", timing_spans_last(1), 1e-3 * params.watchdog_ms_propagation},
+      {"msckf update", timing_spans_last(2), 1e-3 * params.watchdog_ms_msckf},
+      {"slam update", timing_spans_last(3) + timing_spans_last(4), 1e-3 * params.watchdog_ms_slam},
+      {"re-tri & marg", timing_spans_last(5), 1e-3 * params.watchdog_ms_marg},
+  };
+
+  // Find the worst offender relative to its budget (zero budgets disable a stage)
+  const StageBudget *worst = nullptr;
+  for (const auto &stage : stages) {
+    if (stage.budget <= 0 || stage.seconds <= stage.budget)
+      continue;
+    if (worst == nullptr || stage.seconds / stage.budget > worst->seconds / worst->budget) {
+      worst = &stage;
+    }
+  }
+  if (worst == nullptr)
+    return;
+
+  // Respect the per-run dump cap so a platform that is simply too slow for its
+  // budgets degrades into a single warning per frame instead of filling the disk
+  if (watchdog_num_dumps >= params.watchdog_max_dumps) {
+    PRINT_WARNING(YELLOW "[WATCHDOG]: stage '%s' took %.1f ms (budget %.1f ms), dump cap reached\n" RESET, worst->name,
+                  1e3 * worst->seconds, 1e3 * worst->budget);
+    return;
+  }
+  watchdog_num_dumps++;
+
+  // Dump the in-memory trace ring and the allocation counters for post-hoc analysis
+  // Files are keyed by the frame timestamp in the IMU clock so they can be lined up
+  // against the recorded trajectory and timing statistics
+  double timestamp_inI = state->imu_time(state->_timestamp);
+  std::stringstream ss;
+  ss << params.watchdog_dump_path << "/watchdog_" << std::fixed << std::setprecision(3) << timestamp_inI;
+  ov_core::Tracer::dump_flamegraph(ss.str() + "_trace.txt");
+  ov_core::AllocAudit::report(ss.str() + "_alloc.txt");
+  PRINT_WARNING(YELLOW "[WATCHDOG]: stage '%s' took %.1f ms (budget %.1f ms), dumped %s_*.txt (%d of %d)\n" RESET, worst->name,
+                1e3 * worst->seconds, 1e3 * worst->budget, ss.str().c_str(), watchdog_num_dumps, params.watchdog_max_dumps);
+}
+
+void VioManager::update_cond_monitor() {
+
+  // A few warm-started power iterations against the live covariance
+  cond_number_last = StateHelper::estimate_condition_number(state, cond_vec_max, cond_vec_min, params.cond_monitor_iterations);
+  if (cond_number_last <= params.cond_monitor_max)
+    return;
+
+  // Conditioning is collapsing: warn early, and let the watchdog dump machinery
+  // capture the frames leading into it (respecting its per-run cap)
+  PRINT_WARNING(YELLOW "[COND]: covariance condition number %.3e over limit %.3e, filter may be close to divergence\n" RESET,
+                cond_number_last, params.cond_monitor_max);
+  if (params.use_stage_watchdog && watchdog_num_dumps < params.watchdog_max_dumps) {
+    watchdog_num_dumps++;
+    double timestamp_inI = state->imu_time(state->_timestamp);
+    std::stringstream ss;
+    ss << params.watchdog_dump_path << "/conditioning_" << std::fixed << std::setprecision(3) << timestamp_inI;
+    ov_core::Tracer::dump_flamegraph(ss.str() + "_trace.txt");
+    ov_core::AllocAudit::report(ss.str() + "_alloc.txt");
+    PRINT_WARNING(YELLOW "[COND]: dumped %s_*.txt (%d of %d)\n" RESET, ss.str().c_str(), watchdog_num_dumps, params.watchdog_max_dumps);
+  }
+}
+
+void VioManager::publish_shm_odometry(double timestamp, bool propagate) {
+
+  // Nothing to do until the segment is mapped and we have a state worth sharing
+  if (shm_output == nullptr || !shm_output->good() || !is_initialized_vio)
+    return;
+  ShmOdometryRecord record;
+
+  // High-rate path: predict from the last update out to this inertial reading
+  // This mirrors what the ROS visualizer publishes for each IMU message
+  if (propagate) {
+    Eigen::Matrix<double, 13, 1> state_plus = Eigen::Matrix<double, 13, 1>::Zero();
+    Eigen::Matrix<double, 12, 12> cov_plus = Eigen::Matrix<double, 12, 12>::Zero();
+    if (!propagator->fast_state_propagate(state, timestamp, state_plus, cov_plus))
+      return;
+    record.timestamp = timestamp;
+    for (int i = 0; i < 4; i++)
+      record.q_GtoI[i] = state_plus(i);
+    for (int i = 0; i < 3; i++) {
+      record.p_IinG[i] = state_plus(4 + i);
+      record.v_IinG[i] = state_plus(7 + i);
+      record.w_IinI[i] = state_plus(10 + i);
+    }
+    Eigen::Map<Eigen::Matrix<double, 6, 6, Eigen::RowMajor>>(record.cov_pose) = cov_plus.block(0, 0, 6, 6);
+    Eigen::Map<Eigen::Matrix<double, 6, 6, Eigen::RowMajor>>(record.cov_twist) = cov_plus.block(6, 6, 6, 6);
+    shm_output->write(record);
+    return;
+  }
+
+  // Update-rate path: publish the filter posterior directly
+  // No angular rate is available here so the twist covariance only has the linear block
+  record.timestamp = state->_timestamp;
+  for (int i = 0; i < 4; i++)
+    record.q_GtoI[i] = state->_imu->quat()(i);
+  for (int i = 0; i < 3; i++) {
+    record.p_IinG[i] = state->_imu->pos()(i);
+    record.v_IinG[i] = state->_imu->vel()(i);
+  }
+  std::vector<std::shared_ptr<Type>> variables;
+  variables.push_back(state->_imu->pose());
+  Eigen::MatrixXd cov = StateHelper::get_marginal_covariance(state, variables);
+  Eigen::Map<Eigen::Matrix<double, 6, 6, Eigen::RowMajor>>(record.cov_pose) = cov.block(0, 0, 6, 6);
+  std::vector<std::shared_ptr<Type>> variables_vel;
+  variables_vel.push_back(state->_imu->v());
+  Eigen::MatrixXd cov_vel = StateHelper::get_marginal_covariance(state, variables_vel);
+  Eigen::Map<Eigen::Matrix<double, 6, 6, Eigen::RowMajor>>(record.cov_twist).block(0, 0, 3, 3) = cov_vel;
+  shm_output->write(record);
+}
+
+std::vector<std::shared_ptr<Feature>> VioManager::select_slam_candidates(std::vector<std::shared_ptr<Feature>> &feats_maxtracks,
+                                                                        int valid_amount) {
+
+  // Trivial cases where there is nothing to rank
+  std::vector<std::shared_ptr<Feature>> selected;
+  if (valid_amount <= 0 || feats_maxtracks.empty())
+    return selected;
+  if ((int)feats_maxtracks.size() <= valid_amount) {
+    selected = feats_maxtracks;
+    feats_maxtracks.clear();
+    return selected;
+  }
+
+  // Dominant direction of the current position uncertainty (closed-form 3x3 solve)
+  // Bearings orthogonal to it constrain exactly what the filter is least sure about,
+  // so they get a score bonus scaled by how anisotropic the uncertainty actually is
+  std::vector<std::shared_ptr<Type>> pos_order = {state->_imu->p()};
+  Eigen::Matrix3d P_pos = StateHelper::get_marginal_covariance(state, pos_order);
+  Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> eig(P_pos);
+  Eigen::Vector3d dir_uncertain = eig.eigenvectors().col(2);
+  double anisotropy = (eig.eigenvalues()(2) > 0) ? 1.0 - eig.eigenvalues()(0) / eig.eigenvalues()(2) : 0.0;
+
+  // Bins the newest observation of each camera into the tracker's detection grid
+  int grid_cells = params.grid_x * params.grid_y;
+  auto bin_into_grid = [&](const std::shared_ptr<Feature> &feat, std::vector<int> &cells) {
+    for (const auto &cams : feat->uvs) {
+      if (cams.second.empty() || state->_cam_intrinsics_cameras.find(cams.first) == state->_cam_intrinsics_cameras.end())
+        continue;
+      auto cam = state->_cam_intrinsics_cameras.at(cams.first);
+      int c = std::min(params.grid_x - 1, std::max(0, (int)(cams.second.back()(0) * params.grid_x / cam->w())));
+      int r = std::min(params.grid_y - 1, std::max(0, (int)(cams.second.back()(1) * params.grid_y / cam->h())));
+      cells.push_back((int)cams.first * grid_cells + r * params.grid_x + c);
+    }
+  };
+
+  // Score every candidate by the information its landmark is expected to buy
+  struct Candidate {
+    std::shared_ptr<Feature> feat;
+    double score = 0.0;
+    std::vector<int> cells;
+  };
+  std::vector<Candidate> candidates;
+  candidates.reserve(feats_maxtracks.size());
+  for (const auto &feat : feats_maxtracks) {
+    Candidate cand;
+    cand.feat = feat;
+
+    // Parallax over the track and total measurement count: more of either means a
+    // better conditioned triangulation and a smaller predicted innovation covariance
+    double parallax = 0.0;
+    int num_meas = 0;
+    for (const auto &cams : feat->uvs_norm) {
+      if (cams.second.empty())
+        continue;
+      num_meas += (int)cams.second.size();
+      parallax = std::max(parallax, (double)(cams.second.back() - cams.second.front()).norm());
+    }
+
+    // Alignment of the current bearing against the uncertain direction
+    double direction = 0.0;
+    auto it_uv = feat->uvs_norm.begin();
+    if (it_uv != feat->uvs_norm.end() && !it_uv->second.empty() &&
+        state->_calib_IMUtoCAM.find(it_uv->first) != state->_calib_IMUtoCAM.end()) {
+      Eigen::Vector3d b_C(it_uv->second.back()(0), it_uv->second.back()(1), 1.0);
+      b_C.normalize();
+      Eigen::Vector3d b_G = state->_imu->Rot().transpose() * state->_calib_IMUtoCAM.at(it_uv->first)->Rot().transpose() * b_C;
+      direction = anisotropy * (1.0 - std::abs(b_G.dot(dir_uncertain)));
+    }
+    cand.score = parallax * std::sqrt((double)num_meas) * (1.0 + direction);
+    bin_into_grid(feat, cand.cells);
+    candidates.push_back(cand);
+  }
+
+  // Active SLAM features claim their grid cells first so we never promote on top of them
+  std::set<int> occupied;
+  for (const auto &landmark : state->_features_SLAM) {
+    std::shared_ptr<Feature> feat = trackFEATS->get_feature_database()->get_feature(landmark.second->_featid);
+    if (feat != nullptr) {
+      std::vector<int> cells;
+      bin_into_grid(feat, cells);
+      occupied.insert(cells.begin(), cells.end());
+    }
+  }
+
+  // Greedy selection, best score first, one landmark per free grid cell
+  std::sort(candidates.begin(), candidates.end(), [](const Candidate &a, const Candidate &b) { return a.score > b.score; });
+  std::vector<bool> taken(candidates.size(), false);
+  for (size_t i = 0; i < candidates.size() && (int)selected.size() < valid_amount; i++) {
+    bool blocked = false;
+    for (int cell : candidates.at(i).cells)
+      blocked |= occupied.count(cell) > 0;
+    if (blocked)
+      continue;
+    occupied.insert(candidates.at(i).cells.begin(), candidates.at(i).cells.end());
+    selected.push_back(candidates.at(i).feat);
+    taken.at(i) = true;
+  }
+
+  // If the coverage constraint left slots open then fill them by score alone, so we
+  // never promote fewer features than the old track-length policy would have
+  for (size_t i = 0; i < candidates.size() && (int)selected.size() < valid_amount; i++) {
+    if (!taken.at(i)) {
+      selected.push_back(candidates.at(i).feat);
+      taken.at(i) = true;
+    }
+  }
+
+  // The chosen ones leave the candidate array (their information must not be reused)
+  feats_maxtracks.erase(std::remove_if(feats_maxtracks.begin(), feats_maxtracks.end(),
+                                       [&](const std::shared_ptr<Feature> &feat) {
+                                         return std::find(selected.begin(), selected.end(), feat) != selected.end();
+                                       }),
+                        feats_maxtracks.end());
+  return selected;
+}
+
 void VioManager::do_feature_propagate_update(const ov_core::CameraData &message) {
 
   //===================================================================================
@@ -348,10 +968,11 @@ void VioManager::do_feature_propagate_update(const ov_core::CameraData &message)
   // Also augment it with a new clone!
   // NOTE: if the state is already at the given time (can happen in sim)
   // NOTE: then no need to prop since we already are at the desired timestep
+  ov_core::TraceSpan span_prop("propagation");
   if (state->_timestamp != message.timestamp) {
     propagator->propagate_and_clone(state, message.timestamp);
   }
-  rT3 = boost::posix_time::microsec_clock::local_time();
+  span_prop.stop();
 
   // If we have not reached max clones, we should just return...
   // This isn't super ideal, but it keeps the logic after this easier...
@@ -425,7 +1046,7 @@ void VioManager::do_feature_propagate_update(const ov_core::CameraData &message)
     // See if any of our camera's reached max track
     bool reached_max = false;
     for (const auto &cams : (*it2)->timestamps) {
-      if ((int)cams.second.size() > state->_options.max_clone_size) {
+      if ((int)(cams.second.size() - (*it2)->first_valid_index(cams.first)) > state->_options.max_clone_size) {
         reached_max = true;
         break;
       }
@@ -455,11 +1076,12 @@ void VioManager::do_feature_propagate_update(const ov_core::CameraData &message)
     // Get the total amount to add, then the max amount that we can add given our marginalize feature array
     int amount_to_add = (state->_options.max_slam_features + curr_aruco_tags) - (int)state->_features_SLAM.size();
     int valid_amount = (amount_to_add > (int)feats_maxtracks.size()) ? (int)feats_maxtracks.size() : amount_to_add;
-    // If we have at least 1 that we can add, lets add it!
-    // Note: we remove them from the feat_marg array since we don't want to reuse information...
+    // If we have at least 1 that we can add, pick the candidates that buy the most
+    // information for their covariance slot (see select_slam_candidates)
+    // Note: they are removed from the max-track array since we don't want to reuse information...
     if (valid_amount > 0) {
-      feats_slam.insert(feats_slam.end(), feats_maxtracks.end() - valid_amount, feats_maxtracks.end());
-      feats_maxtracks.erase(feats_maxtracks.end() - valid_amount, feats_maxtracks.end());
+      std::vector<std::shared_ptr<Feature>> feats_promoted = select_slam_candidates(feats_maxtracks, valid_amount);
+      feats_slam.insert(feats_slam.end(), feats_promoted.begin(), feats_promoted.end());
     }
   }
 
@@ -514,32 +1136,41 @@ void VioManager::do_feature_propagate_update(const ov_core::CameraData &message)
   // Now that we have a list of features, lets do the EKF update for MSCKF and SLAM!
   //===================================================================================
 
-  // Sort based on track length
+  // Sort based on track length, boosted by how many frames a feature has already been
+  // deferred by the update cap, so carried-over features rise in priority and are
+  // consumed once there is headroom instead of starving until their measurements
+  // age out of the clone window
   // TODO: we should have better selection logic here (i.e. even feature distribution in the FOV etc..)
   // TODO: right now features that are "lost" are at the front of this vector, while ones at the end are long-tracks
-  auto compare_feat = [](const std::shared_ptr<Feature> &a, const std::shared_ptr<Feature> &b) -> bool {
-    size_t asize = 0;
-    size_t bsize = 0;
-    for (const auto &pair : a->timestamps)
-      asize += pair.second.size();
-    for (const auto &pair : b->timestamps)
-      bsize += pair.second.size();
-    return asize < bsize;
+  auto defer_count = [this](const std::shared_ptr<Feature> &f) -> int {
+    auto it = deferred_msckf_counts.find(f->featid);
+    return (it == deferred_msckf_counts.end()) ? 0 : it->second;
+  };
+  auto compare_feat = [&defer_count](const std::shared_ptr<Feature> &a, const std::shared_ptr<Feature> &b) -> bool {
+    return (int)a->num_valid_measurements() + 2 * defer_count(a) < (int)b->num_valid_measurements() + 2 * defer_count(b);
   };
   std::sort(featsup_MSCKF.begin(), featsup_MSCKF.end(), compare_feat);
 
   // Pass them to our MSCKF updater
   // NOTE: if we have more then the max, we select the "best" ones (i.e. max tracks) for this update
   // NOTE: this should only really be used if you want to track a lot of features, or have limited computational resources
-  if ((int)featsup_MSCKF.size() > state->_options.max_msckf_in_update)
+  // NOTE: the ones over the cap are *deferred*, not dropped: they stay in the database, get
+  // NOTE: re-collected by the next frame's queries, and their priority boost grows each time
+  if ((int)featsup_MSCKF.size() > state->_options.max_msckf_in_update) {
+    for (auto it3 = featsup_MSCKF.begin(); it3 != featsup_MSCKF.end() - state->_options.max_msckf_in_update; it3++) {
+      deferred_msckf_counts[(*it3)->featid]++;
+    }
     featsup_MSCKF.erase(featsup_MSCKF.begin(), featsup_MSCKF.end() - state->_options.max_msckf_in_update);
+  }
+  ov_core::TraceSpan span_msckf("msckf update");
   updaterMSCKF->update(state, featsup_MSCKF);
   propagator->invalidate_cache();
-  rT4 = boost::posix_time::microsec_clock::local_time();
+  span_msckf.stop();
 
   // Perform SLAM delay init and update
   // NOTE: that we provide the option here to do a *sequential* update
   // NOTE: this will be a lot faster but won't be as accurate.
+  ov_core::TraceSpan span_slam("slam update");
   std::vector<std::shared_ptr<Feature>> feats_slam_UPDATE_TEMP;
   while (!feats_slam_UPDATE.empty()) {
     // Get sub vector of the features we will update with
@@ -554,9 +1185,11 @@ void VioManager::do_feature_propagate_update(const ov_core::CameraData &message)
     propagator->invalidate_cache();
   }
   feats_slam_UPDATE = feats_slam_UPDATE_TEMP;
-  rT5 = boost::posix_time::microsec_clock::local_time();
+  span_slam.stop();
+  ov_core::TraceSpan span_delay("slam delayed");
   updaterSLAM->delayed_init(state, feats_slam_DELAYED);
-  rT6 = boost::posix_time::microsec_clock::local_time();
+  span_delay.stop();
+  ov_core::TraceSpan span_marg("re-tri & marg");
 
   //===================================================================================
   // Update our visualization feature set, and clean up the old features
@@ -578,6 +1211,17 @@ void VioManager::do_feature_propagate_update(const ov_core::CameraData &message)
   for (auto const &feat : featsup_MSCKF) {
     good_features_MSCKF.push_back(feat->p_FinG);
     feat->to_delete = true;
+    deferred_msckf_counts.erase(feat->featid);
+  }
+
+  // Also forget the deferral count of any feature that no longer exists
+  // (e.g. its measurements all aged out of the window, or it became a SLAM feature)
+  for (auto it3 = deferred_msckf_counts.begin(); it3 != deferred_msckf_counts.end();) {
+    if (trackFEATS->get_feature_database()->get_track_length(it3->first) == 0) {
+      it3 = deferred_msckf_counts.erase(it3);
+    } else {
+      it3++;
+    }
   }
 
   //===================================================================================
@@ -603,10 +1247,15 @@ void VioManager::do_feature_propagate_update(const ov_core::CameraData &message)
     }
   }
 
+  // Feed the clone window to the smoother before the oldest clone is destroyed
+  // This way the smoother's prior for the dying clone is the filter's final estimate of it
+  if (smoother != nullptr) {
+    smoother->feed_clones(state);
+  }
+
   // Finally marginalize the oldest clone if needed
   StateHelper::marginalize_old_clone(state);
-  rT7 = boost::posix_time::microsec_clock::local_time();
-
+  span_marg.stop();
 
   //===================================================================================
   // Apply any global measurements
@@ -614,18 +1263,21 @@ void VioManager::do_feature_propagate_update(const ov_core::CameraData &message)
 
   updaterGlobal->update(state);
 
+  // Share the fresh posterior with any shared-memory consumers
+  publish_shm_odometry(message.timestamp, false);
+
   //===================================================================================
   // Debug info, and stats tracking
   //===================================================================================
 
   // Get timing statitics information
-  double time_track = (rT2 - rT1).total_microseconds() * 1e-6;
-  double time_prop = (rT3 - rT2).total_microseconds() * 1e-6;
-  double time_msckf = (rT4 - rT3).total_microseconds() * 1e-6;
-  double time_slam_update = (rT5 - rT4).total_microseconds() * 1e-6;
-  double time_slam_delay = (rT6 - rT5).total_microseconds() * 1e-6;
-  double time_marg = (rT7 - rT6).total_microseconds() * 1e-6;
-  double time_total = (rT7 - rT1).total_microseconds() * 1e-6;
+  double time_prop = span_prop.seconds();
+  double time_msckf = span_msckf.seconds();
+  double time_slam_update = span_slam.seconds();
+  double time_slam_delay = span_delay.seconds();
+  double time_marg = span_marg.seconds();
+  double time_total = time_track + time_prop + time_msckf + time_slam_update + time_slam_delay + time_marg;
+  timing_spans_last << time_track, time_prop, time_msckf, time_slam_update, time_slam_delay, time_marg, time_total;
 
   // Timing information
   PRINT_DEBUG(BLUE "[TIME]: %.4f seconds for tracking\n" RESET, time_track);
@@ -649,8 +1301,7 @@ void VioManager::do_feature_propagate_update(const ov_core::CameraData &message)
   if (params.record_timing_information && of_statistics.is_open()) {
     // We want to publish in the IMU clock frame
     // The timestamp in the state will be the last camera time
-    double t_ItoC = state->_calib_dt_CAMtoIMU->value()(0);
-    double timestamp_inI = state->_timestamp + t_ItoC;
+    double timestamp_inI = state->imu_time(state->_timestamp);
     // Append to the file
     of_statistics << std::fixed << std::setprecision(15) << timestamp_inI << "," << std::fixed << std::setprecision(5) << time_track << ","
                   << time_prop << "," << time_msckf << ",";
@@ -661,6 +1312,36 @@ void VioManager::do_feature_propagate_update(const ov_core::CameraData &message)
     of_statistics.flush();
   }
 
+  // Mark the frame boundary for the flight-recorder tracer (IMU clock frame)
+  if (ov_core::Tracer::enabled()) {
+    ov_core::Tracer::frame(state->imu_time(state->_timestamp));
+  }
+
+  // Check the per-stage budgets, dumping the flight recorder if one tripped
+  if (params.use_stage_watchdog) {
+    update_stage_watchdog();
+  }
+
+  // Track the covariance conditioning for an early divergence warning
+  if (params.use_cond_monitor) {
+    update_cond_monitor();
+  }
+
+  // Let the budget controller react to how long this frame took
+  if (params.use_adaptive_budget) {
+    update_tracking_budget(time_total);
+  }
+
+  // Let the governor policy decide if we should change performance tier
+  if (params.use_perf_governor) {
+    update_perf_governor(time_total);
+  }
+
+  // Watch for filter divergence and keep the warm-restart checkpoints fresh
+  if (params.use_warm_reinit) {
+    update_warm_reinit(message);
+  }
+
   // Update our distance traveled
   if (timelastupdate != -1 && state->_clones_IMU.find(timelastupdate) != state->_clones_IMU.end()) {
     Eigen::Matrix<double, 3, 1> dx = state->_imu->pos() - state->_clones_IMU.at(timelastupdate)->pos();
@@ -29,14 +29,19 @@
 #include <fstream>
 #include <memory>
 #include <mutex>
+#include <set>
 #include <string>
+#include <thread>
 
 #include "VioManagerOptions.h"
+#include "feat/TrackArchive.h"
 #include "types/PoseJPL.h"
+#include "utils/shm_odometry.h"
 
 namespace ov_core {
 struct ImuData;
 struct CameraData;
+class Feature;
 class TrackBase;
 class FeatureInitializer;
 } // namespace ov_core
@@ -46,8 +51,10 @@ class InertialInitializer;
 
 namespace ov_msckf {
 
+class FixedLagSmoother;
 class State;
 class StateHelper;
+struct StateSnapshot;
 class UpdaterGlobal;
 class UpdaterMSCKF;
 class UpdaterSLAM;
@@ -70,6 +77,8 @@ public:
    */
   VioManager(VioManagerOptions &params_);
 
+  ~VioManager();
+
   /**
    * @brief Feed function for inertial data
    * @param message Contains our timestamp and inertial information
@@ -82,6 +91,18 @@ public:
    */
   void feed_measurement_camera(const ov_core::CameraData &message) { track_image_and_update(message); }
 
+  /**
+   * @brief Kicks off asynchronous pyramid pre-computation for a queued camera message
+   * @param message Contains our timestamp, images, and camera ids
+   *
+   * Call this at enqueue time (i.e. from the camera callback, before the message waits
+   * in the camera queue for IMU coverage). The image pre-processing and KLT pyramid
+   * construction then overlap with the filter update of the previous frame instead of
+   * sitting on the critical path of feed_measurement_camera(). This is a no-op if the
+   * thread pool is not running or the frontend is not KLT.
+   */
+  void precompute_camera_pyramids(const ov_core::CameraData &message);
+
   /**
    * @brief Feed function for a GPS measurement
    * @param message Contains our timestamp, gps, and vehicle transformation
@@ -89,13 +110,14 @@ public:
   void feed_measurement_gps(const ov_core::GPSData &message);
 
   /**
-   * @brief Feed function for a synchronized simulated cameras
-   * @param timestamp Time that this image was collected
-   * @param camids Camera ids that we have simulated measurements for
-   * @param feats Raw uv simulated measurements
+   * @brief Feed function for synchronized simulated cameras
+   * @param message Simulated uv observations for this timestep (see ov_core::SimCameraData)
+   *
+   * This is the in-process fast path for simulation: the uvs go straight into the
+   * TrackSIM database and the filter update runs on an image-free camera message,
+   * so no placeholder cv::Mat is ever allocated between the simulator and the filter.
    */
-  void feed_measurement_simulation(double timestamp, const std::vector<int> &camids,
-                                   const std::vector<std::vector<std::pair<size_t, Eigen::VectorXf>>> &feats);
+  void feed_measurement_simulation(const ov_core::SimCameraData &message);
 
   /**
    * @brief Given a state, this will initialize our IMU state.
@@ -121,6 +143,27 @@ public:
   /// Accessor to get the current propagator
   std::shared_ptr<Propagator> get_propagator() { return propagator; }
 
+  /// Accessor to get the fixed-lag smoother (nullptr if not enabled)
+  std::shared_ptr<FixedLagSmoother> get_smoother() { return smoother; }
+
+  /// Timing spans of the last update in seconds [track prop msckf slam_up slam_delay marg total]
+  Eigen::Matrix<double, 7, 1> get_timing_spans() { return timing_spans_last; }
+
+  /// Latest covariance condition number estimate (zero until the conditioning monitor has run)
+  double get_condition_number() { return cond_number_last; }
+
+  /// Pipeline latency of the last update in seconds [queue_wait track update total]
+  /// Measured from the driver handing the image over (see ov_core::CameraData::time_received)
+  Eigen::Matrix<double, 4, 1> get_latency_spans() {
+    Eigen::Matrix<double, 4, 1> latency;
+    latency << latency_queue_last, timing_spans_last(0), timing_spans_last(6) - timing_spans_last(0),
+        latency_queue_last + timing_spans_last(6);
+    return latency;
+  }
+
+  /// Tick stamp the last processed frame was received at (reference of the end-to-end latency)
+  uint64_t get_frame_received() { return frame_received_last; }
+
   /// Get a nice visualization image of what tracks we have
   cv::Mat get_historical_viz_image();
 
@@ -147,7 +190,52 @@ public:
     feat_tracks_uvd = active_tracks_uvd;
   }
 
+  /// Compressed archive of all historical active track observations (stream it, do not copy it)
+  const ov_core::TrackArchive &get_track_archive() { return track_archive; }
+
+  /// Predefined performance tiers the governor can switch between (see set_perf_tier)
+  enum PerfTier { PERF_TIER_FULL = 0, PERF_TIER_REDUCED = 1, PERF_TIER_MINIMUM = 2 };
+
+  /**
+   * @brief Request a performance tier (thread-safe, applied atomically before the next frame)
+   *
+   * Each tier scales the configured processing knobs as a group: the number of tracked
+   * points, the KLT pyramid depth, the per-update MSCKF/SLAM feature caps and how
+   * aggressively the zero velocity detector fires. External code (e.g. a thermal or
+   * battery monitor) can drive this directly, or the internal policy will drive it from
+   * the frame timings if `use_perf_governor` is enabled. The request is latched and
+   * applied at the top of the next frame so a tier change never lands mid-pipeline.
+   *
+   * @param tier Requested tier (clamped to the PerfTier range)
+   */
+  void set_perf_tier(int tier) { perf_tier_requested = std::max(0, std::min(tier, (int)PERF_TIER_MINIMUM)); }
+
+  /// Returns the performance tier the pipeline is currently running at
+  int get_perf_tier() { return perf_tier_active; }
+
 protected:
+  /**
+   * @brief Constructs the trackers, updaters and their chi-squared tables
+   *
+   * This is the expensive tail of construction (feature extractors, aruco dictionaries,
+   * the per-dof chi-squared gating tables of the updaters) and is run on a background
+   * thread so the caller can open its sensor subscriptions immediately after the
+   * constructor returns instead of missing the first seconds of data. IMU messages that
+   * arrive while this runs are buffered and replayed into the initializer and zero
+   * velocity updater once the members exist (the propagator is built synchronously and
+   * is fed from time zero).
+   */
+  void construct_trackers_and_updaters();
+
+  /**
+   * @brief Blocks until the background construction thread has finished
+   *
+   * Every entry point that touches the trackers or updaters calls this first.
+   * In practice construction finishes well before the first camera frame arrives,
+   * so this almost never actually waits.
+   */
+  void wait_for_construction();
+
   /**
    * @brief Given a new set of camera images, this will track them.
    *
@@ -176,6 +264,32 @@ protected:
    */
   bool try_to_initialize(const ov_core::CameraData &message);
 
+  /**
+   * @brief Monitors filter health and maintains the warm-restart checkpoints
+   * @param message Contains our timestamp, images, and camera ids
+   *
+   * Called after every update when warm reinitialization is enabled. While the
+   * estimate is healthy (finite mean, bounded position uncertainty) this keeps two
+   * rolling checkpoints of the published state snapshot, the restore point trailing
+   * the newest one by at least half a second so a slow divergence cannot poison it
+   * before the monitor trips. After a sustained run of unhealthy updates it either
+   * warm-restarts from the trailing checkpoint or, if that is too stale, falls all
+   * the way back to the cold initializer.
+   */
+  void update_warm_reinit(const ov_core::CameraData &message);
+
+  /**
+   * @brief Re-seeds the filter from the last healthy checkpoint after divergence
+   * @param timestamp Current camera time we should restart the filter at
+   *
+   * Marginalizes every clone and landmark out of the state, resets the IMU mean to
+   * the checkpoint values (pose, velocity and biases) with an inflated block-diagonal
+   * prior, and restarts estimation at the given time. Calibration states keep their
+   * converged values and covariance. This skips the 3-5 second cold initialization
+   * entirely since the biases and gravity alignment from the checkpoint are still valid.
+   */
+  void warm_reinitialize(double timestamp);
+
   /**
    * @brief This function will will re-triangulate all features in the current frame
    *
@@ -187,6 +301,103 @@ protected:
    */
   void retriangulate_active_tracks(const ov_core::CameraData &message);
 
+  /**
+   * @brief Selects which max-track features get promoted into SLAM landmarks
+   * @param feats_maxtracks Candidates that reached max track length (selected ones are removed)
+   * @param valid_amount Number of open SLAM slots we may fill
+   * @return The selected features, best candidate first
+   *
+   * Each promoted landmark is a covariance-expanding slot we keep paying for in
+   * delayed_init and every SLAM update after it, so instead of promoting whichever
+   * candidates sit at the tail of the list we rank them. Track parallax and
+   * measurement count proxy the information the landmark will contribute (they bound
+   * its predicted innovation covariance), and bearings orthogonal to the dominant
+   * direction of the current position uncertainty get a bonus since they constrain
+   * exactly what the filter is least sure about. Selection is then greedy over the
+   * tracker's detection grid, one landmark per cell while free cells remain (active
+   * SLAM features claim their cells first), so the chosen set covers the image
+   * instead of clustering on a single structure.
+   */
+  std::vector<std::shared_ptr<ov_core::Feature>> select_slam_candidates(std::vector<std::shared_ptr<ov_core::Feature>> &feats_maxtracks,
+                                                                        int valid_amount);
+
+  /**
+   * @brief Closed-loop controller which adapts our processing budget to the platform
+   * @param time_total Total processing time of the frame that just finished (seconds)
+   *
+   * Tracks a smoothed per-frame latency from the stage timings and, when we run over
+   * the target, trims the number of tracked points, raises the detection threshold and
+   * lowers the MSCKF update cap (each towards a floor of half / double the configured
+   * values). When we have comfortable headroom the knobs are walked back towards their
+   * configured values. This degrades quality gradually under load instead of the bursty
+   * behavior of dropping whole frames once the camera queue backs up.
+   */
+  void update_tracking_budget(double time_total);
+
+  /**
+   * @brief Reconfigures the processing knobs for the given performance tier
+   * @param tier Tier to switch to (0 = full, 1 = reduced, 2 = minimum)
+   *
+   * Called between frames (never mid-pipeline) from track_image_and_update when a
+   * requested tier differs from the active one. Tier values are derived by scaling
+   * the configured ones, so returning to PERF_TIER_FULL restores the exact startup
+   * configuration. Pyramid depth changes are safe against the pooled pyramids since
+   * the LK calls clamp to the levels the pyramids were actually built with.
+   */
+  void apply_perf_tier(int tier);
+
+  /**
+   * @brief Internal governor policy which picks a tier from the frame timings
+   * @param time_total Total processing time of the frame that just finished (seconds)
+   *
+   * Unlike the continuous budget controller this moves between the predefined tiers
+   * with hysteresis: we demote after a sustained run of frames over the latency target
+   * and only promote after a much longer run with comfortable headroom, so the system
+   * degrades (and recovers) in deliberate steps instead of oscillating.
+   */
+  void update_perf_governor(double time_total);
+
+  /**
+   * @brief Per-stage SLA watchdog which dumps the flight recorder on a budget overrun
+   *
+   * Called once per frame after the stage timings have been collected. Each pipeline
+   * stage (tracking, propagation, MSCKF update, SLAM update incl. delayed init, and
+   * re-tri & marg) is checked against its configured millisecond budget, and if any
+   * ran over we dump the in-memory trace ring plus the allocation-auditor counters
+   * into the watchdog dump directory. This gives post-hoc visibility into tail
+   * latency (the occasional 80ms frame) without any always-on logging, since the
+   * flight recorder only ever lives in memory until a budget actually trips.
+   */
+  void update_stage_watchdog();
+
+  /**
+   * @brief Online covariance conditioning monitor (early divergence warning)
+   *
+   * Called once per frame after an update. Tracks the extreme eigenvalues of the
+   * covariance with a few warm-started power iterations (the eigenvector estimates
+   * carry over between frames, so each call costs a handful of O(n^2) matrix-vector
+   * products instead of the O(n^3) decomposition an exact condition number needs).
+   * Conditioning tends to collapse a few seconds before the mean visibly diverges,
+   * so when the estimate crosses the configured limit we warn immediately, and if
+   * the stage watchdog is enabled its flight-recorder dump fires so the frames
+   * leading into the collapse can be inspected post-hoc.
+   */
+  void update_cond_monitor();
+
+  /**
+   * @brief Publish the current (or predicted) odometry into the shared-memory segment
+   *
+   * Writes a pose/twist/covariance record into the seqlock-versioned segment so
+   * co-located non-ROS consumers (e.g. a flight controller) read state without a
+   * bridge or any serialization. Called after each update with the posterior state,
+   * and from the inertial feed with a fast predicted state at the reading's time.
+   *
+   * @param timestamp Time to publish at (camera clock)
+   * @param propagate If true, predict ahead with fast_state_propagate instead of
+   *        reading the posterior state directly
+   */
+  void publish_shm_odometry(double timestamp, bool propagate);
+
   /// Manager parameters
   VioManagerOptions params;
 
@@ -220,6 +431,28 @@ protected:
   /// Our global measurement updater
   std::shared_ptr<UpdaterGlobal> updaterGlobal;
 
+  /// Optional fixed-lag smoother refining marginalized clones in the background
+  std::shared_ptr<FixedLagSmoother> smoother;
+
+  /// Smoothed per-frame processing time used by the budget controller (negative until the first frame)
+  double budget_avg_time = -1;
+
+  /// Performance tier requested by external code or the governor policy (applied before the next frame)
+  std::atomic<int> perf_tier_requested{PERF_TIER_FULL};
+
+  /// Performance tier the pipeline is currently running at
+  int perf_tier_active = PERF_TIER_FULL;
+
+  /// Smoothed per-frame processing time used by the governor policy (negative until the first frame)
+  double governor_avg_time = -1;
+
+  /// Consecutive frames the governor has seen over / comfortably under the latency target
+  int governor_frames_over = 0;
+  int governor_frames_under = 0;
+
+  /// Configured KLT pyramid depth captured before the first tier change (negative until captured)
+  int pyr_levels_config = -1;
+
   /// This is the queue of measurement times that have come in since we starting doing initialization
   /// After we initialize, we will want to prop & update to the latest timestamp quickly
   std::vector<double> camera_queue_init;
@@ -227,7 +460,30 @@ protected:
 
   // Timing statistic file and variables
   std::ofstream of_statistics;
-  boost::posix_time::ptime rT1, rT2, rT3, rT4, rT5, rT6, rT7;
+
+  /// Measured time of the last tracking stage (set in track_image_and_update)
+  double time_track = 0.0;
+
+  /// Timing spans of the last update (see get_timing_spans)
+  Eigen::Matrix<double, 7, 1> timing_spans_last = Eigen::Matrix<double, 7, 1>::Zero();
+
+  /// Receive tick stamp of the last frame through the pipeline (see get_frame_received)
+  uint64_t frame_received_last = 0;
+
+  /// Queue wait of the last frame in seconds (driver handoff to pipeline entry)
+  double latency_queue_last = 0.0;
+
+  /// Number of dumps the stage watchdog has written this run (capped by watchdog_max_dumps)
+  int watchdog_num_dumps = 0;
+
+  /// Warm-started eigenvector estimates of the conditioning monitor (carried between frames)
+  Eigen::VectorXd cond_vec_max, cond_vec_min;
+
+  /// Latest covariance condition number estimate (zero until the monitor has run)
+  double cond_number_last = 0.0;
+
+  /// Shared-memory odometry writer for ROS-free consumers (null unless enabled)
+  std::shared_ptr<ShmOdometryWriter> shm_output;
 
   // Track how much distance we have traveled
   double timelastupdate = -1;
@@ -236,22 +492,55 @@ protected:
   // Startup time of the filter
   double startup_time = -1;
 
+  /// Rolling checkpoints of the last healthy estimate (restore point trails the newest by at least half a second)
+  std::shared_ptr<const StateSnapshot> warm_ckpt_new, warm_ckpt_old;
+
+  /// Consecutive unhealthy updates the divergence monitor has seen
+  int warm_frames_unhealthy = 0;
+
   // Threads and their atomics
   std::atomic<bool> thread_init_running, thread_init_success;
 
+  // Background thread which finishes constructing the heavy members (see construct_trackers_and_updaters)
+  std::thread thread_construct;
+  std::mutex thread_construct_mtx;
+  std::atomic<bool> thread_construct_done;
+
+  // IMU messages that arrived before background construction finished
+  // These are replayed into the initializer and zero velocity updater once they exist
+  std::vector<ov_core::ImuData> imu_queue_construct;
+  std::mutex imu_queue_construct_mtx;
+
   // If we did a zero velocity update
   bool did_zupt_update = false;
   bool has_moved_since_zupt = false;
 
+  // Timestamp of the last frame the tracker processed
+  // This can be newer than the state time when update decimation is active
+  double time_last_tracked = -1;
+
+  // Tracked-only frames since the last one that ran the EKF update (update decimation)
+  int frames_since_update = 0;
+
   // Good features that where used in the last update (used in visualization)
   std::vector<Eigen::Vector3d> good_features_MSCKF;
 
+  // How many frames each feature has been deferred by the MSCKF update cap.
+  // Features over the cap are not consumed (they stay in the database and are
+  // re-collected next frame), and each deferral boosts their selection priority
+  // so carried-over measurements are eventually used instead of silently aging
+  // out of the clone window under sustained deadline pressure.
+  std::map<size_t, int> deferred_msckf_counts;
+
   // Re-triangulated features 3d positions seen from the current frame (used in visualization)
   // For each feature we have a linear system A * p_FinG = b we create and increment their costs
   double active_tracks_time = -1;
   std::unordered_map<size_t, Eigen::Vector3d> active_tracks_posinG;
   std::unordered_map<size_t, Eigen::Vector3d> active_tracks_uvd;
   cv::Mat active_image;
+
+  // Compressed history of every frame's active track observations (used for loop-closure export)
+  ov_core::TrackArchive track_archive;
   std::map<size_t, Eigen::Matrix3d> active_feat_linsys_A;
   std::map<size_t, Eigen::Vector3d> active_feat_linsys_b;
   std::map<size_t, int> active_feat_linsys_count;
@@ -33,12 +33,17 @@
 #include "state/State.h"
 #include "state/StateHelper.h"
 
+#include <cmath>
+
 using namespace ov_core;
 using namespace ov_type;
 using namespace ov_msckf;
 
 void VioManager::initialize_with_gt(Eigen::Matrix<double, 17, 1> imustate) {
 
+  // We touch the trackers below, so construction must have finished
+  wait_for_construction();
+
   // Expand state to include keyframe states (initialized as zero)
   Eigen::Matrix<double, 24, 1> full_imustate = Eigen::Matrix<double, 24, 1>::Zero();
   full_imustate.block(0, 0, 17, 1) = imustate;
@@ -195,6 +200,134 @@ bool VioManager::try_to_initialize(const ov_core::CameraData &message) {
   return false;
 }
 
+void VioManager::update_warm_reinit(const ov_core::CameraData &message) {
+
+  // Health of the current estimate: the mean must be finite and the position
+  // uncertainty must not have exploded past the configured bound
+  bool healthy = state->_imu->value().allFinite();
+  double pos_std = 0.0;
+  if (healthy) {
+    Eigen::MatrixXd P_pose = StateHelper::get_marginal_covariance(state, {state->_imu->pose()});
+    for (int i = 3; i < 6; i++) {
+      pos_std = std::max(pos_std, std::sqrt(std::max(P_pose(i, i), 0.0)));
+    }
+    healthy = std::isfinite(pos_std) && pos_std < params.warm_reinit_max_pos_std;
+  }
+
+  // While healthy we keep the checkpoints rolling forward
+  // The restore point trails the newest checkpoint by at least half a second so a
+  // slow divergence cannot poison it before the monitor trips below
+  if (healthy) {
+    warm_frames_unhealthy = 0;
+    std::shared_ptr<const StateSnapshot> snap = state->get_snapshot();
+    if (snap == nullptr)
+      return;
+    if (warm_ckpt_new == nullptr) {
+      warm_ckpt_new = snap;
+      warm_ckpt_old = snap;
+    } else if (snap->timestamp - warm_ckpt_new->timestamp >= 0.5) {
+      warm_ckpt_old = warm_ckpt_new;
+      warm_ckpt_new = snap;
+    }
+    return;
+  }
+
+  // Require a sustained run of unhealthy updates before declaring divergence
+  // A single bad frame can spike the uncertainty and be absorbed by the next ones
+  warm_frames_unhealthy++;
+  PRINT_WARNING(YELLOW "[warm-init]: unhealthy update (pos std %.2f m), %d of %d before restart\n" RESET, pos_std, warm_frames_unhealthy,
+                params.warm_reinit_frames);
+  if (warm_frames_unhealthy < params.warm_reinit_frames)
+    return;
+  warm_frames_unhealthy = 0;
+
+  // If the checkpoint is too stale (or we never got one) the biases can no longer be
+  // trusted either, so fall all the way back to the cold initializer
+  if (warm_ckpt_old == nullptr || message.timestamp - warm_ckpt_old->timestamp > params.warm_reinit_max_gap) {
+    PRINT_ERROR(RED "[warm-init]: filter diverged with no usable checkpoint, falling back to cold initialization\n" RESET);
+    warm_ckpt_new = nullptr;
+    warm_ckpt_old = nullptr;
+    is_initialized_vio = false;
+    thread_init_success = false;
+    return;
+  }
+
+  // Otherwise we can warm-restart from the checkpoint
+  warm_reinitialize(message.timestamp);
+}
+
+void VioManager::warm_reinitialize(double timestamp) {
+
+  // Grab the restore point, and forget both checkpoints so the monitor has to see
+  // a fresh run of healthy updates before it trusts the restarted filter again
+  std::shared_ptr<const StateSnapshot> ckpt = warm_ckpt_old;
+  warm_ckpt_new = nullptr;
+  warm_ckpt_old = nullptr;
+  PRINT_WARNING(RED "[warm-init]: filter diverged, warm restart from checkpoint %.2f seconds in the past\n" RESET,
+                timestamp - ckpt->timestamp);
+
+  {
+    // Lock the mutex to avoid deleting any elements from _clones_IMU while accessing it from other threads
+    std::lock_guard<std::mutex> lock(state->_mutex_state);
+
+    // Marginalize every landmark out of the state (aruco included, they will re-initialize)
+    // NOTE: we do not re-seed the checkpoint landmark set into the state since anchored
+    // NOTE: representations need clone poses which no longer exist after the restart,
+    // NOTE: the trackers will re-initialize SLAM features within a few frames anyways
+    auto it0 = state->_features_SLAM.begin();
+    while (it0 != state->_features_SLAM.end()) {
+      StateHelper::marginalize(state, (*it0).second);
+      it0 = state->_features_SLAM.erase(it0);
+    }
+
+    // Then marginalize all the clone poses, recycling them into the clone pool
+    while (!state->_clones_IMU.empty()) {
+      double clone_time = state->_clones_IMU.begin()->first;
+      std::shared_ptr<PoseJPL> marg_pose = state->_clones_IMU.begin()->second;
+      StateHelper::marginalize(state, marg_pose);
+      state->_clones_IMU.erase(clone_time);
+      state->_clones_index.erase(clone_time);
+      if ((int)state->_clone_pool.size() <= state->_options.max_clone_size) {
+        state->_clone_pool.push_back(marg_pose);
+      }
+    }
+
+    // Reset the IMU mean to the checkpoint values (keyframe gauge states at identity
+    // relative to the restart pose, mirroring what initialize_with_gt does)
+    Eigen::Matrix<double, 23, 1> imu_val = Eigen::Matrix<double, 23, 1>::Zero();
+    imu_val.block(0, 0, 16, 1) = ckpt->imu_value;
+    imu_val(19) = 1.0;
+    state->_imu->set_value(imu_val);
+    state->_imu->set_fej(imu_val);
+    state->_keyframe_def->set_value(ckpt->imu_value.block(0, 0, 7, 1));
+
+    // Inflated block-diagonal prior on the IMU state
+    // The biases and gravity alignment from the checkpoint are still good, but the pose
+    // and velocity are up to a couple of frames stale so they get a generous sigma
+    Eigen::MatrixXd Cov = Eigen::MatrixXd::Zero(state->_imu->size(), state->_imu->size());
+    Cov.block(0, 0, 3, 3) = std::pow(0.05, 2) * Eigen::Matrix3d::Identity();   // q
+    Cov.block(3, 3, 3, 3) = std::pow(0.10, 2) * Eigen::Matrix3d::Identity();   // p
+    Cov.block(6, 6, 3, 3) = std::pow(0.25, 2) * Eigen::Matrix3d::Identity();   // v
+    Cov.block(9, 9, 3, 3) = std::pow(0.01, 2) * Eigen::Matrix3d::Identity();   // bg
+    Cov.block(12, 12, 3, 3) = std::pow(0.05, 2) * Eigen::Matrix3d::Identity(); // ba
+    Cov.block(15, 15, 3, 3) = 1e-9 * Eigen::Matrix3d::Identity();              // keyframe_q
+    Cov.block(18, 18, 3, 3) = 1e-9 * Eigen::Matrix3d::Identity();              // keyframe_p
+    StateHelper::reset_covariance(state, state->_imu, Cov);
+
+    // Restart estimation at the current camera time
+    state->_timestamp = timestamp;
+  }
+
+  // The propagator caches are keyed off the old trajectory, drop them
+  propagator->invalidate_cache();
+
+  // Cleanup any feature measurements older than the restart time
+  trackFEATS->get_feature_database()->cleanup_measurements(state->_timestamp);
+  if (trackARUCO != nullptr) {
+    trackARUCO->get_feature_database()->cleanup_measurements(state->_timestamp);
+  }
+}
+
 void VioManager::retriangulate_active_tracks(const ov_core::CameraData &message) {
 
   // Start timing
@@ -207,7 +340,11 @@ void VioManager::retriangulate_active_tracks(const ov_core::CameraData &message)
   active_image = cv::Mat();
   trackFEATS->display_active(active_image, 255, 255, 255, 255, 255, 255, " ");
   if (!active_image.empty()) {
-    active_image = active_image(cv::Rect(0, 0, message.images.at(0).cols, message.images.at(0).rows));
+    // The mosaic is rendered at the tracker's display scale, so crop the cam0 cell at that scale
+    double display_scale = trackFEATS->get_display_scale();
+    int cols = std::max(1, (int)std::round(display_scale * message.images.at(0).cols));
+    int rows = std::max(1, (int)std::round(display_scale * message.images.at(0).rows));
+    active_image = active_image(cv::Rect(0, 0, cols, rows));
   }
   active_tracks_posinG.clear();
   active_tracks_uvd.clear();
@@ -385,6 +522,9 @@ void VioManager::retriangulate_active_tracks(const ov_core::CameraData &message)
     uvd << uv_dist, depth;
     active_tracks_uvd.insert({feat.first, uvd});
   }
+
+  // Archive this frame's observations in the compressed track history
+  track_archive.append_frame(active_tracks_time, active_tracks_uvd);
   retri_rT3 = boost::posix_time::microsec_clock::local_time();
 
   // Timing information
@@ -423,47 +563,31 @@ cv::Mat VioManager::get_historical_viz_image() {
 }
 
 std::vector<Eigen::Vector3d> VioManager::get_features_SLAM() {
+  // Read from the published snapshot (anchored landmarks already resolved into global)
+  // so this is safe to call from any thread without racing the filter
   std::vector<Eigen::Vector3d> slam_feats;
-  for (auto &f : state->_features_SLAM) {
+  std::shared_ptr<const StateSnapshot> snap = state->get_snapshot();
+  if (snap == nullptr)
+    return slam_feats;
+  for (const auto &f : snap->features_SLAM) {
     if ((int)f.first <= 4 * state->_options.max_aruco_features)
       continue;
-    if (ov_type::LandmarkRepresentation::is_relative_representation(f.second->_feat_representation)) {
-      // Assert that we have an anchor pose for this feature
-      assert(f.second->_anchor_cam_id != -1);
-      // Get calibration for our anchor camera
-      Eigen::Matrix<double, 3, 3> R_ItoC = state->_calib_IMUtoCAM.at(f.second->_anchor_cam_id)->Rot();
-      Eigen::Matrix<double, 3, 1> p_IinC = state->_calib_IMUtoCAM.at(f.second->_anchor_cam_id)->pos();
-      // Anchor pose orientation and position
-      Eigen::Matrix<double, 3, 3> R_GtoI = state->_clones_IMU.at(f.second->_anchor_clone_timestamp)->Rot();
-      Eigen::Matrix<double, 3, 1> p_IinG = state->_clones_IMU.at(f.second->_anchor_clone_timestamp)->pos();
-      // Feature in the global frame
-      slam_feats.push_back(R_GtoI.transpose() * R_ItoC.transpose() * (f.second->get_xyz(false) - p_IinC) + p_IinG);
-    } else {
-      slam_feats.push_back(f.second->get_xyz(false));
-    }
+    slam_feats.push_back(f.second);
   }
   return slam_feats;
 }
 
 std::vector<Eigen::Vector3d> VioManager::get_features_ARUCO() {
+  // Read from the published snapshot (anchored landmarks already resolved into global)
+  // so this is safe to call from any thread without racing the filter
   std::vector<Eigen::Vector3d> aruco_feats;
-  for (auto &f : state->_features_SLAM) {
+  std::shared_ptr<const StateSnapshot> snap = state->get_snapshot();
+  if (snap == nullptr)
+    return aruco_feats;
+  for (const auto &f : snap->features_SLAM) {
     if ((int)f.first > 4 * state->_options.max_aruco_features)
       continue;
-    if (ov_type::LandmarkRepresentation::is_relative_representation(f.second->_feat_representation)) {
-      // Assert that we have an anchor pose for this feature
-      assert(f.second->_anchor_cam_id != -1);
-      // Get calibration for our anchor camera
-      Eigen::Matrix<double, 3, 3> R_ItoC = state->_calib_IMUtoCAM.at(f.second->_anchor_cam_id)->Rot();
-      Eigen::Matrix<double, 3, 1> p_IinC = state->_calib_IMUtoCAM.at(f.second->_anchor_cam_id)->pos();
-      // Anchor pose orientation and position
-      Eigen::Matrix<double, 3, 3> R_GtoI = state->_clones_IMU.at(f.second->_anchor_clone_timestamp)->Rot();
-      Eigen::Matrix<double, 3, 1> p_IinG = state->_clones_IMU.at(f.second->_anchor_clone_timestamp)->pos();
-      // Feature in the global frame
-      aruco_feats.push_back(R_GtoI.transpose() * R_ItoC.transpose() * (f.second->get_xyz(false) - p_IinC) + p_IinG);
-    } else {
-      aruco_feats.push_back(f.second->get_xyz(false));
-    }
+    aruco_feats.push_back(f.second);
   }
   return aruco_feats;
 }
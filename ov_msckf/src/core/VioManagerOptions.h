@@ -37,6 +37,7 @@
 
 #include "cam/CamEqui.h"
 #include "cam/CamRadtan.h"
+#include "cam/CamRectified.h"
 #include "feat/FeatureInitializerOptions.h"
 #include "track/TrackBase.h"
 #include "utils/colors.h"
@@ -100,6 +101,81 @@ struct VioManagerOptions {
   /// The path to the file we will record the timing information into
   std::string record_timing_filepath = "ov_msckf_timing.txt";
 
+  /// If we should record hot-path trace spans into the flight recorder (see ov_core::Tracer)
+  bool record_trace_information = false;
+
+  /// The path to the file we will dump the recorded trace spans into
+  std::string record_trace_filepath = "ov_msckf_trace.txt";
+
+  /// If we should attribute heap allocations to the trace stages (see ov_core::AllocAudit)
+  bool record_alloc_information = false;
+
+  /// If we should watch the per-stage frame times and dump the flight recorder when a budget is exceeded
+  bool use_stage_watchdog = false;
+
+  /// Watchdog budget for the tracking stage in milliseconds
+  double watchdog_ms_tracking = 25.0;
+
+  /// Watchdog budget for the propagation stage in milliseconds
+  double watchdog_ms_propagation = 5.0;
+
+  /// Watchdog budget for the MSCKF update stage in milliseconds
+  double watchdog_ms_msckf = 25.0;
+
+  /// Watchdog budget for the SLAM update and delayed initialization stages in milliseconds
+  double watchdog_ms_slam = 25.0;
+
+  /// Watchdog budget for the re-triangulation and marginalization stage in milliseconds
+  double watchdog_ms_marg = 10.0;
+
+  /// Directory the watchdog writes its trace and allocation dumps into
+  std::string watchdog_dump_path = "ov_msckf_watchdog";
+
+  /// Maximum number of dumps a single run may write (so a struggling platform cannot fill the disk)
+  int watchdog_max_dumps = 5;
+
+  /// If we should run the asynchronous fixed-lag smoother over marginalized clones
+  bool use_fixed_lag_smoother = false;
+
+  /// Lag, in seconds, behind real time that the smoother emits refined poses
+  double fixed_lag_smoother_lag = 5.0;
+
+  /// If we should preallocate an arena for the big recurring allocations (see ov_core::MemoryArena)
+  bool use_memory_prealloc = false;
+
+  /// If the preallocated arena should be backed by huge pages (needs kernel support)
+  bool memory_use_hugepages = false;
+
+  /// Size of the preallocated arena in MB (zero sizes it from the configuration)
+  int memory_arena_mb = 0;
+
+  /// If we should monitor filter health and warm-restart from the last healthy checkpoint on divergence
+  bool use_warm_reinit = false;
+
+  /// Consecutive unhealthy updates before we declare the filter diverged
+  int warm_reinit_frames = 3;
+
+  /// Position standard deviation (meters) above which an update is considered unhealthy
+  double warm_reinit_max_pos_std = 2.0;
+
+  /// Maximum age (seconds) of a checkpoint we are still willing to restart from
+  double warm_reinit_max_gap = 2.0;
+
+  /// If we should track the covariance conditioning online and warn before it collapses
+  bool use_cond_monitor = false;
+
+  /// Warm-started power iterations to run on each spectrum extreme per frame (a few suffice)
+  int cond_monitor_iterations = 2;
+
+  /// Condition number above which the monitor warns (and trips the watchdog dump if enabled)
+  double cond_monitor_max = 1e12;
+
+  /// If we should publish pose/twist/covariance into a shared-memory segment for ROS-free consumers
+  bool use_shm_output = false;
+
+  /// Name of the POSIX shared-memory segment we publish into (see shm_odometry.h)
+  std::string shm_output_name = "ov_msckf_odometry";
+
   /**
    * @brief This function will load print out all estimator settings loaded.
    * This allows for visual checking that everything was loaded properly from ROS/CMD parsers.
@@ -119,6 +195,31 @@ struct VioManagerOptions {
       parser->parse_config("zupt_only_at_beginning", zupt_only_at_beginning);
       parser->parse_config("record_timing_information", record_timing_information);
       parser->parse_config("record_timing_filepath", record_timing_filepath);
+      parser->parse_config("record_trace_information", record_trace_information, false);
+      parser->parse_config("record_trace_filepath", record_trace_filepath, false);
+      parser->parse_config("record_alloc_information", record_alloc_information, false);
+      parser->parse_config("use_stage_watchdog", use_stage_watchdog, false);
+      parser->parse_config("watchdog_ms_tracking", watchdog_ms_tracking, false);
+      parser->parse_config("watchdog_ms_propagation", watchdog_ms_propagation, false);
+      parser->parse_config("watchdog_ms_msckf", watchdog_ms_msckf, false);
+      parser->parse_config("watchdog_ms_slam", watchdog_ms_slam, false);
+      parser->parse_config("watchdog_ms_marg", watchdog_ms_marg, false);
+      parser->parse_config("watchdog_dump_path", watchdog_dump_path, false);
+      parser->parse_config("watchdog_max_dumps", watchdog_max_dumps, false);
+      parser->parse_config("use_fixed_lag_smoother", use_fixed_lag_smoother, false);
+      parser->parse_config("fixed_lag_smoother_lag", fixed_lag_smoother_lag, false);
+      parser->parse_config("use_memory_prealloc", use_memory_prealloc, false);
+      parser->parse_config("memory_use_hugepages", memory_use_hugepages, false);
+      parser->parse_config("memory_arena_mb", memory_arena_mb, false);
+      parser->parse_config("use_warm_reinit", use_warm_reinit, false);
+      parser->parse_config("warm_reinit_frames", warm_reinit_frames, false);
+      parser->parse_config("warm_reinit_max_pos_std", warm_reinit_max_pos_std, false);
+      parser->parse_config("warm_reinit_max_gap", warm_reinit_max_gap, false);
+      parser->parse_config("use_cond_monitor", use_cond_monitor, false);
+      parser->parse_config("cond_monitor_iterations", cond_monitor_iterations, false);
+      parser->parse_config("cond_monitor_max", cond_monitor_max, false);
+      parser->parse_config("use_shm_output", use_shm_output, false);
+      parser->parse_config("shm_output_name", shm_output_name, false);
     }
     PRINT_DEBUG("  - dt_slam_delay: %.1f\n", dt_slam_delay);
     PRINT_DEBUG("  - zero_velocity_update: %d\n", try_zupt);
@@ -128,6 +229,34 @@ struct VioManagerOptions {
     PRINT_DEBUG("  - zupt_only_at_beginning?: %d\n", zupt_only_at_beginning);
     PRINT_DEBUG("  - record timing?: %d\n", (int)record_timing_information);
     PRINT_DEBUG("  - record timing filepath: %s\n", record_timing_filepath.c_str());
+    PRINT_DEBUG("  - record trace?: %d\n", (int)record_trace_information);
+    PRINT_DEBUG("  - record trace filepath: %s\n", record_trace_filepath.c_str());
+    PRINT_DEBUG("  - record allocations?: %d\n", (int)record_alloc_information);
+    PRINT_DEBUG("  - use stage watchdog?: %d\n", (int)use_stage_watchdog);
+    if (use_stage_watchdog) {
+      PRINT_DEBUG("  - watchdog budgets (ms): track %.1f | prop %.1f | msckf %.1f | slam %.1f | marg %.1f\n", watchdog_ms_tracking,
+                  watchdog_ms_propagation, watchdog_ms_msckf, watchdog_ms_slam, watchdog_ms_marg);
+      PRINT_DEBUG("  - watchdog dump path: %s\n", watchdog_dump_path.c_str());
+      PRINT_DEBUG("  - watchdog max dumps: %d\n", watchdog_max_dumps);
+    }
+    PRINT_DEBUG("  - use fixed-lag smoother?: %d\n", (int)use_fixed_lag_smoother);
+    PRINT_DEBUG("  - fixed-lag smoother lag: %.1f\n", fixed_lag_smoother_lag);
+    PRINT_DEBUG("  - use memory prealloc?: %d\n", (int)use_memory_prealloc);
+    PRINT_DEBUG("  - memory use hugepages?: %d\n", (int)memory_use_hugepages);
+    PRINT_DEBUG("  - memory arena mb: %d\n", memory_arena_mb);
+    PRINT_DEBUG("  - use warm reinit?: %d\n", (int)use_warm_reinit);
+    PRINT_DEBUG("  - warm reinit frames: %d\n", warm_reinit_frames);
+    PRINT_DEBUG("  - warm reinit max pos std: %.2f\n", warm_reinit_max_pos_std);
+    PRINT_DEBUG("  - warm reinit max gap: %.1f\n", warm_reinit_max_gap);
+    PRINT_DEBUG("  - use cond monitor?: %d\n", (int)use_cond_monitor);
+    if (use_cond_monitor) {
+      PRINT_DEBUG("  - cond monitor iterations: %d\n", cond_monitor_iterations);
+      PRINT_DEBUG("  - cond monitor max: %.1e\n", cond_monitor_max);
+    }
+    PRINT_DEBUG("  - use shm output?: %d\n", (int)use_shm_output);
+    if (use_shm_output) {
+      PRINT_DEBUG("  - shm output name: %s\n", shm_output_name.c_str());
+    }
   }
 
   // NOISE / CHI2 ============================
@@ -160,7 +289,28 @@ struct VioManagerOptions {
       parser->parse_external("relative_config_imu", "imu0", "gyroscope_random_walk", imu_noises.sigma_wb);
       parser->parse_external("relative_config_imu", "imu0", "accelerometer_noise_density", imu_noises.sigma_a);
       parser->parse_external("relative_config_imu", "imu0", "accelerometer_random_walk", imu_noises.sigma_ab);
+      // Optional per-axis overrides (three values, any negative falls back to the isotropic sigma)
+      std::vector<double> sigma_w_axis = {-1, -1, -1};
+      std::vector<double> sigma_wb_axis = {-1, -1, -1};
+      std::vector<double> sigma_a_axis = {-1, -1, -1};
+      std::vector<double> sigma_ab_axis = {-1, -1, -1};
+      parser->parse_external("relative_config_imu", "imu0", "gyroscope_noise_density_axis", sigma_w_axis, false);
+      parser->parse_external("relative_config_imu", "imu0", "gyroscope_random_walk_axis", sigma_wb_axis, false);
+      parser->parse_external("relative_config_imu", "imu0", "accelerometer_noise_density_axis", sigma_a_axis, false);
+      parser->parse_external("relative_config_imu", "imu0", "accelerometer_random_walk_axis", sigma_ab_axis, false);
+      if (sigma_w_axis.size() == 3 && sigma_wb_axis.size() == 3 && sigma_a_axis.size() == 3 && sigma_ab_axis.size() == 3) {
+        for (int i = 0; i < 3; i++) {
+          imu_noises.sigma_w_axis(i) = sigma_w_axis.at(i);
+          imu_noises.sigma_wb_axis(i) = sigma_wb_axis.at(i);
+          imu_noises.sigma_a_axis(i) = sigma_a_axis.at(i);
+          imu_noises.sigma_ab_axis(i) = sigma_ab_axis.at(i);
+        }
+      } else {
+        PRINT_ERROR(RED "VioManager(): per-axis imu noise must have exactly three values!\n" RESET);
+        std::exit(EXIT_FAILURE);
+      }
     }
+    imu_noises.prepare();
     imu_noises.print();
     if (parser != nullptr) {
       parser->parse_config("up_msckf_sigma_px", msckf_options.sigma_pix);
@@ -172,6 +322,15 @@ struct VioManagerOptions {
       msckf_options.sigma_pix_sq = std::pow(msckf_options.sigma_pix, 2);
       slam_options.sigma_pix_sq = std::pow(slam_options.sigma_pix, 2);
       aruco_options.sigma_pix_sq = std::pow(aruco_options.sigma_pix, 2);
+      // One robust weighting configuration shared by the visual feature updaters
+      // (the aruco measurements stay hard-gated, markers are either right or wrong)
+      parser->parse_config("up_robust_norm", msckf_options.robust_norm, false);
+      parser->parse_config("up_robust_norm_c", msckf_options.robust_norm_c, false);
+      parser->parse_config("up_robust_chi2_relax", msckf_options.robust_chi2_relax, false);
+      parser->parse_config("up_msckf_partition_by_camera", msckf_options.partition_by_camera, false);
+      slam_options.robust_norm = msckf_options.robust_norm;
+      slam_options.robust_norm_c = msckf_options.robust_norm_c;
+      slam_options.robust_chi2_relax = msckf_options.robust_chi2_relax;
       parser->parse_config("zupt_chi2_multipler", zupt_options.chi2_multipler);
     }
     PRINT_DEBUG("  Updater MSCKF Feats:\n");
@@ -272,6 +431,9 @@ struct VioManagerOptions {
         if (dist_model == "equidistant") {
           camera_intrinsics.insert({i, std::make_shared<ov_core::CamEqui>(matrix_wh.at(0), matrix_wh.at(1))});
           camera_intrinsics.at(i)->set_value(cam_calib);
+        } else if (dist_model == "rectified" || dist_model == "none") {
+          camera_intrinsics.insert({i, std::make_shared<ov_core::CamRectified>(matrix_wh.at(0), matrix_wh.at(1))});
+          camera_intrinsics.at(i)->set_value(cam_calib);
         } else {
           camera_intrinsics.insert({i, std::make_shared<ov_core::CamRadtan>(matrix_wh.at(0), matrix_wh.at(1))});
           camera_intrinsics.at(i)->set_value(cam_calib);
@@ -399,6 +561,25 @@ struct VioManagerOptions {
   /// If we should use KLT tracking, or descriptor matcher
   bool use_klt = true;
 
+  /// If the KLT tracker should try to run its optical flow on the GPU.
+  /// Requires OpenCV built with the CUDA optflow module, otherwise (or if no
+  /// device is present at runtime) tracking silently falls back to the CPU.
+  bool use_gpu_tracking = false;
+
+  /// If the KLT tracker should match long-lived stable tracks on the half-resolution
+  /// pyramid levels with a smaller window, leaving only the new and uncertain features
+  /// at full resolution (large savings in steady state on high resolution streams)
+  bool klt_multires_tracking = false;
+
+  /// Number of frames a track has to survive before the multi-resolution KLT tracker
+  /// demotes it to the half-resolution tier
+  int klt_multires_age = 15;
+
+  /// If the fixed stereo extrinsics should be handed to the KLT tracker so the stereo
+  /// leg of detection can do a 1d epipolar search instead of the full 2d pyramidal LK
+  /// solve (ignored if the camera extrinsics are being calibrated online)
+  bool use_stereo_epipolar_matching = false;
+
   /// If should extract aruco tags and estimate them
   bool use_aruco = true;
 
@@ -408,9 +589,27 @@ struct VioManagerOptions {
   /// Will half the resolution all tracking image (aruco will be 1/4 instead of halved if dowsize_aruoc also enabled)
   bool downsample_cameras = false;
 
+  /// Scale the tracker debug images (active tracks and track history) are rendered at.
+  /// Operators usually view these topics at a small size, so rendering the mosaic
+  /// directly at e.g. 0.5 skips coloring and drawing the full sensor resolution.
+  double track_display_scale = 1.0;
+
   /// Threads our front-end should try to use (opencv uses this also)
   int num_opencv_threads = 4;
 
+  /// Core ids our thread pool workers should be pinned to (empty means no pinning)
+  std::vector<int> thread_pool_affinity;
+
+  /// Per-role core affinity, e.g. "track:4,5,6,7;filter:4,5;visualization:0,1" (see ov_core::ThreadRegistry)
+  std::string thread_affinity_policy;
+
+  /// Per-role niceness, e.g. "visualization:10;prefetch:5" (see ov_core::ThreadRegistry)
+  std::string thread_priority_policy;
+
+  /// If our parallel paths should be replay-stable (identical estimates run-to-run
+  /// regardless of thread count, at the cost of losing some early-exit shortcuts)
+  bool deterministic_parallelism = false;
+
   /// If our ROS image publisher should be async (if sim this should be no!)
   bool use_multi_threading_pubs = true;
 
@@ -435,12 +634,38 @@ struct VioManagerOptions {
   /// What type of pre-processing histogram method should be applied to images
   ov_core::TrackBase::HistogramMethod histogram_method = ov_core::TrackBase::HistogramMethod::HISTOGRAM;
 
+  /// If we should undistort through a cached per-camera lookup table (rebuilt lazily on intrinsic drift)
+  bool use_undistort_lut = false;
+
   /// KNN ration between top two descriptor matcher which is required to be a good match
   double knn_ratio = 0.85;
 
   /// Frequency we want to track images at (higher freq ones will be dropped)
   double track_frequency = 20.0;
 
+  /// Run propagation, cloning and the EKF update only on every Nth tracked frame.
+  /// Frames in between are still tracked (which keeps the KLT baselines short and the
+  /// tracks continuous on high-rate cameras) but only cost the tracker, so the filter
+  /// can follow a camera whose full rate it could not sustain. One disables this.
+  int update_decimation = 1;
+
+  /// If we should run the closed-loop budget controller which trims the number of
+  /// tracked points, the detection threshold and the MSCKF update cap to hold the
+  /// target frame latency (instead of only dropping whole frames when behind)
+  bool use_adaptive_budget = false;
+
+  /// Target per-frame processing latency in seconds the budget controller should
+  /// hold (zero means 80 percent of the tracking period is used)
+  double adaptive_budget_latency = 0.0;
+
+  /// If the internal governor policy should drive the performance tiers from the frame
+  /// timings (external code can always drive them through VioManager::set_perf_tier)
+  bool use_perf_governor = false;
+
+  /// Target per-frame processing latency in seconds the governor policy should hold
+  /// (zero means 90 percent of the tracking period is used)
+  double perf_governor_latency = 0.0;
+
   /// Parameters used by our feature initialize / triangulator
   ov_core::FeatureInitializerOptions featinit_options;
 
@@ -454,10 +679,23 @@ struct VioManagerOptions {
     if (parser != nullptr) {
       parser->parse_config("use_stereo", use_stereo);
       parser->parse_config("use_klt", use_klt);
+      parser->parse_config("use_gpu_tracking", use_gpu_tracking, false);
+      parser->parse_config("klt_multires_tracking", klt_multires_tracking, false);
+      parser->parse_config("klt_multires_age", klt_multires_age, false);
+      parser->parse_config("use_stereo_epipolar_matching", use_stereo_epipolar_matching, false);
       parser->parse_config("use_aruco", use_aruco);
       parser->parse_config("downsize_aruco", downsize_aruco);
       parser->parse_config("downsample_cameras", downsample_cameras);
+      parser->parse_config("track_display_scale", track_display_scale, false);
+      if (track_display_scale <= 0.0 || track_display_scale > 1.0) {
+        printf(RED "VioManager(): track_display_scale must be in (0, 1] (%.2f)\n" RESET, track_display_scale);
+        std::exit(EXIT_FAILURE);
+      }
       parser->parse_config("num_opencv_threads", num_opencv_threads);
+      parser->parse_config("thread_pool_affinity", thread_pool_affinity, false);
+      parser->parse_config("thread_affinity_policy", thread_affinity_policy, false);
+      parser->parse_config("thread_priority_policy", thread_priority_policy, false);
+      parser->parse_config("deterministic_parallelism", deterministic_parallelism, false);
       parser->parse_config("multi_threading_pubs", use_multi_threading_pubs, false);
       parser->parse_config("multi_threading_subs", use_multi_threading_subs, false);
       parser->parse_config("num_pts", num_pts);
@@ -480,16 +718,35 @@ struct VioManagerOptions {
         printf(RED "\t- CLAHE\n" RESET);
         std::exit(EXIT_FAILURE);
       }
+      parser->parse_config("use_undistort_lut", use_undistort_lut, false);
       parser->parse_config("knn_ratio", knn_ratio);
       parser->parse_config("track_frequency", track_frequency);
+      parser->parse_config("update_decimation", update_decimation, false);
+      if (update_decimation < 1) {
+        printf(RED "VioManager(): update_decimation must be at least one (%d)\n" RESET, update_decimation);
+        std::exit(EXIT_FAILURE);
+      }
+      parser->parse_config("use_adaptive_budget", use_adaptive_budget, false);
+      parser->parse_config("adaptive_budget_latency", adaptive_budget_latency, false);
+      parser->parse_config("use_perf_governor", use_perf_governor, false);
+      parser->parse_config("perf_governor_latency", perf_governor_latency, false);
     }
     PRINT_DEBUG("FEATURE TRACKING PARAMETERS:\n");
     PRINT_DEBUG("  - use_stereo: %d\n", use_stereo);
     PRINT_DEBUG("  - use_klt: %d\n", use_klt);
+    PRINT_DEBUG("  - use_gpu_tracking: %d\n", use_gpu_tracking);
+    PRINT_DEBUG("  - klt_multires_tracking: %d\n", klt_multires_tracking);
+    PRINT_DEBUG("  - klt_multires_age: %d\n", klt_multires_age);
+    PRINT_DEBUG("  - use_stereo_epipolar_matching: %d\n", use_stereo_epipolar_matching);
     PRINT_DEBUG("  - use_aruco: %d\n", use_aruco);
     PRINT_DEBUG("  - downsize aruco: %d\n", downsize_aruco);
     PRINT_DEBUG("  - downsize cameras: %d\n", downsample_cameras);
+    PRINT_DEBUG("  - track display scale: %.2f\n", track_display_scale);
     PRINT_DEBUG("  - num opencv threads: %d\n", num_opencv_threads);
+    PRINT_DEBUG("  - thread pool affinity cores: %d\n", (int)thread_pool_affinity.size());
+    PRINT_DEBUG("  - thread affinity policy: %s\n", thread_affinity_policy.c_str());
+    PRINT_DEBUG("  - thread priority policy: %s\n", thread_priority_policy.c_str());
+    PRINT_DEBUG("  - deterministic parallelism: %d\n", deterministic_parallelism);
     PRINT_DEBUG("  - use multi-threading pubs: %d\n", use_multi_threading_pubs);
     PRINT_DEBUG("  - use multi-threading subs: %d\n", use_multi_threading_subs);
     PRINT_DEBUG("  - num_pts: %d\n", num_pts);
@@ -497,8 +754,14 @@ struct VioManagerOptions {
     PRINT_DEBUG("  - grid X by Y: %d by %d\n", grid_x, grid_y);
     PRINT_DEBUG("  - min px dist: %d\n", min_px_dist);
     PRINT_DEBUG("  - hist method: %d\n", (int)histogram_method);
+    PRINT_DEBUG("  - use undistort lut: %d\n", use_undistort_lut);
     PRINT_DEBUG("  - knn ratio: %.3f\n", knn_ratio);
     PRINT_DEBUG("  - track frequency: %.1f\n", track_frequency);
+    PRINT_DEBUG("  - update decimation: %d\n", update_decimation);
+    PRINT_DEBUG("  - use adaptive budget: %d\n", use_adaptive_budget);
+    PRINT_DEBUG("  - adaptive budget latency: %.3f\n", adaptive_budget_latency);
+    PRINT_DEBUG("  - use perf governor: %d\n", use_perf_governor);
+    PRINT_DEBUG("  - perf governor latency: %.3f\n", perf_governor_latency);
     featinit_options.print(parser);
   }
 
@@ -542,6 +805,10 @@ struct VioManagerOptions {
   /// Range in height of points to generate, if ground features are being used
   double sim_ground_plane_features_range = 2.0;
 
+  /// If non-empty, binary file we cache the noiseless measurements in (feature map and raw projections).
+  /// Repeated runs that only change the measurement noise seed can then skip the generation and projection passes.
+  std::string sim_precache_path = "";
+
   /**
    * @brief This function will load print out all simulated parameters.
    * This allows for visual checking that everything was loaded properly from ROS/CMD parsers.
@@ -562,6 +829,7 @@ struct VioManagerOptions {
       parser->parse_config("sim_max_feature_gen_dist", sim_max_feature_gen_distance);
       parser->parse_config("sim_use_ground_plane_features", sim_use_ground_plane_features);
       parser->parse_config("sim_ground_plane_features_range", sim_ground_plane_features_range);
+      parser->parse_config("sim_precache_path", sim_precache_path, false);
     }
     PRINT_DEBUG("SIMULATION PARAMETERS:\n");
     PRINT_WARNING(BOLDRED "  - state init seed: %d \n" RESET, sim_seed_state_init);
@@ -576,6 +844,7 @@ struct VioManagerOptions {
     PRINT_DEBUG("  - min feat dist: %.2f\n", sim_min_feature_gen_distance);
     PRINT_DEBUG("  - max feat dist: %.2f\n", sim_max_feature_gen_distance);
     PRINT_DEBUG("  - ground feat range: %.2f\n", sim_ground_plane_features_range);
+    PRINT_DEBUG("  - precache path: %s\n", sim_precache_path.c_str());
   }
 };
 
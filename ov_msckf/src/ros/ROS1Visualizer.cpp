@@ -21,6 +21,9 @@
 
 #include "ROS1Visualizer.h"
 
+#include <chrono>
+
+#include "core/FixedLagSmoother.h"
 #include "core/VioManager.h"
 #include "ros/ROSVisualizerHelper.h"
 #include "sim/Simulator.h"
@@ -30,13 +33,15 @@
 #include "utils/dataset_reader.h"
 #include "utils/print.h"
 #include "utils/sensor_data.h"
+#include "utils/thread_registry.h"
+#include "utils/tracer.h"
 
 using namespace ov_core;
 using namespace ov_type;
 using namespace ov_msckf;
 
 ROS1Visualizer::ROS1Visualizer(std::shared_ptr<ros::NodeHandle> nh, std::shared_ptr<VioManager> app, std::shared_ptr<Simulator> sim)
-    : _nh(nh), _app(app), _sim(sim), thread_update_running(false) {
+    : _nh(nh), _app(app), _sim(sim) {
 
   // Setup our transform broadcaster
   mTfBr = std::make_shared<tf::TransformBroadcaster>();
@@ -55,6 +60,10 @@ ROS1Visualizer::ROS1Visualizer(std::shared_ptr<ros::NodeHandle> nh, std::shared_
   PRINT_DEBUG("Publishing: %s\n", pub_odomimu.getTopic().c_str());
   pub_pathimu = nh->advertise<nav_msgs::Path>("pathimu", 2);
   PRINT_DEBUG("Publishing: %s\n", pub_pathimu.getTopic().c_str());
+  pub_pathsmooth = nh->advertise<nav_msgs::Path>("pathsmooth", 2);
+  PRINT_DEBUG("Publishing: %s\n", pub_pathsmooth.getTopic().c_str());
+  pub_latency = nh->advertise<std_msgs::Float64MultiArray>("latency", 2);
+  PRINT_DEBUG("Publishing: %s\n", pub_latency.getTopic().c_str());
 
   // 3D points publishing
   pub_points_msckf = nh->advertise<sensor_msgs::PointCloud2>("points_msckf", 2);
@@ -88,6 +97,10 @@ ROS1Visualizer::ROS1Visualizer(std::shared_ptr<ros::NodeHandle> nh, std::shared_
   nh->param<bool>("publish_global_to_imu_tf", publish_global2imu_tf, true);
   nh->param<bool>("publish_calibration_tf", publish_calibration_tf, true);
 
+  // option to treat the imu-rate odometry as a control-critical output (realtime
+  // priority odometry thread, zero-copy publish, decimated TF broadcasts)
+  nh->param<bool>("publish_highrate_odometry", publish_highrate_odometry, false);
+
   // Load groundtruth if we have it and are not doing simulation
   // NOTE: needs to be a csv ASL format file
   if (nh->hasParam("path_gt") && _sim == nullptr) {
@@ -120,36 +133,102 @@ ROS1Visualizer::ROS1Visualizer(std::shared_ptr<ros::NodeHandle> nh, std::shared_
     boost::filesystem::create_directories(boost::filesystem::path(filepath_est.c_str()).parent_path());
     boost::filesystem::create_directories(boost::filesystem::path(filepath_std.c_str()).parent_path());
 
+    // An ".ovb" estimate filepath selects the columnar binary format which skips
+    // the per-frame text formatting here and the text parsing at analysis time
+    save_total_state_binary = ROSVisualizerHelper::save_total_state_is_binary(filepath_est);
+
     // Open the files
-    of_state_est.open(filepath_est.c_str());
-    of_state_std.open(filepath_std.c_str());
-    of_state_est << "# timestamp(s) keyframe_def_q keyframe_def_p imu_q imu_p imu_v bg ba keyframe_imu_q keyframe_imu_p cam_imu_dt num_cam"
-                 << "cam0_k cam0_d cam0_rot cam0_trans ... imu_model dw da tg wtoI atoI etc" << std::endl;
-    of_state_std << "# timestamp(s) keyframe_def_q keyframe_def_p imu_q imu_p imu_v bg ba keyframe_imu_q keyframe_imu_p cam_imu_dt num_cam"
-                 << "cam0_k cam0_d cam0_rot cam0_trans ... imu_model dw da tg wtoI atoI etc" << std::endl;
+    std::ios_base::openmode mode = save_total_state_binary ? (std::ofstream::out | std::ofstream::binary) : std::ofstream::out;
+    of_state_est.open(filepath_est.c_str(), mode);
+    of_state_std.open(filepath_std.c_str(), mode);
+    if (!save_total_state_binary) {
+      of_state_est << "# timestamp(s) keyframe_def_q keyframe_def_p imu_q imu_p imu_v bg ba keyframe_imu_q keyframe_imu_p cam_imu_dt num_cam"
+                   << "cam0_k cam0_d cam0_rot cam0_trans ... imu_model dw da tg wtoI atoI etc" << std::endl;
+      of_state_std << "# timestamp(s) keyframe_def_q keyframe_def_p imu_q imu_p imu_v bg ba keyframe_imu_q keyframe_imu_p cam_imu_dt num_cam"
+                   << "cam0_k cam0_d cam0_rot cam0_trans ... imu_model dw da tg wtoI atoI etc" << std::endl;
+    }
 
     // Groundtruth if we are simulating
     if (_sim != nullptr) {
       if (boost::filesystem::exists(filepath_gt))
         boost::filesystem::remove(filepath_gt);
       boost::filesystem::create_directories(boost::filesystem::path(filepath_gt.c_str()).parent_path());
-      of_state_gt.open(filepath_gt.c_str());
-      of_state_gt << "# timestamp(s) imu_q imu_p imu_v bg ba cam_imu_dt num_cam cam0_k cam0_d cam0_rot cam0_trans ... imu_model dw"
-                  << " da tg wtoI atoI etc" << std::endl;
+      of_state_gt.open(filepath_gt.c_str(), mode);
+      if (!save_total_state_binary) {
+        of_state_gt << "# timestamp(s) imu_q imu_p imu_v bg ba cam_imu_dt num_cam cam0_k cam0_d cam0_rot cam0_trans ... imu_model dw"
+                    << " da tg wtoI atoI etc" << std::endl;
+      }
     }
   }
 
-  // Start thread for the image publishing
+  // Start the background publishing worker
+  // It consumes state snapshots queued by visualize() and also refreshes the
+  // tracking image at 20hz, so all message serialization and the subscriber
+  // handshakes happen off of the filter thread
   if (_app->get_params().use_multi_threading_pubs) {
     std::thread thread([&] {
-      ros::Rate loop_rate(20);
+      ov_core::ThreadRegistry::register_thread("visualization");
       while (ros::ok()) {
+        std::shared_ptr<VizSnapshot> snap = nullptr;
+        {
+          std::unique_lock<std::mutex> lck(viz_queue_mtx);
+          viz_queue_cv.wait_for(lck, std::chrono::milliseconds(50), [&] { return !viz_queue.empty(); });
+          if (!viz_queue.empty()) {
+            snap = viz_queue.front();
+            viz_queue.pop_front();
+          }
+        }
         publish_images();
-        loop_rate.sleep();
+        if (snap != nullptr) {
+          publish_state(*snap);
+          publish_features(*snap);
+          publish_loopclosure_information(*snap);
+        }
       }
     });
     thread.detach();
   }
+
+  // Start the persistent filter worker and the odometry publisher
+  // The sensor callbacks only convert and enqueue, so the ROS executor threads are
+  // never blocked behind an in-progress update: this pair drains the camera queue
+  // and publishes the fast-propagated pose whenever new IMU measurements arrive
+  if (_app->get_params().use_multi_threading_subs) {
+    std::thread thread_filter([&] {
+      while (ros::ok()) {
+        double timestamp_imu = -1;
+        {
+          std::unique_lock<std::mutex> lck(filter_mtx);
+          filter_cv.wait_for(lck, std::chrono::milliseconds(50), [&] { return filter_newest_imu_time > filter_consumed_imu_time; });
+          if (filter_newest_imu_time <= filter_consumed_imu_time)
+            continue;
+          timestamp_imu = filter_newest_imu_time;
+          filter_consumed_imu_time = timestamp_imu;
+        }
+        process_camera_queue(timestamp_imu);
+      }
+    });
+    thread_filter.detach();
+    std::thread thread_odom([&] {
+      ov_core::ThreadRegistry::register_thread("visualization odom");
+      if (publish_highrate_odometry) {
+        ROSVisualizerHelper::try_realtime_priority("visualization odom");
+      }
+      while (ros::ok()) {
+        double timestamp_imu = -1;
+        {
+          std::unique_lock<std::mutex> lck(odom_mtx);
+          odom_cv.wait_for(lck, std::chrono::milliseconds(50), [&] { return odom_newest_imu_time > odom_consumed_imu_time; });
+          if (odom_newest_imu_time <= odom_consumed_imu_time)
+            continue;
+          timestamp_imu = odom_newest_imu_time;
+          odom_consumed_imu_time = timestamp_imu;
+        }
+        visualize_odometry(timestamp_imu);
+      }
+    });
+    thread_odom.detach();
+  }
 }
 
 void ROS1Visualizer::setup_subscribers(std::shared_ptr<ov_core::YamlParser> parser) {
@@ -161,7 +240,24 @@ void ROS1Visualizer::setup_subscribers(std::shared_ptr<ov_core::YamlParser> pars
   std::string topic_imu;
   _nh->param<std::string>("topic_imu", topic_imu, "/imu0");
   parser->parse_external("relative_config_imu", "imu0", "rostopic", topic_imu);
-  sub_imu = _nh->subscribe(topic_imu, 1000, &ROS1Visualizer::callback_inertial, this);
+  if (_app->get_params().use_multi_threading_subs) {
+    // The IMU gets its own callback queue drained by a dedicated ingest thread, so the
+    // image callbacks sharing the global queue can never delay inertial ingest (the
+    // thread also asks for real-time scheduling, which is kept when we have permission)
+    ros::SubscribeOptions ops = ros::SubscribeOptions::create<sensor_msgs::Imu>(
+        topic_imu, 1000, boost::bind(&ROS1Visualizer::callback_inertial, this, _1), ros::VoidConstPtr(), &imu_callback_queue);
+    sub_imu = _nh->subscribe(ops);
+    std::thread thread_imu([&] {
+      ov_core::ThreadRegistry::register_thread("imu ingest");
+      ROSVisualizerHelper::try_realtime_priority("imu ingest");
+      while (ros::ok()) {
+        imu_callback_queue.callAvailable(ros::WallDuration(0.1));
+      }
+    });
+    thread_imu.detach();
+  } else {
+    sub_imu = _nh->subscribe(topic_imu, 1000, &ROS1Visualizer::callback_inertial, this);
+  }
   PRINT_INFO("subscribing to IMU: %s\n", topic_imu.c_str());
 
   // Logic for sync stereo subscriber
@@ -223,21 +319,51 @@ void ROS1Visualizer::visualize() {
     start_time_set = true;
   }
 
-  // publish state
-  publish_state();
+  // Copy everything the publishers need out of the state while we still own it
+  std::shared_ptr<VizSnapshot> snap = capture_snapshot();
 
-  // publish points
-  publish_features();
+  // Hand the snapshot to the background worker, or publish in place if single threaded
+  // The queue is bounded and drops the oldest snapshot so slow subscribers can
+  // never push their latency back into the estimation loop
+  if (_app->get_params().use_multi_threading_pubs) {
+    {
+      std::lock_guard<std::mutex> lck(viz_queue_mtx);
+      if (viz_queue.size() >= 2)
+        viz_queue.pop_front();
+      viz_queue.push_back(snap);
+    }
+    viz_queue_cv.notify_one();
+  } else {
+    publish_state(*snap);
+    publish_features(*snap);
+    publish_loopclosure_information(*snap);
+  }
 
-  // Publish gt if we have it
+  // Publish gt if we have it (this also accumulates our error statistics)
   publish_groundtruth();
 
-  // Publish keyframe information
-  publish_loopclosure_information();
-
   // Save total state
   if (save_total_state) {
-    ROSVisualizerHelper::sim_save_total_state_to_file(_app->get_state(), _sim, of_state_est, of_state_std, of_state_gt);
+    if (save_total_state_binary) {
+      ROSVisualizerHelper::sim_save_total_state_to_binary(_app->get_state(), _sim, of_state_est, of_state_std, of_state_gt,
+                                                          _app->get_timing_spans());
+    } else {
+      ROSVisualizerHelper::sim_save_total_state_to_file(_app->get_state(), _sim, of_state_est, of_state_std, of_state_gt);
+    }
+  }
+
+  // Publish the per-frame latency budget: where the time between the driver handing
+  // us the image and the state going out actually went. The breakdown is
+  // [queue_wait, tracking, update, publish, total] in seconds, all measured against
+  // the receive stamp the frame was tagged with (see ov_core::CameraData). With
+  // multi-threaded publishing the "publish" entry covers the snapshot handoff, since
+  // that is the point the state becomes available to consumers.
+  if (pub_latency.getNumSubscribers() != 0 && _app->get_frame_received() != 0) {
+    Eigen::Matrix<double, 4, 1> latency = _app->get_latency_spans();
+    double total = ov_core::Tracer::to_seconds(ov_core::Tracer::now() - _app->get_frame_received());
+    std_msgs::Float64MultiArray arr_latency;
+    arr_latency.data = {latency(0), latency(1), latency(2), std::max(0.0, total - latency(3)), total};
+    pub_latency.publish(arr_latency);
   }
 
   // Print how much time it took to publish / displaying things
@@ -287,29 +413,31 @@ void ROS1Visualizer::visualize_odometry(double timestamp) {
   //  }
 
   // Publish our odometry message if requested
+  // NOTE: we publish a shared_ptr so intra-process (nodelet) subscribers can take
+  // NOTE: the message without a serialization or copy
   if (pub_odomimu.getNumSubscribers() != 0) {
 
-    nav_msgs::Odometry odomIinM;
-    odomIinM.header.stamp = ros::Time(timestamp);
-    odomIinM.header.frame_id = "global";
+    nav_msgs::OdometryPtr odomIinM = boost::make_shared<nav_msgs::Odometry>();
+    odomIinM->header.stamp = ros::Time(timestamp);
+    odomIinM->header.frame_id = "global";
 
     // The POSE component (orientation and position)
-    odomIinM.pose.pose.orientation.x = state_plus(0);
-    odomIinM.pose.pose.orientation.y = state_plus(1);
-    odomIinM.pose.pose.orientation.z = state_plus(2);
-    odomIinM.pose.pose.orientation.w = state_plus(3);
-    odomIinM.pose.pose.position.x = state_plus(4);
-    odomIinM.pose.pose.position.y = state_plus(5);
-    odomIinM.pose.pose.position.z = state_plus(6);
+    odomIinM->pose.pose.orientation.x = state_plus(0);
+    odomIinM->pose.pose.orientation.y = state_plus(1);
+    odomIinM->pose.pose.orientation.z = state_plus(2);
+    odomIinM->pose.pose.orientation.w = state_plus(3);
+    odomIinM->pose.pose.position.x = state_plus(4);
+    odomIinM->pose.pose.position.y = state_plus(5);
+    odomIinM->pose.pose.position.z = state_plus(6);
 
     // The TWIST component (angular and linear velocities)
-    odomIinM.child_frame_id = "imu";
-    odomIinM.twist.twist.linear.x = state_plus(7);   // vel in local frame
-    odomIinM.twist.twist.linear.y = state_plus(8);   // vel in local frame
-    odomIinM.twist.twist.linear.z = state_plus(9);   // vel in local frame
-    odomIinM.twist.twist.angular.x = state_plus(10); // we do not estimate this...
-    odomIinM.twist.twist.angular.y = state_plus(11); // we do not estimate this...
-    odomIinM.twist.twist.angular.z = state_plus(12); // we do not estimate this...
+    odomIinM->child_frame_id = "imu";
+    odomIinM->twist.twist.linear.x = state_plus(7);   // vel in local frame
+    odomIinM->twist.twist.linear.y = state_plus(8);   // vel in local frame
+    odomIinM->twist.twist.linear.z = state_plus(9);   // vel in local frame
+    odomIinM->twist.twist.angular.x = state_plus(10); // we do not estimate this...
+    odomIinM->twist.twist.angular.y = state_plus(11); // we do not estimate this...
+    odomIinM->twist.twist.angular.z = state_plus(12); // we do not estimate this...
 
     // Finally set the covariance in the message (in the order position then orientation as per ros convention)
     Eigen::Matrix<double, 12, 12> Phi = Eigen::Matrix<double, 12, 12>::Zero();
@@ -319,17 +447,26 @@ void ROS1Visualizer::visualize_odometry(double timestamp) {
     cov_plus = Phi * cov_plus * Phi.transpose();
     for (int r = 0; r < 6; r++) {
       for (int c = 0; c < 6; c++) {
-        odomIinM.pose.covariance[6 * r + c] = cov_plus(r, c);
+        odomIinM->pose.covariance[6 * r + c] = cov_plus(r, c);
       }
     }
     for (int r = 0; r < 6; r++) {
       for (int c = 0; c < 6; c++) {
-        odomIinM.twist.covariance[6 * r + c] = cov_plus(r + 6, c + 6);
+        odomIinM->twist.covariance[6 * r + c] = cov_plus(r + 6, c + 6);
       }
     }
     pub_odomimu.publish(odomIinM);
   }
 
+  // In high-rate mode the odometry topic is the control-critical output, so we keep the
+  // per-message work to just the propagate and publish above and decimate the TF tree
+  // broadcasts (they are for visualization and do not need to be at imu rate)
+  if (publish_highrate_odometry) {
+    if (timestamp - last_time_tf_publish < 0.05)
+      return;
+    last_time_tf_publish = timestamp;
+  }
+
   // Publish our transform on TF
   // NOTE: since we use JPL we have an implicit conversion to Hamilton when we publish
   // NOTE: a rotation from GtoI in JPL has the same xyzw as a ItoG Hamilton rotation
@@ -447,55 +584,67 @@ void ROS1Visualizer::callback_inertial(const sensor_msgs::Imu::ConstPtr &msg) {
   message.wm << msg->angular_velocity.x, msg->angular_velocity.y, msg->angular_velocity.z;
   message.am << msg->linear_acceleration.x, msg->linear_acceleration.y, msg->linear_acceleration.z;
 
-  // send it to our VIO system
+  // send it to our VIO system (this is a lock-free enqueue into the propagator)
   _app->feed_measurement_imu(message);
-  visualize_odometry(message.timestamp);
 
-  // If the processing queue is currently active / running just return so we can keep getting measurements
-  // Otherwise create a second thread to do our update in an async manor
-  // The visualization of the state, images, and features will be synchronous with the update!
-  if (thread_update_running)
+  // If we are single threaded, then run everything inline right here
+  if (!_app->get_params().use_multi_threading_subs) {
+    visualize_odometry(message.timestamp);
+    process_camera_queue(message.timestamp);
     return;
-  thread_update_running = true;
-  std::thread thread([&] {
-    // Lock on the queue (prevents new images from appending)
-    std::lock_guard<std::mutex> lck(camera_queue_mtx);
-
-    // Count how many unique image streams
-    std::map<int, bool> unique_cam_ids;
-    for (const auto &cam_msg : camera_queue) {
-      unique_cam_ids[cam_msg.sensor_ids.at(0)] = true;
-    }
+  }
+
+  // Otherwise we just wake the persistent workers and return, so this callback
+  // never blocks its executor and inertial ingest always stays on time
+  {
+    std::lock_guard<std::mutex> lck(filter_mtx);
+    filter_newest_imu_time = message.timestamp;
+  }
+  filter_cv.notify_one();
+  {
+    std::lock_guard<std::mutex> lck(odom_mtx);
+    odom_newest_imu_time = message.timestamp;
+  }
+  odom_cv.notify_one();
+}
+
+void ROS1Visualizer::process_camera_queue(double timestamp_imu) {
 
-    // If we do not have enough unique cameras then we need to wait
-    // We should wait till we have one of each camera to ensure we propagate in the correct order
-    auto params = _app->get_params();
-    size_t num_unique_cameras = (params.state_options.num_cameras == 2) ? 1 : params.state_options.num_cameras;
-    if (unique_cam_ids.size() == num_unique_cameras) {
-
-      // Loop through our queue and see if we are able to process any of our camera measurements
-      // We are able to process if we have at least one IMU measurement greater than the camera time
-      double timestamp_imu_inC = message.timestamp - _app->get_state()->_calib_dt_CAMtoIMU->value()(0);
-      while (!camera_queue.empty() && camera_queue.at(0).timestamp < timestamp_imu_inC) {
-        auto rT0_1 = boost::posix_time::microsec_clock::local_time();
-        double update_dt = 100.0 * (timestamp_imu_inC - camera_queue.at(0).timestamp);
-        _app->feed_measurement_camera(camera_queue.at(0));
-        visualize();
-        camera_queue.pop_front();
-        auto rT0_2 = boost::posix_time::microsec_clock::local_time();
-        double time_total = (rT0_2 - rT0_1).total_microseconds() * 1e-6;
-        PRINT_INFO(BLUE "[TIME]: %.4f seconds total (%.1f hz, %.2f ms behind)\n" RESET, time_total, 1.0 / time_total, update_dt);
+  // If we do not have enough unique cameras then we need to wait
+  // We should wait till we have one of each camera to ensure we propagate in the correct order
+  auto params = _app->get_params();
+  size_t num_unique_cameras = (params.state_options.num_cameras == 2) ? 1 : params.state_options.num_cameras;
+
+  // We are able to process if we have at least one IMU measurement greater than the camera time
+  double timestamp_imu_inC = _app->get_state()->cam_time(timestamp_imu);
+
+  // Loop through our queue and process all the camera measurements that are ready
+  // Note we only hold the queue lock while inspecting and popping it, never during
+  // the update itself, so the camera callbacks can keep depositing frames meanwhile
+  while (true) {
+    ov_core::CameraData camera_data;
+    {
+      std::lock_guard<std::mutex> lck(camera_queue_mtx);
+
+      // Count how many unique image streams
+      std::map<int, bool> unique_cam_ids;
+      for (const auto &cam_msg : camera_queue) {
+        unique_cam_ids[cam_msg.sensor_ids.at(0)] = true;
       }
+      if (unique_cam_ids.size() != num_unique_cameras)
+        return;
+      if (camera_queue.empty() || camera_queue.at(0).timestamp >= timestamp_imu_inC)
+        return;
+      camera_data = camera_queue.front();
+      camera_queue.pop_front();
     }
-    thread_update_running = false;
-  });
-
-  // If we are single threaded, then run single threaded
-  // Otherwise detach this thread so it runs in the background!
-  if (!_app->get_params().use_multi_threading_subs) {
-    thread.join();
-  } else {
-    thread.detach();
+    auto rT0_1 = boost::posix_time::microsec_clock::local_time();
+    double update_dt = 100.0 * (timestamp_imu_inC - camera_data.timestamp);
+    _app->feed_measurement_camera(camera_data);
+    visualize();
+    auto rT0_2 = boost::posix_time::microsec_clock::local_time();
+    double time_total = (rT0_2 - rT0_1).total_microseconds() * 1e-6;
+    PRINT_INFO(BLUE "[TIME]: %.4f seconds total (%.1f hz, %.2f ms behind)\n" RESET, time_total, 1.0 / time_total, update_dt);
   }
 }
 
@@ -519,19 +668,28 @@ void ROS1Visualizer::callback_monocular(const sensor_msgs::ImageConstPtr &msg0,
   }
 
   // Create the measurement
+  // The image is copied into a pooled slab so we skip the per-frame allocation of clone()
   ov_core::CameraData message;
   message.timestamp = cv_ptr->header.stamp.toSec();
   message.sensor_ids.push_back(cam_id0);
-  message.images.push_back(cv_ptr->image.clone());
+  cv::Mat img_buffer = camera_image_pool.checkout(cv_ptr->image.rows, cv_ptr->image.cols, cv_ptr->image.type());
+  cv_ptr->image.copyTo(img_buffer);
+  message.images.push_back(img_buffer);
 
-  // Load the mask if we are using it, else it is empty
+  // Load the mask if we are using it, else it is an all-zero mask we cache per camera
   // TODO: in the future we should get this from external pixel segmentation
   if (_app->get_params().use_mask) {
     message.masks.push_back(_app->get_params().masks.at(cam_id0));
   } else {
-    message.masks.push_back(cv::Mat::zeros(cv_ptr->image.rows, cv_ptr->image.cols, CV_8UC1));
+    cv::Mat &mask = camera_empty_masks[cam_id0];
+    if (mask.rows != cv_ptr->image.rows || mask.cols != cv_ptr->image.cols)
+      mask = cv::Mat::zeros(cv_ptr->image.rows, cv_ptr->image.cols, CV_8UC1);
+    message.masks.push_back(mask);
   }
 
+  // Kick off pyramid pre-computation so it overlaps with the current filter update
+  _app->precompute_camera_pyramids(message);
+
   // append it to our queue of images
   std::lock_guard<std::mutex> lck(camera_queue_mtx);
   camera_queue.push_back(message);
@@ -568,61 +726,136 @@ void ROS1Visualizer::callback_stereo(const sensor_msgs::ImageConstPtr &msg0, con
   }
 
   // Create the measurement
+  // The images are copied into pooled slabs so we skip the per-frame allocations of clone()
   ov_core::CameraData message;
   message.timestamp = cv_ptr0->header.stamp.toSec();
   message.sensor_ids.push_back(cam_id0);
   message.sensor_ids.push_back(cam_id1);
-  message.images.push_back(cv_ptr0->image.clone());
-  message.images.push_back(cv_ptr1->image.clone());
-
-  // Load the mask if we are using it, else it is empty
+  cv::Mat img_buffer0 = camera_image_pool.checkout(cv_ptr0->image.rows, cv_ptr0->image.cols, cv_ptr0->image.type());
+  cv::Mat img_buffer1 = camera_image_pool.checkout(cv_ptr1->image.rows, cv_ptr1->image.cols, cv_ptr1->image.type());
+  cv_ptr0->image.copyTo(img_buffer0);
+  cv_ptr1->image.copyTo(img_buffer1);
+  message.images.push_back(img_buffer0);
+  message.images.push_back(img_buffer1);
+
+  // Load the mask if we are using it, else it is an all-zero mask we cache per camera
   // TODO: in the future we should get this from external pixel segmentation
   if (_app->get_params().use_mask) {
     message.masks.push_back(_app->get_params().masks.at(cam_id0));
     message.masks.push_back(_app->get_params().masks.at(cam_id1));
   } else {
     // message.masks.push_back(cv::Mat(cv_ptr0->image.rows, cv_ptr0->image.cols, CV_8UC1, cv::Scalar(255)));
-    message.masks.push_back(cv::Mat::zeros(cv_ptr0->image.rows, cv_ptr0->image.cols, CV_8UC1));
-    message.masks.push_back(cv::Mat::zeros(cv_ptr1->image.rows, cv_ptr1->image.cols, CV_8UC1));
+    cv::Mat &mask0 = camera_empty_masks[cam_id0];
+    if (mask0.rows != cv_ptr0->image.rows || mask0.cols != cv_ptr0->image.cols)
+      mask0 = cv::Mat::zeros(cv_ptr0->image.rows, cv_ptr0->image.cols, CV_8UC1);
+    cv::Mat &mask1 = camera_empty_masks[cam_id1];
+    if (mask1.rows != cv_ptr1->image.rows || mask1.cols != cv_ptr1->image.cols)
+      mask1 = cv::Mat::zeros(cv_ptr1->image.rows, cv_ptr1->image.cols, CV_8UC1);
+    message.masks.push_back(mask0);
+    message.masks.push_back(mask1);
   }
 
+  // Kick off pyramid pre-computation so it overlaps with the current filter update
+  _app->precompute_camera_pyramids(message);
+
   // append it to our queue of images
   std::lock_guard<std::mutex> lck(camera_queue_mtx);
   camera_queue.push_back(message);
   std::sort(camera_queue.begin(), camera_queue.end());
 }
 
-void ROS1Visualizer::publish_state() {
+std::shared_ptr<ROS1Visualizer::VizSnapshot> ROS1Visualizer::capture_snapshot() {
 
   // Get the current state
+  auto snap = std::shared_ptr<VizSnapshot>(new VizSnapshot());
   std::shared_ptr<State> state = _app->get_state();
 
   // We want to publish in the IMU clock frame
   // The timestamp in the state will be the last camera time
-  double t_ItoC = state->_calib_dt_CAMtoIMU->value()(0);
-  double timestamp_inI = state->_timestamp + t_ItoC;
+  snap->timestamp = state->_timestamp;
+  snap->timestamp_inI = state->imu_time(state->_timestamp);
+
+  // Current IMU pose and its marginal covariance
+  snap->imu_q = state->_imu->quat();
+  snap->imu_p = state->_imu->pos();
+  std::vector<std::shared_ptr<Type>> statevars;
+  statevars.push_back(state->_imu->pose()->p());
+  statevars.push_back(state->_imu->pose()->q());
+  snap->cov_posori = StateHelper::get_marginal_covariance(state, statevars);
+
+  // Keyframe-relative IMU pose and its marginal covariance
+  snap->kf_imu_q = state->_imu->keyframe_quat();
+  snap->kf_imu_p = state->_imu->keyframe_pos();
+  std::vector<std::shared_ptr<Type>> statevars_keyframe;
+  statevars_keyframe.push_back(state->_imu->keyframe_pose()->p());
+  statevars_keyframe.push_back(state->_imu->keyframe_pose()->q());
+  snap->cov_keyframe = StateHelper::get_marginal_covariance(state, statevars_keyframe);
+
+  // Keyframe definition pose
+  snap->kf_def_q = state->_keyframe_def->quat();
+  snap->kf_def_p = state->_keyframe_def->pos();
+
+  // Feature clouds, only assembled for the topics somebody actually listens to
+  // (gathering the SLAM/ARUCO landmarks and copying the sim map are not free)
+  if (pub_points_msckf.getNumSubscribers() != 0)
+    snap->feats_msckf = _app->get_good_features_MSCKF();
+  if (pub_points_slam.getNumSubscribers() != 0)
+    snap->feats_slam = _app->get_features_SLAM();
+  if (pub_points_aruco.getNumSubscribers() != 0)
+    snap->feats_aruco = _app->get_features_ARUCO();
+  if (_sim != nullptr && pub_points_sim.getNumSubscribers() != 0) {
+    snap->feats_sim = _sim->get_map_vec();
+    snap->have_sim_map = true;
+  }
 
-  // Create pose of IMU (note we use the bag time)
+  // Active track information for the loop-closure publishers
+  // Only valid if the track and image times agree and we still have that clone
+  double active_tracks_time1 = -1;
+  double active_tracks_time2 = -1;
+  std::unordered_map<size_t, Eigen::Vector3d> active_tracks_posinG;
+  std::unordered_map<size_t, Eigen::Vector3d> active_tracks_uvd;
+  cv::Mat active_cam0_image;
+  _app->get_active_tracks(active_tracks_time1, active_tracks_posinG, active_tracks_uvd);
+  _app->get_active_image(active_tracks_time2, active_cam0_image);
+  if (active_tracks_time1 != -1 && active_tracks_time1 == active_tracks_time2 &&
+      state->_clones_IMU.find(active_tracks_time1) != state->_clones_IMU.end()) {
+    snap->have_loopclosure = true;
+    snap->active_tracks_time = active_tracks_time1;
+    snap->active_tracks_posinG = active_tracks_posinG;
+    snap->active_tracks_uvd = active_tracks_uvd;
+    // The depth visualization draws into this image, so take our own copy
+    if (it_pub_loop_img_depth.getNumSubscribers() != 0 || it_pub_loop_img_depth_color.getNumSubscribers() != 0) {
+      snap->active_cam0_image = active_cam0_image.clone();
+    }
+    snap->clone_q = state->_clones_IMU.at(active_tracks_time1)->quat();
+    snap->clone_p = state->_clones_IMU.at(active_tracks_time1)->pos();
+    snap->q_ItoC = state->_calib_IMUtoCAM.at(0)->quat();
+    snap->p_CinI = -state->_calib_IMUtoCAM.at(0)->Rot().transpose() * state->_calib_IMUtoCAM.at(0)->pos();
+    snap->cam0_intrinsics = state->_cam_intrinsics.at(0)->value();
+    snap->cam0_is_fisheye = (std::dynamic_pointer_cast<ov_core::CamEqui>(_app->get_params().camera_intrinsics.at(0)) != nullptr);
+  }
+  return snap;
+}
+
+void ROS1Visualizer::publish_state(const VizSnapshot &snap) {
+
+  // Create pose of IMU (note we use the bag time in the IMU clock frame)
   geometry_msgs::PoseWithCovarianceStamped poseIinM;
-  poseIinM.header.stamp = ros::Time(timestamp_inI);
+  poseIinM.header.stamp = ros::Time(snap.timestamp_inI);
   poseIinM.header.seq = poses_seq_imu;
   poseIinM.header.frame_id = "global";
-  poseIinM.pose.pose.orientation.x = state->_imu->quat()(0);
-  poseIinM.pose.pose.orientation.y = state->_imu->quat()(1);
-  poseIinM.pose.pose.orientation.z = state->_imu->quat()(2);
-  poseIinM.pose.pose.orientation.w = state->_imu->quat()(3);
-  poseIinM.pose.pose.position.x = state->_imu->pos()(0);
-  poseIinM.pose.pose.position.y = state->_imu->pos()(1);
-  poseIinM.pose.pose.position.z = state->_imu->pos()(2);
+  poseIinM.pose.pose.orientation.x = snap.imu_q(0);
+  poseIinM.pose.pose.orientation.y = snap.imu_q(1);
+  poseIinM.pose.pose.orientation.z = snap.imu_q(2);
+  poseIinM.pose.pose.orientation.w = snap.imu_q(3);
+  poseIinM.pose.pose.position.x = snap.imu_p(0);
+  poseIinM.pose.pose.position.y = snap.imu_p(1);
+  poseIinM.pose.pose.position.z = snap.imu_p(2);
 
   // Finally set the covariance in the message (in the order position then orientation as per ros convention)
-  std::vector<std::shared_ptr<Type>> statevars;
-  statevars.push_back(state->_imu->pose()->p());
-  statevars.push_back(state->_imu->pose()->q());
-  Eigen::Matrix<double, 6, 6> covariance_posori = StateHelper::get_marginal_covariance(_app->get_state(), statevars);
   for (int r = 0; r < 6; r++) {
     for (int c = 0; c < 6; c++) {
-      poseIinM.pose.covariance[6 * r + c] = covariance_posori(r, c);
+      poseIinM.pose.covariance[6 * r + c] = snap.cov_posori(r, c);
     }
   }
   pub_poseimu.publish(poseIinM);
@@ -630,23 +863,53 @@ void ROS1Visualizer::publish_state() {
   //=========================================================
   //=========================================================
 
-  // Append to our pose vector
+  // Append to our pose vector (constant memory, older history is progressively decimated)
   geometry_msgs::PoseStamped posetemp;
   posetemp.header = poseIinM.header;
   posetemp.pose = poseIinM.pose.pose;
-  poses_imu.push_back(posetemp);
+  ROSVisualizerHelper::append_to_path_history(poses_imu, stride_path_imu, count_path_imu, posetemp, max_path_length);
 
   // Create our path (imu)
+  // Only assemble the message if somebody listens since it copies the whole history
   // NOTE: We downsample the number of poses as needed to prevent rviz crashes
   // NOTE: https://github.com/ros-visualization/rviz/issues/1107
-  nav_msgs::Path arrIMU;
-  arrIMU.header.stamp = ros::Time::now();
-  arrIMU.header.seq = poses_seq_imu;
-  arrIMU.header.frame_id = "global";
-  for (size_t i = 0; i < poses_imu.size(); i += std::floor((double)poses_imu.size() / 16384.0) + 1) {
-    arrIMU.poses.push_back(poses_imu.at(i));
+  if (pub_pathimu.getNumSubscribers() != 0) {
+    nav_msgs::Path arrIMU;
+    arrIMU.header.stamp = ros::Time::now();
+    arrIMU.header.seq = poses_seq_imu;
+    arrIMU.header.frame_id = "global";
+    for (size_t i = 0; i < poses_imu.size(); i += std::floor((double)poses_imu.size() / 16384.0) + 1) {
+      arrIMU.poses.push_back(poses_imu.at(i));
+    }
+    pub_pathimu.publish(arrIMU);
+  }
+
+  // Append any newly finalized fixed-lag smoother poses and publish the refined path
+  if (_app->get_smoother() != nullptr) {
+    for (const auto &posepair : _app->get_smoother()->pop_smoothed_poses()) {
+      geometry_msgs::PoseStamped posesmooth;
+      posesmooth.header.stamp = ros::Time(posepair.first);
+      posesmooth.header.frame_id = "global";
+      posesmooth.pose.orientation.x = posepair.second(0);
+      posesmooth.pose.orientation.y = posepair.second(1);
+      posesmooth.pose.orientation.z = posepair.second(2);
+      posesmooth.pose.orientation.w = posepair.second(3);
+      posesmooth.pose.position.x = posepair.second(4);
+      posesmooth.pose.position.y = posepair.second(5);
+      posesmooth.pose.position.z = posepair.second(6);
+      ROSVisualizerHelper::append_to_path_history(poses_smoothed, stride_path_smooth, count_path_smooth, posesmooth, max_path_length);
+    }
+    if (pub_pathsmooth.getNumSubscribers() != 0 && !poses_smoothed.empty()) {
+      nav_msgs::Path arrSMOOTH;
+      arrSMOOTH.header.stamp = ros::Time::now();
+      arrSMOOTH.header.seq = poses_seq_imu;
+      arrSMOOTH.header.frame_id = "global";
+      for (size_t i = 0; i < poses_smoothed.size(); i += std::floor((double)poses_smoothed.size() / 16384.0) + 1) {
+        arrSMOOTH.poses.push_back(poses_smoothed.at(i));
+      }
+      pub_pathsmooth.publish(arrSMOOTH);
+    }
   }
-  pub_pathimu.publish(arrIMU);
 
   //=========================================================
   //=========================================================
@@ -656,22 +919,18 @@ void ROS1Visualizer::publish_state() {
   poseImuKeyframe.header = poseIinM.header;
   poseImuKeyframe.header.seq = poses_seq_imu;
   poseImuKeyframe.header.frame_id = "local";
-  poseImuKeyframe.pose.pose.orientation.x = state->_imu->keyframe_quat()(0);
-  poseImuKeyframe.pose.pose.orientation.y = state->_imu->keyframe_quat()(1);
-  poseImuKeyframe.pose.pose.orientation.z = state->_imu->keyframe_quat()(2);
-  poseImuKeyframe.pose.pose.orientation.w = state->_imu->keyframe_quat()(3);
-  poseImuKeyframe.pose.pose.position.x = state->_imu->keyframe_pos()(0);
-  poseImuKeyframe.pose.pose.position.y = state->_imu->keyframe_pos()(1);
-  poseImuKeyframe.pose.pose.position.z = state->_imu->keyframe_pos()(2);
+  poseImuKeyframe.pose.pose.orientation.x = snap.kf_imu_q(0);
+  poseImuKeyframe.pose.pose.orientation.y = snap.kf_imu_q(1);
+  poseImuKeyframe.pose.pose.orientation.z = snap.kf_imu_q(2);
+  poseImuKeyframe.pose.pose.orientation.w = snap.kf_imu_q(3);
+  poseImuKeyframe.pose.pose.position.x = snap.kf_imu_p(0);
+  poseImuKeyframe.pose.pose.position.y = snap.kf_imu_p(1);
+  poseImuKeyframe.pose.pose.position.z = snap.kf_imu_p(2);
 
   // Set the covariances
-  std::vector<std::shared_ptr<Type>> statevars_keyframe;
-  statevars_keyframe.push_back(state->_imu->keyframe_pose()->p());
-  statevars_keyframe.push_back(state->_imu->keyframe_pose()->q());
-  Eigen::Matrix<double, 6, 6> covariance_keyframe = StateHelper::get_marginal_covariance(_app->get_state(), statevars_keyframe);
   for (int r = 0; r < 6; r++) {
     for (int c = 0; c < 6; c++) {
-      poseImuKeyframe.pose.covariance[6 * r + c] = covariance_keyframe(r, c);
+      poseImuKeyframe.pose.covariance[6 * r + c] = snap.cov_keyframe(r, c);
     }
   }
   pub_poseimu_keyframe.publish(poseImuKeyframe);
@@ -683,13 +942,13 @@ void ROS1Visualizer::publish_state() {
   geometry_msgs::PoseStamped keyframe;
   keyframe.header = poseImuKeyframe.header;
   keyframe.header.frame_id = "global";
-  keyframe.pose.orientation.x = state->_keyframe_def->quat()(0);
-  keyframe.pose.orientation.y = state->_keyframe_def->quat()(1);
-  keyframe.pose.orientation.z = state->_keyframe_def->quat()(2);
-  keyframe.pose.orientation.w = state->_keyframe_def->quat()(3);
-  keyframe.pose.position.x = state->_keyframe_def->pos()(0);
-  keyframe.pose.position.y = state->_keyframe_def->pos()(1);
-  keyframe.pose.position.z = state->_keyframe_def->pos()(2);
+  keyframe.pose.orientation.x = snap.kf_def_q(0);
+  keyframe.pose.orientation.y = snap.kf_def_q(1);
+  keyframe.pose.orientation.z = snap.kf_def_q(2);
+  keyframe.pose.orientation.w = snap.kf_def_q(3);
+  keyframe.pose.position.x = snap.kf_def_p(0);
+  keyframe.pose.position.y = snap.kf_def_p(1);
+  keyframe.pose.position.z = snap.kf_def_p(2);
 
   // Publish message
   pub_keyframe_def.publish(keyframe);
@@ -726,36 +985,34 @@ void ROS1Visualizer::publish_images() {
   it_pub_tracks.publish(exl_msg);
 }
 
-void ROS1Visualizer::publish_features() {
+void ROS1Visualizer::publish_features(const VizSnapshot &snap) {
 
-  // Check if we have subscribers
-  if (pub_points_msckf.getNumSubscribers() == 0 && pub_points_slam.getNumSubscribers() == 0 && pub_points_aruco.getNumSubscribers() == 0 &&
-      pub_points_sim.getNumSubscribers() == 0)
-    return;
-
-  // Get our good MSCKF features
-  std::vector<Eigen::Vector3d> feats_msckf = _app->get_good_features_MSCKF();
-  sensor_msgs::PointCloud2 cloud = ROSVisualizerHelper::get_ros_pointcloud(feats_msckf);
-  pub_points_msckf.publish(cloud);
+  // Each cloud was only captured in the snapshot if its topic had a subscriber
+  // So here we just serialize and publish whatever was gathered
 
-  // Get our good SLAM features
-  std::vector<Eigen::Vector3d> feats_slam = _app->get_features_SLAM();
-  sensor_msgs::PointCloud2 cloud_SLAM = ROSVisualizerHelper::get_ros_pointcloud(feats_slam);
-  pub_points_slam.publish(cloud_SLAM);
+  // Our good MSCKF features
+  if (pub_points_msckf.getNumSubscribers() != 0) {
+    sensor_msgs::PointCloud2 cloud = ROSVisualizerHelper::get_ros_pointcloud(snap.feats_msckf);
+    pub_points_msckf.publish(cloud);
+  }
 
-  // Get our good ARUCO features
-  std::vector<Eigen::Vector3d> feats_aruco = _app->get_features_ARUCO();
-  sensor_msgs::PointCloud2 cloud_ARUCO = ROSVisualizerHelper::get_ros_pointcloud(feats_aruco);
-  pub_points_aruco.publish(cloud_ARUCO);
+  // Our good SLAM features
+  if (pub_points_slam.getNumSubscribers() != 0) {
+    sensor_msgs::PointCloud2 cloud_SLAM = ROSVisualizerHelper::get_ros_pointcloud(snap.feats_slam);
+    pub_points_slam.publish(cloud_SLAM);
+  }
 
-  // Skip the rest of we are not doing simulation
-  if (_sim == nullptr)
-    return;
+  // Our good ARUCO features
+  if (pub_points_aruco.getNumSubscribers() != 0) {
+    sensor_msgs::PointCloud2 cloud_ARUCO = ROSVisualizerHelper::get_ros_pointcloud(snap.feats_aruco);
+    pub_points_aruco.publish(cloud_ARUCO);
+  }
 
-  // Get our good SIMULATION features
-  std::vector<Eigen::Vector3d> feats_sim = _sim->get_map_vec();
-  sensor_msgs::PointCloud2 cloud_SIM = ROSVisualizerHelper::get_ros_pointcloud(feats_sim);
-  pub_points_sim.publish(cloud_SIM);
+  // Our good SIMULATION features
+  if (snap.have_sim_map && pub_points_sim.getNumSubscribers() != 0) {
+    sensor_msgs::PointCloud2 cloud_SIM = ROSVisualizerHelper::get_ros_pointcloud(snap.feats_sim);
+    pub_points_sim.publish(cloud_SIM);
+  }
 }
 
 void ROS1Visualizer::publish_groundtruth() {
@@ -765,8 +1022,7 @@ void ROS1Visualizer::publish_groundtruth() {
 
   // We want to publish in the IMU clock frame
   // The timestamp in the state will be the last camera time
-  double t_ItoC = _app->get_state()->_calib_dt_CAMtoIMU->value()(0);
-  double timestamp_inI = _app->get_state()->_timestamp + t_ItoC;
+  double timestamp_inI = _app->get_state()->imu_time(_app->get_state()->_timestamp);
 
   // Check that we have the timestamp in our GT file [time(sec),q_GtoI,p_IinG,v_IinG,b_gyro,b_accel]
   if (_sim == nullptr && (gt_states.empty() || !DatasetReader::get_gt_state(timestamp_inI, state_gt, gt_states))) {
@@ -798,20 +1054,23 @@ void ROS1Visualizer::publish_groundtruth() {
   poseIinM.pose.position.z = state_gt(7, 0);
   pub_posegt.publish(poseIinM);
 
-  // Append to our pose vector
-  poses_gt.push_back(poseIinM);
+  // Append to our pose vector (constant memory, older history is progressively decimated)
+  ROSVisualizerHelper::append_to_path_history(poses_gt, stride_path_gt, count_path_gt, poseIinM, max_path_length);
 
   // Create our path (imu)
+  // Only assemble the message if somebody listens since it copies the whole history
   // NOTE: We downsample the number of poses as needed to prevent rviz crashes
   // NOTE: https://github.com/ros-visualization/rviz/issues/1107
-  nav_msgs::Path arrIMU;
-  arrIMU.header.stamp = ros::Time::now();
-  arrIMU.header.seq = poses_seq_gt;
-  arrIMU.header.frame_id = "global";
-  for (size_t i = 0; i < poses_gt.size(); i += std::floor((double)poses_gt.size() / 16384.0) + 1) {
-    arrIMU.poses.push_back(poses_gt.at(i));
+  if (pub_pathgt.getNumSubscribers() != 0) {
+    nav_msgs::Path arrIMU;
+    arrIMU.header.stamp = ros::Time::now();
+    arrIMU.header.seq = poses_seq_gt;
+    arrIMU.header.frame_id = "global";
+    for (size_t i = 0; i < poses_gt.size(); i += std::floor((double)poses_gt.size() / 16384.0) + 1) {
+      arrIMU.poses.push_back(poses_gt.at(i));
+    }
+    pub_pathgt.publish(arrIMU);
   }
-  pub_pathgt.publish(arrIMU);
 
   // Move them forward in time
   poses_seq_gt++;
@@ -887,28 +1146,15 @@ void ROS1Visualizer::publish_groundtruth() {
   //==========================================================================
 }
 
-void ROS1Visualizer::publish_loopclosure_information() {
+void ROS1Visualizer::publish_loopclosure_information(const VizSnapshot &snap) {
 
-  // Get the current tracks in this frame
-  double active_tracks_time1 = -1;
-  double active_tracks_time2 = -1;
-  std::unordered_map<size_t, Eigen::Vector3d> active_tracks_posinG;
-  std::unordered_map<size_t, Eigen::Vector3d> active_tracks_uvd;
-  cv::Mat active_cam0_image;
-  _app->get_active_tracks(active_tracks_time1, active_tracks_posinG, active_tracks_uvd);
-  _app->get_active_image(active_tracks_time2, active_cam0_image);
-  if (active_tracks_time1 == -1)
-    return;
-  if (_app->get_state()->_clones_IMU.find(active_tracks_time1) == _app->get_state()->_clones_IMU.end())
-    return;
-  Eigen::Vector4d quat = _app->get_state()->_clones_IMU.at(active_tracks_time1)->quat();
-  Eigen::Vector3d pos = _app->get_state()->_clones_IMU.at(active_tracks_time1)->pos();
-  if (active_tracks_time1 != active_tracks_time2)
+  // Skip if the snapshot had no consistent set of active tracks
+  if (!snap.have_loopclosure)
     return;
 
   // Default header
   std_msgs::Header header;
-  header.stamp = ros::Time(active_tracks_time1);
+  header.stamp = ros::Time(snap.active_tracks_time);
 
   //======================================================
   // Check if we have subscribers for the pose odometry, camera intrinsics, or extrinsics
@@ -919,38 +1165,35 @@ void ROS1Visualizer::publish_loopclosure_information() {
     nav_msgs::Odometry odometry_pose;
     odometry_pose.header = header;
     odometry_pose.header.frame_id = "global";
-    odometry_pose.pose.pose.position.x = pos(0);
-    odometry_pose.pose.pose.position.y = pos(1);
-    odometry_pose.pose.pose.position.z = pos(2);
-    odometry_pose.pose.pose.orientation.x = quat(0);
-    odometry_pose.pose.pose.orientation.y = quat(1);
-    odometry_pose.pose.pose.orientation.z = quat(2);
-    odometry_pose.pose.pose.orientation.w = quat(3);
+    odometry_pose.pose.pose.position.x = snap.clone_p(0);
+    odometry_pose.pose.pose.position.y = snap.clone_p(1);
+    odometry_pose.pose.pose.position.z = snap.clone_p(2);
+    odometry_pose.pose.pose.orientation.x = snap.clone_q(0);
+    odometry_pose.pose.pose.orientation.y = snap.clone_q(1);
+    odometry_pose.pose.pose.orientation.z = snap.clone_q(2);
+    odometry_pose.pose.pose.orientation.w = snap.clone_q(3);
     pub_loop_pose.publish(odometry_pose);
 
     // PUBLISH IMU TO CAMERA0 EXTRINSIC
-    // need to flip the transform to the IMU frame
-    Eigen::Vector4d q_ItoC = _app->get_state()->_calib_IMUtoCAM.at(0)->quat();
-    Eigen::Vector3d p_CinI = -_app->get_state()->_calib_IMUtoCAM.at(0)->Rot().transpose() * _app->get_state()->_calib_IMUtoCAM.at(0)->pos();
+    // the transform was already flipped to the IMU frame when the snapshot was taken
     nav_msgs::Odometry odometry_calib;
     odometry_calib.header = header;
     odometry_calib.header.frame_id = "imu";
-    odometry_calib.pose.pose.position.x = p_CinI(0);
-    odometry_calib.pose.pose.position.y = p_CinI(1);
-    odometry_calib.pose.pose.position.z = p_CinI(2);
-    odometry_calib.pose.pose.orientation.x = q_ItoC(0);
-    odometry_calib.pose.pose.orientation.y = q_ItoC(1);
-    odometry_calib.pose.pose.orientation.z = q_ItoC(2);
-    odometry_calib.pose.pose.orientation.w = q_ItoC(3);
+    odometry_calib.pose.pose.position.x = snap.p_CinI(0);
+    odometry_calib.pose.pose.position.y = snap.p_CinI(1);
+    odometry_calib.pose.pose.position.z = snap.p_CinI(2);
+    odometry_calib.pose.pose.orientation.x = snap.q_ItoC(0);
+    odometry_calib.pose.pose.orientation.y = snap.q_ItoC(1);
+    odometry_calib.pose.pose.orientation.z = snap.q_ItoC(2);
+    odometry_calib.pose.pose.orientation.w = snap.q_ItoC(3);
     pub_loop_extrinsic.publish(odometry_calib);
 
     // PUBLISH CAMERA0 INTRINSICS
-    bool is_fisheye = (std::dynamic_pointer_cast<ov_core::CamEqui>(_app->get_params().camera_intrinsics.at(0)) != nullptr);
     sensor_msgs::CameraInfo cameraparams;
     cameraparams.header = header;
     cameraparams.header.frame_id = "cam0";
-    cameraparams.distortion_model = is_fisheye ? "equidistant" : "plumb_bob";
-    Eigen::VectorXd cparams = _app->get_state()->_cam_intrinsics.at(0)->value();
+    cameraparams.distortion_model = snap.cam0_is_fisheye ? "equidistant" : "plumb_bob";
+    const Eigen::VectorXd &cparams = snap.cam0_intrinsics;
     cameraparams.D = {cparams(4), cparams(5), cparams(6), cparams(7)};
     cameraparams.K = {cparams(0), 0, cparams(2), 0, cparams(1), cparams(3), 0, 0, 1};
     pub_loop_intrinsics.publish(cameraparams);
@@ -964,15 +1207,15 @@ void ROS1Visualizer::publish_loopclosure_information() {
     sensor_msgs::PointCloud point_cloud;
     point_cloud.header = header;
     point_cloud.header.frame_id = "global";
-    for (const auto &feattimes : active_tracks_posinG) {
+    for (const auto &feattimes : snap.active_tracks_posinG) {
 
       // Get this feature information
       size_t featid = feattimes.first;
       Eigen::Vector3d uvd = Eigen::Vector3d::Zero();
-      if (active_tracks_uvd.find(featid) != active_tracks_uvd.end()) {
-        uvd = active_tracks_uvd.at(featid);
+      if (snap.active_tracks_uvd.find(featid) != snap.active_tracks_uvd.end()) {
+        uvd = snap.active_tracks_uvd.at(featid);
       }
-      Eigen::Vector3d pFinG = active_tracks_posinG.at(featid);
+      Eigen::Vector3d pFinG = snap.active_tracks_posinG.at(featid);
 
       // Push back 3d point
       geometry_msgs::Point32 p;
@@ -997,19 +1240,21 @@ void ROS1Visualizer::publish_loopclosure_information() {
 
   //======================================================
   // Depth images of sparse points and its colorized version
-  if (it_pub_loop_img_depth.getNumSubscribers() != 0 || it_pub_loop_img_depth_color.getNumSubscribers() != 0) {
+  // NOTE: the image was only captured in the snapshot if somebody was subscribed
+  if (!snap.active_cam0_image.empty() &&
+      (it_pub_loop_img_depth.getNumSubscribers() != 0 || it_pub_loop_img_depth_color.getNumSubscribers() != 0)) {
 
     // Create the images we will populate with the depths
-    std::pair<int, int> wh_pair = {active_cam0_image.cols, active_cam0_image.rows};
+    std::pair<int, int> wh_pair = {snap.active_cam0_image.cols, snap.active_cam0_image.rows};
     cv::Mat depthmap = cv::Mat::zeros(wh_pair.second, wh_pair.first, CV_16UC1);
-    cv::Mat depthmap_viz = active_cam0_image;
+    cv::Mat depthmap_viz = snap.active_cam0_image;
 
     // Loop through all points and append
-    for (const auto &feattimes : active_tracks_uvd) {
+    for (const auto &feattimes : snap.active_tracks_uvd) {
 
       // Get this feature information
       size_t featid = feattimes.first;
-      Eigen::Vector3d uvd = active_tracks_uvd.at(featid);
+      Eigen::Vector3d uvd = snap.active_tracks_uvd.at(featid);
 
       // Skip invalid points
       double dw = 4;
@@ -30,6 +30,7 @@
 #include <message_filters/time_synchronizer.h>
 #include <nav_msgs/Odometry.h>
 #include <nav_msgs/Path.h>
+#include <ros/callback_queue.h>
 #include <ros/ros.h>
 #include <sensor_msgs/CameraInfo.h>
 #include <sensor_msgs/Image.h>
@@ -39,21 +40,27 @@
 #include <sensor_msgs/PointCloud2.h>
 #include <sensor_msgs/point_cloud2_iterator.h>
 #include <std_msgs/Float64.h>
+#include <std_msgs/Float64MultiArray.h>
 #include <tf/transform_broadcaster.h>
 
 #include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <fstream>
 #include <memory>
 #include <mutex>
+#include <unordered_map>
 
 #include <Eigen/Eigen>
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/filesystem.hpp>
+#include <boost/make_shared.hpp>
 #include <cv_bridge/cv_bridge.h>
 
+#include "utils/sensor_data.h"
+
 namespace ov_core {
 class YamlParser;
-struct CameraData;
 } // namespace ov_core
 
 namespace ov_msckf {
@@ -115,20 +122,83 @@ public:
   void callback_stereo(const sensor_msgs::ImageConstPtr &msg0, const sensor_msgs::ImageConstPtr &msg1, int cam_id0, int cam_id1);
 
 protected:
+  /**
+   * @brief Copy of everything the background publisher reads from the estimator.
+   *
+   * The filter thread fills one of these while it still owns the state, so the
+   * actual message construction and publishing can happen on the worker thread
+   * without ever touching @ref VioManager again. This is what guarantees that a
+   * slow rviz subscriber can never push latency back into the estimation loop.
+   */
+  struct VizSnapshot {
+
+    /// State (last camera) time and the same time in the IMU clock frame
+    double timestamp = -1;
+    double timestamp_inI = -1;
+
+    /// Current IMU pose and its marginal covariance (position then orientation)
+    Eigen::Vector4d imu_q;
+    Eigen::Vector3d imu_p;
+    Eigen::Matrix<double, 6, 6> cov_posori;
+
+    /// Keyframe-relative IMU pose and its marginal covariance
+    Eigen::Vector4d kf_imu_q;
+    Eigen::Vector3d kf_imu_p;
+    Eigen::Matrix<double, 6, 6> cov_keyframe;
+
+    /// Keyframe definition pose
+    Eigen::Vector4d kf_def_q;
+    Eigen::Vector3d kf_def_p;
+
+    /// Feature clouds (MSCKF, SLAM, ARUCO, and the simulated map if subscribed)
+    std::vector<Eigen::Vector3d> feats_msckf, feats_slam, feats_aruco, feats_sim;
+    bool have_sim_map = false;
+
+    /// Active track information for the loop-closure publishers
+    bool have_loopclosure = false;
+    double active_tracks_time = -1;
+    std::unordered_map<size_t, Eigen::Vector3d> active_tracks_posinG;
+    std::unordered_map<size_t, Eigen::Vector3d> active_tracks_uvd;
+    cv::Mat active_cam0_image;
+    Eigen::Vector4d clone_q;
+    Eigen::Vector3d clone_p;
+    Eigen::Vector4d q_ItoC;
+    Eigen::Vector3d p_CinI;
+    Eigen::VectorXd cam0_intrinsics;
+    bool cam0_is_fisheye = false;
+
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  };
+
+  /// Copy everything the publishers need out of the current filter state
+  std::shared_ptr<VizSnapshot> capture_snapshot();
+
+  /**
+   * @brief Process all camera measurements whose update is now possible.
+   *
+   * Runs the filter on every queued camera measurement older than the given IMU
+   * timestamp (converted into the camera clock), visualizing after each update.
+   * In the multi-threaded subscriber mode only the persistent filter worker calls
+   * this, in the single-threaded mode it runs inline in the inertial callback.
+   *
+   * @param timestamp_imu Newest IMU timestamp we have received
+   */
+  void process_camera_queue(double timestamp_imu);
+
   /// Publish the current state
-  void publish_state();
+  void publish_state(const VizSnapshot &snap);
 
   /// Publish the active tracking image
   void publish_images();
 
   /// Publish current features
-  void publish_features();
+  void publish_features(const VizSnapshot &snap);
 
   /// Publish groundtruth (if we have it)
   void publish_groundtruth();
 
   /// Publish loop-closure information of current pose and active track information
-  void publish_loopclosure_information();
+  void publish_loopclosure_information(const VizSnapshot &snap);
 
   /// Global node handler
   std::shared_ptr<ros::NodeHandle> _nh;
@@ -141,21 +211,35 @@ protected:
 
   // Our publishers
   image_transport::Publisher it_pub_tracks, it_pub_loop_img_depth, it_pub_loop_img_depth_color;
-  ros::Publisher pub_poseimu, pub_poseimu_keyframe, pub_keyframe_def, pub_odomimu, pub_pathimu;
+  ros::Publisher pub_poseimu, pub_poseimu_keyframe, pub_keyframe_def, pub_odomimu, pub_pathimu, pub_pathsmooth;
   ros::Publisher pub_points_msckf, pub_points_slam, pub_points_aruco, pub_points_sim;
   ros::Publisher pub_loop_pose, pub_loop_point, pub_loop_extrinsic, pub_loop_intrinsics;
+  ros::Publisher pub_latency;
   std::shared_ptr<tf::TransformBroadcaster> mTfBr;
 
   // Our subscribers and camera synchronizers
+  // The IMU subscription has its own callback queue drained by a dedicated
+  // ingest thread, so camera callbacks can never delay inertial ingest
   ros::Subscriber sub_imu;
+  ros::CallbackQueue imu_callback_queue;
   std::vector<ros::Subscriber> subs_cam;
   typedef message_filters::sync_policies::ApproximateTime<sensor_msgs::Image, sensor_msgs::Image> sync_pol;
   std::vector<std::shared_ptr<message_filters::Synchronizer<sync_pol>>> sync_cam;
   std::vector<std::shared_ptr<message_filters::Subscriber<sensor_msgs::Image>>> sync_subs_cam;
 
   // For path viz
+  // NOTE: the pose histories are capped at max_path_length and older poses are
+  // NOTE: progressively decimated (see ROSVisualizerHelper::append_to_path_history)
+  // NOTE: so memory stays constant while the path still spans the whole mission
   unsigned int poses_seq_imu = 0;
-  std::vector<geometry_msgs::PoseStamped> poses_imu;
+  std::deque<geometry_msgs::PoseStamped> poses_imu;
+  std::deque<geometry_msgs::PoseStamped> poses_smoothed;
+  size_t max_path_length = 16384;
+
+  // Decimation state of each path history (see ROSVisualizerHelper::append_to_path_history)
+  size_t stride_path_imu = 1, count_path_imu = 0;
+  size_t stride_path_smooth = 1, count_path_smooth = 0;
+  size_t stride_path_gt = 1, count_path_gt = 0;
 
   // Groundtruth infomation
   ros::Publisher pub_pathgt, pub_posegt;
@@ -169,8 +253,23 @@ protected:
   bool start_time_set = false;
   boost::posix_time::ptime rT1, rT2;
 
-  // Thread atomics
-  std::atomic<bool> thread_update_running;
+  /// Newest IMU timestamps handed from the inertial callback to the persistent
+  /// filter worker and the odometry publisher (each tracks what it consumed, and
+  /// both naturally coalesce to the latest time when they fall behind)
+  std::mutex filter_mtx;
+  std::condition_variable filter_cv;
+  double filter_newest_imu_time = -1;
+  double filter_consumed_imu_time = -1;
+  std::mutex odom_mtx;
+  std::condition_variable odom_cv;
+  double odom_newest_imu_time = -1;
+  double odom_consumed_imu_time = -1;
+
+  /// Bounded queue of state snapshots waiting for the background publisher
+  /// The oldest snapshot is dropped when full so the filter thread never stalls
+  std::deque<std::shared_ptr<VizSnapshot>> viz_queue;
+  std::mutex viz_queue_mtx;
+  std::condition_variable viz_queue_cv;
 
   /// Queue up camera measurements sorted by time and trigger once we have
   /// exactly one IMU measurement with timestamp newer than the camera measurement
@@ -182,6 +281,13 @@ protected:
   // Last camera message timestamps we have received (mapped by cam id)
   std::map<int, double> camera_last_timestamp;
 
+  /// Pool of reusable image slabs so the camera callbacks can deposit frames without
+  /// a fresh allocation per image (the queue depth bounds how many are checked out)
+  ov_core::ImagePool camera_image_pool{16};
+
+  // Cached all-zero tracking masks (mapped by cam id) so we do not rebuild them every frame
+  std::map<int, cv::Mat> camera_empty_masks;
+
   // Last timestamp we visualized at
   double last_visualization_timestamp = 0;
   double last_visualization_timestamp_image = 0;
@@ -191,12 +297,18 @@ protected:
 
   // For path viz
   unsigned int poses_seq_gt = 0;
-  std::vector<geometry_msgs::PoseStamped> poses_gt;
+  std::deque<geometry_msgs::PoseStamped> poses_gt;
   bool publish_global2imu_tf = true;
   bool publish_calibration_tf = true;
 
+  // If the imu-rate odometry should be treated as a control-critical output
+  // (realtime priority odometry thread, zero-copy publish, decimated TF broadcasts)
+  bool publish_highrate_odometry = false;
+  double last_time_tf_publish = -1;
+
   // Files and if we should save total state
   bool save_total_state = false;
+  bool save_total_state_binary = false;
   std::ofstream of_state_est, of_state_std, of_state_gt;
 };
 
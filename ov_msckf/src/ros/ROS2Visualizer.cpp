@@ -21,6 +21,9 @@
 
 #include "ROS2Visualizer.h"
 
+#include <chrono>
+
+#include "core/FixedLagSmoother.h"
 #include "core/VioManager.h"
 #include "ros/ROSVisualizerHelper.h"
 #include "sim/Simulator.h"
@@ -30,13 +33,14 @@
 #include "utils/dataset_reader.h"
 #include "utils/print.h"
 #include "utils/sensor_data.h"
+#include "utils/thread_registry.h"
 
 using namespace ov_core;
 using namespace ov_type;
 using namespace ov_msckf;
 
 ROS2Visualizer::ROS2Visualizer(std::shared_ptr<rclcpp::Node> node, std::shared_ptr<VioManager> app, std::shared_ptr<Simulator> sim)
-    : _node(node), _app(app), _sim(sim), thread_update_running(false) {
+    : _node(node), _app(app), _sim(sim) {
 
   // Setup our transform broadcaster
   mTfBr = std::make_shared<tf2_ros::TransformBroadcaster>(node);
@@ -55,6 +59,8 @@ ROS2Visualizer::ROS2Visualizer(std::shared_ptr<rclcpp::Node> node, std::shared_p
   PRINT_DEBUG("Publishing: %s\n", pub_odomimu->get_topic_name());
   pub_pathimu = node->create_publisher<nav_msgs::msg::Path>("pathimu", 2);
   PRINT_DEBUG("Publishing: %s\n", pub_pathimu->get_topic_name());
+  pub_pathsmooth = node->create_publisher<nav_msgs::msg::Path>("pathsmooth", 2);
+  PRINT_DEBUG("Publishing: %s\n", pub_pathsmooth->get_topic_name());
 
   // 3D points publishing
   pub_points_msckf = node->create_publisher<sensor_msgs::msg::PointCloud2>("points_msckf", 2);
@@ -92,6 +98,13 @@ ROS2Visualizer::ROS2Visualizer(std::shared_ptr<rclcpp::Node> node, std::shared_p
     node->get_parameter<bool>("publish_calibration_tf", publish_calibration_tf);
   }
 
+  // Option to turn the imu-rate odometry into a control-grade output: the publisher
+  // thread gets realtime priority and the TF broadcasts are decimated off of it, so
+  // the odometry topic itself is the only work done per inertial message
+  if (node->has_parameter("publish_highrate_odometry")) {
+    node->get_parameter<bool>("publish_highrate_odometry", publish_highrate_odometry);
+  }
+
   // Load groundtruth if we have it and are not doing simulation
   // NOTE: needs to be a csv ASL format file
   std::string path_to_gt;
@@ -132,28 +145,38 @@ ROS2Visualizer::ROS2Visualizer(std::shared_ptr<rclcpp::Node> node, std::shared_p
     boost::filesystem::create_directories(boost::filesystem::path(filepath_est.c_str()).parent_path());
     boost::filesystem::create_directories(boost::filesystem::path(filepath_std.c_str()).parent_path());
 
+    // An ".ovb" estimate filepath selects the columnar binary format which skips
+    // the per-frame text formatting here and the text parsing at analysis time
+    save_total_state_binary = ROSVisualizerHelper::save_total_state_is_binary(filepath_est);
+
     // Open the files
-    of_state_est.open(filepath_est.c_str());
-    of_state_std.open(filepath_std.c_str());
-    of_state_est << "# timestamp(s) keyframe_def_q keyframe_def_p imu_q imu_p imu_v bg ba keyframe_imu_q keyframe_imu_p cam_imu_dt num_cam"
-                 << " cam0_k cam0_d cam0_rot cam0_trans ... imu_model dw da tg wtoI atoI etc" << std::endl;
-    of_state_std << "# timestamp(s) keyframe_def_q keyframe_def_p imu_q imu_p imu_v bg ba keyframe_imu_q keyframe_imu_p cam_imu_dt num_cam"
-                 << " cam0_k cam0_d cam0_rot cam0_trans ... imu_model dw da tg wtoI atoI etc" << std::endl;
+    std::ios_base::openmode mode = save_total_state_binary ? (std::ofstream::out | std::ofstream::binary) : std::ofstream::out;
+    of_state_est.open(filepath_est.c_str(), mode);
+    of_state_std.open(filepath_std.c_str(), mode);
+    if (!save_total_state_binary) {
+      of_state_est << "# timestamp(s) keyframe_def_q keyframe_def_p imu_q imu_p imu_v bg ba keyframe_imu_q keyframe_imu_p cam_imu_dt num_cam"
+                   << " cam0_k cam0_d cam0_rot cam0_trans ... imu_model dw da tg wtoI atoI etc" << std::endl;
+      of_state_std << "# timestamp(s) keyframe_def_q keyframe_def_p imu_q imu_p imu_v bg ba keyframe_imu_q keyframe_imu_p cam_imu_dt num_cam"
+                   << " cam0_k cam0_d cam0_rot cam0_trans ... imu_model dw da tg wtoI atoI etc" << std::endl;
+    }
 
     // Groundtruth if we are simulating
     if (_sim != nullptr) {
       if (boost::filesystem::exists(filepath_gt))
         boost::filesystem::remove(filepath_gt);
       boost::filesystem::create_directories(boost::filesystem::path(filepath_gt.c_str()).parent_path());
-      of_state_gt.open(filepath_gt.c_str());
-      of_state_gt << "# timestamp(s) imu_q imu_p imu_v bg ba cam_imu_dt num_cam cam0_k cam0_d cam0_rot cam0_trans ... imu_model dw"
-                  << " da tg wtoI atoI etc" << std::endl;
+      of_state_gt.open(filepath_gt.c_str(), mode);
+      if (!save_total_state_binary) {
+        of_state_gt << "# timestamp(s) imu_q imu_p imu_v bg ba cam_imu_dt num_cam cam0_k cam0_d cam0_rot cam0_trans ... imu_model dw"
+                    << " da tg wtoI atoI etc" << std::endl;
+      }
     }
   }
 
   // Start thread for the image publishing
   if (_app->get_params().use_multi_threading_pubs) {
     std::thread thread([&] {
+      ov_core::ThreadRegistry::register_thread("visualization");
       rclcpp::Rate loop_rate(20);
       while (rclcpp::ok()) {
         publish_images();
@@ -162,6 +185,47 @@ ROS2Visualizer::ROS2Visualizer(std::shared_ptr<rclcpp::Node> node, std::shared_p
     });
     thread.detach();
   }
+
+  // Start the persistent filter worker and the odometry publisher
+  // The sensor callbacks only convert and enqueue, so the ROS executor threads are
+  // never blocked behind an in-progress update: this pair drains the camera queue
+  // and publishes the fast-propagated pose whenever new IMU measurements arrive
+  if (_app->get_params().use_multi_threading_subs) {
+    std::thread thread_filter([&] {
+      while (rclcpp::ok()) {
+        double timestamp_imu = -1;
+        {
+          std::unique_lock<std::mutex> lck(filter_mtx);
+          filter_cv.wait_for(lck, std::chrono::milliseconds(50), [&] { return filter_newest_imu_time > filter_consumed_imu_time; });
+          if (filter_newest_imu_time <= filter_consumed_imu_time)
+            continue;
+          timestamp_imu = filter_newest_imu_time;
+          filter_consumed_imu_time = timestamp_imu;
+        }
+        process_camera_queue(timestamp_imu);
+      }
+    });
+    thread_filter.detach();
+    std::thread thread_odom([&] {
+      ov_core::ThreadRegistry::register_thread("visualization odom");
+      if (publish_highrate_odometry) {
+        ROSVisualizerHelper::try_realtime_priority("visualization odom");
+      }
+      while (rclcpp::ok()) {
+        double timestamp_imu = -1;
+        {
+          std::unique_lock<std::mutex> lck(odom_mtx);
+          odom_cv.wait_for(lck, std::chrono::milliseconds(50), [&] { return odom_newest_imu_time > odom_consumed_imu_time; });
+          if (odom_newest_imu_time <= odom_consumed_imu_time)
+            continue;
+          timestamp_imu = odom_newest_imu_time;
+          odom_consumed_imu_time = timestamp_imu;
+        }
+        visualize_odometry(timestamp_imu);
+      }
+    });
+    thread_odom.detach();
+  }
 }
 
 void ROS2Visualizer::setup_subscribers(std::shared_ptr<ov_core::YamlParser> parser) {
@@ -174,8 +238,27 @@ void ROS2Visualizer::setup_subscribers(std::shared_ptr<ov_core::YamlParser> pars
   _node->declare_parameter<std::string>("topic_imu", "/imu0");
   _node->get_parameter("topic_imu", topic_imu);
   parser->parse_external("relative_config_imu", "imu0", "rostopic", topic_imu);
-  sub_imu = _node->create_subscription<sensor_msgs::msg::Imu>(topic_imu, rclcpp::SensorDataQoS(),
-                                                              std::bind(&ROS2Visualizer::callback_inertial, this, std::placeholders::_1));
+  if (_app->get_params().use_multi_threading_subs) {
+    // The IMU lives in its own callback group spun by a dedicated ingest thread, so
+    // the image callbacks handled by the node executor can never delay inertial
+    // ingest (the thread asks for real-time scheduling, kept when we have permission)
+    imu_callback_group = _node->create_callback_group(rclcpp::CallbackGroupType::MutuallyExclusive, false);
+    rclcpp::SubscriptionOptions sub_imu_options;
+    sub_imu_options.callback_group = imu_callback_group;
+    sub_imu = _node->create_subscription<sensor_msgs::msg::Imu>(
+        topic_imu, rclcpp::SensorDataQoS(), std::bind(&ROS2Visualizer::callback_inertial, this, std::placeholders::_1), sub_imu_options);
+    std::thread thread_imu([&] {
+      ov_core::ThreadRegistry::register_thread("imu ingest");
+      ROSVisualizerHelper::try_realtime_priority("imu ingest");
+      rclcpp::executors::SingleThreadedExecutor executor;
+      executor.add_callback_group(imu_callback_group, _node->get_node_base_interface());
+      executor.spin();
+    });
+    thread_imu.detach();
+  } else {
+    sub_imu = _node->create_subscription<sensor_msgs::msg::Imu>(
+        topic_imu, rclcpp::SensorDataQoS(), std::bind(&ROS2Visualizer::callback_inertial, this, std::placeholders::_1));
+  }
   PRINT_INFO("subscribing to IMU: %s\n", topic_imu.c_str());
 
   // Logic for sync stereo subscriber
@@ -261,7 +344,12 @@ void ROS2Visualizer::visualize() {
 
   // Save total state
   if (save_total_state) {
-    ROSVisualizerHelper::sim_save_total_state_to_file(_app->get_state(), _sim, of_state_est, of_state_std, of_state_gt);
+    if (save_total_state_binary) {
+      ROSVisualizerHelper::sim_save_total_state_to_binary(_app->get_state(), _sim, of_state_est, of_state_std, of_state_gt,
+                                                          _app->get_timing_spans());
+    } else {
+      ROSVisualizerHelper::sim_save_total_state_to_file(_app->get_state(), _sim, of_state_est, of_state_std, of_state_gt);
+    }
   }
 
   // Print how much time it took to publish / displaying things
@@ -284,30 +372,32 @@ void ROS2Visualizer::visualize_odometry(double timestamp) {
     return;
 
   // Publish our odometry message if requested
+  // NOTE: we publish a unique_ptr so rclcpp can hand the message over without a copy
+  // NOTE: when both ends live in the same process (zero-copy intra-process transport)
   if (pub_odomimu->get_subscription_count() != 0) {
 
     // Our odometry message
-    nav_msgs::msg::Odometry odomIinM;
-    odomIinM.header.stamp = ROSVisualizerHelper::get_time_from_seconds(timestamp);
-    odomIinM.header.frame_id = "global";
+    auto odomIinM = std::make_unique<nav_msgs::msg::Odometry>();
+    odomIinM->header.stamp = ROSVisualizerHelper::get_time_from_seconds(timestamp);
+    odomIinM->header.frame_id = "global";
 
     // The POSE component (orientation and position)
-    odomIinM.pose.pose.orientation.x = state_plus(0);
-    odomIinM.pose.pose.orientation.y = state_plus(1);
-    odomIinM.pose.pose.orientation.z = state_plus(2);
-    odomIinM.pose.pose.orientation.w = state_plus(3);
-    odomIinM.pose.pose.position.x = state_plus(4);
-    odomIinM.pose.pose.position.y = state_plus(5);
-    odomIinM.pose.pose.position.z = state_plus(6);
+    odomIinM->pose.pose.orientation.x = state_plus(0);
+    odomIinM->pose.pose.orientation.y = state_plus(1);
+    odomIinM->pose.pose.orientation.z = state_plus(2);
+    odomIinM->pose.pose.orientation.w = state_plus(3);
+    odomIinM->pose.pose.position.x = state_plus(4);
+    odomIinM->pose.pose.position.y = state_plus(5);
+    odomIinM->pose.pose.position.z = state_plus(6);
 
     // The TWIST component (angular and linear velocities)
-    odomIinM.child_frame_id = "imu";
-    odomIinM.twist.twist.linear.x = state_plus(7);   // vel in local frame
-    odomIinM.twist.twist.linear.y = state_plus(8);   // vel in local frame
-    odomIinM.twist.twist.linear.z = state_plus(9);   // vel in local frame
-    odomIinM.twist.twist.angular.x = state_plus(10); // we do not estimate this...
-    odomIinM.twist.twist.angular.y = state_plus(11); // we do not estimate this...
-    odomIinM.twist.twist.angular.z = state_plus(12); // we do not estimate this...
+    odomIinM->child_frame_id = "imu";
+    odomIinM->twist.twist.linear.x = state_plus(7);   // vel in local frame
+    odomIinM->twist.twist.linear.y = state_plus(8);   // vel in local frame
+    odomIinM->twist.twist.linear.z = state_plus(9);   // vel in local frame
+    odomIinM->twist.twist.angular.x = state_plus(10); // we do not estimate this...
+    odomIinM->twist.twist.angular.y = state_plus(11); // we do not estimate this...
+    odomIinM->twist.twist.angular.z = state_plus(12); // we do not estimate this...
 
     // Finally set the covariance in the message (in the order position then orientation as per ros convention)
     Eigen::Matrix<double, 12, 12> Phi = Eigen::Matrix<double, 12, 12>::Zero();
@@ -317,15 +407,24 @@ void ROS2Visualizer::visualize_odometry(double timestamp) {
     cov_plus = Phi * cov_plus * Phi.transpose();
     for (int r = 0; r < 6; r++) {
       for (int c = 0; c < 6; c++) {
-        odomIinM.pose.covariance[6 * r + c] = cov_plus(r, c);
+        odomIinM->pose.covariance[6 * r + c] = cov_plus(r, c);
       }
     }
     for (int r = 0; r < 6; r++) {
       for (int c = 0; c < 6; c++) {
-        odomIinM.twist.covariance[6 * r + c] = cov_plus(r + 6, c + 6);
+        odomIinM->twist.covariance[6 * r + c] = cov_plus(r + 6, c + 6);
       }
     }
-    pub_odomimu->publish(odomIinM);
+    pub_odomimu->publish(std::move(odomIinM));
+  }
+
+  // In high-rate mode the odometry topic is the control-critical output, so we keep the
+  // per-message work to just the propagate and publish above and decimate the TF tree
+  // broadcasts (they are for visualization and do not need to be at imu rate)
+  if (publish_highrate_odometry) {
+    if (timestamp - last_time_tf_publish < 0.05)
+      return;
+    last_time_tf_publish = timestamp;
   }
 
   // Publish our transform on TF
@@ -447,55 +546,67 @@ void ROS2Visualizer::callback_inertial(const sensor_msgs::msg::Imu::SharedPtr ms
   message.wm << msg->angular_velocity.x, msg->angular_velocity.y, msg->angular_velocity.z;
   message.am << msg->linear_acceleration.x, msg->linear_acceleration.y, msg->linear_acceleration.z;
 
-  // send it to our VIO system
+  // send it to our VIO system (this is a lock-free enqueue into the propagator)
   _app->feed_measurement_imu(message);
-  visualize_odometry(message.timestamp);
 
-  // If the processing queue is currently active / running just return so we can keep getting measurements
-  // Otherwise create a second thread to do our update in an async manor
-  // The visualization of the state, images, and features will be synchronous with the update!
-  if (thread_update_running)
+  // If we are single threaded, then run everything inline right here
+  if (!_app->get_params().use_multi_threading_subs) {
+    visualize_odometry(message.timestamp);
+    process_camera_queue(message.timestamp);
     return;
-  thread_update_running = true;
-  std::thread thread([&] {
-    // Lock on the queue (prevents new images from appending)
-    std::lock_guard<std::mutex> lck(camera_queue_mtx);
-
-    // Count how many unique image streams
-    std::map<int, bool> unique_cam_ids;
-    for (const auto &cam_msg : camera_queue) {
-      unique_cam_ids[cam_msg.sensor_ids.at(0)] = true;
-    }
+  }
+
+  // Otherwise we just wake the persistent workers and return, so this callback
+  // never blocks its executor and inertial ingest always stays on time
+  {
+    std::lock_guard<std::mutex> lck(filter_mtx);
+    filter_newest_imu_time = message.timestamp;
+  }
+  filter_cv.notify_one();
+  {
+    std::lock_guard<std::mutex> lck(odom_mtx);
+    odom_newest_imu_time = message.timestamp;
+  }
+  odom_cv.notify_one();
+}
+
+void ROS2Visualizer::process_camera_queue(double timestamp_imu) {
+
+  // If we do not have enough unique cameras then we need to wait
+  // We should wait till we have one of each camera to ensure we propagate in the correct order
+  auto params = _app->get_params();
+  size_t num_unique_cameras = (params.state_options.num_cameras == 2) ? 1 : params.state_options.num_cameras;
 
-    // If we do not have enough unique cameras then we need to wait
-    // We should wait till we have one of each camera to ensure we propagate in the correct order
-    auto params = _app->get_params();
-    size_t num_unique_cameras = (params.state_options.num_cameras == 2) ? 1 : params.state_options.num_cameras;
-    if (unique_cam_ids.size() == num_unique_cameras) {
-
-      // Loop through our queue and see if we are able to process any of our camera measurements
-      // We are able to process if we have at least one IMU measurement greater than the camera time
-      double timestamp_imu_inC = message.timestamp - _app->get_state()->_calib_dt_CAMtoIMU->value()(0);
-      while (!camera_queue.empty() && camera_queue.at(0).timestamp < timestamp_imu_inC) {
-        auto rT0_1 = boost::posix_time::microsec_clock::local_time();
-        double update_dt = 100.0 * (timestamp_imu_inC - camera_queue.at(0).timestamp);
-        _app->feed_measurement_camera(camera_queue.at(0));
-        visualize();
-        camera_queue.pop_front();
-        auto rT0_2 = boost::posix_time::microsec_clock::local_time();
-        double time_total = (rT0_2 - rT0_1).total_microseconds() * 1e-6;
-        PRINT_INFO(BLUE "[TIME]: %.4f seconds total (%.1f hz, %.2f ms behind)\n" RESET, time_total, 1.0 / time_total, update_dt);
+  // We are able to process if we have at least one IMU measurement greater than the camera time
+  double timestamp_imu_inC = _app->get_state()->cam_time(timestamp_imu);
+
+  // Loop through our queue and process all the camera measurements that are ready
+  // Note we only hold the queue lock while inspecting and popping it, never during
+  // the update itself, so the camera callbacks can keep depositing frames meanwhile
+  while (true) {
+    ov_core::CameraData camera_data;
+    {
+      std::lock_guard<std::mutex> lck(camera_queue_mtx);
+
+      // Count how many unique image streams
+      std::map<int, bool> unique_cam_ids;
+      for (const auto &cam_msg : camera_queue) {
+        unique_cam_ids[cam_msg.sensor_ids.at(0)] = true;
       }
+      if (unique_cam_ids.size() != num_unique_cameras)
+        return;
+      if (camera_queue.empty() || camera_queue.at(0).timestamp >= timestamp_imu_inC)
+        return;
+      camera_data = camera_queue.front();
+      camera_queue.pop_front();
     }
-    thread_update_running = false;
-  });
-
-  // If we are single threaded, then run single threaded
-  // Otherwise detach this thread so it runs in the background!
-  if (!_app->get_params().use_multi_threading_subs) {
-    thread.join();
-  } else {
-    thread.detach();
+    auto rT0_1 = boost::posix_time::microsec_clock::local_time();
+    double update_dt = 100.0 * (timestamp_imu_inC - camera_data.timestamp);
+    _app->feed_measurement_camera(camera_data);
+    visualize();
+    auto rT0_2 = boost::posix_time::microsec_clock::local_time();
+    double time_total = (rT0_2 - rT0_1).total_microseconds() * 1e-6;
+    PRINT_INFO(BLUE "[TIME]: %.4f seconds total (%.1f hz, %.2f ms behind)\n" RESET, time_total, 1.0 / time_total, update_dt);
   }
 }
 
@@ -519,10 +630,13 @@ void ROS2Visualizer::callback_monocular(const sensor_msgs::msg::Image::SharedPtr
   }
 
   // Create the measurement
+  // The image is handed over zero-copy: it still aliases the middleware message,
+  // which the cv_bridge pointer we park in the owners list keeps alive
   ov_core::CameraData message;
   message.timestamp = cv_ptr->header.stamp.sec + cv_ptr->header.stamp.nanosec * 1e-9;
   message.sensor_ids.push_back(cam_id0);
-  message.images.push_back(cv_ptr->image.clone());
+  message.images.push_back(cv_ptr->image);
+  message.owners.push_back(cv_ptr);
 
   // Load the mask if we are using it, else it is empty
   // TODO: in the future we should get this from external pixel segmentation
@@ -532,9 +646,12 @@ void ROS2Visualizer::callback_monocular(const sensor_msgs::msg::Image::SharedPtr
     message.masks.push_back(cv::Mat::zeros(cv_ptr->image.rows, cv_ptr->image.cols, CV_8UC1));
   }
 
+  // Kick off pyramid pre-computation so it overlaps with the current filter update
+  _app->precompute_camera_pyramids(message);
+
   // append it to our queue of images
   std::lock_guard<std::mutex> lck(camera_queue_mtx);
-  camera_queue.push_back(message);
+  camera_queue.push_back(std::move(message));
   std::sort(camera_queue.begin(), camera_queue.end());
 }
 
@@ -568,12 +685,16 @@ void ROS2Visualizer::callback_stereo(const sensor_msgs::msg::Image::ConstSharedP
   }
 
   // Create the measurement
+  // The images are handed over zero-copy: they still alias the middleware messages,
+  // which the cv_bridge pointers we park in the owners list keep alive
   ov_core::CameraData message;
   message.timestamp = cv_ptr0->header.stamp.sec + cv_ptr0->header.stamp.nanosec * 1e-9;
   message.sensor_ids.push_back(cam_id0);
   message.sensor_ids.push_back(cam_id1);
-  message.images.push_back(cv_ptr0->image.clone());
-  message.images.push_back(cv_ptr1->image.clone());
+  message.images.push_back(cv_ptr0->image);
+  message.images.push_back(cv_ptr1->image);
+  message.owners.push_back(cv_ptr0);
+  message.owners.push_back(cv_ptr1);
 
   // Load the mask if we are using it, else it is empty
   // TODO: in the future we should get this from external pixel segmentation
@@ -586,9 +707,12 @@ void ROS2Visualizer::callback_stereo(const sensor_msgs::msg::Image::ConstSharedP
     message.masks.push_back(cv::Mat::zeros(cv_ptr1->image.rows, cv_ptr1->image.cols, CV_8UC1));
   }
 
+  // Kick off pyramid pre-computation so it overlaps with the current filter update
+  _app->precompute_camera_pyramids(message);
+
   // append it to our queue of images
   std::lock_guard<std::mutex> lck(camera_queue_mtx);
-  camera_queue.push_back(message);
+  camera_queue.push_back(std::move(message));
   std::sort(camera_queue.begin(), camera_queue.end());
 }
 
@@ -599,8 +723,7 @@ void ROS2Visualizer::publish_state() {
 
   // We want to publish in the IMU clock frame
   // The timestamp in the state will be the last camera time
-  double t_ItoC = state->_calib_dt_CAMtoIMU->value()(0);
-  double timestamp_inI = state->_timestamp + t_ItoC;
+  double timestamp_inI = state->imu_time(state->_timestamp);
 
   // Create pose of IMU (note we use the bag time)
   geometry_msgs::msg::PoseWithCovarianceStamped poseIinM;
@@ -629,22 +752,51 @@ void ROS2Visualizer::publish_state() {
   //=========================================================
   //=========================================================
 
-  // Append to our pose vector
+  // Append to our pose vector (constant memory, older history is progressively decimated)
   geometry_msgs::msg::PoseStamped posetemp;
   posetemp.header = poseIinM.header;
   posetemp.pose = poseIinM.pose.pose;
-  poses_imu.push_back(posetemp);
+  ROSVisualizerHelper::append_to_path_history(poses_imu, stride_path_imu, count_path_imu, posetemp, max_path_length);
 
   // Create our path (imu)
+  // Only assemble the message if somebody listens since it copies the whole history
   // NOTE: We downsample the number of poses as needed to prevent rviz crashes
   // NOTE: https://github.com/ros-visualization/rviz/issues/1107
-  nav_msgs::msg::Path arrIMU;
-  arrIMU.header.stamp = _node->now();
-  arrIMU.header.frame_id = "global";
-  for (size_t i = 0; i < poses_imu.size(); i += std::floor((double)poses_imu.size() / 16384.0) + 1) {
-    arrIMU.poses.push_back(poses_imu.at(i));
+  if (pub_pathimu->get_subscription_count() != 0) {
+    nav_msgs::msg::Path arrIMU;
+    arrIMU.header.stamp = _node->now();
+    arrIMU.header.frame_id = "global";
+    for (size_t i = 0; i < poses_imu.size(); i += std::floor((double)poses_imu.size() / 16384.0) + 1) {
+      arrIMU.poses.push_back(poses_imu.at(i));
+    }
+    pub_pathimu->publish(arrIMU);
+  }
+
+  // Append any newly finalized fixed-lag smoother poses and publish the refined path
+  if (_app->get_smoother() != nullptr) {
+    for (const auto &posepair : _app->get_smoother()->pop_smoothed_poses()) {
+      geometry_msgs::msg::PoseStamped posesmooth;
+      posesmooth.header.stamp = rclcpp::Time((int64_t)(posepair.first * 1e9));
+      posesmooth.header.frame_id = "global";
+      posesmooth.pose.orientation.x = posepair.second(0);
+      posesmooth.pose.orientation.y = posepair.second(1);
+      posesmooth.pose.orientation.z = posepair.second(2);
+      posesmooth.pose.orientation.w = posepair.second(3);
+      posesmooth.pose.position.x = posepair.second(4);
+      posesmooth.pose.position.y = posepair.second(5);
+      posesmooth.pose.position.z = posepair.second(6);
+      ROSVisualizerHelper::append_to_path_history(poses_smoothed, stride_path_smooth, count_path_smooth, posesmooth, max_path_length);
+    }
+    if (pub_pathsmooth->get_subscription_count() != 0 && !poses_smoothed.empty()) {
+      nav_msgs::msg::Path arrSMOOTH;
+      arrSMOOTH.header.stamp = _node->now();
+      arrSMOOTH.header.frame_id = "global";
+      for (size_t i = 0; i < poses_smoothed.size(); i += std::floor((double)poses_smoothed.size() / 16384.0) + 1) {
+        arrSMOOTH.poses.push_back(poses_smoothed.at(i));
+      }
+      pub_pathsmooth->publish(arrSMOOTH);
+    }
   }
-  pub_pathimu->publish(arrIMU);
 
   //=========================================================
   //=========================================================
@@ -722,34 +874,36 @@ void ROS2Visualizer::publish_images() {
 
 void ROS2Visualizer::publish_features() {
 
-  // Check if we have subscribers
-  if (pub_points_msckf->get_subscription_count() == 0 && pub_points_slam->get_subscription_count() == 0 &&
-      pub_points_aruco->get_subscription_count() == 0 && pub_points_sim->get_subscription_count() == 0)
-    return;
+  // Each cloud is only gathered and serialized if its topic has a subscriber
+  // (gathering the SLAM/ARUCO landmarks and copying the sim map are not free)
 
   // Get our good MSCKF features
-  std::vector<Eigen::Vector3d> feats_msckf = _app->get_good_features_MSCKF();
-  sensor_msgs::msg::PointCloud2 cloud = ROSVisualizerHelper::get_ros_pointcloud(_node, feats_msckf);
-  pub_points_msckf->publish(cloud);
+  if (pub_points_msckf->get_subscription_count() != 0) {
+    std::vector<Eigen::Vector3d> feats_msckf = _app->get_good_features_MSCKF();
+    sensor_msgs::msg::PointCloud2 cloud = ROSVisualizerHelper::get_ros_pointcloud(_node, feats_msckf);
+    pub_points_msckf->publish(cloud);
+  }
 
   // Get our good SLAM features
-  std::vector<Eigen::Vector3d> feats_slam = _app->get_features_SLAM();
-  sensor_msgs::msg::PointCloud2 cloud_SLAM = ROSVisualizerHelper::get_ros_pointcloud(_node, feats_slam);
-  pub_points_slam->publish(cloud_SLAM);
+  if (pub_points_slam->get_subscription_count() != 0) {
+    std::vector<Eigen::Vector3d> feats_slam = _app->get_features_SLAM();
+    sensor_msgs::msg::PointCloud2 cloud_SLAM = ROSVisualizerHelper::get_ros_pointcloud(_node, feats_slam);
+    pub_points_slam->publish(cloud_SLAM);
+  }
 
   // Get our good ARUCO features
-  std::vector<Eigen::Vector3d> feats_aruco = _app->get_features_ARUCO();
-  sensor_msgs::msg::PointCloud2 cloud_ARUCO = ROSVisualizerHelper::get_ros_pointcloud(_node, feats_aruco);
-  pub_points_aruco->publish(cloud_ARUCO);
-
-  // Skip the rest of we are not doing simulation
-  if (_sim == nullptr)
-    return;
+  if (pub_points_aruco->get_subscription_count() != 0) {
+    std::vector<Eigen::Vector3d> feats_aruco = _app->get_features_ARUCO();
+    sensor_msgs::msg::PointCloud2 cloud_ARUCO = ROSVisualizerHelper::get_ros_pointcloud(_node, feats_aruco);
+    pub_points_aruco->publish(cloud_ARUCO);
+  }
 
   // Get our good SIMULATION features
-  std::vector<Eigen::Vector3d> feats_sim = _sim->get_map_vec();
-  sensor_msgs::msg::PointCloud2 cloud_SIM = ROSVisualizerHelper::get_ros_pointcloud(_node, feats_sim);
-  pub_points_sim->publish(cloud_SIM);
+  if (_sim != nullptr && pub_points_sim->get_subscription_count() != 0) {
+    std::vector<Eigen::Vector3d> feats_sim = _sim->get_map_vec();
+    sensor_msgs::msg::PointCloud2 cloud_SIM = ROSVisualizerHelper::get_ros_pointcloud(_node, feats_sim);
+    pub_points_sim->publish(cloud_SIM);
+  }
 }
 
 void ROS2Visualizer::publish_groundtruth() {
@@ -759,8 +913,7 @@ void ROS2Visualizer::publish_groundtruth() {
 
   // We want to publish in the IMU clock frame
   // The timestamp in the state will be the last camera time
-  double t_ItoC = _app->get_state()->_calib_dt_CAMtoIMU->value()(0);
-  double timestamp_inI = _app->get_state()->_timestamp + t_ItoC;
+  double timestamp_inI = _app->get_state()->imu_time(_app->get_state()->_timestamp);
 
   // Check that we have the timestamp in our GT file [time(sec),q_GtoI,p_IinG,v_IinG,b_gyro,b_accel]
   if (_sim == nullptr && (gt_states.empty() || !DatasetReader::get_gt_state(timestamp_inI, state_gt, gt_states))) {
@@ -791,19 +944,22 @@ void ROS2Visualizer::publish_groundtruth() {
   poseIinM.pose.position.z = state_gt(7, 0);
   pub_posegt->publish(poseIinM);
 
-  // Append to our pose vector
-  poses_gt.push_back(poseIinM);
+  // Append to our pose vector (constant memory, older history is progressively decimated)
+  ROSVisualizerHelper::append_to_path_history(poses_gt, stride_path_gt, count_path_gt, poseIinM, max_path_length);
 
   // Create our path (imu)
+  // Only assemble the message if somebody listens since it copies the whole history
   // NOTE: We downsample the number of poses as needed to prevent rviz crashes
   // NOTE: https://github.com/ros-visualization/rviz/issues/1107
-  nav_msgs::msg::Path arrIMU;
-  arrIMU.header.stamp = _node->now();
-  arrIMU.header.frame_id = "global";
-  for (size_t i = 0; i < poses_gt.size(); i += std::floor((double)poses_gt.size() / 16384.0) + 1) {
-    arrIMU.poses.push_back(poses_gt.at(i));
+  if (pub_pathgt->get_subscription_count() != 0) {
+    nav_msgs::msg::Path arrIMU;
+    arrIMU.header.stamp = _node->now();
+    arrIMU.header.frame_id = "global";
+    for (size_t i = 0; i < poses_gt.size(); i += std::floor((double)poses_gt.size() / 16384.0) + 1) {
+      arrIMU.poses.push_back(poses_gt.at(i));
+    }
+    pub_pathgt->publish(arrIMU);
   }
-  pub_pathgt->publish(arrIMU);
 
   // Publish our transform on TF
   geometry_msgs::msg::TransformStamped trans;
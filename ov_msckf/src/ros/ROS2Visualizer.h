@@ -46,6 +46,8 @@
 #include <tf2_ros/transform_broadcaster.h>
 
 #include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <fstream>
 #include <memory>
 #include <mutex>
@@ -120,6 +122,18 @@ public:
                        int cam_id1);
 
 protected:
+  /**
+   * @brief Process all camera measurements whose update is now possible.
+   *
+   * Runs the filter on every queued camera measurement older than the given IMU
+   * timestamp (converted into the camera clock), visualizing after each update.
+   * In the multi-threaded subscriber mode only the persistent filter worker calls
+   * this, in the single-threaded mode it runs inline in the inertial callback.
+   *
+   * @param timestamp_imu Newest IMU timestamp we have received
+   */
+  void process_camera_queue(double timestamp_imu);
+
   /// Publish the current state
   void publish_state();
 
@@ -151,6 +165,7 @@ protected:
   rclcpp::Publisher<geometry_msgs::msg::PoseStamped>::SharedPtr pub_keyframe_def;
   rclcpp::Publisher<nav_msgs::msg::Odometry>::SharedPtr pub_odomimu;
   rclcpp::Publisher<nav_msgs::msg::Path>::SharedPtr pub_pathimu;
+  rclcpp::Publisher<nav_msgs::msg::Path>::SharedPtr pub_pathsmooth;
   rclcpp::Publisher<sensor_msgs::msg::PointCloud2>::SharedPtr pub_points_msckf, pub_points_slam, pub_points_aruco, pub_points_sim;
   rclcpp::Publisher<nav_msgs::msg::Odometry>::SharedPtr pub_loop_pose, pub_loop_extrinsic;
   rclcpp::Publisher<sensor_msgs::msg::PointCloud>::SharedPtr pub_loop_point;
@@ -158,14 +173,27 @@ protected:
   std::shared_ptr<tf2_ros::TransformBroadcaster> mTfBr;
 
   // Our subscribers and camera synchronizers
+  // The IMU subscription lives in its own callback group spun by a dedicated
+  // ingest thread, so camera callbacks can never delay inertial ingest
   rclcpp::Subscription<sensor_msgs::msg::Imu>::SharedPtr sub_imu;
+  rclcpp::CallbackGroup::SharedPtr imu_callback_group;
   std::vector<rclcpp::Subscription<sensor_msgs::msg::Image>::SharedPtr> subs_cam;
   typedef message_filters::sync_policies::ApproximateTime<sensor_msgs::msg::Image, sensor_msgs::msg::Image> sync_pol;
   std::vector<std::shared_ptr<message_filters::Synchronizer<sync_pol>>> sync_cam;
   std::vector<std::shared_ptr<message_filters::Subscriber<sensor_msgs::msg::Image>>> sync_subs_cam;
 
   // For path viz
-  std::vector<geometry_msgs::msg::PoseStamped> poses_imu;
+  // NOTE: the pose histories are capped at max_path_length and older poses are
+  // NOTE: progressively decimated (see ROSVisualizerHelper::append_to_path_history)
+  // NOTE: so memory stays constant while the path still spans the whole mission
+  std::deque<geometry_msgs::msg::PoseStamped> poses_imu;
+  std::deque<geometry_msgs::msg::PoseStamped> poses_smoothed;
+  size_t max_path_length = 16384;
+
+  // Decimation state of each path history (see ROSVisualizerHelper::append_to_path_history)
+  size_t stride_path_imu = 1, count_path_imu = 0;
+  size_t stride_path_smooth = 1, count_path_smooth = 0;
+  size_t stride_path_gt = 1, count_path_gt = 0;
 
   // Groundtruth infomation
   rclcpp::Publisher<nav_msgs::msg::Path>::SharedPtr pub_pathgt;
@@ -180,8 +208,17 @@ protected:
   bool start_time_set = false;
   boost::posix_time::ptime rT1, rT2;
 
-  // Thread atomics
-  std::atomic<bool> thread_update_running;
+  /// Newest IMU timestamps handed from the inertial callback to the persistent
+  /// filter worker and the odometry publisher (each tracks what it consumed, and
+  /// both naturally coalesce to the latest time when they fall behind)
+  std::mutex filter_mtx;
+  std::condition_variable filter_cv;
+  double filter_newest_imu_time = -1;
+  double filter_consumed_imu_time = -1;
+  std::mutex odom_mtx;
+  std::condition_variable odom_cv;
+  double odom_newest_imu_time = -1;
+  double odom_consumed_imu_time = -1;
 
   /// Queue up camera measurements sorted by time and trigger once we have
   /// exactly one IMU measurement with timestamp newer than the camera measurement
@@ -201,12 +238,18 @@ protected:
   std::map<double, Eigen::Matrix<double, 17, 1>> gt_states;
 
   // For path viz
-  std::vector<geometry_msgs::msg::PoseStamped> poses_gt;
+  std::deque<geometry_msgs::msg::PoseStamped> poses_gt;
   bool publish_global2imu_tf = true;
   bool publish_calibration_tf = true;
 
+  // If the imu-rate odometry should be treated as a control-critical output
+  // (realtime priority odometry thread, zero-copy publish, decimated TF broadcasts)
+  bool publish_highrate_odometry = false;
+  double last_time_tf_publish = -1;
+
   // Files and if we should save total state
   bool save_total_state = false;
+  bool save_total_state_binary = false;
   std::ofstream of_state_est, of_state_std, of_state_gt;
 };
 
@@ -27,6 +27,12 @@
 #include "state/StateHelper.h"
 
 #include "types/PoseJPL.h"
+#include "utils/colors.h"
+#include "utils/print.h"
+
+#include <cstdint>
+#include <cstring>
+#include <pthread.h>
 
 using namespace ov_msckf;
 using namespace std;
@@ -151,14 +157,25 @@ geometry_msgs::msg::TransformStamped ROSVisualizerHelper::get_stamped_transform_
 }
 #endif
 
+void ROSVisualizerHelper::try_realtime_priority(const char *name) {
+  sched_param sch{};
+  sch.sched_priority = sched_get_priority_min(SCHED_FIFO) + 1;
+  int ret = pthread_setschedparam(pthread_self(), SCHED_FIFO, &sch);
+  if (ret != 0) {
+    PRINT_WARNING(YELLOW "unable to set real-time priority for the %s thread (%s), keeping default scheduling\n" RESET, name,
+                  std::strerror(ret));
+  } else {
+    PRINT_DEBUG("set real-time priority for the %s thread\n", name);
+  }
+}
+
 void ROSVisualizerHelper::sim_save_total_state_to_file(std::shared_ptr<State> state, std::shared_ptr<Simulator> sim,
                                                        std::ofstream &of_state_est, std::ofstream &of_state_std,
                                                        std::ofstream &of_state_gt) {
 
   // We want to publish in the IMU clock frame
   // The timestamp in the state will be the last camera time
-  double t_ItoC = state->_calib_dt_CAMtoIMU->value()(0);
-  double timestamp_inI = state->_timestamp + t_ItoC;
+  double timestamp_inI = state->imu_time(state->_timestamp);
 
   // If we have our simulator, then save it to our groundtruth file
   if (sim != nullptr) {
@@ -412,3 +429,187 @@ void ROSVisualizerHelper::sim_save_total_state_to_file(std::shared_ptr<State> st
   of_state_est << endl;
   of_state_std << endl;
 }
+
+bool ROSVisualizerHelper::save_total_state_is_binary(const std::string &filepath) {
+  std::string ext = ".ovb";
+  return filepath.size() >= ext.size() && filepath.compare(filepath.size() - ext.size(), ext.size(), ext) == 0;
+}
+
+void ROSVisualizerHelper::write_binary_state_record(std::ofstream &of, const std::vector<double> &values) {
+
+  // First record also writes the header: 8 byte magic, uint32 version, uint32 values per record
+  // There is no record count, readers derive it from the file size so we can append forever
+  // The magic starts with '#' and ends with a newline so text parsers see one comment line
+  if (of.tellp() == std::streampos(0)) {
+    const char magic[8] = {'#', 'O', 'V', 'S', 'B', 'I', 'N', '\n'};
+    uint32_t version = 1;
+    uint32_t values_per_record = (uint32_t)values.size();
+    of.write(magic, sizeof(magic));
+    of.write((const char *)&version, sizeof(uint32_t));
+    of.write((const char *)&values_per_record, sizeof(uint32_t));
+  }
+  of.write((const char *)values.data(), values.size() * sizeof(double));
+}
+
+void ROSVisualizerHelper::sim_save_total_state_to_binary(std::shared_ptr<State> state, std::shared_ptr<Simulator> sim,
+                                                         std::ofstream &of_state_est, std::ofstream &of_state_std,
+                                                         std::ofstream &of_state_gt, const Eigen::Matrix<double, 7, 1> &timing) {
+
+  // Small helpers so the column building below stays readable
+  // NOTE: the column order must stay identical to sim_save_total_state_to_file
+  // NOTE: so ov_eval can consume text and binary runs interchangeably
+  auto push = [](std::vector<double> &vec, const Eigen::VectorXd &values) {
+    for (int i = 0; i < values.rows(); i++)
+      vec.push_back(values(i));
+  };
+  auto push_zeros = [](std::vector<double> &vec, int num) {
+    for (int i = 0; i < num; i++)
+      vec.push_back(0.0);
+  };
+
+  // We want to publish in the IMU clock frame
+  // The timestamp in the state will be the last camera time
+  double timestamp_inI = state->imu_time(state->_timestamp);
+
+  // If we have our simulator, then save it to our groundtruth file
+  if (sim != nullptr) {
+
+    // Note that we get the true time in the IMU clock frame
+    // NOTE: we record both the estimate and groundtruth with the same "true" timestamp if we are doing simulation
+    Eigen::Matrix<double, 17, 1> state_gt;
+    timestamp_inI = state->_timestamp + sim->get_true_parameters().calib_camimu_dt;
+    if (sim->get_state(timestamp_inI, state_gt)) {
+
+      // STATE: current true state, then the true calibration (mirrors the text groundtruth columns)
+      std::vector<double> vec_gt;
+      push(vec_gt, state_gt);
+      vec_gt.push_back(sim->get_true_parameters().calib_camimu_dt);
+      vec_gt.push_back((double)state->_options.num_cameras);
+      assert(state->_options.num_cameras == sim->get_true_parameters().state_options.num_cameras);
+      for (int i = 0; i < state->_options.num_cameras; i++) {
+        push(vec_gt, sim->get_true_parameters().camera_intrinsics.at(i)->get_value());
+        push(vec_gt, sim->get_true_parameters().camera_extrinsics.at(i));
+      }
+      vec_gt.push_back((double)sim->get_true_parameters().state_options.imu_model);
+      push(vec_gt, sim->get_true_parameters().vec_dw);
+      push(vec_gt, sim->get_true_parameters().vec_da);
+      push(vec_gt, sim->get_true_parameters().vec_tg);
+      push(vec_gt, sim->get_true_parameters().q_GYROtoIMU);
+      push(vec_gt, sim->get_true_parameters().q_ACCtoIMU);
+      write_binary_state_record(of_state_gt, vec_gt);
+    }
+  }
+
+  //==========================================================================
+  //==========================================================================
+  //==========================================================================
+
+  // Get the covariance of the whole system
+  Eigen::MatrixXd cov = StateHelper::get_full_covariance(state);
+  auto push_std = [&](std::vector<double> &vec, int id, int num) {
+    for (int i = 0; i < num; i++)
+      vec.push_back(std::sqrt(cov(id + i, id + i)));
+  };
+
+  // STATE: current state estimate
+  std::vector<double> vec_est;
+  vec_est.push_back(timestamp_inI);
+  push(vec_est, state->_keyframe_def->quat());
+  push(vec_est, state->_keyframe_def->pos());
+  push(vec_est, state->_imu->quat());
+  push(vec_est, state->_imu->pos());
+  push(vec_est, state->_imu->vel());
+  push(vec_est, state->_imu->bias_g());
+  push(vec_est, state->_imu->bias_a());
+  push(vec_est, state->_imu->keyframe_quat());
+  push(vec_est, state->_imu->keyframe_pos());
+
+  // STATE: current uncertainty
+  std::vector<double> vec_std;
+  vec_std.push_back(timestamp_inI);
+  push(vec_std, state->_keyframe_def->quat());
+  push(vec_std, state->_keyframe_def->pos());
+  push_std(vec_std, state->_imu->q()->id(), 3);
+  push_std(vec_std, state->_imu->p()->id(), 3);
+  push_std(vec_std, state->_imu->v()->id(), 3);
+  push_std(vec_std, state->_imu->bg()->id(), 3);
+  push_std(vec_std, state->_imu->ba()->id(), 3);
+  push_std(vec_std, state->_imu->keyframe_q()->id(), 3);
+  push_std(vec_std, state->_imu->keyframe_p()->id(), 3);
+
+  // TIMEOFF: current estimate and std of the time offset
+  vec_est.push_back(state->_calib_dt_CAMtoIMU->value()(0));
+  vec_est.push_back((double)state->_options.num_cameras);
+  if (state->_options.do_calib_camera_timeoffset) {
+    push_std(vec_std, state->_calib_dt_CAMtoIMU->id(), 1);
+  } else {
+    push_zeros(vec_std, 1);
+  }
+  vec_std.push_back((double)state->_options.num_cameras);
+
+  // CALIBRATION: camera intrinsic and extrinsic values
+  for (int i = 0; i < state->_options.num_cameras; i++) {
+    push(vec_est, state->_cam_intrinsics.at(i)->value());
+    push(vec_est, state->_calib_IMUtoCAM.at(i)->value());
+    if (state->_options.do_calib_camera_intrinsics) {
+      push_std(vec_std, state->_cam_intrinsics.at(i)->id(), 8);
+    } else {
+      push_zeros(vec_std, 8);
+    }
+    if (state->_options.do_calib_camera_pose) {
+      push_std(vec_std, state->_calib_IMUtoCAM.at(i)->id(), 6);
+    } else {
+      push_zeros(vec_std, 6);
+    }
+  }
+
+  // imu intrinsics: what model we are using
+  vec_est.push_back((double)state->_options.imu_model);
+  vec_std.push_back((double)state->_options.imu_model);
+
+  // imu intrinsics: dw and da
+  push(vec_est, state->_calib_imu_dw->value());
+  if (state->_options.do_calib_imu_intrinsics) {
+    push_std(vec_std, state->_calib_imu_dw->id(), 6);
+  } else {
+    push_zeros(vec_std, 6);
+  }
+  push(vec_est, state->_calib_imu_da->value());
+  if (state->_options.do_calib_imu_intrinsics) {
+    push_std(vec_std, state->_calib_imu_da->id(), 6);
+  } else {
+    push_zeros(vec_std, 6);
+  }
+
+  // imu intrinsics: tg
+  push(vec_est, state->_calib_imu_tg->value());
+  if (state->_options.do_calib_imu_intrinsics && state->_options.do_calib_imu_g_sensitivity) {
+    push_std(vec_std, state->_calib_imu_tg->id(), 9);
+  } else {
+    push_zeros(vec_std, 9);
+  }
+
+  // imu intrinsics: kalibr R_gyrotoI and rpng R_acctoI
+  // NOTE: we match the text file which only writes three zeros when the quaternion is not calibrated
+  push(vec_est, state->_calib_imu_GYROtoIMU->value());
+  if (state->_options.do_calib_imu_intrinsics && state->_options.imu_model == StateOptions::ImuModel::KALIBR) {
+    push_std(vec_std, state->_calib_imu_GYROtoIMU->id(), 4);
+  } else {
+    push_zeros(vec_std, 3);
+  }
+  push(vec_est, state->_calib_imu_ACCtoIMU->value());
+  if (state->_options.do_calib_imu_intrinsics && state->_options.imu_model == StateOptions::ImuModel::RPNG) {
+    push_std(vec_std, state->_calib_imu_ACCtoIMU->id(), 4);
+  } else {
+    push_zeros(vec_std, 3);
+  }
+
+  // TIMING: spans of the update that produced this estimate (estimate file only)
+  for (int i = 0; i < 7; i++) {
+    vec_est.push_back(timing(i));
+  }
+
+  // Done with the estimates!
+  write_binary_state_record(of_state_est, vec_est);
+  write_binary_state_record(of_state_std, vec_std);
+}
@@ -22,6 +22,8 @@
 #ifndef OV_MSCKF_ROSVISUALIZER_HELPER_H
 #define OV_MSCKF_ROSVISUALIZER_HELPER_H
 
+#include <deque>
+
 #include <Eigen/Eigen>
 
 #if ROS_AVAILABLE == 1
@@ -119,6 +121,48 @@ public:
 
 #endif
 
+  /**
+   * @brief Append a pose to a constant-memory path history
+   * @param history Buffer of poses published as the path (oldest first)
+   * @param stride Current decimation, only every stride'th pose is stored (starts at one)
+   * @param counter Running count of the poses offered to this history
+   * @param pose New pose to record
+   * @param max_size Hard cap on how many poses the buffer may hold
+   *
+   * Once the buffer is full, every other stored pose is dropped and the stride is
+   * doubled, so the history always covers the whole mission at a uniform spacing
+   * while memory use and serialization cost stay constant over arbitrarily long
+   * runs. With the default 16384 cap a 30Hz stream keeps every pose for the first
+   * nine minutes and an eight hour mission ends around a two second spacing (the
+   * full-rate current pose is still published on the pose and odometry topics).
+   */
+  template <typename PoseType>
+  static void append_to_path_history(std::deque<PoseType> &history, size_t &stride, size_t &counter, const PoseType &pose,
+                                     size_t max_size) {
+    if ((counter++ % stride) != 0)
+      return;
+    history.push_back(pose);
+    if (history.size() <= max_size)
+      return;
+    std::deque<PoseType> thinned;
+    for (size_t i = 0; i < history.size(); i += 2)
+      thinned.push_back(history.at(i));
+    history.swap(thinned);
+    stride *= 2;
+  }
+
+  /**
+   * @brief Ask the OS to give the calling thread real-time scheduling priority.
+   *
+   * The inertial ingest threads use this so a long filter update can never starve
+   * them of CPU time and delay measurement timestamps. Real-time scheduling needs
+   * elevated privileges (e.g. CAP_SYS_NICE), so failure is common and expected,
+   * in which case we warn once and keep the default policy.
+   *
+   * @param name Short thread name used in the printouts
+   */
+  static void try_realtime_priority(const char *name);
+
   /**
    * @brief Save current estimate state and groundtruth including calibration
    * @param state Pointer to the state
@@ -130,7 +174,35 @@ public:
   static void sim_save_total_state_to_file(std::shared_ptr<State> state, std::shared_ptr<Simulator> sim, std::ofstream &of_state_est,
                                            std::ofstream &of_state_std, std::ofstream &of_state_gt);
 
+  /**
+   * @brief Binary version of @ref sim_save_total_state_to_file for post-run analysis
+   *
+   * Appends the same columns as the text files as fixed-stride binary records
+   * ("#OVSBIN" format, see ov_eval::BinaryState which reads them back), which
+   * removes the per-frame number formatting from the filter thread and the text
+   * parsing from analysis time. The estimate record additionally ends with the
+   * seven timing spans of the update that produced it. Records are appended
+   * after a small self-describing header, so a file from a crashed run is still
+   * loadable and the writer never has to seek.
+   *
+   * @param state Pointer to the state
+   * @param sim Pointer to the simulator (or null)
+   * @param of_state_est Output file for state estimate (opened in binary mode)
+   * @param of_state_std Output file for covariance (opened in binary mode)
+   * @param of_state_gt Output file for groundtruth (if we have it from sim)
+   * @param timing Timing spans of this update [track prop msckf slam_up slam_delay marg total] (seconds)
+   */
+  static void sim_save_total_state_to_binary(std::shared_ptr<State> state, std::shared_ptr<Simulator> sim, std::ofstream &of_state_est,
+                                             std::ofstream &of_state_std, std::ofstream &of_state_gt,
+                                             const Eigen::Matrix<double, 7, 1> &timing);
+
+  /// True if the given state output filepath selects the binary format (".ovb" extension)
+  static bool save_total_state_is_binary(const std::string &filepath);
+
 private:
+  /// Appends one fixed-stride record to a binary state file, writing the header first if the file is empty
+  static void write_binary_state_record(std::ofstream &of, const std::vector<double> &values);
+
   // Cannot create this class
   ROSVisualizerHelper() = default;
 };
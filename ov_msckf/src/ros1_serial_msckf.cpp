@@ -25,12 +25,18 @@
 #include <sensor_msgs/Image.h>
 #include <sensor_msgs/Imu.h>
 
+#include <atomic>
+#include <condition_variable>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <thread>
 
 #include "core/VioManager.h"
 #include "core/VioManagerOptions.h"
 #include "ros/ROS1Visualizer.h"
 #include "utils/dataset_reader.h"
+#include "utils/thread_registry.h"
 
 using namespace ov_msckf;
 
@@ -188,10 +194,72 @@ int main(int argc, char **argv) {
   //===================================================================================
   //===================================================================================
 
+  // Background prefetcher which deserializes the next messages while the filter consumes the current one
+  // Reading from the bag and decoding an image is a large part of the replay time, so we hide it behind the
+  // filter update by staying a bounded number of messages ahead of the main loop below
+  std::mutex prefetch_mtx;
+  std::condition_variable prefetch_cv;
+  std::map<int, sensor_msgs::Imu::ConstPtr> prefetch_imu;
+  std::map<int, sensor_msgs::Image::ConstPtr> prefetch_img;
+  int prefetch_demand = 0;
+  const int prefetch_window = 64;
+  std::atomic<bool> prefetch_stop(false);
+  std::thread prefetch_thread([&] {
+    ov_core::ThreadRegistry::register_thread("prefetch bag");
+    for (int m = 0; m < (int)msgs.size(); m++) {
+      {
+        std::unique_lock<std::mutex> lck(prefetch_mtx);
+        prefetch_cv.wait(lck, [&] { return m < prefetch_demand + prefetch_window || prefetch_stop; });
+        if (prefetch_stop)
+          return;
+      }
+      if (msgs.at(m).getTopic() == topic_imu) {
+        sensor_msgs::Imu::ConstPtr ptr = msgs.at(m).instantiate<sensor_msgs::Imu>();
+        std::lock_guard<std::mutex> lck(prefetch_mtx);
+        prefetch_imu[m] = ptr;
+        prefetch_cv.notify_all();
+      } else {
+        sensor_msgs::Image::ConstPtr ptr = msgs.at(m).instantiate<sensor_msgs::Image>();
+        std::lock_guard<std::mutex> lck(prefetch_mtx);
+        prefetch_img[m] = ptr;
+        prefetch_cv.notify_all();
+      }
+    }
+  });
+
+  // Helpers which block until the requested message has been deserialized
+  auto get_imu_msg = [&](int m) {
+    std::unique_lock<std::mutex> lck(prefetch_mtx);
+    prefetch_demand = std::max(prefetch_demand, m);
+    prefetch_cv.notify_all();
+    prefetch_cv.wait(lck, [&] { return prefetch_imu.find(m) != prefetch_imu.end(); });
+    sensor_msgs::Imu::ConstPtr ptr = prefetch_imu.at(m);
+    prefetch_imu.erase(m);
+    return ptr;
+  };
+  auto get_image_msg = [&](int m) {
+    std::unique_lock<std::mutex> lck(prefetch_mtx);
+    prefetch_demand = std::max(prefetch_demand, m);
+    prefetch_cv.notify_all();
+    prefetch_cv.wait(lck, [&] { return prefetch_img.find(m) != prefetch_img.end(); });
+    sensor_msgs::Image::ConstPtr ptr = prefetch_img.at(m);
+    prefetch_img.erase(m);
+    return ptr;
+  };
+
   // Loop through our message array, and lets process them
   std::set<int> used_index;
   for (int m = 0; m < (int)msgs.size(); m++) {
 
+    // Let the prefetcher advance, and drop any deserialized messages we have skipped over
+    {
+      std::lock_guard<std::mutex> lck(prefetch_mtx);
+      prefetch_demand = std::max(prefetch_demand, m);
+      prefetch_imu.erase(prefetch_imu.begin(), prefetch_imu.lower_bound(m));
+      prefetch_img.erase(prefetch_img.begin(), prefetch_img.lower_bound(m));
+    }
+    prefetch_cv.notify_all();
+
     // End once we reach the last time, or skip if before beginning time (shouldn't happen)
     if (!ros::ok() || msgs.at(m).getTime() > time_finish || msgs.at(m).getTime().toSec() > max_camera_time)
       break;
@@ -207,7 +275,7 @@ int main(int argc, char **argv) {
     // IMU processing
     if (msgs.at(m).getTopic() == topic_imu) {
       // PRINT_DEBUG("processing imu = %.3f sec\n", msgs.at(m).getTime().toSec() - time_init.toSec());
-      viz->callback_inertial(msgs.at(m).instantiate<sensor_msgs::Imu>());
+      viz->callback_inertial(get_imu_msg(m));
     }
 
     // Camera processing
@@ -258,13 +326,11 @@ int main(int argc, char **argv) {
       // Pass our data into our visualizer callbacks!
       // PRINT_DEBUG("processing cam = %.3f sec\n", msgs.at(m).getTime().toSec() - time_init.toSec());
       if (params.state_options.num_cameras == 1) {
-        viz->callback_monocular(msgs.at(camid_to_msg_index.at(0)).instantiate<sensor_msgs::Image>(), 0);
+        viz->callback_monocular(get_image_msg(camid_to_msg_index.at(0)), 0);
       } else if (params.state_options.num_cameras == 2) {
-        auto msg0 = msgs.at(camid_to_msg_index.at(0));
-        auto msg1 = msgs.at(camid_to_msg_index.at(1));
         used_index.insert(camid_to_msg_index.at(0)); // skip this message
         used_index.insert(camid_to_msg_index.at(1)); // skip this message
-        viz->callback_stereo(msg0.instantiate<sensor_msgs::Image>(), msg1.instantiate<sensor_msgs::Image>(), 0, 1);
+        viz->callback_stereo(get_image_msg(camid_to_msg_index.at(0)), get_image_msg(camid_to_msg_index.at(1)), 0, 1);
       } else {
         PRINT_ERROR(RED "[SERIAL]: We currently only support 1 or 2 camera serial input....\n" RESET);
         return EXIT_FAILURE;
@@ -274,6 +340,14 @@ int main(int argc, char **argv) {
     }
   }
 
+  // Shut down the prefetcher (it may be waiting for the consumer to advance)
+  {
+    std::lock_guard<std::mutex> lck(prefetch_mtx);
+    prefetch_stop = true;
+  }
+  prefetch_cv.notify_all();
+  prefetch_thread.join();
+
   // Final visualization
   viz->visualize_final();
 
@@ -0,0 +1,359 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2018-2023 Patrick Geneva
+ * Copyright (C) 2018-2023 Guoquan Huang
+ * Copyright (C) 2018-2023 OpenVINS Contributors
+ * Copyright (C) 2018-2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <rclcpp/rclcpp.hpp>
+#include <rclcpp/serialization.hpp>
+#include <rosbag2_cpp/readers/sequential_reader.hpp>
+#include <rosbag2_storage/storage_filter.hpp>
+#include <sensor_msgs/msg/image.hpp>
+#include <sensor_msgs/msg/imu.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+
+#include "core/VioManager.h"
+#include "core/VioManagerOptions.h"
+#include "ros/ROS2Visualizer.h"
+#include "utils/dataset_reader.h"
+#include "utils/thread_registry.h"
+
+using namespace ov_msckf;
+
+std::shared_ptr<VioManager> sys;
+std::shared_ptr<ROS2Visualizer> viz;
+
+// Main function
+int main(int argc, char **argv) {
+
+  // Ensure we have a path, if the user passes it then we should use it
+  std::string config_path = "unset_path_to_config.yaml";
+  if (argc > 1) {
+    config_path = argv[1];
+  }
+
+  // Launch our ros node
+  rclcpp::init(argc, argv);
+  rclcpp::NodeOptions options;
+  options.allow_undeclared_parameters(true);
+  options.automatically_declare_parameters_from_overrides(true);
+  auto node = std::make_shared<rclcpp::Node>("ros2_serial_msckf", options);
+  node->get_parameter<std::string>("config_path", config_path);
+
+  // Load the config
+  auto parser = std::make_shared<ov_core::YamlParser>(config_path);
+  parser->set_node(node);
+
+  // Verbosity
+  std::string verbosity = "INFO";
+  parser->parse_config("verbosity", verbosity);
+  ov_core::Printer::setPrintLevel(verbosity);
+
+  // Create our VIO system
+  VioManagerOptions params;
+  params.print_and_load(parser);
+  // params.num_opencv_threads = 0; // uncomment if you want repeatability
+  // params.use_multi_threading_pubs = 0; // uncomment if you want repeatability
+  params.use_multi_threading_subs = false;
+  sys = std::make_shared<VioManager>(params);
+  viz = std::make_shared<ROS2Visualizer>(node, sys);
+
+  // Ensure we read in all parameters required
+  if (!parser->successful()) {
+    PRINT_ERROR(RED "[SERIAL]: unable to parse all parameters, please fix\n" RESET);
+    std::exit(EXIT_FAILURE);
+  }
+
+  //===================================================================================
+  //===================================================================================
+  //===================================================================================
+
+  // Our imu topic
+  std::string topic_imu = "/imu0";
+  node->get_parameter<std::string>("topic_imu", topic_imu);
+  parser->parse_external("relative_config_imu", "imu0", "rostopic", topic_imu);
+  PRINT_DEBUG("[SERIAL]: imu: %s\n", topic_imu.c_str());
+
+  // Our camera topics
+  std::vector<std::string> topic_cameras;
+  for (int i = 0; i < params.state_options.num_cameras; i++) {
+    std::string cam_topic = "/cam" + std::to_string(i) + "/image_raw";
+    node->get_parameter<std::string>("topic_camera" + std::to_string(i), cam_topic);
+    parser->parse_external("relative_config_imucam", "cam" + std::to_string(i), "rostopic", cam_topic);
+    topic_cameras.emplace_back(cam_topic);
+    PRINT_DEBUG("[SERIAL]: cam: %s\n", cam_topic.c_str());
+  }
+
+  // Location of the ROS bag we want to read in
+  std::string path_to_bag = "/home/patrick/datasets/eth/V1_01_easy";
+  node->get_parameter<std::string>("path_bag", path_to_bag);
+  PRINT_DEBUG("[SERIAL]: ros bag path is: %s\n", path_to_bag.c_str());
+
+  // Load groundtruth if we have it
+  // NOTE: needs to be a csv ASL format file
+  std::map<double, Eigen::Matrix<double, 17, 1>> gt_states;
+  std::string path_to_gt;
+  node->get_parameter<std::string>("path_gt", path_to_gt);
+  if (!path_to_gt.empty()) {
+    ov_core::DatasetReader::load_gt_file(path_to_gt, gt_states);
+    PRINT_DEBUG("[SERIAL]: gt file path is: %s\n", path_to_gt.c_str());
+  }
+
+  // Get our start location and how much of the bag we want to play
+  // Make the bag duration < 0 to just process to the end of the bag
+  double bag_start = 0.0;
+  double bag_durr = -1.0;
+  node->get_parameter<double>("bag_start", bag_start);
+  node->get_parameter<double>("bag_durr", bag_durr);
+  PRINT_DEBUG("[SERIAL]: bag start: %.1f\n", bag_start);
+  PRINT_DEBUG("[SERIAL]: bag duration: %.1f\n", bag_durr);
+
+  //===================================================================================
+  //===================================================================================
+  //===================================================================================
+
+  // Open the bag directly through the rosbag2 storage API
+  // This bypasses `ros2 bag play` and its DDS loopback, which serializes every image
+  // onto the wire just for us to deserialize it again in the subscriber callbacks
+  rosbag2_cpp::readers::SequentialReader reader;
+  rosbag2_storage::StorageOptions storage_options;
+  storage_options.uri = path_to_bag;
+  rosbag2_cpp::ConverterOptions converter_options;
+  converter_options.input_serialization_format = "cdr";
+  converter_options.output_serialization_format = "cdr";
+  reader.open(storage_options, converter_options);
+
+  // Only our topics need to be touched on disk
+  rosbag2_storage::StorageFilter filter;
+  filter.topics.push_back(topic_imu);
+  for (int i = 0; i < params.state_options.num_cameras; i++) {
+    filter.topics.push_back(topic_cameras.at(i));
+  }
+  reader.set_filter(filter);
+
+  // Pull the raw serialized messages into memory so we can access arbitrary points
+  // in the bag (the stereo pairing below needs to look ahead of the current message)
+  // Deserialization is deferred to the prefetch worker, here we only keep the bytes
+  std::vector<std::shared_ptr<rosbag2_storage::SerializedBagMessage>> msgs;
+  double max_camera_time = -1;
+  while (reader.has_next()) {
+    auto msg = reader.read_next();
+    if (msg->topic_name == topic_imu) {
+      msgs.push_back(msg);
+    }
+    for (int i = 0; i < params.state_options.num_cameras; i++) {
+      if (msg->topic_name == topic_cameras.at(i)) {
+        msgs.push_back(msg);
+        max_camera_time = std::max(max_camera_time, 1e-9 * (double)msg->time_stamp);
+      }
+    }
+  }
+  PRINT_DEBUG("[SERIAL]: total of %zu messages!\n", msgs.size());
+
+  // Check to make sure we have data to play
+  if (msgs.empty()) {
+    PRINT_ERROR(RED "[SERIAL]: No messages to play on specified topics.  Exiting.\n" RESET);
+    rclcpp::shutdown();
+    return EXIT_FAILURE;
+  }
+
+  // Start a few seconds in from the full bag time
+  // If we have a negative duration then use the full bag length
+  double time_init = 1e-9 * (double)msgs.front()->time_stamp + bag_start;
+  double time_finish = (bag_durr < 0) ? 1e-9 * (double)msgs.back()->time_stamp : time_init + bag_durr;
+  PRINT_DEBUG("time start = %.6f\n", time_init);
+  PRINT_DEBUG("time end   = %.6f\n", time_finish);
+
+  //===================================================================================
+  //===================================================================================
+  //===================================================================================
+
+  // Background prefetcher which deserializes the next messages while the filter consumes the current one
+  // Deserializing an image from its CDR bytes is a large part of the replay time, so we hide it behind the
+  // filter update by staying a bounded number of messages ahead of the main loop below
+  rclcpp::Serialization<sensor_msgs::msg::Imu> serialization_imu;
+  rclcpp::Serialization<sensor_msgs::msg::Image> serialization_img;
+  std::mutex prefetch_mtx;
+  std::condition_variable prefetch_cv;
+  std::map<int, sensor_msgs::msg::Imu::SharedPtr> prefetch_imu;
+  std::map<int, sensor_msgs::msg::Image::SharedPtr> prefetch_img;
+  int prefetch_demand = 0;
+  const int prefetch_window = 64;
+  std::atomic<bool> prefetch_stop(false);
+  std::thread prefetch_thread([&] {
+    ov_core::ThreadRegistry::register_thread("prefetch bag");
+    for (int m = 0; m < (int)msgs.size(); m++) {
+      {
+        std::unique_lock<std::mutex> lck(prefetch_mtx);
+        prefetch_cv.wait(lck, [&] { return m < prefetch_demand + prefetch_window || prefetch_stop; });
+        if (prefetch_stop)
+          return;
+      }
+      rclcpp::SerializedMessage serialized(*msgs.at(m)->serialized_data);
+      if (msgs.at(m)->topic_name == topic_imu) {
+        auto ptr = std::make_shared<sensor_msgs::msg::Imu>();
+        serialization_imu.deserialize_message(&serialized, ptr.get());
+        std::lock_guard<std::mutex> lck(prefetch_mtx);
+        prefetch_imu[m] = ptr;
+        prefetch_cv.notify_all();
+      } else {
+        auto ptr = std::make_shared<sensor_msgs::msg::Image>();
+        serialization_img.deserialize_message(&serialized, ptr.get());
+        std::lock_guard<std::mutex> lck(prefetch_mtx);
+        prefetch_img[m] = ptr;
+        prefetch_cv.notify_all();
+      }
+    }
+  });
+
+  // Helpers which block until the requested message has been deserialized
+  auto get_imu_msg = [&](int m) {
+    std::unique_lock<std::mutex> lck(prefetch_mtx);
+    prefetch_demand = std::max(prefetch_demand, m);
+    prefetch_cv.notify_all();
+    prefetch_cv.wait(lck, [&] { return prefetch_imu.find(m) != prefetch_imu.end(); });
+    sensor_msgs::msg::Imu::SharedPtr ptr = prefetch_imu.at(m);
+    prefetch_imu.erase(m);
+    return ptr;
+  };
+  auto get_image_msg = [&](int m) {
+    std::unique_lock<std::mutex> lck(prefetch_mtx);
+    prefetch_demand = std::max(prefetch_demand, m);
+    prefetch_cv.notify_all();
+    prefetch_cv.wait(lck, [&] { return prefetch_img.find(m) != prefetch_img.end(); });
+    sensor_msgs::msg::Image::SharedPtr ptr = prefetch_img.at(m);
+    prefetch_img.erase(m);
+    return ptr;
+  };
+
+  // Loop through our message array, and lets process them
+  std::set<int> used_index;
+  for (int m = 0; m < (int)msgs.size(); m++) {
+
+    // Let the prefetcher advance, and drop any deserialized messages we have skipped over
+    {
+      std::lock_guard<std::mutex> lck(prefetch_mtx);
+      prefetch_demand = std::max(prefetch_demand, m);
+      prefetch_imu.erase(prefetch_imu.begin(), prefetch_imu.lower_bound(m));
+      prefetch_img.erase(prefetch_img.begin(), prefetch_img.lower_bound(m));
+    }
+    prefetch_cv.notify_all();
+
+    // End once we reach the last time, or skip if before beginning time (shouldn't happen)
+    double msg_time = 1e-9 * (double)msgs.at(m)->time_stamp;
+    if (!rclcpp::ok() || msg_time > time_finish || msg_time > max_camera_time)
+      break;
+    if (msg_time < time_init)
+      continue;
+
+    // Skip messages that we have already used
+    if (used_index.find(m) != used_index.end()) {
+      used_index.erase(m);
+      continue;
+    }
+
+    // IMU processing
+    if (msgs.at(m)->topic_name == topic_imu) {
+      // PRINT_DEBUG("processing imu = %.3f sec\n", msg_time - time_init);
+      viz->callback_inertial(get_imu_msg(m));
+    }
+
+    // Camera processing
+    for (int cam_id = 0; cam_id < params.state_options.num_cameras; cam_id++) {
+
+      // Skip if this message is not a camera topic
+      if (msgs.at(m)->topic_name != topic_cameras.at(cam_id))
+        continue;
+
+      // We have a matching camera topic here, now find the other cameras for this time
+      // For each camera, we will find the nearest timestamp (within 0.02sec) that is greater than the current
+      // If we are unable, then this message should just be skipped since it isn't a sync'ed pair!
+      std::map<int, int> camid_to_msg_index;
+      double meas_time = msg_time;
+      for (int cam_idt = 0; cam_idt < params.state_options.num_cameras; cam_idt++) {
+        if (cam_idt == cam_id) {
+          camid_to_msg_index.insert({cam_id, m});
+          continue;
+        }
+        int cam_idt_idx = -1;
+        for (int mt = m; mt < (int)msgs.size(); mt++) {
+          if (msgs.at(mt)->topic_name != topic_cameras.at(cam_idt))
+            continue;
+          if (std::abs(1e-9 * (double)msgs.at(mt)->time_stamp - meas_time) < 0.02)
+            cam_idt_idx = mt;
+          break;
+        }
+        if (cam_idt_idx != -1) {
+          camid_to_msg_index.insert({cam_idt, cam_idt_idx});
+        }
+      }
+
+      // Skip processing if we were unable to find any messages
+      if ((int)camid_to_msg_index.size() != params.state_options.num_cameras) {
+        PRINT_DEBUG(YELLOW "[SERIAL]: Unable to find stereo pair for message %d at %.2f into bag (will skip!)\n" RESET, m,
+                    meas_time - time_init);
+        continue;
+      }
+
+      // Check if we should initialize using the groundtruth
+      Eigen::Matrix<double, 17, 1> imustate;
+      if (!gt_states.empty() && !sys->initialized() && ov_core::DatasetReader::get_gt_state(meas_time, imustate, gt_states)) {
+        // biases are pretty bad normally, so zero them
+        // imustate.block(11,0,6,1).setZero();
+        sys->initialize_with_gt(imustate);
+      }
+
+      // Pass our data into our visualizer callbacks!
+      // PRINT_DEBUG("processing cam = %.3f sec\n", msg_time - time_init);
+      if (params.state_options.num_cameras == 1) {
+        viz->callback_monocular(get_image_msg(camid_to_msg_index.at(0)), 0);
+      } else if (params.state_options.num_cameras == 2) {
+        used_index.insert(camid_to_msg_index.at(0)); // skip this message
+        used_index.insert(camid_to_msg_index.at(1)); // skip this message
+        viz->callback_stereo(get_image_msg(camid_to_msg_index.at(0)), get_image_msg(camid_to_msg_index.at(1)), 0, 1);
+      } else {
+        PRINT_ERROR(RED "[SERIAL]: We currently only support 1 or 2 camera serial input....\n" RESET);
+        return EXIT_FAILURE;
+      }
+
+      break;
+    }
+  }
+
+  // Shut down the prefetcher (it may be waiting for the consumer to advance)
+  {
+    std::lock_guard<std::mutex> lck(prefetch_mtx);
+    prefetch_stop = true;
+  }
+  prefetch_cv.notify_all();
+  prefetch_thread.join();
+
+  // Final visualization
+  viz->visualize_final();
+  rclcpp::shutdown();
+
+  // Done!
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,262 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2018-2023 Patrick Geneva
+ * Copyright (C) 2018-2023 Guoquan Huang
+ * Copyright (C) 2018-2023 OpenVINS Contributors
+ * Copyright (C) 2018-2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cmath>
+#include <csignal>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "core/VioManager.h"
+#include "sim/Simulator.h"
+#include "state/State.h"
+#include "utils/colors.h"
+#include "utils/print.h"
+#include "utils/sensor_data.h"
+
+using namespace ov_msckf;
+
+// Define the function to be called when ctrl-c (SIGINT) is sent to process
+void signal_callback_handler(int signum) { std::exit(signum); }
+
+/**
+ * Runs one full simulation with the given parameters and writes the estimated
+ * and groundtruth trajectories (time(s), p_IinG, q_GtoI) plus the final
+ * position RMSE into the output directory. Returns false on failure.
+ */
+bool run_one_realization(VioManagerOptions params, int runid, const std::string &output_dir) {
+
+  // Create the simulator (this will load the precomputed measurement cache) and our VIO system
+  auto sim = std::make_shared<Simulator>(params);
+  auto sys = std::make_shared<VioManager>(params);
+
+  // Get initial state
+  // NOTE: we are getting it at the *next* timestep so we get the first IMU message
+  double next_imu_time = sim->current_timestamp() + 1.0 / params.sim_freq_imu;
+  Eigen::Matrix<double, 17, 1> imustate;
+  if (!sim->get_state(next_imu_time, imustate)) {
+    PRINT_ERROR(RED "[SIM]: Could not initialize the filter to the first state\n" RESET);
+    return false;
+  }
+
+  // Since the state time is in the camera frame of reference
+  // Subtract out the imu to camera time offset
+  imustate(0, 0) -= sim->get_true_parameters().calib_camimu_dt;
+  sys->initialize_with_gt(imustate);
+
+  // Open our trajectory output files
+  std::stringstream ss_est, ss_gt;
+  ss_est << output_dir << "/run" << std::setfill('0') << std::setw(2) << runid << "_est.txt";
+  ss_gt << output_dir << "/run" << std::setfill('0') << std::setw(2) << runid << "_gt.txt";
+  std::ofstream of_est(ss_est.str()), of_gt(ss_gt.str());
+  if (!of_est.is_open() || !of_gt.is_open()) {
+    PRINT_ERROR(RED "[SIM]: unable to open trajectory output files in %s\n" RESET, output_dir.c_str());
+    return false;
+  }
+  of_est << "# timestamp(s) tx ty tz qx qy qz qw" << std::endl;
+  of_gt << "# timestamp(s) tx ty tz qx qy qz qw" << std::endl;
+  of_est << std::setprecision(9) << std::fixed;
+  of_gt << std::setprecision(9) << std::fixed;
+
+  // Buffer our camera measurement (uvs are moved along, never copied)
+  bool buffer_hascam = false;
+  ov_core::SimCameraData buffer_cam;
+
+  // Running position error statistics
+  double sum_sq_error = 0.0;
+  size_t num_poses = 0;
+
+  // Step through the simulation
+  while (sim->ok()) {
+
+    // IMU: get the next simulated IMU measurement if we have it
+    ov_core::ImuData message_imu;
+    bool hasimu = sim->get_next_imu(message_imu.timestamp, message_imu.wm, message_imu.am);
+    if (hasimu) {
+      sys->feed_measurement_imu(message_imu);
+    }
+
+    // CAM: get the next simulated camera uv measurements if we have them
+    ov_core::SimCameraData message_cam;
+    bool hascam = sim->get_next_cam(message_cam);
+    if (hascam) {
+      if (buffer_hascam) {
+        sys->feed_measurement_simulation(buffer_cam);
+
+        // Record the estimate and its groundtruth after each update
+        Eigen::Matrix<double, 17, 1> gtstate;
+        if (sys->initialized() && sim->get_state(buffer_cam.timestamp + sim->get_true_parameters().calib_camimu_dt, gtstate)) {
+          Eigen::Vector4d q_est = sys->get_state()->_imu->quat();
+          Eigen::Vector3d p_est = sys->get_state()->_imu->pos();
+          of_est << buffer_cam.timestamp << " " << p_est(0) << " " << p_est(1) << " " << p_est(2) << " " << q_est(0) << " " << q_est(1)
+                 << " " << q_est(2) << " " << q_est(3) << std::endl;
+          of_gt << buffer_cam.timestamp << " " << gtstate(5) << " " << gtstate(6) << " " << gtstate(7) << " " << gtstate(1) << " "
+                << gtstate(2) << " " << gtstate(3) << " " << gtstate(4) << std::endl;
+          sum_sq_error += (p_est - gtstate.block(5, 0, 3, 1)).squaredNorm();
+          num_poses++;
+        }
+      }
+      buffer_hascam = true;
+      buffer_cam = std::move(message_cam);
+    }
+  }
+  of_est.close();
+  of_gt.close();
+
+  // Write the summary for this realization so the parent can aggregate
+  if (num_poses < 1) {
+    PRINT_ERROR(RED "[SIM]: run %d recorded no poses, did the filter diverge on startup?\n" RESET, runid);
+    return false;
+  }
+  double rmse = std::sqrt(sum_sq_error / (double)num_poses);
+  std::stringstream ss_rmse;
+  ss_rmse << output_dir << "/run" << std::setfill('0') << std::setw(2) << runid << "_rmse.txt";
+  std::ofstream of_rmse(ss_rmse.str());
+  of_rmse << std::setprecision(9) << rmse << " " << num_poses << std::endl;
+  of_rmse.close();
+  return true;
+}
+
+// Main function
+int main(int argc, char **argv) {
+
+  // Register failure handler
+  signal(SIGINT, signal_callback_handler);
+
+  // Ensure we have the arguments we need
+  if (argc < 4) {
+    PRINT_ERROR(RED "ERROR: please specify the config, number of runs, and output directory\n" RESET);
+    PRINT_ERROR(RED "ERROR: ./run_sim_batch <config.yaml> <num_runs> <output_dir> [max_parallel]\n" RESET);
+    return EXIT_FAILURE;
+  }
+  std::string config_path = argv[1];
+  int num_runs = std::atoi(argv[2]);
+  std::string output_dir = argv[3];
+  int max_parallel = (argc > 4) ? std::atoi(argv[4]) : (int)std::thread::hardware_concurrency();
+  max_parallel = std::max(1, max_parallel);
+  mkdir(output_dir.c_str(), 0777);
+
+  // Load the config
+  auto parser = std::make_shared<ov_core::YamlParser>(config_path);
+
+  // Verbosity
+  std::string verbosity = "INFO";
+  parser->parse_config("verbosity", verbosity);
+  ov_core::Printer::setPrintLevel(verbosity);
+
+  // Load our simulation parameters
+  VioManagerOptions params;
+  params.print_and_load(parser);
+  params.print_and_load_simulation(parser);
+  params.num_opencv_threads = 0; // for repeatability
+  params.use_multi_threading_pubs = false;
+  params.use_multi_threading_subs = false;
+  if (!parser->successful()) {
+    PRINT_ERROR(RED "unable to parse all parameters, please fix\n" RESET);
+    return EXIT_FAILURE;
+  }
+
+  // All realizations share the same noiseless measurements, so have them load
+  // from a common cache file (unless the user already configured one)
+  if (params.sim_precache_path.empty()) {
+    params.sim_precache_path = output_dir + "/sim_precache.bin";
+  }
+
+  // Phase one: build the cache by constructing a throwaway simulator
+  // Every worker then starts by loading the file instead of re-projecting the map
+  PRINT_INFO("[SIM]: precomputing noiseless measurements for %d runs...\n", num_runs);
+  { Simulator sim_precompute(params); }
+
+  // Phase two: replay the noise realizations in parallel worker processes
+  PRINT_INFO("[SIM]: launching %d runs (%d in parallel)...\n", num_runs, max_parallel);
+  std::vector<pid_t> pids;
+  int num_active = 0;
+  int num_failed = 0;
+  for (int r = 0; r < num_runs; r++) {
+
+    // Throttle to the requested number of simultaneous workers
+    while (num_active >= max_parallel) {
+      int status = 0;
+      if (waitpid(-1, &status, 0) > 0) {
+        num_active--;
+        num_failed += (!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS);
+      }
+    }
+
+    // Fork a worker which runs this noise realization
+    pid_t pid = fork();
+    if (pid < 0) {
+      PRINT_ERROR(RED "[SIM]: unable to fork worker process\n" RESET);
+      return EXIT_FAILURE;
+    }
+    if (pid == 0) {
+      // Child: only print warnings so the parallel output stays readable
+      ov_core::Printer::setPrintLevel("WARNING");
+      VioManagerOptions params_run = params;
+      params_run.sim_seed_measurements = params.sim_seed_measurements + r;
+      bool success = run_one_realization(params_run, r, output_dir);
+      _exit(success ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+    pids.push_back(pid);
+    num_active++;
+  }
+
+  // Wait for the remaining workers
+  while (num_active > 0) {
+    int status = 0;
+    if (waitpid(-1, &status, 0) > 0) {
+      num_active--;
+      num_failed += (!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS);
+    }
+  }
+
+  // Aggregate the per-run position RMSE values
+  double sum = 0.0, sum_sq = 0.0;
+  int num_valid = 0;
+  for (int r = 0; r < num_runs; r++) {
+    std::stringstream ss_rmse;
+    ss_rmse << output_dir << "/run" << std::setfill('0') << std::setw(2) << r << "_rmse.txt";
+    std::ifstream of_rmse(ss_rmse.str());
+    double rmse = 0.0;
+    if (of_rmse >> rmse) {
+      PRINT_INFO("[SIM]: run %02d position rmse = %.4f (m)\n", r, rmse);
+      sum += rmse;
+      sum_sq += rmse * rmse;
+      num_valid++;
+    } else {
+      PRINT_WARNING(YELLOW "[SIM]: run %02d produced no summary\n" RESET, r);
+    }
+  }
+  if (num_valid > 0) {
+    double mean = sum / num_valid;
+    double std = std::sqrt(std::max(0.0, sum_sq / num_valid - mean * mean));
+    PRINT_INFO("[SIM]: %d/%d runs ok | position rmse mean = %.4f +- %.4f (m)\n", num_valid, num_runs, mean, std);
+  }
+  PRINT_INFO("[SIM]: trajectory files are in %s\n", output_dir.c_str());
+  return (num_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -134,10 +134,9 @@ int main(int argc, char **argv) {
   //===================================================================================
   //===================================================================================
 
-  // Buffer our camera image
-  double buffer_timecam = -1;
-  std::vector<int> buffer_camids;
-  std::vector<std::vector<std::pair<size_t, Eigen::VectorXf>>> buffer_feats;
+  // Buffer our camera measurement (uvs are moved along, never copied)
+  bool buffer_hascam = false;
+  ov_core::SimCameraData buffer_cam;
 
   // Step through the rosbag
 #if ROS_AVAILABLE == 1
@@ -160,20 +159,17 @@ int main(int argc, char **argv) {
     }
 
     // CAM: get the next simulated camera uv measurements if we have them
-    double time_cam;
-    std::vector<int> camids;
-    std::vector<std::vector<std::pair<size_t, Eigen::VectorXf>>> feats;
-    bool hascam = sim->get_next_cam(time_cam, camids, feats);
+    ov_core::SimCameraData message_cam;
+    bool hascam = sim->get_next_cam(message_cam);
     if (hascam) {
-      if (buffer_timecam != -1) {
-        sys->feed_measurement_simulation(buffer_timecam, buffer_camids, buffer_feats);
+      if (buffer_hascam) {
+        sys->feed_measurement_simulation(buffer_cam);
 #if ROS_AVAILABLE == 1 || ROS_AVAILABLE == 2
         viz->visualize();
 #endif
       }
-      buffer_timecam = time_cam;
-      buffer_camids = camids;
-      buffer_feats = feats;
+      buffer_hascam = true;
+      buffer_cam = std::move(message_cam);
     }
   }
 
@@ -21,6 +21,11 @@
 
 #include "Simulator.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+
 #include "cam/CamBase.h"
 #include "cam/CamEqui.h"
 #include "cam/CamRadtan.h"
@@ -32,6 +37,55 @@
 using namespace ov_core;
 using namespace ov_msckf;
 
+
+namespace {
+
+// Cache file magic/version, bump the version when the binary layout changes
+const uint32_t PRECACHE_MAGIC = 0x4f565043; // "OVPC"
+const uint32_t PRECACHE_VERSION = 1;
+
+// Raw binary read/write of plain-old-data values
+template <typename T> void write_pod(std::ofstream &file, const T &value) { file.write((const char *)&value, sizeof(T)); }
+template <typename T> bool read_pod(std::ifstream &file, T &value) {
+  file.read((char *)&value, sizeof(T));
+  return file.good();
+}
+
+// All parameters the noiseless measurements depend on, flattened to doubles
+// A cache file is only valid if every entry matches the current simulation exactly
+std::vector<double> precache_fingerprint(const ov_msckf::VioManagerOptions &params, const std::vector<Eigen::VectorXd> &traj_data) {
+  std::vector<double> fingerprint;
+  fingerprint.push_back((double)params.state_options.num_cameras);
+  fingerprint.push_back((double)params.num_pts);
+  fingerprint.push_back((double)params.use_stereo);
+  fingerprint.push_back((double)params.sim_seed_state_init);
+  fingerprint.push_back(params.sim_freq_cam);
+  fingerprint.push_back(params.sim_distance_threshold);
+  fingerprint.push_back(params.sim_min_feature_gen_distance);
+  fingerprint.push_back(params.sim_max_feature_gen_distance);
+  fingerprint.push_back((double)params.sim_use_ground_plane_features);
+  fingerprint.push_back(params.sim_ground_plane_features_range);
+  fingerprint.push_back((double)traj_data.size());
+  if (!traj_data.empty()) {
+    fingerprint.push_back(traj_data.front()(0));
+    fingerprint.push_back(traj_data.back()(0));
+  }
+  for (int i = 0; i < params.state_options.num_cameras; i++) {
+    fingerprint.push_back((double)params.camera_intrinsics.at(i)->w());
+    fingerprint.push_back((double)params.camera_intrinsics.at(i)->h());
+    Eigen::MatrixXd intrinsics = params.camera_intrinsics.at(i)->get_value();
+    for (int r = 0; r < (int)intrinsics.rows(); r++) {
+      fingerprint.push_back(intrinsics(r));
+    }
+    for (int r = 0; r < (int)params.camera_extrinsics.at(i).rows(); r++) {
+      fingerprint.push_back(params.camera_extrinsics.at(i)(r));
+    }
+  }
+  return fingerprint;
+}
+
+} // namespace
+
 Simulator::Simulator(VioManagerOptions &params_) {
 
   //===============================================================
@@ -126,17 +180,15 @@ Simulator::Simulator(VioManagerOptions &params_) {
   //===============================================================
 
   // Load the seeds for the random number generators
-  gen_state_init = std::mt19937(params.sim_seed_state_init);
-  gen_state_init.seed(params.sim_seed_state_init);
-  gen_state_perturb = std::mt19937(params.sim_seed_preturb);
-  gen_state_perturb.seed(params.sim_seed_preturb);
-  gen_meas_imu = std::mt19937(params.sim_seed_measurements);
-  gen_meas_imu.seed(params.sim_seed_measurements);
-
-  // Create generator for our camera
+  // Each purpose gets its own counter-based stream, so any draw is a pure function of
+  // (seed, stream, counter) and the measurement noise can be generated out of order
+  gen_state_init = ov_core::CounterRNG(params.sim_seed_state_init, 0);
+  gen_state_perturb = ov_core::CounterRNG(params.sim_seed_preturb, 1);
+  gen_meas_imu = ov_core::CounterRNG(params.sim_seed_measurements, 2);
+
+  // Create generator for our camera (stream is offset by the fixed sensor streams above)
   for (int i = 0; i < params.state_options.num_cameras; i++) {
-    gen_meas_cams.push_back(std::mt19937(params.sim_seed_measurements));
-    gen_meas_cams.at(i).seed(params.sim_seed_measurements);
+    gen_meas_cams.push_back(ov_core::CounterRNG(params.sim_seed_measurements, 3 + i));
   }
 
   //===============================================================
@@ -159,60 +211,70 @@ Simulator::Simulator(VioManagerOptions &params_) {
   //===============================================================
   //===============================================================
 
+  // Try to load the noiseless measurement cache if the user has specified one
+  // This skips both the feature map generation and the per-frame projections below
+  bool cache_loaded = !params.sim_precache_path.empty() && load_precache(params.sim_precache_path);
+
   // We will create synthetic camera frames and ensure that each has enough features
   // double dt = 0.25/freq_cam;
   double dt = 0.25;
   size_t mapsize = featmap.size();
-  PRINT_DEBUG("[SIM]: Generating map features at %d rate\n", (int)(1.0 / dt));
-
-  // Loop through each camera
-  // NOTE: we loop through cameras here so that the feature map for camera 1 will always be the same
-  // NOTE: thus when we add more cameras the first camera should get the same measurements
-  for (int i = 0; i < params.state_options.num_cameras; i++) {
-
-    // Reset the start time
-    double time_synth = spline->get_start_time();
-
-    // Loop through each pose and generate our feature map in them!!!!
-    while (true) {
-
-      // Get the pose at the current timestep
-      Eigen::Matrix3d R_GtoI;
-      Eigen::Vector3d p_IinG;
-      bool success_pose = spline->get_pose(time_synth, R_GtoI, p_IinG);
-
-      // We have finished generating features
-      if (!success_pose)
-        break;
-
-      // Get the uv features for this frame
-      std::vector<std::pair<size_t, Eigen::VectorXf>> uvs = project_pointcloud(R_GtoI, p_IinG, i, featmap);
-      // If we do not have enough, generate more
-      if ((int)uvs.size() < params.num_pts) {
-        generate_points(R_GtoI, p_IinG, i, featmap, params.num_pts - (int)uvs.size());
+  if (!cache_loaded) {
+    PRINT_DEBUG("[SIM]: Generating map features at %d rate\n", (int)(1.0 / dt));
+
+    // Loop through each camera
+    // NOTE: we loop through cameras here so that the feature map for camera 1 will always be the same
+    // NOTE: thus when we add more cameras the first camera should get the same measurements
+    for (int i = 0; i < params.state_options.num_cameras; i++) {
+
+      // Reset the start time
+      double time_synth = spline->get_start_time();
+
+      // Loop through each pose and generate our feature map in them!!!!
+      while (true) {
+
+        // Get the pose at the current timestep
+        Eigen::Matrix3d R_GtoI;
+        Eigen::Vector3d p_IinG;
+        bool success_pose = spline->get_pose(time_synth, R_GtoI, p_IinG);
+
+        // We have finished generating features
+        if (!success_pose)
+          break;
+
+        // Get the uv features for this frame
+        std::vector<std::pair<size_t, Eigen::VectorXf>> uvs = project_pointcloud(R_GtoI, p_IinG, i, featmap);
+        // If we do not have enough, generate more
+        if ((int)uvs.size() < params.num_pts) {
+          generate_points(R_GtoI, p_IinG, i, featmap, params.num_pts - (int)uvs.size());
+        }
+
+        // Move forward in time
+        time_synth += dt;
       }
 
-      // Move forward in time
-      time_synth += dt;
+      // Debug print
+      PRINT_DEBUG("[SIM]: Generated %d map features in total over %d frames (camera %d)\n", (int)(featmap.size() - mapsize),
+                  (int)((time_synth - spline->get_start_time()) / dt), i);
+      mapsize = featmap.size();
     }
 
-    // Debug print
-    PRINT_DEBUG("[SIM]: Generated %d map features in total over %d frames (camera %d)\n", (int)(featmap.size() - mapsize),
-                (int)((time_synth - spline->get_start_time()) / dt), i);
-    mapsize = featmap.size();
+    // If caching was requested, precompute the noiseless projections and save them for later runs
+    if (!params.sim_precache_path.empty()) {
+      precompute_projections();
+      save_precache(params.sim_precache_path);
+    }
   }
+  use_precache = !cache_cam_times.empty();
 
   // Nice sleep so the user can look at the printout
   sleep(1);
 }
 
-void Simulator::perturb_parameters(std::mt19937 gen_state, VioManagerOptions &params_) {
-
-  // One std generator
-  std::normal_distribution<double> w(0, 1);
+void Simulator::perturb_parameters(ov_core::CounterRNG gen_state, VioManagerOptions &params_) {
 
   // Camera IMU offset
-  params_.calib_camimu_dt += 0.01 * w(gen_state);
+  params_.calib_camimu_dt += 0.01 * gen_state.normal();
 
   // Camera intrinsics and extrinsics
   for (int i = 0; i < params_.state_options.num_cameras; i++) {
@@ -220,38 +282,38 @@ void Simulator::perturb_parameters(std::mt19937 gen_state, VioManagerOptions &pa
     // Camera intrinsic properties (k1, k2, p1, p2, r1, r2, r3, r4)
     Eigen::MatrixXd intrinsics = params_.camera_intrinsics.at(i)->get_value();
     for (int r = 0; r < 4; r++) {
-      intrinsics(r) += 1.0 * w(gen_state);
+      intrinsics(r) += 1.0 * gen_state.normal();
     }
     for (int r = 4; r < 8; r++) {
-      intrinsics(r) += 0.005 * w(gen_state);
+      intrinsics(r) += 0.005 * gen_state.normal();
     }
     params_.camera_intrinsics.at(i)->set_value(intrinsics);
 
     // Our camera extrinsics transform (orientation)
     Eigen::Vector3d w_vec;
-    w_vec << 0.001 * w(gen_state), 0.001 * w(gen_state), 0.001 * w(gen_state);
+    w_vec << 0.001 * gen_state.normal(), 0.001 * gen_state.normal(), 0.001 * gen_state.normal();
     params_.camera_extrinsics.at(i).block(0, 0, 4, 1) =
         rot_2_quat(exp_so3(w_vec) * quat_2_Rot(params_.camera_extrinsics.at(i).block(0, 0, 4, 1)));
 
     // Our camera extrinsics transform (position)
     for (int r = 4; r < 7; r++) {
-      params_.camera_extrinsics.at(i)(r) += 0.01 * w(gen_state);
+      params_.camera_extrinsics.at(i)(r) += 0.01 * gen_state.normal();
     }
   }
 
   // If we need to perturb the imu intrinsics
   if (params_.state_options.do_calib_imu_intrinsics) {
     for (int j = 0; j < 6; j++) {
-      params_.vec_dw(j) += 0.004 * w(gen_state);
-      params_.vec_da(j) += 0.004 * w(gen_state);
+      params_.vec_dw(j) += 0.004 * gen_state.normal();
+      params_.vec_da(j) += 0.004 * gen_state.normal();
     }
     if (params_.state_options.imu_model == StateOptions::ImuModel::KALIBR) {
       Eigen::Vector3d w_vec;
-      w_vec << 0.002 * w(gen_state), 0.002 * w(gen_state), 0.002 * w(gen_state);
+      w_vec << 0.002 * gen_state.normal(), 0.002 * gen_state.normal(), 0.002 * gen_state.normal();
       params_.q_GYROtoIMU = rot_2_quat(exp_so3(w_vec) * quat_2_Rot(params_.q_GYROtoIMU));
     } else {
       Eigen::Vector3d w_vec;
-      w_vec << 0.002 * w(gen_state), 0.002 * w(gen_state), 0.002 * w(gen_state);
+      w_vec << 0.002 * gen_state.normal(), 0.002 * gen_state.normal(), 0.002 * gen_state.normal();
       params_.q_ACCtoIMU = rot_2_quat(exp_so3(w_vec) * quat_2_Rot(params_.q_ACCtoIMU));
     }
   }
@@ -259,7 +321,7 @@ void Simulator::perturb_parameters(std::mt19937 gen_state, VioManagerOptions &pa
   // If we need to perturb gravity sensitivity
   if (params_.state_options.do_calib_imu_g_sensitivity) {
     for (int j = 0; j < 9; j++) {
-      params_.vec_tg(j) += 0.004 * w(gen_state);
+      params_.vec_tg(j) += 0.004 * gen_state.normal();
     }
   }
 }
@@ -357,17 +419,19 @@ bool Simulator::get_next_imu(double &time_imu, Eigen::Vector3d &wm, Eigen::Vecto
 
   // Calculate the bias values for this IMU reading
   // NOTE: we skip the first ever bias since we have already appended it
+  // NOTE: the noise draws are keyed by this reading's timestamp, so they do not
+  // NOTE: depend on how many readings (or which threads) came before this one
   double dt = 1.0 / params.sim_freq_imu;
-  std::normal_distribution<double> w(0, 1);
+  gen_meas_imu.seek_time(timestamp_last_imu);
   if (has_skipped_first_bias) {
 
     // Move the biases forward in time
-    true_bias_gyro(0) += params.imu_noises.sigma_wb * std::sqrt(dt) * w(gen_meas_imu);
-    true_bias_gyro(1) += params.imu_noises.sigma_wb * std::sqrt(dt) * w(gen_meas_imu);
-    true_bias_gyro(2) += params.imu_noises.sigma_wb * std::sqrt(dt) * w(gen_meas_imu);
-    true_bias_accel(0) += params.imu_noises.sigma_ab * std::sqrt(dt) * w(gen_meas_imu);
-    true_bias_accel(1) += params.imu_noises.sigma_ab * std::sqrt(dt) * w(gen_meas_imu);
-    true_bias_accel(2) += params.imu_noises.sigma_ab * std::sqrt(dt) * w(gen_meas_imu);
+    true_bias_gyro(0) += params.imu_noises.sigma_wb * std::sqrt(dt) * gen_meas_imu.normal();
+    true_bias_gyro(1) += params.imu_noises.sigma_wb * std::sqrt(dt) * gen_meas_imu.normal();
+    true_bias_gyro(2) += params.imu_noises.sigma_wb * std::sqrt(dt) * gen_meas_imu.normal();
+    true_bias_accel(0) += params.imu_noises.sigma_ab * std::sqrt(dt) * gen_meas_imu.normal();
+    true_bias_accel(1) += params.imu_noises.sigma_ab * std::sqrt(dt) * gen_meas_imu.normal();
+    true_bias_accel(2) += params.imu_noises.sigma_ab * std::sqrt(dt) * gen_meas_imu.normal();
 
     // Append the current true bias to our history
     hist_true_bias_time.push_back(timestamp_last_imu);
@@ -377,12 +441,12 @@ bool Simulator::get_next_imu(double &time_imu, Eigen::Vector3d &wm, Eigen::Vecto
   has_skipped_first_bias = true;
 
   // Now add noise to these measurements
-  wm(0) = omega_inGYRO(0) + true_bias_gyro(0) + params.imu_noises.sigma_w / std::sqrt(dt) * w(gen_meas_imu);
-  wm(1) = omega_inGYRO(1) + true_bias_gyro(1) + params.imu_noises.sigma_w / std::sqrt(dt) * w(gen_meas_imu);
-  wm(2) = omega_inGYRO(2) + true_bias_gyro(2) + params.imu_noises.sigma_w / std::sqrt(dt) * w(gen_meas_imu);
-  am(0) = accel_inACC(0) + true_bias_accel(0) + params.imu_noises.sigma_a / std::sqrt(dt) * w(gen_meas_imu);
-  am(1) = accel_inACC(1) + true_bias_accel(1) + params.imu_noises.sigma_a / std::sqrt(dt) * w(gen_meas_imu);
-  am(2) = accel_inACC(2) + true_bias_accel(2) + params.imu_noises.sigma_a / std::sqrt(dt) * w(gen_meas_imu);
+  wm(0) = omega_inGYRO(0) + true_bias_gyro(0) + params.imu_noises.sigma_w / std::sqrt(dt) * gen_meas_imu.normal();
+  wm(1) = omega_inGYRO(1) + true_bias_gyro(1) + params.imu_noises.sigma_w / std::sqrt(dt) * gen_meas_imu.normal();
+  wm(2) = omega_inGYRO(2) + true_bias_gyro(2) + params.imu_noises.sigma_w / std::sqrt(dt) * gen_meas_imu.normal();
+  am(0) = accel_inACC(0) + true_bias_accel(0) + params.imu_noises.sigma_a / std::sqrt(dt) * gen_meas_imu.normal();
+  am(1) = accel_inACC(1) + true_bias_accel(1) + params.imu_noises.sigma_a / std::sqrt(dt) * gen_meas_imu.normal();
+  am(2) = accel_inACC(2) + true_bias_accel(2) + params.imu_noises.sigma_a / std::sqrt(dt) * gen_meas_imu.normal();
 
   // Return success
   return true;
@@ -400,22 +464,46 @@ bool Simulator::get_next_cam(double &time_cam, std::vector<int> &camids,
   timestamp = timestamp_last_cam;
   time_cam = timestamp_last_cam - params.calib_camimu_dt;
 
-  // Get the pose at the current timestep
-  Eigen::Matrix3d R_GtoI;
-  Eigen::Vector3d p_IinG;
-  bool success_pose = spline->get_pose(timestamp, R_GtoI, p_IinG);
+  // Get the noiseless projections for this frame (either cached or projected now)
+  std::vector<std::vector<std::pair<size_t, Eigen::VectorXf>>> uvs_allcams;
+  if (use_precache) {
 
-  // We have finished generating measurements
-  if (!success_pose) {
-    is_running = false;
-    return false;
+    // We have finished generating measurements
+    if (index_cam_frame >= cache_cam_times.size()) {
+      is_running = false;
+      return false;
+    }
+
+    // Grab the cached frame (the cache replays the exact stepping of this function)
+    // Each frame is consumed exactly once, so we can move it out instead of copying
+    assert(cache_cam_times.at(index_cam_frame) == timestamp_last_cam);
+    uvs_allcams = std::move(cache_cam_feats.at(index_cam_frame));
+    index_cam_frame++;
+
+  } else {
+
+    // Get the pose at the current timestep
+    Eigen::Matrix3d R_GtoI;
+    Eigen::Vector3d p_IinG;
+    bool success_pose = spline->get_pose(timestamp, R_GtoI, p_IinG);
+
+    // We have finished generating measurements
+    if (!success_pose) {
+      is_running = false;
+      return false;
+    }
+
+    // Project the feature map into each camera
+    for (int i = 0; i < params.state_options.num_cameras; i++) {
+      uvs_allcams.push_back(project_pointcloud(R_GtoI, p_IinG, i, featmap));
+    }
   }
 
   // Loop through each camera
   for (int i = 0; i < params.state_options.num_cameras; i++) {
 
     // Get the uv features for this frame
-    std::vector<std::pair<size_t, Eigen::VectorXf>> uvs = project_pointcloud(R_GtoI, p_IinG, i, featmap);
+    std::vector<std::pair<size_t, Eigen::VectorXf>> uvs = std::move(uvs_allcams.at(i));
 
     // If we do not have enough, generate more
     if ((int)uvs.size() < params.num_pts) {
@@ -435,14 +523,16 @@ bool Simulator::get_next_cam(double &time_cam, std::vector<int> &camids,
     }
 
     // Loop through and add noise to each uv measurement
-    std::normal_distribution<double> w(0, 1);
+    // The draws are keyed by this frame's timestamp, so each frame's noise is
+    // independent of every other frame and can be generated in parallel
+    gen_meas_cams.at(i).seek_time(timestamp_last_cam);
     for (size_t j = 0; j < uvs.size(); j++) {
-      uvs.at(j).second(0) += params.msckf_options.sigma_pix * w(gen_meas_cams.at(i));
-      uvs.at(j).second(1) += params.msckf_options.sigma_pix * w(gen_meas_cams.at(i));
+      uvs.at(j).second(0) += params.msckf_options.sigma_pix * gen_meas_cams.at(i).normal();
+      uvs.at(j).second(1) += params.msckf_options.sigma_pix * gen_meas_cams.at(i).normal();
     }
 
     // Push back for this camera
-    feats.push_back(uvs);
+    feats.push_back(std::move(uvs));
     camids.push_back(i);
   }
 
@@ -464,40 +554,128 @@ std::vector<std::pair<size_t, Eigen::VectorXf>> Simulator::project_pointcloud(co
   Eigen::Matrix<double, 3, 1> p_IinC = params.camera_extrinsics.at(camid).block(4, 0, 3, 1);
   std::shared_ptr<ov_core::CamBase> camera = params.camera_intrinsics.at(camid);
 
-  // Our projected uv true measurements
-  std::vector<std::pair<size_t, Eigen::VectorXf>> uvs;
-
-  // Loop through our map
-  for (const auto &feat : feats) {
+  // Refresh the contiguous mirror of the map if features were added since last call
+  // Note the map only ever grows, and for a fixed size its iteration order is stable,
+  // thus the batched path visits features in the same order the scalar loop would have
+  if (feats.size() != featmap_ids.size()) {
+    featmap_ids.clear();
+    featmap_ids.reserve(feats.size());
+    featmap_pts.resize(3, (Eigen::Index)feats.size());
+    Eigen::Index n = 0;
+    for (const auto &feat : feats) {
+      featmap_ids.push_back(feat.first);
+      featmap_pts.col(n++) = feat.second;
+    }
+    // Also re-bin every feature into the uniform spatial grid
+    // A cell the size of the max generation distance keeps the query cube at 27 cells
+    featmap_grid_cell = params.sim_max_feature_gen_distance;
+    featmap_grid.clear();
+    for (Eigen::Index m = 0; m < featmap_pts.cols(); m++) {
+      int64_t cx = (int64_t)std::floor(featmap_pts(0, m) / featmap_grid_cell);
+      int64_t cy = (int64_t)std::floor(featmap_pts(1, m) / featmap_grid_cell);
+      int64_t cz = (int64_t)std::floor(featmap_pts(2, m) / featmap_grid_cell);
+      featmap_grid[featmap_grid_key(cx, cy, cz)].push_back((int)m);
+    }
+  }
 
-    // Transform feature into current camera frame
-    Eigen::Vector3d p_FinI = R_GtoI * (feat.second - p_IinG);
-    Eigen::Vector3d p_FinC = R_ItoC * p_FinI + p_IinC;
+  // Fold the extrinsic and pose into a single global-to-camera transform
+  // p_FinC = R_ItoC * (R_GtoI * (p_FinG - p_IinG)) + p_IinC, with R and p folded together
+  Eigen::Matrix3d R_GtoC = R_ItoC * R_GtoI;
+  Eigen::Vector3d p_GinC = p_IinC - R_GtoC * p_IinG;
+
+  // Gather the columns that could possibly land in the image from the grid cells near the
+  // camera, so the per-frame cost scales with the local feature density and not the map size
+  // The cull radius is conservative, thus only points the depth check would reject are skipped
+  // Ground plane maps have no depth cull to mirror, so they keep visiting the whole map
+  std::vector<int> candidates;
+  Eigen::Matrix<double, 3, Eigen::Dynamic> pts_inC;
+  if (!params.sim_use_ground_plane_features) {
+    Eigen::Vector3d p_CinG = -R_GtoC.transpose() * p_GinC;
+    int64_t range = (int64_t)std::ceil(featmap_cull_radius(camid) / featmap_grid_cell);
+    int64_t cx = (int64_t)std::floor(p_CinG(0) / featmap_grid_cell);
+    int64_t cy = (int64_t)std::floor(p_CinG(1) / featmap_grid_cell);
+    int64_t cz = (int64_t)std::floor(p_CinG(2) / featmap_grid_cell);
+    for (int64_t dx = -range; dx <= range; dx++) {
+      for (int64_t dy = -range; dy <= range; dy++) {
+        for (int64_t dz = -range; dz <= range; dz++) {
+          auto cell = featmap_grid.find(featmap_grid_key(cx + dx, cy + dy, cz + dz));
+          if (cell != featmap_grid.end())
+            candidates.insert(candidates.end(), cell->second.begin(), cell->second.end());
+        }
+      }
+    }
+    // Restore the map iteration order so the output ordering is unchanged
+    std::sort(candidates.begin(), candidates.end());
+    Eigen::Matrix<double, 3, Eigen::Dynamic> pts_cand(3, (Eigen::Index)candidates.size());
+    for (size_t n = 0; n < candidates.size(); n++)
+      pts_cand.col((Eigen::Index)n) = featmap_pts.col(candidates.at(n));
+    pts_inC = (R_GtoC * pts_cand).colwise() + p_GinC;
+  } else {
+    candidates.resize((size_t)featmap_pts.cols());
+    std::iota(candidates.begin(), candidates.end(), 0);
+    pts_inC = (R_GtoC * featmap_pts).colwise() + p_GinC;
+  }
 
-    // Skip cloud if too far away
-    if (!params.sim_use_ground_plane_features && (p_FinC(2) > params.sim_max_feature_gen_distance || p_FinC(2) < 0.1))
+  // Depth cull, then collect the normalized coordinates of the survivors
+  std::vector<size_t> ids_valid;
+  std::vector<Eigen::Vector2f> pts_norm, pts_dist;
+  ids_valid.reserve(candidates.size());
+  pts_norm.reserve(candidates.size());
+  for (Eigen::Index n = 0; n < pts_inC.cols(); n++) {
+    double depth = pts_inC(2, n);
+    if (!params.sim_use_ground_plane_features && (depth > params.sim_max_feature_gen_distance || depth < 0.1))
       continue;
+    ids_valid.push_back(featmap_ids.at((size_t)candidates.at((size_t)n)));
+    pts_norm.emplace_back((float)(pts_inC(0, n) / depth), (float)(pts_inC(1, n) / depth));
+  }
 
-    // Project to normalized coordinates
-    Eigen::Vector2f uv_norm;
-    uv_norm << (float)(p_FinC(0) / p_FinC(2)), (float)(p_FinC(1) / p_FinC(2));
-
-    // Distort the normalized coordinates
-    Eigen::Vector2f uv_dist = camera->distort_f(uv_norm);
+  // Distort all survivors through the batch kernel (one calibration load, no virtual call per point)
+  camera->distort_batch_f(pts_norm, pts_dist);
 
-    // Check that it is inside our bounds
-    if (uv_dist(0) < 0 || uv_dist(0) > camera->w() || uv_dist(1) < 0 || uv_dist(1) > camera->h()) {
+  // Finally keep the projections that land inside the image bounds
+  std::vector<std::pair<size_t, Eigen::VectorXf>> uvs;
+  uvs.reserve(ids_valid.size());
+  int width = camera->w();
+  int height = camera->h();
+  for (size_t n = 0; n < ids_valid.size(); n++) {
+    const Eigen::Vector2f &uv_dist = pts_dist.at(n);
+    if (uv_dist(0) < 0 || uv_dist(0) > width || uv_dist(1) < 0 || uv_dist(1) > height)
       continue;
-    }
-
-    // Else we can add this as a good projection
-    uvs.push_back({feat.first, uv_dist});
+    uvs.push_back({ids_valid.at(n), uv_dist});
   }
 
   // Return our projections
   return uvs;
 }
 
+double Simulator::featmap_cull_radius(int camid) {
+
+  // Return the cached radius if we already derived it for this camera
+  auto it = featmap_cull_radii.find(camid);
+  if (it != featmap_cull_radii.end())
+    return it->second;
+
+  // Undistort samples along the image border to find the widest normalized ray
+  std::shared_ptr<ov_core::CamBase> camera = params.camera_intrinsics.at(camid);
+  double rn_max_sq = 0.0;
+  int num_samples = 20;
+  for (int i = 0; i <= num_samples; i++) {
+    float u = (float)camera->w() * (float)i / (float)num_samples;
+    float v = (float)camera->h() * (float)i / (float)num_samples;
+    for (const cv::Point2f &uv_dist : {cv::Point2f(u, 0.0f), cv::Point2f(u, (float)camera->h()), cv::Point2f(0.0f, v),
+                                       cv::Point2f((float)camera->w(), v)}) {
+      cv::Point2f uv_norm = camera->undistort_cv(uv_dist);
+      rn_max_sq = std::max(rn_max_sq, (double)(uv_norm.x * uv_norm.x + uv_norm.y * uv_norm.y));
+    }
+  }
+
+  // An in-image feature at depth d sits at camera distance d*sqrt(1+rn^2), so the
+  // generation depth bound gives the farthest it can possibly be (plus some margin)
+  double radius = params.sim_max_feature_gen_distance * std::sqrt(1.0 + rn_max_sq) * 1.05;
+  featmap_cull_radii.insert({camid, radius});
+  return radius;
+}
+
 void Simulator::generate_points(const Eigen::Matrix3d &R_GtoI, const Eigen::Vector3d &p_IinG, int camid,
                                 std::unordered_map<size_t, Eigen::Vector3d> &feats, int numpts) {
 
@@ -519,10 +697,8 @@ void Simulator::generate_points(const Eigen::Matrix3d &R_GtoI, const Eigen::Vect
   for (int i = 0; i < numpts; i++) {
 
     // Uniformly randomly generate within our fov
-    std::uniform_real_distribution<double> gen_u(0, camera->w());
-    std::uniform_real_distribution<double> gen_v(0, camera->h());
-    double u_dist = gen_u(gen_state_init);
-    double v_dist = gen_v(gen_state_init);
+    double u_dist = gen_state_init.uniform(0, camera->w());
+    double v_dist = gen_state_init.uniform(0, camera->h());
 
     // Convert to opencv format
     cv::Point2f uv_dist((float)u_dist, (float)v_dist);
@@ -535,8 +711,7 @@ void Simulator::generate_points(const Eigen::Matrix3d &R_GtoI, const Eigen::Vect
     if (!params.sim_use_ground_plane_features) {
 
       // Generate a random depth
-      std::uniform_real_distribution<double> gen_depth(params.sim_min_feature_gen_distance, params.sim_max_feature_gen_distance);
-      double depth = gen_depth(gen_state_init);
+      double depth = gen_state_init.uniform(params.sim_min_feature_gen_distance, params.sim_max_feature_gen_distance);
 
       // Get the 3d point
       Eigen::Vector3d bearing;
@@ -551,9 +726,8 @@ void Simulator::generate_points(const Eigen::Matrix3d &R_GtoI, const Eigen::Vect
     } else {
 
       // Get the height deviation from the ground plane
-      std::uniform_real_distribution<double> get_height_deviation(-0.5 * params.sim_ground_plane_features_range,
-                                                                  0.5 * params.sim_ground_plane_features_range);
-      double height_deviation = get_height_deviation(gen_state_init);
+      double height_deviation =
+          gen_state_init.uniform(-0.5 * params.sim_ground_plane_features_range, 0.5 * params.sim_ground_plane_features_range);
 
       // Calculate the bearing of the point in camera frame
       Eigen::Vector3d bearing;
@@ -580,3 +754,151 @@ void Simulator::generate_points(const Eigen::Matrix3d &R_GtoI, const Eigen::Vect
     id_map++;
   }
 }
+
+void Simulator::precompute_projections() {
+
+  // Replay the exact camera-time stepping of get_next_cam so the cached
+  // timestamps are bit-identical to the ones a live run would produce
+  double time_cache = timestamp_last_cam;
+  while (true) {
+
+    // Move forward in time and get the pose at this camera frame
+    time_cache += 1.0 / params.sim_freq_cam;
+    Eigen::Matrix3d R_GtoI;
+    Eigen::Vector3d p_IinG;
+    if (!spline->get_pose(time_cache, R_GtoI, p_IinG))
+      break;
+
+    // Project the full feature map into each camera
+    std::vector<std::vector<std::pair<size_t, Eigen::VectorXf>>> frame;
+    for (int i = 0; i < params.state_options.num_cameras; i++) {
+      frame.push_back(project_pointcloud(R_GtoI, p_IinG, i, featmap));
+    }
+    cache_cam_times.push_back(time_cache);
+    cache_cam_feats.push_back(frame);
+  }
+  PRINT_DEBUG("[SIM]: precomputed noiseless projections for %d camera frames\n", (int)cache_cam_times.size());
+}
+
+bool Simulator::load_precache(const std::string &path) {
+
+  // Open the file if it exists (missing is expected on the very first run)
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open())
+    return false;
+
+  // Check the magic and version
+  uint32_t magic = 0, version = 0;
+  if (!read_pod(file, magic) || !read_pod(file, version) || magic != PRECACHE_MAGIC || version != PRECACHE_VERSION) {
+    PRINT_WARNING(YELLOW "[SIM]: precache file has a different format, regenerating (%s)\n" RESET, path.c_str());
+    return false;
+  }
+
+  // Check that the file was generated with our exact simulation parameters
+  std::vector<double> fingerprint = precache_fingerprint(params, traj_data);
+  uint64_t num_values = 0;
+  bool matches = read_pod(file, num_values) && num_values == (uint64_t)fingerprint.size();
+  for (size_t i = 0; matches && i < fingerprint.size(); i++) {
+    double value_saved = 0;
+    matches = read_pod(file, value_saved) && value_saved == fingerprint.at(i);
+  }
+  if (!matches) {
+    PRINT_WARNING(YELLOW "[SIM]: precache file is stale (parameters changed), regenerating (%s)\n" RESET, path.c_str());
+    return false;
+  }
+
+  // Read the feature map
+  uint64_t id_map_saved = 0, num_feats = 0;
+  bool valid = read_pod(file, id_map_saved) && read_pod(file, num_feats);
+  for (uint64_t f = 0; valid && f < num_feats; f++) {
+    uint64_t featid = 0;
+    Eigen::Vector3d p_FinG;
+    valid = read_pod(file, featid) && read_pod(file, p_FinG(0)) && read_pod(file, p_FinG(1)) && read_pod(file, p_FinG(2));
+    if (valid)
+      featmap.insert({(size_t)featid, p_FinG});
+  }
+
+  // Read the per-frame noiseless projections
+  uint64_t num_frames = 0;
+  valid = valid && read_pod(file, num_frames);
+  for (uint64_t f = 0; valid && f < num_frames; f++) {
+    double time_frame = 0;
+    valid = read_pod(file, time_frame);
+    std::vector<std::vector<std::pair<size_t, Eigen::VectorXf>>> frame;
+    for (int i = 0; valid && i < params.state_options.num_cameras; i++) {
+      uint64_t num_uvs = 0;
+      valid = read_pod(file, num_uvs);
+      std::vector<std::pair<size_t, Eigen::VectorXf>> uvs;
+      for (uint64_t j = 0; valid && j < num_uvs; j++) {
+        uint64_t featid = 0;
+        Eigen::Vector2f uv;
+        valid = read_pod(file, featid) && read_pod(file, uv(0)) && read_pod(file, uv(1));
+        if (valid)
+          uvs.push_back({(size_t)featid, uv});
+      }
+      frame.push_back(uvs);
+    }
+    if (valid) {
+      cache_cam_times.push_back(time_frame);
+      cache_cam_feats.push_back(frame);
+    }
+  }
+
+  // If the file was truncated then throw everything away and regenerate
+  if (!valid) {
+    PRINT_WARNING(YELLOW "[SIM]: precache file is corrupted, regenerating (%s)\n" RESET, path.c_str());
+    featmap.clear();
+    cache_cam_times.clear();
+    cache_cam_feats.clear();
+    return false;
+  }
+  id_map = (size_t)id_map_saved;
+  PRINT_INFO("[SIM]: loaded noiseless measurement cache (%d features, %d frames) from %s\n", (int)featmap.size(),
+             (int)cache_cam_times.size(), path.c_str());
+  return true;
+}
+
+void Simulator::save_precache(const std::string &path) {
+
+  // Open the output file
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  if (!file.is_open()) {
+    PRINT_WARNING(YELLOW "[SIM]: unable to open precache file for writing (%s)\n" RESET, path.c_str());
+    return;
+  }
+
+  // Header with the parameters the measurements depend on
+  write_pod(file, PRECACHE_MAGIC);
+  write_pod(file, PRECACHE_VERSION);
+  std::vector<double> fingerprint = precache_fingerprint(params, traj_data);
+  write_pod(file, (uint64_t)fingerprint.size());
+  for (double value : fingerprint) {
+    write_pod(file, value);
+  }
+
+  // Feature map
+  write_pod(file, (uint64_t)id_map);
+  write_pod(file, (uint64_t)featmap.size());
+  for (const auto &feat : featmap) {
+    write_pod(file, (uint64_t)feat.first);
+    write_pod(file, feat.second(0));
+    write_pod(file, feat.second(1));
+    write_pod(file, feat.second(2));
+  }
+
+  // Per-frame noiseless projections
+  write_pod(file, (uint64_t)cache_cam_times.size());
+  for (size_t f = 0; f < cache_cam_times.size(); f++) {
+    write_pod(file, cache_cam_times.at(f));
+    for (const auto &uvs : cache_cam_feats.at(f)) {
+      write_pod(file, (uint64_t)uvs.size());
+      for (const auto &uv : uvs) {
+        write_pod(file, (uint64_t)uv.first);
+        write_pod(file, uv.second(0));
+        write_pod(file, uv.second(1));
+      }
+    }
+  }
+  PRINT_INFO("[SIM]: saved noiseless measurement cache (%d features, %d frames) to %s\n", (int)featmap.size(), (int)cache_cam_times.size(),
+             path.c_str());
+}
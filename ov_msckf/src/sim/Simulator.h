@@ -24,13 +24,15 @@
 
 #include <Eigen/Eigen>
 #include <fstream>
+#include <map>
 #include <opencv2/core/core.hpp>
-#include <random>
 #include <sstream>
 #include <string>
 #include <unordered_map>
 
 #include "core/VioManagerOptions.h"
+#include "utils/counter_rng.h"
+#include "utils/sensor_data.h"
 
 namespace ov_core {
 class BsplineSE3;
@@ -63,7 +65,7 @@ public:
    * @param gen_state Random number gen to use
    * @param params_ Parameters we will perturb
    */
-  static void perturb_parameters(std::mt19937 gen_state, VioManagerOptions &params_);
+  static void perturb_parameters(ov_core::CounterRNG gen_state, VioManagerOptions &params_);
 
   /**
    * @brief Returns if we are actively simulating
@@ -103,6 +105,20 @@ public:
    */
   bool get_next_cam(double &time_cam, std::vector<int> &camids, std::vector<std::vector<std::pair<size_t, Eigen::VectorXf>>> &feats);
 
+  /**
+   * @brief Gets the next camera reading as an image-free simulated message.
+   * @param message Struct the timestamp, camera ids, and noisy uvs are written into (any previous contents are dropped)
+   * @return True if we have a measurement
+   *
+   * The uv vectors are built (or moved out of the precache) directly into the
+   * message, so the caller can hand the struct onwards by move without any copy.
+   */
+  bool get_next_cam(ov_core::SimCameraData &message) {
+    message.sensor_ids.clear();
+    message.feats.clear();
+    return get_next_cam(message.timestamp, message.sensor_ids, message.feats);
+  }
+
   /// Returns the true 3d map of features
   std::unordered_map<size_t, Eigen::Vector3d> get_map() { return featmap; }
 
@@ -120,6 +136,12 @@ public:
 protected:
   /**
    * @brief Projects the passed map features into the desired camera frame.
+   *
+   * This works in batch: the map is mirrored into a contiguous point matrix (rebuilt
+   * lazily when features are added), all points are transformed into the camera frame
+   * with a single matrix product, and the depth-culled survivors are distorted through
+   * the camera model batch kernel instead of one virtual call per point.
+   *
    * @param R_GtoI Orientation of the IMU pose
    * @param p_IinG Position of the IMU pose
    * @param camid Camera id of the camera sensor we want to project into
@@ -140,6 +162,28 @@ protected:
   void generate_points(const Eigen::Matrix3d &R_GtoI, const Eigen::Vector3d &p_IinG, int camid,
                        std::unordered_map<size_t, Eigen::Vector3d> &feats, int numpts);
 
+  /**
+   * @brief Projects the final feature map into every camera frame of the trajectory.
+   *
+   * This caches the noiseless raw uv projections that @ref get_next_cam would otherwise
+   * re-derive each frame, so they can be saved to disk and shared between repeated runs
+   * that only differ in their measurement noise seed.
+   */
+  void precompute_projections();
+
+  /**
+   * @brief Tries to load the noiseless measurement cache from disk.
+   * @param path Path to the binary cache file
+   * @return False if the file is missing or was created with different simulation parameters
+   */
+  bool load_precache(const std::string &path);
+
+  /**
+   * @brief Saves the feature map and noiseless projections to disk.
+   * @param path Path to the binary cache file
+   */
+  void save_precache(const std::string &path);
+
   //===================================================================
   // Configuration variables
   //===================================================================
@@ -161,17 +205,49 @@ protected:
   size_t id_map = 0;
   std::unordered_map<size_t, Eigen::Vector3d> featmap;
 
-  /// Mersenne twister PRNG for measurements (IMU)
-  std::mt19937 gen_meas_imu;
+  /// Contiguous mirror of featmap used by the batched projection (ids and 3xN points
+  /// in map iteration order, rebuilt by project_pointcloud when the map has grown)
+  std::vector<size_t> featmap_ids;
+  Eigen::Matrix<double, 3, Eigen::Dynamic> featmap_pts;
 
-  /// Mersenne twister PRNG for measurements (CAMERAS)
-  std::vector<std::mt19937> gen_meas_cams;
+  /// Uniform spatial grid over the map (cell -> columns of featmap_pts falling in it)
+  /// Rebuilt together with the mirror, so long trajectories only pay for the features
+  /// near the current camera instead of the whole map on every projection
+  std::unordered_map<int64_t, std::vector<int>> featmap_grid;
+  double featmap_grid_cell = -1;
 
-  /// Mersenne twister PRNG for state initialization
-  std::mt19937 gen_state_init;
+  /// Conservative per-camera cull radius used with the grid (lazily computed)
+  std::map<int, double> featmap_cull_radii;
 
-  /// Mersenne twister PRNG for state perturbations
-  std::mt19937 gen_state_perturb;
+  /// Packs the grid cell with the given integer coordinates into a single map key
+  static int64_t featmap_grid_key(int64_t cx, int64_t cy, int64_t cz) {
+    return ((cx & 0x1FFFFF) << 42) | ((cy & 0x1FFFFF) << 21) | (cz & 0x1FFFFF);
+  }
+
+  /**
+   * @brief Farthest distance from the camera at which a feature could still project into the image.
+   *
+   * A feature inside the image bounds at the maximum generation depth lies on a ray no wider
+   * than the widest normalized ray of the camera, so its distance is bounded by that depth
+   * stretched by the ray length. We get the widest ray by undistorting the image border and
+   * keep a small margin, thus the grid cull can never drop an in-frustum feature.
+   *
+   * @param camid Camera id of the camera sensor we want to project into
+   * @return Cull radius in the global frame (cached after the first call per camera)
+   */
+  double featmap_cull_radius(int camid);
+
+  /// Counter-based PRNG for measurements (IMU), re-keyed by each reading's timestamp
+  ov_core::CounterRNG gen_meas_imu;
+
+  /// Counter-based PRNGs for measurements (CAMERAS), re-keyed by each frame's timestamp
+  std::vector<ov_core::CounterRNG> gen_meas_cams;
+
+  /// Counter-based PRNG for feature map generation
+  ov_core::CounterRNG gen_state_init;
+
+  /// Counter-based PRNG for state perturbations
+  ov_core::CounterRNG gen_state_perturb;
 
   /// If our simulation is running
   bool is_running;
@@ -200,6 +276,18 @@ protected:
   std::vector<double> hist_true_bias_time;
   std::vector<Eigen::Vector3d> hist_true_bias_accel;
   std::vector<Eigen::Vector3d> hist_true_bias_gyro;
+
+  /// If we have precomputed the noiseless camera projections (see @ref precompute_projections)
+  bool use_precache = false;
+
+  /// Index of the next cached camera frame that @ref get_next_cam will return
+  size_t index_cam_frame = 0;
+
+  /// Timestamps of the cached camera frames
+  std::vector<double> cache_cam_times;
+
+  /// Noiseless per-frame, per-camera raw feature projections (id, uv)
+  std::vector<std::vector<std::vector<std::pair<size_t, Eigen::VectorXf>>>> cache_cam_feats;
 };
 
 } // namespace ov_msckf
@@ -0,0 +1,138 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2018-2023 Patrick Geneva
+ * Copyright (C) 2018-2023 Guoquan Huang
+ * Copyright (C) 2018-2023 OpenVINS Contributors
+ * Copyright (C) 2018-2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OV_MSCKF_CLONE_INDEX_H
+#define OV_MSCKF_CLONE_INDEX_H
+
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "types/PoseJPL.h"
+
+namespace ov_msckf {
+
+/**
+ * @brief Open-addressing hash from quantized timestamps to clone poses.
+ *
+ * Timestamps are quantized to microsecond ticks before hashing, so lookups are robust to
+ * sub-microsecond jitter that would break exact-double matching in a std::map, and resolve
+ * in O(1) with linear probing (the hot per-measurement Jacobian loop does one of these per
+ * feature observation). This index shadows State::_clones_IMU, which remains the container
+ * used for ordered iteration; both are kept in sync by the StateHelper mutation paths.
+ */
+class CloneIndex {
+
+public:
+  CloneIndex() : slots(64) {}
+
+  /// Insert a clone at the given timestamp (replaces any clone within the same microsecond)
+  void insert(double timestamp, const std::shared_ptr<ov_type::PoseJPL> &clone) {
+    // Grow when half full (counting tombstones) so probe chains stay short
+    // and an empty slot always exists to terminate the probe
+    if (2 * (num_used + 1) > slots.size())
+      rehash(2 * slots.size());
+    Slot &slot = find_slot(slots, quantize(timestamp));
+    if (slot.state == Slot::EMPTY)
+      num_used++;
+    slot.key = quantize(timestamp);
+    slot.clone = clone;
+    slot.state = Slot::FULL;
+  }
+
+  /// Remove the clone at the given timestamp (no-op if absent)
+  void erase(double timestamp) {
+    Slot &slot = find_slot(slots, quantize(timestamp));
+    if (slot.state != Slot::FULL)
+      return;
+    // Leave a tombstone so probe chains through this slot stay intact
+    slot.clone.reset();
+    slot.state = Slot::TOMBSTONE;
+  }
+
+  /// Remove all clones
+  void clear() {
+    slots.assign(slots.size(), Slot());
+    num_used = 0;
+  }
+
+  /// O(1) lookup, returns nullptr if no clone exists within the timestamp's microsecond
+  std::shared_ptr<ov_type::PoseJPL> get(double timestamp) const {
+    const Slot &slot = find_slot(const_cast<std::vector<Slot> &>(slots), quantize(timestamp));
+    return (slot.state == Slot::FULL) ? slot.clone : nullptr;
+  }
+
+private:
+  /// A slot is empty until used, and tombstoned after an erase so probing can continue past it
+  struct Slot {
+    enum { EMPTY, FULL, TOMBSTONE } state = EMPTY;
+    int64_t key = 0;
+    std::shared_ptr<ov_type::PoseJPL> clone;
+  };
+
+  /// Quantize a timestamp to integer microsecond ticks
+  static int64_t quantize(double timestamp) { return (int64_t)std::llround(1e6 * timestamp); }
+
+  /// Fibonacci hash of the quantized key into the (power-of-two sized) table
+  static size_t hash(int64_t key, size_t mask) { return (size_t)((uint64_t)key * 0x9E3779B97F4A7C15ULL) & mask; }
+
+  /// Linear probe for the key, returns its slot or the first insertable one
+  static Slot &find_slot(std::vector<Slot> &table, int64_t key) {
+    size_t mask = table.size() - 1;
+    size_t idx = hash(key, mask);
+    Slot *first_free = nullptr;
+    while (true) {
+      Slot &slot = table[idx];
+      if (slot.state == Slot::FULL && slot.key == key)
+        return slot;
+      if (slot.state == Slot::TOMBSTONE && first_free == nullptr)
+        first_free = &slot;
+      if (slot.state == Slot::EMPTY)
+        return (first_free != nullptr) ? *first_free : slot;
+      idx = (idx + 1) & mask;
+    }
+  }
+
+  /// Re-insert all live entries into a larger table (also drops accumulated tombstones)
+  void rehash(size_t new_size) {
+    std::vector<Slot> new_slots(new_size);
+    num_used = 0;
+    for (Slot &slot : slots) {
+      if (slot.state != Slot::FULL)
+        continue;
+      Slot &dest = find_slot(new_slots, slot.key);
+      dest = std::move(slot);
+      num_used++;
+    }
+    slots.swap(new_slots);
+  }
+
+  /// Table of slots (size is always a power of two)
+  std::vector<Slot> slots;
+
+  /// Number of non-empty slots, including tombstones (reclaimed on rehash)
+  size_t num_used = 0;
+};
+
+} // namespace ov_msckf
+
+#endif // OV_MSCKF_CLONE_INDEX_H
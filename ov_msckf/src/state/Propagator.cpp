@@ -62,11 +62,8 @@ void Propagator::propagate_and_clone(std::shared_ptr<State> state, double timest
   // First lets construct an IMU vector of measurements we need
   double time0 = state->_timestamp + last_prop_time_offset;
   double time1 = timestamp + t_off_new;
-  std::vector<ov_core::ImuData> prop_data;
-  {
-    std::lock_guard<std::mutex> lck(imu_data_mtx);
-    prop_data = Propagator::select_imu_readings(imu_data, time0, time1);
-  }
+  std::vector<ov_core::ImuData> &prop_data = prop_data_prop;
+  select_imu_readings(time0, time1, prop_data);
 
   // We are going to sum up all the state transition matrices, so we can do a single large multiplication at the end
   // Phi_summed = Phi_i*Phi_summed
@@ -77,13 +74,32 @@ void Propagator::propagate_and_clone(std::shared_ptr<State> state, double timest
   Eigen::MatrixXd Qd_summed = Eigen::MatrixXd::Zero(state->imu_intrinsic_size() + 21, state->imu_intrinsic_size() + 21);
   double dt_summed = 0;
 
-  // Loop through all IMU messages, and use them to move the state forward in time
-  // This uses the zero'th order quat, and then constant acceleration discrete
-  if (prop_data.size() > 1) {
+  // Check our preintegration memo: if we have already integrated this exact window
+  // at this exact linearization point (the state mean has not changed since), we can
+  // reuse the summed (Phi, Qd, state delta) instead of re-running predict_and_compute
+  // NOTE: the memo is dropped by invalidate_cache(), which every EKF update triggers,
+  // NOTE: so a changed bias estimate can never serve a stale linearization
+  if (preint_valid && preint_time0 == time0 && preint_time1 == time1 && preint_state_start == state->_imu->value()) {
+    state->_imu->set_value(preint_state_end);
+    state->_imu->set_fej(preint_state_end);
+    Phi_summed = preint_Phi;
+    Qd_summed = preint_Qd;
+    dt_summed = time1 - time0;
+  } else if (prop_data.size() > 1) {
+
+    // Record the window and the linearization point we are about to integrate at
+    preint_time0 = time0;
+    preint_time1 = time1;
+    preint_state_start = state->_imu->value();
+
+    // Loop through all IMU messages, and use them to move the state forward in time
+    // This uses the zero'th order quat, and then constant acceleration discrete
+    // NOTE: the Jacobians and product workspaces are reused between samples (and calls)
+    // NOTE: so that this per-sample kernel does not heap allocate at IMU rate
+    static thread_local Eigen::MatrixXd F, Qdi, Work;
     for (size_t i = 0; i < prop_data.size() - 1; i++) {
 
       // Get the next state Jacobian and noise Jacobian for this IMU reading
-      Eigen::MatrixXd F, Qdi;
       predict_and_compute(state, prop_data.at(i), prop_data.at(i + 1), F, Qdi);
 
       // Next we should propagate our IMU covariance
@@ -92,11 +108,22 @@ void Propagator::propagate_and_clone(std::shared_ptr<State> state, double timest
       // NOTE: Here we are summing the state transition F so we can do a single mutiplication later
       // NOTE: Phi_summed = Phi_i*Phi_summed
       // NOTE: Q_summed = Phi_i*Q_summed*Phi_i^T + G*Q_i*G^T
-      Phi_summed = F * Phi_summed;
-      Qd_summed = F * Qd_summed * F.transpose() + Qdi;
-      Qd_summed = 0.5 * (Qd_summed + Qd_summed.transpose());
+      Work.noalias() = F * Phi_summed;
+      Phi_summed.swap(Work);
+      Work.noalias() = F * Qd_summed;
+      Qd_summed.noalias() = Work * F.transpose();
+      Qd_summed += Qdi;
+      Work = Qd_summed.transpose();
+      Qd_summed += Work;
+      Qd_summed *= 0.5;
       dt_summed += prop_data.at(i + 1).timestamp - prop_data.at(i).timestamp;
     }
+
+    // Memoize the result of this window so an identical request can skip the loop
+    preint_state_end = state->_imu->value();
+    preint_Phi = Phi_summed;
+    preint_Qd = Qd_summed;
+    preint_valid = true;
   }
   assert(std::abs((time1 - time0) - dt_summed) < 1e-4);
 
@@ -152,11 +179,8 @@ bool Propagator::fast_state_propagate(std::shared_ptr<State> state, double times
   // First lets construct an IMU vector of measurements we need
   double time0 = cache_state_time + cache_t_off;
   double time1 = timestamp + cache_t_off;
-  std::vector<ov_core::ImuData> prop_data;
-  {
-    std::lock_guard<std::mutex> lck(imu_data_mtx);
-    prop_data = Propagator::select_imu_readings(imu_data, time0, time1, false);
-  }
+  std::vector<ov_core::ImuData> &prop_data = prop_data_fast;
+  select_imu_readings(time0, time1, prop_data, false);
   if (prop_data.size() < 2)
     return false;
 
@@ -222,10 +246,7 @@ bool Propagator::fast_state_propagate(std::shared_ptr<State> state, double times
     // Equations (129) amd (130) of Trawny tech report
     Eigen::Matrix<double, 21, 21> Qd = Eigen::Matrix<double, 21, 21>::Zero();
     Eigen::Matrix<double, 12, 12> Qc = Eigen::Matrix<double, 12, 12>::Zero();
-    Qc.block(0, 0, 3, 3) = _noises.sigma_w_2 / dt * Eigen::Matrix3d::Identity();
-    Qc.block(3, 3, 3, 3) = _noises.sigma_a_2 / dt * Eigen::Matrix3d::Identity();
-    Qc.block(6, 6, 3, 3) = _noises.sigma_wb_2 * dt * Eigen::Matrix3d::Identity();
-    Qc.block(9, 9, 3, 3) = _noises.sigma_ab_2 * dt * Eigen::Matrix3d::Identity();
+    Qc.diagonal() = _noises.Qd_diagonal(dt);
     Qd = G * Qc * G.transpose();
     Qd = 0.5 * (Qd + Qd.transpose());
     cache_state_covariance = F * cache_state_covariance * F.transpose() + Qd;
@@ -262,26 +283,98 @@ bool Propagator::fast_state_propagate(std::shared_ptr<State> state, double times
   Eigen::MatrixXd covariance_tmp = Phi * cache_state_covariance * Phi.transpose();
   covariance.block(0, 0, 9, 9) = covariance_tmp.block(0, 0, 9, 9);
   double dt = prop_data.at(prop_data.size() - 1).timestamp - prop_data.at(prop_data.size() - 2).timestamp;
-  covariance.block(9, 9, 3, 3) = _noises.sigma_w_2 / dt * Eigen::Matrix3d::Identity();
+  covariance.block(9, 9, 3, 3) = (_noises.sigma_w_2_axis / dt).asDiagonal();
+
+  // Publish through the seqlock so get_fast_state_snapshot() readers can grab the
+  // latest prediction without blocking us or taking any of our locks
+  fast_snapshot_seq.fetch_add(1, std::memory_order_acq_rel);
+  fast_snapshot_time = timestamp;
+  fast_snapshot_state = state_plus;
+  fast_snapshot_cov = covariance;
+  fast_snapshot_seq.fetch_add(1, std::memory_order_release);
+  return true;
+}
+
+bool Propagator::get_fast_state_snapshot(double &timestamp, Eigen::Matrix<double, 13, 1> &state_plus,
+                                         Eigen::Matrix<double, 12, 12> &covariance) {
+
+  // Standard seqlock read: retry if the writer was mid-update or wrote in between
+  for (;;) {
+    uint32_t seq0 = fast_snapshot_seq.load(std::memory_order_acquire);
+    if (seq0 == 0)
+      return false;
+    if (seq0 % 2 != 0)
+      continue;
+    timestamp = fast_snapshot_time;
+    state_plus = fast_snapshot_state;
+    covariance = fast_snapshot_cov;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (fast_snapshot_seq.load(std::memory_order_relaxed) == seq0)
+      return true;
+  }
+}
+
+bool Propagator::get_gyro_relative_rotation(double time0, double time1, const Eigen::Vector3d &bias_g, Eigen::Matrix3d &R_I0toI1) {
+
+  // Select the gyro readings which span the two times
+  std::vector<ov_core::ImuData> &prop_data = prop_data_gyro;
+  select_imu_readings(time0, time1, prop_data, false);
+  if (prop_data.size() < 2)
+    return false;
+
+  // Compound the zero'th order rotation over each interval
+  // Note we skip the IMU intrinsic model here since a prediction does not need that fidelity
+  R_I0toI1.setIdentity();
+  for (size_t i = 0; i < prop_data.size() - 1; i++) {
+    double dt = prop_data.at(i + 1).timestamp - prop_data.at(i).timestamp;
+    Eigen::Vector3d w_hat = 0.5 * (prop_data.at(i).wm + prop_data.at(i + 1).wm) - bias_g;
+    R_I0toI1 = exp_so3(-w_hat * dt) * R_I0toI1;
+  }
   return true;
 }
 
 std::vector<ov_core::ImuData> Propagator::select_imu_readings(const std::vector<ov_core::ImuData> &imu_data, double time0, double time1,
                                                               bool warn) {
+  std::vector<ov_core::ImuData> prop_data;
+  Propagator::select_imu_readings_from(imu_data, time0, time1, 0, prop_data, warn);
+  return prop_data;
+}
+
+void Propagator::select_imu_readings(double time0, double time1, std::vector<ov_core::ImuData> &prop_data, bool warn) {
+  std::lock_guard<std::mutex> lck(imu_data_mtx);
+  drain_imu_queue();
+  imu_select_cursor = Propagator::select_imu_readings_from(imu_data, time0, time1, imu_select_cursor, prop_data, warn);
+}
+
+size_t Propagator::select_imu_readings_from(const std::vector<ov_core::ImuData> &imu_data, double time0, double time1, size_t hint,
+                                            std::vector<ov_core::ImuData> &prop_data, bool warn) {
 
   // Our vector imu readings
-  std::vector<ov_core::ImuData> prop_data;
+  prop_data.clear();
 
   // Ensure we have some measurements in the first place!
   if (imu_data.empty()) {
     if (warn)
       PRINT_WARNING(YELLOW "Propagator::select_imu_readings(): No IMU measurements. IMU-CAMERA are likely messed up!!!\n" RESET);
-    return prop_data;
+    return 0;
   }
 
+  // Move the hint to the reading that brackets the start time
+  // First rewind if the hint has gone past it (e.g. a fast propagate from an older state)
+  // Then advance to the last reading that is still at or before it
+  // Propagation start times are monotonic, so across calls this is amortized constant time
+  // Note we bound the walk by the earlier of the two times so a degenerate (reversed)
+  // request still visits the same readings the full front scan would have
+  double time_min = std::min(time0, time1);
+  size_t i0 = std::min(hint, imu_data.size() - 1);
+  while (i0 > 0 && imu_data.at(i0).timestamp >= time_min)
+    i0--;
+  while (i0 + 1 < imu_data.size() && imu_data.at(i0 + 1).timestamp <= time_min)
+    i0++;
+
   // Loop through and find all the needed measurements to propagate with
   // Note we split measurements based on the given state time, and the update timestamp
-  for (size_t i = 0; i < imu_data.size() - 1; i++) {
+  for (size_t i = i0; i < imu_data.size() - 1; i++) {
 
     // START OF THE INTEGRATION PERIOD
     // If the next timestamp is greater then our current state time
@@ -348,7 +441,7 @@ std::vector<ov_core::ImuData> Propagator::select_imu_readings(const std::vector<
           YELLOW
           "Propagator::select_imu_readings(): No IMU measurements to propagate with (%d of 2). IMU-CAMERA are likely messed up!!!\n" RESET,
           (int)prop_data.size());
-    return prop_data;
+    return i0;
   }
 
   // If we did not reach the whole integration period
@@ -385,11 +478,11 @@ std::vector<ov_core::ImuData> Propagator::select_imu_readings(const std::vector<
           YELLOW
           "Propagator::select_imu_readings(): No IMU measurements to propagate with (%d of 2). IMU-CAMERA are likely messed up!!!\n" RESET,
           (int)prop_data.size());
-    return prop_data;
+    return i0;
   }
 
   // Success :D
-  return prop_data;
+  return i0;
 }
 
 void Propagator::predict_and_compute(std::shared_ptr<State> state, const ov_core::ImuData &data_minus, const ov_core::ImuData &data_plus,
@@ -446,9 +539,15 @@ void Propagator::predict_and_compute(std::shared_ptr<State> state, const ov_core
     predict_mean_discrete(state, dt, w_hat_avg, a_hat_avg, new_q, new_v, new_p, new_keyframe_q, new_keyframe_p);
   }
 
-  // Allocate state transition and continuous-time noise Jacobian
-  F = Eigen::MatrixXd::Zero(state->imu_intrinsic_size() + 21, state->imu_intrinsic_size() + 21);
-  Eigen::MatrixXd G = Eigen::MatrixXd::Zero(state->imu_intrinsic_size() + 21, 12);
+  // Size the state transition and continuous-time noise Jacobian
+  // The state size is fixed at runtime, so the resizes below are no-ops after the
+  // first sample and only the setZero touches the (already allocated) storage
+  int state_size = state->imu_intrinsic_size() + 21;
+  F.resize(state_size, state_size);
+  F.setZero();
+  static thread_local Eigen::MatrixXd G;
+  G.resize(state_size, 12);
+  G.setZero();
   if (state->_options.integration_method == StateOptions::IntegrationMethod::RK4 ||
       state->_options.integration_method == StateOptions::IntegrationMethod::ANALYTICAL) {
     compute_F_and_G_analytic(state, dt, w_hat_avg, a_hat_avg, w_uncorrected, a_uncorrected, new_q, new_v, new_p, new_keyframe_q,
@@ -462,15 +561,16 @@ void Propagator::predict_and_compute(std::shared_ptr<State> state, const ov_core
   // Note that we need to convert our continuous time noises to discrete
   // Equations (129) amd (130) of Trawny tech report
   Eigen::Matrix<double, 12, 12> Qc = Eigen::Matrix<double, 12, 12>::Zero();
-  Qc.block(0, 0, 3, 3) = std::pow(_noises.sigma_w, 2) / dt * Eigen::Matrix3d::Identity();
-  Qc.block(3, 3, 3, 3) = std::pow(_noises.sigma_a, 2) / dt * Eigen::Matrix3d::Identity();
-  Qc.block(6, 6, 3, 3) = std::pow(_noises.sigma_wb, 2) / dt * Eigen::Matrix3d::Identity();
-  Qc.block(9, 9, 3, 3) = std::pow(_noises.sigma_ab, 2) / dt * Eigen::Matrix3d::Identity();
+  Qc.diagonal() = _noises.Qc_diagonal(dt);
 
   // Compute the noise injected into the state over the interval
-  Qd = Eigen::MatrixXd::Zero(state->imu_intrinsic_size() + 21, state->imu_intrinsic_size() + 21);
-  Qd = G * Qc * G.transpose();
-  Qd = 0.5 * (Qd + Qd.transpose());
+  static thread_local Eigen::MatrixXd GQc, Qd_sym;
+  GQc.noalias() = G * Qc;
+  Qd.resize(state_size, state_size);
+  Qd.noalias() = GQc * G.transpose();
+  Qd_sym = Qd.transpose();
+  Qd += Qd_sym;
+  Qd *= 0.5;
 
   // Now replace imu estimate and fej with propagated values
   Eigen::Matrix<double, 23, 1> imu_x = state->_imu->value();
@@ -524,39 +624,41 @@ void Propagator::predict_mean_rk4(std::shared_ptr<State> state, double dt, const
                                   Eigen::Vector3d &new_keyframe_p) {
 
   // Pre-compute things
-  Eigen::Vector3d w_hat = w_hat1;
-  Eigen::Vector3d a_hat = a_hat1;
-  Eigen::Vector3d w_alpha = (w_hat2 - w_hat1) / dt;
-  Eigen::Vector3d a_jerk = (a_hat2 - a_hat1) / dt;
+  // The midpoint substeps k2 and k3 share the same measurement, so we only build
+  // three Omega matrices (begin/mid/end) and one base rotation for this sample
+  Eigen::Vector3d w_mid = 0.5 * (w_hat1 + w_hat2);
+  Eigen::Vector3d a_mid = 0.5 * (a_hat1 + a_hat2);
+  Eigen::Matrix4d Omega_1 = Omega(w_hat1);
+  Eigen::Matrix4d Omega_mid = Omega(w_mid);
+  Eigen::Matrix4d Omega_2 = Omega(w_hat2);
 
   // y0 ================
   Eigen::Vector4d q_0 = state->_imu->quat();
   Eigen::Vector3d p_0 = state->_imu->pos();
   Eigen::Vector3d v_0 = state->_imu->vel();
+  Eigen::Matrix3d R_q0 = quat_2_Rot(q_0);
 
   // k1 ================
+  // The local perturbation starts at identity, so R_Gto0 is just the base rotation
+  // We also use R(dq*q0) = R(dq)*R(q0) to avoid re-normalizing full quaternion products
   Eigen::Vector4d dq_0 = {0, 0, 0, 1};
-  Eigen::Vector4d q0_dot = 0.5 * Omega(w_hat) * dq_0;
+  Eigen::Vector4d q0_dot = 0.5 * Omega_1 * dq_0;
   Eigen::Vector3d p0_dot = v_0;
-  Eigen::Matrix3d R_Gto0 = quat_2_Rot(quat_multiply(dq_0, q_0));
-  Eigen::Vector3d v0_dot = R_Gto0.transpose() * a_hat - _gravity;
+  Eigen::Vector3d v0_dot = R_q0.transpose() * a_hat1 - _gravity;
 
   Eigen::Vector4d k1_q = q0_dot * dt;
   Eigen::Vector3d k1_p = p0_dot * dt;
   Eigen::Vector3d k1_v = v0_dot * dt;
 
   // k2 ================
-  w_hat += 0.5 * w_alpha * dt;
-  a_hat += 0.5 * a_jerk * dt;
-
   Eigen::Vector4d dq_1 = quatnorm(dq_0 + 0.5 * k1_q);
   // Eigen::Vector3d p_1 = p_0+0.5*k1_p;
   Eigen::Vector3d v_1 = v_0 + 0.5 * k1_v;
 
-  Eigen::Vector4d q1_dot = 0.5 * Omega(w_hat) * dq_1;
+  Eigen::Vector4d q1_dot = 0.5 * Omega_mid * dq_1;
   Eigen::Vector3d p1_dot = v_1;
-  Eigen::Matrix3d R_Gto1 = quat_2_Rot(quat_multiply(dq_1, q_0));
-  Eigen::Vector3d v1_dot = R_Gto1.transpose() * a_hat - _gravity;
+  Eigen::Matrix3d R_Gto1 = quat_2_Rot(dq_1) * R_q0;
+  Eigen::Vector3d v1_dot = R_Gto1.transpose() * a_mid - _gravity;
 
   Eigen::Vector4d k2_q = q1_dot * dt;
   Eigen::Vector3d k2_p = p1_dot * dt;
@@ -567,27 +669,24 @@ void Propagator::predict_mean_rk4(std::shared_ptr<State> state, double dt, const
   // Eigen::Vector3d p_2 = p_0+0.5*k2_p;
   Eigen::Vector3d v_2 = v_0 + 0.5 * k2_v;
 
-  Eigen::Vector4d q2_dot = 0.5 * Omega(w_hat) * dq_2;
+  Eigen::Vector4d q2_dot = 0.5 * Omega_mid * dq_2;
   Eigen::Vector3d p2_dot = v_2;
-  Eigen::Matrix3d R_Gto2 = quat_2_Rot(quat_multiply(dq_2, q_0));
-  Eigen::Vector3d v2_dot = R_Gto2.transpose() * a_hat - _gravity;
+  Eigen::Matrix3d R_Gto2 = quat_2_Rot(dq_2) * R_q0;
+  Eigen::Vector3d v2_dot = R_Gto2.transpose() * a_mid - _gravity;
 
   Eigen::Vector4d k3_q = q2_dot * dt;
   Eigen::Vector3d k3_p = p2_dot * dt;
   Eigen::Vector3d k3_v = v2_dot * dt;
 
   // k4 ================
-  w_hat += 0.5 * w_alpha * dt;
-  a_hat += 0.5 * a_jerk * dt;
-
   Eigen::Vector4d dq_3 = quatnorm(dq_0 + k3_q);
   // Eigen::Vector3d p_3 = p_0+k3_p;
   Eigen::Vector3d v_3 = v_0 + k3_v;
 
-  Eigen::Vector4d q3_dot = 0.5 * Omega(w_hat) * dq_3;
+  Eigen::Vector4d q3_dot = 0.5 * Omega_2 * dq_3;
   Eigen::Vector3d p3_dot = v_3;
-  Eigen::Matrix3d R_Gto3 = quat_2_Rot(quat_multiply(dq_3, q_0));
-  Eigen::Vector3d v3_dot = R_Gto3.transpose() * a_hat - _gravity;
+  Eigen::Matrix3d R_Gto3 = quat_2_Rot(dq_3) * R_q0;
+  Eigen::Vector3d v3_dot = R_Gto3.transpose() * a_hat2 - _gravity;
 
   Eigen::Vector4d k4_q = q3_dot * dt;
   Eigen::Vector3d k4_p = p3_dot * dt;
@@ -778,10 +877,22 @@ void Propagator::compute_F_and_G_analytic(std::shared_ptr<State> state, double d
   Eigen::Matrix3d Xi_3 = Xi_sum.block(0, 12, 3, 3);
   Eigen::Matrix3d Xi_4 = Xi_sum.block(0, 15, 3, 3);
 
+  // Shared subexpressions of the blocks below, each of which used to be re-multiplied
+  // out per block (the bias columns alone repeated these chains six times)
+  Eigen::Matrix3d R_k_T = R_k.transpose();
+  Eigen::Matrix3d dRJr_dt = dR_ktok1 * Jr_ktok1 * dt;
+  Eigen::Matrix3d RwD = R_wtoI * Dw;
+  Eigen::Matrix3d RaD = R_atoI * Da;
+  Eigen::Matrix3d RwDT = RwD * Tg;
+  Eigen::Matrix3d RkXi3 = R_k_T * Xi_3;
+  Eigen::Matrix3d RkXi4 = R_k_T * Xi_4;
+  Eigen::Matrix3d RkXi24 = R_k_T * (Xi_2 + Xi_4 * RwDT);
+  Eigen::Matrix3d RkXi13 = R_k_T * (Xi_1 + Xi_3 * RwDT);
+
   // for th
   F.block(th_id, th_id, 3, 3) = dR_ktok1;
-  F.block(p_id, th_id, 3, 3) = -skew_x(new_p - p_k - v_k * dt + 0.5 * _gravity * dt * dt) * R_k.transpose();
-  F.block(v_id, th_id, 3, 3) = -skew_x(new_v - v_k + _gravity * dt) * R_k.transpose();
+  F.block(p_id, th_id, 3, 3) = -skew_x(new_p - p_k - v_k * dt + 0.5 * _gravity * dt * dt) * R_k_T;
+  F.block(v_id, th_id, 3, 3) = -skew_x(new_v - v_k + _gravity * dt) * R_k_T;
 
   // for p
   F.block(p_id, p_id, 3, 3).setIdentity();
@@ -791,67 +902,70 @@ void Propagator::compute_F_and_G_analytic(std::shared_ptr<State> state, double d
   F.block(v_id, v_id, 3, 3).setIdentity();
 
   // for bg
-  F.block(th_id, bg_id, 3, 3) = -dR_ktok1 * Jr_ktok1 * dt * R_wtoI * Dw;
-  F.block(p_id, bg_id, 3, 3) = R_k.transpose() * Xi_4 * R_wtoI * Dw;
-  F.block(v_id, bg_id, 3, 3) = R_k.transpose() * Xi_3 * R_wtoI * Dw;
+  F.block(th_id, bg_id, 3, 3) = -dRJr_dt * RwD;
+  F.block(p_id, bg_id, 3, 3) = RkXi4 * RwD;
+  F.block(v_id, bg_id, 3, 3) = RkXi3 * RwD;
   F.block(bg_id, bg_id, 3, 3).setIdentity();
 
   // for ba
-  F.block(th_id, ba_id, 3, 3) = dR_ktok1 * Jr_ktok1 * dt * R_wtoI * Dw * Tg * R_atoI * Da;
-  F.block(p_id, ba_id, 3, 3) = -R_k.transpose() * (Xi_2 + Xi_4 * R_wtoI * Dw * Tg) * R_atoI * Da;
-  F.block(v_id, ba_id, 3, 3) = -R_k.transpose() * (Xi_1 + Xi_3 * R_wtoI * Dw * Tg) * R_atoI * Da;
+  F.block(th_id, ba_id, 3, 3) = dRJr_dt * RwDT * RaD;
+  F.block(p_id, ba_id, 3, 3) = -RkXi24 * RaD;
+  F.block(v_id, ba_id, 3, 3) = -RkXi13 * RaD;
   F.block(ba_id, ba_id, 3, 3).setIdentity();
 
   // begin to add the state transition matrix for the omega intrinsics Dw part
   if (Dw_id != -1) {
     Eigen::MatrixXd H_Dw = compute_H_Dw(state, w_uncorrected);
-    F.block(th_id, Dw_id, 3, state->_calib_imu_dw->size()) = dR_ktok1 * Jr_ktok1 * dt * R_wtoI * H_Dw;
-    F.block(p_id, Dw_id, 3, state->_calib_imu_dw->size()) = -R_k.transpose() * Xi_4 * R_wtoI * H_Dw;
-    F.block(v_id, Dw_id, 3, state->_calib_imu_dw->size()) = -R_k.transpose() * Xi_3 * R_wtoI * H_Dw;
+    F.block(th_id, Dw_id, 3, state->_calib_imu_dw->size()) = dRJr_dt * R_wtoI * H_Dw;
+    F.block(p_id, Dw_id, 3, state->_calib_imu_dw->size()) = -RkXi4 * R_wtoI * H_Dw;
+    F.block(v_id, Dw_id, 3, state->_calib_imu_dw->size()) = -RkXi3 * R_wtoI * H_Dw;
     F.block(Dw_id, Dw_id, state->_calib_imu_dw->size(), state->_calib_imu_dw->size()).setIdentity();
   }
 
   // begin to add the state transition matrix for the acc intrinsics Da part
   if (Da_id != -1) {
     Eigen::MatrixXd H_Da = compute_H_Da(state, a_uncorrected);
-    F.block(th_id, Da_id, 3, state->_calib_imu_da->size()) = -dR_ktok1 * Jr_ktok1 * dt * R_wtoI * Dw * Tg * R_atoI * H_Da;
-    F.block(p_id, Da_id, 3, state->_calib_imu_da->size()) = R_k.transpose() * (Xi_2 + Xi_4 * R_wtoI * Dw * Tg) * R_atoI * H_Da;
-    F.block(v_id, Da_id, 3, state->_calib_imu_da->size()) = R_k.transpose() * (Xi_1 + Xi_3 * R_wtoI * Dw * Tg) * R_atoI * H_Da;
+    F.block(th_id, Da_id, 3, state->_calib_imu_da->size()) = -dRJr_dt * RwDT * R_atoI * H_Da;
+    F.block(p_id, Da_id, 3, state->_calib_imu_da->size()) = RkXi24 * R_atoI * H_Da;
+    F.block(v_id, Da_id, 3, state->_calib_imu_da->size()) = RkXi13 * R_atoI * H_Da;
     F.block(Da_id, Da_id, state->_calib_imu_da->size(), state->_calib_imu_da->size()).setIdentity();
   }
 
   // add the state transition matrix of the Tg part
   if (Tg_id != -1) {
     Eigen::MatrixXd H_Tg = compute_H_Tg(state, a_k);
-    F.block(th_id, Tg_id, 3, state->_calib_imu_tg->size()) = -dR_ktok1 * Jr_ktok1 * dt * R_wtoI * Dw * H_Tg;
-    F.block(p_id, Tg_id, 3, state->_calib_imu_tg->size()) = R_k.transpose() * Xi_4 * R_wtoI * Dw * H_Tg;
-    F.block(v_id, Tg_id, 3, state->_calib_imu_tg->size()) = R_k.transpose() * Xi_3 * R_wtoI * Dw * H_Tg;
+    F.block(th_id, Tg_id, 3, state->_calib_imu_tg->size()) = -dRJr_dt * RwD * H_Tg;
+    F.block(p_id, Tg_id, 3, state->_calib_imu_tg->size()) = RkXi4 * RwD * H_Tg;
+    F.block(v_id, Tg_id, 3, state->_calib_imu_tg->size()) = RkXi3 * RwD * H_Tg;
     F.block(Tg_id, Tg_id, state->_calib_imu_tg->size(), state->_calib_imu_tg->size()).setIdentity();
   }
 
   // begin to add the state transition matrix for the R_ACCtoIMU part
   if (th_atoI_id != -1) {
-    F.block(th_id, th_atoI_id, 3, 3) = -dR_ktok1 * Jr_ktok1 * dt * R_wtoI * Dw * Tg * ov_core::skew_x(a_k);
-    F.block(p_id, th_atoI_id, 3, 3) = R_k.transpose() * (Xi_2 + Xi_4 * R_wtoI * Dw * Tg) * ov_core::skew_x(a_k);
-    F.block(v_id, th_atoI_id, 3, 3) = R_k.transpose() * (Xi_1 + Xi_3 * R_wtoI * Dw * Tg) * ov_core::skew_x(a_k);
+    Eigen::Matrix3d skew_ak = ov_core::skew_x(a_k);
+    F.block(th_id, th_atoI_id, 3, 3) = -dRJr_dt * RwDT * skew_ak;
+    F.block(p_id, th_atoI_id, 3, 3) = RkXi24 * skew_ak;
+    F.block(v_id, th_atoI_id, 3, 3) = RkXi13 * skew_ak;
     F.block(th_atoI_id, th_atoI_id, 3, 3).setIdentity();
   }
 
   // begin to add the state transition matrix for the R_GYROtoIMU part
   if (th_wtoI_id != -1) {
-    F.block(th_id, th_wtoI_id, 3, 3) = dR_ktok1 * Jr_ktok1 * dt * ov_core::skew_x(w_k);
-    F.block(p_id, th_wtoI_id, 3, 3) = -R_k.transpose() * Xi_4 * ov_core::skew_x(w_k);
-    F.block(v_id, th_wtoI_id, 3, 3) = -R_k.transpose() * Xi_3 * ov_core::skew_x(w_k);
+    Eigen::Matrix3d skew_wk = ov_core::skew_x(w_k);
+    F.block(th_id, th_wtoI_id, 3, 3) = dRJr_dt * skew_wk;
+    F.block(p_id, th_wtoI_id, 3, 3) = -RkXi4 * skew_wk;
+    F.block(v_id, th_wtoI_id, 3, 3) = -RkXi3 * skew_wk;
     F.block(th_wtoI_id, th_wtoI_id, 3, 3).setIdentity();
   }
 
   // construct the G part
-  G.block(th_id, 0, 3, 3) = -dR_ktok1 * Jr_ktok1 * dt * R_wtoI * Dw;
-  G.block(p_id, 0, 3, 3) = R_k.transpose() * Xi_4 * R_wtoI * Dw;
-  G.block(v_id, 0, 3, 3) = R_k.transpose() * Xi_3 * R_wtoI * Dw;
-  G.block(th_id, 3, 3, 3) = dR_ktok1 * Jr_ktok1 * dt * R_wtoI * Dw * Tg * R_atoI * Da;
-  G.block(p_id, 3, 3, 3) = -R_k.transpose() * (Xi_2 + Xi_4 * R_wtoI * Dw * Tg) * R_atoI * Da;
-  G.block(v_id, 3, 3, 3) = -R_k.transpose() * (Xi_1 + Xi_3 * R_wtoI * Dw * Tg) * R_atoI * Da;
+  // The gyro and accel noise columns are identical to the bias columns above
+  G.block(th_id, 0, 3, 3) = F.block(th_id, bg_id, 3, 3);
+  G.block(p_id, 0, 3, 3) = F.block(p_id, bg_id, 3, 3);
+  G.block(v_id, 0, 3, 3) = F.block(v_id, bg_id, 3, 3);
+  G.block(th_id, 3, 3, 3) = F.block(th_id, ba_id, 3, 3);
+  G.block(p_id, 3, 3, 3) = F.block(p_id, ba_id, 3, 3);
+  G.block(v_id, 3, 3, 3) = F.block(v_id, ba_id, 3, 3);
   G.block(bg_id, 6, 3, 3) = dt * Eigen::Matrix3d::Identity();
   G.block(ba_id, 9, 3, 3) = dt * Eigen::Matrix3d::Identity();
 }
@@ -22,10 +22,13 @@
 #ifndef OV_MSCKF_STATE_PROPAGATOR_H
 #define OV_MSCKF_STATE_PROPAGATOR_H
 
+#include <algorithm>
 #include <atomic>
+#include <cstdint>
 #include <memory>
 #include <mutex>
 
+#include "utils/lockfree_queue.h"
 #include "utils/sensor_data.h"
 
 #include "utils/NoiseManager.h"
@@ -49,10 +52,7 @@ public:
    * @param gravity_mag Global gravity magnitude of the system (normally 9.81)
    */
   Propagator(NoiseManager noises, double gravity_mag) : _noises(noises), cache_imu_valid(false) {
-    _noises.sigma_w_2 = std::pow(_noises.sigma_w, 2);
-    _noises.sigma_a_2 = std::pow(_noises.sigma_a, 2);
-    _noises.sigma_wb_2 = std::pow(_noises.sigma_wb, 2);
-    _noises.sigma_ab_2 = std::pow(_noises.sigma_ab, 2);
+    _noises.prepare();
     last_prop_time_offset = 0.0;
     _gravity << 0.0, 0.0, gravity_mag;
   }
@@ -64,13 +64,17 @@ public:
    */
   void feed_imu(const ov_core::ImuData &message, double oldest_time = -1) {
 
-    // Append it to our vector
-    std::lock_guard<std::mutex> lck(imu_data_mtx);
-    imu_data.emplace_back(message);
+    // Record the discard horizon, it is applied when the consumer drains the queue
+    if (oldest_time >= 0)
+      imu_oldest_time = oldest_time - 0.10;
 
-    // Clean old measurements
-    // std::cout << "PROP: imu_data.size() " << imu_data.size() << std::endl;
-    clean_old_imu_measurements(oldest_time - 0.10);
+    // Append it to our lock-free queue so the IMU callback never blocks on the
+    // estimation thread (it is drained on the next propagation call)
+    // If the ring is full (the consumer has stalled) fall back to the locked overflow
+    if (!imu_data_queue.push(message)) {
+      std::lock_guard<std::mutex> lck(imu_data_mtx);
+      imu_data_overflow.emplace_back(message);
+    }
   }
 
   /**
@@ -80,20 +84,21 @@ public:
   void clean_old_imu_measurements(double oldest_time) {
     if (oldest_time < 0)
       return;
-    auto it0 = imu_data.begin();
-    while (it0 != imu_data.end()) {
-      if (it0->timestamp < oldest_time) {
-        it0 = imu_data.erase(it0);
-      } else {
-        it0++;
-      }
-    }
+    std::lock_guard<std::mutex> lck(imu_data_mtx);
+    clean_old_imu_measurements_nolock(oldest_time);
   }
 
   /**
-   * @brief Will invalidate the cache used for fast propagation
+   * @brief Will invalidate the cache used for fast propagation and the preintegration memo
+   *
+   * This must be called whenever the state estimate changes outside of propagation
+   * (any EKF update, and in particular any bias update), since both caches are only
+   * valid at the linearization point they were computed at.
    */
-  void invalidate_cache() { cache_imu_valid = false; }
+  void invalidate_cache() {
+    cache_imu_valid = false;
+    preint_valid = false;
+  }
 
   /**
    * @brief Propagate state up to given timestamp and then clone
@@ -125,6 +130,38 @@ public:
   bool fast_state_propagate(std::shared_ptr<State> state, double timestamp, Eigen::Matrix<double, 13, 1> &state_plus,
                             Eigen::Matrix<double, 12, 12> &covariance);
 
+  /**
+   * @brief Lock-free read of the most recent fast-propagated state
+   *
+   * fast_state_propagate() acts as our predict-ahead service: the odometry publisher
+   * drives it once per incoming IMU sample and, thanks to its internal cache, each
+   * call only integrates the samples that arrived since the previous one. Every call
+   * publishes its result through a seqlock, so any number of additional high-rate
+   * consumers can snapshot the latest prediction here without taking the propagator
+   * locks or re-integrating any part of the IMU window.
+   *
+   * @param timestamp Time the snapshot is valid at (IMU clock frame)
+   * @param state_plus The propagated state (q_GtoI, p_IinG, v_IinI, w_IinI)
+   * @param covariance The propagated covariance (q_GtoI, p_IinG, v_IinI, w_IinI)
+   * @return True if a fast-propagated state has been published yet
+   */
+  bool get_fast_state_snapshot(double &timestamp, Eigen::Matrix<double, 13, 1> &state_plus, Eigen::Matrix<double, 12, 12> &covariance);
+
+  /**
+   * @brief Integrates only the gyroscope between two times to get the relative IMU rotation.
+   *
+   * This is a cheap gyro-only compounding (no covariance, no IMU intrinsic model) meant for
+   * consumers that just need a rotation prediction, e.g. seeding the feature tracker with where
+   * features should reappear. The timestamps passed should already take into account the time offset.
+   *
+   * @param time0 Start timestamp (IMU clock frame)
+   * @param time1 End timestamp (IMU clock frame)
+   * @param bias_g Current gyroscope bias estimate to correct the readings with
+   * @param R_I0toI1 Relative rotation of the IMU frame over the interval
+   * @return True if we had enough IMU measurements to integrate
+   */
+  bool get_gyro_relative_rotation(double time0, double time1, const Eigen::Vector3d &bias_g, Eigen::Matrix3d &R_I0toI1);
+
   /**
    * @brief Helper function that given current imu data, will select imu readings between the two times.
    *
@@ -141,6 +178,23 @@ public:
   static std::vector<ov_core::ImuData> select_imu_readings(const std::vector<ov_core::ImuData> &imu_data, double time0, double time1,
                                                            bool warn = true);
 
+  /**
+   * @brief Selects imu readings between the two times from our own history (cursor-accelerated).
+   *
+   * This is the member variant used by our propagation paths, which has two advantages over
+   * the static function: it starts the scan from a remembered cursor instead of the front of
+   * the history (propagation times are monotonic, so this is amortized constant), and it fills
+   * a caller-owned vector so its capacity is reused across frames instead of reallocating.
+   * The selected measurements are copied out under the lock, thus they stay valid for the
+   * whole integration even if the history is trimmed or appended to concurrently.
+   *
+   * @param time0 Start timestamp
+   * @param time1 End timestamp
+   * @param prop_data Cleared and filled with the selected measurements (if we could compute them)
+   * @param warn If we should warn if we don't have enough IMU to propagate with (e.g. fast prop will get warnings otherwise)
+   */
+  void select_imu_readings(double time0, double time1, std::vector<ov_core::ImuData> &prop_data, bool warn = true);
+
   /**
    * @brief Nice helper function that will linearly interpolate between two imu messages.
    *
@@ -438,10 +492,76 @@ protected:
   /// Container for the noise values
   NoiseManager _noises;
 
+  /**
+   * @brief Moves measurements from the lock-free feed queue into our history vector
+   *
+   * Must be called while holding imu_data_mtx, and only from the estimation thread
+   * (it is the single consumer of the feed queue). This also applies the discard
+   * horizon that feed_imu() recorded and re-sorts if the overflow path was hit.
+   */
+  void drain_imu_queue() {
+    ov_core::ImuData message;
+    while (imu_data_queue.pop(message))
+      imu_data.emplace_back(message);
+    if (!imu_data_overflow.empty()) {
+      imu_data.insert(imu_data.end(), imu_data_overflow.begin(), imu_data_overflow.end());
+      imu_data_overflow.clear();
+      std::sort(imu_data.begin(), imu_data.end());
+    }
+    clean_old_imu_measurements_nolock(imu_oldest_time.exchange(-1));
+  }
+
+  /// Removes IMU measurements older than the given time (imu_data_mtx must be held)
+  void clean_old_imu_measurements_nolock(double oldest_time) {
+    if (oldest_time < 0)
+      return;
+    // The history is sorted, so all stale entries form a prefix we can erase in one shift
+    auto it1 = std::lower_bound(imu_data.begin(), imu_data.end(), oldest_time,
+                                [](const ov_core::ImuData &data, double time) { return data.timestamp < time; });
+    size_t num_erased = (size_t)std::distance(imu_data.begin(), it1);
+    imu_data.erase(imu_data.begin(), it1);
+    imu_select_cursor = (imu_select_cursor > num_erased) ? imu_select_cursor - num_erased : 0;
+  }
+
+  /**
+   * @brief Core selection logic shared by the static and member select_imu_readings()
+   *
+   * Identical semantics to the original front-scan, except the scan starts from the passed
+   * hint index, which is first rewound (if the hint is past time0) and then advanced to the
+   * reading bracketing time0. The hint is only an accelerator, correctness never depends on
+   * it, so any stale value (e.g. after a re-sort of the history) just costs a longer walk.
+   *
+   * @param imu_data IMU data we will select measurements from
+   * @param time0 Start timestamp
+   * @param time1 End timestamp
+   * @param hint Index to start the scan from (pass 0 for a full scan)
+   * @param prop_data Cleared and filled with the selected measurements (if we could compute them)
+   * @param warn If we should warn if we don't have enough IMU to propagate with
+   * @return Index of the reading bracketing time0, to be remembered as the next hint
+   */
+  static size_t select_imu_readings_from(const std::vector<ov_core::ImuData> &imu_data, double time0, double time1, size_t hint,
+                                         std::vector<ov_core::ImuData> &prop_data, bool warn);
+
   /// Our history of IMU messages (time, angular, linear)
   std::vector<ov_core::ImuData> imu_data;
   std::mutex imu_data_mtx;
 
+  /// Remembered index of the reading that bracketed the last selection's start time
+  /// (scan hint for the member select_imu_readings(), guarded by imu_data_mtx)
+  size_t imu_select_cursor = 0;
+
+  /// Reusable selection buffers (one per calling path) so per-frame propagation setup does not allocate
+  std::vector<ov_core::ImuData> prop_data_prop, prop_data_fast, prop_data_gyro;
+
+  /// Lock-free queue the IMU callback deposits into (drained by the estimation thread)
+  ov_core::LockFreeSpscQueue<ov_core::ImuData> imu_data_queue{1024};
+
+  /// Overflow storage used only if the lock-free queue fills up (guarded by imu_data_mtx)
+  std::vector<ov_core::ImuData> imu_data_overflow;
+
+  /// Discard horizon recorded by feed_imu(), applied when the queue is drained
+  std::atomic<double> imu_oldest_time{-1};
+
   /// Gravity vector
   Eigen::Vector3d _gravity;
 
@@ -455,6 +575,24 @@ protected:
   Eigen::MatrixXd cache_state_est;
   Eigen::MatrixXd cache_state_covariance;
   double cache_t_off;
+
+  /// Preintegration memo for propagate_and_clone: the summed state transition, noise
+  /// and resulting IMU mean over the last integrated [time0, time1] window, keyed by
+  /// the window bounds and the IMU mean (linearization point) it started from
+  bool preint_valid = false;
+  double preint_time0 = -1;
+  double preint_time1 = -1;
+  Eigen::MatrixXd preint_state_start;
+  Eigen::MatrixXd preint_state_end;
+  Eigen::MatrixXd preint_Phi;
+  Eigen::MatrixXd preint_Qd;
+
+  /// Seqlock sequence counter for the fast-propagate snapshot (odd while the single
+  /// writer, fast_state_propagate, is mid-update; zero until the first publish)
+  std::atomic<uint32_t> fast_snapshot_seq{0};
+  double fast_snapshot_time = -1;
+  Eigen::Matrix<double, 13, 1> fast_snapshot_state;
+  Eigen::Matrix<double, 12, 12> fast_snapshot_cov;
 };
 
 } // namespace ov_msckf
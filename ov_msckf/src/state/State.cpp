@@ -21,11 +21,16 @@
 
 #include "State.h"
 
+#include <cstdint>
+#include <cstring>
+
+#include "utils/memory_arena.h"
+
 using namespace ov_core;
 using namespace ov_type;
 using namespace ov_msckf;
 
-State::State(StateOptions &options) {
+State::State(StateOptions &options) : _Cov(nullptr, 0, 0, Eigen::OuterStride<>(0)) {
 
   // Save our options
   _options = options;
@@ -133,37 +138,154 @@ State::State(StateOptions &options) {
     }
   }
 
+  // If the covariance capacity is bounded at compile time, make sure this configuration fits
+  // (worst case is all clones plus all SLAM and ARUCO landmarks in the state at once)
+#if OV_MSCKF_MAX_COV_SIZE > 0
+  int max_cov_size = current_id + 6 * _options.max_clone_size + 3 * (_options.max_slam_features + _options.max_aruco_features);
+  if (max_cov_size > OV_MSCKF_MAX_COV_SIZE) {
+    PRINT_ERROR(RED "State(): configuration can reach a %d dim covariance, but this build was bounded at %d!\n" RESET, max_cov_size,
+                OV_MSCKF_MAX_COV_SIZE);
+    PRINT_ERROR(RED "State(): reduce the window/landmark limits or rebuild with a larger MAX_COV_SIZE\n" RESET);
+    std::exit(EXIT_FAILURE);
+  }
+#endif
+
+  // Allocate the covariance backing storage once at the worst case dimension: all clones
+  // plus all SLAM and ARUCO landmarks in the state at once, plus the transient extra
+  // clone that exists between augmentation and marginalization. The capacity is padded up
+  // to a full cache line of elements and used as the fixed map stride, so every column
+  // starts 64-byte aligned no matter what size the filter grows to.
+  int worst_case = current_id + 6 * (_options.max_clone_size + 1) + 3 * (_options.max_slam_features + _options.max_aruco_features);
+  const int align_elems = 64 / (int)sizeof(CovScalar);
+  _Cov_capacity = ((worst_case + align_elems - 1) / align_elems) * align_elems;
+  size_t cov_elems = (size_t)_Cov_capacity * _Cov_capacity + align_elems;
+  if (ov_core::MemoryArena::enabled()) {
+    // Arena blocks are already 64-byte aligned (and hugepage-backed when configured so)
+    _Cov_data = (CovScalar *)ov_core::MemoryArena::allocate(cov_elems * sizeof(CovScalar));
+    _Cov_from_arena = true;
+  } else {
+    _Cov_storage.resize(cov_elems);
+    _Cov_data = (CovScalar *)(((uintptr_t)_Cov_storage.data() + 63) & ~(uintptr_t)63);
+  }
+  resize_covariance(current_id);
+
   // Finally initialize our covariance to small value
-  _Cov = std::pow(1e-3, 2) * Eigen::MatrixXd::Identity(current_id, current_id);
+  // NOTE: the covariance is stored in CovScalar (float on single precision builds)
+  _Cov = CovScalar(std::pow(1e-3, 2)) * CovMatrix::Identity(current_id, current_id);
 
   // Finally, set some of our priors for our calibration parameters
   if (_options.do_calib_imu_intrinsics) {
-    _Cov.block(_calib_imu_dw->id(), _calib_imu_dw->id(), 6, 6) = std::pow(0.005, 2) * Eigen::Matrix<double, 6, 6>::Identity();
-    _Cov.block(_calib_imu_da->id(), _calib_imu_da->id(), 6, 6) = std::pow(0.008, 2) * Eigen::Matrix<double, 6, 6>::Identity();
+    _Cov.block(_calib_imu_dw->id(), _calib_imu_dw->id(), 6, 6) = CovScalar(std::pow(0.005, 2)) * CovMatrix::Identity(6, 6);
+    _Cov.block(_calib_imu_da->id(), _calib_imu_da->id(), 6, 6) = CovScalar(std::pow(0.008, 2)) * CovMatrix::Identity(6, 6);
     if (_options.do_calib_imu_g_sensitivity) {
-      _Cov.block(_calib_imu_tg->id(), _calib_imu_tg->id(), 9, 9) = std::pow(0.005, 2) * Eigen::Matrix<double, 9, 9>::Identity();
+      _Cov.block(_calib_imu_tg->id(), _calib_imu_tg->id(), 9, 9) = CovScalar(std::pow(0.005, 2)) * CovMatrix::Identity(9, 9);
     }
     if (_options.imu_model == StateOptions::ImuModel::KALIBR) {
-      _Cov.block(_calib_imu_GYROtoIMU->id(), _calib_imu_GYROtoIMU->id(), 3, 3) = std::pow(0.005, 2) * Eigen::Matrix3d::Identity();
+      _Cov.block(_calib_imu_GYROtoIMU->id(), _calib_imu_GYROtoIMU->id(), 3, 3) = CovScalar(std::pow(0.005, 2)) * CovMatrix::Identity(3, 3);
     } else {
-      _Cov.block(_calib_imu_ACCtoIMU->id(), _calib_imu_ACCtoIMU->id(), 3, 3) = std::pow(0.005, 2) * Eigen::Matrix3d::Identity();
+      _Cov.block(_calib_imu_ACCtoIMU->id(), _calib_imu_ACCtoIMU->id(), 3, 3) = CovScalar(std::pow(0.005, 2)) * CovMatrix::Identity(3, 3);
     }
   }
   if (_options.do_calib_camera_timeoffset) {
-    _Cov(_calib_dt_CAMtoIMU->id(), _calib_dt_CAMtoIMU->id()) = std::pow(0.01, 2);
+    _Cov(_calib_dt_CAMtoIMU->id(), _calib_dt_CAMtoIMU->id()) = CovScalar(std::pow(0.01, 2));
   }
   if (_options.do_calib_camera_pose) {
     for (int i = 0; i < _options.num_cameras; i++) {
-      _Cov.block(_calib_IMUtoCAM.at(i)->id(), _calib_IMUtoCAM.at(i)->id(), 3, 3) = std::pow(0.005, 2) * Eigen::MatrixXd::Identity(3, 3);
+      _Cov.block(_calib_IMUtoCAM.at(i)->id(), _calib_IMUtoCAM.at(i)->id(), 3, 3) = CovScalar(std::pow(0.005, 2)) * CovMatrix::Identity(3, 3);
       _Cov.block(_calib_IMUtoCAM.at(i)->id() + 3, _calib_IMUtoCAM.at(i)->id() + 3, 3, 3) =
-          std::pow(0.015, 2) * Eigen::MatrixXd::Identity(3, 3);
+          CovScalar(std::pow(0.015, 2)) * CovMatrix::Identity(3, 3);
     }
   }
   if (_options.do_calib_camera_intrinsics) {
     for (int i = 0; i < _options.num_cameras; i++) {
-      _Cov.block(_cam_intrinsics.at(i)->id(), _cam_intrinsics.at(i)->id(), 4, 4) = std::pow(1.0, 2) * Eigen::MatrixXd::Identity(4, 4);
+      _Cov.block(_cam_intrinsics.at(i)->id(), _cam_intrinsics.at(i)->id(), 4, 4) = CovScalar(std::pow(1.0, 2)) * CovMatrix::Identity(4, 4);
       _Cov.block(_cam_intrinsics.at(i)->id() + 4, _cam_intrinsics.at(i)->id() + 4, 4, 4) =
-          std::pow(0.005, 2) * Eigen::MatrixXd::Identity(4, 4);
+          CovScalar(std::pow(0.005, 2)) * CovMatrix::Identity(4, 4);
+    }
+  }
+
+  // Build the flat variable mirror now that all startup variables have their ids
+  rebuild_variables_flat();
+}
+
+State::~State() {
+  // Return the covariance block so a restarted filter can reuse the arena space
+  if (_Cov_from_arena)
+    ov_core::MemoryArena::deallocate(_Cov_data);
+}
+
+void State::resize_covariance(int new_size) {
+
+  // If the requested size somehow exceeds the preallocated worst case then regrow the
+  // backing storage with a copy (this should not happen with an honestly sized
+  // configuration, so warn loudly rather than silently eating reallocations)
+  int old_size = (int)_Cov.rows();
+  if (new_size > _Cov_capacity) {
+    PRINT_WARNING(YELLOW "State::resize_covariance(): %d exceeds the preallocated capacity %d, reallocating!\n" RESET, new_size,
+                  _Cov_capacity);
+    const int align_elems = 64 / (int)sizeof(CovScalar);
+    int new_capacity = ((2 * new_size + align_elems - 1) / align_elems) * align_elems;
+    size_t new_elems = (size_t)new_capacity * new_capacity + align_elems;
+    std::vector<CovScalar> new_storage;
+    CovScalar *new_data = nullptr;
+    bool new_from_arena = ov_core::MemoryArena::enabled();
+    if (new_from_arena) {
+      new_data = (CovScalar *)ov_core::MemoryArena::allocate(new_elems * sizeof(CovScalar));
+    } else {
+      new_storage.resize(new_elems);
+      new_data = (CovScalar *)(((uintptr_t)new_storage.data() + 63) & ~(uintptr_t)63);
+    }
+    for (int c = 0; c < old_size; c++)
+      std::memcpy(new_data + (size_t)c * new_capacity, _Cov_data + (size_t)c * _Cov_capacity, old_size * sizeof(CovScalar));
+    if (_Cov_from_arena)
+      ov_core::MemoryArena::deallocate(_Cov_data);
+    _Cov_storage.swap(new_storage);
+    _Cov_from_arena = new_from_arena;
+    _Cov_data = new_data;
+    _Cov_capacity = new_capacity;
+  }
+
+  // Re-map the active corner of the buffer and zero what growth exposed (shrinking
+  // leaves the stale values in place, they are zeroed if ever re-grown into)
+  new (&_Cov) CovMap(_Cov_data, new_size, new_size, Eigen::OuterStride<>(_Cov_capacity));
+  if (new_size > old_size) {
+    _Cov.block(0, old_size, new_size, new_size - old_size).setZero();
+    _Cov.block(old_size, 0, new_size - old_size, old_size).setZero();
+  }
+}
+
+void State::publish_snapshot() {
+
+  // Build the fresh snapshot (never touch the one that is already published)
+  auto snap = std::make_shared<StateSnapshot>();
+  snap->version = ++_snapshot_version;
+  snap->timestamp = _timestamp;
+  snap->imu_value = _imu->value().block(0, 0, 16, 1);
+  snap->calib_dt = _calib_dt_CAMtoIMU->value()(0);
+
+  // Value of each clone pose
+  for (const auto &clone : _clones_IMU) {
+    snap->clones_IMU[clone.first] = clone.second->value();
+  }
+
+  // Landmark means, resolved into the global frame if they are anchored
+  for (const auto &f : _features_SLAM) {
+    if (LandmarkRepresentation::is_relative_representation(f.second->_feat_representation)) {
+      // Assert that we have an anchor pose for this feature
+      assert(f.second->_anchor_cam_id != -1);
+      // Get calibration for our anchor camera
+      Eigen::Matrix3d R_ItoC = _calib_IMUtoCAM.at(f.second->_anchor_cam_id)->Rot();
+      Eigen::Vector3d p_IinC = _calib_IMUtoCAM.at(f.second->_anchor_cam_id)->pos();
+      // Anchor pose orientation and position
+      Eigen::Matrix3d R_GtoI = _clones_IMU.at(f.second->_anchor_clone_timestamp)->Rot();
+      Eigen::Vector3d p_IinG = _clones_IMU.at(f.second->_anchor_clone_timestamp)->pos();
+      // Feature in the global frame
+      snap->features_SLAM[f.first] = R_GtoI.transpose() * R_ItoC.transpose() * (f.second->get_xyz(false) - p_IinC) + p_IinG;
+    } else {
+      snap->features_SLAM[f.first] = f.second->get_xyz(false);
     }
   }
+
+  // Swap it in for the readers
+  std::atomic_store(&_snapshot, std::shared_ptr<const StateSnapshot>(snap));
 }
@@ -22,13 +22,17 @@
 #ifndef OV_MSCKF_STATE_H
 #define OV_MSCKF_STATE_H
 
+#include <atomic>
 #include <map>
 #include <memory>
 #include <mutex>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
+#include "CloneIndex.h"
 #include "StateOptions.h"
+#include "StateSnapshot.h"
 #include "cam/CamBase.h"
 #include "types/IMU.h"
 #include "types/Landmark.h"
@@ -38,6 +42,39 @@
 
 namespace ov_msckf {
 
+/// Scalar type the filter covariance is *stored* in.
+/// On memory-bandwidth limited embedded targets the covariance can be stored in single
+/// precision (build with ENABLE_SINGLE_PRECISION_COV) which halves the bytes moved per
+/// propagation and update. All covariance arithmetic still accumulates in double (see
+/// StateHelper), only the resting storage is narrowed. Defaults to double.
+#ifdef ENABLE_SINGLE_PRECISION_COV
+typedef float CovScalar;
+#else
+typedef double CovScalar;
+#endif
+
+/// Compile-time upper bound on the covariance dimension (0 keeps it fully dynamic).
+/// Deployed targets run a fixed sliding-window configuration, so the max state size is
+/// known when building for one: set MAX_COV_SIZE in CMake and the covariance gets fixed
+/// inline storage (resizes never reallocate, and Eigen knows the bound when sizing its
+/// kernels). The State constructor checks the configured options fit the bound.
+#ifndef OV_MSCKF_MAX_COV_SIZE
+#define OV_MSCKF_MAX_COV_SIZE 0
+#endif
+
+/// Dense dynamic matrix of the covariance storage scalar (capacity-bounded if requested)
+#if OV_MSCKF_MAX_COV_SIZE > 0
+typedef Eigen::Matrix<CovScalar, Eigen::Dynamic, Eigen::Dynamic, 0, OV_MSCKF_MAX_COV_SIZE, OV_MSCKF_MAX_COV_SIZE> CovMatrix;
+#else
+typedef Eigen::Matrix<CovScalar, Eigen::Dynamic, Eigen::Dynamic> CovMatrix;
+#endif
+
+/// Map the live covariance is accessed through (see State::resize_covariance).
+/// The outer stride is the storage capacity rather than the active size, so growing the
+/// covariance just re-maps a larger top-left corner of the same preallocated buffer: no
+/// reallocation, no copy, and every column keeps its 64-byte cache-line alignment.
+typedef Eigen::Map<Eigen::Matrix<CovScalar, Eigen::Dynamic, Eigen::Dynamic>, Eigen::Aligned64, Eigen::OuterStride<>> CovMap;
+
 /**
  * @brief State of our filter
  *
@@ -55,7 +92,7 @@ public:
    */
   State(StateOptions &options_);
 
-  ~State() {}
+  ~State();
 
   /**
    * @brief Will return the timestep that we will marginalize next.
@@ -156,12 +193,62 @@ public:
     _imu->reset_keyframe_states();
     _Cov.block(_imu->keyframe_pose()->id(), 0, 6, _Cov.cols()).setZero();
     _Cov.block(0, _imu->keyframe_pose()->id(), _Cov.rows(), 6).setZero();
-    _Cov.block(_imu->keyframe_pose()->id(), _imu->keyframe_pose()->id(), 3, 3) = 1e-9 * Eigen::MatrixXd::Identity(3, 3);
-    _Cov.block(_imu->keyframe_pose()->id() + 3, _imu->keyframe_pose()->id() + 3, 3, 3) = 1e-9 * Eigen::MatrixXd::Identity(3, 3);
+    _Cov.block(_imu->keyframe_pose()->id(), _imu->keyframe_pose()->id(), 3, 3) = CovScalar(1e-9) * CovMatrix::Identity(3, 3);
+    _Cov.block(_imu->keyframe_pose()->id() + 3, _imu->keyframe_pose()->id() + 3, 3, 3) = CovScalar(1e-9) * CovMatrix::Identity(3, 3);
 
     return delta_pose;
   }
 
+  /**
+   * @brief O(1) lookup of a clone pose by its imaging time.
+   *
+   * Resolves through the quantized-timestamp hash index, so it is also robust to
+   * sub-microsecond timestamp jitter that exact-double map lookups are not.
+   *
+   * @param timestamp Imaging time of the desired clone
+   * @return The clone pose, or nullptr if no clone exists at that time
+   */
+  std::shared_ptr<ov_type::PoseJPL> get_clone(double timestamp) const { return _clones_index.get(timestamp); }
+
+  /**
+   * @brief Converts a camera-clock time into the imu clock (t_imu = t_cam + t_d).
+   *
+   * Single point of truth for applying the estimated camera-imu time offset.
+   * Call sites should convert once per frame and pass the corrected time along,
+   * rather than re-reading @ref _calib_dt_CAMtoIMU at each use, so that all
+   * quantities derived from one frame agree even if t_d is refined by an update.
+   *
+   * @param timestamp_cam Measurement time in the camera clock frame
+   * @return The same instant expressed in the imu clock frame
+   */
+  double imu_time(double timestamp_cam) const { return timestamp_cam + _calib_dt_CAMtoIMU->value()(0); }
+
+  /**
+   * @brief Converts an imu-clock time into the camera clock (t_cam = t_imu - t_d), inverse of @ref imu_time().
+   *
+   * @param timestamp_imu Measurement time in the imu clock frame
+   * @return The same instant expressed in the camera clock frame
+   */
+  double cam_time(double timestamp_imu) const { return timestamp_imu - _calib_dt_CAMtoIMU->value()(0); }
+
+  /**
+   * @brief Latest published read-only snapshot of the estimate (may be nullptr before the first update).
+   *
+   * The returned object is immutable, so a reader can hold onto it and assemble messages from it
+   * without taking @ref _mutex_state and without racing the filter thread. Each update publishes a
+   * fresh snapshot (copy-on-write), identified by StateSnapshot::version.
+   */
+  std::shared_ptr<const StateSnapshot> get_snapshot() const { return std::atomic_load(&_snapshot); }
+
+  /**
+   * @brief Builds a fresh snapshot of the current estimate and atomically publishes it.
+   *
+   * Called by StateHelper::EKFUpdate once the state values are final for this timestep.
+   * Must only be called by the thread that owns the state, and never modifies a snapshot
+   * that has already been handed out.
+   */
+  void publish_snapshot();
+
   /// Mutex for locking access to the state
   std::mutex _mutex_state;
 
@@ -175,8 +262,16 @@ public:
   std::shared_ptr<ov_type::IMU> _imu;
 
   /// Map between imaging times and clone poses (q_GtoIi, p_IiinG)
+  /// NOTE: this remains the container for ordered iteration, use get_clone() for hot lookups
   std::map<double, std::shared_ptr<ov_type::PoseJPL>> _clones_IMU;
 
+  /// Quantized-timestamp hash over the clones, kept in sync with _clones_IMU at its mutation sites
+  CloneIndex _clones_index;
+
+  /// Pool of clone poses recycled by marginalization so cloning does not allocate
+  /// (bounded by the fixed window size, see StateHelper::augment_clone())
+  std::vector<std::shared_ptr<ov_type::PoseJPL>> _clone_pool;
+
   /// Our current set of SLAM features (3d positions)
   std::unordered_map<size_t, std::shared_ptr<ov_type::Landmark>> _features_SLAM;
 
@@ -216,11 +311,78 @@ private:
   // This prevents a developer from thinking that the "insert clone" will actually correctly add it to the covariance
   friend class StateHelper;
 
-  /// Covariance of all active variables
-  Eigen::MatrixXd _Cov;
+  // The marginal covariance view references blocks of the covariance directly
+  friend class MarginalCovarianceView;
+
+  /// Covariance of all active variables (stored in CovScalar, see the typedef above).
+  /// Maps into _Cov_storage, which is allocated once at the worst-case dimension implied
+  /// by the options, so covariance growth never reallocates (see resize_covariance).
+  /// NOTE: only the upper triangle is maintained (symmetry is structural, there is no
+  /// NOTE: mirror pass) -- everything below the diagonal is stale and must not be read,
+  /// NOTE: all access goes through the StateHelper / MarginalCovarianceView kernels
+  CovMap _Cov;
+
+  /// Backing buffer for the covariance map (capacity * capacity elements plus alignment slack)
+  /// Left empty when the storage comes from the preallocated arena instead (see below)
+  std::vector<CovScalar> _Cov_storage;
+
+  /// 64-byte aligned start of the covariance inside _Cov_storage (or the arena block)
+  CovScalar *_Cov_data = nullptr;
+
+  /// True if _Cov_data was handed out by ov_core::MemoryArena (returned in the destructor)
+  bool _Cov_from_arena = false;
+
+  /// Allocated covariance dimension, which is also the fixed outer stride of the map
+  int _Cov_capacity = 0;
+
+  /**
+   * @brief Re-maps the covariance to the given active dimension.
+   *
+   * Growing zeroes the newly exposed rows and columns (they can hold stale values from a
+   * previous shrink), shrinking only re-maps. The retained top-left corner never moves
+   * since the outer stride stays at the storage capacity. If the requested size somehow
+   * exceeds the preallocated worst case the storage is regrown with a copy and a warning,
+   * so a mis-sized configuration degrades instead of corrupting.
+   *
+   * @param new_size Dimension the active covariance should have
+   */
+  void resize_covariance(int new_size);
+
+  /// Flat {location, size} entry mirroring one state variable (see _variables_flat)
+  struct VarInfo {
+    int id;
+    int size;
+  };
 
   /// Vector of variables
   std::vector<std::shared_ptr<ov_type::Type>> _variables;
+
+  /// Contiguous mirror of each variable's covariance location and size.
+  /// The hot StateHelper loops (gain accumulation, state update) only need id/size, and
+  /// walking this flat array avoids a shared_ptr chase and virtual-size load per variable.
+  /// Kept in sync via rebuild_variables_flat() at every variable mutation site.
+  std::vector<VarInfo> _variables_flat;
+
+  /// Rebuilds the flat variable mirror (call after adding, removing, or moving variables)
+  void rebuild_variables_flat() {
+    _variables_flat.clear();
+    for (const auto &var : _variables) {
+      _variables_flat.push_back({var->id(), var->size()});
+    }
+  }
+
+  /// Free covariance slots (start index, size) left behind by marginalized variables.
+  /// These rows/columns are kept zeroed until a new variable of the same size reuses them.
+  std::vector<std::pair<int, int>> _Cov_free_slots;
+
+  /// Marginalizations since the last compaction pass (see StateOptions::cov_compact_interval)
+  int _margs_since_compact = 0;
+
+  /// Latest published snapshot, only access through std::atomic_load/std::atomic_store
+  std::shared_ptr<const StateSnapshot> _snapshot;
+
+  /// Number of snapshots published so far (only touched by the publishing thread)
+  uint64_t _snapshot_version = 0;
 };
 
 } // namespace ov_msckf
@@ -24,15 +24,117 @@
 #include "state/State.h"
 
 #include "types/Landmark.h"
+#include "utils/chi_square_table.h"
 #include "utils/colors.h"
 #include "utils/print.h"
 
-#include <boost/math/distributions/chi_squared.hpp>
+#include <limits>
 
 using namespace ov_core;
 using namespace ov_type;
 using namespace ov_msckf;
 
+Eigen::MatrixXd MarginalCovarianceView::cache_cov;
+std::unordered_map<int, int> MarginalCovarianceView::cache_offsets;
+
+// The covariance only maintains its upper triangle (see the note on State::_Cov): the
+// rank-update and strip-write kernels below never touch the lower triangle, so symmetry
+// is structural and no per-update mirror pass exists. Anything below the diagonal is
+// stale and must never be read. These helpers centralize the triangle bookkeeping for
+// the two access patterns everything else is built from.
+
+// Covariance block between two variable ranges, widened to double for accumulation.
+// Blocks below the diagonal are served as the transpose of their upper-triangle mirror,
+// and diagonal blocks are completed from their own upper triangle.
+static Eigen::MatrixXd cov_block(const CovMap &cov, int row_id, int row_size, int col_id, int col_size) {
+  if (row_id < col_id)
+    return cov.block(row_id, col_id, row_size, col_size).cast<double>();
+  if (row_id > col_id)
+    return cov.block(col_id, row_id, col_size, row_size).cast<double>().transpose();
+  assert(row_size == col_size);
+  Eigen::MatrixXd diag = cov.block(row_id, col_id, row_size, col_size).cast<double>();
+  return Eigen::MatrixXd(diag.selfadjointView<Eigen::Upper>());
+}
+
+// Reads the full symmetric column strip Cov(:, id:id+size) out of the triangle storage
+// (the matching row strip is its transpose, so one strip serves both orientations)
+static void cov_read_strip(const CovMap &cov, int id, int size, Eigen::Matrix<CovScalar, Eigen::Dynamic, Eigen::Dynamic> &strip) {
+  int n = (int)cov.rows();
+  strip.resize(n, size);
+  strip.topRows(id) = cov.block(0, id, id, size);
+  strip.middleRows(id, size) = cov.block(id, id, size, size).selfadjointView<Eigen::Upper>();
+  strip.bottomRows(n - id - size) = cov.block(id, id + size, size, n - id - size).transpose();
+}
+
+// Writes a variable's symmetric column strip back into the triangle storage: the part
+// above the variable as columns, the part after it as (transposed) rows, plus the diagonal
+static void cov_write_strip(CovMap &cov, int id, int size, const Eigen::Matrix<CovScalar, Eigen::Dynamic, Eigen::Dynamic> &strip) {
+  int n = (int)cov.rows();
+  cov.block(0, id, id, size) = strip.topRows(id);
+  cov.block(id, id, size, size) = strip.middleRows(id, size);
+  cov.block(id, id + size, size, n - id - size) = strip.bottomRows(n - id - size).transpose();
+}
+
+MarginalCovarianceView::MarginalCovarianceView(const std::shared_ptr<State> &state,
+                                               const std::vector<std::shared_ptr<Type>> &small_variables, bool use_gating_cache)
+    : _cov(state->_Cov) {
+  for (const auto &var : small_variables) {
+    _ids.push_back(var->id());
+    _sizes.push_back(var->size());
+    _offsets.push_back(_rows);
+    _rows += var->size();
+  }
+  // Resolve the cache offsets if the caller wants the per-pass gating cache
+  // (fall back to the live covariance if any variable is not in the cache)
+  if (use_gating_cache) {
+    for (const auto &var : small_variables) {
+      auto it = cache_offsets.find(var->id());
+      if (it == cache_offsets.end()) {
+        _cids.clear();
+        return;
+      }
+      _cids.push_back(it->second);
+    }
+    _cached = &cache_cov;
+  }
+}
+
+Eigen::MatrixXd MarginalCovarianceView::block(size_t i, size_t k) const {
+  return cov_block(_cov, _ids.at(i), _sizes.at(i), _ids.at(k), _sizes.at(k));
+}
+
+Eigen::MatrixXd MarginalCovarianceView::quadratic_form(const Eigen::MatrixXd &H) const {
+  assert(H.cols() == _rows);
+  // Accumulate P*H^T in per-variable row strips, then one final product
+  // NOTE: covariance reads are widened to double here, a no-op on double storage builds
+  // NOTE: the cached path reads the pre-widened contiguous gating buffer instead
+  Eigen::MatrixXd PHt = Eigen::MatrixXd::Zero(_rows, H.rows());
+  for (size_t i = 0; i < _ids.size(); i++) {
+    for (size_t k = 0; k < _ids.size(); k++) {
+      if (_cached != nullptr) {
+        PHt.block(_offsets.at(i), 0, _sizes.at(i), H.rows()).noalias() +=
+            _cached->block(_cids.at(i), _cids.at(k), _sizes.at(i), _sizes.at(k)) * H.middleCols(_offsets.at(k), _sizes.at(k)).transpose();
+      } else {
+        PHt.block(_offsets.at(i), 0, _sizes.at(i), H.rows()).noalias() +=
+            block(i, k) * H.middleCols(_offsets.at(k), _sizes.at(k)).transpose();
+      }
+    }
+  }
+  return H * PHt;
+}
+
+Eigen::MatrixXd MarginalCovarianceView::dense() const {
+  // For each variable, lets copy over all other variable cross terms
+  // Note: this copies over itself to when i_index=k_index
+  Eigen::MatrixXd Small_cov(_rows, _rows);
+  for (size_t i = 0; i < _ids.size(); i++) {
+    for (size_t k = 0; k < _ids.size(); k++) {
+      Small_cov.block(_offsets.at(i), _offsets.at(k), _sizes.at(i), _sizes.at(k)) = block(i, k);
+    }
+  }
+  return Small_cov;
+}
+
 void StateHelper::EKFPropagation(std::shared_ptr<State> state, const std::vector<std::shared_ptr<Type>> &order_NEW,
                                  const std::vector<std::shared_ptr<Type>> &order_OLD, const Eigen::MatrixXd &Phi,
                                  const Eigen::MatrixXd &Q) {
@@ -75,32 +177,67 @@ void StateHelper::EKFPropagation(std::shared_ptr<State> state, const std::vector
     current_it += var->size();
   }
 
+  // Workspaces we reuse between calls (this is called at camera rate, and in the
+  // steady state the covariance size is constant, so the resize below is a no-op
+  // and propagation does not touch the allocator)
+  // NOTE: accumulation is done in double even when the covariance is stored in
+  // NOTE: single precision, only the final write back below is narrowed
+  static thread_local Eigen::MatrixXd Cov_PhiT;
+  static thread_local Eigen::MatrixXd Phi_Cov_PhiT;
+
+  // Record which sub-blocks of Phi are identically zero so we can skip them
+  // For the typical IMU transition many blocks (e.g. bias columns of untouched
+  // variables, FEJ calibration columns) are structurally zero, and the isZero
+  // scan is O(block) while each skipped multiply is O(state * block * phi)
+  std::vector<bool> Phi_nonzero;
+  for (size_t i = 0; i < order_OLD.size(); i++) {
+    std::shared_ptr<Type> var = order_OLD.at(i);
+    Phi_nonzero.push_back(!Phi.block(0, Phi_id[i], Phi.rows(), var->size()).isZero(0.0));
+  }
+
   // Loop through all our old states and get the state transition times it
   // Cov_PhiT = [ Pxx ] [ Phi' ]'
-  Eigen::MatrixXd Cov_PhiT = Eigen::MatrixXd::Zero(state->_Cov.rows(), Phi.rows());
+  Cov_PhiT.resize(state->_Cov.rows(), Phi.rows());
+  Cov_PhiT.setZero();
   for (size_t i = 0; i < order_OLD.size(); i++) {
+    if (!Phi_nonzero.at(i))
+      continue;
     std::shared_ptr<Type> var = order_OLD.at(i);
-    Cov_PhiT.noalias() +=
-        state->_Cov.block(0, var->id(), state->_Cov.rows(), var->size()) * Phi.block(0, Phi_id[i], Phi.rows(), var->size()).transpose();
+    // Only the upper triangle is stored, so the symmetric column strip of this variable
+    // is read in three pieces (above the diagonal, the diagonal itself, and the part
+    // after it which lives transposed in the variable's rows)
+    int id = var->id();
+    int size = var->size();
+    int below = (int)state->_Cov.rows() - id - size;
+    const auto PhiT_i = Phi.block(0, Phi_id[i], Phi.rows(), size).transpose();
+    Cov_PhiT.topRows(id).noalias() += state->_Cov.block(0, id, id, size).cast<double>() * PhiT_i;
+    Cov_PhiT.middleRows(id, size).noalias() += cov_block(state->_Cov, id, size, id, size) * PhiT_i;
+    Cov_PhiT.bottomRows(below).noalias() += state->_Cov.block(id, id + size, size, below).cast<double>().transpose() * PhiT_i;
   }
 
   // Get Phi_NEW*Covariance*Phi_NEW^t + Q
-  Eigen::MatrixXd Phi_Cov_PhiT = Q.selfadjointView<Eigen::Upper>();
+  Phi_Cov_PhiT.resize(Phi.rows(), Phi.rows());
+  Phi_Cov_PhiT = Q.selfadjointView<Eigen::Upper>();
   for (size_t i = 0; i < order_OLD.size(); i++) {
+    if (!Phi_nonzero.at(i))
+      continue;
     std::shared_ptr<Type> var = order_OLD.at(i);
     Phi_Cov_PhiT.noalias() += Phi.block(0, Phi_id[i], Phi.rows(), var->size()) * Cov_PhiT.block(var->id(), 0, var->size(), Phi.rows());
   }
 
   // We are good to go!
+  // Write back the moved strip into the upper triangle only: the part above the moved
+  // block as columns, the part after it as (transposed) rows, plus the new diagonal
   int start_id = order_NEW.at(0)->id();
   int phi_size = Phi.rows();
   int total_size = state->_Cov.rows();
-  state->_Cov.block(start_id, 0, phi_size, total_size) = Cov_PhiT.transpose();
-  state->_Cov.block(0, start_id, total_size, phi_size) = Cov_PhiT;
-  state->_Cov.block(start_id, start_id, phi_size, phi_size) = Phi_Cov_PhiT;
+  int strip_below = total_size - start_id - phi_size;
+  state->_Cov.block(0, start_id, start_id, phi_size) = Cov_PhiT.topRows(start_id).cast<CovScalar>();
+  state->_Cov.block(start_id, start_id + phi_size, phi_size, strip_below) = Cov_PhiT.bottomRows(strip_below).transpose().cast<CovScalar>();
+  state->_Cov.block(start_id, start_id, phi_size, phi_size) = Phi_Cov_PhiT.cast<CovScalar>();
 
   // We should check if we are not positive semi-definitate (i.e. negative diagionals is not s.p.d)
-  Eigen::VectorXd diags = state->_Cov.diagonal();
+  Eigen::VectorXd diags = state->_Cov.diagonal().cast<double>();
   bool found_neg = false;
   for (int i = 0; i < diags.rows(); i++) {
     if (diags(i) < 0.0) {
@@ -113,6 +250,98 @@ void StateHelper::EKFPropagation(std::shared_ptr<State> state, const std::vector
   }
 }
 
+void StateHelper::EKFPropagation_batch(std::shared_ptr<State> state, const std::vector<std::shared_ptr<Type>> &order_NEW,
+                                       const std::vector<std::vector<std::shared_ptr<Type>>> &orders_OLD,
+                                       const std::vector<Eigen::MatrixXd> &Phis, const std::vector<Eigen::MatrixXd> &Qs) {
+
+  // We need at least one variable, and a transition for each
+  if (order_NEW.empty() || orders_OLD.size() != order_NEW.size() || Phis.size() != order_NEW.size() || Qs.size() != order_NEW.size()) {
+    PRINT_ERROR(RED "StateHelper::EKFPropagation_batch() - Called with mismatched variable arrays!\n" RESET);
+    std::exit(EXIT_FAILURE);
+  }
+
+  // Get the location of each new variable inside the stacked transform
+  int total_new = 0;
+  std::vector<int> new_it;
+  for (const auto &var : order_NEW) {
+    new_it.push_back(total_new);
+    total_new += var->size();
+  }
+
+  // Stacked Cov_PhiT = [ Pxx ] [ Phi_1' .. Phi_k' ]
+  // Each variable's column strip only involves its own (small) old ordering, so the
+  // batch costs one pass over the covariance no matter how many variables we move
+  Eigen::MatrixXd Cov_PhiT = Eigen::MatrixXd::Zero(state->_Cov.rows(), total_new);
+  for (size_t k = 0; k < order_NEW.size(); k++) {
+    assert(order_NEW.at(k)->size() == Phis.at(k).rows());
+    assert(order_NEW.at(k)->size() == Qs.at(k).rows());
+    int phi_it = 0;
+    for (const auto &var : orders_OLD.at(k)) {
+      // Symmetric column strip read in three pieces from the upper triangle (see EKFPropagation)
+      int id = var->id();
+      int size = var->size();
+      int w = (int)Phis.at(k).rows();
+      int below = (int)state->_Cov.rows() - id - size;
+      const auto PhiT_i = Phis.at(k).block(0, phi_it, w, size).transpose();
+      Cov_PhiT.block(0, new_it[k], id, w).noalias() += state->_Cov.block(0, id, id, size).cast<double>() * PhiT_i;
+      Cov_PhiT.block(id, new_it[k], size, w).noalias() += cov_block(state->_Cov, id, size, id, size) * PhiT_i;
+      Cov_PhiT.block(id + size, new_it[k], below, w).noalias() +=
+          state->_Cov.block(id, id + size, size, below).cast<double>().transpose() * PhiT_i;
+      phi_it += var->size();
+    }
+  }
+
+  // Phi_i*Covariance*Phi_j^t for all pairs of moved variables (plus noise on the diagonal)
+  // NOTE: this must be formed from the pre-transform covariance, hence a separate pass
+  Eigen::MatrixXd Phi_Cov_PhiT = Eigen::MatrixXd::Zero(total_new, total_new);
+  for (size_t k = 0; k < order_NEW.size(); k++) {
+    int phi_it = 0;
+    for (const auto &var : orders_OLD.at(k)) {
+      Phi_Cov_PhiT.block(new_it[k], 0, Phis.at(k).rows(), total_new).noalias() +=
+          Phis.at(k).block(0, phi_it, Phis.at(k).rows(), var->size()) * Cov_PhiT.block(var->id(), 0, var->size(), total_new);
+      phi_it += var->size();
+    }
+    Phi_Cov_PhiT.block(new_it[k], new_it[k], Qs.at(k).rows(), Qs.at(k).rows()) += Qs.at(k);
+  }
+
+  // Write back each variable's strip into the upper triangle, then fix up the blocks
+  // between the moved variables themselves (their strips still held pre-transform values)
+  int total_size = state->_Cov.rows();
+  for (size_t k = 0; k < order_NEW.size(); k++) {
+    int id = order_NEW.at(k)->id();
+    int size = order_NEW.at(k)->size();
+    int below = total_size - id - size;
+    state->_Cov.block(0, id, id, size) = Cov_PhiT.block(0, new_it[k], id, size).cast<CovScalar>();
+    state->_Cov.block(id, id + size, size, below) = Cov_PhiT.block(id + size, new_it[k], below, size).transpose().cast<CovScalar>();
+  }
+  for (size_t k = 0; k < order_NEW.size(); k++) {
+    for (size_t l = k; l < order_NEW.size(); l++) {
+      // Write the block in whichever orientation lands in the stored triangle
+      Eigen::MatrixXd block = Phi_Cov_PhiT.block(new_it[k], new_it[l], order_NEW.at(k)->size(), order_NEW.at(l)->size());
+      int id_k = order_NEW.at(k)->id();
+      int id_l = order_NEW.at(l)->id();
+      if (id_k <= id_l) {
+        state->_Cov.block(id_k, id_l, block.rows(), block.cols()) = block.cast<CovScalar>();
+      } else {
+        state->_Cov.block(id_l, id_k, block.cols(), block.rows()) = block.transpose().cast<CovScalar>();
+      }
+    }
+  }
+
+  // We should check if we are not positive semi-definitate (i.e. negative diagionals is not s.p.d)
+  Eigen::VectorXd diags = state->_Cov.diagonal().cast<double>();
+  bool found_neg = false;
+  for (int i = 0; i < diags.rows(); i++) {
+    if (diags(i) < 0.0) {
+      PRINT_WARNING(RED "StateHelper::EKFPropagation_batch() - diagonal at %d is %.2f\n" RESET, i, diags(i));
+      found_neg = true;
+    }
+  }
+  if (found_neg) {
+    std::exit(EXIT_FAILURE);
+  }
+}
+
 void StateHelper::EKFUpdate(std::shared_ptr<State> state, const std::vector<std::shared_ptr<Type>> &H_order, const Eigen::MatrixXd &H,
                             const Eigen::VectorXd &res, const Eigen::MatrixXd &R) {
 
@@ -124,25 +353,28 @@ void StateHelper::EKFUpdate(std::shared_ptr<State> state, const std::vector<std:
   Eigen::MatrixXd M_a = Eigen::MatrixXd::Zero(state->_Cov.rows(), res.rows());
 
   // Get the location in small jacobian for each measuring variable
+  // (hoisted ids/sizes so the accumulation loops below never chase the shared_ptrs)
   int current_it = 0;
-  std::vector<int> H_id;
+  std::vector<int> H_id, meas_id, meas_size;
   for (const auto &meas_var : H_order) {
     H_id.push_back(current_it);
+    meas_id.push_back(meas_var->id());
+    meas_size.push_back(meas_var->size());
     current_it += meas_var->size();
   }
 
   //==========================================================
   //==========================================================
   // For each active variable find its M = P*H^T
-  for (const auto &var : state->_variables) {
+  // NOTE: we walk the flat id/size mirror instead of the variable pointers here
+  for (const auto &var : state->_variables_flat) {
     // Sum up effect of each subjacobian = K_i= \sum_m (P_im Hm^T)
-    Eigen::MatrixXd M_i = Eigen::MatrixXd::Zero(var->size(), res.rows());
+    Eigen::MatrixXd M_i = Eigen::MatrixXd::Zero(var.size, res.rows());
     for (size_t i = 0; i < H_order.size(); i++) {
-      std::shared_ptr<Type> meas_var = H_order[i];
-      M_i.noalias() += state->_Cov.block(var->id(), meas_var->id(), var->size(), meas_var->size()) *
-                       H.block(0, H_id[i], H.rows(), meas_var->size()).transpose();
+      M_i.noalias() += cov_block(state->_Cov, var.id, var.size, meas_id[i], meas_size[i]) *
+                       H.block(0, H_id[i], H.rows(), meas_size[i]).transpose();
     }
-    M_a.block(var->id(), 0, var->size(), res.rows()) = M_i;
+    M_a.block(var.id, 0, var.size, res.rows()) = M_i;
   }
 
   //==========================================================
@@ -156,20 +388,23 @@ void StateHelper::EKFUpdate(std::shared_ptr<State> state, const std::vector<std:
   S.triangularView<Eigen::Upper>() += R;
   // Eigen::MatrixXd S = H * P_small * H.transpose() + R;
 
-  // Invert our S (should we use a more stable method here??)
-  Eigen::MatrixXd Sinv = Eigen::MatrixXd::Identity(R.rows(), R.rows());
-  S.selfadjointView<Eigen::Upper>().llt().solveInPlace(Sinv);
-  Eigen::MatrixXd K = M_a * Sinv.selfadjointView<Eigen::Upper>();
-  // Eigen::MatrixXd K = M_a * S.inverse();
-
-  // Update Covariance
-  state->_Cov.triangularView<Eigen::Upper>() -= K * M_a.transpose();
-  state->_Cov = state->_Cov.selfadjointView<Eigen::Upper>();
-  // Cov -= K * M_a.transpose();
-  // Cov = 0.5*(Cov+Cov.transpose());
+  // Cholesky factorize S = L*L^T and whiten the gain numerator: W = M_a*L^{-T}
+  // The covariance correction K*S*K^T is then the symmetric rank-m downdate W*W^T,
+  // which is half the flops of forming K = M_a*S^{-1} and multiplying it back out,
+  // and never forms an explicit inverse
+  Eigen::LLT<Eigen::MatrixXd> S_llt(S.selfadjointView<Eigen::Upper>());
+  Eigen::MatrixXd W = S_llt.matrixL().solve(M_a.transpose()).transpose();
+
+  // Update Covariance: Cov -= W*W^T
+  // The rank update only touches the upper triangle, which is exactly the maintained
+  // storage, so the update is symmetric by construction and needs no mirror pass
+  // NOTE: plain dynamic type here since CovMatrix can be capacity-bounded (inline
+  // NOTE: square storage, which we do not want for a tall skinny stack temporary)
+  Eigen::Matrix<CovScalar, Eigen::Dynamic, Eigen::Dynamic> W_cov = W.cast<CovScalar>();
+  state->_Cov.selfadjointView<Eigen::Upper>().rankUpdate(W_cov, CovScalar(-1.0));
 
   // We should check if we are not positive semi-definitate (i.e. negative diagionals is not s.p.d)
-  Eigen::VectorXd diags = state->_Cov.diagonal();
+  Eigen::VectorXd diags = state->_Cov.diagonal().cast<double>();
   bool found_neg = false;
   for (int i = 0; i < diags.rows(); i++) {
     if (diags(i) < 0.0) {
@@ -182,9 +417,11 @@ void StateHelper::EKFUpdate(std::shared_ptr<State> state, const std::vector<std:
   }
 
   // Calculate our delta and update all our active states
-  Eigen::VectorXd dx = K * res;
+  // K*res = M_a*S^{-1}*res = W*(L^{-1}*res), so one small triangular solve suffices
+  Eigen::VectorXd dx = W * S_llt.matrixL().solve(res);
   for (size_t i = 0; i < state->_variables.size(); i++) {
-    state->_variables.at(i)->update(dx.block(state->_variables.at(i)->id(), 0, state->_variables.at(i)->size(), 1));
+    const State::VarInfo &info = state->_variables_flat.at(i);
+    state->_variables.at(i)->update(dx.block(info.id, 0, info.size, 1));
   }
 
   // If we are doing online intrinsic calibration we should update our camera objects
@@ -194,6 +431,10 @@ void StateHelper::EKFUpdate(std::shared_ptr<State> state, const std::vector<std:
       state->_cam_intrinsics_cameras.at(calib.first)->set_value(calib.second->value());
     }
   }
+
+  // Publish a fresh read-only snapshot so outside consumers (visualizers etc.)
+  // can read the updated estimate without ever taking the filter lock
+  state->publish_snapshot();
 }
 
 void StateHelper::set_initial_covariance(std::shared_ptr<State> state, const Eigen::MatrixXd &covariance,
@@ -215,42 +456,26 @@ void StateHelper::set_initial_covariance(std::shared_ptr<State> state, const Eig
     int k_index = 0;
     for (size_t k = 0; k < order.size(); k++) {
       state->_Cov.block(order[i]->id(), order[k]->id(), order[i]->size(), order[k]->size()) =
-          covariance.block(i_index, k_index, order[i]->size(), order[k]->size());
+          covariance.block(i_index, k_index, order[i]->size(), order[k]->size()).cast<CovScalar>();
       k_index += order[k]->size();
     }
     i_index += order[i]->size();
   }
-  state->_Cov = state->_Cov.selfadjointView<Eigen::Upper>();
 }
 
-Eigen::MatrixXd StateHelper::get_marginal_covariance(std::shared_ptr<State> state,
-                                                     const std::vector<std::shared_ptr<Type>> &small_variables) {
-
-  // Calculate the marginal covariance size we need to make our matrix
-  int cov_size = 0;
-  for (size_t i = 0; i < small_variables.size(); i++) {
-    cov_size += small_variables[i]->size();
-  }
+void StateHelper::reset_covariance(std::shared_ptr<State> state, std::shared_ptr<Type> variable, const Eigen::MatrixXd &covariance) {
 
-  // Construct our return covariance
-  Eigen::MatrixXd Small_cov = Eigen::MatrixXd::Zero(cov_size, cov_size);
-
-  // For each variable, lets copy over all other variable cross terms
-  // Note: this copies over itself to when i_index=k_index
-  int i_index = 0;
-  for (size_t i = 0; i < small_variables.size(); i++) {
-    int k_index = 0;
-    for (size_t k = 0; k < small_variables.size(); k++) {
-      Small_cov.block(i_index, k_index, small_variables[i]->size(), small_variables[k]->size()) =
-          state->_Cov.block(small_variables[i]->id(), small_variables[k]->id(), small_variables[i]->size(), small_variables[k]->size());
-      k_index += small_variables[k]->size();
-    }
-    i_index += small_variables[i]->size();
-  }
+  // The variable keeps its slot, we just wipe its correlations and overwrite its prior
+  assert(covariance.rows() == variable->size() && covariance.cols() == variable->size());
+  state->_Cov.block(variable->id(), 0, variable->size(), state->_Cov.cols()).setZero();
+  state->_Cov.block(0, variable->id(), state->_Cov.rows(), variable->size()).setZero();
+  state->_Cov.block(variable->id(), variable->id(), variable->size(), variable->size()) = covariance.cast<CovScalar>();
+}
 
-  // Return the covariance
-  // Small_cov = 0.5*(Small_cov+Small_cov.transpose());
-  return Small_cov;
+Eigen::MatrixXd StateHelper::get_marginal_covariance(std::shared_ptr<State> state,
+                                                     const std::vector<std::shared_ptr<Type>> &small_variables) {
+  // Gather-free block access lives in MarginalCovarianceView, this is the dense fallback
+  return MarginalCovarianceView(state, small_variables).dense();
 }
 
 Eigen::MatrixXd StateHelper::get_full_covariance(std::shared_ptr<State> state) {
@@ -261,13 +486,114 @@ Eigen::MatrixXd StateHelper::get_full_covariance(std::shared_ptr<State> state) {
   // Construct our return covariance
   Eigen::MatrixXd full_cov = Eigen::MatrixXd::Zero(cov_size, cov_size);
 
-  // Copy in the active state elements
-  full_cov.block(0, 0, state->_Cov.rows(), state->_Cov.rows()) = state->_Cov;
+  // Copy in the active state elements (mirroring the maintained upper triangle)
+  full_cov.block(0, 0, state->_Cov.rows(), state->_Cov.rows()) = state->_Cov.cast<double>();
+  full_cov = full_cov.selfadjointView<Eigen::Upper>();
 
   // Return the covariance
   return full_cov;
 }
 
+double StateHelper::estimate_condition_number(std::shared_ptr<State> state, Eigen::VectorXd &v_max, Eigen::VectorXd &v_min,
+                                              int iterations) {
+
+  // Warm vectors follow the active dimension (new directions are seeded flat so a grown
+  // state gets explored, free-list slots are zeroed so the zero rows cannot trap them)
+  int n = (int)state->_Cov.rows();
+  auto repair = [&](Eigen::VectorXd &v) {
+    if ((int)v.rows() != n) {
+      v.conservativeResizeLike(Eigen::VectorXd::Constant(n, 1.0));
+    }
+    for (const auto &slot : state->_Cov_free_slots) {
+      v.segment(slot.first, slot.second).setZero();
+    }
+    if (v.norm() < 1e-12) {
+      v.setOnes();
+      for (const auto &slot : state->_Cov_free_slots) {
+        v.segment(slot.first, slot.second).setZero();
+      }
+    }
+    v.normalize();
+  };
+  repair(v_max);
+  repair(v_min);
+
+  // One matrix-vector product against the maintained upper triangle (accumulated in
+  // the storage scalar like the update kernels, widened to double for the estimates)
+  auto matvec = [&](const Eigen::VectorXd &v) {
+    Eigen::Matrix<CovScalar, Eigen::Dynamic, 1> vc = v.cast<CovScalar>();
+    Eigen::Matrix<CovScalar, Eigen::Dynamic, 1> wc = state->_Cov.selfadjointView<Eigen::Upper>() * vc;
+    return Eigen::VectorXd(wc.cast<double>());
+  };
+
+  // Largest eigenvalue by plain power iteration (the Rayleigh quotient of the
+  // pre-normalization iterate is free since v is already unit length)
+  double eig_max = 0.0;
+  for (int i = 0; i < iterations; i++) {
+    Eigen::VectorXd w = matvec(v_max);
+    eig_max = v_max.dot(w);
+    double norm = w.norm();
+    if (norm < 1e-20) {
+      return 1.0;
+    }
+    v_max = w / norm;
+  }
+
+  // Smallest eigenvalue through the shifted spectrum: the dominant eigenvector of
+  // (eig_max * I - P) is the minimal one of P. Both terms vanish on free slots, so
+  // the iterate stays inside the active subspace without re-projection.
+  double eig_min = eig_max;
+  for (int i = 0; i < iterations; i++) {
+    Eigen::VectorXd w = eig_max * v_min - matvec(v_min);
+    eig_min = eig_max - v_min.dot(w);
+    double norm = w.norm();
+    if (norm < 1e-20) {
+      break;
+    }
+    v_min = w / norm;
+  }
+
+  // A covariance this close to singular is already past any useful warning threshold
+  if (eig_min <= 0.0) {
+    return std::numeric_limits<double>::infinity();
+  }
+  return eig_max / eig_min;
+}
+
+void StateHelper::refresh_gating_cache(std::shared_ptr<State> state) {
+
+  // Map each active variable to its offset in the compact cache
+  // (walking the flat mirror keeps this free of shared_ptr chases)
+  MarginalCovarianceView::cache_offsets.clear();
+  int total = 0;
+  for (const auto &var : state->_variables_flat) {
+    MarginalCovarianceView::cache_offsets[var.id] = total;
+    total += var.size;
+  }
+
+  // Gather (and widen) each block pair into the contiguous buffer
+  // Only the upper triangle of the covariance is stored, so each pair is gathered once
+  // and mirrored inside the cache (which is read densely by the gating quadratic forms)
+  // NOTE: resize is a no-op when the state dimension has not changed, so the
+  // NOTE: buffer allocation is shared across the updaters and across frames
+  const std::vector<State::VarInfo> &vars = state->_variables_flat;
+  MarginalCovarianceView::cache_cov.resize(total, total);
+  int off_i = 0;
+  for (size_t i = 0; i < vars.size(); i++) {
+    int off_k = off_i;
+    for (size_t k = i; k < vars.size(); k++) {
+      MarginalCovarianceView::cache_cov.block(off_i, off_k, vars[i].size, vars[k].size) =
+          cov_block(state->_Cov, vars[i].id, vars[i].size, vars[k].id, vars[k].size);
+      if (k != i) {
+        MarginalCovarianceView::cache_cov.block(off_k, off_i, vars[k].size, vars[i].size) =
+            MarginalCovarianceView::cache_cov.block(off_i, off_k, vars[i].size, vars[k].size).transpose();
+      }
+      off_k += vars[k].size;
+    }
+    off_i += vars[i].size;
+  }
+}
+
 void StateHelper::marginalize(std::shared_ptr<State> state, std::shared_ptr<Type> marg) {
 
   // Check if the current state has the element we want to marginalize
@@ -277,53 +603,27 @@ void StateHelper::marginalize(std::shared_ptr<State> state, std::shared_ptr<Type
     std::exit(EXIT_FAILURE);
   }
 
-  // Generic covariance has this form for x_1, x_m, x_2. If we want to remove x_m:
-  //
-  //  P_(x_1,x_1) P(x_1,x_m) P(x_1,x_2)
-  //  P_(x_m,x_1) P(x_m,x_m) P(x_m,x_2)
-  //  P_(x_2,x_1) P(x_2,x_m) P(x_2,x_2)
-  //
-  //  to
-  //
-  //  P_(x_1,x_1) P(x_1,x_2)
-  //  P_(x_2,x_1) P(x_2,x_2)
-  //
-  // i.e. x_1 goes from 0 to marg_id, x_2 goes from marg_id+marg_size to Cov.rows() in the original covariance
-
+  // Rather than physically removing the marginal rows/columns (which shuffles the
+  // whole covariance with an O(n^2) block copy every time a clone is marginalized),
+  // we zero out its block and record the slot in a free-list. The next variable of
+  // the same size that is inserted will reuse the slot, so the matrix stays bounded
+  // at steady state and no other variable needs its index shifted.
   int marg_size = marg->size();
   int marg_id = marg->id();
-  int x2_size = (int)state->_Cov.rows() - marg_id - marg_size;
-
-  Eigen::MatrixXd Cov_new(state->_Cov.rows() - marg_size, state->_Cov.rows() - marg_size);
-
-  // P_(x_1,x_1)
-  Cov_new.block(0, 0, marg_id, marg_id) = state->_Cov.block(0, 0, marg_id, marg_id);
-
-  // P_(x_1,x_2)
-  Cov_new.block(0, marg_id, marg_id, x2_size) = state->_Cov.block(0, marg_id + marg_size, marg_id, x2_size);
-
-  // P_(x_2,x_1)
-  Cov_new.block(marg_id, 0, x2_size, marg_id) = Cov_new.block(0, marg_id, marg_id, x2_size).transpose();
+  state->_Cov.block(marg_id, 0, marg_size, state->_Cov.cols()).setZero();
+  state->_Cov.block(0, marg_id, state->_Cov.rows(), marg_size).setZero();
+  state->_Cov_free_slots.emplace_back(marg_id, marg_size);
 
-  // P(x_2,x_2)
-  Cov_new.block(marg_id, marg_id, x2_size, x2_size) = state->_Cov.block(marg_id + marg_size, marg_id + marg_size, x2_size, x2_size);
+  // If free slots have accumulated at the very end of the covariance then nothing
+  // references those rows/columns anymore and we can actually shrink the matrix
+  StateHelper::trim_trailing_free_slots(state);
 
-  // Now set new covariance
-  // state->_Cov.resize(Cov_new.rows(),Cov_new.cols());
-  state->_Cov = Cov_new;
-  // state->Cov() = 0.5*(Cov_new+Cov_new.transpose());
-  assert(state->_Cov.rows() == Cov_new.rows());
-
-  // Now we keep the remaining variables and update their ordering
+  // Now we keep the remaining variables (their covariance indices are unchanged)
   // Note: DOES NOT SUPPORT MARGINALIZING SUBVARIABLES YET!!!!!!!
   std::vector<std::shared_ptr<Type>> remaining_variables;
   for (size_t i = 0; i < state->_variables.size(); i++) {
     // Only keep non-marginal states
     if (state->_variables.at(i) != marg) {
-      if (state->_variables.at(i)->id() > marg_id) {
-        // If the variable is "beyond" the marginal one in ordering, need to "move it forward"
-        state->_variables.at(i)->set_local_id(state->_variables.at(i)->id() - marg_size);
-      }
       remaining_variables.push_back(state->_variables.at(i));
     }
   }
@@ -336,17 +636,119 @@ void StateHelper::marginalize(std::shared_ptr<State> state, std::shared_ptr<Type
 
   // Now set variables as the remaining ones
   state->_variables = remaining_variables;
+  state->rebuild_variables_flat();
+
+  // Run the scheduled compaction pass if interior slots have had time to accumulate
+  if (state->_options.cov_compact_interval > 0 && ++state->_margs_since_compact >= state->_options.cov_compact_interval) {
+    StateHelper::compact_covariance(state);
+    state->_margs_since_compact = 0;
+  }
 }
 
-std::shared_ptr<Type> StateHelper::clone(std::shared_ptr<State> state, std::shared_ptr<Type> variable_to_clone) {
+void StateHelper::trim_trailing_free_slots(std::shared_ptr<State> state) {
+  bool trimmed = true;
+  while (trimmed) {
+    trimmed = false;
+    for (auto it = state->_Cov_free_slots.begin(); it != state->_Cov_free_slots.end(); it++) {
+      if (it->first + it->second == (int)state->_Cov.rows()) {
+        state->resize_covariance(it->first);
+        state->_Cov_free_slots.erase(it);
+        trimmed = true;
+        break;
+      }
+    }
+  }
+}
 
-  // Get total size of new cloned variables, and the old covariance size
-  int total_size = variable_to_clone->size();
+void StateHelper::compact_covariance(std::shared_ptr<State> state) {
+
+  // Keep swapping the last active variable down into an interior free slot
+  // Each successful swap exposes a freed tail which we immediately trim away
+  bool moved = true;
+  while (moved) {
+    moved = false;
+    StateHelper::trim_trailing_free_slots(state);
+
+    // Find the active variable that ends exactly at the covariance tail
+    std::shared_ptr<Type> tail_var = nullptr;
+    for (const auto &var : state->_variables) {
+      if (var->id() + var->size() == (int)state->_Cov.rows()) {
+        tail_var = var;
+        break;
+      }
+    }
+    if (tail_var == nullptr)
+      break;
+    int old_loc = tail_var->id();
+    int var_size = tail_var->size();
+
+    // First-fit: lowest interior slot large enough to hold it
+    // (free slots are disjoint from the tail variable, so any candidate is below it)
+    auto best = state->_Cov_free_slots.end();
+    for (auto it = state->_Cov_free_slots.begin(); it != state->_Cov_free_slots.end(); it++) {
+      if (it->second >= var_size && (best == state->_Cov_free_slots.end() || it->first < best->first)) {
+        best = it;
+      }
+    }
+    if (best == state->_Cov_free_slots.end())
+      break;
+    int new_loc = best->first;
+
+    // Move the variable's covariance into the slot via its symmetric column strip
+    // The diagonal block moves with the variable, and the cross term against the old
+    // location is zeroed since that slot is about to be free-listed
+    int cov_size = (int)state->_Cov.rows();
+    Eigen::Matrix<CovScalar, Eigen::Dynamic, Eigen::Dynamic> strip;
+    cov_read_strip(state->_Cov, old_loc, var_size, strip);
+    strip.middleRows(new_loc, var_size) = strip.middleRows(old_loc, var_size);
+    strip.middleRows(old_loc, var_size).setZero();
+    state->_Cov.block(0, old_loc, old_loc, var_size).setZero();
+    state->_Cov.block(old_loc, old_loc, var_size, cov_size - old_loc).setZero();
+    cov_write_strip(state->_Cov, new_loc, var_size, strip);
+    tail_var->set_local_id(new_loc);
+
+    // Shrink or consume the slot we filled, and free-list the old tail location
+    if (best->second > var_size) {
+      best->first += var_size;
+      best->second -= var_size;
+    } else {
+      state->_Cov_free_slots.erase(best);
+    }
+    state->_Cov_free_slots.emplace_back(old_loc, var_size);
+    moved = true;
+  }
+  StateHelper::trim_trailing_free_slots(state);
+
+  // Variable locations have changed, so refresh the flat mirror
+  state->rebuild_variables_flat();
+}
+
+int StateHelper::allocate_covariance_slot(std::shared_ptr<State> state, int size) {
+
+  // Reuse a slot freed by a past marginalization if one of the exact size exists
+  // At steady state this is the common case (clone sizes recur every frame),
+  // so the covariance only truly grows while the sliding window is filling up
+  for (auto it = state->_Cov_free_slots.begin(); it != state->_Cov_free_slots.end(); it++) {
+    if (it->second == size) {
+      int slot_id = it->first;
+      state->_Cov_free_slots.erase(it);
+      return slot_id;
+    }
+  }
+
+  // Otherwise we grow the covariance at the end (new rows/columns zeroed)
   int old_size = (int)state->_Cov.rows();
-  int new_loc = (int)state->_Cov.rows();
+  state->resize_covariance(old_size + size);
+  return old_size;
+}
 
-  // Resize both our covariance to the new size
-  state->_Cov.conservativeResizeLike(Eigen::MatrixXd::Zero(old_size + total_size, old_size + total_size));
+std::shared_ptr<Type> StateHelper::clone(std::shared_ptr<State> state, std::shared_ptr<Type> variable_to_clone,
+                                         std::shared_ptr<Type> reuse) {
+
+  // Get total size of new cloned variables, and allocate covariance rows/columns
+  // for it (this will reuse a slot freed by a past marginalization if possible)
+  int total_size = variable_to_clone->size();
+  int new_loc = StateHelper::allocate_covariance_slot(state, total_size);
 
   // What is the new state, and variable we inserted
   const std::vector<std::shared_ptr<Type>> new_variables = state->_variables;
@@ -367,13 +769,24 @@ std::shared_ptr<Type> StateHelper::clone(std::shared_ptr<State> state, std::shar
     // So we will clone this one
     int old_loc = type_check->id();
 
-    // Copy the covariance elements
-    state->_Cov.block(new_loc, new_loc, total_size, total_size) = state->_Cov.block(old_loc, old_loc, total_size, total_size);
-    state->_Cov.block(0, new_loc, old_size, total_size) = state->_Cov.block(0, old_loc, old_size, total_size);
-    state->_Cov.block(new_loc, 0, total_size, old_size) = state->_Cov.block(old_loc, 0, total_size, old_size);
-
-    // Create clone from the type being cloned
-    new_clone = type_check->clone();
+    // Copy the covariance elements via the cloned variable's symmetric column strip
+    // The clone's cross term against the variable it was cloned from is the old diagonal
+    // block, and so is its own new diagonal block (the slot rows overwritten here held
+    // the zeroed free-slot cross terms)
+    Eigen::Matrix<CovScalar, Eigen::Dynamic, Eigen::Dynamic> strip;
+    cov_read_strip(state->_Cov, old_loc, total_size, strip);
+    strip.middleRows(new_loc, total_size) = strip.middleRows(old_loc, total_size);
+    cov_write_strip(state->_Cov, new_loc, total_size, strip);
+
+    // Create clone from the type being cloned (into the recycled variable if given one)
+    if (reuse != nullptr) {
+      assert(reuse->size() == type_check->size());
+      reuse->set_value(type_check->value());
+      reuse->set_fej(type_check->fej());
+      new_clone = reuse;
+    } else {
+      new_clone = type_check->clone();
+    }
     new_clone->set_local_id(new_loc);
     break;
   }
@@ -387,6 +800,7 @@ std::shared_ptr<Type> StateHelper::clone(std::shared_ptr<State> state, std::shar
 
   // Add to variable list and return
   state->_variables.push_back(new_clone);
+  state->rebuild_variables_flat();
   return new_clone;
 }
 
@@ -394,6 +808,30 @@ bool StateHelper::initialize(std::shared_ptr<State> state, std::shared_ptr<Type>
                              const std::vector<std::shared_ptr<Type>> &H_order, Eigen::MatrixXd &H_R, Eigen::MatrixXd &H_L,
                              Eigen::MatrixXd &R, Eigen::VectorXd &res, double chi_2_mult) {
 
+  // Separate the system and gate it, then directly apply both portions
+  InitSystem init_sys;
+  Eigen::MatrixXd Hup;
+  Eigen::VectorXd resup;
+  Eigen::MatrixXd Rup;
+  if (!StateHelper::initialize_separate(state, new_variable, H_order, H_R, H_L, R, res, chi_2_mult, init_sys, Hup, resup, Rup)) {
+    return false;
+  }
+
+  // Finally, initialize it in our state
+  StateHelper::initialize_invertible(state, new_variable, init_sys.H_order, init_sys.H_R, init_sys.H_L, init_sys.R, init_sys.res);
+
+  // Update with updating portion
+  if (Hup.rows() > 0) {
+    StateHelper::EKFUpdate(state, H_order, Hup, resup, Rup);
+  }
+  return true;
+}
+
+bool StateHelper::initialize_separate(std::shared_ptr<State> state, std::shared_ptr<Type> new_variable,
+                                      const std::vector<std::shared_ptr<Type>> &H_order, Eigen::MatrixXd &H_R, Eigen::MatrixXd &H_L,
+                                      Eigen::MatrixXd &R, Eigen::VectorXd &res, double chi_2_mult, InitSystem &init_sys,
+                                      Eigen::MatrixXd &H_up, Eigen::VectorXd &res_up, Eigen::MatrixXd &R_up) {
+
   // Check that this new variable is not already initialized
   if (std::find(state->_variables.begin(), state->_variables.end(), new_variable) != state->_variables.end()) {
     PRINT_ERROR("StateHelper::initialize_invertible() - Called on variable that is already in the state\n");
@@ -463,28 +901,82 @@ bool StateHelper::initialize(std::shared_ptr<State> state, std::shared_ptr<Type>
   double chi2 = resup.dot(S.llt().solve(resup));
 
   // Get what our threshold should be
-  boost::math::chi_squared chi_squared_dist(res.rows());
-  double chi2_check = boost::math::quantile(chi_squared_dist, 0.95);
+  double chi2_check = ChiSquareTable::chi_squared_095((int)res.rows());
   if (chi2 > chi_2_mult * chi2_check) {
     return false;
   }
 
   //==========================================================
   //==========================================================
-  // Finally, initialize it in our state
-  StateHelper::initialize_invertible(state, new_variable, H_order, Hxinit, H_finit, Rinit, resinit);
+  // Passed the gate, so hand both portions back to the caller to apply
+  init_sys.new_variable = new_variable;
+  init_sys.H_order = H_order;
+  init_sys.H_R = Hxinit;
+  init_sys.H_L = H_finit;
+  init_sys.R = Rinit;
+  init_sys.res = resinit;
+  H_up = Hup;
+  res_up = resup;
+  R_up = Rup;
+  return true;
+}
 
-  // Update with updating portion
-  if (Hup.rows() > 0) {
-    StateHelper::EKFUpdate(state, H_order, Hup, resup, Rup);
+void StateHelper::initialize_batch(std::shared_ptr<State> state, std::vector<InitSystem> &systems) {
+
+  // Return if nothing passed the gate
+  if (systems.empty())
+    return;
+
+  // First hand out freed covariance slots of the exact size, then grow the
+  // covariance a *single* time for everything left over instead of paying a
+  // resize and full matrix copy once per variable
+  std::vector<int> slots(systems.size(), -1);
+  int grow_size = 0;
+  for (size_t i = 0; i < systems.size(); i++) {
+    for (auto it = state->_Cov_free_slots.begin(); it != state->_Cov_free_slots.end(); it++) {
+      if (it->second == systems.at(i).new_variable->size()) {
+        slots.at(i) = it->first;
+        state->_Cov_free_slots.erase(it);
+        break;
+      }
+    }
+    if (slots.at(i) == -1)
+      grow_size += systems.at(i).new_variable->size();
+  }
+  if (grow_size > 0) {
+    int next_loc = (int)state->_Cov.rows();
+    state->resize_covariance(next_loc + grow_size);
+    for (size_t i = 0; i < systems.size(); i++) {
+      if (slots.at(i) == -1) {
+        slots.at(i) = next_loc;
+        next_loc += systems.at(i).new_variable->size();
+      }
+    }
+  }
+
+  // The initializations themselves stay in order so each variable's cross
+  // covariance against the ones initialized before it is formed correctly
+  for (size_t i = 0; i < systems.size(); i++) {
+    InitSystem &sys = systems.at(i);
+    StateHelper::initialize_invertible_in_slot(state, sys.new_variable, sys.H_order, sys.H_R, sys.H_L, sys.R, sys.res, slots.at(i));
   }
-  return true;
 }
 
 void StateHelper::initialize_invertible(std::shared_ptr<State> state, std::shared_ptr<Type> new_variable,
                                         const std::vector<std::shared_ptr<Type>> &H_order, const Eigen::MatrixXd &H_R,
                                         const Eigen::MatrixXd &H_L, const Eigen::MatrixXd &R, const Eigen::VectorXd &res) {
 
+  // Allocate covariance rows/columns for the new variable up front so the gain
+  // below is already sized for the final covariance (reuses a freed slot if possible)
+  int new_loc = StateHelper::allocate_covariance_slot(state, new_variable->size());
+  StateHelper::initialize_invertible_in_slot(state, new_variable, H_order, H_R, H_L, R, res, new_loc);
+}
+
+void StateHelper::initialize_invertible_in_slot(std::shared_ptr<State> state, std::shared_ptr<Type> new_variable,
+                                                const std::vector<std::shared_ptr<Type>> &H_order, const Eigen::MatrixXd &H_R,
+                                                const Eigen::MatrixXd &H_L, const Eigen::MatrixXd &R, const Eigen::VectorXd &res,
+                                                int new_loc) {
+
   // Check that this new variable is not already initialized
   if (std::find(state->_variables.begin(), state->_variables.end(), new_variable) != state->_variables.end()) {
     PRINT_ERROR("StateHelper::initialize_invertible() - Called on variable that is already in the state\n");
@@ -516,28 +1008,32 @@ void StateHelper::initialize_invertible(std::shared_ptr<State> state, std::share
   assert(res.rows() == R.rows());
   assert(H_L.rows() == res.rows());
   assert(H_L.rows() == H_R.rows());
+
   Eigen::MatrixXd M_a = Eigen::MatrixXd::Zero(state->_Cov.rows(), res.rows());
 
   // Get the location in small jacobian for each measuring variable
+  // (hoisted ids/sizes so the accumulation loop below never chases the shared_ptrs)
   int current_it = 0;
-  std::vector<int> H_id;
+  std::vector<int> H_id, meas_id, meas_size;
   for (const auto &meas_var : H_order) {
     H_id.push_back(current_it);
+    meas_id.push_back(meas_var->id());
+    meas_size.push_back(meas_var->size());
     current_it += meas_var->size();
   }
 
   //==========================================================
   //==========================================================
   // For each active variable find its M = P*H^T
-  for (const auto &var : state->_variables) {
+  // NOTE: we walk the flat id/size mirror instead of the variable pointers here
+  for (const auto &var : state->_variables_flat) {
     // Sum up effect of each subjacobian= K_i= \sum_m (P_im Hm^T)
-    Eigen::MatrixXd M_i = Eigen::MatrixXd::Zero(var->size(), res.rows());
+    Eigen::MatrixXd M_i = Eigen::MatrixXd::Zero(var.size, res.rows());
     for (size_t i = 0; i < H_order.size(); i++) {
-      std::shared_ptr<Type> meas_var = H_order.at(i);
-      M_i += state->_Cov.block(var->id(), meas_var->id(), var->size(), meas_var->size()) *
-             H_R.block(0, H_id[i], H_R.rows(), meas_var->size()).transpose();
+      M_i += cov_block(state->_Cov, var.id, var.size, meas_id[i], meas_size[i]) *
+             H_R.block(0, H_id[i], H_R.rows(), meas_size[i]).transpose();
     }
-    M_a.block(var->id(), 0, var->size(), res.rows()) = M_i;
+    M_a.block(var.id, 0, var.size, res.rows()) = M_i;
   }
 
   //==========================================================
@@ -556,20 +1052,26 @@ void StateHelper::initialize_invertible(std::shared_ptr<State> state, std::share
   Eigen::MatrixXd H_Linv = H_L.inverse();
   Eigen::MatrixXd P_LL = H_Linv * M.selfadjointView<Eigen::Upper>() * H_Linv.transpose();
 
-  // Augment the covariance matrix
-  size_t oldSize = state->_Cov.rows();
-  state->_Cov.conservativeResizeLike(Eigen::MatrixXd::Zero(oldSize + new_variable->size(), oldSize + new_variable->size()));
-  state->_Cov.block(0, oldSize, oldSize, new_variable->size()).noalias() = -M_a * H_Linv.transpose();
-  state->_Cov.block(oldSize, 0, new_variable->size(), oldSize) = state->_Cov.block(0, oldSize, oldSize, new_variable->size()).transpose();
-  state->_Cov.block(oldSize, oldSize, new_variable->size(), new_variable->size()) = P_LL;
+  // Write the cross terms and the new diagonal block into the allocated slot, touching
+  // only the upper triangle: the part above the slot as columns, the part after it as
+  // (transposed) rows (M_a rows belonging to the slot itself and to any other free slots
+  // are zero, so nothing of the strip is lost)
+  int cov_size = (int)state->_Cov.rows();
+  int new_size = new_variable->size();
+  int below = cov_size - new_loc - new_size;
+  Eigen::MatrixXd P_xL = -M_a * H_Linv.transpose();
+  state->_Cov.block(0, new_loc, new_loc, new_size) = P_xL.topRows(new_loc).cast<CovScalar>();
+  state->_Cov.block(new_loc, new_loc + new_size, new_size, below) = P_xL.bottomRows(below).transpose().cast<CovScalar>();
+  state->_Cov.block(new_loc, new_loc, new_size, new_size) = P_LL.cast<CovScalar>();
 
   // Update the variable that will be initialized (invertible systems can only update the new variable).
   // However this update should be almost zero if we already used a conditional Gauss-Newton to solve for the initial estimate
   new_variable->update(H_Linv * res);
 
   // Now collect results, and add it to the state variables
-  new_variable->set_local_id(oldSize);
+  new_variable->set_local_id(new_loc);
   state->_variables.push_back(new_variable);
+  state->rebuild_variables_flat();
 
   // std::stringstream ss;
   // ss << new_variable->id() <<  " init dx = " << (H_Linv * res).transpose() << std::endl;
@@ -584,9 +1086,18 @@ void StateHelper::augment_clone(std::shared_ptr<State> state, Eigen::Matrix<doub
     std::exit(EXIT_FAILURE);
   }
 
+  // Grab a recycled pose from the clone pool if one is available
+  // The pool is refilled by marginalize_old_clone(), so once the window is full
+  // the steady state clone/marginalize cycle performs no type allocations
+  std::shared_ptr<PoseJPL> pose_reuse = nullptr;
+  if (!state->_clone_pool.empty()) {
+    pose_reuse = state->_clone_pool.back();
+    state->_clone_pool.pop_back();
+  }
+
   // Call on our cloner and add it to our vector of types
   // NOTE: this will clone the clone pose to the END of the covariance...
-  std::shared_ptr<Type> posetemp = StateHelper::clone(state, state->_imu->pose());
+  std::shared_ptr<Type> posetemp = StateHelper::clone(state, state->_imu->pose(), pose_reuse);
 
   // Cast to a JPL pose type, check if valid
   std::shared_ptr<PoseJPL> pose = std::dynamic_pointer_cast<PoseJPL>(posetemp);
@@ -595,8 +1106,9 @@ void StateHelper::augment_clone(std::shared_ptr<State> state, Eigen::Matrix<doub
     std::exit(EXIT_FAILURE);
   }
 
-  // Append the new clone to our clone vector
+  // Append the new clone to our clone vector (and the fast lookup index)
   state->_clones_IMU[state->_timestamp] = pose;
+  state->_clones_index.insert(state->_timestamp, pose);
 
   // If we are doing time calibration, then our clones are a function of the time offset
   // Logic is based on Mingyang Li and Anastasios I. Mourikis paper:
@@ -607,11 +1119,21 @@ void StateHelper::augment_clone(std::shared_ptr<State> state, Eigen::Matrix<doub
     dnc_dt.block(0, 0, 3, 1) = last_w;
     dnc_dt.block(3, 0, 3, 1) = state->_imu->vel();
     // Augment covariance with time offset Jacobian
+    // The symmetric strip update P(:,c) += e*dnc', P(c,:) += dnc*e' with e = P(:,t_d) is
+    // applied to the upper triangle only: the column part above the clone, the (transposed)
+    // row part after it, and both halves plus the second order term on the diagonal block
     // TODO: replace this with a call to the EKFPropagate function instead....
-    state->_Cov.block(0, pose->id(), state->_Cov.rows(), 6) +=
-        state->_Cov.block(0, state->_calib_dt_CAMtoIMU->id(), state->_Cov.rows(), 1) * dnc_dt.transpose();
-    state->_Cov.block(pose->id(), 0, 6, state->_Cov.rows()) +=
-        dnc_dt * state->_Cov.block(state->_calib_dt_CAMtoIMU->id(), 0, 1, state->_Cov.rows());
+    int id = pose->id();
+    int dt_id = state->_calib_dt_CAMtoIMU->id();
+    int n = (int)state->_Cov.rows();
+    Eigen::Matrix<CovScalar, Eigen::Dynamic, Eigen::Dynamic> strip_cov;
+    cov_read_strip(state->_Cov, dt_id, 1, strip_cov);
+    Eigen::VectorXd e_td = strip_cov.cast<double>();
+    Eigen::Matrix<double, 6, 1> e_p = e_td.segment(id, 6);
+    state->_Cov.block(0, id, id, 6) += (e_td.head(id) * dnc_dt.transpose()).cast<CovScalar>();
+    state->_Cov.block(id, id + 6, 6, n - id - 6) += (dnc_dt * e_td.tail(n - id - 6).transpose()).cast<CovScalar>();
+    state->_Cov.block(id, id, 6, 6) +=
+        (e_p * dnc_dt.transpose() + dnc_dt * e_p.transpose() + e_td(dt_id) * dnc_dt * dnc_dt.transpose()).cast<CovScalar>();
   }
 }
 
@@ -621,10 +1143,17 @@ void StateHelper::marginalize_old_clone(std::shared_ptr<State> state) {
     // Lock the mutex to avoid deleting any elements from _clones_IMU while accessing it from other threads
     std::lock_guard<std::mutex> lock(state->_mutex_state);
     assert(marginal_time != INFINITY);
-    StateHelper::marginalize(state, state->_clones_IMU.at(marginal_time));
+    std::shared_ptr<PoseJPL> marg_pose = state->_clones_IMU.at(marginal_time);
+    StateHelper::marginalize(state, marg_pose);
     // Note that the marginalizer should have already deleted the clone
     // Thus we just need to remove the pointer to it from our state
     state->_clones_IMU.erase(marginal_time);
+    state->_clones_index.erase(marginal_time);
+    // Recycle the pose object into the clone pool for the next augment_clone()
+    // NOTE: any outside reference kept to the marginalized clone will see it be overwritten
+    if ((int)state->_clone_pool.size() <= state->_options.max_clone_size) {
+      state->_clone_pool.push_back(marg_pose);
+    }
   }
 }
 
@@ -24,6 +24,10 @@
 
 #include <Eigen/Eigen>
 #include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "State.h"
 
 namespace ov_type {
 class Type;
@@ -31,7 +35,80 @@ class Type;
 
 namespace ov_msckf {
 
-class State;
+/**
+ * @brief Read-only view into the marginal covariance of a set of state variables.
+ *
+ * This reads blocks of State::_Cov in place instead of gathering them into a fresh dense
+ * matrix, so per-frame consumers (e.g. the chi-squared gating checks before each update)
+ * can form their innovation terms without allocating and copying a full marginal. Only
+ * the upper triangle of the covariance is maintained, so blocks below the diagonal are
+ * served as the transpose of their mirror. Use dense() for the cases that genuinely need
+ * a materialized matrix.
+ *
+ * @warning The view holds a reference into the state covariance, so it is only valid while
+ * the state ordering and size are unchanged (i.e. no clone, marginalize, or update between
+ * construction and the last read). Concurrent reads are fine.
+ */
+class MarginalCovarianceView {
+
+public:
+  /**
+   * @brief Construct a view over the given variables (in the given order)
+   *
+   * With use_gating_cache set the quadratic form is served from the compact dense mirror
+   * gathered by StateHelper::refresh_gating_cache instead of the live covariance, which
+   * amortizes the block gather (and the widening on narrow-storage builds) across all the
+   * features gated in one read-only pass. The caller is responsible for having refreshed
+   * the cache after the covariance was last modified.
+   *
+   * @param state Pointer to state
+   * @param small_variables Vector of variables whose marginal covariance is desired
+   * @param use_gating_cache Serve quadratic_form() from the shared per-pass gating cache
+   */
+  MarginalCovarianceView(const std::shared_ptr<State> &state, const std::vector<std::shared_ptr<ov_type::Type>> &small_variables,
+                         bool use_gating_cache = false);
+
+  /// Summed dimension of the viewed variables (the marginal is rows() by rows())
+  int rows() const { return _rows; }
+
+  /// Covariance block between the i'th and k'th requested variables, widened to double
+  /// (gathered from the maintained upper triangle, see the note on State::_Cov)
+  Eigen::MatrixXd block(size_t i, size_t k) const;
+
+  /**
+   * @brief Computes H * P_marg * H^T without materializing the dense marginal
+   * @param H Jacobian whose columns follow the variable order of this view
+   */
+  Eigen::MatrixXd quadratic_form(const Eigen::MatrixXd &H) const;
+
+  /// Batched gather of the full marginal covariance into a dense matrix
+  Eigen::MatrixXd dense() const;
+
+private:
+  // The gating cache is gathered and invalidated through StateHelper
+  friend class StateHelper;
+
+  /// Reference into the state covariance we are viewing
+  const CovMap &_cov;
+
+  /// Compact dense mirror served instead of the live covariance (nullptr when not cached)
+  const Eigen::MatrixXd *_cached = nullptr;
+
+  /// Location, size, and view-local offset of each requested variable
+  std::vector<int> _ids, _sizes, _offsets;
+
+  /// Offset of each requested variable inside the gating cache (only filled when cached)
+  std::vector<int> _cids;
+
+  /// Total dimension of the view
+  int _rows = 0;
+
+  /// Per-pass gating cache shared by the MSCKF and SLAM updaters: a contiguous double
+  /// mirror of the covariance over all active variables (free slots squeezed out), and
+  /// the cache offset of each variable keyed by its covariance location
+  static Eigen::MatrixXd cache_cov;
+  static std::unordered_map<int, int> cache_offsets;
+};
 
 /**
  * @brief Helper which manipulates the State and its covariance.
@@ -77,6 +154,27 @@ public:
                              const std::vector<std::shared_ptr<ov_type::Type>> &order_OLD, const Eigen::MatrixXd &Phi,
                              const Eigen::MatrixXd &Q);
 
+  /**
+   * @brief Performs many independent EKF propagations in one covariance pass.
+   *
+   * Equivalent to calling @ref EKFPropagation() once per entry, but the new variables do
+   * *not* need to be contiguous and the full-height covariance strips are only traversed
+   * once for the whole batch. Intended for transforms of many small scattered variables
+   * that depend on a shared set of other states, e.g. re-anchoring every SLAM landmark
+   * whose anchor clone is about to be marginalized (see UpdaterSLAM::change_anchors()).
+   * Each new variable must only appear in its *own* transition (it may depend on itself
+   * and on variables outside the batch, but not on the other new variables).
+   *
+   * @param state Pointer to state
+   * @param order_NEW Variables that have evolved (entry i uses orders_OLD/Phis/Qs at i)
+   * @param orders_OLD Per-variable orderings used in each state transition
+   * @param Phis Per-variable state transition matrices (size of the variable by size of its order_OLD)
+   * @param Qs Per-variable additive noise matrices (size of the variable, squared)
+   */
+  static void EKFPropagation_batch(std::shared_ptr<State> state, const std::vector<std::shared_ptr<ov_type::Type>> &order_NEW,
+                                   const std::vector<std::vector<std::shared_ptr<ov_type::Type>>> &orders_OLD,
+                                   const std::vector<Eigen::MatrixXd> &Phis, const std::vector<Eigen::MatrixXd> &Qs);
+
   /**
    * @brief Performs EKF update of the state (see @ref linear-meas page)
    * @param state Pointer to state
@@ -98,6 +196,16 @@ public:
   static void set_initial_covariance(std::shared_ptr<State> state, const Eigen::MatrixXd &covariance,
                                      const std::vector<std::shared_ptr<ov_type::Type>> &order);
 
+  /**
+   * @brief This will reset the prior of a single variable that is already in the state.
+   * Its cross-covariances to every other variable are zeroed since the old correlations
+   * are meaningless under the new prior (used by the warm reinitialization logic).
+   * @param state Pointer to state
+   * @param variable Variable whose prior should be replaced
+   * @param covariance New prior covariance of this variable
+   */
+  static void reset_covariance(std::shared_ptr<State> state, std::shared_ptr<ov_type::Type> variable, const Eigen::MatrixXd &covariance);
+
   /**
    * @brief For a given set of variables, this will this will calculate a smaller covariance.
    *
@@ -112,6 +220,22 @@ public:
   static Eigen::MatrixXd get_marginal_covariance(std::shared_ptr<State> state,
                                                  const std::vector<std::shared_ptr<ov_type::Type>> &small_variables);
 
+  /**
+   * @brief Gathers the covariance into the shared gating cache for a read-only pass.
+   *
+   * The chi-squared gates of the MSCKF and SLAM updaters evaluate one quadratic form per
+   * candidate feature, and the clone blocks those features touch overlap heavily. Calling
+   * this once at the start of a gating pass copies the covariance over all active variables
+   * into one contiguous double buffer (free slots squeezed out, narrow storage widened a
+   * single time); every MarginalCovarianceView constructed with use_gating_cache then reads
+   * its blocks from that buffer. The buffer is shared between the updaters and only valid
+   * until the covariance is next modified, so it must be refreshed per pass and must never
+   * be read across an EKF update or (de)initialization.
+   *
+   * @param state Pointer to state
+   */
+  static void refresh_gating_cache(std::shared_ptr<State> state);
+
   /**
    * @brief This gets the full covariance matrix.
    *
@@ -124,6 +248,26 @@ public:
    */
   static Eigen::MatrixXd get_full_covariance(std::shared_ptr<State> state);
 
+  /**
+   * @brief Cheap incremental estimate of the covariance condition number.
+   *
+   * Runs a few power iterations against the maintained upper triangle to track the
+   * extreme eigenvalues: the largest directly, the smallest through the shifted
+   * matrix (lambda_max * I - P) which flips the spectrum ordering. The caller keeps
+   * the eigenvector estimates between frames, so a handful of iterations per call
+   * is enough to follow the slowly-moving extremes at the cost of one O(n^2)
+   * matrix-vector product each, instead of the O(n^3) decomposition an exact
+   * condition number would need. Free-list slots are zero rows of the covariance,
+   * so the iterates are explicitly kept out of that null space.
+   *
+   * @param state Pointer to state
+   * @param v_max Warm-started estimate of the largest-eigenvalue eigenvector (updated in place)
+   * @param v_min Warm-started estimate of the smallest-eigenvalue eigenvector (updated in place)
+   * @param iterations Power iterations to run on each spectrum extreme
+   * @return Estimated condition number (largest over smallest eigenvalue)
+   */
+  static double estimate_condition_number(std::shared_ptr<State> state, Eigen::VectorXd &v_max, Eigen::VectorXd &v_min, int iterations);
+
   /**
    * @brief Marginalizes a variable, properly modifying the ordering/covariances in the state
    *
@@ -142,8 +286,10 @@ public:
    * @brief Clones "variable to clone" and places it at end of covariance
    * @param state Pointer to state
    * @param variable_to_clone Pointer to variable that will be cloned
+   * @param reuse Optional recycled variable of the same type/size to clone into (avoids allocating a new one)
    */
-  static std::shared_ptr<ov_type::Type> clone(std::shared_ptr<State> state, std::shared_ptr<ov_type::Type> variable_to_clone);
+  static std::shared_ptr<ov_type::Type> clone(std::shared_ptr<State> state, std::shared_ptr<ov_type::Type> variable_to_clone,
+                                              std::shared_ptr<ov_type::Type> reuse = nullptr);
 
   /**
    * @brief Initializes new variable into covariance.
@@ -166,6 +312,67 @@ public:
                          const std::vector<std::shared_ptr<ov_type::Type>> &H_order, Eigen::MatrixXd &H_R, Eigen::MatrixXd &H_L,
                          Eigen::MatrixXd &R, Eigen::VectorXd &res, double chi_2_mult);
 
+  /**
+   * @brief One gated invertible initializing system waiting to be applied by initialize_batch()
+   */
+  struct InitSystem {
+    /// Pointer to variable to be initialized
+    std::shared_ptr<ov_type::Type> new_variable;
+    /// Vector of pointers in order they are contained in the condensed state Jacobian
+    std::vector<std::shared_ptr<ov_type::Type>> H_order;
+    /// Jacobian of initializing measurements wrt variables in H_order
+    Eigen::MatrixXd H_R;
+    /// Jacobian of initializing measurements wrt new variable (invertible)
+    Eigen::MatrixXd H_L;
+    /// Covariance of initializing measurements
+    Eigen::MatrixXd R;
+    /// Residual of initializing measurements
+    Eigen::VectorXd res;
+  };
+
+  /**
+   * @brief Givens-separates and chi2 gates an initializing system without applying it.
+   *
+   * This performs the separation and gating half of initialize(): the system is split into
+   * the invertible portion (returned in init_sys) and the leftover updating portion
+   * (returned in H_up / res_up / R_up), and the updating portion is mahalanobis tested
+   * against the current covariance. Nothing is written to the state, so a caller can gate
+   * many candidates first and then apply them all with initialize_batch() and a single
+   * stacked EKFUpdate() of the updating portions.
+   *
+   * @param state Pointer to state
+   * @param new_variable Pointer to variable to be initialized
+   * @param H_order Vector of pointers in order they are contained in the condensed state Jacobian
+   * @param H_R Jacobian of initializing measurements wrt variables in H_order
+   * @param H_L Jacobian of initializing measurements wrt new variable
+   * @param R Covariance of initializing measurements (isotropic)
+   * @param res Residual of initializing measurements
+   * @param chi_2_mult Value we should multiply the chi2 threshold by (larger means it will be accepted more measurements)
+   * @param init_sys The invertible initializing portion of the system (valid if we return true)
+   * @param H_up Jacobian of the leftover updating portion wrt variables in H_order
+   * @param res_up Residual of the leftover updating portion
+   * @param R_up Covariance of the leftover updating portion
+   * @return False if the system failed the chi2 gate
+   */
+  static bool initialize_separate(std::shared_ptr<State> state, std::shared_ptr<ov_type::Type> new_variable,
+                                  const std::vector<std::shared_ptr<ov_type::Type>> &H_order, Eigen::MatrixXd &H_R, Eigen::MatrixXd &H_L,
+                                  Eigen::MatrixXd &R, Eigen::VectorXd &res, double chi_2_mult, InitSystem &init_sys,
+                                  Eigen::MatrixXd &H_up, Eigen::VectorXd &res_up, Eigen::MatrixXd &R_up);
+
+  /**
+   * @brief Initializes a batch of new variables with one blocked covariance augmentation.
+   *
+   * Freed covariance slots of matching size are handed out first, then the covariance is
+   * grown a *single* time for all remaining variables instead of being resized and copied
+   * once per variable. The initializations themselves are applied in order so that each
+   * variable's cross covariance against the ones initialized before it is formed correctly
+   * (identical to calling initialize_invertible() once per system).
+   *
+   * @param state Pointer to state
+   * @param systems Gated invertible systems from initialize_separate(), in the order to apply them
+   */
+  static void initialize_batch(std::shared_ptr<State> state, std::vector<InitSystem> &systems);
+
   /**
    * @brief Initializes new variable into covariance (H_L must be invertible)
    *
@@ -229,7 +436,67 @@ public:
    */
   static void marginalize_slam(std::shared_ptr<State> state);
 
+  /**
+   * @brief Compacts interior free covariance slots by swapping trailing variables into them.
+   *
+   * Marginalization only zeroes a variable's rows/columns and free-lists the slot, which is
+   * what keeps the per-frame cost off the O(n^2) full shuffle. The price is that interior
+   * slots whose size never recurs (e.g. after lowering the SLAM feature budget) are never
+   * reclaimed. This pass repeatedly moves the last active variable into the lowest interior
+   * slot that can hold it and trims the freed tail, so each swap is O(n * size) instead of
+   * a full matrix copy and the covariance shrinks back to the active dimension.
+   *
+   * Scheduled automatically every StateOptions::cov_compact_interval marginalizations, but
+   * safe to call at any point where no MarginalCovarianceView is outstanding (variable ids
+   * change!).
+   *
+   * @param state Pointer to state
+   */
+  static void compact_covariance(std::shared_ptr<State> state);
+
 private:
+  /**
+   * @brief Shrinks the covariance while free slots sit at its very end.
+   *
+   * Nothing references those trailing rows/columns anymore, so the matrix can actually be
+   * resized down (interior slots stay and wait for reuse or a compaction pass).
+   *
+   * @param state Pointer to state
+   */
+  static void trim_trailing_free_slots(std::shared_ptr<State> state);
+
+  /**
+   * @brief Finds covariance rows/columns for a variable of the given size.
+   *
+   * This will first try to reuse a free slot left behind by a marginalized variable
+   * of the same size (see State::_Cov_free_slots), and only grow the covariance
+   * matrix if no such slot exists. Reused slots have already been zeroed.
+   *
+   * @param state Pointer to state
+   * @param size Error state size of the variable being inserted
+   * @return Starting row/column index of the allocated block
+   */
+  static int allocate_covariance_slot(std::shared_ptr<State> state, int size);
+
+  /**
+   * @brief Applies an invertible initializing system into an already allocated covariance slot.
+   *
+   * This is the math of initialize_invertible() with the slot allocation factored out, so
+   * initialize_batch() can place several variables into one blocked allocation.
+   *
+   * @param state Pointer to state
+   * @param new_variable Pointer to variable to be initialized
+   * @param H_order Vector of pointers in order they are contained in the condensed state Jacobian
+   * @param H_R Jacobian of initializing measurements wrt variables in H_order
+   * @param H_L Jacobian of initializing measurements wrt new variable (needs to be invertible)
+   * @param R Covariance of initializing measurements
+   * @param res Residual of initializing measurements
+   * @param new_loc Starting row/column of the covariance slot the variable will occupy
+   */
+  static void initialize_invertible_in_slot(std::shared_ptr<State> state, std::shared_ptr<ov_type::Type> new_variable,
+                                            const std::vector<std::shared_ptr<ov_type::Type>> &H_order, const Eigen::MatrixXd &H_R,
+                                            const Eigen::MatrixXd &H_L, const Eigen::MatrixXd &R, const Eigen::VectorXd &res, int new_loc);
+
   /**
    * All function in this class should be static.
    * Thus an instance of this class cannot be created.
@@ -82,6 +82,18 @@ struct StateOptions {
   /// Number of distinct cameras that we will observe features in
   int num_cameras = 1;
 
+  /// Every this many marginalizations, compact interior free covariance slots by swapping
+  /// the trailing active variables into them (0 disables). Marginalization itself only
+  /// zeroes a variable's block and free-lists the slot, so without compaction interior
+  /// slots are only reclaimed when a variable of the exact same size reuses them.
+  int cov_compact_interval = 0;
+
+  /// Bool to determine if measurements between clone times should be used by expressing them
+  /// against the two bracketing clones with pose interpolation Jacobians. This lets the frames
+  /// skipped by update_decimation still contribute measurements, so the clone rate (and thus
+  /// the covariance dimension) can sit far below the camera rate.
+  bool use_interpolated_clones = false;
+
   /// What representation our features are in (msckf features)
   ov_type::LandmarkRepresentation::Representation feat_rep_msckf = ov_type::LandmarkRepresentation::Representation::GLOBAL_3D;
 
@@ -125,6 +137,8 @@ struct StateOptions {
       parser->parse_config("max_msckf_in_update", max_msckf_in_update);
       parser->parse_config("num_aruco", max_aruco_features);
       parser->parse_config("max_cameras", num_cameras);
+      parser->parse_config("cov_compact_interval", cov_compact_interval, false);
+      parser->parse_config("use_interpolated_clones", use_interpolated_clones, false);
 
       // Feature representations
       std::string rep1 = ov_type::LandmarkRepresentation::as_string(feat_rep_msckf);
@@ -169,6 +183,8 @@ struct StateOptions {
     PRINT_DEBUG("  - max_msckf_in_update: %d\n", max_msckf_in_update);
     PRINT_DEBUG("  - max_aruco: %d\n", max_aruco_features);
     PRINT_DEBUG("  - max_cameras: %d\n", num_cameras);
+    PRINT_DEBUG("  - cov_compact_interval: %d\n", cov_compact_interval);
+    PRINT_DEBUG("  - use_interpolated_clones: %d\n", use_interpolated_clones);
     PRINT_DEBUG("  - feat_rep_msckf: %s\n", ov_type::LandmarkRepresentation::as_string(feat_rep_msckf).c_str());
     PRINT_DEBUG("  - feat_rep_slam: %s\n", ov_type::LandmarkRepresentation::as_string(feat_rep_slam).c_str());
     PRINT_DEBUG("  - feat_rep_aruco: %s\n", ov_type::LandmarkRepresentation::as_string(feat_rep_aruco).c_str());
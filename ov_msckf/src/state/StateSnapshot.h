@@ -0,0 +1,64 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2018-2023 Patrick Geneva
+ * Copyright (C) 2018-2023 Guoquan Huang
+ * Copyright (C) 2018-2023 OpenVINS Contributors
+ * Copyright (C) 2018-2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OV_MSCKF_STATE_SNAPSHOT_H
+#define OV_MSCKF_STATE_SNAPSHOT_H
+
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+
+#include <Eigen/Eigen>
+
+namespace ov_msckf {
+
+/**
+ * @brief Immutable value-copy of the estimator state for outside consumers.
+ *
+ * The filter publishes one of these after every update through an atomic pointer swap
+ * (see State::publish_snapshot), and never mutates a snapshot once it has been published.
+ * Readers such as the ROS visualizers can thus grab a self-consistent view of the
+ * estimate from any thread via State::get_snapshot() without taking the filter lock.
+ */
+struct StateSnapshot {
+
+  /// Publish counter, increments by one with every update (first snapshot is 1)
+  uint64_t version = 0;
+
+  /// Time of this estimate (last update time in camera clock frame)
+  double timestamp = -1;
+
+  /// Current IMU state value (q_GtoI, p_IinG, v_IinG, bg, ba)
+  Eigen::Matrix<double, 16, 1> imu_value;
+
+  /// Time offset base IMU to camera (t_imu = t_cam + t_off)
+  double calib_dt = 0.0;
+
+  /// Value of each clone pose mapped by imaging time (q_GtoIi, p_IiinG)
+  std::map<double, Eigen::Matrix<double, 7, 1>> clones_IMU;
+
+  /// Mean of each SLAM/ARUCO landmark in the global frame (anchored ones already resolved)
+  std::unordered_map<size_t, Eigen::Vector3d> features_SLAM;
+};
+
+} // namespace ov_msckf
+
+#endif // OV_MSCKF_STATE_SNAPSHOT_H
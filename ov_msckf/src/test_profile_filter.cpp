@@ -0,0 +1,274 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2018-2023 Patrick Geneva
+ * Copyright (C) 2018-2023 Guoquan Huang
+ * Copyright (C) 2018-2023 OpenVINS Contributors
+ * Copyright (C) 2018-2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cmath>
+#include <csignal>
+#include <memory>
+#include <vector>
+
+#include <Eigen/Dense>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include "cam/CamRadtan.h"
+#include "state/State.h"
+#include "state/StateHelper.h"
+#include "types/IMU.h"
+#include "types/Landmark.h"
+#include "types/PoseJPL.h"
+#include "update/UpdaterHelper.h"
+#include "utils/print.h"
+
+using namespace ov_msckf;
+
+// Define the function to be called when ctrl-c (SIGINT) is sent to process
+void signal_callback_handler(int signum) { std::exit(signum); }
+
+void print_stats(std::string title, std::vector<double> times) {
+
+  // Compute mean and rmse
+  double mean = 0.0;
+  double rmse = 0.0;
+  for (size_t i = 0; i < times.size(); i++) {
+    assert(!std::isnan(times.at(i)));
+    mean += times.at(i);
+    rmse += times.at(i) * times.at(i);
+  }
+  mean /= times.size();
+  rmse = std::sqrt(rmse / times.size());
+
+  // Using mean, compute standard deviation
+  double std = 0;
+  for (size_t i = 0; i < times.size(); i++) {
+    std += std::pow(times.at(i) - mean, 2);
+  }
+  std = std::sqrt(std / (times.size() - 1));
+
+  // Print!
+  PRINT_INFO("%s: %.3f +- %.3fms\n", title.c_str(), mean, std);
+}
+
+/**
+ * @brief Constructs a synthetic state with a full clone window and SLAM features.
+ *
+ * This mimics what the filter looks like in steady state: an IMU state, a single camera with
+ * realistic intrinsics/extrinsics, max_clone_size clones spaced at the cloning rate, and the
+ * requested number of SLAM landmarks appended into the covariance. The benchmarks then exercise
+ * the StateHelper and UpdaterHelper hot paths against this fixture.
+ */
+std::shared_ptr<State> build_state(int num_clones, int num_slam, double clone_dt) {
+
+  // Filter options for this fixture (single camera, no online calibration)
+  StateOptions options;
+  options.num_cameras = 1;
+  options.max_clone_size = num_clones;
+  options.max_slam_features = num_slam;
+  auto state = std::make_shared<State>(options);
+
+  // IMU at the origin with identity orientation
+  Eigen::Matrix<double, 16, 1> imu_state = Eigen::Matrix<double, 16, 1>::Zero();
+  imu_state(3) = 1.0;
+  state->_imu->set_value(imu_state);
+  state->_imu->set_fej(imu_state);
+
+  // Camera intrinsics and extrinsics (values are from a typical VGA global shutter setup)
+  Eigen::Matrix<double, 8, 1> cam_calib;
+  cam_calib << 458.654, 457.296, 367.215, 248.375, -0.28, 0.07, 0.0002, 0.00002;
+  auto camera = std::make_shared<ov_core::CamRadtan>(752, 480);
+  camera->set_value(cam_calib);
+  state->_cam_intrinsics_cameras.insert({0, camera});
+  state->_cam_intrinsics.at(0)->set_value(cam_calib);
+  state->_cam_intrinsics.at(0)->set_fej(cam_calib);
+  Eigen::Matrix<double, 7, 1> cam_eigen;
+  cam_eigen << 0, 0, 0, 1, 0, 0, 0;
+  state->_calib_IMUtoCAM.at(0)->set_value(cam_eigen);
+  state->_calib_IMUtoCAM.at(0)->set_fej(cam_eigen);
+
+  // Fill the clone window, moving the IMU slightly between clones so poses are distinct
+  for (int i = 0; i < num_clones; i++) {
+    state->_timestamp = clone_dt * i;
+    imu_state(4) = 0.05 * i;
+    imu_state(5) = 0.02 * i;
+    state->_imu->set_value(imu_state);
+    state->_imu->set_fej(imu_state);
+    StateHelper::augment_clone(state, Eigen::Vector3d::Zero());
+  }
+
+  // Append SLAM features with an invertible initializing system off the newest clone
+  std::shared_ptr<ov_type::PoseJPL> clone_newest = state->_clones_IMU.rbegin()->second;
+  for (int i = 0; i < num_slam; i++) {
+    auto landmark = std::make_shared<ov_type::Landmark>(3);
+    landmark->_featid = i;
+    landmark->_feat_representation = ov_type::LandmarkRepresentation::Representation::GLOBAL_3D;
+    Eigen::Vector3d p_FinG(0.5 * std::sin(0.5 * i), 0.5 * std::cos(0.3 * i), 4.0 + 0.1 * (i % 10));
+    landmark->set_from_xyz(p_FinG, false);
+    landmark->set_from_xyz(p_FinG, true);
+    std::vector<std::shared_ptr<ov_type::Type>> H_order = {clone_newest};
+    Eigen::MatrixXd H_R = Eigen::MatrixXd::Zero(3, 6);
+    Eigen::MatrixXd H_L = Eigen::MatrixXd::Identity(3, 3);
+    Eigen::MatrixXd R = std::pow(0.1, 2) * Eigen::MatrixXd::Identity(3, 3);
+    Eigen::VectorXd res = Eigen::VectorXd::Zero(3);
+    StateHelper::initialize_invertible(state, landmark, H_order, H_R, H_L, R, res);
+    state->_features_SLAM.insert({i, landmark});
+  }
+  return state;
+}
+
+/**
+ * @brief Builds MSCKF-style features seen by every clone of the given state.
+ *
+ * Measurements are the exact reprojections of the landmark, so the residuals are zero and the
+ * Jacobian construction is the only work being timed.
+ */
+std::vector<UpdaterHelper::UpdaterHelperFeature> build_features(std::shared_ptr<State> state, int num_feats) {
+  std::vector<UpdaterHelper::UpdaterHelperFeature> features;
+  Eigen::Matrix3d R_ItoC = state->_calib_IMUtoCAM.at(0)->Rot();
+  Eigen::Vector3d p_IinC = state->_calib_IMUtoCAM.at(0)->pos();
+  for (int i = 0; i < num_feats; i++) {
+    UpdaterHelper::UpdaterHelperFeature feat;
+    feat.featid = i;
+    feat.feat_representation = ov_type::LandmarkRepresentation::Representation::GLOBAL_3D;
+    feat.p_FinG = Eigen::Vector3d(0.8 * std::sin(0.7 * i), 0.8 * std::cos(0.4 * i), 5.0 + 0.1 * (i % 10));
+    feat.p_FinG_fej = feat.p_FinG;
+    for (auto const &clone : state->_clones_IMU) {
+      Eigen::Vector3d p_FinCi = R_ItoC * clone.second->Rot() * (feat.p_FinG - clone.second->pos()) + p_IinC;
+      Eigen::Vector2d uv_norm(p_FinCi(0) / p_FinCi(2), p_FinCi(1) / p_FinCi(2));
+      Eigen::Vector2d uv_dist = state->_cam_intrinsics_cameras.at(0)->distort_d(uv_norm);
+      feat.timestamps[0].push_back(clone.first);
+      feat.uvs_norm[0].push_back(uv_norm.cast<float>());
+      feat.uvs[0].push_back(uv_dist.cast<float>());
+    }
+    features.push_back(feat);
+  }
+  return features;
+}
+
+// Main function
+int main(int argc, char **argv) {
+
+  // Verbosity
+  std::string verbosity = "INFO";
+  ov_core::Printer::setPrintLevel(verbosity);
+
+  // Ctrl-C handler
+  signal(SIGINT, signal_callback_handler);
+
+  // Parameters used in all benchmarks
+  int num_trials = 100;
+  int num_feats = 50;
+  double clone_dt = 0.05;
+  std::vector<std::pair<int, int>> configs = {{11, 25}, {20, 50}, {40, 100}};
+
+  // Helper data structures
+  std::vector<double> times_ms;
+  std::vector<double> times_ms2;
+
+  // Loop through each clone / SLAM feature configuration
+  for (auto const &config : configs) {
+    int num_clones = config.first;
+    int num_slam = config.second;
+    PRINT_INFO("========== %d CLONES / %d SLAM FEATURES ==========\n", num_clones, num_slam);
+    auto state = build_state(num_clones, num_slam, clone_dt);
+
+    // STATE: EKF PROPAGATION (imu covariance propagation)
+    times_ms.clear();
+    std::vector<std::shared_ptr<ov_type::Type>> order = {state->_imu};
+    Eigen::MatrixXd Phi = Eigen::MatrixXd::Identity(15, 15);
+    Phi.block(0, 3, 3, 3) = 0.01 * Eigen::Matrix3d::Ones();
+    Eigen::MatrixXd Qd = 1e-8 * Eigen::MatrixXd::Identity(15, 15);
+    for (int i = 0; i < num_trials; i++) {
+      auto rT1 = boost::posix_time::microsec_clock::local_time();
+      StateHelper::EKFPropagation(state, order, order, Phi, Qd);
+      auto rT2 = boost::posix_time::microsec_clock::local_time();
+      times_ms.push_back((rT2 - rT1).total_microseconds() * 1e-3);
+    }
+    print_stats("STATE: EKF PROPAGATION", times_ms);
+
+    // STATE: EKF UPDATE (compressed jacobian over the whole clone window)
+    times_ms.clear();
+    std::vector<std::shared_ptr<ov_type::Type>> H_order;
+    for (auto const &clone : state->_clones_IMU) {
+      H_order.push_back(clone.second);
+    }
+    int state_cols = 6 * num_clones;
+    Eigen::MatrixXd H = Eigen::MatrixXd::Random(state_cols, state_cols);
+    Eigen::VectorXd res = Eigen::VectorXd::Zero(state_cols);
+    Eigen::MatrixXd R = std::pow(1.0, 2) * Eigen::MatrixXd::Identity(state_cols, state_cols);
+    for (int i = 0; i < num_trials; i++) {
+      auto rT1 = boost::posix_time::microsec_clock::local_time();
+      StateHelper::EKFUpdate(state, H_order, H, res, R);
+      auto rT2 = boost::posix_time::microsec_clock::local_time();
+      times_ms.push_back((rT2 - rT1).total_microseconds() * 1e-3);
+    }
+    print_stats("STATE: EKF UPDATE", times_ms);
+
+    // STATE: AUGMENT CLONE / MARGINALIZE (steady state sliding window cycle)
+    times_ms.clear();
+    times_ms2.clear();
+    for (int i = 0; i < num_trials; i++) {
+      state->_timestamp += clone_dt;
+      auto rT1 = boost::posix_time::microsec_clock::local_time();
+      StateHelper::augment_clone(state, Eigen::Vector3d::Zero());
+      auto rT2 = boost::posix_time::microsec_clock::local_time();
+      StateHelper::marginalize_old_clone(state);
+      auto rT3 = boost::posix_time::microsec_clock::local_time();
+      times_ms.push_back((rT2 - rT1).total_microseconds() * 1e-3);
+      times_ms2.push_back((rT3 - rT2).total_microseconds() * 1e-3);
+    }
+    print_stats("STATE: AUGMENT CLONE", times_ms);
+    print_stats("STATE: MARGINALIZE OLD CLONE", times_ms2);
+
+    // UPDATE: FEATURE JACOBIAN FULL (stacked jacobians for a batch of msckf features)
+    // NOTE: features are rebuilt since the clone window has slid during the cycle above
+    times_ms.clear();
+    auto features = build_features(state, num_feats);
+    for (int i = 0; i < num_trials; i++) {
+      auto rT1 = boost::posix_time::microsec_clock::local_time();
+      for (auto &feat : features) {
+        Eigen::MatrixXd H_f, H_x;
+        Eigen::VectorXd res_f;
+        std::vector<std::shared_ptr<ov_type::Type>> x_order;
+        UpdaterHelper::get_feature_jacobian_full(state, feat, H_f, H_x, res_f, x_order);
+      }
+      auto rT2 = boost::posix_time::microsec_clock::local_time();
+      times_ms.push_back((rT2 - rT1).total_microseconds() * 1e-3);
+    }
+    print_stats("UPDATE: FEATURE JACOBIAN FULL (" + std::to_string(num_feats) + " feats)", times_ms);
+
+    // UPDATE: MEASUREMENT COMPRESS (stacked system from the batch above)
+    times_ms.clear();
+    int meas_rows = 2 * num_feats * num_clones;
+    Eigen::MatrixXd H_big = Eigen::MatrixXd::Random(meas_rows, state_cols);
+    Eigen::VectorXd res_big = Eigen::VectorXd::Random(meas_rows);
+    for (int i = 0; i < num_trials; i++) {
+      Eigen::MatrixXd H_x = H_big;
+      Eigen::VectorXd res_x = res_big;
+      auto rT1 = boost::posix_time::microsec_clock::local_time();
+      UpdaterHelper::measurement_compress_inplace(H_x, res_x);
+      auto rT2 = boost::posix_time::microsec_clock::local_time();
+      times_ms.push_back((rT2 - rT1).total_microseconds() * 1e-3);
+    }
+    print_stats("UPDATE: MEASUREMENT COMPRESS", times_ms);
+  }
+
+  // Done!
+  return EXIT_SUCCESS;
+}
@@ -1,8 +1,12 @@
 #include "UpdaterGlobal.h"
 
+#include <algorithm>
+#include <map>
+
 #include "state/State.h"
 #include "state/StateHelper.h"
 #include "types/PoseJPL.h"
+#include "utils/print.h"
 
 using namespace ov_msckf;
 
@@ -14,14 +18,70 @@ void UpdaterGlobal::feed_gps(const ov_core::GPSData &message) {
 }
 
 void UpdaterGlobal::update(std::shared_ptr<State> state) {
-  for (auto const &gps : gps_data) {
-    std::shared_ptr<ov_type::PoseJPL> pose_imu = state->_imu->pose();
 
-    // Calculate the measurement residual
-    Eigen::Matrix<double, 3, 1> res = gps.z_global - (pose_imu->pos() - gps.T_V1toV2);
+  // Take ownership of everything queued up since the last call
+  std::vector<ov_core::GPSData> pending;
+  {
+    std::lock_guard<std::mutex> lck(gps_data_mtx);
+    pending.swap(gps_data);
+  }
+  if (pending.empty())
+    return;
+  std::sort(pending.begin(), pending.end());
+
+  // Match each measurement to the clone nearest to it in time, falling back to
+  // the newest state when the clone window is empty. Measurements from ahead of
+  // the current state are deferred until propagation catches up to them.
+  std::vector<ov_core::GPSData> deferred;
+  std::vector<std::pair<ov_core::GPSData, std::shared_ptr<ov_type::PoseJPL>>> matched;
+  for (auto const &gps : pending) {
+    if (gps.timestamp > state->_timestamp) {
+      deferred.push_back(gps);
+      continue;
+    }
+    std::shared_ptr<ov_type::PoseJPL> anchor = state->_imu->pose();
+    double best_dt = std::abs(state->_timestamp - gps.timestamp);
+    for (auto const &clone : state->_clones_IMU) {
+      double dt = std::abs(clone.first - gps.timestamp);
+      if (dt < best_dt) {
+        best_dt = dt;
+        anchor = clone.second;
+      }
+    }
+    matched.emplace_back(gps, anchor);
+  }
+  if (!deferred.empty()) {
+    std::lock_guard<std::mutex> lck(gps_data_mtx);
+    gps_data.insert(gps_data.begin(), deferred.begin(), deferred.end());
+  }
+  if (matched.empty())
+    return;
+
+  // Collect the unique position variables the stacked system touches
+  std::vector<std::shared_ptr<ov_type::Type>> Hx_order;
+  std::map<std::shared_ptr<ov_type::Type>, size_t> Hx_mapping;
+  for (auto const &pair : matched) {
+    std::shared_ptr<ov_type::Type> var = pair.second->p();
+    if (Hx_mapping.find(var) == Hx_mapping.end()) {
+      Hx_mapping.insert({var, 3 * Hx_order.size()});
+      Hx_order.push_back(var);
+    }
+  }
+
+  // Stack the whole burst into one linear system with block-diagonal noise
+  size_t rows = 3 * matched.size();
+  Eigen::MatrixXd H_big = Eigen::MatrixXd::Zero(rows, 3 * Hx_order.size());
+  Eigen::VectorXd res_big = Eigen::VectorXd::Zero(rows);
+  Eigen::MatrixXd R_big = Eigen::MatrixXd::Zero(rows, rows);
+  size_t row = 0;
+  for (auto const &pair : matched) {
+    const ov_core::GPSData &gps = pair.first;
+
+    // Calculate the measurement residual about the matched clone
+    res_big.segment(row, 3) = gps.z_global - (pair.second->pos() - gps.T_V1toV2);
 
     // Calculate the measurement Jacobians
-    Eigen::Matrix<double, 3, 3> H = Eigen::Matrix<double, 3, 3>::Identity();
+    H_big.block(row, Hx_mapping.at(pair.second->p()), 3, 3).setIdentity();
     Eigen::Matrix<double, 3, 6> F = Eigen::Matrix<double, 3, 6>::Zero();
     F.block(0, 0, 3, 3) = -Eigen::Matrix<double, 3, 3>::Identity();
     F.block(0, 3, 3, 3) = -Eigen::Matrix<double, 3, 3>::Identity();
@@ -30,22 +90,20 @@ void UpdaterGlobal::update(std::shared_ptr<State> state) {
     Eigen::Matrix<double, 6, 6> Sigma_z = Eigen::Matrix<double, 6, 6>::Zero();
     Sigma_z.block(0, 0, 3, 3) = gps.cov_z_global;
     Sigma_z.block(3, 3, 3, 3) = gps.cov_T_V1toV2;
-    Eigen::Matrix<double, 3, 3> R = F * Sigma_z * F.transpose();
-
-    // Perform the EKF update
-    StateHelper::EKFUpdate(state, {pose_imu->p()}, H, res, R);
+    R_big.block(row, row, 3, 3) = F * Sigma_z * F.transpose();
+    row += 3;
   }
 
-  // Clear out old/invalid data
-  if (gps_data.size() > 0) {
-    gps_data.clear();
-
-    // Remove all clones
-    for (auto& clone : state->_clones_IMU) {
-      StateHelper::marginalize(state, clone.second);
-    }
-    state->_clones_IMU.clear();
+  // Perform the EKF update (single covariance pass for the whole burst)
+  StateHelper::EKFUpdate(state, Hx_order, H_big, res_big, R_big);
+  PRINT_DEBUG("[GPS]: coalesced %zu global measurements into one update (%zu deferred)\n", matched.size(), deferred.size());
 
-    state->reset_keyframe();
+  // Remove all clones
+  for (auto &clone : state->_clones_IMU) {
+    StateHelper::marginalize(state, clone.second);
   }
+  state->_clones_IMU.clear();
+  state->_clones_index.clear();
+
+  state->reset_keyframe();
 }
@@ -35,6 +35,12 @@ public:
   /**
    * @brief Update the state with the global measurements and remove IMU clones
    *
+   * All queued measurements are stacked into a single combined update so a burst of
+   * readings between frames only pays for one covariance pass. Each measurement is
+   * anchored to the clone nearest to it in time (late arrivals are not forced through
+   * the newest state), and measurements from ahead of the current state stay queued
+   * until propagation catches up to them.
+   *
    * @param state State of the filter
    */
   void update(std::shared_ptr<State> state);
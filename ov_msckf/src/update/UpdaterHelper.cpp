@@ -21,9 +21,15 @@
 
 #include "UpdaterHelper.h"
 
+#include "UpdaterJacobianEngine.h"
+
 #include "state/State.h"
 
+#include "feat/Feature.h"
+#include "utils/colors.h"
+#include "utils/print.h"
 #include "utils/quat_ops.h"
+#include "utils/small_vector.h"
 
 using namespace ov_core;
 using namespace ov_type;
@@ -32,161 +38,59 @@ using namespace ov_msckf;
 void UpdaterHelper::get_feature_jacobian_representation(std::shared_ptr<State> state, UpdaterHelperFeature &feature, Eigen::MatrixXd &H_f,
                                                         std::vector<Eigen::MatrixXd> &H_x, std::vector<std::shared_ptr<Type>> &x_order) {
 
-  // Global XYZ representation
-  if (feature.feat_representation == LandmarkRepresentation::Representation::GLOBAL_3D) {
-    H_f.resize(3, 3);
-    H_f.setIdentity();
-    return;
-  }
-
-  // Global inverse depth representation
-  if (feature.feat_representation == LandmarkRepresentation::Representation::GLOBAL_FULL_INVERSE_DEPTH) {
-
-    // Get the feature linearization point
-    Eigen::Matrix<double, 3, 1> p_FinG = (state->_options.do_fej) ? feature.p_FinG_fej : feature.p_FinG;
-
-    // Get inverse depth representation (should match what is in Landmark.cpp)
-    double g_rho = 1 / p_FinG.norm();
-    double g_phi = std::acos(g_rho * p_FinG(2));
-    // double g_theta = std::asin(g_rho*p_FinG(1)/std::sin(g_phi));
-    double g_theta = std::atan2(p_FinG(1), p_FinG(0));
-    Eigen::Matrix<double, 3, 1> p_invFinG;
-    p_invFinG(0) = g_theta;
-    p_invFinG(1) = g_phi;
-    p_invFinG(2) = g_rho;
-
-    // Get inverse depth bearings
-    double sin_th = std::sin(p_invFinG(0, 0));
-    double cos_th = std::cos(p_invFinG(0, 0));
-    double sin_phi = std::sin(p_invFinG(1, 0));
-    double cos_phi = std::cos(p_invFinG(1, 0));
-    double rho = p_invFinG(2, 0);
-
-    // Construct the Jacobian
-    H_f.resize(3, 3);
-    H_f << -(1.0 / rho) * sin_th * sin_phi, (1.0 / rho) * cos_th * cos_phi, -(1.0 / (rho * rho)) * cos_th * sin_phi,
-        (1.0 / rho) * cos_th * sin_phi, (1.0 / rho) * sin_th * cos_phi, -(1.0 / (rho * rho)) * sin_th * sin_phi, 0.0,
-        -(1.0 / rho) * sin_phi, -(1.0 / (rho * rho)) * cos_phi;
-    return;
-  }
-
-  //======================================================================
-  //======================================================================
-  //======================================================================
-
-  // Assert that we have an anchor pose for this feature
-  assert(feature.anchor_cam_id != -1);
-
-  // Anchor pose orientation and position, and camera calibration for our anchor camera
-  Eigen::Matrix3d R_ItoC = state->_calib_IMUtoCAM.at(feature.anchor_cam_id)->Rot();
-  Eigen::Vector3d p_IinC = state->_calib_IMUtoCAM.at(feature.anchor_cam_id)->pos();
-  Eigen::Matrix3d R_GtoI = state->_clones_IMU.at(feature.anchor_clone_timestamp)->Rot();
-  Eigen::Vector3d p_IinG = state->_clones_IMU.at(feature.anchor_clone_timestamp)->pos();
-  Eigen::Vector3d p_FinA = feature.p_FinA;
-
-  // If I am doing FEJ, I should FEJ the anchor states (should we fej calibration???)
-  // Also get the FEJ position of the feature if we are
-  if (state->_options.do_fej) {
-    // "Best" feature in the global frame
-    Eigen::Vector3d p_FinG_best = R_GtoI.transpose() * R_ItoC.transpose() * (feature.p_FinA - p_IinC) + p_IinG;
-    // Transform the best into our anchor frame using FEJ
-    R_GtoI = state->_clones_IMU.at(feature.anchor_clone_timestamp)->Rot_fej();
-    p_IinG = state->_clones_IMU.at(feature.anchor_clone_timestamp)->pos_fej();
-    p_FinA = (R_GtoI.transpose() * R_ItoC.transpose()).transpose() * (p_FinG_best - p_IinG) + p_IinC;
-  }
-  Eigen::Matrix3d R_CtoG = R_GtoI.transpose() * R_ItoC.transpose();
-
-  // Jacobian for our anchor pose
-  Eigen::Matrix<double, 3, 6> H_anc;
-  H_anc.block(0, 0, 3, 3).noalias() = -R_GtoI.transpose() * skew_x(R_ItoC.transpose() * (p_FinA - p_IinC));
-  H_anc.block(0, 3, 3, 3).setIdentity();
-
-  // Add anchor Jacobians to our return vector
-  x_order.push_back(state->_clones_IMU.at(feature.anchor_clone_timestamp));
-  H_x.push_back(H_anc);
-
-  // Get calibration Jacobians (for anchor clone)
-  if (state->_options.do_calib_camera_pose) {
-    Eigen::Matrix<double, 3, 6> H_calib;
-    H_calib.block(0, 0, 3, 3).noalias() = -R_CtoG * skew_x(p_FinA - p_IinC);
-    H_calib.block(0, 3, 3, 3) = -R_CtoG;
-    x_order.push_back(state->_calib_IMUtoCAM.at(feature.anchor_cam_id));
-    H_x.push_back(H_calib);
-  }
-
-  // If we are doing anchored XYZ feature
-  if (feature.feat_representation == LandmarkRepresentation::Representation::ANCHORED_3D) {
-    H_f = R_CtoG;
-    return;
-  }
-
-  // If we are doing full inverse depth
-  if (feature.feat_representation == LandmarkRepresentation::Representation::ANCHORED_FULL_INVERSE_DEPTH) {
-
-    // Get inverse depth representation (should match what is in Landmark.cpp)
-    double a_rho = 1 / p_FinA.norm();
-    double a_phi = std::acos(a_rho * p_FinA(2));
-    double a_theta = std::atan2(p_FinA(1), p_FinA(0));
-    Eigen::Matrix<double, 3, 1> p_invFinA;
-    p_invFinA(0) = a_theta;
-    p_invFinA(1) = a_phi;
-    p_invFinA(2) = a_rho;
-
-    // Using anchored inverse depth
-    double sin_th = std::sin(p_invFinA(0, 0));
-    double cos_th = std::cos(p_invFinA(0, 0));
-    double sin_phi = std::sin(p_invFinA(1, 0));
-    double cos_phi = std::cos(p_invFinA(1, 0));
-    double rho = p_invFinA(2, 0);
-    // assert(p_invFinA(2,0)>=0.0);
-
-    // Jacobian of anchored 3D position wrt inverse depth parameters
-    Eigen::Matrix<double, 3, 3> d_pfinA_dpinv;
-    d_pfinA_dpinv << -(1.0 / rho) * sin_th * sin_phi, (1.0 / rho) * cos_th * cos_phi, -(1.0 / (rho * rho)) * cos_th * sin_phi,
-        (1.0 / rho) * cos_th * sin_phi, (1.0 / rho) * sin_th * cos_phi, -(1.0 / (rho * rho)) * sin_th * sin_phi, 0.0,
-        -(1.0 / rho) * sin_phi, -(1.0 / (rho * rho)) * cos_phi;
-    H_f = R_CtoG * d_pfinA_dpinv;
-    return;
-  }
-
-  // If we are doing the MSCKF version of inverse depth
-  if (feature.feat_representation == LandmarkRepresentation::Representation::ANCHORED_MSCKF_INVERSE_DEPTH) {
-
-    // Get inverse depth representation (should match what is in Landmark.cpp)
-    Eigen::Matrix<double, 3, 1> p_invFinA_MSCKF;
-    p_invFinA_MSCKF(0) = p_FinA(0) / p_FinA(2);
-    p_invFinA_MSCKF(1) = p_FinA(1) / p_FinA(2);
-    p_invFinA_MSCKF(2) = 1 / p_FinA(2);
-
-    // Using the MSCKF version of inverse depth
-    double alpha = p_invFinA_MSCKF(0, 0);
-    double beta = p_invFinA_MSCKF(1, 0);
-    double rho = p_invFinA_MSCKF(2, 0);
-
-    // Jacobian of anchored 3D position wrt inverse depth parameters
-    Eigen::Matrix<double, 3, 3> d_pfinA_dpinv;
-    d_pfinA_dpinv << (1.0 / rho), 0.0, -(1.0 / (rho * rho)) * alpha, 0.0, (1.0 / rho), -(1.0 / (rho * rho)) * beta, 0.0, 0.0,
-        -(1.0 / (rho * rho));
-    H_f = R_CtoG * d_pfinA_dpinv;
-    return;
-  }
-
-  /// CASE: Estimate single depth of the feature using the initial bearing
-  if (feature.feat_representation == LandmarkRepresentation::Representation::ANCHORED_INVERSE_DEPTH_SINGLE) {
+  // Dispatch into the engine built for this representation (see UpdaterJacobianEngine)
+  // The engine also caches per-anchor-clone rotation/position terms across features
+  UpdaterJacobianEngine::get(feature.feat_representation)->jacobian_representation(state, feature, H_f, H_x, x_order);
+}
 
-    // Get inverse depth representation (should match what is in Landmark.cpp)
-    double rho = 1.0 / p_FinA(2);
-    Eigen::Vector3d bearing = rho * p_FinA;
+bool UpdaterHelper::interpolate_clone_pose(std::shared_ptr<State> state, double timestamp, InterpolatedClone &interp) {
+
+  // Find the clones bounding this timestamp (the clone map is ordered by time)
+  auto it1 = state->_clones_IMU.upper_bound(timestamp);
+  if (it1 == state->_clones_IMU.begin() || it1 == state->_clones_IMU.end())
+    return false;
+  auto it0 = std::prev(it1);
+  interp.clone0 = it0->second;
+  interp.clone1 = it1->second;
+  interp.lambda = (timestamp - it0->first) / (it1->first - it0->first);
+
+  // Geodesic orientation and linear position blend between the bounding clones
+  Eigen::Matrix3d R_Gto0 = interp.clone0->Rot();
+  Eigen::Matrix3d R_Gto1 = interp.clone1->Rot();
+  interp.R_GtoI = exp_so3(interp.lambda * log_so3(R_Gto1 * R_Gto0.transpose())) * R_Gto0;
+  interp.p_IinG = (1.0 - interp.lambda) * interp.clone0->pos() + interp.lambda * interp.clone1->pos();
+
+  // Same blend of the first estimates for FEJ
+  Eigen::Matrix3d R_Gto0_fej = interp.clone0->Rot_fej();
+  Eigen::Matrix3d R_Gto1_fej = interp.clone1->Rot_fej();
+  interp.R_GtoI_fej = exp_so3(interp.lambda * log_so3(R_Gto1_fej * R_Gto0_fej.transpose())) * R_Gto0_fej;
+  interp.p_IinG_fej = (1.0 - interp.lambda) * interp.clone0->pos_fej() + interp.lambda * interp.clone1->pos_fej();
+  return true;
+}
 
-    // Jacobian of anchored 3D position wrt inverse depth parameters
-    Eigen::Vector3d d_pfinA_drho;
-    d_pfinA_drho << -(1.0 / (rho * rho)) * bearing;
-    H_f = R_CtoG * d_pfinA_drho;
-    return;
+void UpdaterHelper::add_interpolated_clone_poses(
+    std::shared_ptr<State> state, const std::vector<std::shared_ptr<ov_core::Feature>> &features,
+    std::unordered_map<size_t, std::unordered_map<double, ov_core::FeatureInitializer::ClonePose>> &clones_cam) {
+
+  // Walk every measurement time and fill in the poses the clone times do not cover
+  for (const auto &feature : features) {
+    for (const auto &pair : feature->timestamps) {
+      auto &clones_cami = clones_cam.at(pair.first);
+      Eigen::Matrix3d R_ItoC = state->_calib_IMUtoCAM.at(pair.first)->Rot();
+      Eigen::Vector3d p_IinC = state->_calib_IMUtoCAM.at(pair.first)->pos();
+      for (size_t m = 0; m < pair.second.size(); m++) {
+        double time = pair.second.at(m);
+        if (clones_cami.find(time) != clones_cami.end())
+          continue;
+        InterpolatedClone interp;
+        if (!interpolate_clone_pose(state, time, interp))
+          continue;
+        Eigen::Matrix3d R_GtoCi = R_ItoC * interp.R_GtoI;
+        Eigen::Vector3d p_CiinG = interp.p_IinG - R_GtoCi.transpose() * p_IinC;
+        clones_cami.insert({time, FeatureInitializer::ClonePose(R_GtoCi, p_CiinG)});
+      }
+    }
   }
-
-  // Failure, invalid representation that is not programmed
-  assert(false);
 }
 
 void UpdaterHelper::get_feature_jacobian_full(std::shared_ptr<State> state, UpdaterHelperFeature &feature, Eigen::MatrixXd &H_f,
@@ -199,8 +103,17 @@ void UpdaterHelper::get_feature_jacobian_full(std::shared_ptr<State> state, Upda
   }
 
   // Compute the size of the states involved with this feature
+  // The map is keyed by the covariance location of each variable and only ever holds
+  // the observing clones plus calibration (a dozen or so entries), so we keep it in a
+  // stack-inline flat list with linear search instead of a heap-backed hash map
   int total_hx = 0;
-  std::unordered_map<std::shared_ptr<Type>, size_t> map_hx;
+  ov_core::SmallVector<std::pair<int, int>, 32> map_hx;
+  auto map_hx_find = [&map_hx](int id) {
+    for (const auto &entry : map_hx)
+      if (entry.first == id)
+        return entry.second;
+    return -1;
+  };
   for (auto const &pair : feature.timestamps) {
 
     // Our extrinsics and intrinsics
@@ -209,14 +122,14 @@ void UpdaterHelper::get_feature_jacobian_full(std::shared_ptr<State> state, Upda
 
     // If doing calibration extrinsics
     if (state->_options.do_calib_camera_pose) {
-      map_hx.insert({calibration, total_hx});
+      map_hx.emplace_back(calibration->id(), total_hx);
       x_order.push_back(calibration);
       total_hx += calibration->size();
     }
 
     // If doing calibration intrinsics
     if (state->_options.do_calib_camera_intrinsics) {
-      map_hx.insert({distortion, total_hx});
+      map_hx.emplace_back(distortion->id(), total_hx);
       x_order.push_back(distortion);
       total_hx += distortion->size();
     }
@@ -225,9 +138,25 @@ void UpdaterHelper::get_feature_jacobian_full(std::shared_ptr<State> state, Upda
     for (size_t m = 0; m < feature.timestamps[pair.first].size(); m++) {
 
       // Add this clone if it is not added already
-      std::shared_ptr<PoseJPL> clone_Ci = state->_clones_IMU.at(feature.timestamps[pair.first].at(m));
-      if (map_hx.find(clone_Ci) == map_hx.end()) {
-        map_hx.insert({clone_Ci, total_hx});
+      // A measurement between clone times instead adds its two bracketing clones
+      // (see interpolate_clone_pose, enabled with use_interpolated_clones)
+      std::shared_ptr<PoseJPL> clone_Ci = state->get_clone(feature.timestamps[pair.first].at(m));
+      if (clone_Ci == nullptr) {
+        InterpolatedClone interp;
+        bool bracketed = interpolate_clone_pose(state, feature.timestamps[pair.first].at(m), interp);
+        assert(state->_options.use_interpolated_clones && bracketed);
+        (void)bracketed;
+        for (const auto &clone : {interp.clone0, interp.clone1}) {
+          if (map_hx_find(clone->id()) == -1) {
+            map_hx.emplace_back(clone->id(), total_hx);
+            x_order.push_back(clone);
+            total_hx += clone->size();
+          }
+        }
+        continue;
+      }
+      if (map_hx_find(clone_Ci->id()) == -1) {
+        map_hx.emplace_back(clone_Ci->id(), total_hx);
         x_order.push_back(clone_Ci);
         total_hx += clone_Ci->size();
       }
@@ -241,9 +170,10 @@ void UpdaterHelper::get_feature_jacobian_full(std::shared_ptr<State> state, Upda
     assert(feature.anchor_cam_id != -1);
 
     // Add this anchor if it is not added already
-    std::shared_ptr<PoseJPL> clone_Ai = state->_clones_IMU.at(feature.anchor_clone_timestamp);
-    if (map_hx.find(clone_Ai) == map_hx.end()) {
-      map_hx.insert({clone_Ai, total_hx});
+    std::shared_ptr<PoseJPL> clone_Ai = state->get_clone(feature.anchor_clone_timestamp);
+    assert(clone_Ai != nullptr);
+    if (map_hx_find(clone_Ai->id()) == -1) {
+      map_hx.emplace_back(clone_Ai->id(), total_hx);
       x_order.push_back(clone_Ai);
       total_hx += clone_Ai->size();
     }
@@ -252,8 +182,8 @@ void UpdaterHelper::get_feature_jacobian_full(std::shared_ptr<State> state, Upda
     if (state->_options.do_calib_camera_pose) {
       // Add this anchor if it is not added already
       std::shared_ptr<PoseJPL> clone_calib = state->_calib_IMUtoCAM.at(feature.anchor_cam_id);
-      if (map_hx.find(clone_calib) == map_hx.end()) {
-        map_hx.insert({clone_calib, total_hx});
+      if (map_hx_find(clone_calib->id()) == -1) {
+        map_hx.emplace_back(clone_calib->id(), total_hx);
         x_order.push_back(clone_calib);
         total_hx += clone_calib->size();
       }
@@ -269,14 +199,11 @@ void UpdaterHelper::get_feature_jacobian_full(std::shared_ptr<State> state, Upda
   if (LandmarkRepresentation::is_relative_representation(feature.feat_representation)) {
     // Assert that we have an anchor pose for this feature
     assert(feature.anchor_cam_id != -1);
-    // Get calibration for our anchor camera
-    Eigen::Matrix3d R_ItoC = state->_calib_IMUtoCAM.at(feature.anchor_cam_id)->Rot();
-    Eigen::Vector3d p_IinC = state->_calib_IMUtoCAM.at(feature.anchor_cam_id)->pos();
-    // Anchor pose orientation and position
-    Eigen::Matrix3d R_GtoI = state->_clones_IMU.at(feature.anchor_clone_timestamp)->Rot();
-    Eigen::Vector3d p_IinG = state->_clones_IMU.at(feature.anchor_clone_timestamp)->pos();
+    // Anchor camera calibration and anchor pose (served from the per-pass clone term cache)
+    const UpdaterJacobianEngine::CloneTerms &anchor =
+        UpdaterJacobianEngine::clone_terms(state, feature.anchor_cam_id, feature.anchor_clone_timestamp);
     // Feature in the global frame
-    p_FinG = R_GtoI.transpose() * R_ItoC.transpose() * (feature.p_FinA - p_IinC) + p_IinG;
+    p_FinG = anchor.R_GtoC.transpose() * (feature.p_FinA - anchor.p_IinC) + anchor.p_IinG;
   }
 
   // Calculate the position of this feature in the global frame FEJ
@@ -298,23 +225,32 @@ void UpdaterHelper::get_feature_jacobian_full(std::shared_ptr<State> state, Upda
 
   // Derivative of p_FinG in respect to feature representation.
   // This only needs to be computed once and thus we pull it out of the loop
-  Eigen::MatrixXd dpfg_dlambda;
-  std::vector<Eigen::MatrixXd> dpfg_dx;
-  std::vector<std::shared_ptr<Type>> dpfg_dx_order;
+  // The workspaces are thread local (like the nullspace projection below) so their
+  // one or two entries stop costing a heap round trip per feature
+  static thread_local Eigen::MatrixXd dpfg_dlambda;
+  static thread_local std::vector<Eigen::MatrixXd> dpfg_dx;
+  static thread_local std::vector<std::shared_ptr<Type>> dpfg_dx_order;
+  dpfg_dx.clear();
+  dpfg_dx_order.clear();
   UpdaterHelper::get_feature_jacobian_representation(state, feature, dpfg_dlambda, dpfg_dx, dpfg_dx_order);
 
   // Assert that all the ones in our order are already in our local jacobian mapping
 #ifndef NDEBUG
   for (auto &type : dpfg_dx_order) {
-    assert(map_hx.find(type) != map_hx.end());
+    assert(map_hx_find(type->id()) != -1);
   }
 #endif
 
+  // Distortion Jacobians, hoisted out of the loop so their storage is reused
+  // (the camera models resize these, which is a no-op after the first measurement)
+  Eigen::MatrixXd dz_dzn, dz_dzeta;
+
   // Loop through each camera for this feature
   for (auto const &pair : feature.timestamps) {
 
     // Our calibration between the IMU and CAMi frames
     std::shared_ptr<Vec> distortion = state->_cam_intrinsics.at(pair.first);
+    std::shared_ptr<ov_core::CamBase> camera = state->_cam_intrinsics_cameras.at(pair.first);
     std::shared_ptr<PoseJPL> calibration = state->_calib_IMUtoCAM.at(pair.first);
     Eigen::Matrix3d R_ItoC = calibration->Rot();
     Eigen::Vector3d p_IinC = calibration->pos();
@@ -326,9 +262,36 @@ void UpdaterHelper::get_feature_jacobian_full(std::shared_ptr<State> state, Upda
       //=========================================================================
 
       // Get current IMU clone state
-      std::shared_ptr<PoseJPL> clone_Ii = state->_clones_IMU.at(feature.timestamps[pair.first].at(m));
-      Eigen::Matrix3d R_GtoIi = clone_Ii->Rot();
-      Eigen::Vector3d p_IiinG = clone_Ii->pos();
+      // The pose terms (and the composed R_GtoCi = R_ItoC * R_GtoIi) come from the
+      // per-pass clone term cache shared by all features and both updaters, so the
+      // same rotation composition is done once per clone per update instead of once
+      // per measurement (the clone pointer is still needed for its covariance id)
+      // A measurement between clone times instead gets the pose interpolated from
+      // its bracketing clones, and its Jacobian is split onto them further below
+      std::shared_ptr<PoseJPL> clone_Ii = state->get_clone(feature.timestamps[pair.first].at(m));
+      InterpolatedClone interp;
+      Eigen::Matrix3d R_GtoIi, R_GtoIi_fej, R_GtoCi, R_GtoCi_fej;
+      Eigen::Vector3d p_IiinG, p_IiinG_fej;
+      if (clone_Ii != nullptr) {
+        const UpdaterJacobianEngine::CloneTerms &terms =
+            UpdaterJacobianEngine::clone_terms(state, (int)pair.first, feature.timestamps[pair.first].at(m));
+        R_GtoIi = terms.R_GtoI;
+        p_IiinG = terms.p_IinG;
+        R_GtoCi = terms.R_GtoC;
+        R_GtoIi_fej = terms.R_GtoI_fej;
+        p_IiinG_fej = terms.p_IinG_fej;
+        R_GtoCi_fej = terms.R_GtoC_fej;
+      } else {
+        bool bracketed = interpolate_clone_pose(state, feature.timestamps[pair.first].at(m), interp);
+        assert(bracketed);
+        (void)bracketed;
+        R_GtoIi = interp.R_GtoI;
+        p_IiinG = interp.p_IinG;
+        R_GtoCi = R_ItoC * R_GtoIi;
+        R_GtoIi_fej = interp.R_GtoI_fej;
+        p_IiinG_fej = interp.p_IinG_fej;
+        R_GtoCi_fej = R_ItoC * R_GtoIi_fej;
+      }
 
       // Get current feature in the IMU
       Eigen::Vector3d p_FinIi = R_GtoIi * (p_FinG - p_IiinG);
@@ -339,8 +302,17 @@ void UpdaterHelper::get_feature_jacobian_full(std::shared_ptr<State> state, Upda
       uv_norm << p_FinCi(0) / p_FinCi(2), p_FinCi(1) / p_FinCi(2);
 
       // Distort the normalized coordinates (radtan or fisheye)
+      // In calibration runs the fused dual-number kernel produces the distorted point
+      // and both Jacobians from a single traversal of the distortion model, otherwise
+      // the reduced hand-derived kernel skips the dz_dzeta chain entirely since the
+      // frozen intrinsics never enter H_x (~20% of jacobian time)
       Eigen::Vector2d uv_dist;
-      uv_dist = state->_cam_intrinsics_cameras.at(pair.first)->distort_d(uv_norm);
+      if (state->_options.do_calib_camera_intrinsics) {
+        camera->compute_distort_value_jacobian(uv_norm, uv_dist, dz_dzn, dz_dzeta);
+      } else {
+        uv_dist = camera->distort_d(uv_norm);
+        camera->compute_distort_jacobian_norm(uv_norm, dz_dzn);
+      }
 
       // Our residual
       Eigen::Vector2d uv_m;
@@ -352,8 +324,9 @@ void UpdaterHelper::get_feature_jacobian_full(std::shared_ptr<State> state, Upda
 
       // If we are doing first estimate Jacobians, then overwrite with the first estimates
       if (state->_options.do_fej) {
-        R_GtoIi = clone_Ii->Rot_fej();
-        p_IiinG = clone_Ii->pos_fej();
+        R_GtoIi = R_GtoIi_fej;
+        p_IiinG = p_IiinG_fej;
+        R_GtoCi = R_GtoCi_fej;
         // R_ItoC = calibration->Rot_fej();
         // p_IinC = calibration->pos_fej();
         p_FinIi = R_GtoIi * (p_FinG_fej - p_IiinG);
@@ -362,19 +335,17 @@ void UpdaterHelper::get_feature_jacobian_full(std::shared_ptr<State> state, Upda
         // cam_d = state->get_intrinsics_CAM(pair.first)->fej();
       }
 
-      // Compute Jacobians in respect to normalized image coordinates and possibly the camera intrinsics
-      Eigen::MatrixXd dz_dzn, dz_dzeta;
-      state->_cam_intrinsics_cameras.at(pair.first)->compute_distort_jacobian(uv_norm, dz_dzn, dz_dzeta);
-
       // Normalized coordinates in respect to projection function
-      Eigen::MatrixXd dzn_dpfc = Eigen::MatrixXd::Zero(2, 3);
+      // NOTE: these small chainrule matrices are all fixed-size stack storage so the
+      // NOTE: per-measurement assembly loop never touches the heap allocator
+      Eigen::Matrix<double, 2, 3> dzn_dpfc = Eigen::Matrix<double, 2, 3>::Zero();
       dzn_dpfc << 1 / p_FinCi(2), 0, -p_FinCi(0) / (p_FinCi(2) * p_FinCi(2)), 0, 1 / p_FinCi(2), -p_FinCi(1) / (p_FinCi(2) * p_FinCi(2));
 
-      // Derivative of p_FinCi in respect to p_FinIi
-      Eigen::MatrixXd dpfc_dpfg = R_ItoC * R_GtoIi;
+      // Derivative of p_FinCi in respect to p_FinIi (the cached composed rotation)
+      const Eigen::Matrix3d &dpfc_dpfg = R_GtoCi;
 
       // Derivative of p_FinCi in respect to camera clone state
-      Eigen::MatrixXd dpfc_dclone = Eigen::MatrixXd::Zero(3, 6);
+      Eigen::Matrix<double, 3, 6> dpfc_dclone = Eigen::Matrix<double, 3, 6>::Zero();
       dpfc_dclone.block(0, 0, 3, 3).noalias() = R_ItoC * skew_x(p_FinIi);
       dpfc_dclone.block(0, 3, 3, 3) = -dpfc_dpfg;
 
@@ -382,19 +353,27 @@ void UpdaterHelper::get_feature_jacobian_full(std::shared_ptr<State> state, Upda
       //=========================================================================
 
       // Precompute some matrices
-      Eigen::MatrixXd dz_dpfc = dz_dzn * dzn_dpfc;
-      Eigen::MatrixXd dz_dpfg = dz_dpfc * dpfc_dpfg;
+      Eigen::Matrix<double, 2, 3> dz_dpfc = dz_dzn * dzn_dpfc;
+      Eigen::Matrix<double, 2, 3> dz_dpfg = dz_dpfc * dpfc_dpfg;
 
       // CHAINRULE: get the total feature Jacobian
       H_f.block(2 * c, 0, 2, H_f.cols()).noalias() = dz_dpfg * dpfg_dlambda;
 
       // CHAINRULE: get state clone Jacobian
-      H_x.block(2 * c, map_hx[clone_Ii], 2, clone_Ii->size()).noalias() = dz_dpfc * dpfc_dclone;
+      // An interpolated measurement splits it onto the bracketing clones, since to
+      // first order the interpolated pose error is their lambda-weighted blend
+      if (clone_Ii != nullptr) {
+        H_x.block(2 * c, map_hx_find(clone_Ii->id()), 2, clone_Ii->size()).noalias() = dz_dpfc * dpfc_dclone;
+      } else {
+        Eigen::Matrix<double, 2, 6> dz_dclone = dz_dpfc * dpfc_dclone;
+        H_x.block(2 * c, map_hx_find(interp.clone0->id()), 2, interp.clone0->size()).noalias() = (1.0 - interp.lambda) * dz_dclone;
+        H_x.block(2 * c, map_hx_find(interp.clone1->id()), 2, interp.clone1->size()).noalias() = interp.lambda * dz_dclone;
+      }
 
       // CHAINRULE: loop through all extra states and add their
       // NOTE: we add the Jacobian here as we might be in the anchoring pose for this measurement
       for (size_t i = 0; i < dpfg_dx_order.size(); i++) {
-        H_x.block(2 * c, map_hx[dpfg_dx_order.at(i)], 2, dpfg_dx_order.at(i)->size()).noalias() += dz_dpfg * dpfg_dx.at(i);
+        H_x.block(2 * c, map_hx_find(dpfg_dx_order.at(i)->id()), 2, dpfg_dx_order.at(i)->size()).noalias() += dz_dpfg * dpfg_dx.at(i);
       }
 
       //=========================================================================
@@ -404,17 +383,17 @@ void UpdaterHelper::get_feature_jacobian_full(std::shared_ptr<State> state, Upda
       if (state->_options.do_calib_camera_pose) {
 
         // Calculate the Jacobian
-        Eigen::MatrixXd dpfc_dcalib = Eigen::MatrixXd::Zero(3, 6);
+        Eigen::Matrix<double, 3, 6> dpfc_dcalib = Eigen::Matrix<double, 3, 6>::Zero();
         dpfc_dcalib.block(0, 0, 3, 3) = skew_x(p_FinCi - p_IinC);
         dpfc_dcalib.block(0, 3, 3, 3) = Eigen::Matrix<double, 3, 3>::Identity();
 
         // Chainrule it and add it to the big jacobian
-        H_x.block(2 * c, map_hx[calibration], 2, calibration->size()).noalias() += dz_dpfc * dpfc_dcalib;
+        H_x.block(2 * c, map_hx_find(calibration->id()), 2, calibration->size()).noalias() += dz_dpfc * dpfc_dcalib;
       }
 
       // Derivative of measurement in respect to distortion parameters
       if (state->_options.do_calib_camera_intrinsics) {
-        H_x.block(2 * c, map_hx[distortion], 2, distortion->size()) = dz_dzeta;
+        H_x.block(2 * c, map_hx_find(distortion->id()), 2, distortion->size()) = dz_dzeta;
       }
 
       // Move the Jacobian and residual index forward
@@ -426,28 +405,39 @@ void UpdaterHelper::get_feature_jacobian_full(std::shared_ptr<State> state, Upda
 void UpdaterHelper::nullspace_project_inplace(Eigen::MatrixXd &H_f, Eigen::MatrixXd &H_x, Eigen::VectorXd &res) {
 
   // Apply the left nullspace of H_f to all variables
-  // Based on "Matrix Computations 4th Edition by Golub and Van Loan"
-  // See page 252, Algorithm 5.2.4 for how these two loops work
-  // They use "matlab" index notation, thus we need to subtract 1 from all index
-  Eigen::JacobiRotation<double> tempHo_GR;
-  for (int n = 0; n < H_f.cols(); ++n) {
-    for (int m = (int)H_f.rows() - 1; m > n; m--) {
-      // Givens matrix G
-      tempHo_GR.makeGivens(H_f(m - 1, n), H_f(m, n));
-      // Multiply G to the corresponding lines (m-1,m) in each matrix
-      // Note: we only apply G to the nonzero cols [n:Ho.cols()-n-1], while
-      //       it is equivalent to applying G to the entire cols [0:Ho.cols()-1].
-      (H_f.block(m - 1, n, 2, H_f.cols() - n)).applyOnTheLeft(0, 1, tempHo_GR.adjoint());
-      (H_x.block(m - 1, 0, 2, H_x.cols())).applyOnTheLeft(0, 1, tempHo_GR.adjoint());
-      (res.block(m - 1, 0, 2, 1)).applyOnTheLeft(0, 1, tempHo_GR.adjoint());
+  // H_f has very few columns (three for a 3d position, two for a marginalized
+  // bearing), so we triangularize it with one Householder reflection per column
+  // and apply each reflection to the stacked [H_x | res] workspace as a single
+  // rank-one update, instead of rotating two rows at a time with Givens over
+  // every element like we used to. The update is invariant to which orthogonal
+  // transform we use, so the result is equivalent, and stacking means the whole
+  // system is swept in one pass over contiguous memory. The workspace is thread
+  // local and only reallocates when the system grows.
+  assert(H_f.rows() == H_x.rows() && H_f.rows() == res.rows());
+  int rows = (int)H_f.rows();
+  int cols = (int)H_x.cols();
+  int rank = (int)H_f.cols();
+  static thread_local Eigen::MatrixXd A;
+  static thread_local Eigen::VectorXd hwork;
+  A.resize(rows, cols + 1);
+  A.leftCols(cols) = H_x;
+  A.col(cols) = res;
+  hwork.resize(cols + 1);
+  for (int k = 0; k < rank; k++) {
+    // Reflection that zeros column k of H_f below its diagonal (essential part
+    // is stored in the column itself, exactly like Eigen's own HouseholderQR)
+    double tau, beta;
+    H_f.col(k).tail(rows - k).makeHouseholderInPlace(tau, beta);
+    H_f(k, k) = beta;
+    if (k + 1 < rank) {
+      H_f.bottomRightCorner(rows - k, rank - k - 1).applyHouseholderOnTheLeft(H_f.col(k).tail(rows - k - 1), tau, hwork.data());
     }
+    A.bottomRows(rows - k).applyHouseholderOnTheLeft(H_f.col(k).tail(rows - k - 1), tau, hwork.data());
   }
 
   // The H_f jacobian max rank is 3 if it is a 3d position, thus size of the left nullspace is Hf.rows()-3
-  // NOTE: need to eigen3 eval here since this experiences aliasing!
-  // H_f = H_f.block(H_f.cols(),0,H_f.rows()-H_f.cols(),H_f.cols()).eval();
-  H_x = H_x.block(H_f.cols(), 0, H_x.rows() - H_f.cols(), H_x.cols()).eval();
-  res = res.block(H_f.cols(), 0, res.rows() - H_f.cols(), res.cols()).eval();
+  H_x = A.block(rank, 0, rows - rank, cols);
+  res = A.block(rank, cols, rows - rank, 1);
 
   // Sanity check
   assert(H_x.rows() == res.rows());
@@ -459,29 +449,141 @@ void UpdaterHelper::measurement_compress_inplace(Eigen::MatrixXd &H_x, Eigen::Ve
   if (H_x.rows() <= H_x.cols())
     return;
 
-  // Do measurement compression through givens rotations
-  // Based on "Matrix Computations 4th Edition by Golub and Van Loan"
-  // See page 252, Algorithm 5.2.4 for how these two loops work
-  // They use "matlab" index notation, thus we need to subtract 1 from all index
-  Eigen::JacobiRotation<double> tempHo_GR;
-  for (int n = 0; n < H_x.cols(); n++) {
-    for (int m = (int)H_x.rows() - 1; m > n; m--) {
-      // Givens matrix G
-      tempHo_GR.makeGivens(H_x(m - 1, n), H_x(m, n));
-      // Multiply G to the corresponding lines (m-1,m) in each matrix
-      // Note: we only apply G to the nonzero cols [n:Ho.cols()-n-1], while
-      //       it is equivalent to applying G to the entire cols [0:Ho.cols()-1].
-      (H_x.block(m - 1, n, 2, H_x.cols() - n)).applyOnTheLeft(0, 1, tempHo_GR.adjoint());
-      (res.block(m - 1, 0, 2, 1)).applyOnTheLeft(0, 1, tempHo_GR.adjoint());
+  // Do measurement compression through an in-place Householder QR
+  // We stack [H_x | res] into a single workspace so one factorization triangularizes
+  // the Jacobian and applies Q^T to the residual at the same time. Householder works
+  // on whole columns (and Eigen blocks it into matrix-matrix products) which is much
+  // faster than rotating two rows at a time with Givens like we used to. The update
+  // is invariant to which orthogonal transform we use, so the result is equivalent.
+  // The workspace is thread local and only reallocates when the system grows.
+  static thread_local Eigen::MatrixXd A;
+  int rows = (int)H_x.rows();
+  int cols = (int)H_x.cols();
+  A.resize(rows, cols + 1);
+  A.leftCols(cols) = H_x;
+  A.col(cols) = res;
+
+  // In-place factorization on the workspace (no copy of the stacked system)
+  Eigen::HouseholderQR<Eigen::Ref<Eigen::MatrixXd>> qr(A);
+
+  // The compressed system is the upper-triangular R block and the rotated residual
+  // Rows beyond the column count carry only the discarded orthogonal residual energy
+  int r = std::min(rows, cols);
+  H_x.resize(r, cols);
+  H_x.setZero();
+  H_x.triangularView<Eigen::Upper>() = A.topLeftCorner(r, cols);
+  res = A.block(0, cols, r, 1);
+}
+
+void UpdaterHelper::measurement_compress_inplace(Eigen::MatrixXd &H_x, Eigen::VectorXd &res,
+                                                 const std::vector<std::pair<int, int>> &row_spans) {
+
+  // Return if H_x is a fat matrix (there is no need to compress in this case)
+  if (H_x.rows() <= H_x.cols())
+    return;
+  assert((int)row_spans.size() == (int)H_x.rows());
+
+  // Row-wise Givens QR over a staircase factor that only ever touches the declared
+  // nonzero extent of each row. The rows are kept transposed in the workspace (a
+  // system row is a contiguous workspace column) so every rotation runs over
+  // contiguous memory, and the residual rides along as the extra last entry.
+  // The workspace is thread local and only reallocates when the system grows.
+  static thread_local Eigen::MatrixXd A;
+  int rows = (int)H_x.rows();
+  int cols = (int)H_x.cols();
+  A.resize(cols + 1, rows);
+  std::vector<std::pair<int, int>> spans(rows);
+  for (int i = 0; i < rows; i++) {
+    int lo = std::max(0, row_spans.at(i).first);
+    int hi = std::min(cols, row_spans.at(i).second);
+    spans.at(i) = {lo, hi};
+    A.col(i).setZero();
+    A.col(i).segment(lo, hi - lo) = H_x.row(i).segment(lo, hi - lo).transpose();
+    A(cols, i) = res(i);
+  }
+
+  // Merge every row into the factor: the first row with a given leading column becomes
+  // the factor row for that column, later rows have the entry rotated away and continue
+  // with their leading column advanced (the extent grows to the union of the two rows)
+  std::vector<int> row_of_col(cols, -1);
+  for (int i = 0; i < rows; i++) {
+    int c = spans.at(i).first;
+    int hi = spans.at(i).second;
+    while (c < hi) {
+      if (std::abs(A(c, i)) < 1e-12) {
+        c++;
+        continue;
+      }
+      int j = row_of_col.at(c);
+      if (j < 0) {
+        row_of_col.at(c) = i;
+        spans.at(i) = {c, hi};
+        break;
+      }
+      int hi_new = std::max(hi, spans.at(j).second);
+      int w = hi_new - c;
+      Eigen::JacobiRotation<double> g;
+      g.makeGivens(A(c, j), A(c, i));
+      double gc = g.c();
+      double gs = g.s();
+      Eigen::VectorXd tmp = gc * A.col(j).segment(c, w) - gs * A.col(i).segment(c, w);
+      A.col(i).segment(c, w) = gs * A.col(j).segment(c, w) + gc * A.col(i).segment(c, w);
+      A.col(j).segment(c, w) = tmp;
+      double rj = A(cols, j);
+      double ri = A(cols, i);
+      A(cols, j) = gc * rj - gs * ri;
+      A(cols, i) = gs * rj + gc * ri;
+      A(c, i) = 0.0;
+      spans.at(j).second = hi_new;
+      hi = hi_new;
+      c++;
     }
   }
 
-  // If H is a fat matrix, then use the rows
-  // Else it should be same size as our state
-  int r = std::min(H_x.rows(), H_x.cols());
+  // Gather the factor rows in column order into the compressed system
+  // Columns without a factor row simply contribute no measurement row
+  int r = 0;
+  for (int c = 0; c < cols; c++) {
+    r += (row_of_col.at(c) >= 0) ? 1 : 0;
+  }
+  H_x.resize(r, cols);
+  H_x.setZero();
+  res.resize(r);
+  int out = 0;
+  for (int c = 0; c < cols; c++) {
+    int i = row_of_col.at(c);
+    if (i < 0)
+      continue;
+    int hi = spans.at(i).second;
+    H_x.row(out).segment(c, hi - c) = A.col(i).segment(c, hi - c).transpose();
+    res(out) = A(cols, i);
+    out++;
+  }
+}
+
+Eigen::ArrayXd UpdaterHelper::robust_weight_inplace(Eigen::MatrixXd &H_x, Eigen::VectorXd &res, double sigma_pix, const std::string &norm,
+                                                    double c) {
+
+  // Whitened magnitude of every residual row (~1 for a one-sigma residual)
+  assert(H_x.rows() == res.rows());
+  Eigen::ArrayXd x = res.array().abs() / sigma_pix;
+
+  // Weight of each row under the requested norm
+  // Huber is the identity inside the c-sigma band and 1/|x| outside it, while
+  // Cauchy never fully trusts any row and decays quadratically in the tails
+  Eigen::ArrayXd w;
+  if (norm == "huber") {
+    w = (x <= c).select(Eigen::ArrayXd::Ones(x.rows()), c / x.max(1e-12));
+  } else if (norm == "cauchy") {
+    w = (1.0 + (x / c).square()).inverse();
+  } else {
+    PRINT_ERROR(RED "[UP]: unknown robust norm %s (supported: huber, cauchy)\n" RESET, norm.c_str());
+    std::exit(EXIT_FAILURE);
+  }
 
-  // Construct the smaller jacobian and residual after measurement compression
-  assert(r <= H_x.rows());
-  H_x.conservativeResize(r, H_x.cols());
-  res.conservativeResize(r, res.cols());
+  // Scale the rows by sqrt(w) so the weight lands in the information of each row
+  Eigen::ArrayXd sw = w.sqrt();
+  res.array() *= sw;
+  H_x.array().colwise() *= sw;
+  return w;
 }
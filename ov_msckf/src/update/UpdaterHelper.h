@@ -24,11 +24,19 @@
 
 #include <Eigen/Eigen>
 #include <memory>
+#include <string>
 #include <unordered_map>
+#include <vector>
 
+#include "feat/FeatureInitializer.h"
 #include "types/LandmarkRepresentation.h"
 
+namespace ov_core {
+class Feature;
+} // namespace ov_core
+
 namespace ov_type {
+class PoseJPL;
 class Type;
 } // namespace ov_type
 
@@ -57,10 +65,10 @@ public:
     size_t featid;
 
     /// UV coordinates that this feature has been seen from (mapped by camera ID)
-    std::unordered_map<size_t, std::vector<Eigen::VectorXf>> uvs;
+    std::unordered_map<size_t, std::vector<Eigen::Vector2f>> uvs;
 
     // UV normalized coordinates that this feature has been seen from (mapped by camera ID)
-    std::unordered_map<size_t, std::vector<Eigen::VectorXf>> uvs_norm;
+    std::unordered_map<size_t, std::vector<Eigen::Vector2f>> uvs_norm;
 
     /// Timestamps of each UV measurement (mapped by camera ID)
     std::unordered_map<size_t, std::vector<double>> timestamps;
@@ -112,12 +120,68 @@ public:
   static void get_feature_jacobian_full(std::shared_ptr<State> state, UpdaterHelperFeature &feature, Eigen::MatrixXd &H_f,
                                         Eigen::MatrixXd &H_x, Eigen::VectorXd &res, std::vector<std::shared_ptr<ov_type::Type>> &x_order);
 
+  /**
+   * @brief Pose of a measurement time expressed against its two bracketing clones
+   *
+   * The interpolated orientation follows the geodesic between the bounding clone
+   * orientations and the position is blended linearly, both parameterized by the
+   * time fraction lambda. To first order the error of the interpolated pose is the
+   * lambda-weighted blend of the bounding clone errors, so a measurement Jacobian
+   * computed at the interpolated pose is split (1-lambda) / lambda onto the clones.
+   */
+  struct InterpolatedClone {
+
+    /// Bounding clones (clone0 is the older one)
+    std::shared_ptr<ov_type::PoseJPL> clone0, clone1;
+
+    /// Time fraction between the clones in [0, 1] (zero means at clone0)
+    double lambda = 0.0;
+
+    /// Interpolated orientation and position (and their first estimates)
+    Eigen::Matrix3d R_GtoI, R_GtoI_fej;
+    Eigen::Vector3d p_IinG, p_IinG_fej;
+  };
+
+  /**
+   * @brief Computes the interpolated IMU pose of a timestamp between two clones
+   *
+   * This is how measurements at timestamps without their own clone become usable:
+   * with update_decimation the tracker runs at the camera rate while only every
+   * n'th frame is cloned, and these in-between measurements are then expressed
+   * against the bracketing clones (enabled with use_interpolated_clones).
+   *
+   * @param[in] state State of the filter system
+   * @param[in] timestamp Camera clock time we want the pose of (must lie between two clones)
+   * @param[out] interp Interpolated pose and the bounding clones
+   * @return False if the timestamp is not bracketed by two clones
+   */
+  static bool interpolate_clone_pose(std::shared_ptr<State> state, double timestamp, InterpolatedClone &interp);
+
+  /**
+   * @brief Appends interpolated camera poses for measurement times between the clones
+   *
+   * The triangulation clone map normally only has the poses at the clone times, so
+   * this walks the measurements of the given features and inserts an interpolated
+   * camera pose for every timestamp that does not have one (measurement times
+   * outside the clone window are skipped, the cleaning has already dropped them).
+   *
+   * @param[in] state State of the filter system
+   * @param[in] features Features whose measurement times need poses
+   * @param[in,out] clones_cam Camera poses keyed by camera id and timestamp
+   */
+  static void add_interpolated_clone_poses(
+      std::shared_ptr<State> state, const std::vector<std::shared_ptr<ov_core::Feature>> &features,
+      std::unordered_map<size_t, std::unordered_map<double, ov_core::FeatureInitializer::ClonePose>> &clones_cam);
+
   /**
    * @brief This will project the left nullspace of H_f onto the linear system.
    *
    * Please see the @ref update-null for details on how this works.
    * This is the MSCKF nullspace projection which removes the dependency on the feature state.
    * Note that this is done **in place** so all matrices will be different after a function call.
+   * The projection is performed with Householder reflections over a stacked [H_x | res]
+   * thread-local workspace, so the output differs from a Givens sweep by an orthogonal
+   * transform (which the update and the chi2 gate are both invariant to).
    *
    * @param H_f Jacobian with nullspace we want to project onto the system [res = Hx*(x-xhat)+Hf(f-fhat)+n]
    * @param H_x State jacobian
@@ -135,6 +199,44 @@ public:
    * @param res Measurement residual
    */
   static void measurement_compress_inplace(Eigen::MatrixXd &H_x, Eigen::VectorXd &res);
+
+  /**
+   * @brief Measurement compression that exploits the banded stacked structure
+   *
+   * Same contract as measurement_compress_inplace(), but the caller additionally provides
+   * the nonzero column extent of every stacked row (each feature's rows only touch the
+   * columns of the variables it observes). The compression is then a row-wise Givens QR
+   * that only operates on the union of the two extents it merges, so the structural zeros
+   * outside the bands are never multiplied. The update is invariant to which orthogonal
+   * transform is applied, so the result is equivalent to the dense Householder path.
+   *
+   * @param H_x State jacobian (rows are zero outside their declared extent)
+   * @param res Measurement residual
+   * @param row_spans Per-row [first, past-last) extent of the nonzero columns
+   */
+  static void measurement_compress_inplace(Eigen::MatrixXd &H_x, Eigen::VectorXd &res,
+                                           const std::vector<std::pair<int, int>> &row_spans);
+
+  /**
+   * @brief Vectorized robust reweighting of stacked residual rows
+   *
+   * Computes a Huber or Cauchy weight for every residual row from its whitened
+   * magnitude |r|/sigma and scales the row of both the Jacobian and the residual by
+   * sqrt(weight), which is the standard IRLS trick of folding the weight into the
+   * (still isotropic) measurement noise. Rows of well-behaved measurements keep a
+   * weight of one, so with clean data this pass is the identity; borderline rows are
+   * smoothly down-weighted instead of a gate discarding their whole feature. Must be
+   * applied before any measurement compression, since compression mixes the rows.
+   *
+   * @param H_x State jacobian (rows are scaled in place)
+   * @param res Measurement residual (scaled in place)
+   * @param sigma_pix Isotropic measurement sigma the rows are whitened with
+   * @param norm Which norm to weight with ("huber" or "cauchy")
+   * @param c Tuning constant of the norm in whitened-residual units
+   * @return The per-row weights that were applied (for instrumentation)
+   */
+  static Eigen::ArrayXd robust_weight_inplace(Eigen::MatrixXd &H_x, Eigen::VectorXd &res, double sigma_pix, const std::string &norm,
+                                              double c);
 };
 
 } // namespace ov_msckf
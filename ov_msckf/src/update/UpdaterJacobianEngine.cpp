@@ -0,0 +1,301 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2018-2023 Patrick Geneva
+ * Copyright (C) 2018-2023 Guoquan Huang
+ * Copyright (C) 2018-2023 OpenVINS Contributors
+ * Copyright (C) 2018-2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "UpdaterJacobianEngine.h"
+
+#include "state/State.h"
+
+#include "utils/quat_ops.h"
+
+using namespace ov_core;
+using namespace ov_type;
+using namespace ov_msckf;
+
+// Static storage for the engine table and the clone term cache
+std::map<LandmarkRepresentation::Representation, std::shared_ptr<UpdaterJacobianEngine>> UpdaterJacobianEngine::engines;
+std::map<std::pair<int, double>, UpdaterJacobianEngine::CloneTerms> UpdaterJacobianEngine::cache_clones;
+std::mutex UpdaterJacobianEngine::cache_mtx;
+
+namespace ov_msckf {
+
+// Global XYZ representation
+template <>
+void UpdaterJacobianEngineT<LandmarkRepresentation::Representation::GLOBAL_3D>::jacobian_representation(
+    std::shared_ptr<State> state, UpdaterHelper::UpdaterHelperFeature &feature, Eigen::MatrixXd &H_f,
+    std::vector<Eigen::MatrixXd> &H_x, std::vector<std::shared_ptr<Type>> &x_order) const {
+  H_f.resize(3, 3);
+  H_f.setIdentity();
+}
+
+// Global inverse depth representation
+template <>
+void UpdaterJacobianEngineT<LandmarkRepresentation::Representation::GLOBAL_FULL_INVERSE_DEPTH>::jacobian_representation(
+    std::shared_ptr<State> state, UpdaterHelper::UpdaterHelperFeature &feature, Eigen::MatrixXd &H_f,
+    std::vector<Eigen::MatrixXd> &H_x, std::vector<std::shared_ptr<Type>> &x_order) const {
+
+  // Get the feature linearization point
+  Eigen::Matrix<double, 3, 1> p_FinG = (state->_options.do_fej) ? feature.p_FinG_fej : feature.p_FinG;
+
+  // Get inverse depth representation (should match what is in Landmark.cpp)
+  double g_rho = 1 / p_FinG.norm();
+  double g_phi = std::acos(g_rho * p_FinG(2));
+  // double g_theta = std::asin(g_rho*p_FinG(1)/std::sin(g_phi));
+  double g_theta = std::atan2(p_FinG(1), p_FinG(0));
+  Eigen::Matrix<double, 3, 1> p_invFinG;
+  p_invFinG(0) = g_theta;
+  p_invFinG(1) = g_phi;
+  p_invFinG(2) = g_rho;
+
+  // Get inverse depth bearings
+  double sin_th = std::sin(p_invFinG(0, 0));
+  double cos_th = std::cos(p_invFinG(0, 0));
+  double sin_phi = std::sin(p_invFinG(1, 0));
+  double cos_phi = std::cos(p_invFinG(1, 0));
+  double rho = p_invFinG(2, 0);
+
+  // Construct the Jacobian
+  H_f.resize(3, 3);
+  H_f << -(1.0 / rho) * sin_th * sin_phi, (1.0 / rho) * cos_th * cos_phi, -(1.0 / (rho * rho)) * cos_th * sin_phi,
+      (1.0 / rho) * cos_th * sin_phi, (1.0 / rho) * sin_th * cos_phi, -(1.0 / (rho * rho)) * sin_th * sin_phi, 0.0,
+      -(1.0 / rho) * sin_phi, -(1.0 / (rho * rho)) * cos_phi;
+}
+
+// Anchored XYZ representation
+template <>
+void UpdaterJacobianEngineT<LandmarkRepresentation::Representation::ANCHORED_3D>::jacobian_representation(
+    std::shared_ptr<State> state, UpdaterHelper::UpdaterHelperFeature &feature, Eigen::MatrixXd &H_f,
+    std::vector<Eigen::MatrixXd> &H_x, std::vector<std::shared_ptr<Type>> &x_order) const {
+  Eigen::Vector3d p_FinA;
+  H_f = anchored_prologue(state, feature, p_FinA, H_x, x_order);
+}
+
+// Anchored full inverse depth representation
+template <>
+void UpdaterJacobianEngineT<LandmarkRepresentation::Representation::ANCHORED_FULL_INVERSE_DEPTH>::jacobian_representation(
+    std::shared_ptr<State> state, UpdaterHelper::UpdaterHelperFeature &feature, Eigen::MatrixXd &H_f,
+    std::vector<Eigen::MatrixXd> &H_x, std::vector<std::shared_ptr<Type>> &x_order) const {
+
+  // Shared anchored prologue (FEJ adjustment and anchor pose Jacobians)
+  Eigen::Vector3d p_FinA;
+  Eigen::Matrix3d R_CtoG = anchored_prologue(state, feature, p_FinA, H_x, x_order);
+
+  // Get inverse depth representation (should match what is in Landmark.cpp)
+  double a_rho = 1 / p_FinA.norm();
+  double a_phi = std::acos(a_rho * p_FinA(2));
+  double a_theta = std::atan2(p_FinA(1), p_FinA(0));
+  Eigen::Matrix<double, 3, 1> p_invFinA;
+  p_invFinA(0) = a_theta;
+  p_invFinA(1) = a_phi;
+  p_invFinA(2) = a_rho;
+
+  // Using anchored inverse depth
+  double sin_th = std::sin(p_invFinA(0, 0));
+  double cos_th = std::cos(p_invFinA(0, 0));
+  double sin_phi = std::sin(p_invFinA(1, 0));
+  double cos_phi = std::cos(p_invFinA(1, 0));
+  double rho = p_invFinA(2, 0);
+  // assert(p_invFinA(2,0)>=0.0);
+
+  // Jacobian of anchored 3D position wrt inverse depth parameters
+  Eigen::Matrix<double, 3, 3> d_pfinA_dpinv;
+  d_pfinA_dpinv << -(1.0 / rho) * sin_th * sin_phi, (1.0 / rho) * cos_th * cos_phi, -(1.0 / (rho * rho)) * cos_th * sin_phi,
+      (1.0 / rho) * cos_th * sin_phi, (1.0 / rho) * sin_th * cos_phi, -(1.0 / (rho * rho)) * sin_th * sin_phi, 0.0,
+      -(1.0 / rho) * sin_phi, -(1.0 / (rho * rho)) * cos_phi;
+  H_f = R_CtoG * d_pfinA_dpinv;
+}
+
+// Anchored MSCKF version of inverse depth
+template <>
+void UpdaterJacobianEngineT<LandmarkRepresentation::Representation::ANCHORED_MSCKF_INVERSE_DEPTH>::jacobian_representation(
+    std::shared_ptr<State> state, UpdaterHelper::UpdaterHelperFeature &feature, Eigen::MatrixXd &H_f,
+    std::vector<Eigen::MatrixXd> &H_x, std::vector<std::shared_ptr<Type>> &x_order) const {
+
+  // Shared anchored prologue (FEJ adjustment and anchor pose Jacobians)
+  Eigen::Vector3d p_FinA;
+  Eigen::Matrix3d R_CtoG = anchored_prologue(state, feature, p_FinA, H_x, x_order);
+
+  // Get inverse depth representation (should match what is in Landmark.cpp)
+  Eigen::Matrix<double, 3, 1> p_invFinA_MSCKF;
+  p_invFinA_MSCKF(0) = p_FinA(0) / p_FinA(2);
+  p_invFinA_MSCKF(1) = p_FinA(1) / p_FinA(2);
+  p_invFinA_MSCKF(2) = 1 / p_FinA(2);
+
+  // Using the MSCKF version of inverse depth
+  double alpha = p_invFinA_MSCKF(0, 0);
+  double beta = p_invFinA_MSCKF(1, 0);
+  double rho = p_invFinA_MSCKF(2, 0);
+
+  // Jacobian of anchored 3D position wrt inverse depth parameters
+  Eigen::Matrix<double, 3, 3> d_pfinA_dpinv;
+  d_pfinA_dpinv << (1.0 / rho), 0.0, -(1.0 / (rho * rho)) * alpha, 0.0, (1.0 / rho), -(1.0 / (rho * rho)) * beta, 0.0, 0.0,
+      -(1.0 / (rho * rho));
+  H_f = R_CtoG * d_pfinA_dpinv;
+}
+
+// Estimate single depth of the feature using the initial bearing
+template <>
+void UpdaterJacobianEngineT<LandmarkRepresentation::Representation::ANCHORED_INVERSE_DEPTH_SINGLE>::jacobian_representation(
+    std::shared_ptr<State> state, UpdaterHelper::UpdaterHelperFeature &feature, Eigen::MatrixXd &H_f,
+    std::vector<Eigen::MatrixXd> &H_x, std::vector<std::shared_ptr<Type>> &x_order) const {
+
+  // Shared anchored prologue (FEJ adjustment and anchor pose Jacobians)
+  Eigen::Vector3d p_FinA;
+  Eigen::Matrix3d R_CtoG = anchored_prologue(state, feature, p_FinA, H_x, x_order);
+
+  // Get inverse depth representation (should match what is in Landmark.cpp)
+  double rho = 1.0 / p_FinA(2);
+  Eigen::Vector3d bearing = rho * p_FinA;
+
+  // Jacobian of anchored 3D position wrt inverse depth parameters
+  Eigen::Vector3d d_pfinA_drho;
+  d_pfinA_drho << -(1.0 / (rho * rho)) * bearing;
+  H_f = R_CtoG * d_pfinA_drho;
+}
+
+} // namespace ov_msckf
+
+void UpdaterJacobianEngine::initialize() {
+
+  // Only build the table once (VioManager construction)
+  std::lock_guard<std::mutex> lck(cache_mtx);
+  if (!engines.empty())
+    return;
+
+  // One engine per supported representation, dispatched at compile time
+  engines[LandmarkRepresentation::Representation::GLOBAL_3D] =
+      std::make_shared<UpdaterJacobianEngineT<LandmarkRepresentation::Representation::GLOBAL_3D>>();
+  engines[LandmarkRepresentation::Representation::GLOBAL_FULL_INVERSE_DEPTH] =
+      std::make_shared<UpdaterJacobianEngineT<LandmarkRepresentation::Representation::GLOBAL_FULL_INVERSE_DEPTH>>();
+  engines[LandmarkRepresentation::Representation::ANCHORED_3D] =
+      std::make_shared<UpdaterJacobianEngineT<LandmarkRepresentation::Representation::ANCHORED_3D>>();
+  engines[LandmarkRepresentation::Representation::ANCHORED_FULL_INVERSE_DEPTH] =
+      std::make_shared<UpdaterJacobianEngineT<LandmarkRepresentation::Representation::ANCHORED_FULL_INVERSE_DEPTH>>();
+  engines[LandmarkRepresentation::Representation::ANCHORED_MSCKF_INVERSE_DEPTH] =
+      std::make_shared<UpdaterJacobianEngineT<LandmarkRepresentation::Representation::ANCHORED_MSCKF_INVERSE_DEPTH>>();
+  engines[LandmarkRepresentation::Representation::ANCHORED_INVERSE_DEPTH_SINGLE] =
+      std::make_shared<UpdaterJacobianEngineT<LandmarkRepresentation::Representation::ANCHORED_INVERSE_DEPTH_SINGLE>>();
+}
+
+std::shared_ptr<UpdaterJacobianEngine> UpdaterJacobianEngine::get(LandmarkRepresentation::Representation feat_representation) {
+
+  // Lazy init so standalone updater usage (e.g. simulation) works without a VioManager
+  if (engines.empty())
+    initialize();
+
+  // Failure if an invalid representation that is not programmed is requested
+  assert(engines.find(feat_representation) != engines.end());
+  return engines.at(feat_representation);
+}
+
+void UpdaterJacobianEngine::begin_pass(std::shared_ptr<State> state) {
+
+  // Throw away terms from the last pass, the estimates have likely changed since then
+  std::lock_guard<std::mutex> lck(cache_mtx);
+  cache_clones.clear();
+
+  // Snapshot rotation/position terms (and the composed global-to-camera rotations) for
+  // every (camera, clone) pair so the per-feature loops (which may run on the thread
+  // pool) only ever read from the cache and never redo the same composition
+  for (const auto &calib : state->_calib_IMUtoCAM) {
+    CloneTerms terms;
+    terms.R_ItoC = calib.second->Rot();
+    terms.p_IinC = calib.second->pos();
+    for (const auto &clone_imu : state->_clones_IMU) {
+      terms.R_GtoI = clone_imu.second->Rot();
+      terms.p_IinG = clone_imu.second->pos();
+      terms.R_GtoC.noalias() = terms.R_ItoC * terms.R_GtoI;
+      terms.R_GtoI_fej = clone_imu.second->Rot_fej();
+      terms.p_IinG_fej = clone_imu.second->pos_fej();
+      terms.R_GtoC_fej.noalias() = terms.R_ItoC * terms.R_GtoI_fej;
+      cache_clones[{(int)calib.first, clone_imu.first}] = terms;
+    }
+  }
+}
+
+const UpdaterJacobianEngine::CloneTerms &UpdaterJacobianEngine::clone_terms(std::shared_ptr<State> state, int cam_id, double timestamp) {
+
+  // Fast path: served from the begin_pass() snapshot (no locking, read-only)
+  auto it = cache_clones.find({cam_id, timestamp});
+  if (it != cache_clones.end())
+    return it->second;
+
+  // Fallback: compute and insert under the lock (begin_pass() was not called)
+  // NOTE: std::map references are stable under insertion so handing them out is safe
+  std::lock_guard<std::mutex> lck(cache_mtx);
+  CloneTerms &terms = cache_clones[{cam_id, timestamp}];
+  terms.R_ItoC = state->_calib_IMUtoCAM.at(cam_id)->Rot();
+  terms.p_IinC = state->_calib_IMUtoCAM.at(cam_id)->pos();
+  std::shared_ptr<PoseJPL> clone = state->get_clone(timestamp);
+  assert(clone != nullptr);
+  terms.R_GtoI = clone->Rot();
+  terms.p_IinG = clone->pos();
+  terms.R_GtoC.noalias() = terms.R_ItoC * terms.R_GtoI;
+  terms.R_GtoI_fej = clone->Rot_fej();
+  terms.p_IinG_fej = clone->pos_fej();
+  terms.R_GtoC_fej.noalias() = terms.R_ItoC * terms.R_GtoI_fej;
+  return terms;
+}
+
+Eigen::Matrix3d UpdaterJacobianEngine::anchored_prologue(std::shared_ptr<State> state, UpdaterHelper::UpdaterHelperFeature &feature,
+                                                         Eigen::Vector3d &p_FinA, std::vector<Eigen::MatrixXd> &H_x,
+                                                         std::vector<std::shared_ptr<Type>> &x_order) {
+
+  // Assert that we have an anchor pose for this feature
+  assert(feature.anchor_cam_id != -1);
+
+  // Anchor pose orientation and position, and camera calibration for our anchor camera
+  const CloneTerms &terms = clone_terms(state, feature.anchor_cam_id, feature.anchor_clone_timestamp);
+  Eigen::Matrix3d R_GtoI = terms.R_GtoI;
+  Eigen::Vector3d p_IinG = terms.p_IinG;
+  p_FinA = feature.p_FinA;
+
+  // If I am doing FEJ, I should FEJ the anchor states (should we fej calibration???)
+  // Also get the FEJ position of the feature if we are
+  if (state->_options.do_fej) {
+    // "Best" feature in the global frame
+    Eigen::Vector3d p_FinG_best = R_GtoI.transpose() * terms.R_ItoC.transpose() * (feature.p_FinA - terms.p_IinC) + p_IinG;
+    // Transform the best into our anchor frame using FEJ
+    R_GtoI = terms.R_GtoI_fej;
+    p_IinG = terms.p_IinG_fej;
+    p_FinA = (R_GtoI.transpose() * terms.R_ItoC.transpose()).transpose() * (p_FinG_best - p_IinG) + terms.p_IinC;
+  }
+  Eigen::Matrix3d R_CtoG = R_GtoI.transpose() * terms.R_ItoC.transpose();
+
+  // Jacobian for our anchor pose
+  Eigen::Matrix<double, 3, 6> H_anc;
+  H_anc.block(0, 0, 3, 3).noalias() = -R_GtoI.transpose() * skew_x(terms.R_ItoC.transpose() * (p_FinA - terms.p_IinC));
+  H_anc.block(0, 3, 3, 3).setIdentity();
+
+  // Add anchor Jacobians to our return vector
+  x_order.push_back(state->get_clone(feature.anchor_clone_timestamp));
+  H_x.push_back(H_anc);
+
+  // Get calibration Jacobians (for anchor clone)
+  if (state->_options.do_calib_camera_pose) {
+    Eigen::Matrix<double, 3, 6> H_calib;
+    H_calib.block(0, 0, 3, 3).noalias() = -R_CtoG * skew_x(p_FinA - terms.p_IinC);
+    H_calib.block(0, 3, 3, 3) = -R_CtoG;
+    x_order.push_back(state->_calib_IMUtoCAM.at(feature.anchor_cam_id));
+    H_x.push_back(H_calib);
+  }
+  return R_CtoG;
+}
+
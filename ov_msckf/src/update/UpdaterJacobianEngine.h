@@ -0,0 +1,166 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2018-2023 Patrick Geneva
+ * Copyright (C) 2018-2023 Guoquan Huang
+ * Copyright (C) 2018-2023 OpenVINS Contributors
+ * Copyright (C) 2018-2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OV_MSCKF_UPDATER_JACOBIAN_ENGINE_H
+#define OV_MSCKF_UPDATER_JACOBIAN_ENGINE_H
+
+#include <Eigen/Eigen>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "UpdaterHelper.h"
+#include "types/LandmarkRepresentation.h"
+
+namespace ov_msckf {
+
+class State;
+
+/**
+ * @brief Representation-dispatched engine for the feature representation Jacobian.
+ *
+ * Historically @ref UpdaterHelper::get_feature_jacobian_representation branched on the
+ * landmark representation enum at runtime for *every* feature, and the anchored paths
+ * re-looked-up and re-converted the anchor clone orientation for every feature even
+ * though many features share the same anchor clone. This class moves the representation
+ * branch to construction time: one engine subclass is instantiated per representation
+ * (see @ref UpdaterJacobianEngineT) when the @ref VioManager is built, so the per-feature
+ * call is a single virtual dispatch into straight-line code for that representation.
+ *
+ * The engines additionally share a cache of per-(camera, clone) rotation and position
+ * terms, including the composed global-to-camera rotation R_ItoC * R_GtoI which every
+ * measurement Jacobian needs. An updater calls @ref begin_pass once before it starts
+ * building Jacobians, which snapshots these terms for all clone/camera pairs; all
+ * features observed from (or anchored to) the same clone then read the same cached
+ * entry instead of redoing the rotation composition per feature, which also makes the
+ * cache safe to read from the parallel per-feature loops without locking.
+ */
+class UpdaterJacobianEngine {
+
+public:
+  virtual ~UpdaterJacobianEngine() = default;
+
+  /**
+   * @brief Construct one engine per landmark representation.
+   *
+   * Called once at VioManager construction. Safe to call multiple times (no-op after the first).
+   */
+  static void initialize();
+
+  /**
+   * @brief Get the engine for the given landmark representation.
+   * @param feat_representation Representation the feature error state is in
+   */
+  static std::shared_ptr<UpdaterJacobianEngine> get(ov_type::LandmarkRepresentation::Representation feat_representation);
+
+  /**
+   * @brief Snapshot per-anchor-clone rotation/position terms for a new update pass.
+   *
+   * Must be called after any operation that changes the clone or calibration estimates
+   * (propagation, an EKF update) and before Jacobian construction starts. After this call
+   * the cached terms can be read concurrently from the per-feature worker threads.
+   *
+   * @param state State of the filter system
+   */
+  static void begin_pass(std::shared_ptr<State> state);
+
+  /**
+   * @brief Jacobian of the global feature position in respect to this engine's representation.
+   *
+   * Same contract as @ref UpdaterHelper::get_feature_jacobian_representation, which
+   * delegates here. The feature's representation must match this engine's.
+   *
+   * @param[in] state State of the filter system
+   * @param[in] feature Feature we want to get Jacobians of (must have feature means)
+   * @param[out] H_f Jacobians in respect to the feature error state (will be either 3x3 or 3x1 for single depth)
+   * @param[out] H_x Extra Jacobians in respect to the state (for example anchored pose)
+   * @param[out] x_order Extra variables our extra Jacobian has (for example anchored pose)
+   */
+  virtual void jacobian_representation(std::shared_ptr<State> state, UpdaterHelper::UpdaterHelperFeature &feature, Eigen::MatrixXd &H_f,
+                                       std::vector<Eigen::MatrixXd> &H_x, std::vector<std::shared_ptr<ov_type::Type>> &x_order) const = 0;
+
+  /// Cached rotation and position terms for one (camera, clone) pair
+  struct CloneTerms {
+    Eigen::Matrix3d R_ItoC;     ///< Rotation from IMU to camera
+    Eigen::Vector3d p_IinC;     ///< Position of IMU in camera
+    Eigen::Matrix3d R_GtoI;     ///< Rotation from global to IMU clone
+    Eigen::Vector3d p_IinG;     ///< Position of IMU clone in global
+    Eigen::Matrix3d R_GtoC;     ///< Composed rotation from global to camera (R_ItoC * R_GtoI)
+    Eigen::Matrix3d R_GtoI_fej; ///< First-estimate rotation from global to IMU clone
+    Eigen::Vector3d p_IinG_fej; ///< First-estimate position of IMU clone in global
+    Eigen::Matrix3d R_GtoC_fej; ///< Composed first-estimate rotation from global to camera
+  };
+
+  /**
+   * @brief Cached pose terms for the given camera and clone timestamp.
+   *
+   * Normally served straight from the @ref begin_pass snapshot, with a locked
+   * compute-and-insert fallback if the pair has not been cached yet.
+   */
+  static const CloneTerms &clone_terms(std::shared_ptr<State> state, int cam_id, double timestamp);
+
+protected:
+  /**
+   * @brief Shared prologue of all anchored representations.
+   *
+   * Applies the FEJ anchor adjustment to the feature position, and appends the anchor
+   * pose (and optionally anchor camera calibration) Jacobians to the output.
+   *
+   * @param[in] state State of the filter system
+   * @param[in] feature Feature we want to get Jacobians of (must have a valid anchor)
+   * @param[out] p_FinA Feature position in the anchor frame (FEJ-adjusted if enabled)
+   * @param[out] H_x Extra Jacobians in respect to the state (anchor pose appended here)
+   * @param[out] x_order Extra variables our extra Jacobian has (anchor pose appended here)
+   * @return Rotation from the anchor camera frame to the global frame
+   */
+  static Eigen::Matrix3d anchored_prologue(std::shared_ptr<State> state, UpdaterHelper::UpdaterHelperFeature &feature,
+                                           Eigen::Vector3d &p_FinA, std::vector<Eigen::MatrixXd> &H_x,
+                                           std::vector<std::shared_ptr<ov_type::Type>> &x_order);
+
+private:
+  /// Engines for each landmark representation (built by initialize())
+  static std::map<ov_type::LandmarkRepresentation::Representation, std::shared_ptr<UpdaterJacobianEngine>> engines;
+
+  /// Cached pose terms keyed by (camera id, clone timestamp)
+  static std::map<std::pair<int, double>, CloneTerms> cache_clones;
+
+  /// Mutex protecting mutation of the clone term cache
+  static std::mutex cache_mtx;
+};
+
+/**
+ * @brief Jacobian engine specialized at compile time for one landmark representation.
+ *
+ * Each supported @ref ov_type::LandmarkRepresentation::Representation value gets its own
+ * explicit specialization of @ref jacobian_representation in the translation unit, so the
+ * per-representation math compiles to straight-line code with no enum branching.
+ */
+template <ov_type::LandmarkRepresentation::Representation Rep> class UpdaterJacobianEngineT : public UpdaterJacobianEngine {
+public:
+  void jacobian_representation(std::shared_ptr<State> state, UpdaterHelper::UpdaterHelperFeature &feature, Eigen::MatrixXd &H_f,
+                               std::vector<Eigen::MatrixXd> &H_x,
+                               std::vector<std::shared_ptr<ov_type::Type>> &x_order) const override;
+};
+
+} // namespace ov_msckf
+
+#endif // OV_MSCKF_UPDATER_JACOBIAN_ENGINE_H
@@ -21,19 +21,24 @@
 
 #include "UpdaterMSCKF.h"
 
+#include <algorithm>
+#include <map>
+#include <unordered_set>
+
 #include "UpdaterHelper.h"
+#include "UpdaterJacobianEngine.h"
 
 #include "feat/Feature.h"
 #include "feat/FeatureInitializer.h"
 #include "state/State.h"
 #include "state/StateHelper.h"
 #include "types/LandmarkRepresentation.h"
+#include "utils/chi_square_table.h"
 #include "utils/colors.h"
 #include "utils/print.h"
 #include "utils/quat_ops.h"
-
-#include <boost/date_time/posix_time/posix_time.hpp>
-#include <boost/math/distributions/chi_squared.hpp>
+#include "utils/thread_pool.h"
+#include "utils/tracer.h"
 
 using namespace ov_core;
 using namespace ov_type;
@@ -47,12 +52,6 @@ UpdaterMSCKF::UpdaterMSCKF(UpdaterOptions &options, ov_core::FeatureInitializerO
   // Save our feature initializer
   initializer_feat = std::shared_ptr<ov_core::FeatureInitializer>(new ov_core::FeatureInitializer(feat_init_options));
 
-  // Initialize the chi squared test table with confidence level 0.95
-  // https://github.com/KumarRobotics/msckf_vio/blob/050c50defa5a7fd9a04c1eed5687b405f02919b5/src/msckf_vio.cpp#L215-L221
-  for (int i = 1; i < 500; i++) {
-    boost::math::chi_squared chi_squared_dist(i);
-    chi_squared_table[i] = boost::math::quantile(chi_squared_dist, 0.95);
-  }
 }
 
 void UpdaterMSCKF::update(std::shared_ptr<State> state, std::vector<std::shared_ptr<Feature>> &feature_vec) {
@@ -62,8 +61,7 @@ void UpdaterMSCKF::update(std::shared_ptr<State> state, std::vector<std::shared_
     return;
 
   // Start timing
-  boost::posix_time::ptime rT0, rT1, rT2, rT3, rT4, rT5;
-  rT0 = boost::posix_time::microsec_clock::local_time();
+  ov_core::TraceSpan span_clean("msckf clean");
 
   // 0. Get all timestamps our clones are at (and thus valid measurement times)
   std::vector<double> clonetimes;
@@ -72,11 +70,17 @@ void UpdaterMSCKF::update(std::shared_ptr<State> state, std::vector<std::shared_
   }
 
   // 1. Clean all feature measurements and make sure they all have valid clone times
+  // With interpolated clones, measurements between the clone times are usable too,
+  // so we only drop what falls outside the current clone window
   auto it0 = feature_vec.begin();
   while (it0 != feature_vec.end()) {
 
     // Clean the feature
-    (*it0)->clean_old_measurements(clonetimes);
+    if (state->_options.use_interpolated_clones && clonetimes.size() > 1) {
+      (*it0)->clean_outside_measurements(clonetimes.front(), clonetimes.back());
+    } else {
+      (*it0)->clean_old_measurements(clonetimes);
+    }
 
     // Count how many measurements
     int ct_meas = 0;
@@ -92,7 +96,8 @@ void UpdaterMSCKF::update(std::shared_ptr<State> state, std::vector<std::shared_
       it0++;
     }
   }
-  rT1 = boost::posix_time::microsec_clock::local_time();
+  span_clean.stop();
+  ov_core::TraceSpan span_triangulate("msckf triangulate");
 
   // 2. Create vector of cloned *CAMERA* poses at each of our clone timesteps
   std::unordered_map<size_t, std::unordered_map<double, FeatureInitializer::ClonePose>> clones_cam;
@@ -114,33 +119,16 @@ void UpdaterMSCKF::update(std::shared_ptr<State> state, std::vector<std::shared_
     clones_cam.insert({clone_calib.first, clones_cami});
   }
 
-  // 3. Try to triangulate all MSCKF or new SLAM features that have measurements
-  auto it1 = feature_vec.begin();
-  while (it1 != feature_vec.end()) {
-
-    // Triangulate the feature and remove if it fails
-    bool success_tri = true;
-    if (initializer_feat->config().triangulate_1d) {
-      success_tri = initializer_feat->single_triangulation_1d(*it1, clones_cam);
-    } else {
-      success_tri = initializer_feat->single_triangulation(*it1, clones_cam);
-    }
-
-    // Gauss-newton refine the feature
-    bool success_refine = true;
-    if (initializer_feat->config().refine_features) {
-      success_refine = initializer_feat->single_gaussnewton(*it1, clones_cam);
-    }
-
-    // Remove the feature if not a success
-    if (!success_tri || !success_refine) {
-      (*it1)->to_delete = true;
-      it1 = feature_vec.erase(it1);
-      continue;
-    }
-    it1++;
+  // Also provide interpolated camera poses for measurement times between the clones
+  if (state->_options.use_interpolated_clones) {
+    UpdaterHelper::add_interpolated_clone_poses(state, feature_vec, clones_cam);
   }
-  rT2 = boost::posix_time::microsec_clock::local_time();
+
+  // 3. Try to triangulate all MSCKF or new SLAM features that have measurements
+  // This solves (and optionally gauss-newton refines) all features in parallel
+  initializer_feat->batch_triangulation(feature_vec, clones_cam);
+  span_triangulate.stop();
+  ov_core::TraceSpan span_system("msckf system");
 
   // Calculate the max possible measurement size
   size_t max_meas_size = 0;
@@ -160,21 +148,39 @@ void UpdaterMSCKF::update(std::shared_ptr<State> state, std::vector<std::shared_
   // Large Jacobian and residual of *all* features for this update
   Eigen::VectorXd res_big = Eigen::VectorXd::Zero(max_meas_size);
   Eigen::MatrixXd Hx_big = Eigen::MatrixXd::Zero(max_meas_size, max_hx_size);
-  std::unordered_map<std::shared_ptr<Type>, size_t> Hx_mapping;
+  // Bookkeeping containers are keyed by the covariance location of each variable
+  // (a unique small-integer handle) instead of hashing shared pointers
+  std::unordered_map<int, size_t> Hx_mapping;
   std::vector<std::shared_ptr<Type>> Hx_order_big;
   size_t ct_jacob = 0;
   size_t ct_meas = 0;
 
   // 4. Compute linear system for each feature, nullspace project, and reject
-  auto it2 = feature_vec.begin();
-  while (it2 != feature_vec.end()) {
+  // Jacobian construction, nullspace projection, and the chi2 gate only *read* the
+  // state, so each feature is an independent task we can farm out to the thread pool.
+  // The survivors are then stacked serially in their original order afterwards so the
+  // final linear system (and thus the update) stays deterministic.
+  // Snapshot the per-anchor-clone terms so the workers share them without locking,
+  // and gather the gating covariance once for all the chi2 checks of this pass
+  UpdaterJacobianEngine::begin_pass(state);
+  StateHelper::refresh_gating_cache(state);
+  struct FeatureSystem {
+    bool valid = false;
+    size_t featid = 0;
+    int cam_group = -1;
+    Eigen::MatrixXd H_x;
+    Eigen::VectorXd res;
+    std::vector<std::shared_ptr<Type>> Hx_order;
+  };
+  std::vector<FeatureSystem> systems(feature_vec.size());
+  ov_core::ThreadPool::instance().parallel_for(0, (int)feature_vec.size(), [&](int f) {
 
     // Convert our feature into our current format
     UpdaterHelper::UpdaterHelperFeature feat;
-    feat.featid = (*it2)->featid;
-    feat.uvs = (*it2)->uvs;
-    feat.uvs_norm = (*it2)->uvs_norm;
-    feat.timestamps = (*it2)->timestamps;
+    feat.featid = feature_vec.at(f)->featid;
+    feat.uvs = feature_vec.at(f)->uvs;
+    feat.uvs_norm = feature_vec.at(f)->uvs_norm;
+    feat.timestamps = feature_vec.at(f)->timestamps;
 
     // If we are using single inverse depth, then it is equivalent to using the msckf inverse depth
     feat.feat_representation = state->_options.feat_rep_msckf;
@@ -184,77 +190,129 @@ void UpdaterMSCKF::update(std::shared_ptr<State> state, std::vector<std::shared_
 
     // Save the position and its fej value
     if (LandmarkRepresentation::is_relative_representation(feat.feat_representation)) {
-      feat.anchor_cam_id = (*it2)->anchor_cam_id;
-      feat.anchor_clone_timestamp = (*it2)->anchor_clone_timestamp;
-      feat.p_FinA = (*it2)->p_FinA;
-      feat.p_FinA_fej = (*it2)->p_FinA;
+      feat.anchor_cam_id = feature_vec.at(f)->anchor_cam_id;
+      feat.anchor_clone_timestamp = feature_vec.at(f)->anchor_clone_timestamp;
+      feat.p_FinA = feature_vec.at(f)->p_FinA;
+      feat.p_FinA_fej = feature_vec.at(f)->p_FinA;
     } else {
-      feat.p_FinG = (*it2)->p_FinG;
-      feat.p_FinG_fej = (*it2)->p_FinG;
+      feat.p_FinG = feature_vec.at(f)->p_FinG;
+      feat.p_FinG_fej = feature_vec.at(f)->p_FinG;
     }
 
-    // Our return values (feature jacobian, state jacobian, residual, and order of state jacobian)
-    Eigen::MatrixXd H_f;
-    Eigen::MatrixXd H_x;
-    Eigen::VectorXd res;
-    std::vector<std::shared_ptr<Type>> Hx_order;
-
     // Get the Jacobian for this feature
-    UpdaterHelper::get_feature_jacobian_full(state, feat, H_f, H_x, res, Hx_order);
+    Eigen::MatrixXd H_f;
+    FeatureSystem &sys = systems.at(f);
+    UpdaterHelper::get_feature_jacobian_full(state, feat, H_f, sys.H_x, sys.res, sys.Hx_order);
 
     // Nullspace project
-    UpdaterHelper::nullspace_project_inplace(H_f, H_x, res);
+    UpdaterHelper::nullspace_project_inplace(H_f, sys.H_x, sys.res);
 
-    /// Chi2 distance check
-    Eigen::MatrixXd P_marg = StateHelper::get_marginal_covariance(state, Hx_order);
-    Eigen::MatrixXd S = H_x * P_marg * H_x.transpose();
+    /// Chi2 distance check (covariance blocks are served from the per-pass gating cache)
+    Eigen::MatrixXd S = MarginalCovarianceView(state, sys.Hx_order, true).quadratic_form(sys.H_x);
     S.diagonal() += _options.sigma_pix_sq * Eigen::VectorXd::Ones(S.rows());
-    double chi2 = res.dot(S.llt().solve(res));
+    double chi2 = sys.res.dot(S.llt().solve(sys.res));
 
-    // Get our threshold (we precompute up to 500 but handle the case that it is more)
-    double chi2_check;
-    if (res.rows() < 500) {
-      chi2_check = chi_squared_table[res.rows()];
-    } else {
-      boost::math::chi_squared chi_squared_dist(res.rows());
-      chi2_check = boost::math::quantile(chi_squared_dist, 0.95);
-      PRINT_WARNING(YELLOW "chi2_check over the residual limit - %d\n" RESET, (int)res.rows());
-    }
+    // Get our threshold (flat table with analytic tail for large residuals)
+    double chi2_check = ChiSquareTable::chi_squared_095((int)sys.res.rows());
 
     // Check if we should delete or not
-    if (chi2 > _options.chi2_multipler * chi2_check) {
+    // With robust weighting active the gate is loosened, since borderline
+    // features will be down-weighted by the robust pass instead of discarded
+    double relax = (_options.robust_norm != "none") ? _options.robust_chi2_relax : 1.0;
+    sys.featid = feat.featid;
+    sys.valid = (chi2 <= relax * _options.chi2_multipler * chi2_check);
+
+    // Which camera partition this feature's rows belong to for the partitioned
+    // compression (features seen by multiple cameras go into the shared group)
+    sys.cam_group = (feat.timestamps.size() == 1) ? (int)feat.timestamps.begin()->first : -1;
+  });
+
+  // Remove the features whose chi2 gate failed, and collect the set of state
+  // variables the survivors touch so we can pick the stacked column order
+  std::map<int, std::shared_ptr<Type>> vars_used;
+  size_t index = 0;
+  auto it2 = feature_vec.begin();
+  while (it2 != feature_vec.end()) {
+    FeatureSystem &sys = systems.at(index++);
+    if (!sys.valid) {
       (*it2)->to_delete = true;
       it2 = feature_vec.erase(it2);
-      // PRINT_DEBUG("featid = %d\n", feat.featid);
-      // PRINT_DEBUG("chi2 = %f > %f\n", chi2, _options.chi2_multipler*chi2_check);
-      // std::stringstream ss;
-      // ss << "res = " << std::endl << res.transpose() << std::endl;
-      // PRINT_DEBUG(ss.str().c_str());
       continue;
     }
+    for (const auto &var : sys.Hx_order) {
+      vars_used.insert({var->id(), var});
+    }
+    it2++;
+  }
 
-    // We are good!!! Append to our large H vector
-    size_t ct_hx = 0;
-    for (const auto &var : Hx_order) {
-
-      // Ensure that this variable is in our Jacobian
-      if (Hx_mapping.find(var) == Hx_mapping.end()) {
-        Hx_mapping.insert({var, ct_jacob});
-        Hx_order_big.push_back(var);
-        ct_jacob += var->size();
-      }
+  // Canonical column order: calibration-style variables first (sorted by covariance id),
+  // then the clones ordered by time. Each feature observes a contiguous window of clones,
+  // so with this ordering its stacked rows are zero outside a narrow column band which
+  // the sparsity-aware compression below can skip entirely.
+  std::unordered_set<int> clone_set;
+  for (const auto &clone : state->_clones_IMU) {
+    clone_set.insert(clone.second->id());
+  }
+  for (const auto &var : vars_used) {
+    if (clone_set.find(var.first) == clone_set.end()) {
+      Hx_mapping.insert({var.first, ct_jacob});
+      Hx_order_big.push_back(var.second);
+      ct_jacob += var.second->size();
+    }
+  }
+  for (const auto &clone : state->_clones_IMU) {
+    if (vars_used.find(clone.second->id()) != vars_used.end()) {
+      Hx_mapping.insert({clone.second->id(), ct_jacob});
+      Hx_order_big.push_back(clone.second);
+      ct_jacob += clone.second->size();
+    }
+  }
 
-      // Append to our large Jacobian
-      Hx_big.block(ct_meas, Hx_mapping[var], H_x.rows(), var->size()) = H_x.block(0, ct_hx, H_x.rows(), var->size());
+  // Now serially stack the surviving features, recording the nonzero column extent
+  // of each row for the compression (and which rows belong to which feature, so the
+  // robust pass can report its per-feature weights). The order is the original one,
+  // except that with the partitioned compression active we group by camera so each
+  // partition owns a contiguous row block of the stacked system.
+  std::vector<size_t> stack_order;
+  for (size_t f = 0; f < systems.size(); f++) {
+    if (systems.at(f).valid)
+      stack_order.push_back(f);
+  }
+  if (_options.partition_by_camera) {
+    std::stable_sort(stack_order.begin(), stack_order.end(),
+                     [&](size_t a, size_t b) { return systems.at(a).cam_group < systems.at(b).cam_group; });
+  }
+  std::vector<std::pair<int, int>> row_spans;
+  row_spans.reserve(max_meas_size);
+  std::vector<std::pair<size_t, std::pair<size_t, size_t>>> feat_rows;
+  std::vector<std::pair<size_t, size_t>> partitions;
+  int group_last = -2;
+  for (size_t f : stack_order) {
+    FeatureSystem &sys = systems.at(f);
+    if (sys.cam_group != group_last) {
+      partitions.push_back({ct_meas, 0});
+      group_last = sys.cam_group;
+    }
+    partitions.back().second += sys.res.rows();
+    feat_rows.push_back({sys.featid, {ct_meas, (size_t)sys.res.rows()}});
+    int span_lo = (int)ct_jacob;
+    int span_hi = 0;
+    size_t ct_hx = 0;
+    for (const auto &var : sys.Hx_order) {
+      size_t col = Hx_mapping.at(var->id());
+      Hx_big.block(ct_meas, col, sys.H_x.rows(), var->size()) = sys.H_x.block(0, ct_hx, sys.H_x.rows(), var->size());
+      span_lo = std::min(span_lo, (int)col);
+      span_hi = std::max(span_hi, (int)(col + var->size()));
       ct_hx += var->size();
     }
-
-    // Append our residual and move forward
-    res_big.block(ct_meas, 0, res.rows(), 1) = res;
-    ct_meas += res.rows();
-    it2++;
+    for (int r = 0; r < (int)sys.res.rows(); r++) {
+      row_spans.emplace_back(span_lo, span_hi);
+    }
+    res_big.block(ct_meas, 0, sys.res.rows(), 1) = sys.res;
+    ct_meas += sys.res.rows();
   }
-  rT3 = boost::posix_time::microsec_clock::local_time();
+  span_system.stop();
+  ov_core::TraceSpan span_compress("msckf compress");
 
   // We have appended all features to our Hx_big, res_big
   // Delete it so we do not reuse information
@@ -271,25 +329,78 @@ void UpdaterMSCKF::update(std::shared_ptr<State> state, std::vector<std::shared_
   res_big.conservativeResize(ct_meas, 1);
   Hx_big.conservativeResize(ct_meas, ct_jacob);
 
-  // 5. Perform measurement compression
-  UpdaterHelper::measurement_compress_inplace(Hx_big, res_big);
+  // Optional robust pass: vectorized Huber/Cauchy row weighting of the stacked
+  // system, which must happen before the compression below mixes the rows
+  if (_options.robust_norm != "none") {
+    Eigen::ArrayXd w = UpdaterHelper::robust_weight_inplace(Hx_big, res_big, _options.sigma_pix, _options.robust_norm, _options.robust_norm_c);
+    for (const auto &fr : feat_rows) {
+      double w_mean = w.segment(fr.second.first, fr.second.second).mean();
+      if (w_mean < 1.0) {
+        PRINT_ALL("[MSCKF-UP]: robust weight %.2f for feature %d\n", w_mean, (int)fr.first);
+      }
+    }
+    PRINT_ALL("[MSCKF-UP]: robust pass down-weighted %d of %d rows (min %.2f)\n", (int)(w < 1.0).count(), (int)w.rows(), w.minCoeff());
+  }
+
+  // 5. Perform measurement compression (exploiting the banded row structure)
+  // With the partitioned path, each camera's contiguous row block is compressed
+  // independently in parallel and the merged factors are compressed once more.
+  // Per-block orthogonal transforms leave H^T R^-1 H unchanged (R is isotropic),
+  // so this is equivalent to one big QR while replacing its superlinear cost
+  // with several smaller concurrent ones on many-camera rigs.
+  if (_options.partition_by_camera && partitions.size() > 1) {
+    struct PartitionBlock {
+      Eigen::MatrixXd H;
+      Eigen::VectorXd res;
+      std::vector<std::pair<int, int>> spans;
+    };
+    std::vector<PartitionBlock> blocks(partitions.size());
+    for (size_t p = 0; p < partitions.size(); p++) {
+      size_t row0 = partitions.at(p).first;
+      size_t rows = partitions.at(p).second;
+      blocks.at(p).H = Hx_big.block(row0, 0, rows, ct_jacob);
+      blocks.at(p).res = res_big.segment(row0, rows);
+      blocks.at(p).spans.assign(row_spans.begin() + row0, row_spans.begin() + row0 + rows);
+    }
+    ov_core::ThreadPool::instance().parallel_for(0, (int)blocks.size(), [&](int p) {
+      UpdaterHelper::measurement_compress_inplace(blocks.at(p).H, blocks.at(p).res, blocks.at(p).spans);
+    });
+    size_t rows_merged = 0;
+    for (const auto &block : blocks) {
+      rows_merged += block.H.rows();
+    }
+    Hx_big.resize(rows_merged, ct_jacob);
+    res_big.resize(rows_merged);
+    size_t row0 = 0;
+    for (const auto &block : blocks) {
+      Hx_big.block(row0, 0, block.H.rows(), ct_jacob) = block.H;
+      res_big.segment(row0, block.res.rows()) = block.res;
+      row0 += block.H.rows();
+    }
+    // Final pass over the merged factors (at most num-partitions * cols rows)
+    if (Hx_big.rows() > (int)ct_jacob) {
+      UpdaterHelper::measurement_compress_inplace(Hx_big, res_big);
+    }
+  } else {
+    UpdaterHelper::measurement_compress_inplace(Hx_big, res_big, row_spans);
+  }
   if (Hx_big.rows() < 1) {
     return;
   }
-  rT4 = boost::posix_time::microsec_clock::local_time();
+  span_compress.stop();
+  ov_core::TraceSpan span_update("msckf apply");
 
   // Our noise is isotropic, so make it here after our compression
   Eigen::MatrixXd R_big = _options.sigma_pix_sq * Eigen::MatrixXd::Identity(res_big.rows(), res_big.rows());
 
   // 6. With all good features update the state
   StateHelper::EKFUpdate(state, Hx_order_big, Hx_big, res_big, R_big);
-  rT5 = boost::posix_time::microsec_clock::local_time();
+  span_update.stop();
 
   // Debug print timing information
-  PRINT_ALL("[MSCKF-UP]: %.4f seconds to clean\n", (rT1 - rT0).total_microseconds() * 1e-6);
-  PRINT_ALL("[MSCKF-UP]: %.4f seconds to triangulate\n", (rT2 - rT1).total_microseconds() * 1e-6);
-  PRINT_ALL("[MSCKF-UP]: %.4f seconds create system (%d features)\n", (rT3 - rT2).total_microseconds() * 1e-6, (int)feature_vec.size());
-  PRINT_ALL("[MSCKF-UP]: %.4f seconds compress system\n", (rT4 - rT3).total_microseconds() * 1e-6);
-  PRINT_ALL("[MSCKF-UP]: %.4f seconds update state (%d size)\n", (rT5 - rT4).total_microseconds() * 1e-6, (int)res_big.rows());
-  PRINT_ALL("[MSCKF-UP]: %.4f seconds total\n", (rT5 - rT1).total_microseconds() * 1e-6);
+  PRINT_ALL("[MSCKF-UP]: %.4f seconds to clean\n", span_clean.seconds());
+  PRINT_ALL("[MSCKF-UP]: %.4f seconds to triangulate\n", span_triangulate.seconds());
+  PRINT_ALL("[MSCKF-UP]: %.4f seconds create system (%d features)\n", span_system.seconds(), (int)feature_vec.size());
+  PRINT_ALL("[MSCKF-UP]: %.4f seconds compress system\n", span_compress.seconds());
+  PRINT_ALL("[MSCKF-UP]: %.4f seconds update state (%d size)\n", span_update.seconds(), (int)res_big.rows());
 }
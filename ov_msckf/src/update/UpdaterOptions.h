@@ -22,6 +22,8 @@
 #ifndef OV_MSCKF_UPDATER_OPTIONS_H
 #define OV_MSCKF_UPDATER_OPTIONS_H
 
+#include <string>
+
 #include "utils/print.h"
 
 namespace ov_msckf {
@@ -40,10 +42,30 @@ struct UpdaterOptions {
   /// Covariance for our raw pixel measurements
   double sigma_pix_sq = 1;
 
+  /// Robust norm applied to residual rows before the update ("none", "huber", or "cauchy")
+  std::string robust_norm = "none";
+
+  /// Tuning constant of the robust norm in whitened-residual (sigma) units
+  double robust_norm_c = 1.345;
+
+  /// Factor the chi2 gate is loosened by when robust weighting is active, so
+  /// borderline features are kept and down-weighted instead of discarded
+  double robust_chi2_relax = 4.0;
+
+  /// If the measurement compression should be partitioned by camera and run in
+  /// parallel (many-camera rigs, see UpdaterMSCKF::update)
+  bool partition_by_camera = false;
+
   /// Nice print function of what parameters we have loaded
   void print() {
     PRINT_DEBUG("    - chi2_multipler: %.1f\n", chi2_multipler);
     PRINT_DEBUG("    - sigma_pix: %.2f\n", sigma_pix);
+    PRINT_DEBUG("    - robust_norm: %s\n", robust_norm.c_str());
+    if (robust_norm != "none") {
+      PRINT_DEBUG("    - robust_norm_c: %.3f\n", robust_norm_c);
+      PRINT_DEBUG("    - robust_chi2_relax: %.1f\n", robust_chi2_relax);
+    }
+    PRINT_DEBUG("    - partition_by_camera: %d\n", (int)partition_by_camera);
   }
 };
 
@@ -22,6 +22,7 @@
 #include "UpdaterSLAM.h"
 
 #include "UpdaterHelper.h"
+#include "UpdaterJacobianEngine.h"
 
 #include "feat/Feature.h"
 #include "feat/FeatureInitializer.h"
@@ -29,12 +30,12 @@
 #include "state/StateHelper.h"
 #include "types/Landmark.h"
 #include "types/LandmarkRepresentation.h"
+#include "utils/chi_square_table.h"
 #include "utils/colors.h"
 #include "utils/print.h"
 #include "utils/quat_ops.h"
-
-#include <boost/date_time/posix_time/posix_time.hpp>
-#include <boost/math/distributions/chi_squared.hpp>
+#include "utils/thread_pool.h"
+#include "utils/tracer.h"
 
 using namespace ov_core;
 using namespace ov_type;
@@ -49,13 +50,6 @@ UpdaterSLAM::UpdaterSLAM(UpdaterOptions &options_slam, UpdaterOptions &options_a
 
   // Save our feature initializer
   initializer_feat = std::shared_ptr<ov_core::FeatureInitializer>(new ov_core::FeatureInitializer(feat_init_options));
-
-  // Initialize the chi squared test table with confidence level 0.95
-  // https://github.com/KumarRobotics/msckf_vio/blob/050c50defa5a7fd9a04c1eed5687b405f02919b5/src/msckf_vio.cpp#L215-L221
-  for (int i = 1; i < 500; i++) {
-    boost::math::chi_squared chi_squared_dist(i);
-    chi_squared_table[i] = boost::math::quantile(chi_squared_dist, 0.95);
-  }
 }
 
 void UpdaterSLAM::delayed_init(std::shared_ptr<State> state, std::vector<std::shared_ptr<Feature>> &feature_vec) {
@@ -65,8 +59,7 @@ void UpdaterSLAM::delayed_init(std::shared_ptr<State> state, std::vector<std::sh
     return;
 
   // Start timing
-  boost::posix_time::ptime rT0, rT1, rT2, rT3;
-  rT0 = boost::posix_time::microsec_clock::local_time();
+  ov_core::TraceSpan span_clean("slam-delay clean");
 
   // 0. Get all timestamps our clones are at (and thus valid measurement times)
   std::vector<double> clonetimes;
@@ -75,11 +68,17 @@ void UpdaterSLAM::delayed_init(std::shared_ptr<State> state, std::vector<std::sh
   }
 
   // 1. Clean all feature measurements and make sure they all have valid clone times
+  // With interpolated clones, measurements between the clone times are usable too,
+  // so we only drop what falls outside the current clone window
   auto it0 = feature_vec.begin();
   while (it0 != feature_vec.end()) {
 
     // Clean the feature
-    (*it0)->clean_old_measurements(clonetimes);
+    if (state->_options.use_interpolated_clones && clonetimes.size() > 1) {
+      (*it0)->clean_outside_measurements(clonetimes.front(), clonetimes.back());
+    } else {
+      (*it0)->clean_old_measurements(clonetimes);
+    }
 
     // Count how many measurements
     int ct_meas = 0;
@@ -95,7 +94,8 @@ void UpdaterSLAM::delayed_init(std::shared_ptr<State> state, std::vector<std::sh
       it0++;
     }
   }
-  rT1 = boost::posix_time::microsec_clock::local_time();
+  span_clean.stop();
+  ov_core::TraceSpan span_triangulate("slam-delay triangulate");
 
   // 2. Create vector of cloned *CAMERA* poses at each of our clone timesteps
   std::unordered_map<size_t, std::unordered_map<double, FeatureInitializer::ClonePose>> clones_cam;
@@ -117,35 +117,27 @@ void UpdaterSLAM::delayed_init(std::shared_ptr<State> state, std::vector<std::sh
     clones_cam.insert({clone_calib.first, clones_cami});
   }
 
-  // 3. Try to triangulate all MSCKF or new SLAM features that have measurements
-  auto it1 = feature_vec.begin();
-  while (it1 != feature_vec.end()) {
-
-    // Triangulate the feature and remove if it fails
-    bool success_tri = true;
-    if (initializer_feat->config().triangulate_1d) {
-      success_tri = initializer_feat->single_triangulation_1d(*it1, clones_cam);
-    } else {
-      success_tri = initializer_feat->single_triangulation(*it1, clones_cam);
-    }
-
-    // Gauss-newton refine the feature
-    bool success_refine = true;
-    if (initializer_feat->config().refine_features) {
-      success_refine = initializer_feat->single_gaussnewton(*it1, clones_cam);
-    }
-
-    // Remove the feature if not a success
-    if (!success_tri || !success_refine) {
-      (*it1)->to_delete = true;
-      it1 = feature_vec.erase(it1);
-      continue;
-    }
-    it1++;
+  // Also provide interpolated camera poses for measurement times between the clones
+  if (state->_options.use_interpolated_clones) {
+    UpdaterHelper::add_interpolated_clone_poses(state, feature_vec, clones_cam);
   }
-  rT2 = boost::posix_time::microsec_clock::local_time();
 
-  // 4. Compute linear system for each feature, nullspace project, and reject
+  // 3. Try to triangulate all MSCKF or new SLAM features that have measurements
+  // This solves (and optionally gauss-newton refines) all features in parallel
+  initializer_feat->batch_triangulation(feature_vec, clones_cam);
+  span_triangulate.stop();
+  ov_core::TraceSpan span_init("slam-delay initialize");
+
+  // 4. Compute linear system for each feature, nullspace project, and gate
+  // We gate every candidate against the current covariance first and collect the
+  // accepted systems, so afterwards we can grow the covariance for all accepted
+  // landmarks in one blocked augmentation and apply one stacked update, instead
+  // of paying a covariance resize and an EKF update per landmark
+  UpdaterJacobianEngine::begin_pass(state);
+  std::vector<StateHelper::InitSystem> init_systems;
+  std::vector<Eigen::MatrixXd> Hup_systems;
+  std::vector<Eigen::VectorXd> resup_systems;
+  std::vector<std::vector<std::shared_ptr<Type>>> Hup_orders;
   auto it2 = feature_vec.begin();
   while (it2 != feature_vec.end()) {
 
@@ -227,10 +219,22 @@ void UpdaterSLAM::delayed_init(std::shared_ptr<State> state, std::vector<std::sh
         ((int)feat.featid < state->_options.max_aruco_features) ? _options_aruco.sigma_pix_sq : _options_slam.sigma_pix_sq;
     Eigen::MatrixXd R = sigma_pix_sq * Eigen::MatrixXd::Identity(res.rows(), res.rows());
 
-    // Try to initialize, delete new pointer if we failed
+    // Try to gate the candidate, delete new pointer if we failed
     double chi2_multipler =
         ((int)feat.featid < state->_options.max_aruco_features) ? _options_aruco.chi2_multipler : _options_slam.chi2_multipler;
-    if (StateHelper::initialize(state, landmark, Hx_order, H_x, H_f, R, res, chi2_multipler)) {
+    StateHelper::InitSystem init_sys;
+    Eigen::MatrixXd H_up;
+    Eigen::VectorXd res_up;
+    Eigen::MatrixXd R_up;
+    if (StateHelper::initialize_separate(state, landmark, Hx_order, H_x, H_f, R, res, chi2_multipler, init_sys, H_up, res_up, R_up)) {
+      // Whiten the leftover updating portion so the stacked system below has identity noise
+      if (H_up.rows() > 0) {
+        double sigma_pix = std::sqrt(sigma_pix_sq);
+        Hup_systems.push_back(H_up / sigma_pix);
+        resup_systems.push_back(res_up / sigma_pix);
+        Hup_orders.push_back(Hx_order);
+      }
+      init_systems.push_back(init_sys);
       state->_features_SLAM.insert({(*it2)->featid, landmark});
       (*it2)->to_delete = true;
       it2++;
@@ -239,14 +243,60 @@ void UpdaterSLAM::delayed_init(std::shared_ptr<State> state, std::vector<std::sh
       it2 = feature_vec.erase(it2);
     }
   }
-  rT3 = boost::posix_time::microsec_clock::local_time();
+
+  // 5. Initialize all accepted landmarks with one blocked covariance augmentation
+  StateHelper::initialize_batch(state, init_systems);
+
+  // 6. Stack the whitened updating portions into one large system and update once
+  if (!Hup_systems.empty()) {
+
+    // Calculate the max possible measurement size
+    size_t max_meas_size = 0;
+    for (const auto &H_up : Hup_systems) {
+      max_meas_size += H_up.rows();
+    }
+
+    // Large Jacobian and residual of *all* leftover updating portions
+    Eigen::VectorXd res_big = Eigen::VectorXd::Zero(max_meas_size);
+    Eigen::MatrixXd Hx_big = Eigen::MatrixXd::Zero(max_meas_size, state->max_covariance_size());
+    std::unordered_map<int, size_t> Hx_mapping;
+    std::vector<std::shared_ptr<Type>> Hx_order_big;
+    size_t ct_jacob = 0;
+    size_t ct_meas = 0;
+    for (size_t i = 0; i < Hup_systems.size(); i++) {
+      const Eigen::MatrixXd &H_up = Hup_systems.at(i);
+      size_t ct_hx = 0;
+      for (const auto &var : Hup_orders.at(i)) {
+        // Ensure that this variable is in our Jacobian
+        if (Hx_mapping.find(var->id()) == Hx_mapping.end()) {
+          Hx_mapping.insert({var->id(), ct_jacob});
+          Hx_order_big.push_back(var);
+          ct_jacob += var->size();
+        }
+        // Append to our large Jacobian
+        Hx_big.block(ct_meas, Hx_mapping[var->id()], H_up.rows(), var->size()) = H_up.block(0, ct_hx, H_up.rows(), var->size());
+        ct_hx += var->size();
+      }
+      res_big.block(ct_meas, 0, resup_systems.at(i).rows(), 1) = resup_systems.at(i);
+      ct_meas += H_up.rows();
+    }
+    res_big.conservativeResize(ct_meas, 1);
+    Hx_big.conservativeResize(ct_meas, ct_jacob);
+
+    // Perform measurement compression and update (the noise is identity after whitening)
+    UpdaterHelper::measurement_compress_inplace(Hx_big, res_big);
+    if (Hx_big.rows() > 0) {
+      Eigen::MatrixXd R_big = Eigen::MatrixXd::Identity(res_big.rows(), res_big.rows());
+      StateHelper::EKFUpdate(state, Hx_order_big, Hx_big, res_big, R_big);
+    }
+  }
+  span_init.stop();
 
   // Debug print timing information
   if (!feature_vec.empty()) {
-    PRINT_ALL("[SLAM-DELAY]: %.4f seconds to clean\n", (rT1 - rT0).total_microseconds() * 1e-6);
-    PRINT_ALL("[SLAM-DELAY]: %.4f seconds to triangulate\n", (rT2 - rT1).total_microseconds() * 1e-6);
-    PRINT_ALL("[SLAM-DELAY]: %.4f seconds initialize (%d features)\n", (rT3 - rT2).total_microseconds() * 1e-6, (int)feature_vec.size());
-    PRINT_ALL("[SLAM-DELAY]: %.4f seconds total\n", (rT3 - rT1).total_microseconds() * 1e-6);
+    PRINT_ALL("[SLAM-DELAY]: %.4f seconds to clean\n", span_clean.seconds());
+    PRINT_ALL("[SLAM-DELAY]: %.4f seconds to triangulate\n", span_triangulate.seconds());
+    PRINT_ALL("[SLAM-DELAY]: %.4f seconds initialize (%d features)\n", span_init.seconds(), (int)feature_vec.size());
   }
 }
 
@@ -257,8 +307,7 @@ void UpdaterSLAM::update(std::shared_ptr<State> state, std::vector<std::shared_p
     return;
 
   // Start timing
-  boost::posix_time::ptime rT0, rT1, rT2, rT3;
-  rT0 = boost::posix_time::microsec_clock::local_time();
+  ov_core::TraceSpan span_clean("slam clean");
 
   // 0. Get all timestamps our clones are at (and thus valid measurement times)
   std::vector<double> clonetimes;
@@ -267,11 +316,17 @@ void UpdaterSLAM::update(std::shared_ptr<State> state, std::vector<std::shared_p
   }
 
   // 1. Clean all feature measurements and make sure they all have valid clone times
+  // With interpolated clones, measurements between the clone times are usable too,
+  // so we only drop what falls outside the current clone window
   auto it0 = feature_vec.begin();
   while (it0 != feature_vec.end()) {
 
     // Clean the feature
-    (*it0)->clean_old_measurements(clonetimes);
+    if (state->_options.use_interpolated_clones && clonetimes.size() > 1) {
+      (*it0)->clean_outside_measurements(clonetimes.front(), clonetimes.back());
+    } else {
+      (*it0)->clean_old_measurements(clonetimes);
+    }
 
     // Count how many measurements
     int ct_meas = 0;
@@ -295,7 +350,8 @@ void UpdaterSLAM::update(std::shared_ptr<State> state, std::vector<std::shared_p
       it0++;
     }
   }
-  rT1 = boost::posix_time::microsec_clock::local_time();
+  span_clean.stop();
+  ov_core::TraceSpan span_system("slam system");
 
   // Calculate the max possible measurement size
   size_t max_meas_size = 0;
@@ -312,28 +368,45 @@ void UpdaterSLAM::update(std::shared_ptr<State> state, std::vector<std::shared_p
   Eigen::VectorXd res_big = Eigen::VectorXd::Zero(max_meas_size);
   Eigen::MatrixXd Hx_big = Eigen::MatrixXd::Zero(max_meas_size, max_hx_size);
   Eigen::MatrixXd R_big = Eigen::MatrixXd::Identity(max_meas_size, max_meas_size);
-  std::unordered_map<std::shared_ptr<Type>, size_t> Hx_mapping;
+  std::unordered_map<int, size_t> Hx_mapping;
   std::vector<std::shared_ptr<Type>> Hx_order_big;
   size_t ct_jacob = 0;
   size_t ct_meas = 0;
 
   // 4. Compute linear system for each feature, nullspace project, and reject
-  auto it2 = feature_vec.begin();
-  while (it2 != feature_vec.end()) {
+  // Each landmark's Jacobian construction and chi2 gate only *read* the state, so
+  // they are farmed out to the thread pool as independent tasks. The survivors are
+  // stacked serially in their original order afterwards (with any landmark fail
+  // counting and printing) so the final linear system stays deterministic.
+  struct LandmarkSystem {
+    bool valid = false;
+    Eigen::MatrixXd H_xf;
+    Eigen::VectorXd res;
+    std::vector<std::shared_ptr<Type>> Hxf_order;
+    double sigma_pix_sq = 0.0;
+    double chi2 = 0.0;
+    double chi2_check = 0.0;
+  };
+  // Snapshot the per-anchor-clone terms so the workers share them without locking,
+  // and gather the gating covariance once for all the chi2 checks of this pass
+  UpdaterJacobianEngine::begin_pass(state);
+  StateHelper::refresh_gating_cache(state);
+  std::vector<LandmarkSystem> systems(feature_vec.size());
+  ov_core::ThreadPool::instance().parallel_for(0, (int)feature_vec.size(), [&](int f) {
 
     // Ensure we have the landmark and it is the same
-    assert(state->_features_SLAM.find((*it2)->featid) != state->_features_SLAM.end());
-    assert(state->_features_SLAM.at((*it2)->featid)->_featid == (*it2)->featid);
+    assert(state->_features_SLAM.find(feature_vec.at(f)->featid) != state->_features_SLAM.end());
+    assert(state->_features_SLAM.at(feature_vec.at(f)->featid)->_featid == feature_vec.at(f)->featid);
 
     // Get our landmark from the state
-    std::shared_ptr<Landmark> landmark = state->_features_SLAM.at((*it2)->featid);
+    std::shared_ptr<Landmark> landmark = state->_features_SLAM.at(feature_vec.at(f)->featid);
 
     // Convert the state landmark into our current format
     UpdaterHelper::UpdaterHelperFeature feat;
-    feat.featid = (*it2)->featid;
-    feat.uvs = (*it2)->uvs;
-    feat.uvs_norm = (*it2)->uvs_norm;
-    feat.timestamps = (*it2)->timestamps;
+    feat.featid = feature_vec.at(f)->featid;
+    feat.uvs = feature_vec.at(f)->uvs;
+    feat.uvs_norm = feature_vec.at(f)->uvs_norm;
+    feat.timestamps = feature_vec.at(f)->timestamps;
 
     // If we are using single inverse depth, then it is equivalent to using the msckf inverse depth
     feat.feat_representation = landmark->_feat_representation;
@@ -386,31 +459,44 @@ void UpdaterSLAM::update(std::shared_ptr<State> state, std::vector<std::shared_p
     std::vector<std::shared_ptr<Type>> Hxf_order = Hx_order;
     Hxf_order.push_back(landmark);
 
-    // Chi2 distance check
-    Eigen::MatrixXd P_marg = StateHelper::get_marginal_covariance(state, Hxf_order);
-    Eigen::MatrixXd S = H_xf * P_marg * H_xf.transpose();
-    double sigma_pix_sq =
+    // Chi2 distance check (covariance blocks are served from the per-pass gating cache)
+    LandmarkSystem &sys = systems.at(f);
+    Eigen::MatrixXd S = MarginalCovarianceView(state, Hxf_order, true).quadratic_form(H_xf);
+    sys.sigma_pix_sq =
         ((int)feat.featid < state->_options.max_aruco_features) ? _options_aruco.sigma_pix_sq : _options_slam.sigma_pix_sq;
-    S.diagonal() += sigma_pix_sq * Eigen::VectorXd::Ones(S.rows());
-    double chi2 = res.dot(S.llt().solve(res));
+    S.diagonal() += sys.sigma_pix_sq * Eigen::VectorXd::Ones(S.rows());
+    sys.chi2 = res.dot(S.llt().solve(res));
 
-    // Get our threshold (we precompute up to 500 but handle the case that it is more)
-    double chi2_check;
-    if (res.rows() < 500) {
-      chi2_check = chi_squared_table[res.rows()];
-    } else {
-      boost::math::chi_squared chi_squared_dist(res.rows());
-      chi2_check = boost::math::quantile(chi_squared_dist, 0.95);
-      PRINT_WARNING(YELLOW "chi2_check over the residual limit - %d\n" RESET, (int)res.rows());
-    }
+    // Get our threshold (flat table with analytic tail for large residuals)
+    sys.chi2_check = ChiSquareTable::chi_squared_095((int)res.rows());
 
     // Check if we should delete or not
-    double chi2_multipler =
-        ((int)feat.featid < state->_options.max_aruco_features) ? _options_aruco.chi2_multipler : _options_slam.chi2_multipler;
-    if (chi2 > chi2_multipler * chi2_check) {
-      if ((int)feat.featid < state->_options.max_aruco_features) {
-        PRINT_WARNING(YELLOW "[SLAM-UP]: rejecting aruco tag %d for chi2 thresh (%.3f > %.3f)\n" RESET, (int)feat.featid, chi2,
-                      chi2_multipler * chi2_check);
+    // With robust weighting active the gate is loosened, since borderline
+    // landmarks will be down-weighted by the robust pass instead of discarded
+    const UpdaterOptions &opts = ((int)feat.featid < state->_options.max_aruco_features) ? _options_aruco : _options_slam;
+    double relax = (opts.robust_norm != "none") ? opts.robust_chi2_relax : 1.0;
+    sys.valid = (sys.chi2 <= relax * opts.chi2_multipler * sys.chi2_check);
+    sys.H_xf = H_xf;
+    sys.res = res;
+    sys.Hxf_order = Hxf_order;
+  });
+
+  // Now serially stack the landmarks that passed in their original order
+  size_t index = 0;
+  auto it2 = feature_vec.begin();
+  while (it2 != feature_vec.end()) {
+
+    // Get our landmark from the state and the system we computed for it
+    std::shared_ptr<Landmark> landmark = state->_features_SLAM.at((*it2)->featid);
+    LandmarkSystem &sys = systems.at(index++);
+
+    // Remove the feature (and count the failure) if its chi2 gate failed
+    if (!sys.valid) {
+      double chi2_multipler =
+          ((int)(*it2)->featid < state->_options.max_aruco_features) ? _options_aruco.chi2_multipler : _options_slam.chi2_multipler;
+      if ((int)(*it2)->featid < state->_options.max_aruco_features) {
+        PRINT_WARNING(YELLOW "[SLAM-UP]: rejecting aruco tag %d for chi2 thresh (%.3f > %.3f)\n" RESET, (int)(*it2)->featid, sys.chi2,
+                      chi2_multipler * sys.chi2_check);
       } else {
         landmark->update_fail_count++;
       }
@@ -420,35 +506,49 @@ void UpdaterSLAM::update(std::shared_ptr<State> state, std::vector<std::shared_p
     }
 
     // Debug print when we are going to update the aruco tags
-    if ((int)feat.featid < state->_options.max_aruco_features) {
-      PRINT_DEBUG("[SLAM-UP]: accepted aruco tag %d for chi2 thresh (%.3f < %.3f)\n", (int)feat.featid, chi2, chi2_multipler * chi2_check);
+    if ((int)(*it2)->featid < state->_options.max_aruco_features) {
+      double chi2_multipler = _options_aruco.chi2_multipler;
+      PRINT_DEBUG("[SLAM-UP]: accepted aruco tag %d for chi2 thresh (%.3f < %.3f)\n", (int)(*it2)->featid, sys.chi2,
+                  chi2_multipler * sys.chi2_check);
+    }
+
+    // Optional robust pass: weight this landmark's rows by its Huber/Cauchy weights
+    // This is done per landmark since the aruco and slam noise sigmas differ
+    const UpdaterOptions &opts = ((int)(*it2)->featid < state->_options.max_aruco_features) ? _options_aruco : _options_slam;
+    if (opts.robust_norm != "none") {
+      Eigen::ArrayXd w =
+          UpdaterHelper::robust_weight_inplace(sys.H_xf, sys.res, std::sqrt(sys.sigma_pix_sq), opts.robust_norm, opts.robust_norm_c);
+      if (w.mean() < 1.0) {
+        PRINT_ALL("[SLAM-UP]: robust weight %.2f for landmark %d\n", w.mean(), (int)(*it2)->featid);
+      }
     }
 
     // We are good!!! Append to our large H vector
     size_t ct_hx = 0;
-    for (const auto &var : Hxf_order) {
+    for (const auto &var : sys.Hxf_order) {
 
       // Ensure that this variable is in our Jacobian
-      if (Hx_mapping.find(var) == Hx_mapping.end()) {
-        Hx_mapping.insert({var, ct_jacob});
+      if (Hx_mapping.find(var->id()) == Hx_mapping.end()) {
+        Hx_mapping.insert({var->id(), ct_jacob});
         Hx_order_big.push_back(var);
         ct_jacob += var->size();
       }
 
       // Append to our large Jacobian
-      Hx_big.block(ct_meas, Hx_mapping[var], H_xf.rows(), var->size()) = H_xf.block(0, ct_hx, H_xf.rows(), var->size());
+      Hx_big.block(ct_meas, Hx_mapping[var->id()], sys.H_xf.rows(), var->size()) = sys.H_xf.block(0, ct_hx, sys.H_xf.rows(), var->size());
       ct_hx += var->size();
     }
 
     // Our isotropic measurement noise
-    R_big.block(ct_meas, ct_meas, res.rows(), res.rows()) *= sigma_pix_sq;
+    R_big.block(ct_meas, ct_meas, sys.res.rows(), sys.res.rows()) *= sys.sigma_pix_sq;
 
     // Append our residual and move forward
-    res_big.block(ct_meas, 0, res.rows(), 1) = res;
-    ct_meas += res.rows();
+    res_big.block(ct_meas, 0, sys.res.rows(), 1) = sys.res;
+    ct_meas += sys.res.rows();
     it2++;
   }
-  rT2 = boost::posix_time::microsec_clock::local_time();
+  span_system.stop();
+  ov_core::TraceSpan span_update("slam apply");
 
   // We have appended all features to our Hx_big, res_big
   // Delete it so we do not reuse information
@@ -468,14 +568,13 @@ void UpdaterSLAM::update(std::shared_ptr<State> state, std::vector<std::shared_p
 
   // 5. With all good SLAM features update the state
   StateHelper::EKFUpdate(state, Hx_order_big, Hx_big, res_big, R_big);
-  rT3 = boost::posix_time::microsec_clock::local_time();
+  span_update.stop();
 
   // Debug print timing information
-  PRINT_ALL("[SLAM-UP]: %.4f seconds to clean\n", (rT1 - rT0).total_microseconds() * 1e-6);
-  PRINT_ALL("[SLAM-UP]: %.4f seconds creating linear system\n", (rT2 - rT1).total_microseconds() * 1e-6);
-  PRINT_ALL("[SLAM-UP]: %.4f seconds to update (%d feats of %d size)\n", (rT3 - rT2).total_microseconds() * 1e-6, (int)feature_vec.size(),
+  PRINT_ALL("[SLAM-UP]: %.4f seconds to clean\n", span_clean.seconds());
+  PRINT_ALL("[SLAM-UP]: %.4f seconds creating linear system\n", span_system.seconds());
+  PRINT_ALL("[SLAM-UP]: %.4f seconds to update (%d feats of %d size)\n", span_update.seconds(), (int)feature_vec.size(),
             (int)Hx_big.rows());
-  PRINT_ALL("[SLAM-UP]: %.4f seconds total\n", (rT3 - rT1).total_microseconds() * 1e-6);
 }
 
 void UpdaterSLAM::change_anchors(std::shared_ptr<State> state) {
@@ -489,6 +588,8 @@ void UpdaterSLAM::change_anchors(std::shared_ptr<State> state) {
   // NOTE: for now we have anchor the feature in the same camera as it is before
   // NOTE: this also does not change the representation of the feature at all right now
   double marg_timestep = state->margtimestep();
+  UpdaterJacobianEngine::begin_pass(state);
+  std::vector<AnchorChange> changes;
   for (auto &f : state->_features_SLAM) {
     // Skip any features that are in the global frame
     if (f.second->_feat_representation == LandmarkRepresentation::Representation::GLOBAL_3D ||
@@ -497,13 +598,38 @@ void UpdaterSLAM::change_anchors(std::shared_ptr<State> state) {
     // Else lets see if it is anchored in the clone that will be marginalized
     assert(marg_timestep <= f.second->_anchor_clone_timestamp);
     if (f.second->_anchor_clone_timestamp == marg_timestep) {
-      perform_anchor_change(state, f.second, state->_timestamp, f.second->_anchor_cam_id);
+      changes.push_back(AnchorChange());
+      prepare_anchor_change(state, f.second, state->_timestamp, f.second->_anchor_cam_id, changes.back());
     }
   }
+  if (changes.empty())
+    return;
+
+  // All changes depend on the same dying anchor, so instead of one covariance
+  // transform per landmark we compose them into a single batched transform
+  std::vector<std::shared_ptr<Type>> order_NEW;
+  std::vector<std::vector<std::shared_ptr<Type>>> orders_OLD;
+  std::vector<Eigen::MatrixXd> Phis, Qs;
+  for (const auto &change : changes) {
+    order_NEW.push_back(change.landmark);
+    orders_OLD.push_back(change.phi_order);
+    Phis.push_back(change.Phi);
+    Qs.push_back(change.Q);
+  }
+  StateHelper::EKFPropagation_batch(state, order_NEW, orders_OLD, Phis, Qs);
+
+  // Finally move each landmark estimate into its new anchor frame
+  for (const auto &change : changes) {
+    change.landmark->_anchor_cam_id = (int)change.new_cam_id;
+    change.landmark->_anchor_clone_timestamp = change.new_anchor_timestamp;
+    change.landmark->set_from_xyz(change.p_FinA, false);
+    change.landmark->set_from_xyz(change.p_FinA_fej, true);
+    change.landmark->has_had_anchor_change = true;
+  }
 }
 
-void UpdaterSLAM::perform_anchor_change(std::shared_ptr<State> state, std::shared_ptr<Landmark> landmark, double new_anchor_timestamp,
-                                        size_t new_cam_id) {
+void UpdaterSLAM::prepare_anchor_change(std::shared_ptr<State> state, std::shared_ptr<Landmark> landmark, double new_anchor_timestamp,
+                                        size_t new_cam_id, AnchorChange &change) {
 
   // Assert that this is an anchored representation
   assert(LandmarkRepresentation::is_relative_representation(landmark->_feat_representation));
@@ -580,29 +706,25 @@ void UpdaterSLAM::perform_anchor_change(std::shared_ptr<State> state, std::share
   //==========================================================================
   //==========================================================================
 
-  // New phi order is just the landmark
-  std::vector<std::shared_ptr<Type>> phi_order_NEW;
-  phi_order_NEW.push_back(landmark);
-
   // Loop through all our orders and append them
   std::vector<std::shared_ptr<Type>> phi_order_OLD;
   int current_it = 0;
-  std::map<std::shared_ptr<Type>, int> Phi_id_map;
+  std::unordered_map<int, int> Phi_id_map;
   for (const auto &var : x_order_old) {
-    if (Phi_id_map.find(var) == Phi_id_map.end()) {
-      Phi_id_map.insert({var, current_it});
+    if (Phi_id_map.find(var->id()) == Phi_id_map.end()) {
+      Phi_id_map.insert({var->id(), current_it});
       phi_order_OLD.push_back(var);
       current_it += var->size();
     }
   }
   for (const auto &var : x_order_new) {
-    if (Phi_id_map.find(var) == Phi_id_map.end()) {
-      Phi_id_map.insert({var, current_it});
+    if (Phi_id_map.find(var->id()) == Phi_id_map.end()) {
+      Phi_id_map.insert({var->id(), current_it});
       phi_order_OLD.push_back(var);
       current_it += var->size();
     }
   }
-  Phi_id_map.insert({landmark, current_it});
+  Phi_id_map.insert({landmark->id(), current_it});
   phi_order_OLD.push_back(landmark);
   current_it += landmark->size();
 
@@ -622,26 +744,40 @@ void UpdaterSLAM::perform_anchor_change(std::shared_ptr<State> state, std::share
 
   // Place Jacobians for old anchor
   for (size_t i = 0; i < H_x_old.size(); i++) {
-    Phi.block(0, Phi_id_map.at(x_order_old[i]), phisize, x_order_old[i]->size()).noalias() += H_f_new_inv * H_x_old[i];
+    Phi.block(0, Phi_id_map.at(x_order_old[i]->id()), phisize, x_order_old[i]->size()).noalias() += H_f_new_inv * H_x_old[i];
   }
 
   // Place Jacobians for old feat
-  Phi.block(0, Phi_id_map.at(landmark), phisize, phisize) = H_f_new_inv * H_f_old;
+  Phi.block(0, Phi_id_map.at(landmark->id()), phisize, phisize) = H_f_new_inv * H_f_old;
 
   // Place Jacobians for new anchor
   for (size_t i = 0; i < H_x_new.size(); i++) {
-    Phi.block(0, Phi_id_map.at(x_order_new[i]), phisize, x_order_new[i]->size()).noalias() -= H_f_new_inv * H_x_new[i];
+    Phi.block(0, Phi_id_map.at(x_order_new[i]->id()), phisize, x_order_new[i]->size()).noalias() -= H_f_new_inv * H_x_new[i];
   }
 
-  // Perform covariance propagation
-  StateHelper::EKFPropagation(state, phi_order_NEW, phi_order_OLD, Phi, Q);
+  // Record everything needed to apply this change later
+  change.landmark = landmark;
+  change.phi_order = phi_order_OLD;
+  change.Phi = Phi;
+  change.Q = Q;
+  change.new_cam_id = new_feat.anchor_cam_id;
+  change.new_anchor_timestamp = new_feat.anchor_clone_timestamp;
+  change.p_FinA = new_feat.p_FinA;
+  change.p_FinA_fej = new_feat.p_FinA_fej;
+}
+
+void UpdaterSLAM::perform_anchor_change(std::shared_ptr<State> state, std::shared_ptr<Landmark> landmark, double new_anchor_timestamp,
+                                        size_t new_cam_id) {
+
+  // Prepare the transition, then apply it as a batch of one
+  AnchorChange change;
+  prepare_anchor_change(state, landmark, new_anchor_timestamp, new_cam_id, change);
+  StateHelper::EKFPropagation_batch(state, {landmark}, {change.phi_order}, {change.Phi}, {change.Q});
 
   // Set state from new feature
-  landmark->_featid = new_feat.featid;
-  landmark->_feat_representation = new_feat.feat_representation;
-  landmark->_anchor_cam_id = new_feat.anchor_cam_id;
-  landmark->_anchor_clone_timestamp = new_feat.anchor_clone_timestamp;
-  landmark->set_from_xyz(new_feat.p_FinA, false);
-  landmark->set_from_xyz(new_feat.p_FinA_fej, true);
+  landmark->_anchor_cam_id = (int)change.new_cam_id;
+  landmark->_anchor_clone_timestamp = change.new_anchor_timestamp;
+  landmark->set_from_xyz(change.p_FinA, false);
+  landmark->set_from_xyz(change.p_FinA_fej, true);
   landmark->has_had_anchor_change = true;
 }
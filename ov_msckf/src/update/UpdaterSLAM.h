@@ -35,6 +35,7 @@ class FeatureInitializer;
 } // namespace ov_core
 namespace ov_type {
 class Landmark;
+class Type;
 } // namespace ov_type
 
 namespace ov_msckf {
@@ -87,6 +88,42 @@ public:
   void change_anchors(std::shared_ptr<State> state);
 
 protected:
+  /// A prepared (but not yet applied) landmark anchor change (see prepare_anchor_change())
+  struct AnchorChange {
+    /// Landmark that is being re-anchored
+    std::shared_ptr<ov_type::Landmark> landmark;
+    /// Old-variable ordering the transition below is in terms of
+    std::vector<std::shared_ptr<ov_type::Type>> phi_order;
+    /// Transition of the landmark error from the old to the new anchor
+    Eigen::MatrixXd Phi;
+    /// Additive noise of the transition (zero for an anchor change)
+    Eigen::MatrixXd Q;
+    /// Camera the landmark will be anchored in
+    size_t new_cam_id = 0;
+    /// Clone timestamp the landmark will be anchored at
+    double new_anchor_timestamp = 0;
+    /// Landmark estimate in the new anchor frame
+    Eigen::Vector3d p_FinA;
+    /// First-estimate of the landmark in the new anchor frame
+    Eigen::Vector3d p_FinA_fej;
+  };
+
+  /**
+   * @brief Computes the transition and new estimate for shifting a landmark anchor to a new clone.
+   *
+   * This only fills in the passed change, it does not touch the state or covariance.
+   * All changes of a frame are applied together with a single batched covariance
+   * transform in change_anchors(), which is why preparation is split out.
+   *
+   * @param state State of filter
+   * @param landmark landmark whose anchor is being shifted
+   * @param new_anchor_timestamp Clone timestamp we want to move to
+   * @param new_cam_id Which camera frame we want to move to
+   * @param change Prepared anchor change (transition, ordering, and new estimates)
+   */
+  void prepare_anchor_change(std::shared_ptr<State> state, std::shared_ptr<ov_type::Landmark> landmark, double new_anchor_timestamp,
+                             size_t new_cam_id, AnchorChange &change);
+
   /**
    * @brief Shifts landmark anchor to new clone
    * @param state State of filter
@@ -105,9 +142,6 @@ protected:
 
   /// Feature initializer class object
   std::shared_ptr<ov_core::FeatureInitializer> initializer_feat;
-
-  /// Chi squared 95th percentile table (lookup would be size of residual)
-  std::map<int, double> chi_squared_table;
 };
 
 } // namespace ov_msckf
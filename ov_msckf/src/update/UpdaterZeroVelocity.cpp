@@ -28,12 +28,12 @@
 #include "state/Propagator.h"
 #include "state/State.h"
 #include "state/StateHelper.h"
+#include "utils/chi_square_table.h"
 #include "utils/colors.h"
 #include "utils/print.h"
 #include "utils/quat_ops.h"
 
 #include <boost/date_time/posix_time/posix_time.hpp>
-#include <boost/math/distributions/chi_squared.hpp>
 
 using namespace ov_core;
 using namespace ov_type;
@@ -48,18 +48,8 @@ UpdaterZeroVelocity::UpdaterZeroVelocity(UpdaterOptions &options, NoiseManager &
   // Gravity
   _gravity << 0.0, 0.0, gravity_mag;
 
-  // Save our raw pixel noise squared
-  _noises.sigma_w_2 = std::pow(_noises.sigma_w, 2);
-  _noises.sigma_a_2 = std::pow(_noises.sigma_a, 2);
-  _noises.sigma_wb_2 = std::pow(_noises.sigma_wb, 2);
-  _noises.sigma_ab_2 = std::pow(_noises.sigma_ab, 2);
-
-  // Initialize the chi squared test table with confidence level 0.95
-  // https://github.com/KumarRobotics/msckf_vio/blob/050c50defa5a7fd9a04c1eed5687b405f02919b5/src/msckf_vio.cpp#L215-L221
-  for (int i = 1; i < 1000; i++) {
-    boost::math::chi_squared chi_squared_dist(i);
-    chi_squared_table[i] = boost::math::quantile(chi_squared_dist, 0.95);
-  }
+  // Square the sigmas and resolve the per-axis diagonals
+  _noises.prepare();
 }
 
 bool UpdaterZeroVelocity::try_update(std::shared_ptr<State> state, double timestamp) {
@@ -113,6 +103,42 @@ bool UpdaterZeroVelocity::try_update(std::shared_ptr<State> state, double timest
   bool override_with_disparity_check = true;
   bool explicitly_enforce_zero_motion = false;
 
+  // Cheap hypothesis gates first, so enabling ZUPT does not add the cost of the
+  // full stacked IMU system to every moving frame:
+  //  - disparity passing forces an accept (it overrides the chi2 either way)
+  //  - disparity failing plus a velocity above the bound forces a reject
+  // Only the remaining ambiguous case (moving image, slow state) needs the
+  // expensive chi2 test against the stacked system below
+  bool disparity_passed = false;
+  if (override_with_disparity_check) {
+
+    // Get the disparity statistics from this image to the previous
+    double time0_cam = state->_timestamp;
+    double time1_cam = timestamp;
+    int num_features = 0;
+    double disp_avg = 0.0;
+    double disp_var = 0.0;
+    // The database keeps a per frame pair aggregate as measurements arrive, so this is
+    // normally an O(1) read, with the full scan as a fallback for uncached pairs
+    if (!_db->get_disparity(time0_cam, time1_cam, disp_avg, disp_var, num_features)) {
+      FeatureHelper::compute_disparity(_db, time0_cam, time1_cam, disp_avg, disp_var, num_features);
+    }
+
+    // Check if this disparity is enough to be classified as moving
+    disparity_passed = (disp_avg < _zupt_max_disparity && num_features > 20);
+    if (disparity_passed) {
+      PRINT_INFO(CYAN "[ZUPT]: passed disparity (%.3f < %.3f, %d features)\n" RESET, disp_avg, _zupt_max_disparity, (int)num_features);
+    } else {
+      PRINT_DEBUG(YELLOW "[ZUPT]: failed disparity (%.3f > %.3f, %d features)\n" RESET, disp_avg, _zupt_max_disparity, (int)num_features);
+    }
+  }
+  if (!disparity_passed && state->_imu->vel().norm() > _zupt_max_velocity) {
+    last_zupt_state_timestamp = 0.0;
+    last_zupt_count = 0;
+    PRINT_DEBUG(YELLOW "[ZUPT]: rejected |v_IinG| = %.3f (above %.3f bound)\n" RESET, state->_imu->vel().norm(), _zupt_max_velocity);
+    return false;
+  }
+
   // Order of our Jacobian
   std::vector<std::shared_ptr<Type>> Hx_order;
   Hx_order.push_back(state->_imu->q());
@@ -195,59 +221,36 @@ bool UpdaterZeroVelocity::try_update(std::shared_ptr<State> state, double timest
   Q_bias.block(0, 0, 3, 3) *= dt_summed * _noises.sigma_wb_2;
   Q_bias.block(3, 3, 3, 3) *= dt_summed * _noises.sigma_ab_2;
 
-  // Chi2 distance check
+  // Chi2 distance check (only when the disparity could not force an accept)
   // NOTE: we also append the propagation we "would do before the update" if this was to be accepted (just the bias evolution)
   // NOTE: we don't propagate first since if we fail the chi2 then we just want to return and do normal logic
-  Eigen::MatrixXd P_marg = StateHelper::get_marginal_covariance(state, Hx_order);
-  if (model_time_varying_bias) {
-    P_marg.block(3, 3, 6, 6) += Q_bias;
-  }
-  Eigen::MatrixXd S = H * P_marg * H.transpose() + R;
-  double chi2 = res.dot(S.llt().solve(res));
-
-  // Get our threshold (we precompute up to 1000 but handle the case that it is more)
-  double chi2_check;
-  if (res.rows() < 1000) {
-    chi2_check = chi_squared_table[res.rows()];
-  } else {
-    boost::math::chi_squared chi_squared_dist(res.rows());
-    chi2_check = boost::math::quantile(chi_squared_dist, 0.95);
-    PRINT_WARNING(YELLOW "[ZUPT]: chi2_check over the residual limit - %d\n" RESET, (int)res.rows());
-  }
-
-  // Check if the image disparity
-  bool disparity_passed = false;
-  if (override_with_disparity_check) {
-
-    // Get the disparity statistics from this image to the previous
-    double time0_cam = state->_timestamp;
-    double time1_cam = timestamp;
-    int num_features = 0;
-    double disp_avg = 0.0;
-    double disp_var = 0.0;
-    FeatureHelper::compute_disparity(_db, time0_cam, time1_cam, disp_avg, disp_var, num_features);
-
-    // Check if this disparity is enough to be classified as moving
-    disparity_passed = (disp_avg < _zupt_max_disparity && num_features > 20);
-    if (disparity_passed) {
-      PRINT_INFO(CYAN "[ZUPT]: passed disparity (%.3f < %.3f, %d features)\n" RESET, disp_avg, _zupt_max_disparity, (int)num_features);
-    } else {
-      PRINT_DEBUG(YELLOW "[ZUPT]: failed disparity (%.3f > %.3f, %d features)\n" RESET, disp_avg, _zupt_max_disparity, (int)num_features);
+  // NOTE: the covariance view reads the state blocks in place, so no dense marginal is gathered here
+  if (!disparity_passed) {
+    MarginalCovarianceView P_marg(state, Hx_order);
+    Eigen::MatrixXd S = P_marg.quadratic_form(H) + R;
+    if (model_time_varying_bias) {
+      // Equivalent to adding Q_bias to the (bg,ba) block of the marginal before forming S
+      S.noalias() += H.middleCols(3, 6) * Q_bias * H.middleCols(3, 6).transpose();
     }
+    double chi2 = res.dot(S.llt().solve(res));
+
+    // Get our threshold (flat table with analytic tail for large residuals)
+    double chi2_check = ChiSquareTable::chi_squared_095((int)res.rows());
+
+    // Check if we are currently zero velocity (the velocity bound was checked above)
+    if (chi2 > _options.chi2_multipler * chi2_check) {
+      last_zupt_state_timestamp = 0.0;
+      last_zupt_count = 0;
+      PRINT_DEBUG(YELLOW "[ZUPT]: rejected |v_IinG| = %.3f (chi2 %.3f > %.3f)\n" RESET, state->_imu->vel().norm(), chi2,
+                  _options.chi2_multipler * chi2_check);
+      return false;
+    }
+    PRINT_INFO(CYAN "[ZUPT]: accepted |v_IinG| = %.3f (chi2 %.3f < %.3f)\n" RESET, state->_imu->vel().norm(), chi2,
+               _options.chi2_multipler * chi2_check);
+  } else {
+    PRINT_INFO(CYAN "[ZUPT]: accepted |v_IinG| = %.3f (disparity override)\n" RESET, state->_imu->vel().norm());
   }
 
-  // Check if we are currently zero velocity
-  // We need to pass the chi2 and not be above our velocity threshold
-  if (!disparity_passed && (chi2 > _options.chi2_multipler * chi2_check || state->_imu->vel().norm() > _zupt_max_velocity)) {
-    last_zupt_state_timestamp = 0.0;
-    last_zupt_count = 0;
-    PRINT_DEBUG(YELLOW "[ZUPT]: rejected |v_IinG| = %.3f (chi2 %.3f > %.3f)\n" RESET, state->_imu->vel().norm(), chi2,
-                _options.chi2_multipler * chi2_check);
-    return false;
-  }
-  PRINT_INFO(CYAN "[ZUPT]: accepted |v_IinG| = %.3f (chi2 %.3f < %.3f)\n" RESET, state->_imu->vel().norm(), chi2,
-             _options.chi2_multipler * chi2_check);
-
   // Do our update, only do this update if we have previously detected
   // If we have succeeded, then we should remove the current timestamp feature tracks
   // This is because we will not clone at this timestep and instead do our zero velocity update
@@ -289,10 +292,12 @@ bool UpdaterZeroVelocity::try_update(std::shared_ptr<State> state, double timest
     R = Eigen::MatrixXd::Identity(9, 9);
 
     // residual (order is ori, pos, vel)
-    Eigen::Matrix3d R_GtoI0 = state->_clones_IMU.at(time0_cam)->Rot();
-    Eigen::Vector3d p_I0inG = state->_clones_IMU.at(time0_cam)->pos();
-    Eigen::Matrix3d R_GtoI1 = state->_clones_IMU.at(time1_cam)->Rot();
-    Eigen::Vector3d p_I1inG = state->_clones_IMU.at(time1_cam)->pos();
+    std::shared_ptr<ov_type::PoseJPL> clone_I0 = state->get_clone(time0_cam);
+    std::shared_ptr<ov_type::PoseJPL> clone_I1 = state->get_clone(time1_cam);
+    Eigen::Matrix3d R_GtoI0 = clone_I0->Rot();
+    Eigen::Vector3d p_I0inG = clone_I0->pos();
+    Eigen::Matrix3d R_GtoI1 = clone_I1->Rot();
+    Eigen::Vector3d p_I1inG = clone_I1->pos();
     res.block(0, 0, 3, 1) = -log_so3(R_GtoI0 * R_GtoI1.transpose());
     res.block(3, 0, 3, 1) = p_I1inG - p_I0inG;
     res.block(6, 0, 3, 1) = state->_imu->vel();
@@ -300,11 +305,11 @@ bool UpdaterZeroVelocity::try_update(std::shared_ptr<State> state, double timest
 
     // jacobian (order is q0, p0, q1, p1, v0)
     Hx_order.clear();
-    Hx_order.push_back(state->_clones_IMU.at(time0_cam));
-    Hx_order.push_back(state->_clones_IMU.at(time1_cam));
+    Hx_order.push_back(clone_I0);
+    Hx_order.push_back(clone_I1);
     Hx_order.push_back(state->_imu->v());
     if (state->_options.do_fej) {
-      R_GtoI0 = state->_clones_IMU.at(time0_cam)->Rot_fej();
+      R_GtoI0 = clone_I0->Rot_fej();
     }
     H.block(0, 0, 3, 3) = Eigen::Matrix3d::Identity();
     H.block(0, 6, 3, 3) = -R_GtoI0;
@@ -321,6 +326,7 @@ bool UpdaterZeroVelocity::try_update(std::shared_ptr<State> state, double timest
     StateHelper::EKFUpdate(state, Hx_order, H, res, R);
     StateHelper::marginalize(state, state->_clones_IMU.at(time1_cam));
     state->_clones_IMU.erase(time1_cam);
+    state->_clones_index.erase(time1_cam);
   }
 
   // Finally return
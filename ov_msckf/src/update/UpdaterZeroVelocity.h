@@ -114,6 +114,16 @@ public:
    */
   bool try_update(std::shared_ptr<State> state, double timestamp);
 
+  /**
+   * @brief Change the detection thresholds (used by the performance governor tiers)
+   * @param zupt_max_velocity Max velocity we should consider to do a update with
+   * @param zupt_max_disparity Max disparity we should consider to do a update with
+   */
+  void set_thresholds(double zupt_max_velocity, double zupt_max_disparity) {
+    _zupt_max_velocity = zupt_max_velocity;
+    _zupt_max_disparity = zupt_max_disparity;
+  }
+
 protected:
   /// Options used during update (chi2 multiplier)
   UpdaterOptions _options;
@@ -139,9 +149,6 @@ protected:
   /// Max disparity (pixels) that we should consider a zupt with
   double _zupt_max_disparity = 1.0;
 
-  /// Chi squared 95th percentile table (lookup would be size of residual)
-  std::map<int, double> chi_squared_table;
-
   /// Our history of IMU messages (time, angular, linear)
   std::vector<ov_core::ImuData> imu_data;
 
@@ -24,12 +24,20 @@
 
 #include <math.h>
 
+#include <Eigen/Eigen>
+
 #include "utils/print.h"
 
 namespace ov_msckf {
 
 /**
  * @brief Struct of our imu noise parameters
+ *
+ * The isotropic sigmas are what is loaded from the config, with optional per-axis
+ * overrides for sensors whose axes have different noise characteristics.
+ * After loading, prepare() must be called to resolve the squared per-axis diagonals.
+ * The discrete-time Qc diagonals for a given integration interval are cached since the
+ * IMU dt is constant in practice, so the per-sample pow()/divide work is done once.
  */
 struct NoiseManager {
 
@@ -57,15 +65,92 @@ struct NoiseManager {
   /// Accelerometer random walk covariance
   double sigma_ab_2 = pow(3.0000e-03, 2);
 
+  /// Optional per-axis sigma overrides (any axis left negative uses the isotropic value)
+  Eigen::Vector3d sigma_w_axis = Eigen::Vector3d::Constant(-1);
+  Eigen::Vector3d sigma_wb_axis = Eigen::Vector3d::Constant(-1);
+  Eigen::Vector3d sigma_a_axis = Eigen::Vector3d::Constant(-1);
+  Eigen::Vector3d sigma_ab_axis = Eigen::Vector3d::Constant(-1);
+
+  /// Resolved per-axis covariances (filled by prepare(), defaults match the isotropic sigmas)
+  Eigen::Vector3d sigma_w_2_axis = Eigen::Vector3d::Constant(pow(1.6968e-04, 2));
+  Eigen::Vector3d sigma_wb_2_axis = Eigen::Vector3d::Constant(pow(1.9393e-05, 2));
+  Eigen::Vector3d sigma_a_2_axis = Eigen::Vector3d::Constant(pow(2.0000e-3, 2));
+  Eigen::Vector3d sigma_ab_2_axis = Eigen::Vector3d::Constant(pow(3.0000e-03, 2));
+
+  /**
+   * @brief Squares the loaded sigmas and resolves the per-axis covariance diagonals.
+   * Must be called once after the config values have been parsed into the sigmas.
+   */
+  void prepare() {
+    sigma_w_2 = std::pow(sigma_w, 2);
+    sigma_wb_2 = std::pow(sigma_wb, 2);
+    sigma_a_2 = std::pow(sigma_a, 2);
+    sigma_ab_2 = std::pow(sigma_ab, 2);
+    for (int i = 0; i < 3; i++) {
+      sigma_w_2_axis(i) = (sigma_w_axis(i) > 0) ? std::pow(sigma_w_axis(i), 2) : sigma_w_2;
+      sigma_wb_2_axis(i) = (sigma_wb_axis(i) > 0) ? std::pow(sigma_wb_axis(i), 2) : sigma_wb_2;
+      sigma_a_2_axis(i) = (sigma_a_axis(i) > 0) ? std::pow(sigma_a_axis(i), 2) : sigma_a_2;
+      sigma_ab_2_axis(i) = (sigma_ab_axis(i) > 0) ? std::pow(sigma_ab_axis(i), 2) : sigma_ab_2;
+    }
+  }
+
+  /**
+   * @brief Diagonal of the continuous-time noise covariance over the interval (all blocks over dt).
+   *
+   * Ordered as [gyro white, accel white, gyro walk, accel walk], for use with noise Jacobians
+   * whose bias columns already carry the dt factor (see Propagator::compute_F_and_G_discrete).
+   * The last result is cached per-thread since the IMU dt is constant to the microsecond.
+   */
+  const Eigen::Matrix<double, 12, 1> &Qc_diagonal(double dt) const {
+    static thread_local const NoiseManager *owner = nullptr;
+    static thread_local double dt_cached = -1;
+    static thread_local Eigen::Matrix<double, 12, 1> diag;
+    if (owner != this || dt_cached != dt) {
+      diag.segment(0, 3) = sigma_w_2_axis / dt;
+      diag.segment(3, 3) = sigma_a_2_axis / dt;
+      diag.segment(6, 3) = sigma_wb_2_axis / dt;
+      diag.segment(9, 3) = sigma_ab_2_axis / dt;
+      owner = this;
+      dt_cached = dt;
+    }
+    return diag;
+  }
+
+  /**
+   * @brief Diagonal of the discrete-time noise covariance over the interval.
+   *
+   * Same ordering as Qc_diagonal() but with the random walk blocks multiplied by dt,
+   * for use with unit bias Jacobians (the quick discrete prediction path).
+   * The last result is cached per-thread since the IMU dt is constant to the microsecond.
+   */
+  const Eigen::Matrix<double, 12, 1> &Qd_diagonal(double dt) const {
+    static thread_local const NoiseManager *owner = nullptr;
+    static thread_local double dt_cached = -1;
+    static thread_local Eigen::Matrix<double, 12, 1> diag;
+    if (owner != this || dt_cached != dt) {
+      diag.segment(0, 3) = sigma_w_2_axis / dt;
+      diag.segment(3, 3) = sigma_a_2_axis / dt;
+      diag.segment(6, 3) = sigma_wb_2_axis * dt;
+      diag.segment(9, 3) = sigma_ab_2_axis * dt;
+      owner = this;
+      dt_cached = dt;
+    }
+    return diag;
+  }
+
   /// Nice print function of what parameters we have loaded
   void print() {
     PRINT_DEBUG("  - gyroscope_noise_density: %.6f\n", sigma_w);
     PRINT_DEBUG("  - accelerometer_noise_density: %.5f\n", sigma_a);
     PRINT_DEBUG("  - gyroscope_random_walk: %.7f\n", sigma_wb);
     PRINT_DEBUG("  - accelerometer_random_walk: %.6f\n", sigma_ab);
+    if ((sigma_w_axis.array() > 0).any() || (sigma_a_axis.array() > 0).any() || (sigma_wb_axis.array() > 0).any() ||
+        (sigma_ab_axis.array() > 0).any()) {
+      PRINT_DEBUG("  - per-axis noise overrides are active\n");
+    }
   }
 };
 
 } // namespace ov_msckf
 
-#endif // OV_MSCKF_NOISEMANAGER_H
\ No newline at end of file
+#endif // OV_MSCKF_NOISEMANAGER_H
@@ -0,0 +1,82 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2018-2023 Patrick Geneva
+ * Copyright (C) 2018-2023 Guoquan Huang
+ * Copyright (C) 2018-2023 OpenVINS Contributors
+ * Copyright (C) 2018-2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OV_MSCKF_CHI_SQUARE_TABLE_H
+#define OV_MSCKF_CHI_SQUARE_TABLE_H
+
+#include <array>
+#include <cmath>
+
+#include <boost/math/distributions/chi_squared.hpp>
+
+namespace ov_msckf {
+
+/**
+ * @brief Shared 95th-percentile chi-squared gating table.
+ *
+ * Every updater used to build its own std::map<int, double> of quantiles in its
+ * constructor and pay a tree lookup per gated feature, plus construct a whole
+ * boost distribution object whenever the degrees of freedom exceeded the table.
+ * This helper keeps a single flat array (built once on first use, O(1) indexed)
+ * and falls back to the analytic Wilson-Hilferty approximation above the table,
+ * which high-resolution configs with many measurements per feature do hit.
+ */
+class ChiSquareTable {
+
+public:
+  /// Largest degrees of freedom covered by the exact precomputed table
+  static const int MAX_DOF_TABLE = 500;
+
+  /**
+   * @brief 95th-percentile chi-squared quantile for the given degrees of freedom
+   * @param dof Degrees of freedom of the residual (must be positive)
+   * @return Value which a chi-squared statistic exceeds with probability 0.05
+   */
+  static double chi_squared_095(int dof) {
+
+    // Exact values from the flat table for the common small cases
+    static const std::array<double, MAX_DOF_TABLE + 1> table = build_table();
+    if (dof <= MAX_DOF_TABLE)
+      return table.at(dof);
+
+    // Wilson-Hilferty: (chi2/k)^(1/3) is approximately normal
+    // with mean 1-2/(9k) and variance 2/(9k), so invert at z_0.95
+    static const double z095 = 1.6448536269514722;
+    double k = (double)dof;
+    double term = 1.0 - 2.0 / (9.0 * k) + z095 * std::sqrt(2.0 / (9.0 * k));
+    return k * term * term * term;
+  }
+
+private:
+  /// Fills the exact quantile table (runs once, guarded by static initialization)
+  static std::array<double, MAX_DOF_TABLE + 1> build_table() {
+    std::array<double, MAX_DOF_TABLE + 1> table{};
+    for (int i = 1; i <= MAX_DOF_TABLE; i++) {
+      boost::math::chi_squared chi_squared_dist(i);
+      table.at(i) = boost::math::quantile(chi_squared_dist, 0.95);
+    }
+    return table;
+  }
+};
+
+} // namespace ov_msckf
+
+#endif // OV_MSCKF_CHI_SQUARE_TABLE_H
@@ -0,0 +1,214 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2018-2023 Patrick Geneva
+ * Copyright (C) 2018-2023 Guoquan Huang
+ * Copyright (C) 2018-2023 OpenVINS Contributors
+ * Copyright (C) 2018-2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OV_MSCKF_SHM_ODOMETRY_H
+#define OV_MSCKF_SHM_ODOMETRY_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ov_msckf {
+
+/**
+ * @brief One odometry sample exchanged through shared memory.
+ *
+ * Plain doubles only, so the record can be copied bytewise by any co-located
+ * process that includes this header (no serialization, no ROS dependency).
+ * Covariances are row-major 6x6 blocks matching the odometry convention:
+ * pose is (orientation, position) and twist is (linear, angular).
+ */
+struct ShmOdometryRecord {
+  /// Timestamp of the sample (camera clock, seconds)
+  double timestamp = 0.0;
+  /// Orientation as a JPL quaternion (x, y, z, w) from global to IMU
+  double q_GtoI[4] = {0.0, 0.0, 0.0, 1.0};
+  /// Position of the IMU in the global frame
+  double p_IinG[3] = {0.0, 0.0, 0.0};
+  /// Velocity of the IMU in the global frame
+  double v_IinG[3] = {0.0, 0.0, 0.0};
+  /// Angular velocity in the IMU frame (zero when not predicted from a reading)
+  double w_IinI[3] = {0.0, 0.0, 0.0};
+  /// Pose covariance, row-major 6x6 (orientation then position)
+  double cov_pose[36] = {0.0};
+  /// Twist covariance, row-major 6x6 (linear then angular)
+  double cov_twist[36] = {0.0};
+};
+
+/**
+ * @brief Memory layout of the shared segment (single seqlock-versioned record).
+ *
+ * The writer bumps the sequence to an odd value, copies the record, then bumps it
+ * to the next even value. A reader that observes the same even sequence before and
+ * after its copy got a torn-free sample; otherwise it simply retries. This keeps
+ * the filter thread wait-free (it never blocks on a reader) and readers lock-free.
+ */
+struct ShmOdometrySegment {
+  /// Magic word so readers never interpret an unrelated segment ("OVOD")
+  uint32_t magic = 0;
+  /// Layout version, bumped whenever ShmOdometryRecord changes
+  uint32_t layout = 0;
+  /// Seqlock sequence (odd while the writer is mid-copy, zero until the first write)
+  std::atomic<uint32_t> seq;
+  /// The latest odometry sample
+  ShmOdometryRecord record;
+};
+
+/// Magic word and layout version the segment is stamped with
+static const uint32_t SHM_ODOMETRY_MAGIC = 0x4F564F44;
+static const uint32_t SHM_ODOMETRY_LAYOUT = 1;
+
+/**
+ * @brief Writer side of the shared-memory odometry transport.
+ *
+ * Owned by the filter process; creates (or re-opens) the named POSIX shared memory
+ * segment and overwrites the single record in place on every publish. Failures to
+ * set the segment up are reported through good() and publishing becomes a no-op,
+ * so a missing /dev/shm never takes the filter down.
+ */
+class ShmOdometryWriter {
+
+public:
+  explicit ShmOdometryWriter(const std::string &name) {
+    std::string shm_name = (name.empty() || name.at(0) != '/') ? "/" + name : name;
+    fd = shm_open(shm_name.c_str(), O_CREAT | O_RDWR, 0666);
+    if (fd < 0)
+      return;
+    if (ftruncate(fd, sizeof(ShmOdometrySegment)) != 0) {
+      close(fd);
+      fd = -1;
+      return;
+    }
+    void *ptr = mmap(nullptr, sizeof(ShmOdometrySegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (ptr == MAP_FAILED) {
+      close(fd);
+      fd = -1;
+      return;
+    }
+    segment = static_cast<ShmOdometrySegment *>(ptr);
+    segment->seq.store(0, std::memory_order_relaxed);
+    segment->layout = SHM_ODOMETRY_LAYOUT;
+    // Stamp the magic last so a reader never trusts a half-initialized segment
+    segment->magic = SHM_ODOMETRY_MAGIC;
+  }
+
+  ~ShmOdometryWriter() {
+    if (segment != nullptr)
+      munmap(segment, sizeof(ShmOdometrySegment));
+    if (fd >= 0)
+      close(fd);
+  }
+
+  /// If the shared segment was mapped successfully
+  bool good() const { return segment != nullptr; }
+
+  /// Publish the next sample (wait-free, single writer assumed)
+  void write(const ShmOdometryRecord &record) {
+    if (segment == nullptr)
+      return;
+    uint32_t seq = segment->seq.load(std::memory_order_relaxed);
+    segment->seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    segment->record = record;
+    segment->seq.store(seq + 2, std::memory_order_release);
+  }
+
+private:
+  int fd = -1;
+  ShmOdometrySegment *segment = nullptr;
+};
+
+/**
+ * @brief Reader side of the shared-memory odometry transport (the client library).
+ *
+ * Header-only so consumers only need this file and -lrt, nothing from ov_msckf.
+ * read() returns the latest sample, retrying the seqlock a bounded number of times
+ * so a stalled writer can never spin a reader forever.
+ */
+class ShmOdometryReader {
+
+public:
+  explicit ShmOdometryReader(const std::string &name) : shm_name((name.empty() || name.at(0) != '/') ? "/" + name : name) {}
+
+  ~ShmOdometryReader() {
+    if (segment != nullptr)
+      munmap(segment, sizeof(ShmOdometrySegment));
+    if (fd >= 0)
+      close(fd);
+  }
+
+  /**
+   * @brief Copy out the latest published sample.
+   * @param record Filled with the newest record on success
+   * @return True if a torn-free sample was read, false if none is available yet
+   */
+  bool read(ShmOdometryRecord &record) {
+    if (segment == nullptr && !open())
+      return false;
+    for (int i = 0; i < 64; i++) {
+      uint32_t seq0 = segment->seq.load(std::memory_order_acquire);
+      if (seq0 == 0 || (seq0 & 1u) != 0)
+        continue;
+      record = segment->record;
+      std::atomic_thread_fence(std::memory_order_acquire);
+      uint32_t seq1 = segment->seq.load(std::memory_order_relaxed);
+      if (seq0 == seq1)
+        return true;
+    }
+    return false;
+  }
+
+private:
+  /// Lazily map the segment so the reader can be constructed before the writer
+  bool open() {
+    fd = shm_open(shm_name.c_str(), O_RDONLY, 0666);
+    if (fd < 0)
+      return false;
+    void *ptr = mmap(nullptr, sizeof(ShmOdometrySegment), PROT_READ, MAP_SHARED, fd, 0);
+    if (ptr == MAP_FAILED) {
+      close(fd);
+      fd = -1;
+      return false;
+    }
+    segment = static_cast<ShmOdometrySegment *>(ptr);
+    if (segment->magic != SHM_ODOMETRY_MAGIC || segment->layout != SHM_ODOMETRY_LAYOUT) {
+      munmap(segment, sizeof(ShmOdometrySegment));
+      close(fd);
+      fd = -1;
+      segment = nullptr;
+      return false;
+    }
+    return true;
+  }
+
+  std::string shm_name;
+  int fd = -1;
+  ShmOdometrySegment *segment = nullptr;
+};
+
+} // namespace ov_msckf
+
+#endif // OV_MSCKF_SHM_ODOMETRY_H